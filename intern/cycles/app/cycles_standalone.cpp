@@ -15,13 +15,23 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
+#include "background.h"
 #include "buffers.h"
 #include "camera.h"
 #include "device.h"
+#include "film.h"
+#include "graph.h"
+#include "image.h"
+#include "light.h"
+#include "mesh.h"
+#include "object.h"
 #include "scene.h"
 #include "session.h"
+#include "shader.h"
 #include "integrator.h"
+#include "subd_dice.h"
 
 #include "util_args.h"
 #include "util_foreach.h"
@@ -46,6 +56,9 @@ struct Options {
 	Session *session;
 	Scene *scene;
 	string filepath;
+	vector<string> frame_filepaths;
+	Scene *frame_scene;
+	double frame_sync_time, full_update_time;
 	int width, height;
 	SceneParams scene_params;
 	SessionParams session_params;
@@ -100,9 +113,28 @@ static BufferParams& session_buffer_params()
 	return buffer_params;
 }
 
+static string frame_output_path(size_t frame)
+{
+	const string& filepath = options.session_params.output_path;
+
+	/* Frame number goes before the extension. */
+	string::size_type dot = filepath.rfind('.');
+	string::size_type slash = filepath.find_last_of("/\\");
+
+	if(dot == string::npos || (slash != string::npos && dot < slash))
+		dot = filepath.size();
+
+	return filepath.substr(0, dot) + string_printf("_%04d", (int)frame + 1) + filepath.substr(dot);
+}
+
 static void session_init()
 {
 	options.session = new Session(options.session_params);
+
+	/* Tiles of every frame go to their own file. */
+	if(options.session_params.tiled_output && options.frame_filepaths.size() > 1)
+		options.session->params.output_path = frame_output_path(0);
+
 	options.session->reset(session_buffer_params(), options.session_params.samples);
 	options.session->scene = options.scene;
 
@@ -118,25 +150,438 @@ static void session_init()
 	options.scene = NULL;
 }
 
-static void scene_init()
+static Scene *scene_read(const string& filepath)
 {
-	options.scene = new Scene(options.scene_params, options.session_params.device);
+	Scene *scene = new Scene(options.scene_params, options.session_params.device);
 
 	/* Read XML */
-	xml_read_file(options.scene, options.filepath.c_str());
+	xml_read_file(scene, filepath.c_str());
+
+	/* Keep object transforms out of the mesh BVHs, so that moving objects
+	 * only need the top level BVH to be refitted. */
+	if(options.scene_params.persistent_data)
+		scene->params.bvh_type = SceneParams::BVH_DYNAMIC;
 
 	/* Camera width/height override? */
 	if(!(options.width == 0 || options.height == 0)) {
-		options.scene->camera->width = options.width;
-		options.scene->camera->height = options.height;
+		scene->camera->width = options.width;
+		scene->camera->height = options.height;
 	}
 	else {
-		options.width = options.scene->camera->width;
-		options.height = options.scene->camera->height;
+		options.width = scene->camera->width;
+		options.height = scene->camera->height;
 	}
 
 	/* Calculate Viewplane */
-	options.scene->camera->compute_auto_viewplane();
+	scene->camera->compute_auto_viewplane();
+
+	return scene;
+}
+
+static void scene_init()
+{
+	options.scene = scene_read(options.filepath);
+
+	/* Previous frame to compare the next one against. */
+	if(options.scene_params.persistent_data && options.frame_filepaths.size() > 1)
+		options.frame_scene = scene_read(options.filepath);
+}
+
+/* Persistent Data
+ *
+ * Every frame after the first is read into a scene that is never rendered,
+ * and compared against the previous frame. Only what changed is copied into
+ * the scene that is rendered, so unchanged meshes, their BVHs and images stay
+ * on the device. When objects, meshes, lights or shaders are added, removed
+ * or the shader graphs change, the frame is rendered from a new scene. */
+
+static bool socket_is_node(const SocketType& socket)
+{
+	/* Links to other nodes are remapped between scenes separately. */
+	return socket.type == SocketType::NODE || socket.type == SocketType::NODE_ARRAY;
+}
+
+static bool node_equals(const Node *a, const Node *b)
+{
+	foreach(const SocketType& socket, a->type->inputs) {
+		if(!socket_is_node(socket) && !a->equals_value(*b, socket))
+			return false;
+	}
+
+	return true;
+}
+
+static void node_copy(Node *dst, const Node *src)
+{
+	foreach(const SocketType& socket, src->type->inputs) {
+		if(!socket_is_node(socket))
+			dst->copy_value(socket, *src, socket);
+	}
+}
+
+template<typename T>
+static int scene_index(const vector<T*>& items, const T *item)
+{
+	for(size_t i = 0; i < items.size(); i++)
+		if(items[i] == item)
+			return i;
+
+	return -1;
+}
+
+static bool shader_graph_equals(ShaderGraph *a, ShaderGraph *b)
+{
+	if(a->nodes.size() != b->nodes.size())
+		return false;
+
+	list<ShaderNode*>::iterator it_a = a->nodes.begin();
+	list<ShaderNode*>::iterator it_b = b->nodes.begin();
+
+	for(; it_a != a->nodes.end(); ++it_a, ++it_b) {
+		ShaderNode *node_a = *it_a, *node_b = *it_b;
+
+		if(node_a->type != node_b->type || !node_a->equals(*node_b))
+			return false;
+
+		for(size_t i = 0; i < node_a->inputs.size(); i++) {
+			ShaderOutput *link_a = node_a->inputs[i]->link;
+			ShaderOutput *link_b = node_b->inputs[i]->link;
+
+			if((link_a == NULL) != (link_b == NULL))
+				return false;
+			if(link_a && (link_a->parent->id != link_b->parent->id ||
+			              link_a->name() != link_b->name()))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static bool voxel_attributes_equals(const Attribute& a, const Attribute& b)
+{
+	const VoxelAttribute *voxel_a = a.data_voxel();
+	const VoxelAttribute *voxel_b = b.data_voxel();
+
+	if(!voxel_a || !voxel_b)
+		return voxel_a == voxel_b;
+
+	/* Slots are per scene, compare the images behind them. */
+	const ImageManager::Image *image_a = (voxel_a->slot != -1)?
+		voxel_a->manager->get_image(voxel_a->slot): NULL;
+	const ImageManager::Image *image_b = (voxel_b->slot != -1)?
+		voxel_b->manager->get_image(voxel_b->slot): NULL;
+
+	if(!image_a || !image_b)
+		return image_a == image_b;
+
+	return image_a->filename == image_b->filename &&
+	       image_a->builtin_data == image_b->builtin_data &&
+	       image_a->animated == image_b->animated &&
+	       image_a->frame == image_b->frame &&
+	       image_a->interpolation == image_b->interpolation &&
+	       image_a->extension == image_b->extension;
+}
+
+static bool attributes_equals(const AttributeSet& a, const AttributeSet& b)
+{
+	if(a.attributes.size() != b.attributes.size())
+		return false;
+
+	list<Attribute>::const_iterator it_a = a.attributes.begin();
+	list<Attribute>::const_iterator it_b = b.attributes.begin();
+
+	for(; it_a != a.attributes.end(); ++it_a, ++it_b) {
+		if(it_a->name != it_b->name || it_a->std != it_b->std ||
+		   it_a->element != it_b->element || it_a->type != it_b->type)
+			return false;
+		if(it_a->element == ATTR_ELEMENT_VOXEL) {
+			if(!voxel_attributes_equals(*it_a, *it_b))
+				return false;
+		}
+		else if(it_a->buffer != it_b->buffer)
+			return false;
+	}
+
+	return true;
+}
+
+static bool mesh_subd_equals(Mesh *a, Mesh *b)
+{
+	if(a->subdivision_type != b->subdivision_type ||
+	   a->subd_faces.size() != b->subd_faces.size() ||
+	   a->subd_creases.size() != b->subd_creases.size() ||
+	   !(a->subd_face_corners == b->subd_face_corners) ||
+	   (a->subd_params == NULL) != (b->subd_params == NULL))
+		return false;
+
+	for(size_t i = 0; i < a->subd_faces.size(); i++) {
+		const Mesh::SubdFace& face_a = a->subd_faces[i];
+		const Mesh::SubdFace& face_b = b->subd_faces[i];
+
+		if(face_a.start_corner != face_b.start_corner ||
+		   face_a.num_corners != face_b.num_corners ||
+		   face_a.shader != face_b.shader ||
+		   face_a.smooth != face_b.smooth)
+			return false;
+	}
+
+	for(size_t i = 0; i < a->subd_creases.size(); i++) {
+		const Mesh::SubdEdgeCrease& crease_a = a->subd_creases[i];
+		const Mesh::SubdEdgeCrease& crease_b = b->subd_creases[i];
+
+		if(crease_a.v[0] != crease_b.v[0] ||
+		   crease_a.v[1] != crease_b.v[1] ||
+		   crease_a.crease != crease_b.crease)
+			return false;
+	}
+
+	if(a->subd_params &&
+	   (a->subd_params->dicing_rate != b->subd_params->dicing_rate ||
+	    memcmp(&a->subd_params->objecttoworld, &b->subd_params->objecttoworld, sizeof(Transform)) != 0))
+		return false;
+
+	return attributes_equals(a->subd_attributes, b->subd_attributes);
+}
+
+static bool mesh_equals(Scene *scene_a, Mesh *a, Scene *scene_b, Mesh *b)
+{
+	if(a->used_shaders.size() != b->used_shaders.size())
+		return false;
+
+	for(size_t i = 0; i < a->used_shaders.size(); i++)
+		if(scene_index(scene_a->shaders, a->used_shaders[i]) !=
+		   scene_index(scene_b->shaders, b->used_shaders[i]))
+			return false;
+
+	return node_equals(a, b) &&
+	       mesh_subd_equals(a, b) &&
+	       attributes_equals(a->attributes, b->attributes) &&
+	       attributes_equals(a->curve_attributes, b->curve_attributes);
+}
+
+static bool scene_sync_check(Scene *prev, Scene *next)
+{
+	if(prev->shaders.size() != next->shaders.size() ||
+	   prev->meshes.size() != next->meshes.size() ||
+	   prev->objects.size() != next->objects.size() ||
+	   prev->lights.size() != next->lights.size())
+		return false;
+
+	for(size_t i = 0; i < prev->shaders.size(); i++) {
+		Shader *shader_a = prev->shaders[i], *shader_b = next->shaders[i];
+
+		if(shader_a->name != shader_b->name ||
+		   !node_equals(shader_a, shader_b) ||
+		   !shader_graph_equals(shader_a->graph, shader_b->graph))
+			return false;
+	}
+
+	/* Meshes are copied from the new frame when they changed, which is not
+	 * supported for subdivision meshes. */
+	for(size_t i = 0; i < prev->meshes.size(); i++) {
+		Mesh *mesh_a = prev->meshes[i], *mesh_b = next->meshes[i];
+
+		if(mesh_a->subdivision_type != Mesh::SUBDIVISION_NONE ||
+		   mesh_b->subdivision_type != Mesh::SUBDIVISION_NONE)
+		{
+			if(!mesh_equals(prev, mesh_a, next, mesh_b))
+				return false;
+		}
+	}
+
+	for(size_t i = 0; i < prev->objects.size(); i++)
+		if(scene_index(prev->meshes, prev->objects[i]->mesh) !=
+		   scene_index(next->meshes, next->objects[i]->mesh))
+			return false;
+
+	for(size_t i = 0; i < prev->lights.size(); i++)
+		if(scene_index(prev->shaders, prev->lights[i]->shader) !=
+		   scene_index(next->shaders, next->lights[i]->shader))
+			return false;
+
+	if(scene_index(prev->shaders, prev->background->shader) !=
+	   scene_index(next->shaders, next->background->shader))
+		return false;
+
+	return true;
+}
+
+static bool scene_sync_frame(Scene *scene, Scene *prev, Scene *next)
+{
+	if(!scene_sync_check(prev, next))
+		return false;
+
+	if(!node_equals(prev->camera, next->camera)) {
+		node_copy(scene->camera, next->camera);
+		scene->camera->need_update = true;
+		scene->camera->need_device_update = true;
+	}
+	if(!node_equals(prev->film, next->film)) {
+		node_copy(scene->film, next->film);
+		scene->film->tag_update(scene);
+	}
+	if(!node_equals(prev->integrator, next->integrator)) {
+		node_copy(scene->integrator, next->integrator);
+		scene->integrator->tag_update(scene);
+	}
+	if(!node_equals(prev->background, next->background)) {
+		node_copy(scene->background, next->background);
+		scene->background->tag_update(scene);
+	}
+
+	for(size_t i = 0; i < scene->meshes.size(); i++) {
+		Mesh *mesh = scene->meshes[i];
+		Mesh *mesh_a = prev->meshes[i], *mesh_b = next->meshes[i];
+
+		if(mesh_equals(prev, mesh_a, next, mesh_b))
+			continue;
+
+		/* Only vertices moved, the mesh BVH can be refitted. */
+		bool rebuild = !(mesh_a->triangles == mesh_b->triangles &&
+		                 mesh_a->curve_first_key == mesh_b->curve_first_key &&
+		                 mesh_a->verts.size() == mesh_b->verts.size() &&
+		                 mesh_a->curve_keys.size() == mesh_b->curve_keys.size());
+
+		mesh->clear();
+		node_copy(mesh, mesh_b);
+		mesh->attributes.attributes = mesh_b->attributes.attributes;
+		mesh->curve_attributes.attributes = mesh_b->curve_attributes.attributes;
+		/* Voxel slots point into the image manager of the next scene, which
+		 * is freed before the next frame. */
+		mesh->attributes.remap_voxel_images(scene->image_manager);
+
+		foreach(Shader *shader, mesh_b->used_shaders)
+			mesh->used_shaders.push_back(scene->shaders[scene_index(next->shaders, shader)]);
+
+		mesh->tag_update(scene, rebuild);
+	}
+
+	for(size_t i = 0; i < scene->objects.size(); i++) {
+		if(!node_equals(prev->objects[i], next->objects[i])) {
+			node_copy(scene->objects[i], next->objects[i]);
+			scene->objects[i]->tag_update(scene);
+		}
+	}
+
+	for(size_t i = 0; i < scene->lights.size(); i++) {
+		if(!node_equals(prev->lights[i], next->lights[i])) {
+			node_copy(scene->lights[i], next->lights[i]);
+			scene->lights[i]->tag_update(scene);
+		}
+	}
+
+	return true;
+}
+
+static void session_frame_init(size_t frame)
+{
+	Session *session = options.session;
+	const string& filepath = options.frame_filepaths[frame];
+	Scene *next = scene_read(filepath);
+	double sync_start_time = time_dt();
+	bool synced = false;
+
+	if(options.frame_scene) {
+		thread_scoped_lock scene_lock(session->scene->mutex);
+		synced = scene_sync_frame(session->scene, options.frame_scene, next);
+	}
+
+	if(synced) {
+		delete options.frame_scene;
+		options.frame_scene = next;
+	}
+	else {
+		/* Render the frame from a new scene, freeing the old one from the device. */
+		VLOG(1) << "Full scene update for " << filepath << ".";
+
+		delete session->scene;
+		session->scene = next;
+
+		if(options.frame_scene) {
+			delete options.frame_scene;
+			options.frame_scene = scene_read(filepath);
+		}
+	}
+
+	options.frame_sync_time = time_dt() - sync_start_time;
+
+	if(options.session_params.tiled_output)
+		session->params.output_path = frame_output_path(frame);
+
+	session->progress.reset();
+	session->reset(session_buffer_params(), options.session_params.samples);
+	session->start();
+}
+
+static void session_print_frame(size_t frame)
+{
+	Progress& progress = options.session->progress;
+	double total_time, render_time;
+
+	progress.get_time(total_time, render_time);
+	double update_time = progress.get_update_time() + options.frame_sync_time;
+
+	if(frame == 0)
+		options.full_update_time = update_time;
+
+	string str = string_printf("Frame %d/%d   Time %.2f   Scene Update %.2f",
+	                           (int)frame + 1,
+	                           (int)options.frame_filepaths.size(),
+	                           total_time,
+	                           update_time);
+
+	if(frame > 0 && options.scene_params.persistent_data)
+		str += string_printf("   Saved %.2f", max(options.full_update_time - update_time, 0.0));
+
+	/* Shaders compiled for this frame, unchanged ones are reused. */
+	map<string, double> compile_times;
+	progress.get_shader_compile_times(compile_times);
+
+	if(!compile_times.empty()) {
+		double compile_time = 0.0;
+		map<string, double>::iterator slowest = compile_times.begin();
+
+		for(map<string, double>::iterator it = compile_times.begin(); it != compile_times.end(); it++) {
+			compile_time += it->second;
+			if(it->second > slowest->second)
+				slowest = it;
+		}
+
+		str += string_printf("   Shaders %d Compiled %.2f (slowest %s %.2f)",
+		                     (int)compile_times.size(),
+		                     compile_time,
+		                     slowest->first.c_str(),
+		                     slowest->second);
+	}
+
+	session_print(str);
+	printf("\n");
+}
+
+static void session_render_frames()
+{
+	bool write_output = !options.session_params.output_path.empty();
+
+	for(size_t frame = 0; frame < options.frame_filepaths.size(); frame++) {
+		if(frame > 0)
+			session_frame_init(frame);
+
+		options.session->wait();
+
+		Progress& progress = options.session->progress;
+		if(progress.get_cancel() || progress.get_error())
+			break;
+
+		if(write_output && !options.session_params.tiled_output)
+			options.session->write_image(frame_output_path(frame));
+
+		if(!options.quiet)
+			session_print_frame(frame);
+	}
+
+	/* All frames were written already. */
+	options.session->params.output_path = "";
 }
 
 static void session_exit()
@@ -149,6 +594,10 @@ static void session_exit()
 		delete options.scene;
 		options.scene = NULL;
 	}
+	if(options.frame_scene) {
+		delete options.frame_scene;
+		options.frame_scene = NULL;
+	}
 
 	if(options.session_params.background && !options.quiet) {
 		session_print("Finished Rendering.");
@@ -321,8 +770,11 @@ static void keyboard(unsigned char key)
 
 static int files_parse(int argc, const char *argv[])
 {
-	if(argc > 0)
-		options.filepath = argv[0];
+	for(int i = 0; i < argc; i++)
+		options.frame_filepaths.push_back(argv[i]);
+
+	if(options.frame_filepaths.size())
+		options.filepath = options.frame_filepaths[0];
 
 	return 0;
 }
@@ -333,6 +785,9 @@ static void options_parse(int argc, const char **argv)
 	options.height = 0;
 	options.filepath = "";
 	options.session = NULL;
+	options.frame_scene = NULL;
+	options.frame_sync_time = 0.0;
+	options.full_update_time = 0.0;
 	options.quiet = false;
 
 	/* device names */
@@ -362,7 +817,7 @@ static void options_parse(int argc, const char **argv)
 	bool help = false, debug = false, version = false;
 	int verbosity = 1;
 
-	ap.options ("Usage: cycles [options] file.xml",
+	ap.options ("Usage: cycles [options] file.xml [frame2.xml ...]",
 		"%*", files_parse, "",
 		"--device %s", &devicename, ("Devices to use: " + device_names).c_str(),
 #ifdef WITH_OSL
@@ -372,6 +827,8 @@ static void options_parse(int argc, const char **argv)
 		"--quiet", &options.quiet, "In background mode, don't print progress messages",
 		"--samples %d", &options.session_params.samples, "Number of samples to render",
 		"--output %s", &options.session_params.output_path, "File path to write output image",
+		"--tiled-output", &options.session_params.tiled_output, "Write tiles to a multilayer EXR output image while rendering, without keeping the full image in memory",
+		"--persistent-data", &options.scene_params.persistent_data, "Keep unchanged scene data on the device between frames",
 		"--threads %d", &options.session_params.threads, "CPU Rendering Threads",
 		"--width  %d", &options.width, "Window width in pixel",
 		"--height %d", &options.height, "Window height in pixel",
@@ -428,8 +885,8 @@ static void options_parse(int argc, const char **argv)
 	options.session_params.background = true;
 #endif
 
-	/* Use progressive rendering */
-	options.session_params.progressive = true;
+	/* Use progressive rendering, unless tiles are written as they finish */
+	options.session_params.progressive = !options.session_params.tiled_output;
 
 	/* find matching device */
 	DeviceType device_type = Device::type_from_string(devicename.c_str());
@@ -490,7 +947,10 @@ int main(int argc, const char **argv)
 	if(options.session_params.background) {
 #endif
 		session_init();
-		options.session->wait();
+		if(options.frame_filepaths.size() > 1)
+			session_render_frames();
+		else
+			options.session->wait();
 		session_exit();
 #ifdef WITH_CYCLES_STANDALONE_GUI
 	}
@@ -327,6 +327,11 @@ static void create_mesh_volume_attributes(Scene *scene,
 		create_mesh_volume_attribute(b_ob, mesh, scene->image_manager, ATTR_STD_VOLUME_HEAT, frame);
 	if(mesh->need_attribute(scene, ATTR_STD_VOLUME_VELOCITY))
 		create_mesh_volume_attribute(b_ob, mesh, scene->image_manager, ATTR_STD_VOLUME_VELOCITY, frame);
+
+	/* smoke only exists where there are voxels, so the domain mesh can be
+	 * replaced by bounds around them to skip empty space */
+	if(object_smoke_domain_find(b_ob))
+		mesh->use_volume_bounds = true;
 }
 
 /* Create vertex color attributes. */
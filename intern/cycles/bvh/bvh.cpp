@@ -111,10 +111,15 @@ void BVH::build(Progress& progress)
 
 void BVH::refit(Progress& progress)
 {
-	progress.set_substatus("Packing BVH primitives");
-	pack_primitives();
-
-	if(progress.get_cancel()) return;
+	/* The top level BVH has the instanced meshes merged into its arrays,
+	 * only object bounds are expected to change there, so primitives are
+	 * left as is and only the top level nodes are refitted. */
+	if(!params.top_level) {
+		progress.set_substatus("Packing BVH primitives");
+		pack_primitives();
+
+		if(progress.get_cancel()) return;
+	}
 
 	progress.set_substatus("Refitting BVH nodes");
 	refit_nodes();
@@ -622,8 +627,6 @@ void RegularBVH::pack_nodes(const BVHNode *root)
 
 void RegularBVH::refit_nodes()
 {
-	assert(!params.top_level);
-
 	BoundBox bbox = BoundBox::empty;
 	uint visibility = 0;
 	refit_node(0, (pack.root_index == -1)? true: false, bbox, visibility);
@@ -636,8 +639,12 @@ void RegularBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility
 		const int4 *data = &pack.leaf_nodes[idx];
 		const int c0 = data[0].x;
 		const int c1 = data[0].y;
+		/* object instance leaves in the top level are packed as ~prim,
+		 * without a primitive range */
+		const int prim_lo = (c0 < 0)? ~c0: c0;
+		const int prim_hi = (c0 < 0)? prim_lo + 1: c1;
 		/* refit leaf node */
-		for(int prim = c0; prim < c1; prim++) {
+		for(int prim = prim_lo; prim < prim_hi; prim++) {
 			int pidx = pack.prim_index[prim];
 			int tob = pack.prim_object[prim];
 			Object *ob = objects[tob];
@@ -1075,8 +1082,6 @@ void QBVH::pack_nodes(const BVHNode *root)
 
 void QBVH::refit_nodes()
 {
-	assert(!params.top_level);
-
 	BoundBox bbox = BoundBox::empty;
 	uint visibility = 0;
 	refit_node(0, (pack.root_index == -1)? true: false, bbox, visibility);
@@ -1087,8 +1092,12 @@ void QBVH::refit_node(int idx, bool leaf, BoundBox& bbox, uint& visibility)
 	if(leaf) {
 		int4 *data = &pack.leaf_nodes[idx];
 		int4 c = data[0];
+		/* Object instance leaves in the top level are packed as ~prim,
+		 * without a primitive range. */
+		const int prim_lo = (c.x < 0)? ~c.x: c.x;
+		const int prim_hi = (c.x < 0)? prim_lo + 1: c.y;
 		/* Refit leaf node. */
-		for(int prim = c.x; prim < c.y; prim++) {
+		for(int prim = prim_lo; prim < prim_hi; prim++) {
 			int pidx = pack.prim_index[prim];
 			int tob = pack.prim_object[prim];
 			Object *ob = objects[tob];
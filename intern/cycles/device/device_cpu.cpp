@@ -45,6 +45,7 @@
 #include "util_progress.h"
 #include "util_system.h"
 #include "util_thread.h"
+#include "util_time.h"
 
 CCL_NAMESPACE_BEGIN
 
@@ -165,7 +166,8 @@ public:
 		                mem.data_height,
 		                mem.data_depth,
 		                interpolation,
-		                extension);
+		                extension,
+		                mem.grid_info);
 		mem.device_pointer = mem.data_pointer;
 		mem.device_size = mem.memory_size();
 		stats.mem_alloc(mem.device_size);
@@ -219,41 +221,54 @@ public:
 		RenderTile tile;
 
 		void(*path_trace_kernel)(KernelGlobals*, float*, unsigned int*, int, int, int, int, int);
+		void(*path_trace_stream_kernel)(KernelGlobals*, float*, unsigned int*, int, int, int, int, int, int);
 
 #ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX2
 		if(system_cpu_support_avx2()) {
 			path_trace_kernel = kernel_cpu_avx2_path_trace;
+			path_trace_stream_kernel = kernel_cpu_avx2_path_trace_stream;
 		}
 		else
 #endif
 #ifdef WITH_CYCLES_OPTIMIZED_KERNEL_AVX
 		if(system_cpu_support_avx()) {
 			path_trace_kernel = kernel_cpu_avx_path_trace;
+			path_trace_stream_kernel = kernel_cpu_avx_path_trace_stream;
 		}
 		else
 #endif
 #ifdef WITH_CYCLES_OPTIMIZED_KERNEL_SSE41
 		if(system_cpu_support_sse41()) {
 			path_trace_kernel = kernel_cpu_sse41_path_trace;
+			path_trace_stream_kernel = kernel_cpu_sse41_path_trace_stream;
 		}
 		else
 #endif
 #ifdef WITH_CYCLES_OPTIMIZED_KERNEL_SSE3
 		if(system_cpu_support_sse3()) {
 			path_trace_kernel = kernel_cpu_sse3_path_trace;
+			path_trace_stream_kernel = kernel_cpu_sse3_path_trace_stream;
 		}
 		else
 #endif
 #ifdef WITH_CYCLES_OPTIMIZED_KERNEL_SSE2
 		if(system_cpu_support_sse2()) {
 			path_trace_kernel = kernel_cpu_sse2_path_trace;
+			path_trace_stream_kernel = kernel_cpu_sse2_path_trace_stream;
 		}
 		else
 #endif
 		{
 			path_trace_kernel = kernel_cpu_path_trace;
+			path_trace_stream_kernel = kernel_cpu_path_trace_stream;
 		}
-		
+
+		/* Ray stream mode, timings are logged to compare against tracing
+		 * pixel by pixel. */
+		const bool use_stream = DebugFlags().cpu.stream;
+		double path_trace_time = 0.0;
+		int64_t num_path_samples = 0;
+
 		while(task.acquire_tile(this, tile)) {
 			float *render_buffer = (float*)tile.buffer;
 			uint *rng_state = (uint*)tile.rng_state;
@@ -266,13 +281,25 @@ public:
 						break;
 				}
 
+				double start_time = time_dt();
+
 				for(int y = tile.y; y < tile.y + tile.h; y++) {
+					if(use_stream) {
+						path_trace_stream_kernel(&kg, render_buffer, rng_state,
+						                         sample, tile.x, y, tile.w,
+						                         tile.offset, tile.stride);
+						continue;
+					}
+
 					for(int x = tile.x; x < tile.x + tile.w; x++) {
 						path_trace_kernel(&kg, render_buffer, rng_state,
 						                  sample, x, y, tile.offset, tile.stride);
 					}
 				}
 
+				path_trace_time += time_dt() - start_time;
+				num_path_samples += (int64_t)tile.w * tile.h;
+
 				tile.sample = sample + 1;
 
 				task.update_progress(&tile);
@@ -286,6 +313,14 @@ public:
 			}
 		}
 
+		if(num_path_samples > 0) {
+			VLOG(2) << "Path traced " << num_path_samples << " samples in "
+			        << path_trace_time << "s using "
+			        << (use_stream ? "ray stream" : "megakernel") << ", "
+			        << (num_path_samples / max(path_trace_time, 1e-6)) * 1e-6
+			        << "M samples/s.";
+		}
+
 		thread_kernel_globals_free(&kg);
 	}
 
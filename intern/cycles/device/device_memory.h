@@ -177,6 +177,9 @@ public:
 	size_t data_height;
 	size_t data_depth;
 
+	/* offsets grid for sparse 3D textures, see util_sparse_grid.h */
+	device_ptr grid_info;
+
 	/* device pointer */
 	device_ptr device_pointer;
 
@@ -204,6 +207,7 @@ public:
 		data_width = 0;
 		data_height = 0;
 		data_depth = 0;
+		grid_info = 0;
 
 		assert(data_elements > 0);
 
@@ -223,6 +227,7 @@ public:
 		data_width = width;
 		data_height = height;
 		data_depth = depth;
+		grid_info = 0;
 		if(data_size == 0) {
 			data_pointer = 0;
 			return NULL;
@@ -231,6 +236,25 @@ public:
 		return &data[0];
 	}
 
+	/* Sparse 3D textures only store num_voxels of the width*height*depth
+	 * voxels, grid_info points to the offsets used to find them. Existing
+	 * data is freed rather than shrunk, to actually release the memory. */
+	T *resize_sparse(size_t num_voxels, size_t width, size_t height, size_t depth, int *offsets)
+	{
+		data.clear();
+		if(data.resize(num_voxels) == NULL) {
+			clear();
+			return NULL;
+		}
+		data_size = num_voxels;
+		data_width = width;
+		data_height = height;
+		data_depth = depth;
+		grid_info = (device_ptr)offsets;
+		data_pointer = (device_ptr)&data[0];
+		return &data[0];
+	}
+
 	T *copy(T *ptr, size_t width, size_t height = 0, size_t depth = 0)
 	{
 		T *mem = resize(width, height, depth);
@@ -266,6 +290,7 @@ public:
 		data_height = 0;
 		data_depth = 0;
 		data_size = 0;
+		grid_info = 0;
 	}
 
 	size_t size()
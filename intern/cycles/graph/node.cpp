@@ -18,6 +18,7 @@
 #include "node_type.h"
 
 #include "util_foreach.h"
+#include "util_md5.h"
 #include "util_param.h"
 #include "util_transform.h"
 
@@ -403,5 +404,42 @@ bool Node::equals(const Node& other) const
 	return true;
 }
 
+/* Hash */
+
+template<typename T>
+static void array_hash(const Node *node, const SocketType& socket, MD5Hash& md5)
+{
+	const array<T>& a = *(const array<T>*)(((char*)node) + socket.struct_offset);
+	for(size_t i = 0; i < a.size(); i++) {
+		md5.append((uint8_t*)&a[i], sizeof(T));
+	}
+}
+
+void Node::hash(MD5Hash& md5)
+{
+	md5.append((const uint8_t*)type->name.c_str(), type->name.size());
+
+	foreach(const SocketType& socket, type->inputs) {
+		md5.append((const uint8_t*)socket.name.c_str(), socket.name.size());
+
+		switch(socket.type) {
+			case SocketType::BOOLEAN_ARRAY: array_hash<bool>(this, socket, md5); break;
+			case SocketType::FLOAT_ARRAY: array_hash<float>(this, socket, md5); break;
+			case SocketType::INT_ARRAY: array_hash<int>(this, socket, md5); break;
+			case SocketType::COLOR_ARRAY: array_hash<float3>(this, socket, md5); break;
+			case SocketType::VECTOR_ARRAY: array_hash<float3>(this, socket, md5); break;
+			case SocketType::POINT_ARRAY: array_hash<float3>(this, socket, md5); break;
+			case SocketType::NORMAL_ARRAY: array_hash<float3>(this, socket, md5); break;
+			case SocketType::POINT2_ARRAY: array_hash<float2>(this, socket, md5); break;
+			case SocketType::STRING_ARRAY: array_hash<ustring>(this, socket, md5); break;
+			case SocketType::TRANSFORM_ARRAY: array_hash<Transform>(this, socket, md5); break;
+			case SocketType::NODE_ARRAY: array_hash<void*>(this, socket, md5); break;
+			default:
+				md5.append(((uint8_t*)this) + socket.struct_offset, socket.size());
+				break;
+		}
+	}
+}
+
 CCL_NAMESPACE_END
 
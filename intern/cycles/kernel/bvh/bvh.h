@@ -303,6 +303,12 @@ ccl_device_intersect uint scene_intersect_volume_all(KernelGlobals *kg,
 }
 #endif  /* __VOLUME_RECORD_ALL__ */
 
+/* Packet traversal for coherent rays */
+
+#if defined(__KERNEL_CPU__) && defined(__KERNEL_SSE2__)
+#  include "bvh_packet.h"
+#endif
+
 
 /* Ray offset to avoid self intersection.
  *
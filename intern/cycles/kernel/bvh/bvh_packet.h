@@ -0,0 +1,458 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Packet BVH traversal
+ *
+ * Traverses a packet of up to four rays through the BVH together, testing
+ * each node against all rays at once using SSE. A node is visited when any
+ * ray in the packet hits it, so this only pays off for coherent rays, such as
+ * camera rays of neighbouring pixels or their shadow rays towards the same
+ * light. Primitives are still intersected one ray at a time.
+ *
+ * Only triangles, optionally instanced, are supported. Scenes with hair or
+ * object motion must use single ray traversal instead, which is checked with
+ * scene_intersect_packet_supported(). */
+
+#define BVH_PACKET_SIZE 4
+#define BVH_PACKET_MASK ((1 << BVH_PACKET_SIZE) - 1)
+
+typedef struct BVHPacketStackItem {
+	int addr;
+	int mask;
+} BVHPacketStackItem;
+
+typedef struct BVHPacket {
+	/* Per ray data, in object space while inside an instance. */
+	float3 P[BVH_PACKET_SIZE];
+	float3 dir[BVH_PACKET_SIZE];
+	float3 idir[BVH_PACKET_SIZE];
+	IsectPrecalc isect_precalc[BVH_PACKET_SIZE];
+
+	/* Same data in SoA layout, for node intersection. */
+	sse3f org4;
+	sse3f idir4;
+	sseb positive_x, positive_y, positive_z;
+	ssef tfar;
+} BVHPacket;
+
+ccl_device_inline bool scene_intersect_packet_supported(KernelGlobals *kg)
+{
+	return !kernel_data.bvh.have_motion && !kernel_data.bvh.have_curves;
+}
+
+ccl_device_inline void bvh_packet_update(BVHPacket *packet,
+                                         const Intersection *isect,
+                                         int mask)
+{
+	for(int i = 0; i < BVH_PACKET_SIZE; i++) {
+		if(mask & (1 << i)) {
+			packet->org4.x[i] = packet->P[i].x;
+			packet->org4.y[i] = packet->P[i].y;
+			packet->org4.z[i] = packet->P[i].z;
+			packet->idir4.x[i] = packet->idir[i].x;
+			packet->idir4.y[i] = packet->idir[i].y;
+			packet->idir4.z[i] = packet->idir[i].z;
+			packet->tfar[i] = isect[i].t;
+			triangle_intersect_precalc(packet->dir[i], &packet->isect_precalc[i]);
+		}
+	}
+
+	const ssef zero(0.0f);
+	packet->positive_x = packet->idir4.x >= zero;
+	packet->positive_y = packet->idir4.y >= zero;
+	packet->positive_z = packet->idir4.z >= zero;
+}
+
+/* Intersect all rays of the packet with a single box, returns a bit mask of
+ * the rays hitting it. The near and far planes are chosen per ray so that the
+ * inverted bounds QBVH uses for empty children are never hit. */
+ccl_device_inline int bvh_packet_box_intersect(const BVHPacket *packet,
+                                               float min_x, float max_x,
+                                               float min_y, float max_y,
+                                               float min_z, float max_z,
+                                               ssef *dist)
+{
+	const ssef lo_x(min_x), hi_x(max_x);
+	const ssef lo_y(min_y), hi_y(max_y);
+	const ssef lo_z(min_z), hi_z(max_z);
+
+	const ssef tnear_x = (select(packet->positive_x, lo_x, hi_x) - packet->org4.x) * packet->idir4.x;
+	const ssef tnear_y = (select(packet->positive_y, lo_y, hi_y) - packet->org4.y) * packet->idir4.y;
+	const ssef tnear_z = (select(packet->positive_z, lo_z, hi_z) - packet->org4.z) * packet->idir4.z;
+	const ssef tfar_x = (select(packet->positive_x, hi_x, lo_x) - packet->org4.x) * packet->idir4.x;
+	const ssef tfar_y = (select(packet->positive_y, hi_y, lo_y) - packet->org4.y) * packet->idir4.y;
+	const ssef tfar_z = (select(packet->positive_z, hi_z, lo_z) - packet->org4.z) * packet->idir4.z;
+
+	const ssef tnear = max(max(tnear_x, tnear_y), max(tnear_z, ssef(0.0f)));
+	const ssef tfar = min(min(tfar_x, tfar_y), min(tfar_z, packet->tfar));
+
+	*dist = tnear;
+	return movemask(tnear <= tfar);
+}
+
+/* Closest distance to the box over the rays in mask, used for ordering. */
+ccl_device_inline float bvh_packet_box_dist(const ssef& dist, int mask)
+{
+	return reduce_min(select(sseb(mask), dist, ssef(FLT_MAX)));
+}
+
+/* Intersect the children of an inner node, returning the number of children
+ * hit with their addresses and ray masks sorted from near to far. */
+ccl_device_inline int bvh_packet_node_intersect(KernelGlobals *kg,
+                                                const BVHPacket *packet,
+                                                const int node_addr,
+                                                const int node_mask,
+                                                const uint visibility,
+                                                int child_addr[4],
+                                                int child_mask[4])
+{
+	float child_dist[4];
+	int num_children = 0;
+	ssef dist;
+
+#ifdef __QBVH__
+	if(kernel_data.bvh.use_qbvh) {
+		float4 inodes = kernel_tex_fetch(__bvh_nodes, node_addr+0);
+
+#ifdef __VISIBILITY_FLAG__
+		if((__float_as_uint(inodes.x) & visibility) == 0) {
+			return 0;
+		}
+#endif
+
+		const ssef bmin_x = kernel_tex_fetch_ssef(__bvh_nodes, node_addr+1);
+		const ssef bmax_x = kernel_tex_fetch_ssef(__bvh_nodes, node_addr+2);
+		const ssef bmin_y = kernel_tex_fetch_ssef(__bvh_nodes, node_addr+3);
+		const ssef bmax_y = kernel_tex_fetch_ssef(__bvh_nodes, node_addr+4);
+		const ssef bmin_z = kernel_tex_fetch_ssef(__bvh_nodes, node_addr+5);
+		const ssef bmax_z = kernel_tex_fetch_ssef(__bvh_nodes, node_addr+6);
+		const float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr+7);
+
+		for(int i = 0; i < 4; i++) {
+			int mask = bvh_packet_box_intersect(packet,
+			                                    bmin_x[i], bmax_x[i],
+			                                    bmin_y[i], bmax_y[i],
+			                                    bmin_z[i], bmax_z[i],
+			                                    &dist) & node_mask;
+			if(mask != 0) {
+				child_addr[num_children] = __float_as_int(cnodes[i]);
+				child_mask[num_children] = mask;
+				child_dist[num_children] = bvh_packet_box_dist(dist, mask);
+				num_children++;
+			}
+		}
+	}
+	else
+#endif  /* __QBVH__ */
+	{
+		const float4 cnodes = kernel_tex_fetch(__bvh_nodes, node_addr+0);
+		const float4 node0 = kernel_tex_fetch(__bvh_nodes, node_addr+1);
+		const float4 node1 = kernel_tex_fetch(__bvh_nodes, node_addr+2);
+		const float4 node2 = kernel_tex_fetch(__bvh_nodes, node_addr+3);
+
+		int mask = bvh_packet_box_intersect(packet,
+		                                    node0.x, node0.z,
+		                                    node1.x, node1.z,
+		                                    node2.x, node2.z,
+		                                    &dist) & node_mask;
+#ifdef __VISIBILITY_FLAG__
+		if((__float_as_uint(cnodes.x) & visibility) == 0) {
+			mask = 0;
+		}
+#endif
+		if(mask != 0) {
+			child_addr[num_children] = __float_as_int(cnodes.z);
+			child_mask[num_children] = mask;
+			child_dist[num_children] = bvh_packet_box_dist(dist, mask);
+			num_children++;
+		}
+
+		mask = bvh_packet_box_intersect(packet,
+		                                node0.y, node0.w,
+		                                node1.y, node1.w,
+		                                node2.y, node2.w,
+		                                &dist) & node_mask;
+#ifdef __VISIBILITY_FLAG__
+		if((__float_as_uint(cnodes.y) & visibility) == 0) {
+			mask = 0;
+		}
+#endif
+		if(mask != 0) {
+			child_addr[num_children] = __float_as_int(cnodes.w);
+			child_mask[num_children] = mask;
+			child_dist[num_children] = bvh_packet_box_dist(dist, mask);
+			num_children++;
+		}
+	}
+
+	/* Insertion sort, at most four children. */
+	for(int i = 1; i < num_children; i++) {
+		const int addr = child_addr[i];
+		const int mask = child_mask[i];
+		const float d = child_dist[i];
+		int j = i - 1;
+		for(; j >= 0 && child_dist[j] > d; j--) {
+			child_addr[j+1] = child_addr[j];
+			child_mask[j+1] = child_mask[j];
+			child_dist[j+1] = child_dist[j];
+		}
+		child_addr[j+1] = addr;
+		child_mask[j+1] = mask;
+		child_dist[j+1] = d;
+	}
+
+	return num_children;
+}
+
+/* Traverse the packet, finding the closest hit of each ray. With any_hit a
+ * ray drops out of the traversal at its first hit instead, which is all
+ * shadow rays need. */
+ccl_device_inline int bvh_packet_traverse(KernelGlobals *kg,
+                                          const Ray *rays,
+                                          int ray_mask,
+                                          const uint visibility,
+                                          Intersection *isect,
+                                          const bool any_hit)
+{
+	BVHPacketStackItem traversal_stack[BVH_QSTACK_SIZE];
+	traversal_stack[0].addr = ENTRYPOINT_SENTINEL;
+	traversal_stack[0].mask = 0;
+
+	BVHPacket packet;
+
+	for(int i = 0; i < BVH_PACKET_SIZE; i++) {
+		isect[i].u = 0.0f;
+		isect[i].v = 0.0f;
+		isect[i].prim = PRIM_NONE;
+		isect[i].object = OBJECT_NONE;
+#ifdef __KERNEL_DEBUG__
+		isect[i].num_traversal_steps = 0;
+		isect[i].num_traversed_instances = 0;
+#endif
+
+		if((ray_mask & (1 << i)) && isfinite(rays[i].P.x)) {
+			isect[i].t = rays[i].t;
+			packet.P[i] = rays[i].P;
+			packet.dir[i] = bvh_clamp_direction(rays[i].D);
+		}
+		else {
+			/* Inactive lanes still need sane values for the SIMD tests. */
+			ray_mask &= ~(1 << i);
+			isect[i].t = 0.0f;
+			packet.P[i] = make_float3(0.0f, 0.0f, 0.0f);
+			packet.dir[i] = make_float3(1.0f, 1.0f, 1.0f);
+		}
+		packet.idir[i] = bvh_inverse_direction(packet.dir[i]);
+	}
+
+	bvh_packet_update(&packet, isect, BVH_PACKET_MASK);
+
+	/* Traversal variables in registers. */
+	int stack_ptr = 0;
+	int node_addr = kernel_data.bvh.root;
+	int node_mask = ray_mask;
+	int object = OBJECT_NONE;
+	int instance_mask = 0;
+	/* Rays that found their hit, only used with any_hit. */
+	int done_mask = 0;
+
+	if(ray_mask == 0) {
+		return 0;
+	}
+
+	/* Traversal loop. */
+	do {
+		do {
+			/* Traverse internal nodes. */
+			while(node_addr >= 0 && node_addr != ENTRYPOINT_SENTINEL) {
+				int child_addr[4], child_mask[4];
+				int num_children = bvh_packet_node_intersect(kg,
+				                                             &packet,
+				                                             node_addr,
+				                                             node_mask & ~done_mask,
+				                                             visibility,
+				                                             child_addr,
+				                                             child_mask);
+
+				if(num_children == 0) {
+					/* Pop. */
+					node_addr = traversal_stack[stack_ptr].addr;
+					node_mask = traversal_stack[stack_ptr].mask;
+					--stack_ptr;
+					continue;
+				}
+
+				/* Push far children, continue with the closest one. */
+				for(int i = num_children - 1; i > 0; i--) {
+					++stack_ptr;
+					kernel_assert(stack_ptr < BVH_QSTACK_SIZE);
+					traversal_stack[stack_ptr].addr = child_addr[i];
+					traversal_stack[stack_ptr].mask = child_mask[i];
+				}
+
+				node_addr = child_addr[0];
+				node_mask = child_mask[0];
+			}
+
+			/* If node is leaf, fetch triangle list. */
+			if(node_addr < 0) {
+				float4 leaf = kernel_tex_fetch(__bvh_leaf_nodes, (-node_addr-1));
+				int prim_addr = __float_as_int(leaf.x);
+				const int leaf_mask = node_mask & ~done_mask;
+
+				/* Pop. */
+				node_addr = traversal_stack[stack_ptr].addr;
+				node_mask = traversal_stack[stack_ptr].mask;
+				--stack_ptr;
+
+#ifdef __VISIBILITY_FLAG__
+				if((__float_as_uint(leaf.z) & visibility) == 0) {
+					continue;
+				}
+#endif
+
+#ifdef __INSTANCING__
+				if(prim_addr >= 0) {
+#endif
+					const int prim_addr2 = __float_as_int(leaf.y);
+
+					kernel_assert((__float_as_int(leaf.w) & PRIMITIVE_ALL) == PRIMITIVE_TRIANGLE);
+
+					/* Primitive intersection, one ray at a time. */
+					for(int i = 0; i < BVH_PACKET_SIZE; i++) {
+						if(!(leaf_mask & (1 << i))) {
+							continue;
+						}
+
+						bool hit = false;
+						for(int addr = prim_addr; addr < prim_addr2; addr++) {
+#ifdef __KERNEL_DEBUG__
+							isect[i].num_traversal_steps++;
+#endif
+							hit |= triangle_intersect(kg,
+							                          &packet.isect_precalc[i],
+							                          &isect[i],
+							                          packet.P[i],
+							                          visibility,
+							                          object,
+							                          addr);
+							if(hit && any_hit) {
+								break;
+							}
+						}
+
+						if(hit) {
+							packet.tfar[i] = isect[i].t;
+							if(any_hit) {
+								done_mask |= (1 << i);
+							}
+						}
+					}
+
+					if(any_hit && done_mask == ray_mask) {
+						/* All rays blocked. */
+						return ray_mask;
+					}
+#ifdef __INSTANCING__
+				}
+				else {
+					/* Instance push, for the rays that reached the leaf. The
+					 * rest of the stack only holds nodes outside the instance,
+					 * so push the popped node back first. */
+					++stack_ptr;
+					kernel_assert(stack_ptr < BVH_QSTACK_SIZE);
+					traversal_stack[stack_ptr].addr = node_addr;
+					traversal_stack[stack_ptr].mask = node_mask;
+
+					object = kernel_tex_fetch(__prim_object, -prim_addr-1);
+					instance_mask = leaf_mask;
+
+					for(int i = 0; i < BVH_PACKET_SIZE; i++) {
+						if(instance_mask & (1 << i)) {
+							bvh_instance_push(kg, object, &rays[i], &packet.P[i], &packet.dir[i], &packet.idir[i], &isect[i].t);
+#ifdef __KERNEL_DEBUG__
+							isect[i].num_traversed_instances++;
+#endif
+						}
+					}
+
+					bvh_packet_update(&packet, isect, instance_mask);
+
+					++stack_ptr;
+					kernel_assert(stack_ptr < BVH_QSTACK_SIZE);
+					traversal_stack[stack_ptr].addr = ENTRYPOINT_SENTINEL;
+					traversal_stack[stack_ptr].mask = 0;
+
+					node_addr = kernel_tex_fetch(__object_node, object);
+					node_mask = instance_mask;
+				}
+#endif  /* __INSTANCING__ */
+			}
+		} while(node_addr != ENTRYPOINT_SENTINEL);
+
+#ifdef __INSTANCING__
+		if(stack_ptr >= 0) {
+			kernel_assert(object != OBJECT_NONE);
+
+			/* Instance pop. */
+			for(int i = 0; i < BVH_PACKET_SIZE; i++) {
+				if(instance_mask & (1 << i)) {
+					bvh_instance_pop(kg, object, &rays[i], &packet.P[i], &packet.dir[i], &packet.idir[i], &isect[i].t);
+				}
+			}
+
+			bvh_packet_update(&packet, isect, instance_mask);
+
+			object = OBJECT_NONE;
+			instance_mask = 0;
+			node_addr = traversal_stack[stack_ptr].addr;
+			node_mask = traversal_stack[stack_ptr].mask;
+			--stack_ptr;
+		}
+#endif  /* __INSTANCING__ */
+	} while(node_addr != ENTRYPOINT_SENTINEL);
+
+	int hit_mask = 0;
+	for(int i = 0; i < BVH_PACKET_SIZE; i++) {
+		if((ray_mask & (1 << i)) && isect[i].prim != PRIM_NONE) {
+			hit_mask |= (1 << i);
+		}
+	}
+
+	return hit_mask;
+}
+
+/* Find the closest intersection for each ray in ray_mask. Rays and
+ * intersections are arrays of BVH_PACKET_SIZE, rays outside of the mask are
+ * ignored. Returns a bit mask of the rays that hit something. */
+ccl_device int scene_intersect_packet(KernelGlobals *kg,
+                                      const Ray *rays,
+                                      int ray_mask,
+                                      const uint visibility,
+                                      Intersection *isect)
+{
+	return bvh_packet_traverse(kg, rays, ray_mask, visibility, isect, false);
+}
+
+/* Opaque shadow test for each ray in ray_mask, returns a bit mask of the rays
+ * that are blocked. Intersections are any hit, not the closest one. */
+ccl_device int scene_intersect_packet_shadow(KernelGlobals *kg,
+                                             const Ray *rays,
+                                             int ray_mask,
+                                             Intersection *isect)
+{
+	return bvh_packet_traverse(kg, rays, ray_mask, PATH_RAY_SHADOW_OPAQUE, isect, true);
+}
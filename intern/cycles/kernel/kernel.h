@@ -43,7 +43,8 @@ void kernel_tex_copy(KernelGlobals *kg,
                      size_t height,
                      size_t depth,
                      InterpolationType interpolation=INTERPOLATION_LINEAR,
-                     ExtensionType extension = EXTENSION_REPEAT);
+                     ExtensionType extension = EXTENSION_REPEAT,
+                     device_ptr grid_info = 0);
 
 #define KERNEL_ARCH cpu
 #include "kernels/cpu/kernel_cpu.h"
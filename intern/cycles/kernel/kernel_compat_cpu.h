@@ -133,6 +133,23 @@ template<typename T> struct texture_image  {
 		return make_float4(f, f, f, 1.0f);
 	}
 
+	/* Voxel lookup for 3D textures. Sparse textures store their voxels in
+	 * tiles, with an offsets grid to find the tile, see util_sparse_grid.h. */
+	ccl_always_inline float4 read_3d(int x, int y, int z)
+	{
+		if(grid_offsets == NULL) {
+			return read(data[x + y*width + z*width*height]);
+		}
+
+		const int tile = grid_offsets[(x >> TEX_SPARSE_TILE_SHIFT) +
+		                              tiled_width*((y >> TEX_SPARSE_TILE_SHIFT) +
+		                                           tiled_height*(z >> TEX_SPARSE_TILE_SHIFT))];
+		const int voxel = (x & TEX_SPARSE_TILE_MASK) +
+		                  TEX_SPARSE_TILE_SIZE*((y & TEX_SPARSE_TILE_MASK) +
+		                                        TEX_SPARSE_TILE_SIZE*(z & TEX_SPARSE_TILE_MASK));
+		return read(data[tile + voxel]);
+	}
+
 	ccl_always_inline int wrap_periodic(int x, int width)
 	{
 		x %= width;
@@ -329,7 +346,7 @@ template<typename T> struct texture_image  {
 					return make_float4(0.0f, 0.0f, 0.0f, 0.0f);
 			}
 
-			return read(data[ix + iy*width + iz*width*height]);
+			return read_3d(ix, iy, iz);
 		}
 		else if(interpolation == INTERPOLATION_LINEAR) {
 			float tx = frac(x*(float)width - 0.5f, &ix);
@@ -369,15 +386,15 @@ template<typename T> struct texture_image  {
 
 			float4 r;
 
-			r  = (1.0f - tz)*(1.0f - ty)*(1.0f - tx)*read(data[ix + iy*width + iz*width*height]);
-			r += (1.0f - tz)*(1.0f - ty)*tx*read(data[nix + iy*width + iz*width*height]);
-			r += (1.0f - tz)*ty*(1.0f - tx)*read(data[ix + niy*width + iz*width*height]);
-			r += (1.0f - tz)*ty*tx*read(data[nix + niy*width + iz*width*height]);
+			r  = (1.0f - tz)*(1.0f - ty)*(1.0f - tx)*read_3d(ix, iy, iz);
+			r += (1.0f - tz)*(1.0f - ty)*tx*read_3d(nix, iy, iz);
+			r += (1.0f - tz)*ty*(1.0f - tx)*read_3d(ix, niy, iz);
+			r += (1.0f - tz)*ty*tx*read_3d(nix, niy, iz);
 
-			r += tz*(1.0f - ty)*(1.0f - tx)*read(data[ix + iy*width + niz*width*height]);
-			r += tz*(1.0f - ty)*tx*read(data[nix + iy*width + niz*width*height]);
-			r += tz*ty*(1.0f - tx)*read(data[ix + niy*width + niz*width*height]);
-			r += tz*ty*tx*read(data[nix + niy*width + niz*width*height]);
+			r += tz*(1.0f - ty)*(1.0f - tx)*read_3d(ix, iy, niz);
+			r += tz*(1.0f - ty)*tx*read_3d(nix, iy, niz);
+			r += tz*ty*(1.0f - tx)*read_3d(ix, niy, niz);
+			r += tz*ty*tx*read_3d(nix, niy, niz);
 
 			return r;
 		}
@@ -436,20 +453,14 @@ template<typename T> struct texture_image  {
 			}
 
 			const int xc[4] = {pix, ix, nix, nnix};
-			const int yc[4] = {width * piy,
-			                   width * iy,
-			                   width * niy,
-			                   width * nniy};
-			const int zc[4] = {width * height * piz,
-			                   width * height * iz,
-			                   width * height * niz,
-			                   width * height * nniz};
+			const int yc[4] = {piy, iy, niy, nniy};
+			const int zc[4] = {piz, iz, niz, nniz};
 			float u[4], v[4], w[4];
 
 			/* Some helper macro to keep code reasonable size,
 			 * let compiler to inline all the matrix multiplications.
 			 */
-#define DATA(x, y, z) (read(data[xc[x] + yc[y] + zc[z]]))
+#define DATA(x, y, z) (read_3d(xc[x], yc[y], zc[z]))
 #define COL_TERM(col, row) \
 			(v[col] * (u[0] * DATA(0, col, row) + \
 			           u[1] * DATA(1, col, row) + \
@@ -479,12 +490,16 @@ template<typename T> struct texture_image  {
 		width = width_;
 		height = height_;
 		depth = depth_;
+		tiled_width = (width + TEX_SPARSE_TILE_MASK) >> TEX_SPARSE_TILE_SHIFT;
+		tiled_height = (height + TEX_SPARSE_TILE_MASK) >> TEX_SPARSE_TILE_SHIFT;
 	}
 
 	T *data;
+	int *grid_offsets;
 	int interpolation;
 	ExtensionType extension;
 	int width, height, depth;
+	int tiled_width, tiled_height;
 #undef SET_CUBIC_SPLINE_WEIGHTS
 };
 
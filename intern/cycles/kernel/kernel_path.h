@@ -400,7 +400,8 @@ ccl_device_noinline void kernel_path_ao(KernelGlobals *kg,
                                         PathRadiance *L,
                                         PathState *state,
                                         RNG *rng,
-                                        float3 throughput)
+                                        float3 throughput,
+                                        PathShadowQueue *shadow_queue)
 {
 	/* todo: solve correlation */
 	float bsdf_u, bsdf_v;
@@ -429,8 +430,19 @@ ccl_device_noinline void kernel_path_ao(KernelGlobals *kg,
 		light_ray.dP = ccl_fetch(sd, dP);
 		light_ray.dD = differential3_zero();
 
-		if(!shadow_blocked(kg, emission_sd, state, &light_ray, &ao_shadow))
+		PathShadowRecord *record = shadow_queue_push(kg, shadow_queue, state, &light_ray);
+
+		if(record) {
+			/* shadow ray traced later by the caller */
+			record->throughput = throughput;
+			record->ao_alpha = ao_alpha;
+			record->ao_bsdf = ao_bsdf;
+			record->is_lamp = false;
+			record->is_ao = true;
+		}
+		else if(!shadow_blocked(kg, emission_sd, state, &light_ray, &ao_shadow)) {
 			path_radiance_accum_ao(L, throughput, ao_alpha, ao_bsdf, ao_shadow, state->bounce);
+		}
 	}
 }
 
@@ -512,7 +524,7 @@ bool kernel_path_subsurface_scatter(
 			hit_L->direct_throughput = L->direct_throughput;
 			path_radiance_copy_indirect(hit_L, L);
 
-			kernel_path_surface_connect_light(kg, rng, sd, emission_sd, *hit_tp, state, hit_L);
+			kernel_path_surface_connect_light(kg, rng, sd, emission_sd, *hit_tp, state, hit_L, NULL);
 
 			if(kernel_path_surface_bounce(kg,
 			                              rng,
@@ -601,11 +613,18 @@ ccl_device void kernel_path_subsurface_setup_indirect(
 
 #endif  /* __SUBSURFACE__ */
 
-ccl_device_inline float4 kernel_path_integrate(KernelGlobals *kg,
-                                               RNG *rng,
-                                               int sample,
-                                               Ray ray,
-                                               ccl_global float *buffer)
+/* Integrate a path into L, returning its transparency. When camera_isect is
+ * given, the camera ray was already intersected by the caller. When
+ * shadow_queue is given, opaque shadow and AO rays of the first bounce may be
+ * added to it for the caller to trace, instead of being traced here. */
+ccl_device_inline float kernel_path_integrate_radiance(KernelGlobals *kg,
+                                                       RNG *rng,
+                                                       int sample,
+                                                       Ray ray,
+                                                       const Intersection *camera_isect,
+                                                       PathShadowQueue *shadow_queue,
+                                                       ccl_global float *buffer,
+                                                       PathRadiance *L_out)
 {
 	/* initialize */
 	PathRadiance L;
@@ -654,11 +673,24 @@ ccl_device_inline float4 kernel_path_integrate(KernelGlobals *kg,
 			extmax = kernel_data.curve.maximum_width;
 			lcg_state = lcg_state_init(rng, &state, 0x51633e2d);
 		}
+#endif
+
+		bool hit;
 
-		bool hit = scene_intersect(kg, &ray, visibility, &isect, &lcg_state, difl, extmax);
+		if(camera_isect != NULL) {
+			/* camera ray was already intersected by the caller */
+			kernel_assert(visibility == PATH_RAY_CAMERA);
+			isect = *camera_isect;
+			hit = (isect.prim != PRIM_NONE);
+			camera_isect = NULL;
+		}
+		else {
+#ifdef __HAIR__
+			hit = scene_intersect(kg, &ray, visibility, &isect, &lcg_state, difl, extmax);
 #else
-		bool hit = scene_intersect(kg, &ray, visibility, &isect, NULL, 0.0f, 0.0f);
+			hit = scene_intersect(kg, &ray, visibility, &isect, NULL, 0.0f, 0.0f);
 #endif
+		}
 
 #ifdef __KERNEL_DEBUG__
 		if(state.flag & PATH_RAY_CAMERA) {
@@ -861,7 +893,8 @@ ccl_device_inline float4 kernel_path_integrate(KernelGlobals *kg,
 #ifdef __AO__
 		/* ambient occlusion */
 		if(kernel_data.integrator.use_ambient_occlusion || (sd.flag & SD_AO)) {
-			kernel_path_ao(kg, &sd, &emission_sd, &L, &state, rng, throughput);
+			kernel_path_ao(kg, &sd, &emission_sd, &L, &state, rng, throughput,
+			               (state.bounce == 0)? shadow_queue: NULL);
 		}
 #endif
 
@@ -885,7 +918,8 @@ ccl_device_inline float4 kernel_path_integrate(KernelGlobals *kg,
 #endif  /* __SUBSURFACE__ */
 
 		/* direct lighting */
-		kernel_path_surface_connect_light(kg, rng, &sd, &emission_sd, throughput, &state, &L);
+		kernel_path_surface_connect_light(kg, rng, &sd, &emission_sd, throughput, &state, &L,
+		                                  (state.bounce == 0)? shadow_queue: NULL);
 
 		/* compute direct lighting and next bounce */
 		if(!kernel_path_surface_bounce(kg, rng, &sd, &throughput, &state, &L, &ray))
@@ -912,17 +946,41 @@ ccl_device_inline float4 kernel_path_integrate(KernelGlobals *kg,
 	}
 #endif  /* __SUBSURFACE__ */
 
-	float3 L_sum = path_radiance_clamp_and_sum(kg, &L);
-
-	kernel_write_light_passes(kg, buffer, &L, sample);
-
 #ifdef __KERNEL_DEBUG__
 	kernel_write_debug_passes(kg, buffer, &state, &debug_data, sample);
 #endif
 
+	*L_out = L;
+
+	return L_transparent;
+}
+
+/* Sum radiance of an integrated path and write its light passes. */
+ccl_device_inline float4 kernel_path_radiance_sum(KernelGlobals *kg,
+                                                  PathRadiance *L,
+                                                  float L_transparent,
+                                                  int sample,
+                                                  ccl_global float *buffer)
+{
+	float3 L_sum = path_radiance_clamp_and_sum(kg, L);
+
+	kernel_write_light_passes(kg, buffer, L, sample);
+
 	return make_float4(L_sum.x, L_sum.y, L_sum.z, 1.0f - L_transparent);
 }
 
+ccl_device_inline float4 kernel_path_integrate(KernelGlobals *kg,
+                                               RNG *rng,
+                                               int sample,
+                                               Ray ray,
+                                               ccl_global float *buffer)
+{
+	PathRadiance L;
+	float L_transparent = kernel_path_integrate_radiance(kg, rng, sample, ray, NULL, NULL, buffer, &L);
+
+	return kernel_path_radiance_sum(kg, &L, L_transparent, sample, buffer);
+}
+
 ccl_device void kernel_path_trace(KernelGlobals *kg,
 	ccl_global float *buffer, ccl_global uint *rng_state,
 	int sample, int x, int y, int offset, int stride)
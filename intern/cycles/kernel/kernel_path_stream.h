@@ -0,0 +1,235 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Ray Stream Path Tracing
+ *
+ * Instead of tracing one pixel from start to end, camera rays for a span of
+ * pixels are generated first and intersected with the scene in packets, which
+ * is faster since neighbouring camera rays visit mostly the same BVH nodes.
+ * Pixels are then sorted by the shader that was hit, so that consecutive
+ * shader evaluations run the same SVM program, and the rest of each path is
+ * integrated as usual, except for the opaque shadow and AO rays from the
+ * first hit. These are queued per pixel and traced in packets after all
+ * pixels of the span are integrated, then their light is added.
+ *
+ * The result is identical to kernel_path_trace(), random numbers are still
+ * per pixel and do not depend on the order of evaluation. */
+
+CCL_NAMESPACE_BEGIN
+
+#define PATH_STREAM_SIZE 64
+
+#if defined(__KERNEL_SSE2__) && defined(__KERNEL_CPU__)
+/* Sort key to group pixels hitting the same shader. */
+ccl_device_inline int kernel_path_stream_shader(KernelGlobals *kg,
+                                                const Ray *ray,
+                                                const Intersection *isect)
+{
+	if(ray->t == 0.0f) {
+		return -2;
+	}
+	else if(isect->prim == PRIM_NONE) {
+		return -1;
+	}
+
+	return kernel_tex_fetch(__tri_shader, isect->prim) & SHADER_MASK;
+}
+
+/* Add the light of an unoccluded queued shadow ray. */
+ccl_device_inline void kernel_path_stream_shadow_accum(PathRadiance *L,
+                                                       PathShadowRecord *record)
+{
+	const float3 shadow = make_float3(1.0f, 1.0f, 1.0f);
+
+	if(record->is_ao) {
+		path_radiance_accum_ao(L, record->throughput, record->ao_alpha,
+		                       record->ao_bsdf, shadow, record->bounce);
+	}
+	else {
+		path_radiance_accum_light(L, record->throughput, &record->L_light,
+		                          shadow, 1.0f, record->bounce, record->is_lamp != 0);
+	}
+}
+
+/* Trace the queued shadow rays of all pixels in packets. Consecutive pixels
+ * queue their light and AO rays in the same order, so packets mostly hold
+ * rays of neighbouring pixels going the same way. */
+ccl_device void kernel_path_stream_shadow(KernelGlobals *kg,
+                                          PathRadiance *L,
+                                          PathShadowQueue *shadow_queue,
+                                          int num_pixels)
+{
+	Ray ray[BVH_PACKET_SIZE];
+	Intersection isect[BVH_PACKET_SIZE];
+	PathShadowRecord *record[BVH_PACKET_SIZE];
+	int pixel[BVH_PACKET_SIZE];
+
+	for(int r = 0; r < PATH_SHADOW_QUEUE_SIZE; r++) {
+		int num_rays = 0;
+
+		for(int i = 0; i < num_pixels; i++) {
+			if(r < shadow_queue[i].num_records) {
+				record[num_rays] = &shadow_queue[i].records[r];
+				ray[num_rays] = record[num_rays]->ray;
+				pixel[num_rays] = i;
+				num_rays++;
+			}
+
+			if(num_rays == BVH_PACKET_SIZE || (num_rays > 0 && i == num_pixels - 1)) {
+				int ray_mask = 0;
+
+				for(int j = 0; j < num_rays; j++) {
+					if(ray[j].t != 0.0f) {
+						ray_mask |= (1 << j);
+					}
+				}
+
+				int blocked_mask = scene_intersect_packet_shadow(kg, ray, ray_mask, isect);
+
+				for(int j = 0; j < num_rays; j++) {
+					if(!(blocked_mask & (1 << j))) {
+						kernel_path_stream_shadow_accum(&L[pixel[j]], record[j]);
+					}
+				}
+
+				num_rays = 0;
+			}
+		}
+	}
+}
+
+ccl_device void kernel_path_trace_stream_span(KernelGlobals *kg,
+                                              ccl_global float *buffer,
+                                              ccl_global uint *rng_state,
+                                              int sample,
+                                              int x, int y, int num_pixels,
+                                              int offset, int stride)
+{
+	int pass_stride = kernel_data.film.pass_stride;
+
+	RNG rng[PATH_STREAM_SIZE];
+	Ray ray[PATH_STREAM_SIZE];
+	Intersection isect[PATH_STREAM_SIZE];
+	int shader[PATH_STREAM_SIZE];
+	int order[PATH_STREAM_SIZE];
+	PathRadiance L[PATH_STREAM_SIZE];
+	float L_transparent[PATH_STREAM_SIZE];
+	PathShadowQueue shadow_queue[PATH_STREAM_SIZE];
+
+	/* generate camera rays */
+	for(int i = 0; i < num_pixels; i++) {
+		int index = offset + x + i + y*stride;
+		kernel_path_trace_setup(kg, rng_state + index, sample, x + i, y, &rng[i], &ray[i]);
+	}
+
+	/* intersect camera rays in packets */
+	for(int i = 0; i < num_pixels; i += BVH_PACKET_SIZE) {
+		int ray_mask = 0;
+
+		for(int j = 0; j < BVH_PACKET_SIZE && i + j < num_pixels; j++) {
+			if(ray[i + j].t != 0.0f) {
+				ray_mask |= (1 << j);
+			}
+		}
+
+		scene_intersect_packet(kg, &ray[i], ray_mask, PATH_RAY_CAMERA, &isect[i]);
+	}
+
+	/* sort pixels by shader, insertion sort keeps pixel order within a shader */
+	for(int i = 0; i < num_pixels; i++) {
+		int key = kernel_path_stream_shader(kg, &ray[i], &isect[i]);
+		int j = i - 1;
+
+		for(; j >= 0 && shader[j] > key; j--) {
+			shader[j + 1] = shader[j];
+			order[j + 1] = order[j];
+		}
+
+		shader[j + 1] = key;
+		order[j + 1] = i;
+	}
+
+	/* integrate rest of the paths, except for queued shadow rays */
+	for(int k = 0; k < num_pixels; k++) {
+		int i = order[k];
+		int index = offset + x + i + y*stride;
+		ccl_global float *pixel_buffer = buffer + index*pass_stride;
+
+		shadow_queue[i].num_records = 0;
+
+		if(ray[i].t != 0.0f) {
+			L_transparent[i] = kernel_path_integrate_radiance(kg,
+			                                                  &rng[i],
+			                                                  sample,
+			                                                  ray[i],
+			                                                  &isect[i],
+			                                                  &shadow_queue[i],
+			                                                  pixel_buffer,
+			                                                  &L[i]);
+		}
+
+		path_rng_end(kg, rng_state + index, rng[i]);
+	}
+
+	/* trace queued shadow rays in packets */
+	kernel_path_stream_shadow(kg, L, shadow_queue, num_pixels);
+
+	/* write pixels */
+	for(int i = 0; i < num_pixels; i++) {
+		int index = offset + x + i + y*stride;
+		ccl_global float *pixel_buffer = buffer + index*pass_stride;
+		float4 L_sum;
+
+		if(ray[i].t != 0.0f)
+			L_sum = kernel_path_radiance_sum(kg, &L[i], L_transparent[i], sample, pixel_buffer);
+		else
+			L_sum = make_float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+		kernel_write_pass_float4(pixel_buffer, sample, L_sum);
+	}
+}
+#endif  /* __KERNEL_SSE2__ && __KERNEL_CPU__ */
+
+/* Path trace a row of w pixels starting at x. */
+ccl_device void kernel_path_trace_stream(KernelGlobals *kg,
+                                         ccl_global float *buffer,
+                                         ccl_global uint *rng_state,
+                                         int sample,
+                                         int x, int y, int w,
+                                         int offset, int stride)
+{
+#if defined(__KERNEL_SSE2__) && defined(__KERNEL_CPU__)
+	if(scene_intersect_packet_supported(kg)) {
+		for(int i = 0; i < w; i += PATH_STREAM_SIZE) {
+			kernel_path_trace_stream_span(kg,
+			                              buffer,
+			                              rng_state,
+			                              sample,
+			                              x + i, y, min(w - i, PATH_STREAM_SIZE),
+			                              offset,
+			                              stride);
+		}
+		return;
+	}
+#endif
+
+	/* no packet traversal for hair and motion blur, trace one by one */
+	for(int i = 0; i < w; i++) {
+		kernel_path_trace(kg, buffer, rng_state, sample, x + i, y, offset, stride);
+	}
+}
+
+CCL_NAMESPACE_END
@@ -292,5 +292,30 @@ ccl_device_noinline bool shadow_blocked(KernelGlobals *kg,
 
 #endif
 
+/* Set a shadow ray aside to be traced later in a packet, instead of calling
+ * shadow_blocked() now. Only possible for rays without transparent surfaces
+ * or volumes to shade along the way, where any hit blocks all light. Returns
+ * NULL when the ray must be traced right away, otherwise the record for the
+ * caller to store the light contribution in. */
+ccl_device_inline PathShadowRecord *shadow_queue_push(KernelGlobals *kg,
+                                                      PathShadowQueue *queue,
+                                                      ccl_addr_space PathState *state,
+                                                      ccl_addr_space Ray *ray)
+{
+	if(queue == NULL || queue->num_records == PATH_SHADOW_QUEUE_SIZE)
+		return NULL;
+	if(kernel_data.integrator.transparent_shadows)
+		return NULL;
+#ifdef __VOLUME__
+	if(state->volume_stack[0].shader != SHADER_NONE)
+		return NULL;
+#endif
+
+	PathShadowRecord *record = &queue->records[queue->num_records++];
+	record->ray = *ray;
+	record->bounce = state->bounce;
+	return record;
+}
+
 CCL_NAMESPACE_END
 
@@ -544,6 +544,31 @@ typedef ccl_addr_space struct Intersection {
 #endif
 } Intersection;
 
+/* Shadow Queue
+ *
+ * Opaque shadow and AO rays of the first bounce, set aside by the CPU ray
+ * stream kernel and traced in packets once all pixels of a span are shaded.
+ * The light is only added to the path radiance if the ray is unoccluded. */
+
+#define PATH_SHADOW_QUEUE_SIZE 2
+
+typedef struct PathShadowRecord {
+	Ray ray;
+	float3 throughput;
+	/* light sample, or AO when is_ao is set */
+	BsdfEval L_light;
+	float3 ao_alpha;
+	float3 ao_bsdf;
+	int bounce;
+	int is_lamp;
+	int is_ao;
+} PathShadowRecord;
+
+typedef struct PathShadowQueue {
+	int num_records;
+	PathShadowRecord records[PATH_SHADOW_QUEUE_SIZE];
+} PathShadowQueue;
+
 /* Primitives */
 
 typedef enum PrimitiveType {
@@ -77,7 +77,8 @@ void kernel_tex_copy(KernelGlobals *kg,
                      size_t height,
                      size_t depth,
                      InterpolationType interpolation,
-                     ExtensionType extension)
+                     ExtensionType extension,
+                     device_ptr grid_info)
 {
 	if(0) {
 	}
@@ -101,6 +102,7 @@ void kernel_tex_copy(KernelGlobals *kg,
 
 		if(tex) {
 			tex->data = (float4*)mem;
+			tex->grid_offsets = (int*)grid_info;
 			tex->dimensions_set(width, height, depth);
 			tex->interpolation = interpolation;
 			tex->extension = extension;
@@ -117,6 +119,7 @@ void kernel_tex_copy(KernelGlobals *kg,
 
 		if(tex) {
 			tex->data = (float*)mem;
+			tex->grid_offsets = (int*)grid_info;
 			tex->dimensions_set(width, height, depth);
 			tex->interpolation = interpolation;
 			tex->extension = extension;
@@ -133,6 +136,7 @@ void kernel_tex_copy(KernelGlobals *kg,
 
 		if(tex) {
 			tex->data = (uchar4*)mem;
+			tex->grid_offsets = (int*)grid_info;
 			tex->dimensions_set(width, height, depth);
 			tex->interpolation = interpolation;
 			tex->extension = extension;
@@ -149,6 +153,7 @@ void kernel_tex_copy(KernelGlobals *kg,
 
 		if(tex) {
 			tex->data = (uchar*)mem;
+			tex->grid_offsets = (int*)grid_info;
 			tex->dimensions_set(width, height, depth);
 			tex->interpolation = interpolation;
 			tex->extension = extension;
@@ -165,6 +170,7 @@ void kernel_tex_copy(KernelGlobals *kg,
 
 		if(tex) {
 			tex->data = (half4*)mem;
+			tex->grid_offsets = (int*)grid_info;
 			tex->dimensions_set(width, height, depth);
 			tex->interpolation = interpolation;
 			tex->extension = extension;
@@ -181,6 +187,7 @@ void kernel_tex_copy(KernelGlobals *kg,
 
 		if(tex) {
 			tex->data = (half*)mem;
+			tex->grid_offsets = (int*)grid_info;
 			tex->dimensions_set(width, height, depth);
 			tex->interpolation = interpolation;
 			tex->extension = extension;
@@ -24,6 +24,14 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
                                            int offset,
                                            int stride);
 
+void KERNEL_FUNCTION_FULL_NAME(path_trace_stream)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  unsigned int *rng_state,
+                                                  int sample,
+                                                  int x, int y, int w,
+                                                  int offset,
+                                                  int stride);
+
 void KERNEL_FUNCTION_FULL_NAME(convert_to_byte)(KernelGlobals *kg,
                                                 uchar4 *rgba,
                                                 float *buffer,
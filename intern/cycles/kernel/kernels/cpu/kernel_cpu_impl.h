@@ -28,6 +28,7 @@
 #include "kernel_film.h"
 #include "kernel_path.h"
 #include "kernel_path_branched.h"
+#include "kernel_path_stream.h"
 #include "kernel_bake.h"
 
 CCL_NAMESPACE_BEGIN
@@ -59,6 +60,33 @@ void KERNEL_FUNCTION_FULL_NAME(path_trace)(KernelGlobals *kg,
 	}
 }
 
+void KERNEL_FUNCTION_FULL_NAME(path_trace_stream)(KernelGlobals *kg,
+                                                  float *buffer,
+                                                  unsigned int *rng_state,
+                                                  int sample,
+                                                  int x, int y, int w,
+                                                  int offset,
+                                                  int stride)
+{
+#ifdef __BRANCHED_PATH__
+	if(kernel_data.integrator.branched) {
+		for(int i = 0; i < w; i++) {
+			kernel_branched_path_trace(kg,
+			                           buffer,
+			                           rng_state,
+			                           sample,
+			                           x + i, y,
+			                           offset,
+			                           stride);
+		}
+	}
+	else
+#endif
+	{
+		kernel_path_trace_stream(kg, buffer, rng_state, sample, x, y, w, offset, stride);
+	}
+}
+
 /* Film */
 
 void KERNEL_FUNCTION_FULL_NAME(convert_to_byte)(KernelGlobals *kg,
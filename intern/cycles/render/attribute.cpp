@@ -519,6 +519,42 @@ void AttributeSet::clear()
 	attributes.clear();
 }
 
+void AttributeSet::remap_voxel_images(ImageManager *manager)
+{
+	foreach(Attribute& attr, attributes) {
+		if(attr.element != ATTR_ELEMENT_VOXEL)
+			continue;
+
+		VoxelAttribute *voxel_data = attr.data_voxel();
+
+		if(!voxel_data || voxel_data->manager == manager)
+			continue;
+
+		const ImageManager::Image *image = (voxel_data->slot != -1)?
+			voxel_data->manager->get_image(voxel_data->slot): NULL;
+
+		/* The copy holds its own user in the new manager, the user in the
+		 * old manager stays with the attribute it was copied from. */
+		if(image) {
+			bool is_float = false, is_linear = false;
+			voxel_data->slot = manager->add_image(image->filename,
+			                                      image->builtin_data,
+			                                      image->animated,
+			                                      image->frame,
+			                                      is_float,
+			                                      is_linear,
+			                                      image->interpolation,
+			                                      image->extension,
+			                                      image->use_alpha);
+		}
+		else {
+			voxel_data->slot = -1;
+		}
+
+		voxel_data->manager = manager;
+	}
+}
+
 /* AttributeRequest */
 
 AttributeRequest::AttributeRequest(ustring name_)
@@ -122,6 +122,10 @@ public:
 
 	void resize(bool reserve_only = false);
 	void clear();
+
+	/* Register the images of voxel attributes with another image manager,
+	 * for attributes copied over from a mesh in a different scene. */
+	void remap_voxel_images(ImageManager *manager);
 };
 
 /* AttributeRequest
@@ -19,8 +19,10 @@
 #include "scene.h"
 
 #include "util_foreach.h"
+#include "util_logging.h"
 #include "util_path.h"
 #include "util_progress.h"
+#include "util_sparse_grid.h"
 #include "util_texture.h"
 
 #ifdef WITH_OSL
@@ -47,6 +49,9 @@ ImageManager::ImageManager(const DeviceInfo& info)
 		device_type = info.multi_devices[0].type;
 	}
 
+	/* Sparse 3D textures are only supported by the CPU kernel. */
+	use_sparse_textures = (device_type == DEVICE_CPU);
+
 	/* Set image limits */
 #define SET_TEX_IMAGES_LIMITS(ARCH) \
 	{ \
@@ -373,6 +378,17 @@ void ImageManager::remove_image(int flat_slot)
 		need_update = true;
 }
 
+const ImageManager::Image *ImageManager::get_image(int flat_slot)
+{
+	ImageDataType type;
+	int slot = flattened_slot_to_type_index(flat_slot, &type);
+
+	if(slot < 0 || (size_t)slot >= images[type].size())
+		return NULL;
+
+	return images[type][slot];
+}
+
 void ImageManager::remove_image(const string& filename,
                                 void *builtin_data,
                                 InterpolationType interpolation,
@@ -770,6 +786,105 @@ bool ImageManager::file_load_half_image(Image *img, ImageDataType type, device_v
 	return true;
 }
 
+template<typename T>
+bool ImageManager::make_sparse_image(device_vector<T>& tex_img,
+                                     device_vector<int>& tex_offsets)
+{
+	tex_offsets.clear();
+
+	const int width = tex_img.data_width;
+	const int height = tex_img.data_height;
+	const int depth = tex_img.data_depth;
+
+	if(!use_sparse_textures || depth <= 1) {
+		return false;
+	}
+
+	const T *voxels = tex_img.get_data();
+	vector<int> offsets;
+	size_t num_voxels = sparse_grid_create_offsets(voxels,
+	                                               width, height, depth,
+	                                               &offsets);
+
+	if(!sparse_grid_use_sparse<T>(tex_img.size(), num_voxels, offsets.size())) {
+		return false;
+	}
+
+	/* Copy tiles out first, the dense voxels are freed by resize_sparse(). */
+	array<T> sparse_voxels(num_voxels);
+	sparse_grid_copy_tiles(voxels,
+	                       width, height, depth,
+	                       offsets,
+	                       sparse_voxels.data(),
+	                       num_voxels);
+
+	VLOG(1) << "Sparse 3D texture " << width << "x" << height << "x" << depth
+	        << ", " << string_human_readable_size(tex_img.memory_size())
+	        << " dense, " << string_human_readable_size(sizeof(T) * num_voxels)
+	        << " sparse.";
+
+	int *offsets_data = tex_offsets.copy(&offsets[0], offsets.size());
+	T *sparse_data = tex_img.resize_sparse(num_voxels,
+	                                       width, height, depth,
+	                                       offsets_data);
+	if(sparse_data == NULL) {
+		tex_offsets.clear();
+		return false;
+	}
+	memcpy(sparse_data, sparse_voxels.data(), sizeof(T) * num_voxels);
+
+	return true;
+}
+
+bool ImageManager::get_image_sparse_grid(DeviceScene *dscene,
+                                         int flat_slot,
+                                         int3 *resolution,
+                                         vector<int> *offsets)
+{
+	ImageDataType type;
+	int slot = flattened_slot_to_type_index(flat_slot, &type);
+
+	device_memory *tex_img;
+	device_vector<int> *tex_offsets;
+
+	if(type == IMAGE_DATA_TYPE_FLOAT4) {
+		tex_img = &dscene->tex_float4_image[slot];
+		tex_offsets = &dscene->tex_float4_image_offsets[slot];
+	}
+	else if(type == IMAGE_DATA_TYPE_FLOAT) {
+		tex_img = &dscene->tex_float_image[slot];
+		tex_offsets = &dscene->tex_float_image_offsets[slot];
+	}
+	else {
+		return false;
+	}
+
+	if(tex_img->data_pointer == 0 || tex_img->data_depth <= 1) {
+		return false;
+	}
+
+	*resolution = make_int3(tex_img->data_width,
+	                        tex_img->data_height,
+	                        tex_img->data_depth);
+
+	if(tex_img->grid_info) {
+		offsets->assign(tex_offsets->get_data(),
+		                tex_offsets->get_data() + tex_offsets->size());
+	}
+	else if(type == IMAGE_DATA_TYPE_FLOAT4) {
+		sparse_grid_create_offsets((float4*)tex_img->data_pointer,
+		                           resolution->x, resolution->y, resolution->z,
+		                           offsets);
+	}
+	else {
+		sparse_grid_create_offsets((float*)tex_img->data_pointer,
+		                           resolution->x, resolution->y, resolution->z,
+		                           offsets);
+	}
+
+	return true;
+}
+
 void ImageManager::device_load_image(Device *device, DeviceScene *dscene, ImageDataType type, int slot, Progress *progress)
 {
 	if(progress->get_cancel())
@@ -812,6 +927,8 @@ void ImageManager::device_load_image(Device *device, DeviceScene *dscene, ImageD
 			pixels[3] = TEX_IMAGE_MISSING_A;
 		}
 
+		make_sparse_image(tex_img, dscene->tex_float4_image_offsets[slot]);
+
 		if(!pack_images) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_alloc(name.c_str(),
@@ -835,6 +952,8 @@ void ImageManager::device_load_image(Device *device, DeviceScene *dscene, ImageD
 			pixels[0] = TEX_IMAGE_MISSING_R;
 		}
 
+		make_sparse_image(tex_img, dscene->tex_float_image_offsets[slot]);
+
 		if(!pack_images) {
 			thread_scoped_lock device_lock(device_mutex);
 			device->tex_alloc(name.c_str(),
@@ -965,6 +1084,7 @@ void ImageManager::device_free_image(Device *device, DeviceScene *dscene, ImageD
 			}
 
 			tex_img.clear();
+			dscene->tex_float4_image_offsets[slot].clear();
 		}
 		else if(type == IMAGE_DATA_TYPE_FLOAT) {
 			device_vector<float>& tex_img = dscene->tex_float_image[slot];
@@ -975,6 +1095,7 @@ void ImageManager::device_free_image(Device *device, DeviceScene *dscene, ImageD
 			}
 
 			tex_img.clear();
+			dscene->tex_float_image_offsets[slot].clear();
 		}
 		else if(type == IMAGE_DATA_TYPE_BYTE4) {
 			device_vector<uchar4>& tex_img = dscene->tex_byte4_image[slot];
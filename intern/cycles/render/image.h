@@ -66,6 +66,10 @@ public:
 	                      InterpolationType interpolation,
 	                      ExtensionType extension);
 	ImageDataType get_image_metadata(const string& filename, void *builtin_data, bool& is_linear);
+	bool get_image_sparse_grid(DeviceScene *dscene,
+	                           int flat_slot,
+	                           int3 *resolution,
+	                           vector<int> *offsets);
 
 	void device_update(Device *device, DeviceScene *dscene, Progress& progress);
 	void device_update_slot(Device *device, DeviceScene *dscene, int flat_slot, Progress *progress);
@@ -96,6 +100,9 @@ public:
 		int users;
 	};
 
+	/* Image stored in a flattened slot, NULL if the slot is empty. */
+	const Image *get_image(int flat_slot);
+
 private:
 	int tex_num_images[IMAGE_DATA_NUM_TYPES];
 	int tex_start_images[IMAGE_DATA_NUM_TYPES];
@@ -106,6 +113,7 @@ private:
 	vector<Image*> images[IMAGE_DATA_NUM_TYPES];
 	void *osl_texture_system;
 	bool pack_images;
+	bool use_sparse_textures;
 
 	bool file_load_image_generic(Image *img, ImageInput **in, int &width, int &height, int &depth, int &components);
 
@@ -118,6 +126,9 @@ private:
 	template<typename T>
 	bool file_load_half_image(Image *img, ImageDataType type, device_vector<T>& tex_img);
 
+	template<typename T>
+	bool make_sparse_image(device_vector<T>& tex_img, device_vector<int>& tex_offsets);
+
 	int type_index_to_flattened_slot(int slot, ImageDataType type);
 	int flattened_slot_to_type_index(int flat_slot, ImageDataType *type);
 	string name_from_type(int type);
@@ -169,6 +169,7 @@ Mesh::Mesh()
 
 	has_volume = false;
 	has_surface_bssrdf = false;
+	use_volume_bounds = false;
 
 	num_ngons = 0;
 
@@ -286,6 +287,7 @@ void Mesh::clear()
 	transform_negative_scaled = false;
 	transform_normal = transform_identity();
 	geometry_flags = GEOMETRY_NONE;
+	use_volume_bounds = false;
 
 	delete patch_table;
 	patch_table = NULL;
@@ -1615,6 +1617,61 @@ void MeshManager::device_update_bvh(Device *device, DeviceScene *dscene, Scene *
 
 	dscene->data.bvh.root = pack.root_index;
 	dscene->data.bvh.use_qbvh = scene->params.use_qbvh;
+
+	bvh_object_meshes.clear();
+	foreach(Object *object, scene->objects)
+		bvh_object_meshes.push_back(object->mesh);
+}
+
+bool MeshManager::can_refit_bvh(Scene *scene)
+{
+	/* Refit is only possible when the device has the BVH and mesh data of
+	 * exactly the same objects and meshes, only their bounds may differ. */
+	if(!bvh || scene->objects.empty() || bvh->objects != scene->objects)
+		return false;
+	if(bvh_object_meshes.size() != scene->objects.size())
+		return false;
+
+	for(size_t i = 0; i < scene->objects.size(); i++)
+		if(scene->objects[i]->mesh != bvh_object_meshes[i])
+			return false;
+
+	foreach(Mesh *mesh, scene->meshes)
+		if(mesh->need_update)
+			return false;
+
+	return true;
+}
+
+void MeshManager::device_update_bvh_refit(Device *device,
+                                          DeviceScene *dscene,
+                                          Scene * /*scene*/,
+                                          Progress& progress)
+{
+	progress.set_status("Updating Scene BVH", "Refitting");
+
+	VLOG(1) << "Refitting top level BVH of " << bvh->objects.size() << " objects.";
+
+	bvh->refit(progress);
+
+	if(progress.get_cancel()) return;
+
+	/* Primitives are unchanged, only nodes need to be copied again. */
+	progress.set_status("Updating Scene BVH", "Copying BVH to device");
+
+	PackedBVH& pack = bvh->pack;
+
+	device->tex_free(dscene->bvh_nodes);
+	device->tex_free(dscene->bvh_leaf_nodes);
+
+	if(pack.nodes.size()) {
+		dscene->bvh_nodes.reference((float4*)&pack.nodes[0], pack.nodes.size());
+		device->tex_alloc("__bvh_nodes", dscene->bvh_nodes);
+	}
+	if(pack.leaf_nodes.size()) {
+		dscene->bvh_leaf_nodes.reference((float4*)&pack.leaf_nodes[0], pack.leaf_nodes.size());
+		device->tex_alloc("__bvh_leaf_nodes", dscene->bvh_leaf_nodes);
+	}
 }
 
 void MeshManager::device_update_flags(Device * /*device*/,
@@ -1695,13 +1752,48 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 
 	VLOG(1) << "Total " << scene->meshes.size() << " meshes.";
 
-	/* Update normals. */
 	foreach(Mesh *mesh, scene->meshes) {
 		foreach(Shader *shader, mesh->used_shaders) {
 			if(shader->need_update_attributes)
 				mesh->need_update = true;
 		}
+	}
+
+#ifdef __OBJECT_MOTION__
+	Scene::MotionType need_motion = scene->need_motion(device->info.advanced_shading);
+	bool motion_blur = need_motion == Scene::MOTION_BLUR;
+#else
+	bool motion_blur = false;
+#endif
+
+	/* When only objects changed, mesh data and mesh BVHs on the device are
+	 * still valid and the top level BVH can be refitted to the new bounds. */
+	if(can_refit_bvh(scene)) {
+		foreach(Object *object, scene->objects) {
+			object->compute_bounds(motion_blur);
+		}
+
+		device_update_bvh_refit(device, dscene, scene, progress);
+		if(progress.get_cancel()) return;
+
+		need_update = false;
+		return;
+	}
+
+	/* Replace volume meshes by bounds around their voxel data, before
+	 * normals and BVH are computed from the geometry. */
+	device_update_volume_images(device, dscene, scene, progress);
+	if(progress.get_cancel()) return;
 
+	foreach(Mesh *mesh, scene->meshes) {
+		if(mesh->need_update) {
+			create_volume_mesh(scene, dscene, mesh, progress);
+			if(progress.get_cancel()) return;
+		}
+	}
+
+	/* Update normals. */
+	foreach(Mesh *mesh, scene->meshes) {
 		if(mesh->need_update) {
 			mesh->add_face_normals();
 			mesh->add_vertex_normals();
@@ -1844,13 +1936,6 @@ void MeshManager::device_update(Device *device, DeviceScene *dscene, Scene *scen
 		shader->need_update_attributes = false;
 	}
 
-#ifdef __OBJECT_MOTION__
-	Scene::MotionType need_motion = scene->need_motion(device->info.advanced_shading);
-	bool motion_blur = need_motion == Scene::MOTION_BLUR;
-#else
-	bool motion_blur = false;
-#endif
-
 	/* Update objects. */
 	vector<Object *> volume_objects;
 	foreach(Object *object, scene->objects) {
@@ -1923,6 +2008,8 @@ void MeshManager::device_free(Device *device, DeviceScene *dscene)
 	dscene->attributes_float3.clear();
 	dscene->attributes_uchar4.clear();
 
+	bvh_object_meshes.clear();
+
 #ifdef WITH_OSL
 	OSLGlobals *og = (OSLGlobals*)device->osl_memory();
 
@@ -145,6 +145,7 @@ public:
 
 	bool has_volume;  /* Set in the device_update_flags(). */
 	bool has_surface_bssrdf;  /* Set in the device_update_flags(). */
+	bool use_volume_bounds;  /* Replace by bounds around voxel data, see mesh_volume.cpp. */
 
 	array<float3> curve_keys;
 	array<float> curve_radius;
@@ -270,6 +271,7 @@ public:
 	~MeshManager();
 
 	bool displace(Device *device, DeviceScene *dscene, Scene *scene, Mesh *mesh, Progress& progress);
+	bool create_volume_mesh(Scene *scene, DeviceScene *dscene, Mesh *mesh, Progress& progress);
 
 	/* attributes */
 	void update_osl_attributes(Device *device, Scene *scene, vector<AttributeRequestSet>& mesh_attributes);
@@ -307,10 +309,25 @@ protected:
 	                       Scene *scene,
 	                       Progress& progress);
 
+	/* Top level BVH refit, when only objects changed since the last build. */
+	bool can_refit_bvh(Scene *scene);
+	void device_update_bvh_refit(Device *device,
+	                             DeviceScene *dscene,
+	                             Scene *scene,
+	                             Progress& progress);
+
 	void device_update_displacement_images(Device *device,
 	                                       DeviceScene *dscene,
 	                                       Scene *scene,
 	                                       Progress& progress);
+
+	void device_update_volume_images(Device *device,
+	                                 DeviceScene *dscene,
+	                                 Scene *scene,
+	                                 Progress& progress);
+
+	/* Meshes of the objects in the top level BVH on the device. */
+	vector<Mesh*> bvh_object_meshes;
 };
 
 CCL_NAMESPACE_END
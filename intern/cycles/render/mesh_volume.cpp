@@ -0,0 +1,392 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "device.h"
+
+#include "attribute.h"
+#include "image.h"
+#include "mesh.h"
+#include "object.h"
+#include "scene.h"
+#include "shader.h"
+
+#include "util_foreach.h"
+#include "util_logging.h"
+#include "util_progress.h"
+#include "util_set.h"
+#include "util_sparse_grid.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Volume Bounds
+ *
+ * Smoke domains only have density where the voxel grids are non-zero, which
+ * is often a small part of the domain. The domain mesh is replaced by a closed
+ * surface around the non-empty tiles of the grids, so rays skip the empty
+ * space entirely and are only ray-marched between entering and leaving this
+ * surface. Tiles are dilated by one, so interpolation near the border of the
+ * non-empty region still gives the same result as with the full domain. */
+
+namespace {
+
+struct VolumeTileGrid {
+	int3 res;
+	vector<char> active;
+
+	int index(int x, int y, int z) const
+	{
+		return x + res.x*(y + res.y*z);
+	}
+
+	bool is_active(int x, int y, int z) const
+	{
+		if(x < 0 || y < 0 || z < 0 || x >= res.x || y >= res.y || z >= res.z) {
+			return false;
+		}
+		return active[index(x, y, z)] != 0;
+	}
+};
+
+/* Mark tiles of the bounds grid that overlap non-empty tiles of a voxel grid,
+ * which may have a different resolution than the bounds grid. */
+void volume_tiles_add_grid(VolumeTileGrid *tiles,
+                           const int3& voxel_res,
+                           const int3& grid_res,
+                           const vector<int>& offsets)
+{
+	const int3 tiled_res = make_int3(sparse_grid_tile_res(grid_res.x),
+	                                 sparse_grid_tile_res(grid_res.y),
+	                                 sparse_grid_tile_res(grid_res.z));
+	const float3 scale = make_float3((float)voxel_res.x / grid_res.x,
+	                                 (float)voxel_res.y / grid_res.y,
+	                                 (float)voxel_res.z / grid_res.z);
+	size_t tile = 0;
+
+	for(int z = 0; z < tiled_res.z; z++) {
+		for(int y = 0; y < tiled_res.y; y++) {
+			for(int x = 0; x < tiled_res.x; x++, tile++) {
+				if(offsets[tile] == SPARSE_GRID_EMPTY_TILE) {
+					continue;
+				}
+
+				/* Voxel range of the tile in the bounds grid. */
+				float3 lo = make_float3(x, y, z) * (float)TEX_SPARSE_TILE_SIZE * scale;
+				float3 hi = make_float3(x + 1, y + 1, z + 1) * (float)TEX_SPARSE_TILE_SIZE * scale;
+
+				int x0 = clamp((int)floorf(lo.x) >> TEX_SPARSE_TILE_SHIFT, 0, tiles->res.x - 1);
+				int y0 = clamp((int)floorf(lo.y) >> TEX_SPARSE_TILE_SHIFT, 0, tiles->res.y - 1);
+				int z0 = clamp((int)floorf(lo.z) >> TEX_SPARSE_TILE_SHIFT, 0, tiles->res.z - 1);
+				int x1 = clamp((int)ceilf(hi.x - 1.0f) >> TEX_SPARSE_TILE_SHIFT, 0, tiles->res.x - 1);
+				int y1 = clamp((int)ceilf(hi.y - 1.0f) >> TEX_SPARSE_TILE_SHIFT, 0, tiles->res.y - 1);
+				int z1 = clamp((int)ceilf(hi.z - 1.0f) >> TEX_SPARSE_TILE_SHIFT, 0, tiles->res.z - 1);
+
+				for(int k = z0; k <= z1; k++) {
+					for(int j = y0; j <= y1; j++) {
+						for(int i = x0; i <= x1; i++) {
+							tiles->active[tiles->index(i, j, k)] = 1;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+/* Grow the active region by one tile, to cover the footprint of linear and
+ * cubic interpolation of voxels at the border. */
+void volume_tiles_dilate(VolumeTileGrid *tiles)
+{
+	vector<char> dilated(tiles->active.size(), 0);
+
+	for(int z = 0; z < tiles->res.z; z++) {
+		for(int y = 0; y < tiles->res.y; y++) {
+			for(int x = 0; x < tiles->res.x; x++) {
+				if(!tiles->is_active(x, y, z)) {
+					continue;
+				}
+
+				for(int k = max(z - 1, 0); k <= min(z + 1, tiles->res.z - 1); k++) {
+					for(int j = max(y - 1, 0); j <= min(y + 1, tiles->res.y - 1); j++) {
+						for(int i = max(x - 1, 0); i <= min(x + 1, tiles->res.x - 1); i++) {
+							dilated[tiles->index(i, j, k)] = 1;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	tiles->active.swap(dilated);
+}
+
+}  /* namespace */
+
+bool MeshManager::create_volume_mesh(Scene *scene,
+                                     DeviceScene *dscene,
+                                     Mesh *mesh,
+                                     Progress& progress)
+{
+	if(!mesh->use_volume_bounds || !mesh->has_volume) {
+		return false;
+	}
+
+	/* Only meshes that are nothing but a container for voxel data. */
+	foreach(Shader *shader, mesh->used_shaders) {
+		if(shader->has_surface) {
+			return false;
+		}
+	}
+
+	if(mesh->subdivision_type != Mesh::SUBDIVISION_NONE ||
+	   mesh->num_curves() ||
+	   mesh->attributes.find(ATTR_STD_MOTION_VERTEX_POSITION))
+	{
+		return false;
+	}
+
+	Attribute *attr_tfm = mesh->attributes.find(ATTR_STD_GENERATED_TRANSFORM);
+	if(!attr_tfm) {
+		return false;
+	}
+
+	/* Gather non-empty tiles of all voxel grids, at the highest resolution. */
+	vector<int3> grid_res;
+	vector<vector<int> > grid_offsets;
+	int3 voxel_res = make_int3(0, 0, 0);
+
+	foreach(Attribute& attr, mesh->attributes.attributes) {
+		if(attr.element != ATTR_ELEMENT_VOXEL) {
+			continue;
+		}
+
+		VoxelAttribute *voxel = attr.data_voxel();
+		int3 res;
+		vector<int> offsets;
+
+		if(voxel->slot == -1 ||
+		   !scene->image_manager->get_image_sparse_grid(dscene, voxel->slot, &res, &offsets))
+		{
+			/* Without the grid we can't know where the volume is empty. */
+			return false;
+		}
+
+		if(res.x * res.y * res.z > voxel_res.x * voxel_res.y * voxel_res.z) {
+			voxel_res = res;
+		}
+
+		grid_res.push_back(res);
+		grid_offsets.push_back(offsets);
+	}
+
+	if(grid_res.empty()) {
+		return false;
+	}
+
+	progress.set_status("Updating Mesh", "Computing volume bounds " + mesh->name.string());
+
+	VolumeTileGrid tiles;
+	tiles.res = make_int3(sparse_grid_tile_res(voxel_res.x),
+	                      sparse_grid_tile_res(voxel_res.y),
+	                      sparse_grid_tile_res(voxel_res.z));
+	tiles.active.resize((size_t)tiles.res.x * tiles.res.y * tiles.res.z, 0);
+
+	for(size_t i = 0; i < grid_res.size(); i++) {
+		volume_tiles_add_grid(&tiles, voxel_res, grid_res[i], grid_offsets[i]);
+	}
+
+	volume_tiles_dilate(&tiles);
+
+	/* Transform from normalized grid coordinates to mesh space. */
+	Transform itfm = transform_inverse(*attr_tfm->data_transform());
+
+	if(mesh->transform_applied) {
+		foreach(Object *object, scene->objects) {
+			if(object->mesh == mesh) {
+				itfm = object->tfm * itfm;
+				break;
+			}
+		}
+	}
+
+	const bool flip = transform_negative_scale(itfm);
+
+	/* Nothing to skip if the voxels fill the whole domain. */
+	size_t num_active = 0;
+	foreach(char active, tiles.active) {
+		num_active += active;
+	}
+	if(num_active == tiles.active.size()) {
+		return false;
+	}
+
+	/* Create a quad for every face between an active and an inactive tile,
+	 * sharing vertices on the tile lattice. */
+	const int lattice_res[3] = {tiles.res.x + 1, tiles.res.y + 1, tiles.res.z + 1};
+	const int voxel_res_axis[3] = {voxel_res.x, voxel_res.y, voxel_res.z};
+	vector<int> lattice_verts((size_t)lattice_res[0] * lattice_res[1] * lattice_res[2], -1);
+	array<float3> verts;
+	array<int> triangles;
+
+	for(int z = 0; z < tiles.res.z; z++) {
+		for(int y = 0; y < tiles.res.y; y++) {
+			for(int x = 0; x < tiles.res.x; x++) {
+				if(!tiles.is_active(x, y, z)) {
+					continue;
+				}
+
+				for(int axis = 0; axis < 3; axis++) {
+					const int u = (axis + 1) % 3;
+					const int v = (axis + 2) % 3;
+
+					for(int side = 0; side < 2; side++) {
+						int neighbor[3] = {x, y, z};
+						neighbor[axis] += (side == 0)? -1: 1;
+
+						if(tiles.is_active(neighbor[0], neighbor[1], neighbor[2])) {
+							continue;
+						}
+
+						/* Corners counter-clockwise seen from outside, the
+						 * face normal u x v points along the positive axis. */
+						int corners[4][3];
+						for(int c = 0; c < 4; c++) {
+							corners[c][0] = x;
+							corners[c][1] = y;
+							corners[c][2] = z;
+							corners[c][axis] += side;
+						}
+						corners[1][u] += 1;
+						corners[2][u] += 1;
+						corners[2][v] += 1;
+						corners[3][v] += 1;
+
+						if((side == 0) != flip) {
+							for(int i = 0; i < 3; i++) {
+								swap(corners[1][i], corners[3][i]);
+							}
+						}
+
+						int face_verts[4];
+						for(int c = 0; c < 4; c++) {
+							const int *q = corners[c];
+							int& vert = lattice_verts[q[0] + lattice_res[0]*(q[1] + lattice_res[1]*q[2])];
+
+							if(vert == -1) {
+								float co[3];
+								for(int i = 0; i < 3; i++) {
+									co[i] = (float)min(q[i] << TEX_SPARSE_TILE_SHIFT, voxel_res_axis[i]) / voxel_res_axis[i];
+								}
+
+								vert = verts.size();
+								verts.push_back_slow(transform_point(&itfm, make_float3(co[0], co[1], co[2])));
+							}
+
+							face_verts[c] = vert;
+						}
+
+						triangles.push_back_slow(face_verts[0]);
+						triangles.push_back_slow(face_verts[1]);
+						triangles.push_back_slow(face_verts[2]);
+						triangles.push_back_slow(face_verts[0]);
+						triangles.push_back_slow(face_verts[2]);
+						triangles.push_back_slow(face_verts[3]);
+					}
+				}
+			}
+		}
+
+		if(progress.get_cancel()) {
+			return false;
+		}
+	}
+
+	const size_t num_triangles = triangles.size() / 3;
+
+	VLOG(1) << "Volume bounds for mesh " << mesh->name << ": "
+	        << mesh->num_triangles() << " -> " << num_triangles << " triangles.";
+
+	/* Replace geometry, keeping only attributes that don't depend on it. */
+	const int shader = (mesh->shader.size())? mesh->shader[0]: 0;
+
+	list<Attribute>::iterator it = mesh->attributes.attributes.begin();
+	while(it != mesh->attributes.attributes.end()) {
+		if(it->element == ATTR_ELEMENT_VOXEL || it->element == ATTR_ELEMENT_MESH) {
+			++it;
+		}
+		else {
+			it = mesh->attributes.attributes.erase(it);
+		}
+	}
+
+	mesh->verts.steal_data(verts);
+	mesh->triangles.steal_data(triangles);
+	mesh->shader.resize(num_triangles);
+	mesh->smooth.resize(num_triangles);
+	for(size_t i = 0; i < num_triangles; i++) {
+		mesh->shader[i] = shader;
+		mesh->smooth[i] = false;
+	}
+	mesh->triangle_patch.clear();
+	mesh->vert_patch_uv.clear();
+
+	mesh->compute_bounds();
+
+	return true;
+}
+
+void MeshManager::device_update_volume_images(Device *device,
+                                              DeviceScene *dscene,
+                                              Scene *scene,
+                                              Progress& progress)
+{
+	if(device->info.pack_images) {
+		return;
+	}
+
+	ImageManager *image_manager = scene->image_manager;
+	set<int> volume_images;
+
+	foreach(Mesh *mesh, scene->meshes) {
+		if(!mesh->need_update || !mesh->use_volume_bounds) {
+			continue;
+		}
+
+		foreach(Attribute& attr, mesh->attributes.attributes) {
+			if(attr.element == ATTR_ELEMENT_VOXEL && attr.data_voxel()->slot != -1) {
+				volume_images.insert(attr.data_voxel()->slot);
+			}
+		}
+	}
+
+	if(volume_images.empty()) {
+		return;
+	}
+
+	progress.set_status("Updating Volume Images");
+
+	TaskPool pool;
+	foreach(int slot, volume_images) {
+		pool.push(function_bind(&ImageManager::device_update_slot,
+		                        image_manager,
+		                        device,
+		                        dscene,
+		                        slot,
+		                        &progress));
+	}
+	pool.wait_work();
+}
+
+CCL_NAMESPACE_END
@@ -120,6 +120,10 @@ public:
 	device_vector<half4> tex_half4_image[TEX_NUM_HALF4_CPU];
 	device_vector<half> tex_half_image[TEX_NUM_HALF_CPU];
 
+	/* cpu sparse volume images, offsets grid per image */
+	device_vector<int> tex_float4_image_offsets[TEX_NUM_FLOAT4_CPU];
+	device_vector<int> tex_float_image_offsets[TEX_NUM_FLOAT_CPU];
+
 	/* opencl images */
 	device_vector<uchar4> tex_image_byte4_packed;
 	device_vector<float4> tex_image_float4_packed;
@@ -27,6 +27,7 @@
 #include "scene.h"
 #include "session.h"
 #include "bake.h"
+#include "tile_output.h"
 
 #include "util_foreach.h"
 #include "util_function.h"
@@ -55,7 +56,21 @@ Session::Session(const SessionParams& params_)
 
 	device = Device::create(params.device, stats, params.background);
 
-	if(params.background && params.output_path.empty()) {
+	if(params.tiled_output) {
+		/* Tiles have to be finished in one go, and match the file tile grid. */
+		if(params.background && !params.progressive && !params.progressive_refine &&
+		   !params.output_path.empty())
+		{
+			tile_manager.set_tile_order(TILE_TOP_TO_BOTTOM);
+			tile_manager.set_align_top(true);
+		}
+		else {
+			VLOG(1) << "Tiled output is only supported for non-progressive background renders.";
+			params.tiled_output = false;
+		}
+	}
+
+	if(params.background && (params.output_path.empty() || params.tiled_output)) {
 		buffers = NULL;
 		display = NULL;
 	}
@@ -72,6 +87,7 @@ Session::Session(const SessionParams& params_)
 	preview_time = 0.0;
 	paused_time = 0.0;
 	last_update_time = 0.0;
+	tile_output = NULL;
 
 	delayed_reset.do_reset = false;
 	delayed_reset.samples = 0;
@@ -104,18 +120,13 @@ Session::~Session()
 		wait();
 	}
 
-	if(!params.output_path.empty()) {
+	if(!params.output_path.empty() && !params.tiled_output) {
 		/* tonemap and write out image if requested */
-		delete display;
-
-		display = new DisplayBuffer(device, false);
-		display->reset(device, buffers->params);
-		tonemap(params.samples);
-
-		progress.set_status("Writing Image", params.output_path);
-		display->write(device, params.output_path);
+		write_image(params.output_path);
 	}
 
+	delete tile_output;
+
 	/* clean up */
 	foreach(RenderBuffers *buffers, tile_buffers)
 		delete buffers;
@@ -128,6 +139,18 @@ Session::~Session()
 	TaskScheduler::exit();
 }
 
+void Session::write_image(const string& filepath)
+{
+	delete display;
+
+	display = new DisplayBuffer(device, false);
+	display->reset(device, buffers->params);
+	tonemap(params.samples);
+
+	progress.set_status("Writing Image", filepath);
+	display->write(device, filepath);
+}
+
 void Session::start()
 {
 	session_thread = new thread(function_bind(&Session::run, this));
@@ -382,7 +405,7 @@ bool Session::acquire_tile(Device *tile_device, RenderTile& rtile)
 
 	/* in case of a permanent buffer, return it, otherwise we will allocate
 	 * a new temporary buffer */
-	if(!(params.background && params.output_path.empty())) {
+	if(buffers) {
 		tile_manager.state.buffer.get_offset_stride(rtile.offset, rtile.stride);
 
 		rtile.buffer = buffers->buffer.device_pointer;
@@ -463,6 +486,17 @@ void Session::update_tile_sample(RenderTile& rtile)
 
 void Session::release_tile(RenderTile& rtile)
 {
+	if(tile_output) {
+		/* written without holding the tile lock, so other devices can keep
+		 * acquiring tiles while passes are converted and written */
+		if(!tile_output->write_tile(rtile))
+			progress.set_error(tile_output->error_message());
+
+		thread_scoped_lock tile_lock(tile_mutex);
+		update_status_time();
+		return;
+	}
+
 	thread_scoped_lock tile_lock(tile_mutex);
 
 	if(write_render_tile_cb) {
@@ -692,6 +726,8 @@ void Session::run()
 			run_cpu();
 	}
 
+	close_tile_output();
+
 	/* progress update */
 	if(progress.get_cancel())
 		progress.set_status("Cancel", progress.get_cancel_message());
@@ -719,6 +755,12 @@ void Session::reset_(BufferParams& buffer_params, int samples)
 
 	tile_manager.reset(buffer_params, samples);
 
+	/* tiles of the previous render are not written anymore */
+	if(tile_output) {
+		delete tile_output;
+		tile_output = NULL;
+	}
+
 	start_time = time_dt();
 	preview_time = 0.0;
 	paused_time = 0.0;
@@ -820,8 +862,12 @@ void Session::update_scene()
 
 	/* update scene */
 	if(scene->need_update()) {
+		double update_start_time = time_dt();
+
 		progress.set_status("Updating Scene");
 		MEM_GUARDED_CALL(&progress, scene->device_update, device, progress);
+
+		progress.add_update_time(time_dt() - update_start_time);
 	}
 }
 
@@ -913,8 +959,41 @@ void Session::update_progress_sample()
 	progress.increment_sample();
 }
 
+bool Session::open_tile_output()
+{
+	tile_output = new TileOutput();
+
+	if(!tile_output->open(params.output_path,
+	                      tile_manager.params,
+	                      params.tile_size,
+	                      scene->film->exposure))
+	{
+		progress.set_error(tile_output->error_message());
+		return false;
+	}
+
+	return true;
+}
+
+void Session::close_tile_output()
+{
+	if(!tile_output)
+		return;
+
+	if(!tile_output->close() && !progress.get_cancel())
+		progress.set_error(tile_output->error_message());
+
+	delete tile_output;
+	tile_output = NULL;
+}
+
 void Session::path_trace()
 {
+	if(params.tiled_output && !tile_output) {
+		if(!open_tile_output())
+			return;
+	}
+
 	/* add path trace task */
 	DeviceTask task(DeviceTask::PATH_TRACE);
 	
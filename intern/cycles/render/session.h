@@ -37,6 +37,7 @@ class DisplayBuffer;
 class Progress;
 class RenderBuffers;
 class Scene;
+class TileOutput;
 
 /* Session Parameters */
 
@@ -46,6 +47,10 @@ public:
 	bool background;
 	bool progressive_refine;
 	string output_path;
+	/* Write tiles to output_path as soon as they are finished instead of
+	 * keeping the full frame in memory, for background renders without
+	 * progressive sampling. */
+	bool tiled_output;
 
 	bool progressive;
 	bool experimental;
@@ -69,6 +74,7 @@ public:
 		background = false;
 		progressive_refine = false;
 		output_path = "";
+		tiled_output = false;
 
 		progressive = false;
 		experimental = false;
@@ -94,6 +100,7 @@ public:
 		&& background == params.background
 		&& progressive_refine == params.progressive_refine
 		&& output_path == params.output_path
+		&& tiled_output == params.tiled_output
 		/* && samples == params.samples */
 		&& progressive == params.progressive
 		&& experimental == params.experimental
@@ -144,6 +151,9 @@ public:
 	void update_scene();
 	void load_kernels();
 
+	/* Tonemap and write the render result, used by background renders. */
+	void write_image(const string& filepath);
+
 	void device_free();
 
 protected:
@@ -206,6 +216,11 @@ protected:
 
 	vector<RenderBuffers *> tile_buffers;
 
+	/* tiled output */
+	TileOutput *tile_output;
+	bool open_tile_output();
+	void close_tile_output();
+
 	DeviceRequestedFeatures get_requested_device_features();
 
 	/* ** Split kernel routines ** */
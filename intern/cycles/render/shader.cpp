@@ -229,6 +229,11 @@ void Shader::set_graph(ShaderGraph *graph_)
 	delete graph_bump;
 	graph = graph_;
 	graph_bump = NULL;
+
+	/* nodes of a new graph may need image slots and attributes that are only
+	 * added while compiling, never reuse nodes of another graph */
+	svm_nodes.clear();
+	svm_nodes_hash = "";
 }
 
 void Shader::tag_update(Scene *scene)
@@ -332,6 +337,8 @@ ShaderManager *ShaderManager::create(Scene *scene, int shadingsystem)
 
 uint ShaderManager::get_attribute_id(ustring name)
 {
+	thread_scoped_lock lock(attribute_id_mutex);
+
 	/* get a unique id for each name, for SVM attribute lookup */
 	AttributeIDMap::iterator it = unique_attribute_id.find(name);
 
@@ -128,6 +128,11 @@ public:
 	uint id;
 	bool used;
 
+	/* SVM nodes from the last compilation with the hash of the graph they
+	 * were compiled from, reused as long as the graph does not change */
+	vector<int4> svm_nodes;
+	string svm_nodes_hash;
+
 #ifdef WITH_OSL
 	/* osl shading state references */
 	OSL::ShaderGroupRef osl_surface_ref;
@@ -194,6 +199,8 @@ protected:
 
 	typedef unordered_map<ustring, uint, ustringHash> AttributeIDMap;
 	AttributeIDMap unique_attribute_id;
+	/* Shaders are compiled from multiple threads. */
+	thread_mutex attribute_id_mutex;
 
 	thread_mutex lookup_table_mutex;
 	static vector<float> beckmann_table;
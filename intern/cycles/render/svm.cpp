@@ -26,6 +26,7 @@
 #include "util_debug.h"
 #include "util_logging.h"
 #include "util_foreach.h"
+#include "util_md5.h"
 #include "util_progress.h"
 #include "util_task.h"
 
@@ -35,6 +36,9 @@ CCL_NAMESPACE_BEGIN
 
 SVMShaderManager::SVMShaderManager()
 {
+	num_compiled_shaders_ = 0;
+	compile_time_ = 0.0;
+	max_compile_time_ = 0.0;
 }
 
 SVMShaderManager::~SVMShaderManager()
@@ -45,49 +49,95 @@ void SVMShaderManager::reset(Scene * /*scene*/)
 {
 }
 
+/* Hash of everything the compiled nodes depend on, other than image slots
+ * and attribute ids which stay valid for the lifetime of the graph. */
+static string svm_shader_hash(Shader *shader, bool background)
+{
+	MD5Hash md5;
+
+	md5.append((const uint8_t*)&shader->displacement_method, sizeof(shader->displacement_method));
+	/* Unused shaders compile to empty programs. */
+	md5.append((const uint8_t*)&shader->used, sizeof(shader->used));
+	md5.append((const uint8_t*)&background, sizeof(background));
+
+	ShaderGraph *graphs[2] = {shader->graph, shader->graph_bump};
+
+	for(int i = 0; i < 2; i++) {
+		if(!graphs[i]) {
+			continue;
+		}
+
+		foreach(ShaderNode *node, graphs[i]->nodes) {
+			node->hash(md5);
+
+			foreach(ShaderInput *input, node->inputs) {
+				int link_id = (input->link)? input->link->parent->id: -1;
+				md5.append((const uint8_t*)&link_id, sizeof(link_id));
+
+				if(input->link) {
+					ustring name = input->link->name();
+					md5.append((const uint8_t*)name.c_str(), name.size());
+				}
+			}
+		}
+	}
+
+	return md5.get_hex();
+}
+
 void SVMShaderManager::device_update_shader(Scene *scene,
                                             Shader *shader,
-                                            Progress *progress,
-                                            vector<int4> *global_svm_nodes)
+                                            Progress *progress)
 {
 	if(progress->get_cancel()) {
 		return;
 	}
 	assert(shader->graph);
 
-	vector<int4> svm_nodes;
-	svm_nodes.push_back(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
+	bool background = (shader == scene->default_background);
+
+	/* Graphs are finalized once, integrator settings they were simplified
+	 * for are not part of the hash. */
+	bool reuse = !shader->svm_nodes.empty() &&
+	             !(shader->need_update && shader->has_integrator_dependency) &&
+	             shader->svm_nodes_hash == svm_shader_hash(shader, background);
+
+	if(reuse) {
+		VLOG(2) << "Shader " << shader->name << " is unchanged, reusing "
+		        << shader->svm_nodes.size() << " SVM nodes.";
+	}
+	else {
+		vector<int4> svm_nodes;
+		svm_nodes.push_back(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
+
+		SVMCompiler::Summary summary;
+		SVMCompiler compiler(scene->shader_manager, scene->image_manager);
+		compiler.background = background;
+		compiler.compile(scene, shader, svm_nodes, 0, &summary);
+
+		VLOG(2) << "Compilation summary:\n"
+		        << "Shader name: " << shader->name << "\n"
+		        << summary.full_report();
+
+		/* Hash the finalized graph, which is what it will be next time. */
+		shader->svm_nodes.swap(svm_nodes);
+		shader->svm_nodes_hash = svm_shader_hash(shader, background);
 
-	SVMCompiler::Summary summary;
-	SVMCompiler compiler(scene->shader_manager, scene->image_manager);
-	compiler.background = (shader == scene->default_background);
-	compiler.compile(scene, shader, svm_nodes, 0, &summary);
+		progress->set_shader_compile_time(shader->name.string(), summary.time_total);
 
-	VLOG(2) << "Compilation summary:\n"
-	        << "Shader name: " << shader->name << "\n"
-	        << summary.full_report();
+		stats_lock_.lock();
+		num_compiled_shaders_++;
+		compile_time_ += summary.time_total;
+		if(summary.time_total > max_compile_time_) {
+			max_compile_time_ = summary.time_total;
+			slowest_shader_ = shader->name.string();
+		}
+		stats_lock_.unlock();
+	}
 
 	if(shader->use_mis && shader->has_surface_emission) {
 		scene->light_manager->need_update = true;
 	}
-
-	/* We only calculate offset and do re-allocation from the locked block,
-	 * actual copy we do after the lock is releases to hopefully gain some
-	 * percent of performance.
-	 */
-	nodes_lock_.lock();
-	size_t global_nodes_size = global_svm_nodes->size();
-	global_svm_nodes->resize(global_nodes_size + svm_nodes.size());
-	nodes_lock_.unlock();
-	/* Offset local SVM nodes to a global address space. */
-	int4& jump_node = global_svm_nodes->at(shader->id);
-	jump_node.y = svm_nodes[0].y + global_nodes_size - 1;
-	jump_node.z = svm_nodes[0].z + global_nodes_size - 1;
-	jump_node.w = svm_nodes[0].w + global_nodes_size - 1;
-	/* Copy new nodes to global storage. */
-	memcpy(&global_svm_nodes->at(global_nodes_size),
-	       &svm_nodes[1],
-	       sizeof(int4) * (svm_nodes.size() - 1));
 }
 
 void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene *scene, Progress& progress)
@@ -105,13 +155,11 @@ void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 	/* determine which shaders are in use */
 	device_update_shaders_used(scene);
 
-	/* svm_nodes */
-	vector<int4> svm_nodes;
-	size_t i;
-
-	for(i = 0; i < scene->shaders.size(); i++) {
-		svm_nodes.push_back(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
-	}
+	/* compile shaders in parallel, each to its own nodes */
+	num_compiled_shaders_ = 0;
+	compile_time_ = 0.0;
+	max_compile_time_ = 0.0;
+	slowest_shader_ = "";
 
 	TaskPool task_pool;
 	foreach(Shader *shader, scene->shaders) {
@@ -119,8 +167,7 @@ void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 		                             this,
 		                             scene,
 		                             shader,
-		                             &progress,
-		                             &svm_nodes),
+		                             &progress),
 		               false);
 	}
 	task_pool.wait_work();
@@ -129,6 +176,27 @@ void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 		return;
 	}
 
+	/* svm_nodes, jump nodes of all shaders followed by the nodes of each
+	 * shader with offsets moved to the global address space */
+	vector<int4> svm_nodes;
+	size_t i;
+
+	for(i = 0; i < scene->shaders.size(); i++) {
+		svm_nodes.push_back(make_int4(NODE_SHADER_JUMP, 0, 0, 0));
+	}
+
+	foreach(Shader *shader, scene->shaders) {
+		const vector<int4>& shader_nodes = shader->svm_nodes;
+		int offset = svm_nodes.size() - 1;
+
+		int4& jump_node = svm_nodes[shader->id];
+		jump_node.y = shader_nodes[0].y + offset;
+		jump_node.z = shader_nodes[0].z + offset;
+		jump_node.w = shader_nodes[0].w + offset;
+
+		svm_nodes.insert(svm_nodes.end(), shader_nodes.begin() + 1, shader_nodes.end());
+	}
+
 	dscene->svm_nodes.copy((uint4*)&svm_nodes[0], svm_nodes.size());
 	device->tex_alloc("__svm_nodes", dscene->svm_nodes);
 
@@ -143,7 +211,15 @@ void SVMShaderManager::device_update(Device *device, DeviceScene *dscene, Scene
 
 	VLOG(1) << "Shader manager updated "
 	        << scene->shaders.size() << " shaders in "
-	        << time_dt() - start_time << " seconds.";
+	        << time_dt() - start_time << " seconds, compiled "
+	        << num_compiled_shaders_ << " in " << compile_time_
+	        << " seconds of thread time, "
+	        << scene->shaders.size() - num_compiled_shaders_ << " unchanged.";
+
+	if(num_compiled_shaders_ > 0) {
+		VLOG(1) << "Slowest shader to compile was " << slowest_shader_
+		        << " with " << max_compile_time_ << " seconds.";
+	}
 }
 
 void SVMShaderManager::device_free(Device *device, DeviceScene *dscene, Scene *scene)
@@ -49,13 +49,18 @@ public:
 	void device_free(Device *device, DeviceScene *dscene, Scene *scene);
 
 protected:
-	/* Lock used to synchronize threaded nodes compilation. */
-	thread_spin_lock nodes_lock_;
-
+	/* Statistics of the last update, gathered from the compilation threads. */
+	thread_spin_lock stats_lock_;
+	int num_compiled_shaders_;
+	double compile_time_;
+	double max_compile_time_;
+	string slowest_shader_;
+
+	/* Compile shader to its own nodes, or keep the nodes of the previous
+	 * update if the graph did not change. */
 	void device_update_shader(Scene *scene,
 	                          Shader *shader,
-	                          Progress *progress,
-	                          vector<int4> *global_svm_nodes);
+	                          Progress *progress);
 };
 
 /* Graph Compiler */
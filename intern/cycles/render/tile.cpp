@@ -96,6 +96,7 @@ TileManager::TileManager(bool progressive_, int num_samples_, int2 tile_size_, i
 	num_devices = num_devices_;
 	preserve_tile_device = preserve_tile_device_;
 	background = background_;
+	align_top = false;
 
 	range_start_sample = 0;
 	range_num_samples = -1;
@@ -271,6 +272,13 @@ int TileManager::gen_tiles(bool sliced)
 				int w = (tile_x == tile_w-1)? image_w - x: tile_size.x;
 				int h = (tile_y == tile_h-1)? slice_h - y: tile_size.y;
 
+				if(align_top) {
+					/* Rows go from top to bottom, so tile index matches file order. */
+					int top = slice_h - tile_y * tile_size.y;
+					y = max(top - tile_size.y, 0);
+					h = top - y;
+				}
+
 				tile_list->push_back(Tile(tile_index, x, y + slice_y, w, h, sliced? slice: cur_device));
 
 				if(!sliced) {
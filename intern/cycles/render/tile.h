@@ -82,6 +82,7 @@ public:
 	bool done();
 
 	void set_tile_order(TileOrder tile_order_) { tile_order = tile_order_; }
+	void set_align_top(bool align_top_) { align_top = align_top_; }
 
 	/* ** Sample range rendering. ** */
 
@@ -122,6 +123,12 @@ protected:
 	 */
 	bool background;
 
+	/* Align the tile grid to the top of the image instead of the bottom, with
+	 * the partial tiles in the bottom row. Needed to write tiles directly to
+	 * image files, whose tile grid starts at the top. Not supported by the
+	 * Hilbert spiral tile order. */
+	bool align_top;
+
 	/* Generate tile list, return number of tiles. */
 	int gen_tiles(bool sliced);
 };
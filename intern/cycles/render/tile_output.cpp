@@ -0,0 +1,283 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "tile_output.h"
+
+#include "util_algorithm.h"
+#include "util_logging.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Layer and channel names of passes in the file, following the multilayer
+ * EXR naming used by Blender. Returns false for internal passes. */
+static bool tile_output_pass_info(PassType type, const char **name, const char **channels)
+{
+	switch(type) {
+		case PASS_COMBINED: *name = "Combined"; *channels = "RGBA"; return true;
+		case PASS_DEPTH: *name = "Depth"; *channels = "Z"; return true;
+		case PASS_MIST: *name = "Mist"; *channels = "Z"; return true;
+		case PASS_NORMAL: *name = "Normal"; *channels = "XYZ"; return true;
+		case PASS_UV: *name = "UV"; *channels = "UVA"; return true;
+		case PASS_MOTION: *name = "Vector"; *channels = "XYZW"; return true;
+		case PASS_OBJECT_ID: *name = "IndexOB"; *channels = "X"; return true;
+		case PASS_MATERIAL_ID: *name = "IndexMA"; *channels = "X"; return true;
+		case PASS_DIFFUSE_COLOR: *name = "DiffCol"; *channels = "RGB"; return true;
+		case PASS_GLOSSY_COLOR: *name = "GlossCol"; *channels = "RGB"; return true;
+		case PASS_TRANSMISSION_COLOR: *name = "TransCol"; *channels = "RGB"; return true;
+		case PASS_SUBSURFACE_COLOR: *name = "SubsurfaceCol"; *channels = "RGB"; return true;
+		case PASS_DIFFUSE_INDIRECT: *name = "DiffInd"; *channels = "RGB"; return true;
+		case PASS_GLOSSY_INDIRECT: *name = "GlossInd"; *channels = "RGB"; return true;
+		case PASS_TRANSMISSION_INDIRECT: *name = "TransInd"; *channels = "RGB"; return true;
+		case PASS_SUBSURFACE_INDIRECT: *name = "SubsurfaceInd"; *channels = "RGB"; return true;
+		case PASS_DIFFUSE_DIRECT: *name = "DiffDir"; *channels = "RGB"; return true;
+		case PASS_GLOSSY_DIRECT: *name = "GlossDir"; *channels = "RGB"; return true;
+		case PASS_TRANSMISSION_DIRECT: *name = "TransDir"; *channels = "RGB"; return true;
+		case PASS_SUBSURFACE_DIRECT: *name = "SubsurfaceDir"; *channels = "RGB"; return true;
+		case PASS_EMISSION: *name = "Emit"; *channels = "RGB"; return true;
+		case PASS_BACKGROUND: *name = "Env"; *channels = "RGB"; return true;
+		case PASS_AO: *name = "AO"; *channels = "RGB"; return true;
+		case PASS_SHADOW: *name = "Shadow"; *channels = "RGB"; return true;
+#ifdef WITH_CYCLES_DEBUG
+		case PASS_BVH_TRAVERSAL_STEPS: *name = "Debug BVH Traversal Steps"; *channels = "X"; return true;
+		case PASS_BVH_TRAVERSED_INSTANCES: *name = "Debug BVH Traversed Instances"; *channels = "X"; return true;
+		case PASS_RAY_BOUNCES: *name = "Debug Ray Bounces"; *channels = "X"; return true;
+#endif
+		default:
+			return false;
+	}
+}
+
+TileOutput::TileOutput()
+{
+	out = NULL;
+	tile_size = make_int2(0, 0);
+	num_tiles_x = 0;
+	num_tiles = 0;
+	exposure = 1.0f;
+	num_channels = 0;
+	next_tile = 0;
+	max_pending_tiles = 0;
+}
+
+TileOutput::~TileOutput()
+{
+	close();
+}
+
+bool TileOutput::open(const string& filepath_,
+                      const BufferParams& params_,
+                      int2 tile_size_,
+                      float exposure_)
+{
+	close();
+
+	filepath = filepath_;
+	params = params_;
+	tile_size = tile_size_;
+	exposure = exposure_;
+	error = "";
+
+	num_tiles_x = (params.width + tile_size.x - 1) / tile_size.x;
+	num_tiles = num_tiles_x * ((params.height + tile_size.y - 1) / tile_size.y);
+	next_tile = 0;
+	max_pending_tiles = 0;
+
+	/* channels of all passes */
+	vector<string> channel_names;
+	int alpha_channel = -1;
+
+	pass_types.clear();
+	pass_channels.clear();
+
+	for(size_t i = 0; i < params.passes.size(); i++) {
+		const Pass& pass = params.passes[i];
+		const char *name, *channels;
+
+		if(!tile_output_pass_info(pass.type, &name, &channels))
+			continue;
+
+		pass_types.push_back(pass.type);
+		pass_channels.push_back(strlen(channels));
+
+		for(const char *c = channels; *c; c++) {
+			if(pass.type == PASS_COMBINED && *c == 'A')
+				alpha_channel = channel_names.size();
+
+			channel_names.push_back(string_printf("%s.%c", name, *c));
+		}
+	}
+
+	num_channels = channel_names.size();
+
+	/* open file */
+	out = ImageOutput::create(filepath);
+
+	if(!out) {
+		set_error("Failed to create image output for " + filepath);
+		return false;
+	}
+
+	if(!out->supports("tiles")) {
+		set_error("Tiled output not supported for " + filepath + ", use an EXR file");
+		delete out;
+		out = NULL;
+		return false;
+	}
+
+	ImageSpec spec(params.width, params.height, num_channels, TypeDesc::FLOAT);
+	spec.tile_width = tile_size.x;
+	spec.tile_height = tile_size.y;
+	spec.channelnames = channel_names;
+	spec.alpha_channel = alpha_channel;
+	spec.attribute("compression", "zip");
+
+	if(!out->open(filepath, spec)) {
+		set_error("Failed to open " + filepath + ": " + out->geterror());
+		delete out;
+		out = NULL;
+		return false;
+	}
+
+	VLOG(1) << "Writing " << num_tiles << " tiles with " << num_channels
+	        << " channels to " << filepath << ".";
+
+	return true;
+}
+
+int TileOutput::tile_index(const RenderTile& rtile)
+{
+	/* Render buffers start at the bottom, the file at the top. */
+	int x = rtile.x - params.full_x;
+	int y = params.height - (rtile.y - params.full_y) - rtile.h;
+
+	assert(x % tile_size.x == 0 && y % tile_size.y == 0);
+
+	return (y / tile_size.y) * num_tiles_x + x / tile_size.x;
+}
+
+bool TileOutput::write_tile(RenderTile& rtile)
+{
+	RenderBuffers *buffers = rtile.buffers;
+	int w = rtile.w;
+	int h = rtile.h;
+
+	/* convert passes to the file layout, always a full tile even at the
+	 * image border */
+	vector<float> pixels(tile_size.x * tile_size.y * num_channels, 0.0f);
+	bool success = buffers->copy_from_device();
+
+	if(success) {
+		vector<float> pass_pixels(w * h * 4);
+		int channel = 0;
+
+		for(size_t i = 0; i < pass_types.size(); i++) {
+			int components = pass_channels[i];
+
+			buffers->get_pass_rect(pass_types[i], exposure, rtile.sample, components, &pass_pixels[0]);
+
+			for(int y = 0; y < h; y++) {
+				const float *in = &pass_pixels[(h - 1 - y) * w * components];
+				float *out_row = &pixels[y * tile_size.x * num_channels + channel];
+
+				for(int x = 0; x < w; x++)
+					for(int c = 0; c < components; c++)
+						out_row[x * num_channels + c] = in[x * components + c];
+			}
+
+			channel += components;
+		}
+	}
+
+	/* the tile is not needed anymore, free it before waiting for the file */
+	delete buffers;
+	rtile.buffers = NULL;
+
+	int index = tile_index(rtile);
+
+	thread_scoped_lock lock(mutex);
+
+	if(!success) {
+		set_error("Failed to copy render tile from device");
+		return false;
+	}
+
+	pending_tiles[index].swap(pixels);
+	max_pending_tiles = max(max_pending_tiles, pending_tiles.size());
+
+	return write_pending_tiles();
+}
+
+bool TileOutput::write_pending_tiles()
+{
+	bool success = true;
+
+	while(!pending_tiles.empty() && pending_tiles.begin()->first == next_tile) {
+		int x = (next_tile % num_tiles_x) * tile_size.x;
+		int y = (next_tile / num_tiles_x) * tile_size.y;
+
+		if(out && !out->write_tile(x, y, 0, TypeDesc::FLOAT, &pending_tiles.begin()->second[0])) {
+			set_error("Failed to write tile to " + filepath + ": " + out->geterror());
+			success = false;
+		}
+
+		pending_tiles.erase(pending_tiles.begin());
+		next_tile++;
+	}
+
+	return success;
+}
+
+bool TileOutput::close()
+{
+	thread_scoped_lock lock(mutex);
+
+	if(!out)
+		return error.empty();
+
+	if(next_tile != num_tiles) {
+		set_error(string_printf("Only %d of %d tiles written to %s",
+		                        next_tile, num_tiles, filepath.c_str()));
+	}
+
+	if(!out->close())
+		set_error("Failed to close " + filepath + ": " + out->geterror());
+
+	VLOG(1) << "Finished writing " << filepath << ", at most "
+	        << max_pending_tiles << " tiles were waiting to be written.";
+
+	delete out;
+	out = NULL;
+	pending_tiles.clear();
+
+	return error.empty();
+}
+
+string TileOutput::error_message()
+{
+	thread_scoped_lock lock(mutex);
+	return error;
+}
+
+void TileOutput::set_error(const string& message)
+{
+	/* keep the first error, later ones are usually a consequence of it */
+	if(error.empty())
+		error = message;
+}
+
+CCL_NAMESPACE_END
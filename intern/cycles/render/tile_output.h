@@ -0,0 +1,93 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __TILE_OUTPUT_H__
+#define __TILE_OUTPUT_H__
+
+#include "buffers.h"
+
+#include "util_image.h"
+#include "util_map.h"
+#include "util_string.h"
+#include "util_thread.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+CCL_NAMESPACE_BEGIN
+
+/* Tile Output
+ *
+ * Writes the passes of finished render tiles to a tiled multilayer EXR file,
+ * so that background renders never need to keep the full frame in memory.
+ *
+ * Tiles must match the tile grid of the file, which starts at the top left
+ * of the image. They are written in file order, a tile finished before the
+ * tiles in front of it is kept in memory in file layout until it is its turn.
+ * When tiles are handed out in the same order, only about as many tiles as
+ * are rendered at the same time are waiting. */
+
+class TileOutput {
+public:
+	TileOutput();
+	~TileOutput();
+
+	bool open(const string& filepath,
+	          const BufferParams& params,
+	          int2 tile_size,
+	          float exposure);
+
+	/* Write the tile or queue it, the tile buffers are freed in both cases.
+	 * Safe to be called from multiple device threads. */
+	bool write_tile(RenderTile& rtile);
+
+	/* Finish writing the file, returns false if any tile failed to be
+	 * written or some tiles are missing because the render was canceled. */
+	bool close();
+
+	string error_message();
+
+protected:
+	/* Index of the tile in the file, row by row from the top. */
+	int tile_index(const RenderTile& rtile);
+
+	bool write_pending_tiles();
+	void set_error(const string& message);
+
+	ImageOutput *out;
+	string filepath;
+
+	BufferParams params;
+	int2 tile_size;
+	int num_tiles_x;
+	int num_tiles;
+	float exposure;
+
+	/* Passes written to the file with their number of channels. */
+	vector<PassType> pass_types;
+	vector<int> pass_channels;
+	int num_channels;
+
+	thread_mutex mutex;
+	int next_tile;
+	map<int, vector<float> > pending_tiles;
+	size_t max_pending_tiles;
+
+	string error;
+};
+
+CCL_NAMESPACE_END
+
+#endif /* __TILE_OUTPUT_H__ */
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+#include "render/background.h"
+#include "render/buffers.h"
+#include "render/camera.h"
+#include "render/graph.h"
+#include "render/light.h"
+#include "render/mesh.h"
+#include "render/nodes.h"
+#include "render/object.h"
+#include "render/scene.h"
+#include "render/session.h"
+#include "render/shader.h"
+#include "util/util_debug.h"
+#include "util/util_foreach.h"
+#include "util/util_math.h"
+#include "util/util_transform.h"
+#include "util/util_vector.h"
+
+/* Renders the same scene with the CPU ray stream mode on and off, comparing
+ * render times and checking that both give the same image. The scene is lit
+ * by a sun and uses AO, so camera, shadow and AO rays all go through packet
+ * traversal. */
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+const int width = 256;
+const int height = 256;
+const int samples = 16;
+/* Quads per side of the displaced grid. */
+const int grid_resolution = 256;
+
+DeviceInfo cpu_device_info()
+{
+	vector<DeviceInfo>& devices = Device::available_devices();
+	foreach(DeviceInfo& info, devices) {
+		if(info.type == DEVICE_CPU) {
+			return info;
+		}
+	}
+	return DeviceInfo();
+}
+
+void scene_add_grid(Scene *scene)
+{
+	Mesh *mesh = new Mesh();
+	const int num_verts = grid_resolution + 1;
+
+	mesh->used_shaders.push_back(scene->default_surface);
+	mesh->reserve_mesh(num_verts * num_verts, grid_resolution * grid_resolution * 2);
+
+	for(int y = 0; y < num_verts; y++) {
+		for(int x = 0; x < num_verts; x++) {
+			float u = (float)x / grid_resolution * 4.0f - 2.0f;
+			float v = (float)y / grid_resolution * 4.0f - 2.0f;
+			/* Bumps cast shadows on each other. */
+			float z = 0.2f * sinf(u * 4.0f) * cosf(v * 4.0f);
+			mesh->add_vertex(make_float3(u, v, z));
+		}
+	}
+
+	for(int y = 0; y < grid_resolution; y++) {
+		for(int x = 0; x < grid_resolution; x++) {
+			int v0 = y * num_verts + x;
+			int v1 = v0 + 1;
+			int v2 = v0 + num_verts;
+			int v3 = v2 + 1;
+			mesh->add_triangle(v0, v1, v3, 0, false);
+			mesh->add_triangle(v0, v3, v2, 0, false);
+		}
+	}
+
+	Object *object = new Object();
+	object->mesh = mesh;
+	object->tfm = transform_identity();
+
+	scene->meshes.push_back(mesh);
+	scene->objects.push_back(object);
+}
+
+void scene_add_sun(Scene *scene)
+{
+	ShaderGraph *graph = new ShaderGraph();
+	EmissionNode *emission = new EmissionNode();
+	emission->color = make_float3(1.0f, 1.0f, 1.0f);
+	emission->strength = 3.0f;
+	graph->add(emission);
+	graph->connect(emission->output("Emission"), graph->output()->input("Surface"));
+
+	Shader *shader = new Shader();
+	shader->name = "sun";
+	shader->set_graph(graph);
+	scene->shaders.push_back(shader);
+
+	Light *light = new Light();
+	light->type = LIGHT_DISTANT;
+	/* Low angle, so the bumps shadow each other. */
+	light->dir = normalize(make_float3(1.0f, 0.5f, 0.5f));
+	light->size = 0.0f;
+	light->shader = shader;
+	scene->lights.push_back(light);
+}
+
+/* Render the scene, returning the combined pass and the path tracing time. */
+double render(bool use_stream, vector<float>& pixels)
+{
+	SessionParams session_params;
+	session_params.device = cpu_device_info();
+	session_params.background = true;
+	session_params.samples = samples;
+	/* Needed to keep the render buffers, the image is never written. */
+	session_params.output_path = "render_stream_test.png";
+
+	Session *session = new Session(session_params);
+
+	Scene *scene = new Scene(SceneParams(), session_params.device);
+	scene_add_grid(scene);
+	scene_add_sun(scene);
+	scene->background->ao_factor = 0.5f;
+	scene->background->ao_distance = 0.5f;
+	scene->camera->width = width;
+	scene->camera->height = height;
+	scene->camera->matrix = transform_translate(0.0f, 0.0f, -5.0f);
+	scene->camera->compute_auto_viewplane();
+	session->scene = scene;
+
+	BufferParams buffer_params;
+	buffer_params.width = width;
+	buffer_params.height = height;
+	buffer_params.full_width = width;
+	buffer_params.full_height = height;
+
+	DebugFlags().cpu.stream = use_stream;
+
+	session->reset(buffer_params, samples);
+	session->start();
+	session->wait();
+
+	/* Render time without the scene update. */
+	double total_time, render_time;
+	session->progress.get_time(total_time, render_time);
+
+	DebugFlags().cpu.stream = false;
+
+	pixels.resize(width * height * 4);
+	session->buffers->copy_from_device();
+	EXPECT_TRUE(session->buffers->get_pass_rect(PASS_COMBINED, 1.0f, samples, 4, &pixels[0]));
+
+	session->params.output_path = "";
+	delete session;
+
+	return render_time;
+}
+
+}  // namespace
+
+TEST(render_stream, coherent_rays)
+{
+	vector<float> pixels, pixels_stream;
+
+	double time = render(false, pixels);
+	double time_stream = render(true, pixels_stream);
+
+	printf("%dx%d, %d samples: path trace %.4fs, ray stream %.4fs, %.2fx\n",
+	       width, height, samples, time, time_stream, time / time_stream);
+
+	/* Pixels are integrated in a different order, but with the same random
+	 * numbers, so only ties between equally close hits may differ. */
+	ASSERT_EQ(pixels.size(), pixels_stream.size());
+	int num_different = 0;
+	for(size_t i = 0; i < pixels.size(); i++) {
+		if(fabsf(pixels[i] - pixels_stream[i]) > 1e-4f) {
+			num_different++;
+		}
+	}
+	EXPECT_LE(num_different, (int)pixels.size() / 1000);
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "device/device.h"
+#include "render/attribute.h"
+#include "render/image.h"
+#include "render/mesh.h"
+#include "render/scene.h"
+#include "util/util_foreach.h"
+#include "util/util_function.h"
+#include "util/util_stats.h"
+#include "util/util_string.h"
+
+/* Copies a volume mesh from a per-frame scene into a persistent scene over
+ * two frames, the way frame sync in the standalone app does, and checks the
+ * voxel images end up owned by the persistent scene. */
+
+CCL_NAMESPACE_BEGIN
+
+namespace {
+
+DeviceInfo cpu_device_info()
+{
+	vector<DeviceInfo>& devices = Device::available_devices();
+	foreach(DeviceInfo& info, devices) {
+		if(info.type == DEVICE_CPU) {
+			return info;
+		}
+	}
+	return DeviceInfo();
+}
+
+/* Stands in for the smoke domain pointer of builtin volume images. */
+int volume_builtin_data;
+
+void volume_image_info(const string& /*filename*/,
+                       void * /*data*/,
+                       bool& is_float,
+                       int& width,
+                       int& height,
+                       int& depth,
+                       int& channels)
+{
+	is_float = true;
+	width = height = depth = 8;
+	channels = 1;
+}
+
+Scene *scene_create(Device *device)
+{
+	Scene *scene = new Scene(SceneParams(), device->info);
+	/* Lets the scene free its images on delete. */
+	scene->device = device;
+	scene->image_manager->builtin_image_info_cb = function_bind(&volume_image_info,
+	                                                            _1, _2, _3, _4,
+	                                                            _5, _6, _7);
+	return scene;
+}
+
+Mesh *scene_add_volume_mesh(Scene *scene, const string& filename)
+{
+	Mesh *mesh = new Mesh();
+	Attribute *attr = mesh->attributes.add(ATTR_STD_VOLUME_DENSITY);
+	VoxelAttribute *voxel = attr->data_voxel();
+	bool is_float, is_linear;
+
+	voxel->manager = scene->image_manager;
+	voxel->slot = scene->image_manager->add_image(filename,
+	                                              &volume_builtin_data,
+	                                              false,
+	                                              0.0f,
+	                                              is_float,
+	                                              is_linear,
+	                                              INTERPOLATION_LINEAR,
+	                                              EXTENSION_CLIP,
+	                                              true);
+	scene->meshes.push_back(mesh);
+	return mesh;
+}
+
+}  /* namespace */
+
+TEST(render_volume_sync, two_frames)
+{
+	DeviceInfo device_info = cpu_device_info();
+	Stats stats;
+	Device *device = Device::create(device_info, stats, true);
+	ASSERT_TRUE(device != NULL);
+
+	Scene *scene = scene_create(device);
+	Mesh *mesh = scene_add_volume_mesh(scene, "density_0");
+	int prev_slot = -1;
+
+	for(int frame = 0; frame < 2; frame++) {
+		const string filename = string_printf("density_%d", frame);
+		Scene *next = scene_create(device);
+		Mesh *next_mesh = scene_add_volume_mesh(next, filename);
+
+		mesh->clear();
+		mesh->attributes.attributes = next_mesh->attributes.attributes;
+		mesh->attributes.remap_voxel_images(scene->image_manager);
+
+		/* The next scene goes away before the frame renders. */
+		delete next;
+
+		Attribute *attr = mesh->attributes.find(ATTR_STD_VOLUME_DENSITY);
+		ASSERT_TRUE(attr != NULL);
+		VoxelAttribute *voxel = attr->data_voxel();
+		EXPECT_EQ(voxel->manager, scene->image_manager);
+		ASSERT_NE(voxel->slot, -1);
+
+		const ImageManager::Image *image = scene->image_manager->get_image(voxel->slot);
+		ASSERT_TRUE(image != NULL);
+		EXPECT_EQ(image->filename, filename);
+		EXPECT_EQ(image->builtin_data, &volume_builtin_data);
+		EXPECT_EQ(image->users, 1);
+
+		/* The previous frame's image has no users left. */
+		if(prev_slot != -1 && prev_slot != voxel->slot) {
+			const ImageManager::Image *prev_image =
+			        scene->image_manager->get_image(prev_slot);
+			ASSERT_TRUE(prev_image != NULL);
+			EXPECT_EQ(prev_image->users, 0);
+		}
+		prev_slot = voxel->slot;
+	}
+
+	delete scene;
+	delete device;
+}
+
+CCL_NAMESPACE_END
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "testing/testing.h"
+
+#include "util/util_sparse_grid.h"
+
+CCL_NAMESPACE_BEGIN
+
+static float sparse_grid_lookup(const vector<float>& sparse,
+                                const vector<int>& offsets,
+                                int width, int height,
+                                int x, int y, int z)
+{
+	const int tiled_width = sparse_grid_tile_res(width);
+	const int tiled_height = sparse_grid_tile_res(height);
+	const int tile = offsets[(x >> TEX_SPARSE_TILE_SHIFT) +
+	                         tiled_width*((y >> TEX_SPARSE_TILE_SHIFT) +
+	                                      tiled_height*(z >> TEX_SPARSE_TILE_SHIFT))];
+	const int index = (x & TEX_SPARSE_TILE_MASK) +
+	                  TEX_SPARSE_TILE_SIZE*((y & TEX_SPARSE_TILE_MASK) +
+	                                        TEX_SPARSE_TILE_SIZE*(z & TEX_SPARSE_TILE_MASK));
+	return sparse[tile + index];
+}
+
+TEST(util_sparse_grid, empty)
+{
+	vector<float> voxels(10*11*12, 0.0f);
+	vector<int> offsets;
+	size_t num = sparse_grid_create_offsets(&voxels[0], 10, 11, 12, &offsets);
+	EXPECT_EQ(TEX_SPARSE_TILE_VOXELS, num);
+	EXPECT_EQ(2*2*2, offsets.size());
+	for(size_t i = 0; i < offsets.size(); i++) {
+		EXPECT_EQ(SPARSE_GRID_EMPTY_TILE, offsets[i]);
+	}
+}
+
+TEST(util_sparse_grid, lookup_matches_dense)
+{
+	const int width = 19, height = 9, depth = 21;
+	vector<float> voxels(width*height*depth, 0.0f);
+	/* One voxel in a border tile and a small block in the middle. */
+	voxels[(depth - 1)*width*height + (height - 1)*width + width - 1] = 1.0f;
+	for(int z = 9; z < 12; z++) {
+		for(int y = 2; y < 4; y++) {
+			for(int x = 7; x < 10; x++) {
+				voxels[(z*height + y)*width + x] = (float)(x + y + z);
+			}
+		}
+	}
+
+	vector<int> offsets;
+	size_t num = sparse_grid_create_offsets(&voxels[0], width, height, depth, &offsets);
+	EXPECT_LT(num, voxels.size());
+
+	vector<float> sparse(num);
+	sparse_grid_copy_tiles(&voxels[0], width, height, depth, offsets, &sparse[0], num);
+
+	for(int z = 0; z < depth; z++) {
+		for(int y = 0; y < height; y++) {
+			for(int x = 0; x < width; x++) {
+				EXPECT_EQ(voxels[(z*height + y)*width + x],
+				          sparse_grid_lookup(sparse, offsets, width, height, x, y, z));
+			}
+		}
+	}
+}
+
+TEST(util_sparse_grid, use_sparse)
+{
+	EXPECT_FALSE(sparse_grid_use_sparse<float>(1000, 1000, 10));
+	EXPECT_TRUE(sparse_grid_use_sparse<float>(1000, 512, 10));
+}
+
+CCL_NAMESPACE_END
@@ -46,6 +46,10 @@ public:
 
 		/* Whether QBVH usage is allowed or not. */
 		bool qbvh;
+
+		/* Whether to trace camera, shadow and AO rays in packets,
+		 * see kernel_path_stream.h. */
+		bool stream;
 	};
 
 	/* Descriptor of CUDA feature-set to be used. */
@@ -24,6 +24,7 @@
  * except for the constructor/destructor are thread safe. */
 
 #include "util_function.h"
+#include "util_map.h"
 #include "util_string.h"
 #include "util_time.h"
 #include "util_thread.h"
@@ -40,6 +41,7 @@ public:
 		total_time = 0.0;
 		render_time = 0.0;
 		tile_time = 0.0;
+		update_time = 0.0;
 		status = "Initializing";
 		substatus = "";
 		sync_status = "";
@@ -78,6 +80,8 @@ public:
 		total_time = 0.0;
 		render_time = 0.0;
 		tile_time = 0.0;
+		update_time = 0.0;
+		shader_compile_times.clear();
 		status = "Initializing";
 		substatus = "";
 		sync_status = "";
@@ -179,6 +183,36 @@ public:
 		render_time_ = (render_time > 0.0)? render_time: 0.0;
 	}
 
+	/* time spent updating scene data on the device */
+	void add_update_time(double update_time_)
+	{
+		thread_scoped_lock lock(progress_mutex);
+
+		update_time += update_time_;
+	}
+
+	double get_update_time()
+	{
+		thread_scoped_lock lock(progress_mutex);
+
+		return update_time;
+	}
+
+	/* time spent compiling each shader, for the shaders compiled since reset */
+	void set_shader_compile_time(const string& name, double compile_time)
+	{
+		thread_scoped_lock lock(progress_mutex);
+
+		shader_compile_times[name] = compile_time;
+	}
+
+	void get_shader_compile_times(map<string, double>& compile_times)
+	{
+		thread_scoped_lock lock(progress_mutex);
+
+		compile_times = shader_compile_times;
+	}
+
 	void reset_sample()
 	{
 		thread_scoped_lock lock(progress_mutex);
@@ -298,6 +332,8 @@ protected:
 	double start_time, render_start_time;
 	double total_time, render_time;
 	double tile_time;
+	double update_time;
+	map<string, double> shader_compile_times;
 
 	string status;
 	string substatus;
@@ -0,0 +1,183 @@
+/*
+ * Copyright 2011-2016 Blender Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __UTIL_SPARSE_GRID_H__
+#define __UTIL_SPARSE_GRID_H__
+
+#include <limits.h>
+#include <string.h>
+
+#include "util_math.h"
+#include "util_texture.h"
+#include "util_types.h"
+#include "util_vector.h"
+
+/* Sparse Grid
+ *
+ * Volume textures such as smoke are mostly empty space. To avoid storing all
+ * those zeros, the voxels are grouped into tiles of TEX_SPARSE_TILE_SIZE^3,
+ * and only tiles that contain at least one non-zero voxel are stored. A grid
+ * of offsets with one entry per tile gives the index of the first voxel of the
+ * tile in the compacted voxel array.
+ *
+ * All empty tiles point to a single tile of zeros at the start of the voxel
+ * array, so lookups need no extra branch and sampling the sparse grid gives
+ * exactly the same result as sampling the dense one. */
+
+CCL_NAMESPACE_BEGIN
+
+/* Offset of the shared empty tile. */
+#define SPARSE_GRID_EMPTY_TILE 0
+
+/* Number of tiles needed to cover the given number of voxels. */
+static inline int sparse_grid_tile_res(int res)
+{
+	return (res + TEX_SPARSE_TILE_MASK) >> TEX_SPARSE_TILE_SHIFT;
+}
+
+static inline bool sparse_grid_voxel_is_zero(float v)
+{
+	return v == 0.0f;
+}
+
+static inline bool sparse_grid_voxel_is_zero(const float4& v)
+{
+	return v.x == 0.0f && v.y == 0.0f && v.z == 0.0f && v.w == 0.0f;
+}
+
+template<typename T>
+static bool sparse_grid_tile_is_zero(const T *voxels,
+                                     int width, int height, int depth,
+                                     int tile_x, int tile_y, int tile_z)
+{
+	const int x0 = tile_x << TEX_SPARSE_TILE_SHIFT;
+	const int y0 = tile_y << TEX_SPARSE_TILE_SHIFT;
+	const int z0 = tile_z << TEX_SPARSE_TILE_SHIFT;
+	const int x1 = min(x0 + TEX_SPARSE_TILE_SIZE, width);
+	const int y1 = min(y0 + TEX_SPARSE_TILE_SIZE, height);
+	const int z1 = min(z0 + TEX_SPARSE_TILE_SIZE, depth);
+
+	for(int z = z0; z < z1; z++) {
+		for(int y = y0; y < y1; y++) {
+			const T *row = voxels + ((size_t)z*height + y)*width;
+			for(int x = x0; x < x1; x++) {
+				if(!sparse_grid_voxel_is_zero(row[x])) {
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+/* Fill in the offsets grid for a dense voxel array. Returns the number of
+ * voxels needed for the sparse array, including the shared empty tile. */
+template<typename T>
+size_t sparse_grid_create_offsets(const T *voxels,
+                                  int width, int height, int depth,
+                                  vector<int> *offsets)
+{
+	const int tiled_width = sparse_grid_tile_res(width);
+	const int tiled_height = sparse_grid_tile_res(height);
+	const int tiled_depth = sparse_grid_tile_res(depth);
+
+	offsets->resize((size_t)tiled_width * tiled_height * tiled_depth);
+
+	size_t num_voxels = TEX_SPARSE_TILE_VOXELS;
+	size_t tile = 0;
+
+	for(int z = 0; z < tiled_depth; z++) {
+		for(int y = 0; y < tiled_height; y++) {
+			for(int x = 0; x < tiled_width; x++, tile++) {
+				if(sparse_grid_tile_is_zero(voxels, width, height, depth, x, y, z)) {
+					(*offsets)[tile] = SPARSE_GRID_EMPTY_TILE;
+				}
+				else {
+					(*offsets)[tile] = (int)num_voxels;
+					num_voxels += TEX_SPARSE_TILE_VOXELS;
+				}
+			}
+		}
+	}
+
+	return num_voxels;
+}
+
+/* Copy the non-empty tiles of a dense voxel array into the sparse array.
+ * Tiles crossing the border of the grid are padded with zeros. */
+template<typename T>
+void sparse_grid_copy_tiles(const T *voxels,
+                            int width, int height, int depth,
+                            const vector<int>& offsets,
+                            T *sparse_voxels,
+                            size_t num_sparse_voxels)
+{
+	const int tiled_width = sparse_grid_tile_res(width);
+	const int tiled_height = sparse_grid_tile_res(height);
+	const int tiled_depth = sparse_grid_tile_res(depth);
+
+	memset(sparse_voxels, 0, sizeof(T) * num_sparse_voxels);
+
+	size_t tile = 0;
+
+	for(int tz = 0; tz < tiled_depth; tz++) {
+		for(int ty = 0; ty < tiled_height; ty++) {
+			for(int tx = 0; tx < tiled_width; tx++, tile++) {
+				if(offsets[tile] == SPARSE_GRID_EMPTY_TILE) {
+					continue;
+				}
+
+				T *tile_voxels = sparse_voxels + offsets[tile];
+				const int x0 = tx << TEX_SPARSE_TILE_SHIFT;
+				const int y0 = ty << TEX_SPARSE_TILE_SHIFT;
+				const int z0 = tz << TEX_SPARSE_TILE_SHIFT;
+				const int num_x = min(TEX_SPARSE_TILE_SIZE, width - x0);
+				const int num_y = min(TEX_SPARSE_TILE_SIZE, height - y0);
+				const int num_z = min(TEX_SPARSE_TILE_SIZE, depth - z0);
+
+				for(int z = 0; z < num_z; z++) {
+					for(int y = 0; y < num_y; y++) {
+						const T *row = voxels + ((size_t)(z0 + z)*height + y0 + y)*width + x0;
+						T *tile_row = tile_voxels + (z*TEX_SPARSE_TILE_SIZE + y)*TEX_SPARSE_TILE_SIZE;
+						memcpy(tile_row, row, sizeof(T) * num_x);
+					}
+				}
+			}
+		}
+	}
+}
+
+/* Check if storing the voxels sparse is worth the extra lookup, it should
+ * save at least a quarter of the memory. */
+template<typename T>
+bool sparse_grid_use_sparse(size_t num_dense_voxels,
+                            size_t num_sparse_voxels,
+                            size_t num_tiles)
+{
+	if(num_sparse_voxels > (size_t)INT_MAX) {
+		return false;
+	}
+
+	const size_t dense_size = sizeof(T) * num_dense_voxels;
+	const size_t sparse_size = sizeof(T) * num_sparse_voxels + sizeof(int) * num_tiles;
+
+	return sparse_size < dense_size - dense_size / 4;
+}
+
+CCL_NAMESPACE_END
+
+#endif /* __UTIL_SPARSE_GRID_H__ */
@@ -206,6 +206,11 @@ extern const char *(*MEM_name_ptr)(void *vmemh);
 /* Switch allocator to slower but fully guarded mode. */
 void MEM_use_guarded_allocator(void);
 
+/* Switch allocator to a mode which caches small blocks per thread, for heavily
+ * multi-threaded allocations. Like the guarded mode it must be set before any
+ * allocation, it does nothing on platforms without thread local storage. */
+void MEM_use_threadcache_allocator(void);
+
 #ifdef __cplusplus
 /* alloc funcs for C++ only */
 #define MEM_CXX_CLASS_ALLOC_FUNCS(_id)                                        \
@@ -128,3 +128,37 @@ void MEM_use_guarded_allocator(void)
 	MEM_name_ptr = MEM_guarded_name_ptr;
 #endif
 }
+
+void MEM_use_threadcache_allocator(void)
+{
+#ifdef WITH_MEM_THREADCACHE
+	MEM_threadcache_init();
+
+	MEM_allocN_len = MEM_threadcache_allocN_len;
+	MEM_freeN = MEM_threadcache_freeN;
+	MEM_dupallocN = MEM_threadcache_dupallocN;
+	MEM_reallocN_id = MEM_threadcache_reallocN_id;
+	MEM_recallocN_id = MEM_threadcache_recallocN_id;
+	MEM_callocN = MEM_threadcache_callocN;
+	MEM_mallocN = MEM_threadcache_mallocN;
+	MEM_mallocN_aligned = MEM_threadcache_mallocN_aligned;
+	MEM_mapallocN = MEM_threadcache_mapallocN;
+	MEM_printmemlist_pydict = MEM_threadcache_printmemlist_pydict;
+	MEM_printmemlist = MEM_threadcache_printmemlist;
+	MEM_callbackmemlist = MEM_threadcache_callbackmemlist;
+	MEM_printmemlist_stats = MEM_threadcache_printmemlist_stats;
+	MEM_set_error_callback = MEM_threadcache_set_error_callback;
+	MEM_check_memory_integrity = MEM_threadcache_check_memory_integrity;
+	MEM_set_lock_callback = MEM_threadcache_set_lock_callback;
+	MEM_set_memory_debug = MEM_threadcache_set_memory_debug;
+	MEM_get_memory_in_use = MEM_threadcache_get_memory_in_use;
+	MEM_get_mapped_memory_in_use = MEM_threadcache_get_mapped_memory_in_use;
+	MEM_get_memory_blocks_in_use = MEM_threadcache_get_memory_blocks_in_use;
+	MEM_reset_peak_memory = MEM_threadcache_reset_peak_memory;
+	MEM_get_peak_memory = MEM_threadcache_get_peak_memory;
+
+#ifndef NDEBUG
+	MEM_name_ptr = MEM_threadcache_name_ptr;
+#endif
+#endif  /* WITH_MEM_THREADCACHE */
+}
@@ -120,6 +120,11 @@
 /* Real pointer returned by the malloc or aligned_alloc. */
 #define MEMHEAD_REAL_PTR(memh) ((char *)memh - MEMHEAD_ALIGN_PADDING(memh->alignment))
 
+/* Thread caching allocator needs thread local storage. */
+#if !defined(WIN32)
+#  define WITH_MEM_THREADCACHE
+#endif
+
 void *aligned_malloc(size_t size, size_t alignment);
 void aligned_free(void *ptr);
 
@@ -177,4 +182,34 @@ size_t MEM_guarded_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
 const char *MEM_guarded_name_ptr(void *vmemh);
 #endif
 
+/* Prototypes for thread caching allocator functions */
+#ifdef WITH_MEM_THREADCACHE
+void MEM_threadcache_init(void);
+size_t MEM_threadcache_allocN_len(const void *vmemh) ATTR_WARN_UNUSED_RESULT;
+void MEM_threadcache_freeN(void *vmemh);
+void *MEM_threadcache_dupallocN(const void *vmemh) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void *MEM_threadcache_reallocN_id(void *vmemh, size_t len, const char *UNUSED(str))  ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(2);
+void *MEM_threadcache_recallocN_id(void *vmemh, size_t len, const char *UNUSED(str))  ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(2);
+void *MEM_threadcache_callocN(size_t len, const char *UNUSED(str))  ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *MEM_threadcache_mallocN(size_t len, const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void *MEM_threadcache_mallocN_aligned(size_t len, size_t alignment, const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1) ATTR_NONNULL(3);
+void *MEM_threadcache_mapallocN(size_t len, const char *UNUSED(str)) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_ALLOC_SIZE(1) ATTR_NONNULL(2);
+void MEM_threadcache_printmemlist_pydict(void);
+void MEM_threadcache_printmemlist(void);
+void MEM_threadcache_callbackmemlist(void (*func)(void *));
+void MEM_threadcache_printmemlist_stats(void);
+void MEM_threadcache_set_error_callback(void (*func)(const char *));
+bool MEM_threadcache_check_memory_integrity(void);
+void MEM_threadcache_set_lock_callback(void (*lock)(void), void (*unlock)(void));
+void MEM_threadcache_set_memory_debug(void);
+size_t MEM_threadcache_get_memory_in_use(void);
+size_t MEM_threadcache_get_mapped_memory_in_use(void);
+unsigned int MEM_threadcache_get_memory_blocks_in_use(void);
+void MEM_threadcache_reset_peak_memory(void);
+size_t MEM_threadcache_get_peak_memory(void) ATTR_WARN_UNUSED_RESULT;
+#ifndef NDEBUG
+const char *MEM_threadcache_name_ptr(void *vmemh);
+#endif
+#endif  /* WITH_MEM_THREADCACHE */
+
 #endif  /* __MALLOCN_INTERN_H__ */
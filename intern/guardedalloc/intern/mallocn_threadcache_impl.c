@@ -0,0 +1,872 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file guardedalloc/intern/mallocn_threadcache_impl.c
+ *  \ingroup MEM
+ *
+ * Memory allocation which keeps small blocks in per-thread caches.
+ *
+ * Small blocks are rounded up to a size class and recycled through free lists
+ * owned by the thread which allocated them, so most allocations and frees don't
+ * touch any shared state. Blocks freed by another thread are collected by that
+ * thread and handed back to the owner in batches, with a single atomic operation.
+ *
+ * Memory counters are kept per thread and only added to the global counters
+ * once they changed by more than #MEM_THREAD_STATS_FLUSH, so while threads are
+ * allocating the peak memory can be off by that much per thread. Totals are
+ * exact once the threads are done.
+ */
+
+#include <stdlib.h>
+#include <string.h> /* memcpy */
+#include <stdarg.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "MEM_guardedalloc.h"
+
+/* to ensure strict conversions */
+#include "../../source/blender/blenlib/BLI_strict_flags.h"
+
+#include "atomic_ops.h"
+#include "mallocn_intern.h"
+
+#ifdef WITH_MEM_THREADCACHE
+
+#include <pthread.h>
+
+typedef struct MemThreadCache MemThreadCache;
+
+typedef struct MemHead {
+	/* Cache of the thread which allocated the block, NULL for large blocks. */
+	MemThreadCache *cache;
+	/* Length of allocated memory block. */
+	size_t len;
+} MemHead;
+
+typedef struct MemHeadAligned {
+	short alignment;
+	size_t len;
+} MemHeadAligned;
+
+/* Unused small block, the link is stored in the data of the block. */
+typedef struct MemFreeBlock {
+	MemHead head;
+	struct MemFreeBlock *next;
+} MemFreeBlock;
+
+/* Number of size classes: steps of 16 bytes up to 128 bytes,
+ * then four classes for each power of two up to 2048 bytes. */
+#define MEM_SIZE_CLASSES 24
+/* Largest block kept in the thread caches. */
+#define MEM_SIZE_CLASS_MAX 2048
+/* Memory kept in the free list of a single size class, at least #MEM_FREE_BLOCKS_MIN blocks. */
+#define MEM_THREAD_CACHE_SIZE (64 * 1024)
+#define MEM_FREE_BLOCKS_MIN 16
+/* Number of blocks freed by a thread which doesn't own them, before handing them back. */
+#define MEM_REMOTE_BATCH 32
+/* Changes of the per-thread counters before adding them to the global counters. */
+#define MEM_THREAD_STATS_FLUSH (256 * 1024)
+#define MEM_THREAD_BLOCKS_FLUSH 1024
+
+static const size_t size_classes[MEM_SIZE_CLASSES] = {
+	16, 32, 48, 64, 80, 96, 112, 128,
+	160, 192, 224, 256,
+	320, 384, 448, 512,
+	640, 768, 896, 1024,
+	1280, 1536, 1792, 2048,
+};
+
+struct MemThreadCache {
+	MemFreeBlock *free[MEM_SIZE_CLASSES];
+	unsigned int free_num[MEM_SIZE_CLASSES];
+
+	/* Blocks of this cache freed by other threads, pushed atomically
+	 * and taken all at once by the owner. */
+	MemFreeBlock *remote;
+
+	/* Blocks of another cache freed by this thread, not handed back yet. */
+	MemThreadCache *pending_cache;
+	MemFreeBlock *pending_first, *pending_last;
+	unsigned int pending_num;
+
+	/* Changes of the memory counters not added to the global counters yet. */
+	ptrdiff_t mem_delta;
+	int blocks_delta;
+
+	/* Caches are never freed, a cache of a finished thread is reused by the next new thread. */
+	unsigned int in_use;
+	MemThreadCache *next;
+};
+
+static unsigned int totblock = 0;
+static size_t mem_in_use = 0, mmap_in_use = 0, peak_mem = 0;
+static bool malloc_debug_memset = false;
+
+static void (*error_callback)(const char *) = NULL;
+
+static MemThreadCache *thread_caches = NULL;
+static pthread_key_t thread_cache_key;
+static bool thread_cache_key_created = false;
+static __thread MemThreadCache *thread_cache = NULL;
+
+enum {
+	MEMHEAD_MMAP_FLAG = 1,
+	MEMHEAD_ALIGN_FLAG = 2,
+};
+
+#define MEMHEAD_FROM_PTR(ptr) (((MemHead*) vmemh) - 1)
+#define PTR_FROM_MEMHEAD(memhead) (memhead + 1)
+#define MEMHEAD_ALIGNED_FROM_PTR(ptr) (((MemHeadAligned*) vmemh) - 1)
+#define MEMHEAD_IS_MMAP(memhead) ((memhead)->len & (size_t) MEMHEAD_MMAP_FLAG)
+#define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & (size_t) MEMHEAD_ALIGN_FLAG)
+#define MEMHEAD_LEN(memhead) ((memhead)->len & ~((size_t) (MEMHEAD_MMAP_FLAG | MEMHEAD_ALIGN_FLAG)))
+
+MEM_INLINE void update_maximum(size_t *maximum_value, size_t value)
+{
+	size_t prev_value = *maximum_value;
+	while (prev_value < value) {
+		const size_t orig_value = atomic_cas_z(maximum_value, prev_value, value);
+		if (orig_value == prev_value) {
+			break;
+		}
+		prev_value = orig_value;
+	}
+}
+
+#ifdef __GNUC__
+__attribute__ ((format(printf, 1, 2)))
+#endif
+static void print_error(const char *str, ...)
+{
+	char buf[512];
+	va_list ap;
+
+	va_start(ap, str);
+	vsnprintf(buf, sizeof(buf), str, ap);
+	va_end(ap);
+	buf[sizeof(buf) - 1] = '\0';
+
+	if (error_callback) {
+		error_callback(buf);
+	}
+}
+
+MEM_INLINE unsigned int size_class_index(size_t len)
+{
+	size_t len_1, bit;
+
+	if (len <= 128) {
+		return (len != 0) ? (unsigned int)((len - 1) >> 4) : 0;
+	}
+
+	/* Highest bit of (len - 1), four classes between each power of two. */
+	len_1 = len - 1;
+#ifdef __GNUC__
+	bit = (sizeof(unsigned long) * 8 - 1) - (size_t)__builtin_clzl((unsigned long)len_1);
+#else
+	for (bit = 7; (len_1 >> (bit + 1)) != 0; bit++) {
+		/* pass */
+	}
+#endif
+	return (unsigned int)(8 + (bit - 7) * 4 + ((len_1 - ((size_t)1 << bit)) >> (bit - 2)));
+}
+
+/* -------------------------------------------------------------------- */
+/* Memory counters */
+
+static void thread_cache_flush_stats(MemThreadCache *cache)
+{
+	if (cache->mem_delta != 0 || cache->blocks_delta != 0) {
+		const size_t mem = atomic_add_z(&mem_in_use, (size_t)cache->mem_delta);
+		atomic_add_u(&totblock, (unsigned int)cache->blocks_delta);
+		if (cache->mem_delta > 0) {
+			update_maximum(&peak_mem, mem);
+		}
+		cache->mem_delta = 0;
+		cache->blocks_delta = 0;
+	}
+}
+
+MEM_INLINE void stats_add(MemThreadCache *cache, size_t len)
+{
+	if (LIKELY(cache)) {
+		cache->mem_delta += (ptrdiff_t)len;
+		cache->blocks_delta++;
+		if (UNLIKELY(cache->mem_delta > MEM_THREAD_STATS_FLUSH ||
+		             cache->blocks_delta > MEM_THREAD_BLOCKS_FLUSH))
+		{
+			thread_cache_flush_stats(cache);
+		}
+	}
+	else {
+		atomic_add_u(&totblock, 1);
+		update_maximum(&peak_mem, atomic_add_z(&mem_in_use, len));
+	}
+}
+
+MEM_INLINE void stats_sub(MemThreadCache *cache, size_t len)
+{
+	if (LIKELY(cache)) {
+		cache->mem_delta -= (ptrdiff_t)len;
+		cache->blocks_delta--;
+		if (UNLIKELY(cache->mem_delta < -MEM_THREAD_STATS_FLUSH ||
+		             cache->blocks_delta < -MEM_THREAD_BLOCKS_FLUSH))
+		{
+			thread_cache_flush_stats(cache);
+		}
+	}
+	else {
+		atomic_sub_u(&totblock, 1);
+		atomic_sub_z(&mem_in_use, len);
+	}
+}
+
+/* -------------------------------------------------------------------- */
+/* Thread caches */
+
+static void thread_cache_free_local(MemThreadCache *cache, MemFreeBlock *block, const unsigned int index)
+{
+	block->next = cache->free[index];
+	cache->free[index] = block;
+	cache->free_num[index]++;
+
+	if (UNLIKELY(cache->free_num[index] > MEM_FREE_BLOCKS_MIN &&
+	             cache->free_num[index] > MEM_THREAD_CACHE_SIZE / size_classes[index]))
+	{
+		/* Return half of the blocks to the system. */
+		const unsigned int keep = cache->free_num[index] / 2;
+		MemFreeBlock *last = cache->free[index];
+		unsigned int i;
+
+		for (i = 1; i < keep; i++) {
+			last = last->next;
+		}
+		block = last->next;
+		last->next = NULL;
+		cache->free_num[index] = keep;
+
+		while (block) {
+			MemFreeBlock *next = block->next;
+			free(block);
+			block = next;
+		}
+	}
+}
+
+/* Hand the blocks freed by this thread back to the thread owning them. */
+static void thread_cache_flush_pending(MemThreadCache *cache)
+{
+	MemThreadCache *owner = cache->pending_cache;
+	size_t head;
+
+	if (cache->pending_num == 0) {
+		return;
+	}
+
+	do {
+		head = (size_t)owner->remote;
+		cache->pending_last->next = (MemFreeBlock *)head;
+	} while (atomic_cas_z((size_t *)&owner->remote, head, (size_t)cache->pending_first) != head);
+
+	cache->pending_cache = NULL;
+	cache->pending_first = cache->pending_last = NULL;
+	cache->pending_num = 0;
+}
+
+static void thread_cache_free_remote(MemThreadCache *cache, MemFreeBlock *block)
+{
+	if (cache->pending_cache != block->head.cache) {
+		thread_cache_flush_pending(cache);
+		cache->pending_cache = block->head.cache;
+	}
+
+	block->next = cache->pending_first;
+	if (cache->pending_first == NULL) {
+		cache->pending_last = block;
+	}
+	cache->pending_first = block;
+
+	if (++cache->pending_num >= MEM_REMOTE_BATCH) {
+		thread_cache_flush_pending(cache);
+	}
+}
+
+/* Move the blocks freed by other threads into the free lists. */
+static void thread_cache_take_remote(MemThreadCache *cache)
+{
+	MemFreeBlock *block;
+	size_t head;
+
+	do {
+		head = (size_t)cache->remote;
+	} while (atomic_cas_z((size_t *)&cache->remote, head, 0) != head);
+
+	for (block = (MemFreeBlock *)head; block; ) {
+		MemFreeBlock *next = block->next;
+		thread_cache_free_local(cache, block, size_class_index(block->head.len));
+		block = next;
+	}
+}
+
+static void thread_cache_exit(void *vcache)
+{
+	MemThreadCache *cache = vcache;
+	unsigned int i;
+
+	thread_cache_flush_pending(cache);
+	thread_cache_flush_stats(cache);
+	thread_cache_take_remote(cache);
+
+	for (i = 0; i < MEM_SIZE_CLASSES; i++) {
+		MemFreeBlock *block = cache->free[i];
+		while (block) {
+			MemFreeBlock *next = block->next;
+			free(block);
+			block = next;
+		}
+		cache->free[i] = NULL;
+		cache->free_num[i] = 0;
+	}
+
+	thread_cache = NULL;
+	atomic_cas_u(&cache->in_use, 1, 0);
+}
+
+static MemThreadCache *thread_cache_get(void)
+{
+	MemThreadCache *cache = thread_cache;
+	size_t head;
+
+	if (LIKELY(cache)) {
+		return cache;
+	}
+
+	for (cache = thread_caches; cache; cache = cache->next) {
+		if (cache->in_use == 0 && atomic_cas_u(&cache->in_use, 0, 1) == 0) {
+			break;
+		}
+	}
+
+	if (cache == NULL) {
+		cache = calloc(1, sizeof(MemThreadCache));
+		if (UNLIKELY(cache == NULL)) {
+			/* Allocate without caching. */
+			return NULL;
+		}
+		cache->in_use = 1;
+		do {
+			head = (size_t)thread_caches;
+			cache->next = (MemThreadCache *)head;
+		} while (atomic_cas_z((size_t *)&thread_caches, head, (size_t)cache) != head);
+	}
+
+	thread_cache = cache;
+	pthread_setspecific(thread_cache_key, cache);
+	return cache;
+}
+
+void MEM_threadcache_init(void)
+{
+	if (!thread_cache_key_created) {
+		pthread_key_create(&thread_cache_key, thread_cache_exit);
+		thread_cache_key_created = true;
+	}
+}
+
+/* -------------------------------------------------------------------- */
+/* Allocation */
+
+static void *mem_alloc(size_t len, const bool clear)
+{
+	MemThreadCache *cache = thread_cache_get();
+	MemHead *memh;
+
+	len = SIZET_ALIGN_4(len);
+
+	if (LIKELY(cache && len <= MEM_SIZE_CLASS_MAX)) {
+		const unsigned int index = size_class_index(len);
+		MemFreeBlock *block = cache->free[index];
+
+		if (block == NULL && cache->remote != NULL) {
+			thread_cache_take_remote(cache);
+			block = cache->free[index];
+		}
+
+		if (block) {
+			cache->free[index] = block->next;
+			cache->free_num[index]--;
+			memh = &block->head;
+			if (clear) {
+				memset(memh + 1, 0, len);
+			}
+		}
+		else {
+			memh = clear ? calloc(1, size_classes[index] + sizeof(MemHead)) :
+			               malloc(size_classes[index] + sizeof(MemHead));
+		}
+
+		if (UNLIKELY(memh == NULL)) {
+			return NULL;
+		}
+		memh->cache = cache;
+	}
+	else {
+		memh = clear ? calloc(1, len + sizeof(MemHead)) : malloc(len + sizeof(MemHead));
+
+		if (UNLIKELY(memh == NULL)) {
+			return NULL;
+		}
+		memh->cache = NULL;
+	}
+
+	if (UNLIKELY(malloc_debug_memset && len && !clear)) {
+		memset(memh + 1, 255, len);
+	}
+
+	memh->len = len;
+	stats_add(cache, len);
+
+	return PTR_FROM_MEMHEAD(memh);
+}
+
+size_t MEM_threadcache_allocN_len(const void *vmemh)
+{
+	if (vmemh) {
+		return MEMHEAD_LEN(MEMHEAD_FROM_PTR(vmemh));
+	}
+	else {
+		return 0;
+	}
+}
+
+void MEM_threadcache_freeN(void *vmemh)
+{
+	MemThreadCache *cache;
+	MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+	size_t len = MEM_threadcache_allocN_len(vmemh);
+
+	if (vmemh == NULL) {
+		print_error("Attempt to free NULL pointer\n");
+#ifdef WITH_ASSERT_ABORT
+		abort();
+#endif
+		return;
+	}
+
+	if (UNLIKELY(MEMHEAD_IS_MMAP(memh))) {
+		atomic_sub_u(&totblock, 1);
+		atomic_sub_z(&mem_in_use, len);
+		atomic_sub_z(&mmap_in_use, len);
+		if (munmap(memh, len + sizeof(MemHead)))
+			printf("Couldn't unmap memory\n");
+		return;
+	}
+
+	cache = thread_cache_get();
+	stats_sub(cache, len);
+
+	if (UNLIKELY(malloc_debug_memset && len)) {
+		memset(memh + 1, 255, len);
+	}
+
+	if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+		MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+		aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
+	}
+	else if (memh->cache == NULL) {
+		free(memh);
+	}
+	else if (LIKELY(memh->cache == cache)) {
+		thread_cache_free_local(cache, (MemFreeBlock *)memh, size_class_index(len));
+	}
+	else if (cache) {
+		thread_cache_free_remote(cache, (MemFreeBlock *)memh);
+	}
+	else {
+		/* No cache to batch the block, hand it back right away. */
+		MemThreadCache *owner = memh->cache;
+		MemFreeBlock *block = (MemFreeBlock *)memh;
+		size_t head;
+
+		do {
+			head = (size_t)owner->remote;
+			block->next = (MemFreeBlock *)head;
+		} while (atomic_cas_z((size_t *)&owner->remote, head, (size_t)block) != head);
+	}
+}
+
+void *MEM_threadcache_dupallocN(const void *vmemh)
+{
+	void *newp = NULL;
+	if (vmemh) {
+		MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+		const size_t prev_size = MEM_allocN_len(vmemh);
+		if (UNLIKELY(MEMHEAD_IS_MMAP(memh))) {
+			newp = MEM_threadcache_mapallocN(prev_size, "dupli_mapalloc");
+		}
+		else if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
+			MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+			newp = MEM_threadcache_mallocN_aligned(
+				prev_size,
+				(size_t)memh_aligned->alignment,
+				"dupli_malloc");
+		}
+		else {
+			newp = MEM_threadcache_mallocN(prev_size, "dupli_malloc");
+		}
+		memcpy(newp, vmemh, prev_size);
+	}
+	return newp;
+}
+
+/* Resize a small block without moving it, when the size class doesn't change. */
+static bool mem_resize_in_place(void *vmemh, size_t len)
+{
+	MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+	MemThreadCache *cache;
+	const size_t old_len = memh->len;
+
+	if (MEMHEAD_IS_ALIGNED(memh) || MEMHEAD_IS_MMAP(memh) || memh->cache == NULL) {
+		return false;
+	}
+
+	len = SIZET_ALIGN_4(len);
+	if (len > MEM_SIZE_CLASS_MAX || size_class_index(len) != size_class_index(old_len)) {
+		return false;
+	}
+
+	cache = thread_cache_get();
+	stats_sub(cache, old_len);
+	stats_add(cache, len);
+	memh->len = len;
+
+	return true;
+}
+
+void *MEM_threadcache_reallocN_id(void *vmemh, size_t len, const char *str)
+{
+	void *newp = NULL;
+
+	if (vmemh) {
+		MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+		size_t old_len = MEM_allocN_len(vmemh);
+
+		if (mem_resize_in_place(vmemh, len)) {
+			return vmemh;
+		}
+
+		if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+			newp = MEM_threadcache_mallocN(len, "realloc");
+		}
+		else {
+			MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+			newp = MEM_threadcache_mallocN_aligned(
+				len,
+				(size_t)memh_aligned->alignment,
+				"realloc");
+		}
+
+		if (newp) {
+			if (len < old_len) {
+				/* shrink */
+				memcpy(newp, vmemh, len);
+			}
+			else {
+				/* grow (or remain same size) */
+				memcpy(newp, vmemh, old_len);
+			}
+		}
+
+		MEM_threadcache_freeN(vmemh);
+	}
+	else {
+		newp = MEM_threadcache_mallocN(len, str);
+	}
+
+	return newp;
+}
+
+void *MEM_threadcache_recallocN_id(void *vmemh, size_t len, const char *str)
+{
+	void *newp = NULL;
+
+	if (vmemh) {
+		MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
+		size_t old_len = MEM_allocN_len(vmemh);
+
+		if (mem_resize_in_place(vmemh, len)) {
+			if (len > old_len) {
+				/* zero new bytes */
+				memset(((char *)vmemh) + old_len, 0, len - old_len);
+			}
+			return vmemh;
+		}
+
+		if (LIKELY(!MEMHEAD_IS_ALIGNED(memh))) {
+			newp = MEM_threadcache_mallocN(len, "recalloc");
+		}
+		else {
+			MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+			newp = MEM_threadcache_mallocN_aligned(len,
+			                                       (size_t)memh_aligned->alignment,
+			                                       "recalloc");
+		}
+
+		if (newp) {
+			if (len < old_len) {
+				/* shrink */
+				memcpy(newp, vmemh, len);
+			}
+			else {
+				memcpy(newp, vmemh, old_len);
+
+				if (len > old_len) {
+					/* grow */
+					/* zero new bytes */
+					memset(((char *)newp) + old_len, 0, len - old_len);
+				}
+			}
+		}
+
+		MEM_threadcache_freeN(vmemh);
+	}
+	else {
+		newp = MEM_threadcache_callocN(len, str);
+	}
+
+	return newp;
+}
+
+void *MEM_threadcache_callocN(size_t len, const char *str)
+{
+	void *ptr = mem_alloc(len, true);
+
+	if (LIKELY(ptr)) {
+		return ptr;
+	}
+	print_error("Calloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+	            SIZET_ARG(len), str, (unsigned int) mem_in_use);
+	return NULL;
+}
+
+void *MEM_threadcache_mallocN(size_t len, const char *str)
+{
+	void *ptr = mem_alloc(len, false);
+
+	if (LIKELY(ptr)) {
+		return ptr;
+	}
+	print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+	            SIZET_ARG(len), str, (unsigned int) mem_in_use);
+	return NULL;
+}
+
+void *MEM_threadcache_mallocN_aligned(size_t len, size_t alignment, const char *str)
+{
+	MemHeadAligned *memh;
+
+	/* It's possible that MemHead's size is not properly aligned,
+	 * do extra padding to deal with this.
+	 *
+	 * We only support small alignments which fits into short in
+	 * order to save some bits in MemHead structure.
+	 */
+	size_t extra_padding = MEMHEAD_ALIGN_PADDING(alignment);
+
+	/* Huge alignment values doesn't make sense and they
+	 * wouldn't fit into 'short' used in the MemHead.
+	 */
+	assert(alignment < 1024);
+
+	/* We only support alignment to a power of two. */
+	assert(IS_POW2(alignment));
+
+	len = SIZET_ALIGN_4(len);
+
+	memh = (MemHeadAligned *)aligned_malloc(
+		len + extra_padding + sizeof(MemHeadAligned), alignment);
+
+	if (LIKELY(memh)) {
+		/* We keep padding in the beginning of MemHead,
+		 * this way it's always possible to get MemHead
+		 * from the data pointer.
+		 */
+		memh = (MemHeadAligned *)((char *)memh + extra_padding);
+
+		if (UNLIKELY(malloc_debug_memset && len)) {
+			memset(memh + 1, 255, len);
+		}
+
+		memh->len = len | (size_t) MEMHEAD_ALIGN_FLAG;
+		memh->alignment = (short) alignment;
+		stats_add(thread_cache_get(), len);
+
+		return PTR_FROM_MEMHEAD(memh);
+	}
+	print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
+	            SIZET_ARG(len), str, (unsigned int) mem_in_use);
+	return NULL;
+}
+
+void *MEM_threadcache_mapallocN(size_t len, const char *str)
+{
+	MemHead *memh;
+
+	/* on 64 bit, simply use calloc instead, as mmap does not support
+	 * allocating > 4 GB on Windows. the only reason mapalloc exists
+	 * is to get around address space limitations in 32 bit OSes. */
+	if (sizeof(void *) >= 8)
+		return MEM_threadcache_callocN(len, str);
+
+	len = SIZET_ALIGN_4(len);
+
+	memh = mmap(NULL, len + sizeof(MemHead),
+	            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+
+	if (memh != (MemHead *)-1) {
+		memh->cache = NULL;
+		memh->len = len | (size_t) MEMHEAD_MMAP_FLAG;
+		atomic_add_u(&totblock, 1);
+		atomic_add_z(&mmap_in_use, len);
+		update_maximum(&peak_mem, atomic_add_z(&mem_in_use, len));
+
+		return PTR_FROM_MEMHEAD(memh);
+	}
+	print_error("Mapalloc returns null, fallback to regular malloc: "
+	            "len=" SIZET_FORMAT " in %s, total %u\n",
+	            SIZET_ARG(len), str, (unsigned int) mmap_in_use);
+	return MEM_threadcache_callocN(len, str);
+}
+
+void MEM_threadcache_printmemlist_pydict(void)
+{
+}
+
+void MEM_threadcache_printmemlist(void)
+{
+}
+
+/* unused */
+void MEM_threadcache_callbackmemlist(void (*func)(void *))
+{
+	(void) func;  /* Ignored. */
+}
+
+void MEM_threadcache_printmemlist_stats(void)
+{
+	MemThreadCache *cache;
+	size_t cached = 0;
+	int caches_num = 0;
+
+	for (cache = thread_caches; cache; cache = cache->next) {
+		unsigned int i;
+		for (i = 0; i < MEM_SIZE_CLASSES; i++) {
+			cached += cache->free_num[i] * size_classes[i];
+		}
+		caches_num++;
+	}
+
+	printf("\ntotal memory len: %.3f MB\n",
+	       (double)MEM_threadcache_get_memory_in_use() / (double)(1024 * 1024));
+	printf("peak memory len: %.3f MB\n",
+	       (double)MEM_threadcache_get_peak_memory() / (double)(1024 * 1024));
+	printf("thread caches: %d, %.3f MB of free blocks\n",
+	       caches_num, (double)cached / (double)(1024 * 1024));
+	printf("\nFor more detailed per-block statistics run Blender with memory debugging command line argument.\n");
+
+#ifdef HAVE_MALLOC_STATS
+	printf("System Statistics:\n");
+	malloc_stats();
+#endif
+}
+
+void MEM_threadcache_set_error_callback(void (*func)(const char *))
+{
+	error_callback = func;
+}
+
+bool MEM_threadcache_check_memory_integrity(void)
+{
+	return true;
+}
+
+void MEM_threadcache_set_lock_callback(void (*lock)(void), void (*unlock)(void))
+{
+	(void) lock;  /* Ignored, no mmap lock is needed on this platform. */
+	(void) unlock;
+}
+
+void MEM_threadcache_set_memory_debug(void)
+{
+	malloc_debug_memset = true;
+}
+
+size_t MEM_threadcache_get_memory_in_use(void)
+{
+	MemThreadCache *cache;
+	size_t mem = mem_in_use;
+
+	for (cache = thread_caches; cache; cache = cache->next) {
+		mem += (size_t)cache->mem_delta;
+	}
+	return mem;
+}
+
+size_t MEM_threadcache_get_mapped_memory_in_use(void)
+{
+	return mmap_in_use;
+}
+
+unsigned int MEM_threadcache_get_memory_blocks_in_use(void)
+{
+	MemThreadCache *cache;
+	unsigned int blocks = totblock;
+
+	for (cache = thread_caches; cache; cache = cache->next) {
+		blocks += (unsigned int)cache->blocks_delta;
+	}
+	return blocks;
+}
+
+void MEM_threadcache_reset_peak_memory(void)
+{
+	peak_mem = MEM_threadcache_get_memory_in_use();
+}
+
+size_t MEM_threadcache_get_peak_memory(void)
+{
+	const size_t mem = MEM_threadcache_get_memory_in_use();
+	return (mem > peak_mem) ? mem : peak_mem;
+}
+
+#ifndef NDEBUG
+const char *MEM_threadcache_name_ptr(void *vmemh)
+{
+	if (vmemh) {
+		return "unknown block name ptr";
+	}
+	else {
+		return "MEM_threadcache_name_ptr(NULL)";
+	}
+}
+#endif  /* NDEBUG */
+
+#endif  /* WITH_MEM_THREADCACHE */
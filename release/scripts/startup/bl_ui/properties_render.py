@@ -400,6 +400,7 @@ class RENDER_PT_output(RenderButtonsPanel, Panel):
         col.active = not rd.is_movie_format
         col.prop(rd, "use_overwrite")
         col.prop(rd, "use_placeholder")
+        col.prop(rd, "use_async_write")
 
         col = split.column()
         col.prop(rd, "use_file_extension")
@@ -129,10 +129,11 @@ enum {
 	G_DEBUG_GPU_MEM =   (1 << 10), /* gpu memory in status bar */
 	G_DEBUG_DEPSGRAPH_NO_THREADS = (1 << 11),  /* single threaded depsgraph */
 	G_DEBUG_GPU =        (1 << 12), /* gpu debug */
+	G_DEBUG_IO =         (1 << 13), /* file reading timings */
 };
 
 #define G_DEBUG_ALL  (G_DEBUG | G_DEBUG_FFMPEG | G_DEBUG_PYTHON | G_DEBUG_EVENTS | G_DEBUG_WM | G_DEBUG_JOBS | \
-                      G_DEBUG_FREESTYLE | G_DEBUG_DEPSGRAPH | G_DEBUG_GPU_MEM)
+                      G_DEBUG_FREESTYLE | G_DEBUG_DEPSGRAPH | G_DEBUG_GPU_MEM | G_DEBUG_IO)
 
 
 /* G.fileflags */
@@ -79,6 +79,7 @@ int     BKE_imbuf_write_stamp(
 void    BKE_imbuf_write_prepare(struct ImBuf *ibuf, const struct ImageFormatData *imf);
 int     BKE_imbuf_write(struct ImBuf *ibuf, const char *name, const struct ImageFormatData *imf);
 int     BKE_imbuf_write_as(struct ImBuf *ibuf, const char *name, struct ImageFormatData *imf, const bool is_copy);
+void    BKE_imbuf_write_async(struct ImBuf *ibuf, const char *name, const struct ImageFormatData *imf);
 void    BKE_image_path_from_imformat(
         char *string, const char *base, const char *relbase, int frame,
         const struct ImageFormatData *im_format, const bool use_ext, const bool use_frames, const char *suffix);
@@ -102,6 +102,7 @@ typedef struct SeqRenderData {
 	float motion_blur_shutter;
 	bool skip_cache;
 	bool is_proxy_render;
+	bool is_prefetch_render;
 	int view_id;
 
 	/* special case for OpenGL render */
@@ -187,10 +188,29 @@ struct SeqEffectHandle {
  * ********************************************************************** */
 
 struct ImBuf *BKE_sequencer_give_ibuf(const SeqRenderData *context, float cfra, int chanshown);
-struct ImBuf *BKE_sequencer_give_ibuf_threaded(const SeqRenderData *context, float cfra, int chanshown);
 struct ImBuf *BKE_sequencer_give_ibuf_direct(const SeqRenderData *context, float cfra, struct Sequence *seq);
 struct ImBuf *BKE_sequencer_give_ibuf_seqbase(const SeqRenderData *context, float cfra, int chan_shown, struct ListBase *seqbasep);
-void BKE_sequencer_give_ibuf_prefetch_request(const SeqRenderData *context, float cfra, int chan_shown);
+
+/* **********************************************************************
+ * sequencer.c
+ *
+ * prefetch functions
+ * ********************************************************************** */
+
+typedef struct SeqPrefetchStats {
+	int frames_requested;   /* frames given by BKE_sequencer_give_ibuf_prefetch */
+	int frames_cached;      /* requested frames which were already in the cache */
+	int frames_prefetched;  /* frames rendered by the prefetch threads */
+	int frames_skipped;     /* frames which can't be rendered by the prefetch threads */
+	int frames_ahead;       /* frames rendered ahead, limited by the memory budget */
+	int num_threads;
+} SeqPrefetchStats;
+
+struct ImBuf *BKE_sequencer_give_ibuf_prefetch(const SeqRenderData *context, float cfra, int chanshown, int num_frames);
+void BKE_sequencer_prefetch_stop(void);
+void BKE_sequencer_prefetch_free(void);
+void BKE_sequencer_prefetch_stats_get(SeqPrefetchStats *r_stats);
+void BKE_sequencer_prefetch_stats_reset(void);
 
 /* **********************************************************************
  * sequencer.c
@@ -60,6 +60,7 @@
 #include "BKE_global.h"
 #include "BKE_image.h"
 #include "BKE_main.h"
+#include "BKE_sequencer.h"
 #include "RE_pipeline.h"
 
 #include "BLO_undofile.h"
@@ -101,6 +102,8 @@ static int read_undosave(bContext *C, UndoElem *uel)
 
 	/* This is needed so undoing/redoing doesn't crash with threaded previews going */
 	undo_wm_job_kill_callback(C);
+	/* the sequencer prefetch threads render strips of the scenes being replaced */
+	BKE_sequencer_prefetch_stop();
 
 	BLI_strncpy(mainstr, G.main->name, sizeof(mainstr));    /* temporal store */
 
@@ -2358,6 +2358,23 @@ int BKE_imbuf_write_as(ImBuf *ibuf, const char *name, ImageFormatData *imf,
 	return ok;
 }
 
+/* same as BKE_imbuf_write() but the file is written by the write queue of imbuf,
+ * a copy of the image is queued so the caller keeps and can change it.
+ * Errors are returned by IMB_write_queue_wait() */
+void BKE_imbuf_write_async(ImBuf *ibuf, const char *name, const ImageFormatData *imf)
+{
+	ImBuf *ibuf_copy;
+
+	BKE_imbuf_write_prepare(ibuf, imf);
+
+	BLI_make_existing_file(name);
+
+	ibuf_copy = IMB_dupImBuf(ibuf);
+	IMB_metadata_copy(ibuf_copy, ibuf);
+
+	IMB_write_queue_push(ibuf_copy, name, IB_rect | IB_zbuf | IB_zbuffloat);
+}
+
 int BKE_imbuf_write_stamp(
         Scene *scene, struct RenderResult *rr, ImBuf *ibuf, const char *name,
         const struct ImageFormatData *imf)
@@ -137,7 +137,10 @@ ID *BKE_main_idmap_lookup(struct IDNameLib_Map *id_map, short id_type, const cha
 		if (lb_len == 0) {
 			return NULL;
 		}
-		type_map->map = BLI_ghash_new_ex(idkey_hash, idkey_cmp, __func__, lb_len);
+		type_map->map = BLI_ghash_new(idkey_hash, idkey_cmp, __func__);
+		/* filled once and only used for lookups, strings are compared less with the full hashes stored */
+		BLI_ghash_flag_set(type_map->map, GHASH_FLAG_OPEN_ADDRESSING);
+		BLI_ghash_reserve(type_map->map, (unsigned int)lb_len);
 		type_map->keys = MEM_mallocN(sizeof(struct IDNameLib_Key) * lb_len, __func__);
 
 		GHash *map = type_map->map;
@@ -40,6 +40,7 @@
 #include "IMB_imbuf_types.h"
 
 #include "BLI_listbase.h"
+#include "BLI_threads.h"
 
 #include "BKE_sequencer.h"
 #include "BKE_scene.h"
@@ -69,6 +70,9 @@ typedef struct SeqPreprocessCache {
 static struct MovieCache *moviecache = NULL;
 static struct SeqPreprocessCache *preprocess_cache = NULL;
 
+/* the prefetch threads use the cache along with the main thread */
+static ThreadMutex cache_lock = BLI_MUTEX_INITIALIZER;
+
 static void preprocessed_cache_destruct(void);
 
 static bool seq_cmp_render_data(const SeqRenderData *a, const SeqRenderData *b)
@@ -123,6 +127,8 @@ static bool seqcache_hashcmp(const void *a_, const void *b_)
 
 void BKE_sequencer_cache_destruct(void)
 {
+	BKE_sequencer_prefetch_free();
+
 	if (moviecache)
 		IMB_moviecache_free(moviecache);
 
@@ -131,10 +137,14 @@ void BKE_sequencer_cache_destruct(void)
 
 void BKE_sequencer_cache_cleanup(void)
 {
+	BKE_sequencer_prefetch_stop();
+
+	BLI_mutex_lock(&cache_lock);
 	if (moviecache) {
 		IMB_moviecache_free(moviecache);
 		moviecache = IMB_moviecache_create("seqcache", sizeof(SeqCacheKey), seqcache_hashhash, seqcache_hashcmp);
 	}
+	BLI_mutex_unlock(&cache_lock);
 
 	BKE_sequencer_preprocessed_cache_cleanup();
 }
@@ -149,13 +159,19 @@ static bool seqcache_key_check_seq(ImBuf *UNUSED(ibuf), void *userkey, void *use
 
 void BKE_sequencer_cache_cleanup_sequence(Sequence *seq)
 {
+	BKE_sequencer_prefetch_stop();
+
+	BLI_mutex_lock(&cache_lock);
 	if (moviecache)
 		IMB_moviecache_cleanup(moviecache, seqcache_key_check_seq, seq);
+	BLI_mutex_unlock(&cache_lock);
 }
 
 struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context, Sequence *seq, float cfra, eSeqStripElemIBuf type)
 {
-	if (moviecache && seq) {
+	ImBuf *ibuf = NULL;
+
+	if (seq) {
 		SeqCacheKey key;
 
 		key.seq = seq;
@@ -163,10 +179,13 @@ struct ImBuf *BKE_sequencer_cache_get(const SeqRenderData *context, Sequence *se
 		key.cfra = cfra - seq->start;
 		key.type = type;
 
-		return IMB_moviecache_get(moviecache, &key);
+		BLI_mutex_lock(&cache_lock);
+		if (moviecache)
+			ibuf = IMB_moviecache_get(moviecache, &key);
+		BLI_mutex_unlock(&cache_lock);
 	}
 
-	return NULL;
+	return ibuf;
 }
 
 void BKE_sequencer_cache_put(const SeqRenderData *context, Sequence *seq, float cfra, eSeqStripElemIBuf type, ImBuf *i)
@@ -177,16 +196,20 @@ void BKE_sequencer_cache_put(const SeqRenderData *context, Sequence *seq, float
 		return;
 	}
 
-	if (!moviecache) {
-		moviecache = IMB_moviecache_create("seqcache", sizeof(SeqCacheKey), seqcache_hashhash, seqcache_hashcmp);
-	}
-
 	key.seq = seq;
 	key.context = *context;
 	key.cfra = cfra - seq->start;
 	key.type = type;
 
+	BLI_mutex_lock(&cache_lock);
+
+	if (!moviecache) {
+		moviecache = IMB_moviecache_create("seqcache", sizeof(SeqCacheKey), seqcache_hashhash, seqcache_hashcmp);
+	}
+
 	IMB_moviecache_put(moviecache, &key, i);
+
+	BLI_mutex_unlock(&cache_lock);
 }
 
 void BKE_sequencer_preprocessed_cache_cleanup(void)
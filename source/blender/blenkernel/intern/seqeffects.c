@@ -40,6 +40,7 @@
 #include "BLI_utildefines.h"
 #include "BLI_rect.h"
 #include "BLI_string.h"
+#include "BLI_threads.h"
 
 #include "DNA_scene_types.h"
 #include "DNA_sequence_types.h"
@@ -3117,6 +3118,9 @@ static int early_out_text(Sequence *seq, float UNUSED(facf0), float UNUSED(facf1
 	return EARLY_NO_INPUT;
 }
 
+/* The font has a single buffer and state, sequencer prefetch renders text from several threads. */
+static ThreadMutex text_effect_lock = BLI_MUTEX_INITIALIZER;
+
 static ImBuf *do_text_effect(const SeqRenderData *context, Sequence *seq, float UNUSED(cfra), float UNUSED(facf0), float UNUSED(facf1),
                           ImBuf *ibuf1, ImBuf *ibuf2, ImBuf *ibuf3)
 {
@@ -3145,6 +3149,8 @@ static ImBuf *do_text_effect(const SeqRenderData *context, Sequence *seq, float
 		proxy_size_comp = context->preview_render_size / 100.0f;
 	}
 
+	BLI_mutex_lock(&text_effect_lock);
+
 	/* set before return */
 	BLF_size(mono, proxy_size_comp * data->text_size, 72);
 
@@ -3211,6 +3217,8 @@ static ImBuf *do_text_effect(const SeqRenderData *context, Sequence *seq, float
 
 	BLF_disable(mono, BLF_WORD_WRAP);
 
+	BLI_mutex_unlock(&text_effect_lock);
+
 	return out;
 }
 
@@ -889,6 +889,9 @@ SequenceModifierData *BKE_sequence_modifier_new(Sequence *seq, const char *name,
 	SequenceModifierData *smd;
 	const SequenceModifierTypeInfo *smti = BKE_sequence_modifier_type_info_get(type);
 
+	/* the prefetch threads may be applying the modifiers */
+	BKE_sequencer_prefetch_stop();
+
 	smd = MEM_callocN(smti->struct_size, "sequence modifier");
 
 	smd->type = type;
@@ -936,6 +939,8 @@ void BKE_sequence_modifier_free(SequenceModifierData *smd)
 {
 	const SequenceModifierTypeInfo *smti = BKE_sequence_modifier_type_info_get(smd->type);
 
+	BKE_sequencer_prefetch_stop();
+
 	if (smti && smti->free_data) {
 		smti->free_data(smd);
 	}
@@ -31,10 +31,12 @@
 
 #include <stddef.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include <math.h>
 
 #include "MEM_guardedalloc.h"
+#include "MEM_CacheLimiterC-Api.h"
 
 #include "DNA_sequence_types.h"
 #include "DNA_movieclip_types.h"
@@ -97,6 +99,16 @@ typedef struct SeqRenderState {
 	LinkNode *scene_parents;
 } SeqRenderState;
 
+/* Movies and speed effect maps of the strips are shared by the threads rendering frames. */
+static ThreadMutex seq_anim_lock = BLI_MUTEX_INITIALIZER;
+
+/* Strip settings the render reads which can be animated, see seq_render_strip_values_get. */
+typedef struct SeqRenderStripValues {
+	float blend_opacity;
+	float mul;
+	float sat;
+} SeqRenderStripValues;
+
 static ImBuf *seq_render_strip_stack(
         const SeqRenderData *context, SeqRenderState *state, ListBase *seqbasep,
         float cfra, int chanshown);
@@ -104,6 +116,9 @@ static ImBuf *seq_render_strip(
         const SeqRenderData *context, SeqRenderState *state,
         Sequence *seq, float cfra);
 static void seq_free_animdata(Scene *scene, Sequence *seq);
+static bool seq_prefetch_animdata_is_safe(Scene *scene, Sequence *seq);
+static void seq_render_strip_values_get(const SeqRenderData *context, Sequence *seq, float cfra,
+                                        SeqRenderStripValues *r_values);
 static ImBuf *seq_render_mask(const SeqRenderData *context, Mask *mask, float nr, bool make_float);
 static int seq_num_files(Scene *scene, char views_format, const bool is_multiview);
 static void seq_anim_add_suffix(Scene *scene, struct anim *anim, const int view_id);
@@ -201,6 +216,8 @@ static void seq_free_strip(Strip *strip)
 /* only give option to skip cache locally (static func) */
 static void BKE_sequence_free_ex(Scene *scene, Sequence *seq, const bool do_cache)
 {
+	BKE_sequencer_prefetch_stop();
+
 	if (seq->strip)
 		seq_free_strip(seq->strip);
 
@@ -577,6 +594,7 @@ void BKE_sequencer_new_render_data(
 	r_context->motion_blur_shutter = 0;
 	r_context->skip_cache = false;
 	r_context->is_proxy_render = false;
+	r_context->is_prefetch_render = false;
 	r_context->view_id = 0;
 	r_context->gpu_offscreen = NULL;
 	r_context->gpu_samples = (scene->r.mode & R_OSA) ? scene->r.osa : 0;
@@ -837,6 +855,8 @@ void BKE_sequence_reload_new_file(Scene *scene, Sequence *seq, const bool lock_r
 		return;
 	}
 
+	BKE_sequencer_prefetch_stop();
+
 	if (lock_range) {
 		/* keep so we don't have to move the actual start and end points (only the data) */
 		BKE_sequence_calc_disp(scene, seq);
@@ -997,6 +1017,8 @@ void BKE_sequencer_sort(Scene *scene)
 	if (ed == NULL)
 		return;
 
+	BKE_sequencer_prefetch_stop();
+
 	BLI_listbase_clear(&seqbase);
 	BLI_listbase_clear(&effbase);
 
@@ -1745,23 +1767,28 @@ static ImBuf *seq_proxy_fetch(const SeqRenderData *context, Sequence *seq, int c
 
 	if (proxy->storage & SEQ_STORAGE_PROXY_CUSTOM_FILE) {
 		int frameno = (int)give_stripelem_index(seq, cfra) + seq->anim_startofs;
+		ImBuf *ibuf = NULL;
+
+		BLI_mutex_lock(&seq_anim_lock);
+
 		if (proxy->anim == NULL) {
-			if (seq_proxy_get_fname(ed, seq, cfra, render_size, name, context->view_id) == 0) {
-				return NULL;
+			if (seq_proxy_get_fname(ed, seq, cfra, render_size, name, context->view_id)) {
+				proxy->anim = openanim(name, IB_rect, 0, seq->strip->colorspace_settings.name);
 			}
-
-			proxy->anim = openanim(name, IB_rect, 0, seq->strip->colorspace_settings.name);
 		}
-		if (proxy->anim == NULL) {
-			return NULL;
+
+		if (proxy->anim) {
+			seq_open_anim_file(context->scene, seq, true);
+			sanim = seq->anims.first;
+
+			frameno = IMB_anim_index_get_frame_index(sanim ? sanim->anim : NULL, seq->strip->proxy->tc, frameno);
+
+			ibuf = IMB_anim_absolute(proxy->anim, frameno, IMB_TC_NONE, IMB_PROXY_NONE);
 		}
- 
-		seq_open_anim_file(context->scene, seq, true);
-		sanim = seq->anims.first;
 
-		frameno = IMB_anim_index_get_frame_index(sanim ? sanim->anim : NULL, seq->strip->proxy->tc, frameno);
+		BLI_mutex_unlock(&seq_anim_lock);
 
-		return IMB_anim_absolute(proxy->anim, frameno, IMB_TC_NONE, IMB_PROXY_NONE);
+		return ibuf;
 	}
  
 	if (seq_proxy_get_fname(ed, seq, cfra, render_size, name, context->view_id) == 0) {
@@ -2393,8 +2420,9 @@ void BKE_sequencer_color_balance_apply(StripColorBalance *cb, ImBuf *ibuf, float
  *  - Premultiply
  */
 
-bool BKE_sequencer_input_have_to_preprocess(const SeqRenderData *context, Sequence *seq, float UNUSED(cfra))
+bool BKE_sequencer_input_have_to_preprocess(const SeqRenderData *context, Sequence *seq, float cfra)
 {
+	SeqRenderStripValues values;
 	float mul;
 
 	if (context->is_proxy_render) {
@@ -2405,17 +2433,18 @@ bool BKE_sequencer_input_have_to_preprocess(const SeqRenderData *context, Sequen
 		return true;
 	}
 
-	mul = seq->mul;
+	seq_render_strip_values_get(context, seq, cfra, &values);
+	mul = values.mul;
 
 	if (seq->blend_mode == SEQ_BLEND_REPLACE) {
-		mul *= seq->blend_opacity / 100.0f;
+		mul *= values.blend_opacity / 100.0f;
 	}
 
 	if (mul != 1.0f) {
 		return true;
 	}
 
-	if (seq->sat != 1.0f) {
+	if (values.sat != 1.0f) {
 		return true;
 	}
 
@@ -2430,6 +2459,7 @@ static ImBuf *input_preprocess(const SeqRenderData *context, Sequence *seq, floa
                                const bool is_proxy_image, const bool is_preprocessed)
 {
 	Scene *scene = context->scene;
+	SeqRenderStripValues values;
 	float mul;
 
 	ibuf = IMB_makeSingleUser(ibuf);
@@ -2520,14 +2550,16 @@ static ImBuf *input_preprocess(const SeqRenderData *context, Sequence *seq, floa
 		IMB_flipy(ibuf);
 	}
 
-	if (seq->sat != 1.0f) {
-		IMB_saturation(ibuf, seq->sat);
+	seq_render_strip_values_get(context, seq, cfra, &values);
+
+	if (values.sat != 1.0f) {
+		IMB_saturation(ibuf, values.sat);
 	}
 
-	mul = seq->mul;
+	mul = values.mul;
 
 	if (seq->blend_mode == SEQ_BLEND_REPLACE) {
-		mul *= seq->blend_opacity / 100.0f;
+		mul *= values.blend_opacity / 100.0f;
 	}
 
 	if (seq->flag & SEQ_MAKE_FLOAT) {
@@ -3472,7 +3504,9 @@ static ImBuf *do_render_strip_uncached(
 			float f_cfra;
 			SpeedControlVars *s = (SpeedControlVars *)seq->effectdata;
 
+			BLI_mutex_lock(&seq_anim_lock);
 			BKE_sequence_effect_speed_rebuild_map(context->scene, seq, false);
+			BLI_mutex_unlock(&seq_anim_lock);
 
 			/* weeek! */
 			f_cfra = seq->start + s->frameMap[(int)nr];
@@ -3507,7 +3541,9 @@ static ImBuf *do_render_strip_uncached(
 
 		case SEQ_TYPE_MOVIE:
 		{
+			BLI_mutex_lock(&seq_anim_lock);
 			ibuf = seq_render_movie_strip(context, seq, nr, cfra);
+			BLI_mutex_unlock(&seq_anim_lock);
 			copy_to_ibuf_still(context, seq, nr, ibuf);
 			break;
 		}
@@ -3564,23 +3600,26 @@ static ImBuf *seq_render_strip(
 	if (ibuf == NULL) {
 		ibuf = copy_from_ibuf_still(context, seq, nr);
 
-		if (ibuf == NULL) {
+		/* the preprocessed cache holds a single frame, it's only used by the main thread */
+		if (ibuf == NULL && !context->is_prefetch_render) {
 			ibuf = BKE_sequencer_preprocessed_cache_get(context, seq, cfra, SEQ_STRIPELEM_IBUF);
+		}
 
-			if (ibuf == NULL) {
-				/* MOVIECLIPs have their own proxy management */
-				if (seq->type != SEQ_TYPE_MOVIECLIP) {
-					ibuf = seq_proxy_fetch(context, seq, cfra);
-					is_proxy_image = (ibuf != NULL);
-				}
+		if (ibuf == NULL) {
+			/* MOVIECLIPs have their own proxy management */
+			if (seq->type != SEQ_TYPE_MOVIECLIP) {
+				ibuf = seq_proxy_fetch(context, seq, cfra);
+				is_proxy_image = (ibuf != NULL);
+			}
 
-				if (ibuf == NULL)
-					ibuf = do_render_strip_uncached(context, state, seq, cfra);
+			if (ibuf == NULL)
+				ibuf = do_render_strip_uncached(context, state, seq, cfra);
 
-				if (ibuf) {
-					if (ELEM(seq->type, SEQ_TYPE_MOVIE, SEQ_TYPE_MOVIECLIP)) {
-						is_proxy_image = (context->preview_render_size != 100);
-					}
+			if (ibuf) {
+				if (ELEM(seq->type, SEQ_TYPE_MOVIE, SEQ_TYPE_MOVIECLIP)) {
+					is_proxy_image = (context->preview_render_size != 100);
+				}
+				if (!context->is_prefetch_render) {
 					BKE_sequencer_preprocessed_cache_put(context, seq, cfra, SEQ_STRIPELEM_IBUF, ibuf);
 				}
 			}
@@ -3631,11 +3670,16 @@ static bool seq_must_swap_input_in_blend_mode(Sequence *seq)
 	return swap_input;
 }
 
-static int seq_get_early_out_for_blend_mode(Sequence *seq)
+static int seq_get_early_out_for_blend_mode(const SeqRenderData *context, Sequence *seq, float cfra)
 {
 	struct SeqEffectHandle sh = BKE_sequence_get_blend(seq);
-	float facf = seq->blend_opacity / 100.0f;
-	int early_out = sh.early_out(seq, facf, facf);
+	SeqRenderStripValues values;
+	float facf;
+	int early_out;
+
+	seq_render_strip_values_get(context, seq, cfra, &values);
+	facf = values.blend_opacity / 100.0f;
+	early_out = sh.early_out(seq, facf, facf);
 
 	if (ELEM(early_out, EARLY_DO_EFFECT, EARLY_NO_INPUT)) {
 		return early_out;
@@ -3657,9 +3701,13 @@ static ImBuf *seq_render_strip_stack_apply_effect(const SeqRenderData *context,
 {
 	ImBuf *out;
 	struct SeqEffectHandle sh = BKE_sequence_get_blend(seq);
-	float facf = seq->blend_opacity / 100.0f;
+	SeqRenderStripValues values;
+	float facf;
 	int swap_input = seq_must_swap_input_in_blend_mode(seq);
 
+	seq_render_strip_values_get(context, seq, cfra, &values);
+	facf = values.blend_opacity / 100.0f;
+
 	if (swap_input) {
 		if (sh.multithreaded)
 			out = seq_render_effect_execute_threaded(&sh, context, seq, cfra, facf, facf, ibuf2, ibuf1, NULL);
@@ -3717,7 +3765,7 @@ static ImBuf *seq_render_strip_stack(
 				early_out = EARLY_NO_INPUT;
 			}
 			else {
-				early_out = seq_get_early_out_for_blend_mode(seq);
+				early_out = seq_get_early_out_for_blend_mode(context, seq, cfra);
 			}
 
 			if (ELEM(early_out, EARLY_NO_INPUT, EARLY_USE_INPUT_2)) {
@@ -3767,7 +3815,7 @@ static ImBuf *seq_render_strip_stack(
 			break;
 		}
 
-		early_out = seq_get_early_out_for_blend_mode(seq);
+		early_out = seq_get_early_out_for_blend_mode(context, seq, cfra);
 
 		switch (early_out) {
 			case EARLY_NO_INPUT:
@@ -3804,7 +3852,7 @@ static ImBuf *seq_render_strip_stack(
 	for (; i < count; i++) {
 		Sequence *seq = seq_arr[i];
 
-		if (seq_get_early_out_for_blend_mode(seq) == EARLY_DO_EFFECT) {
+		if (seq_get_early_out_for_blend_mode(context, seq, cfra) == EARLY_DO_EFFECT) {
 			ImBuf *ibuf1 = out;
 			ImBuf *ibuf2 = seq_render_strip(context, state, seq, cfra);
 
@@ -3820,6 +3868,18 @@ static ImBuf *seq_render_strip_stack(
 	return out;
 }
 
+/* strips shown with the channel, negative channels show the meta strips being edited */
+static ListBase *seq_render_seqbase_get(Editing *ed, int chanshown)
+{
+	if ((chanshown < 0) && !BLI_listbase_is_empty(&ed->metastack)) {
+		int count = BLI_listbase_count(&ed->metastack);
+		count = max_ii(count + chanshown, 0);
+		return ((MetaStack *)BLI_findlink(&ed->metastack, count))->oldbasep;
+	}
+
+	return ed->seqbasep;
+}
+
 /*
  * returned ImBuf is refed!
  * you have to free after usage!
@@ -3832,14 +3892,7 @@ ImBuf *BKE_sequencer_give_ibuf(const SeqRenderData *context, float cfra, int cha
 	
 	if (ed == NULL) return NULL;
 
-	if ((chanshown < 0) && !BLI_listbase_is_empty(&ed->metastack)) {
-		int count = BLI_listbase_count(&ed->metastack);
-		count = max_ii(count + chanshown, 0);
-		seqbasep = ((MetaStack *)BLI_findlink(&ed->metastack, count))->oldbasep;
-	}
-	else {
-		seqbasep = ed->seqbasep;
-	}
+	seqbasep = seq_render_seqbase_get(ed, chanshown);
 
 	SeqRenderState state;
 	sequencer_state_init(&state);
@@ -3866,154 +3919,458 @@ ImBuf *BKE_sequencer_give_ibuf_direct(const SeqRenderData *context, float cfra,
 
 /* *********************** threading api ******************* */
 
-static ListBase running_threads;
-static ListBase prefetch_wait;
-static ListBase prefetch_done;
+/* Frames ahead of the playhead are rendered by worker threads into the cache, the playback
+ * then finds them there. Each thread renders whole frames with its own copy of the render
+ * data and its own render state, the strips are shared with the main thread which stops
+ * the threads before any change invalidating the cache. */
 
-static pthread_mutex_t queue_lock          = PTHREAD_MUTEX_INITIALIZER;
-static pthread_mutex_t wakeup_lock         = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t wakeup_cond          = PTHREAD_COND_INITIALIZER;
+/* Part of the cache memory limit the frames ahead of the playhead may use, the rest is left
+ * for the frames already played and the images of the strips. */
+#define SEQ_PREFETCH_MEMORY_FRACTION 0.5
 
-//static pthread_mutex_t prefetch_ready_lock = PTHREAD_MUTEX_INITIALIZER;
-//static pthread_cond_t  prefetch_ready_cond = PTHREAD_COND_INITIALIZER;
+typedef struct SeqPrefetchThread {
+	pthread_t pthread;
+	/* frame being rendered, or SEQ_PREFETCH_NO_FRAME */
+	int cfra;
+} SeqPrefetchThread;
 
-static pthread_mutex_t frame_done_lock     = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t frame_done_cond      = PTHREAD_COND_INITIALIZER;
+#define SEQ_PREFETCH_NO_FRAME INT_MIN
 
-static volatile bool seq_thread_shutdown = true; 
-static volatile int seq_last_given_monoton_cfra = 0;
-static int monoton_cfra = 0;
+static struct {
+	ListBase threads;
+	SeqPrefetchThread *slots;
+	int num_threads;
 
-typedef struct PrefetchThread {
-	struct PrefetchThread *next, *prev;
-	
-	Scene *scene;
-	struct PrefetchQueueElem *current;
-	pthread_t pthread;
-	int running;
-	
-} PrefetchThread;
+	ThreadMutex mutex;
+	ThreadCondition cond;
 
-typedef struct PrefetchQueueElem {
-	struct PrefetchQueueElem *next, *prev;
-	
-	int rectx;
-	int recty;
-	float cfra;
+	/* render data and channel of the last requested frame */
+	SeqRenderData context;
 	int chanshown;
-	int preview_render_size;
+	bool has_context;
 
-	int monoton_cfra;
+	/* playhead, the next frame to render is cfra + offset */
+	int cfra;
+	int offset;
+	int num_frames;
+	/* estimated memory used by a rendered frame */
+	size_t frame_size;
 
-	ImBuf *ibuf;
-} PrefetchQueueElem;
+	bool stop;
+	bool exit;
+
+	SeqPrefetchStats stats;
+} seq_prefetch = {{NULL}};
 
-void BKE_sequencer_give_ibuf_prefetch_request(const SeqRenderData *context, float cfra, int chanshown)
+static bool seq_prefetch_context_equals(const SeqRenderData *a, const SeqRenderData *b)
 {
-	PrefetchQueueElem *e;
-	if (seq_thread_shutdown) {
-		return;
+	return ((a->bmain == b->bmain) &&
+	        (a->scene == b->scene) &&
+	        (a->rectx == b->rectx) &&
+	        (a->recty == b->recty) &&
+	        (a->preview_render_size == b->preview_render_size) &&
+	        (a->motion_blur_samples == b->motion_blur_samples) &&
+	        (a->motion_blur_shutter == b->motion_blur_shutter) &&
+	        (a->view_id == b->view_id));
+}
+
+static bool seq_prefetch_strip_is_safe(Scene *scene, Sequence *seq)
+{
+	SequenceModifierData *smd;
+	Sequence *iseq;
+
+	/* Scene strips render with the render pipeline or OpenGL, clips and masks are evaluated
+	 * in their datablock: all of them need the main thread. */
+	if (ELEM(seq->type, SEQ_TYPE_SCENE, SEQ_TYPE_MOVIECLIP, SEQ_TYPE_MASK)) {
+		return false;
 	}
 
-	e = MEM_callocN(sizeof(PrefetchQueueElem), "prefetch_queue_elem");
-	e->rectx = context->rectx;
-	e->recty = context->recty;
-	e->cfra = cfra;
-	e->chanshown = chanshown;
-	e->preview_render_size = context->preview_render_size;
-	e->monoton_cfra = monoton_cfra++;
+	if (!seq_prefetch_animdata_is_safe(scene, seq)) {
+		return false;
+	}
 
-	pthread_mutex_lock(&queue_lock);
-	BLI_addtail(&prefetch_wait, e);
-	pthread_mutex_unlock(&queue_lock);
-	
-	pthread_mutex_lock(&wakeup_lock);
-	pthread_cond_signal(&wakeup_cond);
-	pthread_mutex_unlock(&wakeup_lock);
+	for (smd = seq->modifiers.first; smd; smd = smd->next) {
+		/* curve mappings are initialized and premultiplied in place */
+		if (ELEM(smd->type, seqModifierType_Curves, seqModifierType_HueCorrect) || smd->mask_id) {
+			return false;
+		}
+		if (smd->mask_sequence && !seq_prefetch_strip_is_safe(scene, smd->mask_sequence)) {
+			return false;
+		}
+	}
+
+	if ((seq->seq1 && !seq_prefetch_strip_is_safe(scene, seq->seq1)) ||
+	    (seq->seq2 && !seq_prefetch_strip_is_safe(scene, seq->seq2)) ||
+	    (seq->seq3 && !seq_prefetch_strip_is_safe(scene, seq->seq3)))
+	{
+		return false;
+	}
+
+	for (iseq = seq->seqbase.first; iseq; iseq = iseq->next) {
+		if (!seq_prefetch_strip_is_safe(scene, iseq)) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
-ImBuf *BKE_sequencer_give_ibuf_threaded(const SeqRenderData *context, float cfra, int chanshown)
+/* Check all the strips at the frame rather than the shown ones only,
+ * adjustment strips render the channels below them. */
+static bool seq_prefetch_frame_is_safe(Scene *scene, ListBase *seqbasep, int cfra)
 {
-	PrefetchQueueElem *e = NULL;
-	bool found_something = false;
+	Sequence *seq;
 
-	if (seq_thread_shutdown) {
-		return BKE_sequencer_give_ibuf(context, cfra, chanshown);
+	for (seq = seqbasep->first; seq; seq = seq->next) {
+		if (seq->startdisp <= cfra && seq->enddisp > cfra && !seq_prefetch_strip_is_safe(scene, seq)) {
+			return false;
+		}
 	}
 
-	while (!e) {
-		bool success = false;
-		pthread_mutex_lock(&queue_lock);
+	return true;
+}
 
-		for (e = prefetch_done.first; e; e = e->next) {
-			if (cfra == e->cfra &&
-			    chanshown == e->chanshown &&
-			    context->rectx == e->rectx &&
-			    context->recty == e->recty &&
-			    context->preview_render_size == e->preview_render_size)
-			{
-				success = true;
-				found_something = true;
-				break;
-			}
+static size_t seq_prefetch_ibuf_size(ImBuf *ibuf)
+{
+	size_t size = 0;
+
+	if (ibuf->rect)
+		size += sizeof(unsigned int);
+	if (ibuf->rect_float)
+		size += sizeof(float) * 4;
+
+	return size * ibuf->x * ibuf->y;
+}
+
+/* The final image of a frame, which is cached for the top strip of the stack. */
+static ImBuf *seq_prefetch_cache_get(const SeqRenderData *context, ListBase *seqbasep, int cfra, int chanshown)
+{
+	Sequence *seq_arr[MAXSEQ + 1];
+	int count = get_shown_sequences(seqbasep, cfra, chanshown, seq_arr);
+
+	if (count == 0) {
+		return NULL;
+	}
+
+	return BKE_sequencer_cache_get(context, seq_arr[count - 1], cfra, SEQ_STRIPELEM_IBUF_COMP);
+}
+
+/* Render a frame into the cache, returns its memory size or 0 when it isn't rendered. */
+static size_t seq_prefetch_render_frame(const SeqRenderData *context, int cfra, int chanshown, bool *r_skipped)
+{
+	Editing *ed = BKE_sequencer_editing_get(context->scene, false);
+	Sequence *seq_arr[MAXSEQ + 1];
+	SeqRenderData localcontext;
+	SeqRenderState state;
+	ListBase *seqbasep;
+	ImBuf *ibuf;
+	size_t size = 0;
+	int count;
+
+	if (ed == NULL) {
+		return 0;
+	}
+
+	seqbasep = seq_render_seqbase_get(ed, chanshown);
+	count = get_shown_sequences(seqbasep, cfra, chanshown, seq_arr);
+
+	if (count == 0) {
+		return 0;
+	}
+
+	ibuf = BKE_sequencer_cache_get(context, seq_arr[count - 1], cfra, SEQ_STRIPELEM_IBUF_COMP);
+	if (ibuf) {
+		IMB_freeImBuf(ibuf);
+		return 0;
+	}
+
+	if (!seq_prefetch_frame_is_safe(context->scene, seqbasep, cfra)) {
+		*r_skipped = true;
+		return 0;
+	}
+
+	/* Only the final image is cached, the memory budget then only depends on the frame size. */
+	localcontext = *context;
+	localcontext.skip_cache = true;
+	localcontext.is_prefetch_render = true;
+
+	sequencer_state_init(&state);
+	ibuf = seq_render_strip_stack(&localcontext, &state, seqbasep, cfra, chanshown);
+
+	if (ibuf) {
+		BKE_sequencer_cache_put(context, seq_arr[count - 1], cfra, SEQ_STRIPELEM_IBUF_COMP, ibuf);
+		size = seq_prefetch_ibuf_size(ibuf);
+		IMB_freeImBuf(ibuf);
+	}
+
+	return size;
+}
+
+/* Number of frames to render ahead, within the memory budget and the playback range. */
+static int seq_prefetch_frames_ahead(void)
+{
+	Scene *scene = seq_prefetch.context.scene;
+	size_t budget = (size_t)(MEM_CacheLimiter_get_maximum() * SEQ_PREFETCH_MEMORY_FRACTION);
+	int num_frames = seq_prefetch.num_frames;
+
+	if (seq_prefetch.frame_size) {
+		num_frames = (int)MIN2((size_t)num_frames, budget / seq_prefetch.frame_size);
+	}
+
+	return min_ii(num_frames, PEFRA - PSFRA);
+}
+
+/* Frame at an offset from the playhead, wrapping around the playback range like the playback. */
+static int seq_prefetch_frame_get(int offset)
+{
+	Scene *scene = seq_prefetch.context.scene;
+	int len = PEFRA - PSFRA + 1;
+	int cfra = seq_prefetch.cfra + offset;
+
+	if (cfra > PEFRA) {
+		cfra = PSFRA + (cfra - PSFRA) % len;
+	}
+
+	return cfra;
+}
+
+static bool seq_prefetch_is_rendering(int cfra)
+{
+	int i;
+
+	for (i = 0; i < seq_prefetch.num_threads; i++) {
+		if (seq_prefetch.slots[i].cfra == cfra) {
+			return true;
 		}
+	}
 
-		if (!e) {
-			for (e = prefetch_wait.first; e; e = e->next) {
-				if (cfra == e->cfra &&
-				    chanshown == e->chanshown &&
-				    context->rectx == e->rectx &&
-				    context->recty == e->recty &&
-				    context->preview_render_size == e->preview_render_size)
-				{
-					found_something = true;
-					break;
-				}
-			}
+	return false;
+}
+
+static SeqPrefetchThread *seq_prefetch_thread_self(void)
+{
+	int i;
+
+	for (i = 0; i < seq_prefetch.num_threads; i++) {
+		if (pthread_equal(seq_prefetch.slots[i].pthread, pthread_self())) {
+			return &seq_prefetch.slots[i];
 		}
+	}
 
-		if (!e) {
-			PrefetchThread *tslot;
+	return NULL;
+}
 
-			for (tslot = running_threads.first;
-			     tslot;
-			     tslot = tslot->next)
-			{
-				if (tslot->current &&
-				    cfra == tslot->current->cfra &&
-				    chanshown == tslot->current->chanshown &&
-				    context->rectx == tslot->current->rectx &&
-				    context->recty == tslot->current->recty &&
-				    context->preview_render_size == tslot->current->preview_render_size)
-				{
-					found_something = true;
-					break;
-				}
-			}
+static void *seq_prefetch_thread(void *data)
+{
+	SeqPrefetchThread *slot = data;
+
+	BLI_mutex_lock(&seq_prefetch.mutex);
+	slot->pthread = pthread_self();
+
+	while (!seq_prefetch.exit) {
+		SeqRenderData context;
+		int cfra, chanshown;
+		bool skipped = false;
+		size_t size;
+
+		if (seq_prefetch.stop || !seq_prefetch.has_context ||
+		    seq_prefetch.offset > seq_prefetch_frames_ahead())
+		{
+			BLI_condition_wait(&seq_prefetch.cond, &seq_prefetch.mutex);
+			continue;
 		}
 
-		/* e->ibuf is unrefed by render thread on next round. */
+		cfra = seq_prefetch_frame_get(seq_prefetch.offset++);
+		if (seq_prefetch_is_rendering(cfra)) {
+			continue;
+		}
+
+		context = seq_prefetch.context;
+		chanshown = seq_prefetch.chanshown;
+		slot->cfra = cfra;
+		BLI_mutex_unlock(&seq_prefetch.mutex);
 
-		if (e) {
-			seq_last_given_monoton_cfra = e->monoton_cfra;
+		size = seq_prefetch_render_frame(&context, cfra, chanshown, &skipped);
+
+		BLI_mutex_lock(&seq_prefetch.mutex);
+		slot->cfra = SEQ_PREFETCH_NO_FRAME;
+		if (size) {
+			seq_prefetch.frame_size = size;
+			seq_prefetch.stats.frames_prefetched++;
+		}
+		if (skipped) {
+			seq_prefetch.stats.frames_skipped++;
 		}
+		/* the main thread may wait for this frame */
+		BLI_condition_notify_all(&seq_prefetch.cond);
+	}
+
+	BLI_mutex_unlock(&seq_prefetch.mutex);
 
-		pthread_mutex_unlock(&queue_lock);
+	return NULL;
+}
 
-		if (!success) {
-			e = NULL;
+static void seq_prefetch_start_threads(void)
+{
+	int i;
+
+	seq_prefetch.num_threads = max_ii(BLI_system_thread_count() - 1, 1);
+	seq_prefetch.slots = MEM_callocN(sizeof(SeqPrefetchThread) * seq_prefetch.num_threads, "seq prefetch threads");
+
+	BLI_mutex_init(&seq_prefetch.mutex);
+	BLI_condition_init(&seq_prefetch.cond);
+
+	BLI_init_threads(&seq_prefetch.threads, seq_prefetch_thread, seq_prefetch.num_threads);
+	for (i = 0; i < seq_prefetch.num_threads; i++) {
+		seq_prefetch.slots[i].cfra = SEQ_PREFETCH_NO_FRAME;
+		BLI_insert_thread(&seq_prefetch.threads, &seq_prefetch.slots[i]);
+	}
+}
 
-			if (!found_something) {
-				fprintf(stderr, "SEQ-THREAD: Requested frame not in queue ???\n");
+/**
+ * Give the frame like #BKE_sequencer_give_ibuf and render up to \a num_frames frames after it
+ * with the prefetch threads.
+ *
+ * returned ImBuf is refed!
+ */
+ImBuf *BKE_sequencer_give_ibuf_prefetch(const SeqRenderData *context, float cfra, int chanshown, int num_frames)
+{
+	Editing *ed = BKE_sequencer_editing_get(context->scene, false);
+	ImBuf *ibuf;
+	bool is_cached;
+
+	if (ed == NULL || num_frames <= 0 || context->skip_cache) {
+		return BKE_sequencer_give_ibuf(context, cfra, chanshown);
+	}
+
+	if (seq_prefetch.num_threads == 0) {
+		seq_prefetch_start_threads();
+	}
+
+	BLI_mutex_lock(&seq_prefetch.mutex);
+
+	if (!seq_prefetch.has_context ||
+	    !seq_prefetch_context_equals(&seq_prefetch.context, context) ||
+	    seq_prefetch.chanshown != chanshown ||
+	    seq_prefetch.cfra != (int)cfra)
+	{
+		seq_prefetch.context = *context;
+		seq_prefetch.chanshown = chanshown;
+		seq_prefetch.has_context = true;
+		seq_prefetch.cfra = (int)cfra;
+		seq_prefetch.offset = 1;
+	}
+	seq_prefetch.num_frames = num_frames;
+	seq_prefetch.stop = false;
+
+	/* wait for the frame rather than rendering it twice */
+	while (seq_prefetch_is_rendering((int)cfra)) {
+		BLI_condition_wait(&seq_prefetch.cond, &seq_prefetch.mutex);
+	}
+
+	BLI_condition_notify_all(&seq_prefetch.cond);
+	BLI_mutex_unlock(&seq_prefetch.mutex);
+
+	ibuf = seq_prefetch_cache_get(context, seq_render_seqbase_get(ed, chanshown), (int)cfra, chanshown);
+	is_cached = (ibuf != NULL);
+
+	if (ibuf == NULL) {
+		ibuf = BKE_sequencer_give_ibuf(context, cfra, chanshown);
+	}
+
+	BLI_mutex_lock(&seq_prefetch.mutex);
+	seq_prefetch.stats.frames_requested++;
+	if (is_cached) {
+		seq_prefetch.stats.frames_cached++;
+	}
+	BLI_mutex_unlock(&seq_prefetch.mutex);
+
+	return ibuf;
+}
+
+/**
+ * Stop the prefetch threads once they finished their frame, must be called before changing
+ * strips which may be rendered or invalidating the cache. The threads start again with the
+ * next #BKE_sequencer_give_ibuf_prefetch.
+ */
+void BKE_sequencer_prefetch_stop(void)
+{
+	SeqPrefetchThread *self;
+
+	if (seq_prefetch.num_threads == 0) {
+		return;
+	}
+
+	BLI_mutex_lock(&seq_prefetch.mutex);
+
+	seq_prefetch.stop = true;
+	seq_prefetch.has_context = false;
+
+	/* strips may be freed by the prefetch threads themselves, e.g. reopening a movie */
+	self = seq_prefetch_thread_self();
+
+	for (;;) {
+		int i;
+
+		for (i = 0; i < seq_prefetch.num_threads; i++) {
+			if (&seq_prefetch.slots[i] != self && seq_prefetch.slots[i].cfra != SEQ_PREFETCH_NO_FRAME) {
 				break;
 			}
-			pthread_mutex_lock(&frame_done_lock);
-			pthread_cond_wait(&frame_done_cond, &frame_done_lock);
-			pthread_mutex_unlock(&frame_done_lock);
 		}
+
+		if (i == seq_prefetch.num_threads) {
+			break;
+		}
+
+		BLI_condition_wait(&seq_prefetch.cond, &seq_prefetch.mutex);
 	}
-	
-	return e ? e->ibuf : NULL;
+
+	BLI_mutex_unlock(&seq_prefetch.mutex);
+}
+
+void BKE_sequencer_prefetch_free(void)
+{
+	if (seq_prefetch.num_threads == 0) {
+		return;
+	}
+
+	BLI_mutex_lock(&seq_prefetch.mutex);
+	seq_prefetch.exit = true;
+	BLI_condition_notify_all(&seq_prefetch.cond);
+	BLI_mutex_unlock(&seq_prefetch.mutex);
+
+	BLI_end_threads(&seq_prefetch.threads);
+
+	BLI_condition_end(&seq_prefetch.cond);
+	BLI_mutex_end(&seq_prefetch.mutex);
+	MEM_freeN(seq_prefetch.slots);
+
+	memset(&seq_prefetch, 0, sizeof(seq_prefetch));
+}
+
+void BKE_sequencer_prefetch_stats_get(SeqPrefetchStats *r_stats)
+{
+	if (seq_prefetch.num_threads == 0) {
+		memset(r_stats, 0, sizeof(*r_stats));
+		return;
+	}
+
+	BLI_mutex_lock(&seq_prefetch.mutex);
+	*r_stats = seq_prefetch.stats;
+	r_stats->frames_ahead = seq_prefetch.has_context ? seq_prefetch_frames_ahead() : 0;
+	r_stats->num_threads = seq_prefetch.num_threads;
+	BLI_mutex_unlock(&seq_prefetch.mutex);
+}
+
+void BKE_sequencer_prefetch_stats_reset(void)
+{
+	if (seq_prefetch.num_threads == 0) {
+		return;
+	}
+
+	BLI_mutex_lock(&seq_prefetch.mutex);
+	memset(&seq_prefetch.stats, 0, sizeof(seq_prefetch.stats));
+	BLI_mutex_unlock(&seq_prefetch.mutex);
 }
 
 /* check whether sequence cur depends on seq */
@@ -4065,6 +4422,8 @@ static void sequence_invalidate_cache(Scene *scene, Sequence *seq, bool invalida
 {
 	Editing *ed = scene->ed;
 
+	BKE_sequencer_prefetch_stop();
+
 	/* invalidate cache for current sequence */
 	if (invalidate_self) {
 		/* Animation structure holds some buffers inside,
@@ -4184,6 +4543,8 @@ void BKE_sequencer_update_changed_seq_and_deps(Scene *scene, Sequence *changed_s
 	Sequence *seq;
 	
 	if (ed == NULL) return;
+
+	BKE_sequencer_prefetch_stop();
 	
 	for (seq = ed->seqbase.first; seq; seq = seq->next)
 		update_changed_seq_recurs(scene, seq, changed_seq, len_change, ibuf_change);
@@ -4911,6 +5272,120 @@ static void seq_free_animdata(Scene *scene, Sequence *seq)
 	}
 }
 
+/* Animated settings of the strips are evaluated for the frame of the main thread. Prefetch
+ * threads render other frames, they evaluate the action F-curves of the settings the render
+ * reads for the frame they render, the settings only used by the sound don't matter to them,
+ * anything else animated needs the main thread. */
+static bool seq_prefetch_prop_is_sound(const char *prop)
+{
+	return (STREQ(prop, ".volume") || STREQ(prop, ".pitch") || STREQ(prop, ".pan"));
+}
+
+/* see seq_render_strip_values_get, the effect fader is evaluated by the effect render */
+static bool seq_prefetch_prop_is_evaluated(const char *prop)
+{
+	return (STREQ(prop, ".blend_alpha") || STREQ(prop, ".color_multiply") ||
+	        STREQ(prop, ".color_saturation") || STREQ(prop, ".effect_fader"));
+}
+
+static bool seq_prefetch_fcurves_are_safe(ListBase *curves, const char *str, const size_t str_len, const bool is_action)
+{
+	FCurve *fcu;
+
+	for (fcu = curves->first; fcu; fcu = fcu->next) {
+		if (STREQLEN(fcu->rna_path, str, str_len)) {
+			const char *prop = fcu->rna_path + str_len;
+
+			if (!seq_prefetch_prop_is_sound(prop) && !(is_action && seq_prefetch_prop_is_evaluated(prop)))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/* the NLA blends the actions of its strips, it's only evaluated by the main thread */
+static bool seq_prefetch_nla_strips_are_safe(ListBase *strips, const char *str, const size_t str_len)
+{
+	NlaStrip *strip;
+
+	for (strip = strips->first; strip; strip = strip->next) {
+		if (strip->act && !seq_prefetch_fcurves_are_safe(&strip->act->curves, str, str_len, false))
+			return false;
+		/* meta strips */
+		if (!seq_prefetch_nla_strips_are_safe(&strip->strips, str, str_len))
+			return false;
+	}
+
+	return true;
+}
+
+static bool seq_prefetch_animdata_is_safe(Scene *scene, Sequence *seq)
+{
+	char str[SEQ_RNAPATH_MAXSTR];
+	size_t str_len;
+	NlaTrack *nlt;
+
+	if (scene->adt == NULL)
+		return true;
+
+	str_len = sequencer_rna_path_prefix(str, seq->name + 2);
+
+	if (scene->adt->action && !seq_prefetch_fcurves_are_safe(&scene->adt->action->curves, str, str_len, true))
+		return false;
+
+	/* drivers may run Python */
+	if (!seq_prefetch_fcurves_are_safe(&scene->adt->drivers, str, str_len, false))
+		return false;
+
+	for (nlt = scene->adt->nla_tracks.first; nlt; nlt = nlt->next) {
+		if (!seq_prefetch_nla_strips_are_safe(&nlt->strips, str, str_len))
+			return false;
+	}
+
+	return true;
+}
+
+/* The settings of the strip for the render, the main thread renders the frame the animation is
+ * evaluated for and shows the changes made to animated settings before they are keyed. */
+static void seq_render_strip_values_get(const SeqRenderData *context, Sequence *seq, float cfra,
+                                        SeqRenderStripValues *r_values)
+{
+	AnimData *adt = context->scene->adt;
+	char str[SEQ_RNAPATH_MAXSTR];
+	size_t str_len;
+	FCurve *fcu;
+
+	r_values->blend_opacity = seq->blend_opacity;
+	r_values->mul = seq->mul;
+	r_values->sat = seq->sat;
+
+	if (!context->is_prefetch_render || adt == NULL || adt->action == NULL)
+		return;
+
+	str_len = sequencer_rna_path_prefix(str, seq->name + 2);
+
+	for (fcu = adt->action->curves.first; fcu; fcu = fcu->next) {
+		if (STREQLEN(fcu->rna_path, str, str_len) && (fcu->flag & FCURVE_MUTED) == 0) {
+			const char *prop = fcu->rna_path + str_len;
+
+			/* same ranges as the RNA properties */
+			if (STREQ(prop, ".blend_alpha")) {
+				r_values->blend_opacity = evaluate_fcurve(fcu, cfra) * 100.0f;
+				CLAMP(r_values->blend_opacity, 0.0f, 100.0f);
+			}
+			else if (STREQ(prop, ".color_multiply")) {
+				r_values->mul = evaluate_fcurve(fcu, cfra);
+				CLAMP(r_values->mul, 0.0f, 20.0f);
+			}
+			else if (STREQ(prop, ".color_saturation")) {
+				r_values->sat = evaluate_fcurve(fcu, cfra);
+				CLAMP(r_values->sat, 0.0f, 20.0f);
+			}
+		}
+	}
+}
+
 #undef SEQ_RNAPATH_MAXSTR
 
 Sequence *BKE_sequence_get_by_name(ListBase *seqbase, const char *name, bool recursive)
@@ -5053,6 +5528,9 @@ Sequence *BKE_sequence_alloc(ListBase *lb, int cfra, int machine)
 {
 	Sequence *seq;
 
+	/* the prefetch threads may be reading the list */
+	BKE_sequencer_prefetch_stop();
+
 	seq = MEM_callocN(sizeof(Sequence), "addseq");
 	BLI_addtail(lb, seq);
 
@@ -42,6 +42,8 @@
 #include "DNA_meshdata_types.h"
 #include "DNA_mesh_types.h"
 
+#include "MEM_guardedalloc.h"
+
 #include "BLI_math.h"
 #include "BLI_utildefines.h"
 #include "BLI_task.h"
@@ -482,53 +484,50 @@ static void shrinkwrap_calc_normal_projection(ShrinkwrapCalcData *calc, bool for
 	}
 }
 
-/*
- * Shrinkwrap moving vertexs to the nearest surface point on the target
- *
- * it builds a BVHTree from the target mesh and then performs a
- * NN matches for each vertex
- */
-static void shrinkwrap_calc_nearest_surface_point_cb_ex(
-        void *userdata, void *userdata_chunk, const int i, const int UNUSED(threadid))
+typedef struct ShrinkwrapNearestSurfaceData {
+	ShrinkwrapCalcData *calc;
+	float (*tree_co)[3];
+	float *weight;
+	BVHTreeNearest *nearest;
+} ShrinkwrapNearestSurfaceData;
+
+/* Convert the vertices to tree coordinates */
+static void shrinkwrap_calc_nearest_surface_point_init_cb(void *userdata, const int i)
 {
-	ShrinkwrapCalcCBData *data = userdata;
+	ShrinkwrapNearestSurfaceData *data = userdata;
 
 	ShrinkwrapCalcData *calc = data->calc;
-	BVHTreeFromMesh *treeData = data->treeData;
-	BVHTreeNearest *nearest = userdata_chunk;
-
-	float *co = calc->vertexCos[i];
-	float tmp_co[3];
+	float *tmp_co = data->tree_co[i];
+	BVHTreeNearest *nearest = &data->nearest[i];
 	float weight = defvert_array_find_weight_safe(calc->dvert, i, calc->vgroup);
 
 	if (calc->invert_vgroup) {
 		weight = 1.0f - weight;
 	}
+	data->weight[i] = weight;
 
-	if (weight == 0.0f) {
-		return;
-	}
-
-	/* Convert the vertex to tree coordinates */
 	if (calc->vert) {
 		copy_v3_v3(tmp_co, calc->vert[i].co);
 	}
 	else {
-		copy_v3_v3(tmp_co, co);
+		copy_v3_v3(tmp_co, calc->vertexCos[i]);
 	}
 	BLI_space_transform_apply(&calc->local2target, tmp_co);
 
-	/* Use local proximity heuristics (to reduce the nearest search)
-	 *
-	 * If we already had an hit before.. we assume this vertex is going to have a close hit to that other vertex
-	 * so we can initiate the "nearest.dist" with the expected value to that last hit.
-	 * This will lead in pruning of the search tree. */
-	if (nearest->index != -1)
-		nearest->dist_sq = len_squared_v3v3(tmp_co, nearest->co);
-	else
-		nearest->dist_sq = FLT_MAX;
+	/* vertices without weight are not moved, a zero distance skips their search */
+	nearest->index = -1;
+	nearest->dist_sq = (weight == 0.0f) ? 0.0f : FLT_MAX;
+}
 
-	BLI_bvhtree_find_nearest(treeData->tree, tmp_co, nearest, treeData->nearest_callback, treeData);
+static void shrinkwrap_calc_nearest_surface_point_cb(void *userdata, const int i)
+{
+	ShrinkwrapNearestSurfaceData *data = userdata;
+
+	ShrinkwrapCalcData *calc = data->calc;
+	const BVHTreeNearest *nearest = &data->nearest[i];
+
+	float *co = calc->vertexCos[i];
+	float *tmp_co = data->tree_co[i];
 
 	/* Found the nearest vertex */
 	if (nearest->index != -1) {
@@ -551,14 +550,20 @@ static void shrinkwrap_calc_nearest_surface_point_cb_ex(
 
 		/* Convert the coordinates back to mesh coordinates */
 		BLI_space_transform_invert(&calc->local2target, tmp_co);
-		interp_v3_v3v3(co, co, tmp_co, weight);  /* linear interpolation */
+		interp_v3_v3v3(co, co, tmp_co, data->weight[i]);  /* linear interpolation */
 	}
 }
 
+/*
+ * Shrinkwrap moving vertexs to the nearest surface point on the target
+ *
+ * it builds a BVHTree from the target mesh and then performs a
+ * NN matches for all vertices in a single batch, traversing the tree for several vertices at once
+ */
 static void shrinkwrap_calc_nearest_surface_point(ShrinkwrapCalcData *calc)
 {
 	BVHTreeFromMesh treeData = NULL_BVHTreeFromMesh;
-	BVHTreeNearest nearest  = NULL_BVHTreeNearest;
+	const bool use_threading = calc->numVerts > BKE_MESH_OMP_LIMIT;
 
 	/* Create a bvh-tree of the given target */
 	bvhtree_from_mesh_looptri(&treeData, calc->target, 0.0, 2, 6);
@@ -567,15 +572,25 @@ static void shrinkwrap_calc_nearest_surface_point(ShrinkwrapCalcData *calc)
 		return;
 	}
 
-	/* Setup nearest */
-	nearest.index = -1;
-	nearest.dist_sq = FLT_MAX;
+	ShrinkwrapNearestSurfaceData data = {
+		.calc = calc,
+		.tree_co = MEM_mallocN(sizeof(*data.tree_co) * (size_t)calc->numVerts, __func__),
+		.weight = MEM_mallocN(sizeof(*data.weight) * (size_t)calc->numVerts, __func__),
+		.nearest = MEM_mallocN(sizeof(*data.nearest) * (size_t)calc->numVerts, __func__),
+	};
+
+	BLI_task_parallel_range(0, calc->numVerts, &data, shrinkwrap_calc_nearest_surface_point_init_cb, use_threading);
 
 	/* Find the nearest vertex */
-	ShrinkwrapCalcCBData data = {.calc = calc, .treeData = &treeData};
-	BLI_task_parallel_range_ex(
-	            0, calc->numVerts, &data, &nearest, sizeof(nearest), shrinkwrap_calc_nearest_surface_point_cb_ex,
-	            calc->numVerts > BKE_MESH_OMP_LIMIT, false);
+	BLI_bvhtree_find_nearest_batch(
+	        treeData.tree, (const float (*)[3])data.tree_co, calc->numVerts, data.nearest,
+	        treeData.nearest_callback, &treeData);
+
+	BLI_task_parallel_range(0, calc->numVerts, &data, shrinkwrap_calc_nearest_surface_point_cb, use_threading);
+
+	MEM_freeN(data.tree_co);
+	MEM_freeN(data.weight);
+	MEM_freeN(data.nearest);
 
 	free_bvhtree_from_mesh(&treeData);
 }
@@ -72,6 +72,9 @@ typedef struct GHashIterState {
 enum {
 	GHASH_FLAG_ALLOW_DUPES  = (1 << 0),  /* Only checked for in debug mode */
 	GHASH_FLAG_ALLOW_SHRINK = (1 << 1),  /* Allow to shrink buckets' size. */
+	/* Store entries in a flat open addressing table instead of chained buckets: faster lookups,
+	 * slower insertions, and pointers to keys or values are only valid until the next insertion or removal. */
+	GHASH_FLAG_OPEN_ADDRESSING = (1 << 2),
 
 #ifdef GHASH_INTERNAL_API
 	/* Internal usage only */
@@ -89,6 +89,11 @@ enum {
 #define BVH_RAYCAST_DEFAULT (BVH_RAYCAST_WATERTIGHT)
 #define BVH_RAYCAST_DIST_MAX (FLT_MAX / 2.0f)
 
+enum {
+	/* split using the surface area heuristic instead of the median, slower to build but faster to query */
+	BVH_BALANCE_SAH = (1 << 0),
+};
+
 /* callback must update nearest in case it finds a nearest result */
 typedef void (*BVHTree_NearestPointCallback)(void *userdata, int index, const float co[3], BVHTreeNearest *nearest);
 
@@ -120,6 +125,7 @@ void BLI_bvhtree_free(BVHTree *tree);
 
 /* construct: first insert points, then call balance */
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints);
+void BLI_bvhtree_balance_ex(BVHTree *tree, int flag);
 void BLI_bvhtree_balance(BVHTree *tree);
 
 /* update: first update points/nodes, then call update_tree to refit the bounding volumes */
@@ -143,6 +149,12 @@ int BLI_bvhtree_find_nearest(
         BVHTree *tree, const float co[3], BVHTreeNearest *nearest,
         BVHTree_NearestPointCallback callback, void *userdata);
 
+/* batched queries: the nearest and hits arrays (not NULL) are initialized and returned like the argument
+ * of the single queries, the queries are run in parallel so the callback must be thread-safe */
+void BLI_bvhtree_find_nearest_batch(
+        BVHTree *tree, const float (*co)[3], const int points_num, BVHTreeNearest *nearest,
+        BVHTree_NearestPointCallback callback, void *userdata);
+
 int BLI_bvhtree_find_nearest_to_ray_angle(
         BVHTree *tree, const float co[3], const float dir[3],
         const bool ray_is_normalized, const float scale[3],
@@ -163,6 +175,11 @@ int BLI_bvhtree_ray_cast(
         BVHTree *tree, const float co[3], const float dir[3], float radius, BVHTreeRayHit *hit,
         BVHTree_RayCastCallback callback, void *userdata);
 
+void BLI_bvhtree_ray_cast_batch(
+        BVHTree *tree, const float (*co)[3], const float (*dir)[3], const int rays_num, float radius,
+        BVHTreeRayHit *hits, BVHTree_RayCastCallback callback, void *userdata,
+        int flag);
+
 void BLI_bvhtree_ray_cast_all_ex(
         BVHTree *tree, const float co[3], const float dir[3], float radius, float hit_dist,
         BVHTree_RayCastCallback callback, void *userdata,
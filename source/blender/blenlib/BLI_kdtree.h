@@ -66,6 +66,14 @@ void BLI_kdtree_range_search_cb(
         const KDTree *tree, const float co[3], float range,
         bool (*search_cb)(void *user_data, int index, const float co[3], float dist_sq), void *user_data);
 
+/* batched queries, writing up to n results per point in r_nearest, the number found in r_found */
+void BLI_kdtree_find_nearest_n_batch(
+        const KDTree *tree, const float (*co)[3], unsigned int co_num,
+        KDTreeNearest *r_nearest, unsigned int n, int *r_found) ATTR_NONNULL(1, 2, 4, 6);
+void BLI_kdtree_range_search_batch(
+        const KDTree *tree, const float (*co)[3], unsigned int co_num, float range,
+        KDTreeNearest *r_nearest, unsigned int n, int *r_found) ATTR_NONNULL(1, 2, 5, 7);
+
 /* Normal use is deprecated */
 /* remove __normal functions when last users drop */
 int BLI_kdtree_find_nearest_n__normal(
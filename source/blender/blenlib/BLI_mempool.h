@@ -61,6 +61,13 @@ void      **BLI_mempool_as_tableN(BLI_mempool *pool, const char *allocstr) ATTR_
 void        BLI_mempool_as_array(BLI_mempool *pool, void *data) ATTR_NONNULL(1, 2);
 void       *BLI_mempool_as_arrayN(BLI_mempool *pool, const char *allocstr) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1, 2);
 
+BLI_mempool *BLI_mempool_create_threadsafe(unsigned int esize, unsigned int totelem,
+                                           unsigned int pchunk, unsigned int flag,
+                                           unsigned int num_threads) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT;
+void        *BLI_mempool_alloc_threadsafe(BLI_mempool *pool, const int threadid) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void        *BLI_mempool_calloc_threadsafe(BLI_mempool *pool, const int threadid) ATTR_MALLOC ATTR_WARN_UNUSED_RESULT ATTR_NONNULL(1);
+void         BLI_mempool_free_threadsafe(BLI_mempool *pool, void *addr, const int threadid) ATTR_NONNULL(1, 2);
+
 #ifndef NDEBUG
 void        BLI_mempool_set_memory_debug(void);
 #endif
@@ -70,6 +77,8 @@ void        BLI_mempool_set_memory_debug(void);
 typedef struct BLI_mempool_iter {
 	BLI_mempool *pool;
 	struct BLI_mempool_chunk *curchunk;
+	/* chunk after the last one to iterate over, NULL for all chunks */
+	struct BLI_mempool_chunk *endchunk;
 	unsigned int curindex;
 } BLI_mempool_iter;
 
@@ -86,6 +95,8 @@ enum {
 
 void  BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter) ATTR_NONNULL();
 void *BLI_mempool_iterstep(BLI_mempool_iter *iter) ATTR_WARN_UNUSED_RESULT ATTR_NONNULL();
+unsigned int BLI_mempool_iter_ranges_init(BLI_mempool *pool, BLI_mempool_iter *iters,
+                                          unsigned int range_num) ATTR_NONNULL();
 
 #ifdef __cplusplus
 }
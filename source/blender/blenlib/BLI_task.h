@@ -153,6 +153,16 @@ void BLI_task_parallel_listbase(
         TaskParallelListbaseFunc func,
         const bool use_threading);
 
+struct BLI_mempool;
+typedef void (*TaskParallelMempoolFunc)(void *userdata,
+                                        void *elem,
+                                        const int thread_id);
+void BLI_task_parallel_mempool(
+        struct BLI_mempool *mempool,
+        void *userdata,
+        TaskParallelMempoolFunc func,
+        const bool use_threading);
+
 #ifdef __cplusplus
 }
 #endif
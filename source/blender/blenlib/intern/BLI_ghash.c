@@ -31,6 +31,9 @@
  * A general (pointer -> pointer) chaining hash table
  * for 'Abstract Data Types' (known as an ADT Hash Table).
  *
+ * Instances with #GHASH_FLAG_OPEN_ADDRESSING set use an open addressing table instead,
+ * see \ref ghash_slots.
+ *
  * \note edgehash.c is based on this, make sure they stay in sync.
  */
 
@@ -38,6 +41,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <limits.h>
+#include <stddef.h>
 
 #include "MEM_guardedalloc.h"
 
@@ -77,6 +81,12 @@ const unsigned int hashsizes[] = {
 #define GHASH_LIMIT_GROW(_nbkt)   (((_nbkt) * 3) /  4)
 #define GHASH_LIMIT_SHRINK(_nbkt) (((_nbkt) * 3) / 16)
 
+/* Number of slots of open addressing tables, always a power of two. */
+#define GHASH_SLOT_BIT_MIN 3
+#define GHASH_SLOT_BIT_MAX 30
+
+#define GHASH_SLOT_NONE UINT_MAX
+
 /***/
 
 /* WARNING! Keep in sync with ugly _gh_Entry in header!!! */
@@ -97,6 +107,27 @@ typedef Entry GSetEntry;
 #define GHASH_ENTRY_SIZE(_is_gset) \
 	((_is_gset) ? sizeof(GSetEntry) : sizeof(GHashEntry))
 
+typedef struct GHashSlotInfo {
+	unsigned int hash;
+	/* Distance of the slot to the ideal slot of the hash plus one, zero for empty slots. */
+	unsigned int dist;
+} GHashSlotInfo;
+
+/* Open addressing slots, see \ref ghash_slots. */
+typedef struct GHashSlot {
+	GHashSlotInfo info;
+	void *key;
+	void *val;
+} GHashSlot;
+
+typedef struct GSetSlot {
+	GHashSlotInfo info;
+	void *key;
+} GSetSlot;
+
+#define GHASH_SLOT_SIZE(_is_gset) \
+	((_is_gset) ? sizeof(GSetSlot) : sizeof(GHashSlot))
+
 struct GHash {
 	GHashHashFP hashfp;
 	GHashCmpFP cmpfp;
@@ -111,6 +142,11 @@ struct GHash {
 	unsigned int bucket_mask, bucket_bit, bucket_bit_min;
 #endif
 
+	/* Open addressing storage (#GHASH_FLAG_OPEN_ADDRESSING), nbuckets is the number of slots. */
+	char *slots;
+	unsigned int slot_size;
+	unsigned int slot_bit, slot_bit_min;
+
 	unsigned int nentries;
 	unsigned int flag;
 };
@@ -378,6 +414,360 @@ BLI_INLINE void ghash_buckets_reset(GHash *gh, const unsigned int nentries)
 	ghash_buckets_expand(gh, nentries, (nentries != 0));
 }
 
+/** \} */
+
+
+/** \name Open Addressing Storage
+ *
+ * \anchor ghash_slots
+ *
+ * With #GHASH_FLAG_OPEN_ADDRESSING entries are stored in a single array of slots instead of
+ * a mempool of entries chained in buckets, using Robin Hood hashing with backward shift deletion.
+ *
+ * Every slot stores the full hash and the probe distance of its entry before the key (and value),
+ * so probing touches a single cache line in most cases, and keys are only compared when their
+ * full hashes match (saving most string compares).
+ * The code shared with the chained storage and the iterator API use an #Entry view of the slots,
+ * where only the key and value are valid.
+ *
+ * \note Inserting and removing entries moves other entries, pointers returned by
+ * #BLI_ghash_lookup_p, #BLI_ghash_ensure_p & co. are only valid until the next change of the hash.
+ * \{ */
+
+BLI_INLINE GHashSlot *ghash_slot(GHash *gh, const unsigned int index)
+{
+	return (GHashSlot *)(gh->slots + (size_t)index * gh->slot_size);
+}
+
+BLI_INLINE Entry *ghash_slot_entry(GHashSlot *slot)
+{
+	return (Entry *)((char *)&slot->key - offsetof(Entry, key));
+}
+
+/**
+ * Copy a slot, sets use the smaller #GSetSlot.
+ */
+BLI_INLINE void ghash_slot_copy(const GHash *gh, GHashSlot *s_dst, const GHashSlot *s_src)
+{
+	if (gh->slot_size == sizeof(GHashSlot)) {
+		*s_dst = *s_src;
+	}
+	else {
+		*(GSetSlot *)s_dst = *(const GSetSlot *)s_src;
+	}
+}
+
+/**
+ * Get the ideal slot for an already-computed full hash.
+ * Multiplicative (Fibonacci) hashing, so hashes with few varying low bits still spread over all slots.
+ */
+BLI_INLINE unsigned int ghash_slot_index(GHash *gh, const unsigned int hash)
+{
+	return (hash * 2654435769u) >> (32 - gh->slot_bit);
+}
+
+/**
+ * Store the key (and value) of \a s_src, returning the slot they end up in.
+ * The table must have a free slot.
+ */
+static GHashSlot *ghash_slots_store(GHash *gh, const unsigned int hash, const GHashSlot *s_src)
+{
+	const unsigned int mask = gh->nbuckets - 1;
+	unsigned int index = ghash_slot_index(gh, hash);
+	GHashSlot s_curr, s_tmp;
+	GHashSlot *s_result = NULL;
+
+	ghash_slot_copy(gh, &s_curr, s_src);
+	s_curr.info.hash = hash;
+	s_curr.info.dist = 1;
+
+	while (true) {
+		GHashSlot *s = ghash_slot(gh, index);
+
+		if (s->info.dist == 0) {
+			ghash_slot_copy(gh, s, &s_curr);
+			return s_result ? s_result : s;
+		}
+
+		/* Take the slot of entries closer to their ideal slot, and continue storing those. */
+		if (s->info.dist < s_curr.info.dist) {
+			ghash_slot_copy(gh, &s_tmp, s);
+			ghash_slot_copy(gh, s, &s_curr);
+			ghash_slot_copy(gh, &s_curr, &s_tmp);
+			if (s_result == NULL) {
+				s_result = s;
+			}
+		}
+
+		index = (index + 1) & mask;
+		s_curr.info.dist++;
+	}
+}
+
+static void ghash_slots_resize(GHash *gh, const unsigned int slot_bit)
+{
+	char *slots_old = gh->slots;
+	const unsigned int nslots_old = gh->nbuckets;
+	unsigned int i;
+
+	gh->slot_bit = slot_bit;
+	gh->nbuckets = 1u << slot_bit;
+	gh->limit_grow   = GHASH_LIMIT_GROW(gh->nbuckets);
+	gh->limit_shrink = GHASH_LIMIT_SHRINK(gh->nbuckets);
+
+	gh->slots = MEM_callocN((size_t)gh->slot_size * gh->nbuckets, __func__);
+
+	if (slots_old) {
+		for (i = 0; i < nslots_old; i++) {
+			const GHashSlot *s = (const GHashSlot *)(slots_old + (size_t)i * gh->slot_size);
+			if (s->info.dist != 0) {
+				ghash_slots_store(gh, s->info.hash, s);
+			}
+		}
+		MEM_freeN(slots_old);
+	}
+}
+
+/**
+ * Open addressing version of #ghash_buckets_expand.
+ */
+static void ghash_slots_expand(
+        GHash *gh, const unsigned int nentries, const bool user_defined)
+{
+	unsigned int slot_bit = gh->slot_bit;
+
+	if (LIKELY(gh->slots && (nentries < gh->limit_grow))) {
+		return;
+	}
+
+	while ((nentries > GHASH_LIMIT_GROW(1u << slot_bit)) &&
+	       (slot_bit < GHASH_SLOT_BIT_MAX))
+	{
+		slot_bit++;
+	}
+
+	if (user_defined) {
+		gh->slot_bit_min = slot_bit;
+	}
+
+	if ((slot_bit == gh->slot_bit) && gh->slots) {
+		return;
+	}
+
+	ghash_slots_resize(gh, slot_bit);
+}
+
+/**
+ * Open addressing version of #ghash_buckets_contract.
+ */
+static void ghash_slots_contract(
+        GHash *gh, const unsigned int nentries, const bool user_defined, const bool force_shrink)
+{
+	unsigned int slot_bit = gh->slot_bit;
+
+	if (!(force_shrink || (gh->flag & GHASH_FLAG_ALLOW_SHRINK))) {
+		return;
+	}
+
+	if (LIKELY(gh->slots && (nentries > gh->limit_shrink))) {
+		return;
+	}
+
+	while ((nentries < GHASH_LIMIT_SHRINK(1u << slot_bit)) &&
+	       (slot_bit > gh->slot_bit_min))
+	{
+		slot_bit--;
+	}
+
+	if (user_defined) {
+		gh->slot_bit_min = slot_bit;
+	}
+
+	if ((slot_bit == gh->slot_bit) && gh->slots) {
+		return;
+	}
+
+	ghash_slots_resize(gh, slot_bit);
+}
+
+/**
+ * Clear and reset \a gh slots, reserve again slots for given number of entries.
+ */
+BLI_INLINE void ghash_slots_reset(GHash *gh, const unsigned int nentries)
+{
+	/* Small hashes are often cleared and filled again, keep their slots. */
+	if (gh->slots && (gh->slot_bit == GHASH_SLOT_BIT_MIN) &&
+	    (nentries < GHASH_LIMIT_GROW(1u << GHASH_SLOT_BIT_MIN)))
+	{
+		memset(gh->slots, 0, (size_t)gh->slot_size * gh->nbuckets);
+		gh->slot_bit_min = GHASH_SLOT_BIT_MIN;
+		gh->nentries = 0;
+		return;
+	}
+
+	MEM_SAFE_FREE(gh->slots);
+
+	gh->slot_bit = GHASH_SLOT_BIT_MIN;
+	gh->slot_bit_min = GHASH_SLOT_BIT_MIN;
+	gh->nentries = 0;
+
+	ghash_slots_expand(gh, nentries, (nentries != 0));
+}
+
+/**
+ * Find the slot of \a key, or #GHASH_SLOT_NONE.
+ */
+BLI_INLINE unsigned int ghash_slots_lookup_index(GHash *gh, const void *key, const unsigned int hash)
+{
+	const unsigned int mask = gh->nbuckets - 1;
+	unsigned int index = ghash_slot_index(gh, hash);
+	unsigned int dist;
+
+	/* Entries are ordered by distance to their ideal slot,
+	 * once that is smaller than ours the key can't follow anymore. */
+	for (dist = 1; ; dist++) {
+		const GHashSlot *s = ghash_slot(gh, index);
+
+		if (s->info.dist < dist) {
+			return GHASH_SLOT_NONE;
+		}
+		if ((s->info.hash == hash) && (gh->cmpfp(key, s->key) == false)) {
+			return index;
+		}
+		index = (index + 1) & mask;
+	}
+}
+
+BLI_INLINE Entry *ghash_slots_lookup_entry(GHash *gh, const void *key, const unsigned int hash)
+{
+	const unsigned int index = ghash_slots_lookup_index(gh, key, hash);
+	return (index != GHASH_SLOT_NONE) ? ghash_slot_entry(ghash_slot(gh, index)) : NULL;
+}
+
+/**
+ * Insert a new entry, returning the #Entry view of its slot.
+ */
+static Entry *ghash_slots_insert(GHash *gh, const unsigned int hash, void *key, void *val)
+{
+	GHashSlot s = {{0, 0}, key, val};
+
+	BLI_assert((gh->flag & GHASH_FLAG_ALLOW_DUPES) || (BLI_ghash_haskey(gh, key) == 0));
+
+	ghash_slots_expand(gh, ++gh->nentries, false);
+	return ghash_slot_entry(ghash_slots_store(gh, hash, &s));
+}
+
+/**
+ * Remove the entry of a slot, shifting back the following entries which are not in their ideal slot.
+ */
+static void ghash_slots_remove_index(GHash *gh, unsigned int index)
+{
+	const unsigned int mask = gh->nbuckets - 1;
+	GHashSlot *s = ghash_slot(gh, index);
+	GHashSlot *s_next;
+
+	while ((s_next = ghash_slot(gh, (index = (index + 1) & mask)))->info.dist > 1) {
+		ghash_slot_copy(gh, s, s_next);
+		s->info.dist--;
+		s = s_next;
+	}
+	s->info.dist = 0;
+
+	ghash_slots_contract(gh, --gh->nentries, false, false);
+}
+
+/**
+ * Copy the key (and value) of a slot to \a r_e.
+ */
+BLI_INLINE void ghash_slot_to_entry(GHash *gh, const GHashSlot *s, GHashEntry *r_e)
+{
+	r_e->e.key = s->key;
+	r_e->val = (gh->flag & GHASH_FLAG_IS_GSET) ? NULL : s->val;
+}
+
+/**
+ * Remove \a key, copying its entry to \a r_e.
+ * \return false if \a key isn't in \a gh.
+ */
+static bool ghash_slots_remove(
+        GHash *gh, const void *key,
+        GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp,
+        GHashEntry *r_e)
+{
+	const unsigned int index = ghash_slots_lookup_index(gh, key, ghash_keyhash(gh, key));
+	GHashSlot *s;
+
+	BLI_assert(!valfreefp || !(gh->flag & GHASH_FLAG_IS_GSET));
+
+	if (index == GHASH_SLOT_NONE) {
+		return false;
+	}
+
+	s = ghash_slot(gh, index);
+	if (keyfreefp) {
+		keyfreefp(s->key);
+	}
+	if (valfreefp) {
+		valfreefp(s->val);
+	}
+
+	ghash_slot_to_entry(gh, s, r_e);
+	ghash_slots_remove_index(gh, index);
+	return true;
+}
+
+/**
+ * Open addressing version of #ghash_pop, copies the removed entry to \a r_e.
+ */
+static bool ghash_slots_pop(GHash *gh, GHashIterState *state, GHashEntry *r_e)
+{
+	unsigned int index = state->curr_bucket;
+
+	if (gh->nentries == 0) {
+		return false;
+	}
+
+	if (index >= gh->nbuckets) {
+		index = 0;
+	}
+	while (ghash_slot(gh, index)->info.dist == 0) {
+		index = (index + 1) & (gh->nbuckets - 1);
+	}
+
+	ghash_slot_to_entry(gh, ghash_slot(gh, index), r_e);
+	ghash_slots_remove_index(gh, index);
+
+	/* The next entry may have been shifted back into this slot, start from there. */
+	state->curr_bucket = index;
+	return true;
+}
+
+/**
+ * Find the next used slot from \a index for the iterator.
+ */
+BLI_INLINE void ghash_slots_iterator_next(GHashIterator *ghi, unsigned int index)
+{
+	GHash *gh = ghi->gh;
+
+	for (; index < gh->nbuckets; index++) {
+		GHashSlot *s = ghash_slot(gh, index);
+		if (s->info.dist != 0) {
+			ghi->curBucket = index;
+			ghi->curEntry = ghash_slot_entry(s);
+			return;
+		}
+	}
+
+	ghi->curBucket = gh->nbuckets;
+	ghi->curEntry = NULL;
+}
+
+/** \} */
+
+
+/** \name Internal Lookup & Insert API
+ * \{ */
+
 /**
  * Internal lookup function.
  * Takes hash and bucket_index arguments to avoid calling #ghash_keyhash and #ghash_bucket_index multiple times.
@@ -425,8 +815,43 @@ BLI_INLINE Entry *ghash_lookup_entry_prev_ex(
 BLI_INLINE Entry *ghash_lookup_entry(GHash *gh, const void *key)
 {
 	const unsigned int hash = ghash_keyhash(gh, key);
-	const unsigned int bucket_index = ghash_bucket_index(gh, hash);
-	return ghash_lookup_entry_ex(gh, key, bucket_index);
+
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		return ghash_slots_lookup_entry(gh, key, hash);
+	}
+	else {
+		const unsigned int bucket_index = ghash_bucket_index(gh, hash);
+		return ghash_lookup_entry_ex(gh, key, bucket_index);
+	}
+}
+
+/**
+ * Create the storage of \a gh for its flags.
+ */
+static void ghash_storage_init(GHash *gh, const unsigned int nentries_reserve)
+{
+	gh->buckets = NULL;
+	gh->entrypool = NULL;
+	gh->slots = NULL;
+	gh->slot_size = (unsigned int)GHASH_SLOT_SIZE(gh->flag & GHASH_FLAG_IS_GSET);
+
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		ghash_slots_reset(gh, nentries_reserve);
+	}
+	else {
+		ghash_buckets_reset(gh, nentries_reserve);
+		gh->entrypool = BLI_mempool_create(GHASH_ENTRY_SIZE(gh->flag & GHASH_FLAG_IS_GSET), 64, 64, BLI_MEMPOOL_NOP);
+	}
+}
+
+static void ghash_storage_free(GHash *gh)
+{
+	MEM_SAFE_FREE(gh->buckets);
+	MEM_SAFE_FREE(gh->slots);
+	if (gh->entrypool) {
+		BLI_mempool_destroy(gh->entrypool);
+		gh->entrypool = NULL;
+	}
 }
 
 static GHash *ghash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
@@ -437,11 +862,9 @@ static GHash *ghash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
 	gh->hashfp = hashfp;
 	gh->cmpfp = cmpfp;
 
-	gh->buckets = NULL;
 	gh->flag = flag;
 
-	ghash_buckets_reset(gh, nentries_reserve);
-	gh->entrypool = BLI_mempool_create(GHASH_ENTRY_SIZE(flag & GHASH_FLAG_IS_GSET), 64, 64, BLI_MEMPOOL_NOP);
+	ghash_storage_init(gh, nentries_reserve);
 
 	return gh;
 }
@@ -503,9 +926,15 @@ BLI_INLINE void ghash_insert_ex_keyonly(
 BLI_INLINE void ghash_insert(GHash *gh, void *key, void *val)
 {
 	const unsigned int hash = ghash_keyhash(gh, key);
-	const unsigned int bucket_index = ghash_bucket_index(gh, hash);
 
-	ghash_insert_ex(gh, key, val, bucket_index);
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
+		ghash_slots_insert(gh, hash, key, val);
+	}
+	else {
+		const unsigned int bucket_index = ghash_bucket_index(gh, hash);
+		ghash_insert_ex(gh, key, val, bucket_index);
+	}
 }
 
 BLI_INLINE bool ghash_insert_safe(
@@ -513,8 +942,10 @@ BLI_INLINE bool ghash_insert_safe(
         GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
 {
 	const unsigned int hash = ghash_keyhash(gh, key);
-	const unsigned int bucket_index = ghash_bucket_index(gh, hash);
-	GHashEntry *e = (GHashEntry *)ghash_lookup_entry_ex(gh, key, bucket_index);
+	const bool use_slots = (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) != 0;
+	const unsigned int bucket_index = use_slots ? 0 : ghash_bucket_index(gh, hash);
+	GHashEntry *e = (GHashEntry *)(use_slots ? ghash_slots_lookup_entry(gh, key, hash) :
+	                                           ghash_lookup_entry_ex(gh, key, bucket_index));
 
 	BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
 
@@ -531,6 +962,10 @@ BLI_INLINE bool ghash_insert_safe(
 		}
 		return false;
 	}
+	else if (use_slots) {
+		ghash_slots_insert(gh, hash, key, val);
+		return true;
+	}
 	else {
 		ghash_insert_ex(gh, key, val, bucket_index);
 		return true;
@@ -542,8 +977,9 @@ BLI_INLINE bool ghash_insert_safe_keyonly(
         GHashKeyFreeFP keyfreefp)
 {
 	const unsigned int hash = ghash_keyhash(gh, key);
-	const unsigned int bucket_index = ghash_bucket_index(gh, hash);
-	Entry *e = ghash_lookup_entry_ex(gh, key, bucket_index);
+	const bool use_slots = (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) != 0;
+	const unsigned int bucket_index = use_slots ? 0 : ghash_bucket_index(gh, hash);
+	Entry *e = use_slots ? ghash_slots_lookup_entry(gh, key, hash) : ghash_lookup_entry_ex(gh, key, bucket_index);
 
 	BLI_assert((gh->flag & GHASH_FLAG_IS_GSET) != 0);
 
@@ -556,6 +992,10 @@ BLI_INLINE bool ghash_insert_safe_keyonly(
 		}
 		return false;
 	}
+	else if (use_slots) {
+		ghash_slots_insert(gh, hash, key, NULL);
+		return true;
+	}
 	else {
 		ghash_insert_ex_keyonly(gh, key, bucket_index);
 		return true;
@@ -631,6 +1071,21 @@ static void ghash_free_cb(
 	BLI_assert(keyfreefp  || valfreefp);
 	BLI_assert(!valfreefp || !(gh->flag & GHASH_FLAG_IS_GSET));
 
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		for (i = 0; i < gh->nbuckets; i++) {
+			GHashSlot *s = ghash_slot(gh, i);
+			if (s->info.dist != 0) {
+				if (keyfreefp) {
+					keyfreefp(s->key);
+				}
+				if (valfreefp) {
+					valfreefp(s->val);
+				}
+			}
+		}
+		return;
+	}
+
 	for (i = 0; i < gh->nbuckets; i++) {
 		Entry *e;
 
@@ -658,6 +1113,27 @@ static GHash *ghash_copy(GHash *gh, GHashKeyCopyFP keycopyfp, GHashValCopyFP val
 	BLI_assert(!valcopyfp || !(gh->flag & GHASH_FLAG_IS_GSET));
 
 	gh_new = ghash_new(gh->hashfp, gh->cmpfp, __func__, 0, gh->flag);
+
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		/* Same slots, so the entries can stay in place. */
+		ghash_slots_resize(gh_new, gh->slot_bit);
+		gh_new->slot_bit_min = gh->slot_bit_min;
+		memcpy(gh_new->slots, gh->slots, (size_t)gh->slot_size * gh->nbuckets);
+
+		if (keycopyfp || valcopyfp) {
+			for (i = 0; i < gh->nbuckets; i++) {
+				GHashSlot *s = ghash_slot(gh, i);
+				if (s->info.dist != 0) {
+					ghash_entry_copy(gh_new, ghash_slot_entry(ghash_slot(gh_new, i)), gh, ghash_slot_entry(s),
+					                 keycopyfp, valcopyfp);
+				}
+			}
+		}
+		gh_new->nentries = gh->nentries;
+
+		return gh_new;
+	}
+
 	ghash_buckets_expand(gh_new, reserve_nentries_new, false);
 
 	BLI_assert(gh_new->nbuckets == gh->nbuckets);
@@ -683,6 +1159,42 @@ static GHash *ghash_copy(GHash *gh, GHashKeyCopyFP keycopyfp, GHashValCopyFP val
 	return gh_new;
 }
 
+/**
+ * Move all entries to the storage of the new \a flag, when #GHASH_FLAG_OPEN_ADDRESSING changes.
+ */
+static void ghash_storage_convert(GHash *gh, const unsigned int flag)
+{
+	GHash gh_old = *gh;
+	GHashIterator ghi;
+	const bool is_gset = (flag & GHASH_FLAG_IS_GSET) != 0;
+
+	gh->flag = flag;
+	ghash_storage_init(gh, 0);
+
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		ghash_slots_expand(gh, gh_old.nentries, false);
+	}
+	else {
+		ghash_buckets_expand(gh, gh_old.nentries, false);
+	}
+
+	/* Duplicates are allowed here, they were in the old storage. */
+	gh->flag |= GHASH_FLAG_ALLOW_DUPES;
+	GHASH_ITER (ghi, &gh_old) {
+		void *key = BLI_ghashIterator_getKey(&ghi);
+
+		if (is_gset) {
+			BLI_gset_insert((GSet *)gh, key);
+		}
+		else {
+			ghash_insert(gh, key, BLI_ghashIterator_getValue(&ghi));
+		}
+	}
+	gh->flag = flag;
+
+	ghash_storage_free(&gh_old);
+}
+
 /** \} */
 
 
@@ -726,8 +1238,14 @@ GHash *BLI_ghash_copy(GHash *gh, GHashKeyCopyFP keycopyfp, GHashValCopyFP valcop
  */
 void BLI_ghash_reserve(GHash *gh, const unsigned int nentries_reserve)
 {
-	ghash_buckets_expand(gh, nentries_reserve, true);
-	ghash_buckets_contract(gh, nentries_reserve, true, false);
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		ghash_slots_expand(gh, nentries_reserve, true);
+		ghash_slots_contract(gh, nentries_reserve, true, false);
+	}
+	else {
+		ghash_buckets_expand(gh, nentries_reserve, true);
+		ghash_buckets_contract(gh, nentries_reserve, true, false);
+	}
 }
 
 /**
@@ -822,6 +1340,16 @@ void **BLI_ghash_lookup_p(GHash *gh, const void *key)
 bool BLI_ghash_ensure_p(GHash *gh, void *key, void ***r_val)
 {
 	const unsigned int hash = ghash_keyhash(gh, key);
+
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		const unsigned int index = ghash_slots_lookup_index(gh, key, hash);
+		const bool haskey = (index != GHASH_SLOT_NONE);
+		GHashEntry *e = (GHashEntry *)(haskey ? ghash_slot_entry(ghash_slot(gh, index)) : ghash_slots_insert(gh, hash, key, NULL));
+
+		*r_val = &e->val;
+		return haskey;
+	}
+
 	const unsigned int bucket_index = ghash_bucket_index(gh, hash);
 	GHashEntry *e = (GHashEntry *)ghash_lookup_entry_ex(gh, key, bucket_index);
 	const bool haskey = (e != NULL);
@@ -845,6 +1373,25 @@ bool BLI_ghash_ensure_p_ex(
         GHash *gh, const void *key, void ***r_key, void ***r_val)
 {
 	const unsigned int hash = ghash_keyhash(gh, key);
+
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		const unsigned int index = ghash_slots_lookup_index(gh, key, hash);
+		const bool haskey = (index != GHASH_SLOT_NONE);
+		GHashEntry *e;
+
+		if (haskey) {
+			e = (GHashEntry *)ghash_slot_entry(ghash_slot(gh, index));
+		}
+		else {
+			e = (GHashEntry *)ghash_slots_insert(gh, hash, (void *)key, NULL);
+			e->e.key = NULL;  /* caller must re-assign */
+		}
+
+		*r_key = &e->e.key;
+		*r_val = &e->val;
+		return haskey;
+	}
+
 	const unsigned int bucket_index = ghash_bucket_index(gh, hash);
 	GHashEntry *e = (GHashEntry *)ghash_lookup_entry_ex(gh, key, bucket_index);
 	const bool haskey = (e != NULL);
@@ -871,6 +1418,11 @@ bool BLI_ghash_ensure_p_ex(
  */
 bool BLI_ghash_remove(GHash *gh, const void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
 {
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		GHashEntry e;
+		return ghash_slots_remove(gh, key, keyfreefp, valfreefp, &e);
+	}
+
 	const unsigned int hash = ghash_keyhash(gh, key);
 	const unsigned int bucket_index = ghash_bucket_index(gh, hash);
 	Entry *e = ghash_remove_ex(gh, key, keyfreefp, valfreefp, bucket_index);
@@ -894,6 +1446,12 @@ bool BLI_ghash_remove(GHash *gh, const void *key, GHashKeyFreeFP keyfreefp, GHas
  */
 void *BLI_ghash_popkey(GHash *gh, const void *key, GHashKeyFreeFP keyfreefp)
 {
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		GHashEntry e;
+		BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
+		return ghash_slots_remove(gh, key, keyfreefp, NULL, &e) ? e.val : NULL;
+	}
+
 	const unsigned int hash = ghash_keyhash(gh, key);
 	const unsigned int bucket_index = ghash_bucket_index(gh, hash);
 	GHashEntry *e = (GHashEntry *)ghash_remove_ex(gh, key, keyfreefp, NULL, bucket_index);
@@ -928,10 +1486,21 @@ bool BLI_ghash_pop(
         GHash *gh, GHashIterState *state,
         void **r_key, void **r_val)
 {
-	GHashEntry *e = (GHashEntry *)ghash_pop(gh, state);
-
 	BLI_assert(!(gh->flag & GHASH_FLAG_IS_GSET));
 
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		GHashEntry e;
+		if (ghash_slots_pop(gh, state, &e)) {
+			*r_key = e.e.key;
+			*r_val = e.val;
+			return true;
+		}
+		*r_key = *r_val = NULL;
+		return false;
+	}
+
+	GHashEntry *e = (GHashEntry *)ghash_pop(gh, state);
+
 	if (e) {
 		*r_key = e->e.key;
 		*r_val = e->val;
@@ -958,6 +1527,11 @@ void BLI_ghash_clear_ex(GHash *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valf
 	if (keyfreefp || valfreefp)
 		ghash_free_cb(gh, keyfreefp, valfreefp);
 
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		ghash_slots_reset(gh, nentries_reserve);
+		return;
+	}
+
 	ghash_buckets_reset(gh, nentries_reserve);
 	BLI_mempool_clear_ex(gh->entrypool, nentries_reserve ? (int)nentries_reserve : -1);
 }
@@ -979,21 +1553,29 @@ void BLI_ghash_clear(GHash *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfree
  */
 void BLI_ghash_free(GHash *gh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
 {
-	BLI_assert((int)gh->nentries == BLI_mempool_count(gh->entrypool));
+	BLI_assert(!gh->entrypool || ((int)gh->nentries == BLI_mempool_count(gh->entrypool)));
 	if (keyfreefp || valfreefp)
 		ghash_free_cb(gh, keyfreefp, valfreefp);
 
-	MEM_freeN(gh->buckets);
-	BLI_mempool_destroy(gh->entrypool);
+	ghash_storage_free(gh);
 	MEM_freeN(gh);
 }
 
 /**
  * Sets a GHash flag.
+ *
+ * \note Setting #GHASH_FLAG_OPEN_ADDRESSING moves all entries, it's best done on an empty hash.
  */
 void BLI_ghash_flag_set(GHash *gh, unsigned int flag)
 {
-	gh->flag |= flag;
+	const unsigned int flag_new = gh->flag | flag;
+
+	if ((flag_new ^ gh->flag) & GHASH_FLAG_OPEN_ADDRESSING) {
+		ghash_storage_convert(gh, flag_new);
+	}
+	else {
+		gh->flag = flag_new;
+	}
 }
 
 /**
@@ -1001,7 +1583,14 @@ void BLI_ghash_flag_set(GHash *gh, unsigned int flag)
  */
 void BLI_ghash_flag_clear(GHash *gh, unsigned int flag)
 {
-	gh->flag &= ~flag;
+	const unsigned int flag_new = gh->flag & ~flag;
+
+	if ((flag_new ^ gh->flag) & GHASH_FLAG_OPEN_ADDRESSING) {
+		ghash_storage_convert(gh, flag_new);
+	}
+	else {
+		gh->flag = flag_new;
+	}
 }
 
 /** \} */
@@ -1041,7 +1630,12 @@ void BLI_ghashIterator_init(GHashIterator *ghi, GHash *gh)
 	ghi->gh = gh;
 	ghi->curEntry = NULL;
 	ghi->curBucket = UINT_MAX;  /* wraps to zero */
-	if (gh->nentries) {
+	if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		if (gh->nentries) {
+			ghash_slots_iterator_next(ghi, 0);
+		}
+	}
+	else if (gh->nentries) {
 		do {
 			ghi->curBucket++;
 			if (UNLIKELY(ghi->curBucket == ghi->gh->nbuckets))
@@ -1058,7 +1652,12 @@ void BLI_ghashIterator_init(GHashIterator *ghi, GHash *gh)
  */
 void BLI_ghashIterator_step(GHashIterator *ghi)
 {
-	if (ghi->curEntry) {
+	if (ghi->gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		if (ghi->curEntry) {
+			ghash_slots_iterator_next(ghi, ghi->curBucket + 1);
+		}
+	}
+	else if (ghi->curEntry) {
 		ghi->curEntry = ghi->curEntry->next;
 		while (!ghi->curEntry) {
 			ghi->curBucket++;
@@ -1379,8 +1978,14 @@ unsigned int BLI_gset_size(GSet *gs)
 void BLI_gset_insert(GSet *gs, void *key)
 {
 	const unsigned int hash = ghash_keyhash((GHash *)gs, key);
-	const unsigned int bucket_index = ghash_bucket_index((GHash *)gs, hash);
-	ghash_insert_ex_keyonly((GHash *)gs, key, bucket_index);
+
+	if (((GHash *)gs)->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		ghash_slots_insert((GHash *)gs, hash, key, NULL);
+	}
+	else {
+		const unsigned int bucket_index = ghash_bucket_index((GHash *)gs, hash);
+		ghash_insert_ex_keyonly((GHash *)gs, key, bucket_index);
+	}
 }
 
 /**
@@ -1403,6 +2008,24 @@ bool BLI_gset_add(GSet *gs, void *key)
 bool BLI_gset_ensure_p_ex(GSet *gs, const void *key, void ***r_key)
 {
 	const unsigned int hash = ghash_keyhash((GHash *)gs, key);
+
+	if (((GHash *)gs)->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		const unsigned int index = ghash_slots_lookup_index((GHash *)gs, key, hash);
+		const bool haskey = (index != GHASH_SLOT_NONE);
+		GSetEntry *e;
+
+		if (haskey) {
+			e = ghash_slot_entry(ghash_slot((GHash *)gs, index));
+		}
+		else {
+			e = ghash_slots_insert((GHash *)gs, hash, (void *)key, NULL);
+			e->key = NULL;  /* caller must re-assign */
+		}
+
+		*r_key = &e->key;
+		return haskey;
+	}
+
 	const unsigned int bucket_index = ghash_bucket_index((GHash *)gs, hash);
 	GSetEntry *e = (GSetEntry *)ghash_lookup_entry_ex((GHash *)gs, key, bucket_index);
 	const bool haskey = (e != NULL);
@@ -1451,6 +2074,16 @@ bool BLI_gset_pop(
         GSet *gs, GSetIterState *state,
         void **r_key)
 {
+	if (((GHash *)gs)->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+		GHashEntry e;
+		if (ghash_slots_pop((GHash *)gs, (GHashIterState *)state, &e)) {
+			*r_key = e.e.key;
+			return true;
+		}
+		*r_key = NULL;
+		return false;
+	}
+
 	GSetEntry *e = (GSetEntry *)ghash_pop((GHash *)gs, (GHashIterState *)state);
 
 	if (e) {
@@ -1484,12 +2117,12 @@ void BLI_gset_free(GSet *gs, GSetKeyFreeFP keyfreefp)
 
 void BLI_gset_flag_set(GSet *gs, unsigned int flag)
 {
-	((GHash *)gs)->flag |= flag;
+	BLI_ghash_flag_set((GHash *)gs, flag);
 }
 
 void BLI_gset_flag_clear(GSet *gs, unsigned int flag)
 {
-	((GHash *)gs)->flag &= ~flag;
+	BLI_ghash_flag_clear((GHash *)gs, flag);
 }
 
 /** \} */
@@ -1545,6 +2178,31 @@ int BLI_gset_buckets_size(GSet *gs)
 	return BLI_ghash_buckets_size((GHash *)gs);
 }
 
+/**
+ * Number of entries in each bucket, with open addressing the number of entries for which each slot is ideal.
+ */
+static unsigned int *ghash_bucket_counts(GHash *gh)
+{
+	unsigned int *counts = MEM_callocN(sizeof(*counts) * gh->nbuckets, __func__);
+	unsigned int i;
+
+	for (i = 0; i < gh->nbuckets; i++) {
+		if (gh->flag & GHASH_FLAG_OPEN_ADDRESSING) {
+			const GHashSlot *s = ghash_slot(gh, i);
+			if (s->info.dist != 0) {
+				counts[ghash_slot_index(gh, s->info.hash)]++;
+			}
+		}
+		else {
+			for (Entry *e = gh->buckets[i]; e; e = e->next) {
+				counts[i]++;
+			}
+		}
+	}
+
+	return counts;
+}
+
 /**
  * Measure how well the hash function performs (1.0 is approx as good as random distribution),
  * and return a few other stats like load, variance of the distribution of the entries in the buckets, etc.
@@ -1556,6 +2214,7 @@ double BLI_ghash_calc_quality_ex(
         double *r_prop_empty_buckets, double *r_prop_overloaded_buckets, int *r_biggest_bucket)
 {
 	double mean;
+	unsigned int *counts;
 	unsigned int i;
 
 	if (gh->nentries == 0) {
@@ -1578,6 +2237,7 @@ double BLI_ghash_calc_quality_ex(
 		return 0.0;
 	}
 
+	counts = ghash_bucket_counts(gh);
 	mean = (double)gh->nentries / (double)gh->nbuckets;
 	if (r_load) {
 		*r_load = mean;
@@ -1592,12 +2252,8 @@ double BLI_ghash_calc_quality_ex(
 		 */
 		double sum = 0.0;
 		for (i = 0; i < gh->nbuckets; i++) {
-			int count = 0;
-			Entry *e;
-			for (e = gh->buckets[i]; e; e = e->next) {
-				count++;
-			}
-			sum += ((double)count - mean) * ((double)count - mean);
+			const double count = (double)counts[i];
+			sum += (count - mean) * (count - mean);
 		}
 		*r_variance = sum / (double)(gh->nbuckets - 1);
 	}
@@ -1609,11 +2265,7 @@ double BLI_ghash_calc_quality_ex(
 		uint64_t sum_empty = 0;
 
 		for (i = 0; i < gh->nbuckets; i++) {
-			uint64_t count = 0;
-			Entry *e;
-			for (e = gh->buckets[i]; e; e = e->next) {
-				count++;
-			}
+			const uint64_t count = counts[i];
 			if (r_biggest_bucket) {
 				*r_biggest_bucket = max_ii(*r_biggest_bucket, (int)count);
 			}
@@ -1631,6 +2283,7 @@ double BLI_ghash_calc_quality_ex(
 		if (r_prop_empty_buckets) {
 			*r_prop_empty_buckets = (double)sum_empty / (double)gh->nbuckets;
 		}
+		MEM_freeN(counts);
 		return ((double)sum * (double)gh->nbuckets /
 		        ((double)gh->nentries * (gh->nentries + 2 * gh->nbuckets - 1)));
 	}
@@ -38,8 +38,12 @@
  *
  * - Ray-cast:
  *   #BLI_bvhtree_ray_cast, #BVHRayCastData
+ * - Batched ray-cast, in packets of rays:
+ *   #BLI_bvhtree_ray_cast_batch, #BVHRayPacket
  * - Nearest point on surface:
  *   #BLI_bvhtree_find_nearest, #BVHNearestData
+ * - Batched nearest point on surface:
+ *   #BLI_bvhtree_find_nearest_batch, #BVHNearestPacket
  * - Overlapping 2 trees:
  *   #BLI_bvhtree_overlap, #BVHOverlapData_Shared, #BVHOverlapData_Thread
  * - Range Query:
@@ -48,6 +52,10 @@
 
 #include <assert.h>
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 #include "MEM_guardedalloc.h"
 
 #include "BLI_utildefines.h"
@@ -58,6 +66,8 @@
 #include "BLI_strict_flags.h"
 #include "BLI_task.h"
 
+#include "atomic_ops.h"
+
 /* used for iterative_raycast */
 // #define USE_SKIP_LINKS
 
@@ -68,10 +78,18 @@
  */
 #ifdef DEBUG
 #  define KDOPBVH_THREAD_LEAF_THRESHOLD 0
+#  define KDOPBVH_THREAD_QUERY_THRESHOLD 0
 #else
 #  define KDOPBVH_THREAD_LEAF_THRESHOLD 1024
+#  define KDOPBVH_THREAD_QUERY_THRESHOLD 256
 #endif
 
+/* Number of bins of the leaf centroids the SAH split positions are evaluated for. */
+#define KDOPBVH_SAH_BINS 16
+
+/* Number of rays or points traversing the tree together in the batched queries. */
+#define BVH_PACKET_SIZE 4
+
 
 /* -------------------------------------------------------------------- */
 
@@ -934,6 +952,326 @@ static void non_recursive_bvh_div_nodes(BVHTree *tree, BVHNode *branches_array,
 /** \} */
 
 
+/* -------------------------------------------------------------------- */
+
+/** \name SAH Balance
+ *
+ * Top-down build splitting the leafs with the surface area heuristic (SAH): the cost of a split is
+ * the number of leafs times the surface area of their bounds, summed for both sides. Split positions
+ * are evaluated at the borders of #KDOPBVH_SAH_BINS bins of the leaf centroids along the x, y and z axes.
+ * Nodes get up to tree_type children by splitting the child with the most leafs again.
+ *
+ * Unlike the implicit tree the number of branches depends on the splits, up to one less than the leafs.
+ * Branches are allocated when their parent is split, so children still have a greater index than
+ * their parent (needed by #BLI_bvhtree_update_tree). Large sub-trees are built in parallel.
+ *
+ * \note Only the x, y and z axes are used to split, like #get_largest_axis.
+ * \{ */
+
+typedef struct BVHSAHBuildData {
+	BVHTree *tree;
+	BVHNode *branches_array;
+	uint32_t branches_num;
+	TaskPool *pool;
+} BVHSAHBuildData;
+
+typedef struct BVHSAHBuildTask {
+	BVHNode *node;
+	int begin, end;
+} BVHSAHBuildTask;
+
+typedef struct BVHSAHBin {
+	float min[3], max[3];
+	int count;
+} BVHSAHBin;
+
+static float bvh_sah_area(const float min[3], const float max[3])
+{
+	const float d[3] = {max[0] - min[0], max[1] - min[1], max[2] - min[2]};
+	return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+}
+
+static void bvh_sah_leaf_centroid(const BVHNode *node, float r_co[3])
+{
+	r_co[0] = (node->bv[0] + node->bv[1]) * 0.5f;
+	r_co[1] = (node->bv[2] + node->bv[3]) * 0.5f;
+	r_co[2] = (node->bv[4] + node->bv[5]) * 0.5f;
+}
+
+BLI_INLINE int bvh_sah_bin_index(const float co, const float min, const float scale)
+{
+	return min_ii((int)((co - min) * scale), KDOPBVH_SAH_BINS - 1);
+}
+
+/**
+ * Split the leafs in the ( begin, end ] range in two, sorting them in place.
+ * \return The first leaf of the second part.
+ */
+static int bvh_sah_split(BVHNode **leafs_array, int begin, int end, int *r_axis)
+{
+	BVHSAHBin bins[3][KDOPBVH_SAH_BINS];
+	float area_right[KDOPBVH_SAH_BINS];
+	int count_right[KDOPBVH_SAH_BINS];
+	float co_min[3], co_max[3], scale[3], co[3];
+	float cost_best = FLT_MAX;
+	int axis_best = -1, bin_best = 0;
+	int i, j, axis;
+
+	INIT_MINMAX(co_min, co_max);
+	for (i = begin; i < end; i++) {
+		bvh_sah_leaf_centroid(leafs_array[i], co);
+		minmax_v3v3_v3(co_min, co_max, co);
+	}
+
+	for (axis = 0; axis < 3; axis++) {
+		const float extent = co_max[axis] - co_min[axis];
+		scale[axis] = (extent > FLT_EPSILON) ? (float)KDOPBVH_SAH_BINS / extent : 0.0f;
+
+		for (j = 0; j < KDOPBVH_SAH_BINS; j++) {
+			INIT_MINMAX(bins[axis][j].min, bins[axis][j].max);
+			bins[axis][j].count = 0;
+		}
+	}
+
+	/* fill the bins */
+	for (i = begin; i < end; i++) {
+		const float *bv = leafs_array[i]->bv;
+		const float bv_min[3] = {bv[0], bv[2], bv[4]};
+		const float bv_max[3] = {bv[1], bv[3], bv[5]};
+
+		bvh_sah_leaf_centroid(leafs_array[i], co);
+		for (axis = 0; axis < 3; axis++) {
+			if (scale[axis] != 0.0f) {
+				BVHSAHBin *bin = &bins[axis][bvh_sah_bin_index(co[axis], co_min[axis], scale[axis])];
+				minmax_v3v3_v3(bin->min, bin->max, bv_min);
+				minmax_v3v3_v3(bin->min, bin->max, bv_max);
+				bin->count++;
+			}
+		}
+	}
+
+	/* sweep the bins from both sides */
+	for (axis = 0; axis < 3; axis++) {
+		float min[3], max[3];
+		int count = 0;
+
+		if (scale[axis] == 0.0f) {
+			continue;
+		}
+
+		INIT_MINMAX(min, max);
+		for (j = KDOPBVH_SAH_BINS - 1; j > 0; j--) {
+			const BVHSAHBin *bin = &bins[axis][j];
+			if (bin->count) {
+				minmax_v3v3_v3(min, max, bin->min);
+				minmax_v3v3_v3(min, max, bin->max);
+				count += bin->count;
+			}
+			area_right[j] = count ? bvh_sah_area(min, max) : 0.0f;
+			count_right[j] = count;
+		}
+
+		INIT_MINMAX(min, max);
+		count = 0;
+		for (j = 0; j < KDOPBVH_SAH_BINS - 1; j++) {
+			const BVHSAHBin *bin = &bins[axis][j];
+			if (bin->count) {
+				minmax_v3v3_v3(min, max, bin->min);
+				minmax_v3v3_v3(min, max, bin->max);
+				count += bin->count;
+			}
+			if (count && count_right[j + 1]) {
+				const float cost = bvh_sah_area(min, max) * (float)count + area_right[j + 1] * (float)count_right[j + 1];
+				if (cost < cost_best) {
+					cost_best = cost;
+					axis_best = axis;
+					bin_best = j;
+				}
+			}
+		}
+	}
+
+	if (axis_best == -1) {
+		/* all centroids at the same position, any split is as good */
+		*r_axis = 0;
+		return (begin + end) / 2;
+	}
+
+	/* move the leafs of the bins up to bin_best to the start */
+	i = begin;
+	j = end - 1;
+	while (i <= j) {
+		bvh_sah_leaf_centroid(leafs_array[i], co);
+		if (bvh_sah_bin_index(co[axis_best], co_min[axis_best], scale[axis_best]) <= bin_best) {
+			i++;
+		}
+		else {
+			SWAP(BVHNode *, leafs_array[i], leafs_array[j]);
+			j--;
+		}
+	}
+
+	*r_axis = axis_best;
+	return i;
+}
+
+/**
+ * Split the leafs of \a node in up to tree_type children.
+ * \return The number of children which are branches to split further, written to \a r_tasks.
+ */
+static int bvh_sah_div_node(BVHSAHBuildData *data, BVHNode *node, int begin, int end, BVHSAHBuildTask *r_tasks)
+{
+	BVHTree *tree = data->tree;
+	BVHNode **leafs_array = tree->nodes;
+	int nth[MAX_TREETYPE + 1];
+	int parts = 1, tasks_num = 0;
+	int i;
+
+	refit_kdop_hull(tree, node, begin, end);
+	node->main_axis = (char)(get_largest_axis(node->bv) / 2);
+
+	nth[0] = begin;
+	nth[1] = end;
+	while (parts < tree->tree_type) {
+		int part_best = -1, axis;
+
+		for (i = 0; i < parts; i++) {
+			if ((nth[i + 1] - nth[i] > 1) &&
+			    ((part_best == -1) || (nth[i + 1] - nth[i] > nth[part_best + 1] - nth[part_best])))
+			{
+				part_best = i;
+			}
+		}
+		if (part_best == -1) {
+			break;
+		}
+
+		const int mid = bvh_sah_split(leafs_array, nth[part_best], nth[part_best + 1], &axis);
+		if (parts == 1) {
+			/* children are sorted along the axis of the first split */
+			node->main_axis = (char)axis;
+		}
+
+		memmove(&nth[part_best + 2], &nth[part_best + 1], sizeof(*nth) * (size_t)(parts - part_best));
+		nth[part_best + 1] = mid;
+		parts++;
+	}
+
+	for (i = 0; i < parts; i++) {
+		BVHNode *child;
+
+		if (nth[i + 1] - nth[i] == 1) {
+			child = leafs_array[nth[i]];
+		}
+		else {
+			child = data->branches_array + atomic_fetch_and_add_uint32(&data->branches_num, 1);
+			r_tasks[tasks_num].node = child;
+			r_tasks[tasks_num].begin = nth[i];
+			r_tasks[tasks_num].end = nth[i + 1];
+			tasks_num++;
+		}
+
+		node->children[i] = child;
+		child->parent = node;
+	}
+	node->totnode = (char)parts;
+
+	return tasks_num;
+}
+
+static void bvh_sah_build_task_cb(TaskPool *__restrict pool, void *taskdata, int threadid);
+
+static void bvh_sah_build_subtree(BVHSAHBuildData *data, const BVHSAHBuildTask *task_root, int threadid)
+{
+	BLI_Stack *stack = BLI_stack_new(sizeof(BVHSAHBuildTask), __func__);
+	BVHSAHBuildTask task;
+
+	BLI_stack_push(stack, task_root);
+
+	while (!BLI_stack_is_empty(stack)) {
+		BVHSAHBuildTask tasks[MAX_TREETYPE];
+		int tasks_num, i;
+
+		BLI_stack_pop(stack, &task);
+		tasks_num = bvh_sah_div_node(data, task.node, task.begin, task.end, tasks);
+
+		for (i = 0; i < tasks_num; i++) {
+			if (data->pool && (tasks[i].end - tasks[i].begin > KDOPBVH_THREAD_LEAF_THRESHOLD)) {
+				BVHSAHBuildTask *taskdata = MEM_mallocN(sizeof(*taskdata), __func__);
+				*taskdata = tasks[i];
+				BLI_task_pool_push_from_thread(data->pool, bvh_sah_build_task_cb, taskdata, true,
+				                               TASK_PRIORITY_HIGH, threadid);
+			}
+			else {
+				BLI_stack_push(stack, &tasks[i]);
+			}
+		}
+	}
+
+	BLI_stack_free(stack);
+}
+
+static void bvh_sah_build_task_cb(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+	bvh_sah_build_subtree(BLI_task_pool_userdata(pool), taskdata, threadid);
+}
+
+/**
+ * Build the tree with SAH splits, returning the number of branches.
+ */
+static int bvh_sah_div_nodes(BVHTree *tree, BVHNode *branches_array, int num_leafs)
+{
+	BVHSAHBuildData data = {
+		.tree = tree, .branches_array = branches_array, .branches_num = 1, .pool = NULL,
+	};
+	const BVHSAHBuildTask task_root = {.node = branches_array, .begin = 0, .end = num_leafs};
+
+	branches_array->parent = NULL;
+
+	if (num_leafs > KDOPBVH_THREAD_LEAF_THRESHOLD) {
+		data.pool = BLI_task_pool_create(BLI_task_scheduler_get(), &data);
+		bvh_sah_build_subtree(&data, &task_root, 0);
+		BLI_task_pool_work_and_wait(data.pool);
+		BLI_task_pool_free(data.pool);
+	}
+	else {
+		bvh_sah_build_subtree(&data, &task_root, 0);
+	}
+
+	return (int)data.branches_num;
+}
+
+/**
+ * Make sure there are nodes for \a numnodes, the SAH build can use more branches than the implicit tree.
+ * Only valid before the tree is balanced.
+ */
+static void bvhtree_ensure_nodes(BVHTree *tree, int numnodes)
+{
+	const int numnodes_prev = (int)(MEM_allocN_len(tree->nodes) / sizeof(*tree->nodes));
+	int i;
+
+	if (numnodes <= numnodes_prev) {
+		return;
+	}
+
+	tree->nodes = MEM_recallocN(tree->nodes, sizeof(BVHNode *) * (size_t)numnodes);
+	tree->nodebv = MEM_recallocN(tree->nodebv, sizeof(float) * (size_t)(tree->axis * numnodes));
+	tree->nodechild = MEM_recallocN(tree->nodechild, sizeof(BVHNode *) * (size_t)(tree->tree_type * numnodes));
+	tree->nodearray = MEM_recallocN(tree->nodearray, sizeof(BVHNode) * (size_t)numnodes);
+
+	/* link the dynamic bv and child links again */
+	for (i = 0; i < numnodes; i++) {
+		tree->nodearray[i].bv = &tree->nodebv[i * tree->axis];
+		tree->nodearray[i].children = &tree->nodechild[i * tree->tree_type];
+	}
+	for (i = 0; i < tree->totleaf; i++) {
+		tree->nodes[i] = &tree->nodearray[i];
+	}
+}
+
+/** \} */
+
+
 /* -------------------------------------------------------------------- */
 
 /** \name BLI_bvhtree API
@@ -1037,22 +1375,35 @@ void BLI_bvhtree_free(BVHTree *tree)
 	}
 }
 
-void BLI_bvhtree_balance(BVHTree *tree)
+/**
+ * \param flag: #BVH_BALANCE_SAH to split with the surface area heuristic.
+ */
+void BLI_bvhtree_balance_ex(BVHTree *tree, int flag)
 {
 	int i;
 
-	BVHNode *branches_array = tree->nodearray + tree->totleaf;
-	BVHNode **leafs_array    = tree->nodes;
+	BVHNode *branches_array;
+	BVHNode **leafs_array;
 
 	/* This function should only be called once (some big bug goes here if its being called more than once per tree) */
 	BLI_assert(tree->totbranch == 0);
 
-	/* Build the implicit tree */
-	non_recursive_bvh_div_nodes(tree, branches_array, leafs_array, tree->totleaf);
+	if ((flag & BVH_BALANCE_SAH) && (tree->totleaf > 2) && (tree->start_axis == 0)) {
+		bvhtree_ensure_nodes(tree, 2 * tree->totleaf - 1);
+		branches_array = tree->nodearray + tree->totleaf;
+		tree->totbranch = bvh_sah_div_nodes(tree, branches_array, tree->totleaf);
+	}
+	else {
+		branches_array = tree->nodearray + tree->totleaf;
+		leafs_array    = tree->nodes;
+
+		/* Build the implicit tree */
+		non_recursive_bvh_div_nodes(tree, branches_array, leafs_array, tree->totleaf);
+		tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
+	}
 
 	/* current code expects the branches to be linked to the nodes array
 	 * we perform that linkage here */
-	tree->totbranch = implicit_needed_branches(tree->tree_type, tree->totleaf);
 	for (i = 0; i < tree->totbranch; i++)
 		tree->nodes[tree->totleaf + i] = branches_array + i;
 
@@ -1063,6 +1414,11 @@ void BLI_bvhtree_balance(BVHTree *tree)
 	/* bvhtree_info(tree); */
 }
 
+void BLI_bvhtree_balance(BVHTree *tree)
+{
+	BLI_bvhtree_balance_ex(tree, 0);
+}
+
 void BLI_bvhtree_insert(BVHTree *tree, int index, const float co[3], int numpoints)
 {
 	axis_t axis_iter;
@@ -1358,7 +1714,7 @@ BVHTreeOverlap *BLI_bvhtree_overlap(
  * \{ */
 
 /* Determines the nearest point of the given node BV. Returns the squared distance to that point. */
-static float calc_nearest_point_squared(const float proj[3], BVHNode *node, float nearest[3])
+static float calc_nearest_point_squared(const float proj[3], const BVHNode *node, float nearest[3])
 {
 	int i;
 	const float *bv = node->bv;
@@ -1574,6 +1930,195 @@ int BLI_bvhtree_find_nearest(
 /** \} */
 
 
+/* -------------------------------------------------------------------- */
+
+/** \name BLI_bvhtree_find_nearest_batch
+ *
+ * Points are grouped in packets of #BVH_PACKET_SIZE, traversing the tree together:
+ * the distance to the bounds of a node is computed for all points at once.
+ * The order of the children is picked from the first point still searching the node.
+ * Packets use the bounds on the x, y and z axes, trees without them run the single queries.
+ *
+ * \{ */
+
+typedef struct BVHNearestPacket {
+	/* transposed projections and distances of the points, for SIMD */
+	float proj[3][BVH_PACKET_SIZE];
+	float dist_sq[BVH_PACKET_SIZE];
+
+	BVHNearestData data[BVH_PACKET_SIZE];
+} BVHNearestPacket;
+
+/* index of the first query of the packet in \a mask */
+BLI_INLINE int packet_first_index(const int mask)
+{
+	int i = 0;
+	while (!(mask & (1 << i))) {
+		i++;
+	}
+	return i;
+}
+
+typedef struct BVHNearestBatchData {
+	BVHTree *tree;
+	const float (*co)[3];
+	int points_num;
+	BVHTreeNearest *nearest;
+	BVHTree_NearestPointCallback callback;
+	void *userdata;
+} BVHNearestBatchData;
+
+/**
+ * Squared distances of the points of \a mask to the bounds of \a node.
+ * \return The mask of the points closer than their nearest result.
+ */
+static int packet_nearest_dist_sq(const BVHNearestPacket *packet, const BVHNode *node, const int mask)
+{
+	const float *bv = node->bv;
+	int axis;
+
+#ifdef __SSE2__
+	const __m128 zero = _mm_setzero_ps();
+	__m128 dist_sq = zero;
+
+	for (axis = 0; axis != 3; axis++, bv += 2) {
+		const __m128 proj = _mm_loadu_ps(packet->proj[axis]);
+		const __m128 d = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(bv[0]), proj), zero),
+		                            _mm_max_ps(_mm_sub_ps(proj, _mm_set1_ps(bv[1])), zero));
+		dist_sq = _mm_add_ps(dist_sq, _mm_mul_ps(d, d));
+	}
+
+	return mask & _mm_movemask_ps(_mm_cmplt_ps(dist_sq, _mm_loadu_ps(packet->dist_sq)));
+#else
+	float dist_sq[BVH_PACKET_SIZE] = {0.0f};
+	int i, result = 0;
+
+	for (axis = 0; axis != 3; axis++, bv += 2) {
+		for (i = 0; i != BVH_PACKET_SIZE; i++) {
+			const float d = max_ff(bv[0] - packet->proj[axis][i], 0.0f) + max_ff(packet->proj[axis][i] - bv[1], 0.0f);
+			dist_sq[i] += d * d;
+		}
+	}
+
+	for (i = 0; i != BVH_PACKET_SIZE; i++) {
+		if (dist_sq[i] < packet->dist_sq[i]) {
+			result |= (1 << i);
+		}
+	}
+
+	return mask & result;
+#endif
+}
+
+static void dfs_find_nearest_packet(BVHNearestPacket *packet, const BVHNode *node, int mask)
+{
+	int i;
+
+	mask = packet_nearest_dist_sq(packet, node, mask);
+	if (mask == 0) {
+		return;
+	}
+
+	if (node->totnode == 0) {
+		for (i = 0; i != BVH_PACKET_SIZE; i++) {
+			if (mask & (1 << i)) {
+				BVHNearestData *data = &packet->data[i];
+
+				if (data->callback) {
+					data->callback(data->userdata, node->index, data->co, &data->nearest);
+				}
+				else {
+					data->nearest.index = node->index;
+					data->nearest.dist_sq = calc_nearest_point_squared(data->proj, node, data->nearest.co);
+				}
+				packet->dist_sq[i] = data->nearest.dist_sq;
+			}
+		}
+	}
+	else {
+		/* same heuristic as #dfs_find_nearest_dfs, for the first point */
+		const BVHNearestData *data = &packet->data[packet_first_index(mask)];
+
+		if (data->proj[node->main_axis] <= node->children[0]->bv[node->main_axis * 2 + 1]) {
+			for (i = 0; i != node->totnode; i++) {
+				dfs_find_nearest_packet(packet, node->children[i], mask);
+			}
+		}
+		else {
+			for (i = node->totnode - 1; i >= 0; i--) {
+				dfs_find_nearest_packet(packet, node->children[i], mask);
+			}
+		}
+	}
+}
+
+static void bvhtree_find_nearest_batch_cb(void *userdata, const int iter)
+{
+	const BVHNearestBatchData *batch = userdata;
+	BVHTree *tree = batch->tree;
+	BVHNode *root = tree->nodes[tree->totleaf];
+	BVHNearestPacket packet;
+	const int start = iter * BVH_PACKET_SIZE;
+	int i, mask = 0;
+
+	if (tree->start_axis != 0) {
+		for (i = 0; i != BVH_PACKET_SIZE && start + i < batch->points_num; i++) {
+			BLI_bvhtree_find_nearest(
+			        tree, batch->co[start + i], &batch->nearest[start + i], batch->callback, batch->userdata);
+		}
+		return;
+	}
+
+	memset(&packet, 0, sizeof(packet));
+
+	for (i = 0; i != BVH_PACKET_SIZE && start + i < batch->points_num; i++) {
+		BVHNearestData *data = &packet.data[i];
+		axis_t axis_iter;
+
+		data->tree = tree;
+		data->co = batch->co[start + i];
+		data->callback = batch->callback;
+		data->userdata = batch->userdata;
+		for (axis_iter = tree->start_axis; axis_iter != tree->stop_axis; axis_iter++) {
+			data->proj[axis_iter] = dot_v3v3(data->co, bvhtree_kdop_axes[axis_iter]);
+		}
+		data->nearest = batch->nearest[start + i];
+
+		packet.proj[0][i] = data->proj[0];
+		packet.proj[1][i] = data->proj[1];
+		packet.proj[2][i] = data->proj[2];
+		packet.dist_sq[i] = data->nearest.dist_sq;
+		mask |= (1 << i);
+	}
+
+	dfs_find_nearest_packet(&packet, root, mask);
+
+	for (i = 0; i != BVH_PACKET_SIZE && start + i < batch->points_num; i++) {
+		batch->nearest[start + i] = packet.data[i].nearest;
+	}
+}
+
+void BLI_bvhtree_find_nearest_batch(
+        BVHTree *tree, const float (*co)[3], const int points_num, BVHTreeNearest *nearest,
+        BVHTree_NearestPointCallback callback, void *userdata)
+{
+	BVHNearestBatchData batch = {
+		.tree = tree, .co = co, .points_num = points_num, .nearest = nearest,
+		.callback = callback, .userdata = userdata,
+	};
+
+	if (tree->nodes[tree->totleaf] == NULL) {
+		return;
+	}
+
+	BLI_task_parallel_range(
+	        0, (points_num + BVH_PACKET_SIZE - 1) / BVH_PACKET_SIZE, &batch, bvhtree_find_nearest_batch_cb,
+	        points_num > KDOPBVH_THREAD_QUERY_THRESHOLD);
+}
+
+/** \} */
+
+
 /* -------------------------------------------------------------------- */
 
 /** \name BLI_bvhtree_ray_cast
@@ -1779,34 +2324,42 @@ static void bvhtree_ray_cast_data_precalc(BVHRayCastData *data, int flag)
 #endif
 }
 
-int BLI_bvhtree_ray_cast_ex(
-        BVHTree *tree, const float co[3], const float dir[3], float radius, BVHTreeRayHit *hit,
-        BVHTree_RayCastCallback callback, void *userdata,
+static void bvhtree_ray_cast_data_init(
+        BVHRayCastData *data, BVHTree *tree, const float co[3], const float dir[3], float radius,
+        const BVHTreeRayHit *hit, BVHTree_RayCastCallback callback, void *userdata,
         int flag)
 {
-	BVHRayCastData data;
-	BVHNode *root = tree->nodes[tree->totleaf];
-
 	BLI_ASSERT_UNIT_V3(dir);
 
-	data.tree = tree;
+	data->tree = tree;
 
-	data.callback = callback;
-	data.userdata = userdata;
+	data->callback = callback;
+	data->userdata = userdata;
 
-	copy_v3_v3(data.ray.origin,    co);
-	copy_v3_v3(data.ray.direction, dir);
-	data.ray.radius = radius;
+	copy_v3_v3(data->ray.origin,    co);
+	copy_v3_v3(data->ray.direction, dir);
+	data->ray.radius = radius;
 
-	bvhtree_ray_cast_data_precalc(&data, flag);
+	bvhtree_ray_cast_data_precalc(data, flag);
 
 	if (hit) {
-		memcpy(&data.hit, hit, sizeof(*hit));
+		memcpy(&data->hit, hit, sizeof(*hit));
 	}
 	else {
-		data.hit.index = -1;
-		data.hit.dist = BVH_RAYCAST_DIST_MAX;
+		data->hit.index = -1;
+		data->hit.dist = BVH_RAYCAST_DIST_MAX;
 	}
+}
+
+int BLI_bvhtree_ray_cast_ex(
+        BVHTree *tree, const float co[3], const float dir[3], float radius, BVHTreeRayHit *hit,
+        BVHTree_RayCastCallback callback, void *userdata,
+        int flag)
+{
+	BVHRayCastData data;
+	BVHNode *root = tree->nodes[tree->totleaf];
+
+	bvhtree_ray_cast_data_init(&data, tree, co, dir, radius, hit, callback, userdata, flag);
 
 	if (root) {
 		dfs_raycast(&data, root);
@@ -1827,6 +2380,205 @@ int BLI_bvhtree_ray_cast(
 	return BLI_bvhtree_ray_cast_ex(tree, co, dir, radius, hit, callback, userdata, BVH_RAYCAST_DEFAULT);
 }
 
+/**
+ * Batched ray-cast, rays are grouped in packets of #BVH_PACKET_SIZE traversing the tree together:
+ * the intersection with the bounds of a node is computed for all rays at once.
+ * The order of the children is picked from the first ray still intersecting the node.
+ *
+ * Rays with a radius don't use packets, see #ray_nearest_hit, neither do trees without bounds on the x, y and z axes.
+ */
+
+typedef struct BVHRayPacket {
+	/* transposed origins, inverse directions and distances of the rays, for SIMD */
+	float origin[3][BVH_PACKET_SIZE];
+	float idot_axis[3][BVH_PACKET_SIZE];
+	float dist[BVH_PACKET_SIZE];
+
+	BVHRayCastData data[BVH_PACKET_SIZE];
+} BVHRayPacket;
+
+typedef struct BVHRayCastBatchData {
+	BVHTree *tree;
+	const float (*co)[3];
+	const float (*dir)[3];
+	int rays_num;
+	float radius;
+	BVHTreeRayHit *hits;
+	BVHTree_RayCastCallback callback;
+	void *userdata;
+	int flag;
+} BVHRayCastBatchData;
+
+/**
+ * Distances the rays of \a mask travel to hit the bounds of \a node, like #fast_ray_nearest_hit.
+ * \return The mask of the rays hitting the bounds before their current hit.
+ */
+static int packet_ray_nearest_hit(const BVHRayPacket *packet, const BVHNode *node, const int mask, float r_dist[BVH_PACKET_SIZE])
+{
+	const float *bv = node->bv;
+	int axis;
+
+#ifdef __SSE2__
+	__m128 t_near = _mm_set1_ps(-FLT_MAX);
+	__m128 t_far = _mm_set1_ps(FLT_MAX);
+	__m128 hit;
+
+	for (axis = 0; axis != 3; axis++, bv += 2) {
+		const __m128 origin = _mm_loadu_ps(packet->origin[axis]);
+		const __m128 idot = _mm_loadu_ps(packet->idot_axis[axis]);
+		const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[0]), origin), idot);
+		const __m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bv[1]), origin), idot);
+
+		t_near = _mm_max_ps(t_near, _mm_min_ps(t1, t2));
+		t_far = _mm_min_ps(t_far, _mm_max_ps(t1, t2));
+	}
+
+	hit = _mm_and_ps(_mm_cmple_ps(t_near, t_far), _mm_cmpge_ps(t_far, _mm_setzero_ps()));
+	hit = _mm_and_ps(hit, _mm_cmplt_ps(t_near, _mm_loadu_ps(packet->dist)));
+	_mm_storeu_ps(r_dist, t_near);
+
+	return mask & _mm_movemask_ps(hit);
+#else
+	float t_far[BVH_PACKET_SIZE];
+	int i, result = 0;
+
+	for (i = 0; i != BVH_PACKET_SIZE; i++) {
+		r_dist[i] = -FLT_MAX;
+		t_far[i] = FLT_MAX;
+	}
+
+	for (axis = 0; axis != 3; axis++, bv += 2) {
+		for (i = 0; i != BVH_PACKET_SIZE; i++) {
+			const float t1 = (bv[0] - packet->origin[axis][i]) * packet->idot_axis[axis][i];
+			const float t2 = (bv[1] - packet->origin[axis][i]) * packet->idot_axis[axis][i];
+
+			r_dist[i] = max_ff(r_dist[i], min_ff(t1, t2));
+			t_far[i] = min_ff(t_far[i], max_ff(t1, t2));
+		}
+	}
+
+	for (i = 0; i != BVH_PACKET_SIZE; i++) {
+		if (r_dist[i] <= t_far[i] && t_far[i] >= 0.0f && r_dist[i] < packet->dist[i]) {
+			result |= (1 << i);
+		}
+	}
+
+	return mask & result;
+#endif
+}
+
+static void dfs_raycast_packet(BVHRayPacket *packet, const BVHNode *node, int mask)
+{
+	float dist[BVH_PACKET_SIZE];
+	int i;
+
+	mask = packet_ray_nearest_hit(packet, node, mask, dist);
+	if (mask == 0) {
+		return;
+	}
+
+	if (node->totnode == 0) {
+		for (i = 0; i != BVH_PACKET_SIZE; i++) {
+			if (mask & (1 << i)) {
+				BVHRayCastData *data = &packet->data[i];
+
+				if (data->callback) {
+					data->callback(data->userdata, node->index, &data->ray, &data->hit);
+				}
+				else {
+					data->hit.index = node->index;
+					data->hit.dist  = dist[i];
+					madd_v3_v3v3fl(data->hit.co, data->ray.origin, data->ray.direction, dist[i]);
+				}
+				packet->dist[i] = data->hit.dist;
+			}
+		}
+	}
+	else {
+		/* pick loop direction like #dfs_raycast, for the first ray */
+		const BVHRayCastData *data = &packet->data[packet_first_index(mask)];
+
+		if (data->ray_dot_axis[node->main_axis] > 0.0f) {
+			for (i = 0; i != node->totnode; i++) {
+				dfs_raycast_packet(packet, node->children[i], mask);
+			}
+		}
+		else {
+			for (i = node->totnode - 1; i >= 0; i--) {
+				dfs_raycast_packet(packet, node->children[i], mask);
+			}
+		}
+	}
+}
+
+static void bvhtree_ray_cast_batch_cb(void *userdata, const int iter)
+{
+	const BVHRayCastBatchData *batch = userdata;
+	BVHTree *tree = batch->tree;
+	BVHNode *root = tree->nodes[tree->totleaf];
+	BVHRayPacket packet;
+	const int start = iter * BVH_PACKET_SIZE;
+	int i, axis, mask = 0;
+
+	if (tree->start_axis != 0) {
+		for (i = 0; i != BVH_PACKET_SIZE && start + i < batch->rays_num; i++) {
+			BLI_bvhtree_ray_cast_ex(
+			        tree, batch->co[start + i], batch->dir[start + i], batch->radius, &batch->hits[start + i],
+			        batch->callback, batch->userdata, batch->flag);
+		}
+		return;
+	}
+
+	memset(&packet, 0, sizeof(packet));
+
+	for (i = 0; i != BVH_PACKET_SIZE && start + i < batch->rays_num; i++) {
+		BVHRayCastData *data = &packet.data[i];
+
+		bvhtree_ray_cast_data_init(
+		        data, tree, batch->co[start + i], batch->dir[start + i], batch->radius, &batch->hits[start + i],
+		        batch->callback, batch->userdata, batch->flag);
+
+		if (batch->radius == 0.0f) {
+			for (axis = 0; axis != 3; axis++) {
+				packet.origin[axis][i] = data->ray.origin[axis];
+				packet.idot_axis[axis][i] = data->idot_axis[axis];
+			}
+			packet.dist[i] = data->hit.dist;
+			mask |= (1 << i);
+		}
+		else {
+			dfs_raycast(data, root);
+		}
+	}
+
+	if (mask) {
+		dfs_raycast_packet(&packet, root, mask);
+	}
+
+	for (i = 0; i != BVH_PACKET_SIZE && start + i < batch->rays_num; i++) {
+		batch->hits[start + i] = packet.data[i].hit;
+	}
+}
+
+void BLI_bvhtree_ray_cast_batch(
+        BVHTree *tree, const float (*co)[3], const float (*dir)[3], const int rays_num, float radius,
+        BVHTreeRayHit *hits, BVHTree_RayCastCallback callback, void *userdata,
+        int flag)
+{
+	BVHRayCastBatchData batch = {
+		.tree = tree, .co = co, .dir = dir, .rays_num = rays_num, .radius = radius, .hits = hits,
+		.callback = callback, .userdata = userdata, .flag = flag,
+	};
+
+	if (tree->nodes[tree->totleaf] == NULL) {
+		return;
+	}
+
+	BLI_task_parallel_range(
+	        0, (rays_num + BVH_PACKET_SIZE - 1) / BVH_PACKET_SIZE, &batch, bvhtree_ray_cast_batch_cb,
+	        rays_num > KDOPBVH_THREAD_QUERY_THRESHOLD);
+}
+
 float BLI_bvhtree_bb_raycast(const float bv[6], const float light_start[3], const float light_end[3], float pos[3])
 {
 	BVHRayCastData data;
@@ -29,6 +29,7 @@
 
 #include "BLI_math.h"
 #include "BLI_kdtree.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLI_strict_flags.h"
 
@@ -61,6 +62,14 @@ struct KDTree {
 
 #define KD_NODE_UNSET ((unsigned int)-1)
 
+#ifdef DEBUG
+#  define KD_THREAD_BALANCE_THRESHOLD 0
+#  define KD_THREAD_QUERY_THRESHOLD 0
+#else
+#  define KD_THREAD_BALANCE_THRESHOLD 8192  /* sub-trees larger than this are balanced in their own task */
+#  define KD_THREAD_QUERY_THRESHOLD 1024    /* batches larger than this are searched in parallel */
+#endif
+
 /**
  * Creates or free a kdtree
  */
@@ -113,17 +122,36 @@ void BLI_kdtree_insert(KDTree *tree, int index, const float co[3])
 #endif
 }
 
-static unsigned int kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsigned int axis, const unsigned int ofs)
+typedef struct KDTreeBalanceTask {
+	KDTreeNode *nodes;
+	unsigned int totnode, axis, ofs;
+} KDTreeBalanceTask;
+
+static void kdtree_balance_task_cb(TaskPool *__restrict pool, void *taskdata, int threadid);
+
+/**
+ * Nodes are stored depth first: every node is followed by its left sub-tree, then its right sub-tree.
+ * So the root of the sub-tree of a range of nodes is its first node, and the nodes visited one after
+ * another by the searches are close in memory.
+ * Sub-trees don't share nodes, large ones are balanced in parallel when \a pool is given.
+ */
+static void kdtree_balance(
+        KDTreeNode *nodes, unsigned int totnode, unsigned int axis, const unsigned int ofs,
+        TaskPool *pool, int threadid)
 {
 	KDTreeNode *node;
 	float co;
 	unsigned int left, right, median, i, j;
 
 	if (totnode <= 0)
-		return KD_NODE_UNSET;
-	else if (totnode == 1)
-		return 0 + ofs;
-	
+		return;
+	else if (totnode == 1) {
+		node = &nodes[0];
+		node->left = node->right = KD_NODE_UNSET;
+		node->d = axis;
+		return;
+	}
+
 	/* quicksort style sorting around median */
 	left = 0;
 	right = totnode - 1;
@@ -151,19 +179,49 @@ static unsigned int kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsi
 			left = i + 1;
 	}
 
+	/* move the median to the start, the first node of the left side takes its place */
+	SWAP(KDTreeNode_head, *(KDTreeNode_head *)&nodes[0], *(KDTreeNode_head *)&nodes[median]);
+
 	/* set node and sort subnodes */
-	node = &nodes[median];
+	node = &nodes[0];
 	node->d = axis;
+	node->left = ofs + 1;
+	node->right = (totnode > median + 1) ? ofs + median + 1 : KD_NODE_UNSET;
 	axis = (axis + 1) % 3;
-	node->left = kdtree_balance(nodes, median, axis, ofs);
-	node->right = kdtree_balance(nodes + median + 1, (totnode - (median + 1)), axis, (median + 1) + ofs);
 
-	return median + ofs;
+	if (pool && (totnode - (median + 1) > KD_THREAD_BALANCE_THRESHOLD)) {
+		KDTreeBalanceTask *task = MEM_mallocN(sizeof(*task), __func__);
+		task->nodes = nodes + median + 1;
+		task->totnode = totnode - (median + 1);
+		task->axis = axis;
+		task->ofs = ofs + median + 1;
+		BLI_task_pool_push_from_thread(pool, kdtree_balance_task_cb, task, true, TASK_PRIORITY_HIGH, threadid);
+	}
+	else {
+		kdtree_balance(nodes + median + 1, totnode - (median + 1), axis, ofs + median + 1, pool, threadid);
+	}
+	kdtree_balance(nodes + 1, median, axis, ofs + 1, pool, threadid);
+}
+
+static void kdtree_balance_task_cb(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+	const KDTreeBalanceTask *task = taskdata;
+	kdtree_balance(task->nodes, task->totnode, task->axis, task->ofs, pool, threadid);
 }
 
 void BLI_kdtree_balance(KDTree *tree)
 {
-	tree->root = kdtree_balance(tree->nodes, tree->totnode, 0, 0);
+	if (tree->totnode > KD_THREAD_BALANCE_THRESHOLD) {
+		TaskPool *pool = BLI_task_pool_create(BLI_task_scheduler_get(), NULL);
+		kdtree_balance(tree->nodes, tree->totnode, 0, 0, pool, 0);
+		BLI_task_pool_work_and_wait(pool);
+		BLI_task_pool_free(pool);
+	}
+	else {
+		kdtree_balance(tree->nodes, tree->totnode, 0, 0, NULL, 0);
+	}
+
+	tree->root = (tree->totnode != 0) ? 0 : KD_NODE_UNSET;
 
 #ifdef DEBUG
 	tree->is_balanced = true;
@@ -416,16 +474,17 @@ static void add_nearest(KDTreeNearest *ptn, unsigned int *found, unsigned int n,
 	copy_v3_v3(ptn[i].co, co);
 }
 
-/**
- * Find n nearest returns number of points found, with results in nearest.
- * Normal is optional, but if given will limit results to points in normal direction from co.
- *
- * \param r_nearest  An array of nearest, sized at least \a n.
- */
-int BLI_kdtree_find_nearest_n__normal(
+/* test if a point at \a dist_sq is one of the \a n nearest found so far and within \a range_sq */
+BLI_INLINE bool nearest_n_test(const KDTreeNearest *r_nearest, unsigned int found, unsigned int n,
+                               const float dist_sq, const float range_sq)
+{
+	return (found < n) ? (dist_sq <= range_sq) : (dist_sq < r_nearest[found - 1].dist);
+}
+
+static int kdtree_find_nearest_n_ex(
         const KDTree *tree, const float co[3], const float nor[3],
         KDTreeNearest r_nearest[],
-        unsigned int n)
+        unsigned int n, const float range_sq)
 {
 	const KDTreeNode *nodes = tree->nodes;
 	const KDTreeNode *root;
@@ -447,7 +506,8 @@ int BLI_kdtree_find_nearest_n__normal(
 	root = &nodes[tree->root];
 
 	cur_dist = squared_distance(root->co, co, nor);
-	add_nearest(r_nearest, &found, n, root->index, cur_dist, root->co);
+	if (cur_dist <= range_sq)
+		add_nearest(r_nearest, &found, n, root->index, cur_dist, root->co);
 	
 	if (co[root->d] < root->co[root->d]) {
 		if (root->right != KD_NODE_UNSET)
@@ -470,10 +530,10 @@ int BLI_kdtree_find_nearest_n__normal(
 		if (cur_dist < 0.0f) {
 			cur_dist = -cur_dist * cur_dist;
 
-			if (found < n || -cur_dist < r_nearest[found - 1].dist) {
+			if (nearest_n_test(r_nearest, found, n, -cur_dist, range_sq)) {
 				cur_dist = squared_distance(node->co, co, nor);
 
-				if (found < n || cur_dist < r_nearest[found - 1].dist)
+				if (nearest_n_test(r_nearest, found, n, cur_dist, range_sq))
 					add_nearest(r_nearest, &found, n, node->index, cur_dist, node->co);
 
 				if (node->left != KD_NODE_UNSET)
@@ -485,9 +545,9 @@ int BLI_kdtree_find_nearest_n__normal(
 		else {
 			cur_dist = cur_dist * cur_dist;
 
-			if (found < n || cur_dist < r_nearest[found - 1].dist) {
+			if (nearest_n_test(r_nearest, found, n, cur_dist, range_sq)) {
 				cur_dist = squared_distance(node->co, co, nor);
-				if (found < n || cur_dist < r_nearest[found - 1].dist)
+				if (nearest_n_test(r_nearest, found, n, cur_dist, range_sq))
 					add_nearest(r_nearest, &found, n, node->index, cur_dist, node->co);
 
 				if (node->right != KD_NODE_UNSET)
@@ -510,6 +570,20 @@ int BLI_kdtree_find_nearest_n__normal(
 	return (int)found;
 }
 
+/**
+ * Find n nearest returns number of points found, with results in nearest.
+ * Normal is optional, but if given will limit results to points in normal direction from co.
+ *
+ * \param r_nearest  An array of nearest, sized at least \a n.
+ */
+int BLI_kdtree_find_nearest_n__normal(
+        const KDTree *tree, const float co[3], const float nor[3],
+        KDTreeNearest r_nearest[],
+        unsigned int n)
+{
+	return kdtree_find_nearest_n_ex(tree, co, nor, r_nearest, n, FLT_MAX);
+}
+
 static int range_compare(const void *a, const void *b)
 {
 	const KDTreeNearest *kda = a;
@@ -674,3 +748,132 @@ finally:
 	if (stack != defaultstack)
 		MEM_freeN(stack);
 }
+
+typedef struct KDTreeBatchData {
+	const KDTree *tree;
+	const float (*co)[3];
+	KDTreeNearest *r_nearest;
+	int *r_found;
+	unsigned int n;
+	float range_sq;
+} KDTreeBatchData;
+
+static void kdtree_find_nearest_n_batch_cb(void *userdata, const int i)
+{
+	const KDTreeBatchData *data = userdata;
+
+	data->r_found[i] = kdtree_find_nearest_n_ex(
+	        data->tree, data->co[i], NULL, &data->r_nearest[(size_t)i * data->n], data->n, data->range_sq);
+}
+
+/**
+ * Batched version of #BLI_kdtree_find_nearest_n, the points are searched in parallel.
+ *
+ * \param r_nearest  An array of nearest, sized at least \a n for each point, results of point i start at i * n.
+ * \param r_found  The number of nearest found for each point.
+ */
+void BLI_kdtree_find_nearest_n_batch(
+        const KDTree *tree, const float (*co)[3], unsigned int co_num,
+        KDTreeNearest *r_nearest, unsigned int n, int *r_found)
+{
+	KDTreeBatchData data = {
+		.tree = tree, .co = co, .r_nearest = r_nearest, .r_found = r_found, .n = n, .range_sq = FLT_MAX,
+	};
+
+	BLI_task_parallel_range(0, (int)co_num, &data, kdtree_find_nearest_n_batch_cb,
+	                        co_num > KD_THREAD_QUERY_THRESHOLD);
+}
+
+/**
+ * Range search writing the \a n nearest points in range to \a r_nearest, sorted by distance.
+ * Traversed like #BLI_kdtree_range_search, the range shrinks to the farthest point found once there are \a n.
+ */
+static int kdtree_range_search_n(
+        const KDTree *tree, const float co[3],
+        KDTreeNearest r_nearest[],
+        unsigned int n, const float range_sq)
+{
+	const KDTreeNode *nodes = tree->nodes;
+	unsigned int *stack, defaultstack[KD_STACK_INIT];
+	float dist_sq, bound_sq = range_sq;
+	unsigned int totstack, cur = 0, i, found = 0;
+
+#ifdef DEBUG
+	BLI_assert(tree->is_balanced == true);
+#endif
+
+	if (UNLIKELY((tree->root == KD_NODE_UNSET) || n == 0))
+		return 0;
+
+	stack = defaultstack;
+	totstack = KD_STACK_INIT;
+
+	stack[cur++] = tree->root;
+
+	while (cur--) {
+		const KDTreeNode *node = &nodes[stack[cur]];
+		const float plane_dist = co[node->d] - node->co[node->d];
+
+		if (plane_dist < 0.0f && plane_dist * plane_dist > bound_sq) {
+			if (node->left != KD_NODE_UNSET)
+				stack[cur++] = node->left;
+		}
+		else if (plane_dist > 0.0f && plane_dist * plane_dist > bound_sq) {
+			if (node->right != KD_NODE_UNSET)
+				stack[cur++] = node->right;
+		}
+		else {
+			dist_sq = len_squared_v3v3(node->co, co);
+			if (nearest_n_test(r_nearest, found, n, dist_sq, range_sq)) {
+				add_nearest(r_nearest, &found, n, node->index, dist_sq, node->co);
+				if (found == n) {
+					bound_sq = r_nearest[n - 1].dist;
+				}
+			}
+
+			if (node->left != KD_NODE_UNSET)
+				stack[cur++] = node->left;
+			if (node->right != KD_NODE_UNSET)
+				stack[cur++] = node->right;
+		}
+
+		if (UNLIKELY(cur + 3 > totstack)) {
+			stack = realloc_nodes(stack, &totstack, defaultstack != stack);
+		}
+	}
+
+	for (i = 0; i < found; i++)
+		r_nearest[i].dist = sqrtf(r_nearest[i].dist);
+
+	if (stack != defaultstack)
+		MEM_freeN(stack);
+
+	return (int)found;
+}
+
+static void kdtree_range_search_batch_cb(void *userdata, const int i)
+{
+	const KDTreeBatchData *data = userdata;
+
+	data->r_found[i] = kdtree_range_search_n(
+	        data->tree, data->co[i], &data->r_nearest[(size_t)i * data->n], data->n, data->range_sq);
+}
+
+/**
+ * Batched range search, the points are searched in parallel.
+ * Unlike #BLI_kdtree_range_search nothing is allocated, only the \a n nearest points in range are found.
+ *
+ * \param r_nearest  An array of nearest, sized at least \a n for each point, results of point i start at i * n.
+ * \param r_found  The number of nearest found for each point.
+ */
+void BLI_kdtree_range_search_batch(
+        const KDTree *tree, const float (*co)[3], unsigned int co_num, float range,
+        KDTreeNearest *r_nearest, unsigned int n, int *r_found)
+{
+	KDTreeBatchData data = {
+		.tree = tree, .co = co, .r_nearest = r_nearest, .r_found = r_found, .n = n, .range_sq = range * range,
+	};
+
+	BLI_task_parallel_range(0, (int)co_num, &data, kdtree_range_search_batch_cb,
+	                        co_num > KD_THREAD_QUERY_THRESHOLD);
+}
@@ -36,6 +36,8 @@
  * - Freeing chunks.
  * - Iterating over allocated chunks
  *   (optionally when using the #BLI_MEMPOOL_ALLOW_ITER flag).
+ * - Iterating over ranges of chunks in parallel.
+ * - Allocating from multiple threads, for pools created with #BLI_mempool_create_threadsafe.
  */
 
 #include <string.h>
@@ -47,6 +49,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_strict_flags.h"  /* keep last */
 
 #ifdef WITH_MEM_VALGRIND
@@ -118,6 +122,20 @@ typedef struct BLI_mempool_chunk {
 #endif
 } BLI_mempool_chunk;
 
+#define MEMPOOL_CACHELINE_SIZE 64
+
+/**
+ * Free list of a thread allocating from a thread-safe pool,
+ * only accessed by that thread so it needs no locking.
+ * Padded to avoid false sharing between threads.
+ */
+typedef struct BLI_mempool_thread {
+	BLI_freenode *free;
+	/* elements allocated minus elements freed by this thread, can wrap around */
+	unsigned int totused;
+	char _pad[MEMPOOL_CACHELINE_SIZE - sizeof(BLI_freenode *) - sizeof(unsigned int)];
+} BLI_mempool_thread;
+
 /**
  * The mempool, stores and tracks memory \a chunks and elements within those chunks \a free.
  */
@@ -139,6 +157,11 @@ struct BLI_mempool {
 #ifdef USE_TOTALLOC
 	unsigned int totalloc;          /* number of elements allocated in total */
 #endif
+
+	/* Thread-safe pools only: free lists of the threads other than the main thread
+	 * (which uses \a free and \a totused). */
+	BLI_mempool_thread *threads;
+	unsigned int num_threads;
 };
 
 #define MEMPOOL_ELEM_SIZE_MIN (sizeof(void *) * 2)
@@ -206,22 +229,12 @@ static BLI_mempool_chunk *mempool_chunk_alloc(BLI_mempool *pool)
 }
 
 /**
- * Initialize a chunk and add into \a pool->chunks
- *
- * \param pool  The pool to add the chunk into.
- * \param mpchunk  The new uninitialized chunk (can be malloc'd)
- * \param lasttail  The last element of the previous chunk
- * (used when building free chunks initially)
- * \return The last chunk,
+ * Append \a mpchunk to \a pool->chunks, keeping the order of iteration.
  */
-static BLI_freenode *mempool_chunk_add(BLI_mempool *pool, BLI_mempool_chunk *mpchunk,
-                                       BLI_freenode *lasttail)
+static void mempool_chunk_append(BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
 {
-	const unsigned int esize = pool->esize;
-	BLI_freenode *curnode = CHUNK_DATA(mpchunk);
-	unsigned int j;
+	mpchunk->next = NULL;
 
-	/* append */
 	if (pool->chunk_tail) {
 		pool->chunk_tail->next = mpchunk;
 	}
@@ -230,12 +243,19 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool, BLI_mempool_chunk *mpc
 		pool->chunks = mpchunk;
 	}
 
-	mpchunk->next = NULL;
 	pool->chunk_tail = mpchunk;
+}
 
-	if (UNLIKELY(pool->free == NULL)) {
-		pool->free = curnode;
-	}
+/**
+ * Build the free list of the elements of \a mpchunk.
+ *
+ * \return The last node of the list.
+ */
+static BLI_freenode *mempool_chunk_nodes_init(BLI_mempool *pool, BLI_mempool_chunk *mpchunk)
+{
+	const unsigned int esize = pool->esize;
+	BLI_freenode *curnode = CHUNK_DATA(mpchunk);
+	unsigned int j;
 
 	/* loop through the allocated data, building the pointer structures */
 	j = pool->pchunk;
@@ -258,6 +278,31 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool, BLI_mempool_chunk *mpc
 	curnode = NODE_STEP_PREV(curnode);
 	curnode->next = NULL;
 
+	return curnode;
+}
+
+/**
+ * Initialize a chunk and add into \a pool->chunks
+ *
+ * \param pool  The pool to add the chunk into.
+ * \param mpchunk  The new uninitialized chunk (can be malloc'd)
+ * \param lasttail  The last element of the previous chunk
+ * (used when building free chunks initially)
+ * \return The last chunk,
+ */
+static BLI_freenode *mempool_chunk_add(BLI_mempool *pool, BLI_mempool_chunk *mpchunk,
+                                       BLI_freenode *lasttail)
+{
+	BLI_freenode *curnode;
+
+	mempool_chunk_append(pool, mpchunk);
+
+	if (UNLIKELY(pool->free == NULL)) {
+		pool->free = CHUNK_DATA(mpchunk);
+	}
+
+	curnode = mempool_chunk_nodes_init(pool, mpchunk);
+
 #ifdef USE_TOTALLOC
 	pool->totalloc += pool->pchunk;
 #endif
@@ -270,6 +315,33 @@ static BLI_freenode *mempool_chunk_add(BLI_mempool *pool, BLI_mempool_chunk *mpc
 	return curnode;
 }
 
+/**
+ * Add a new chunk to a thread-safe pool.
+ *
+ * The chunk is pushed atomically at the start of the list (\a chunk_tail is not used by these pools),
+ * the order of iteration is not kept.
+ *
+ * \return The free list of the elements of the new chunk.
+ */
+static BLI_freenode *mempool_chunk_add_threadsafe(BLI_mempool *pool)
+{
+	BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+	size_t head;
+
+	mempool_chunk_nodes_init(pool, mpchunk);
+
+	do {
+		head = (size_t)pool->chunks;
+		mpchunk->next = (BLI_mempool_chunk *)head;
+	} while (atomic_cas_z((size_t *)&pool->chunks, head, (size_t)mpchunk) != head);
+
+#ifdef USE_TOTALLOC
+	atomic_add_u(&pool->totalloc, pool->pchunk);
+#endif
+
+	return CHUNK_DATA(mpchunk);
+}
+
 static void mempool_chunk_free(BLI_mempool_chunk *mpchunk)
 {
 
@@ -334,6 +406,8 @@ BLI_mempool *BLI_mempool_create(unsigned int esize, unsigned int totelem,
 	pool->totalloc = 0;
 #endif
 	pool->totused = 0;
+	pool->threads = NULL;
+	pool->num_threads = 0;
 
 	if (totelem) {
 		/* allocate the actual chunks */
@@ -356,13 +430,18 @@ void *BLI_mempool_alloc(BLI_mempool *pool)
 
 	if (UNLIKELY(pool->free == NULL)) {
 		/* need to allocate a new chunk */
-		BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
-		mempool_chunk_add(pool, mpchunk, NULL);
+		if (pool->threads) {
+			pool->free = mempool_chunk_add_threadsafe(pool);
+		}
+		else {
+			BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+			mempool_chunk_add(pool, mpchunk, NULL);
+		}
 	}
 
 	free_pop = pool->free;
 
-	BLI_assert(pool->chunk_tail->next == NULL);
+	BLI_assert(pool->threads || pool->chunk_tail->next == NULL);
 
 	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
 		free_pop->freeword = USEDWORD;
@@ -390,29 +469,34 @@ void *BLI_mempool_calloc(BLI_mempool *pool)
  *
  * \note doesnt protect against double frees, don't be stupid!
  */
-void BLI_mempool_free(BLI_mempool *pool, void *addr)
-{
-	BLI_freenode *newhead = addr;
-
 #ifndef NDEBUG
-	{
-		BLI_mempool_chunk *chunk;
-		bool found = false;
-		for (chunk = pool->chunks; chunk; chunk = chunk->next) {
-			if (ARRAY_HAS_ITEM((char *)addr, (char *)CHUNK_DATA(chunk), pool->csize)) {
-				found = true;
-				break;
-			}
-		}
-		if (!found) {
-			BLI_assert(!"Attempt to free data which is not in pool.\n");
+static void mempool_free_debug_check(BLI_mempool *pool, void *addr)
+{
+	BLI_mempool_chunk *chunk;
+	bool found = false;
+	for (chunk = pool->chunks; chunk; chunk = chunk->next) {
+		if (ARRAY_HAS_ITEM((char *)addr, (char *)CHUNK_DATA(chunk), pool->csize)) {
+			found = true;
+			break;
 		}
 	}
+	if (!found) {
+		BLI_assert(!"Attempt to free data which is not in pool.\n");
+	}
 
 	/* enable for debugging */
 	if (UNLIKELY(mempool_debug_memset)) {
 		memset(addr, 255, pool->esize);
 	}
+}
+#endif
+
+void BLI_mempool_free(BLI_mempool *pool, void *addr)
+{
+	BLI_freenode *newhead = addr;
+
+#ifndef NDEBUG
+	mempool_free_debug_check(pool, addr);
 #endif
 
 	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
@@ -432,9 +516,11 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 	VALGRIND_MEMPOOL_FREE(pool, addr);
 #endif
 
-	/* nothing is in use; free all the chunks except the first */
+	/* nothing is in use; free all the chunks except the first
+	 * (not for thread-safe pools, the other threads may still use them) */
 	if (UNLIKELY(pool->totused == 0) &&
-	    (pool->chunks->next))
+	    (pool->chunks->next) &&
+	    (pool->threads == NULL))
 	{
 		const unsigned int esize = pool->esize;
 		BLI_freenode *curnode;
@@ -472,16 +558,132 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 	}
 }
 
+/**
+ * Create a pool which can be allocated from by multiple threads at once,
+ * using the thread ids of the task scheduler (0 for the main thread).
+ *
+ * Each thread takes elements from its own free list, and adds whole chunks to it when empty,
+ * so only adding a chunk to the pool is an atomic operation. Elements freed by a thread
+ * are reused by the same thread.
+ * The regular functions (#BLI_mempool_alloc, #BLI_mempool_free...) are those of thread 0.
+ */
+BLI_mempool *BLI_mempool_create_threadsafe(unsigned int esize, unsigned int totelem,
+                                           unsigned int pchunk, unsigned int flag,
+                                           unsigned int num_threads)
+{
+	BLI_mempool *pool = BLI_mempool_create(esize, totelem, pchunk, flag);
+
+	BLI_assert(num_threads > 0);
+
+	/* the first item is unused, thread 0 uses the pool free list */
+	pool->threads = MEM_callocN(sizeof(*pool->threads) * num_threads, "mempool threads");
+	pool->num_threads = num_threads;
+
+	return pool;
+}
+
+void *BLI_mempool_alloc_threadsafe(BLI_mempool *pool, const int threadid)
+{
+	BLI_mempool_thread *thread;
+	BLI_freenode *free_pop;
+
+	BLI_assert(pool->threads != NULL);
+	BLI_assert(threadid >= 0 && (unsigned int)threadid < pool->num_threads);
+
+	if (threadid == 0) {
+		return BLI_mempool_alloc(pool);
+	}
+
+	thread = &pool->threads[threadid];
+
+	if (UNLIKELY(thread->free == NULL)) {
+		thread->free = mempool_chunk_add_threadsafe(pool);
+	}
+
+	free_pop = thread->free;
+
+	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+		free_pop->freeword = USEDWORD;
+	}
+
+	thread->free = free_pop->next;
+	thread->totused++;
+
+#ifdef WITH_MEM_VALGRIND
+	VALGRIND_MEMPOOL_ALLOC(pool, free_pop, pool->esize);
+#endif
+
+	return (void *)free_pop;
+}
+
+void *BLI_mempool_calloc_threadsafe(BLI_mempool *pool, const int threadid)
+{
+	void *retval = BLI_mempool_alloc_threadsafe(pool, threadid);
+	memset(retval, 0, (size_t)pool->esize);
+	return retval;
+}
+
+/**
+ * Free an element from a thread-safe pool, it may have been allocated by another thread.
+ */
+void BLI_mempool_free_threadsafe(BLI_mempool *pool, void *addr, const int threadid)
+{
+	BLI_mempool_thread *thread;
+	BLI_freenode *newhead = addr;
+
+	BLI_assert(pool->threads != NULL);
+	BLI_assert(threadid >= 0 && (unsigned int)threadid < pool->num_threads);
+
+	if (threadid == 0) {
+		BLI_mempool_free(pool, addr);
+		return;
+	}
+
+#ifndef NDEBUG
+	mempool_free_debug_check(pool, addr);
+#endif
+
+	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+#ifndef NDEBUG
+		/* this will detect double free's */
+		BLI_assert(newhead->freeword != FREEWORD);
+#endif
+		newhead->freeword = FREEWORD;
+	}
+
+	thread = &pool->threads[threadid];
+	newhead->next = thread->free;
+	thread->free = newhead;
+	thread->totused--;
+
+#ifdef WITH_MEM_VALGRIND
+	VALGRIND_MEMPOOL_FREE(pool, addr);
+#endif
+}
+
+/* Elements in use, the counts of all threads add up (with wrap around)
+ * since elements can be freed by other threads than the ones allocating them. */
+static unsigned int mempool_totused(BLI_mempool *pool)
+{
+	unsigned int totused = pool->totused;
+	unsigned int i;
+
+	for (i = 1; i < pool->num_threads; i++) {
+		totused += pool->threads[i].totused;
+	}
+	return totused;
+}
+
 int BLI_mempool_count(BLI_mempool *pool)
 {
-	return (int)pool->totused;
+	return (int)mempool_totused(pool);
 }
 
 void *BLI_mempool_findelem(BLI_mempool *pool, unsigned int index)
 {
 	BLI_assert(pool->flag & BLI_MEMPOOL_ALLOW_ITER);
 
-	if (index < pool->totused) {
+	if (index < mempool_totused(pool)) {
 		/* we could have some faster mem chunk stepping code inline */
 		BLI_mempool_iter iter;
 		void *elem;
@@ -512,7 +714,7 @@ void BLI_mempool_as_table(BLI_mempool *pool, void **data)
 	while ((elem = BLI_mempool_iterstep(&iter))) {
 		*p++ = elem;
 	}
-	BLI_assert((unsigned int)(p - data) == pool->totused);
+	BLI_assert((unsigned int)(p - data) == mempool_totused(pool));
 }
 
 /**
@@ -520,7 +722,7 @@ void BLI_mempool_as_table(BLI_mempool *pool, void **data)
  */
 void **BLI_mempool_as_tableN(BLI_mempool *pool, const char *allocstr)
 {
-	void **data = MEM_mallocN((size_t)pool->totused * sizeof(void *), allocstr);
+	void **data = MEM_mallocN((size_t)mempool_totused(pool) * sizeof(void *), allocstr);
 	BLI_mempool_as_table(pool, data);
 	return data;
 }
@@ -539,7 +741,7 @@ void BLI_mempool_as_array(BLI_mempool *pool, void *data)
 		memcpy(p, elem, (size_t)esize);
 		p = NODE_STEP_NEXT(p);
 	}
-	BLI_assert((unsigned int)(p - (char *)data) == pool->totused * esize);
+	BLI_assert((unsigned int)(p - (char *)data) == mempool_totused(pool) * esize);
 }
 
 /**
@@ -547,7 +749,7 @@ void BLI_mempool_as_array(BLI_mempool *pool, void *data)
  */
 void *BLI_mempool_as_arrayN(BLI_mempool *pool, const char *allocstr)
 {
-	char *data = MEM_mallocN((size_t)(pool->totused * pool->esize), allocstr);
+	char *data = MEM_mallocN((size_t)(mempool_totused(pool) * pool->esize), allocstr);
 	BLI_mempool_as_array(pool, data);
 	return data;
 }
@@ -561,9 +763,47 @@ void BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter)
 
 	iter->pool = pool;
 	iter->curchunk = pool->chunks;
+	iter->endchunk = NULL;
 	iter->curindex = 0;
 }
 
+/**
+ * Split the iteration over \a pool into ranges of chunks, one iterator for each range,
+ * so the ranges can be iterated over in parallel, see #BLI_task_parallel_mempool.
+ *
+ * \param iters: Array of at least \a range_num iterators to initialize.
+ * \return The number of ranges, less than \a range_num when the pool has fewer chunks.
+ */
+unsigned int BLI_mempool_iter_ranges_init(BLI_mempool *pool, BLI_mempool_iter *iters, unsigned int range_num)
+{
+	BLI_mempool_chunk *mpchunk;
+	unsigned int chunks_num = 0, i;
+
+	BLI_assert(pool->flag & BLI_MEMPOOL_ALLOW_ITER);
+	BLI_assert(range_num > 0);
+
+	for (mpchunk = pool->chunks; mpchunk; mpchunk = mpchunk->next) {
+		chunks_num++;
+	}
+	range_num = MIN2(range_num, chunks_num);
+
+	mpchunk = pool->chunks;
+	for (i = 0; i < range_num; i++) {
+		/* spread the remaining chunks over the first ranges */
+		unsigned int range_chunks = (chunks_num / range_num) + ((i < chunks_num % range_num) ? 1 : 0);
+
+		iters[i].pool = pool;
+		iters[i].curchunk = mpchunk;
+		iters[i].curindex = 0;
+		while (range_chunks--) {
+			mpchunk = mpchunk->next;
+		}
+		iters[i].endchunk = mpchunk;
+	}
+
+	return range_num;
+}
+
 #if 0
 /* unoptimized, more readable */
 
@@ -571,7 +811,7 @@ static void *bli_mempool_iternext(BLI_mempool_iter *iter)
 {
 	void *ret = NULL;
 
-	if (!iter->curchunk || !iter->pool->totused) return NULL;
+	if (iter->curchunk == iter->endchunk || !iter->pool->totused) return NULL;
 
 	ret = ((char *)CHUNK_DATA(iter->curchunk)) + (iter->pool->esize * iter->curindex);
 
@@ -605,7 +845,7 @@ void *BLI_mempool_iterstep(BLI_mempool_iter *iter)
  */
 void *BLI_mempool_iterstep(BLI_mempool_iter *iter)
 {
-	if (UNLIKELY(iter->curchunk == NULL)) {
+	if (UNLIKELY(iter->curchunk == iter->endchunk)) {
 		return NULL;
 	}
 
@@ -621,7 +861,7 @@ void *BLI_mempool_iterstep(BLI_mempool_iter *iter)
 		else {
 			iter->curindex = 0;
 			iter->curchunk = iter->curchunk->next;
-			if (iter->curchunk == NULL) {
+			if (iter->curchunk == iter->endchunk) {
 				return (ret->freeword == FREEWORD) ? NULL : ret;
 			}
 			curnode = CHUNK_DATA(iter->curchunk);
@@ -677,6 +917,10 @@ void BLI_mempool_clear_ex(BLI_mempool *pool, const int totelem_reserve)
 	/* re-initialize */
 	pool->free = NULL;
 	pool->totused = 0;
+	for (unsigned int i = 1; i < pool->num_threads; i++) {
+		pool->threads[i].free = NULL;
+		pool->threads[i].totused = 0;
+	}
 #ifdef USE_TOTALLOC
 	pool->totalloc = 0;
 #endif
@@ -706,6 +950,10 @@ void BLI_mempool_destroy(BLI_mempool *pool)
 {
 	mempool_chunk_free_all(pool->chunks);
 
+	if (pool->threads) {
+		MEM_freeN(pool->threads);
+	}
+
 #ifdef WITH_MEM_VALGRIND
 	VALGRIND_DESTROY_MEMPOOL(pool);
 #endif
@@ -32,6 +32,7 @@
 
 #include "BLI_listbase.h"
 #include "BLI_math.h"
+#include "BLI_mempool.h"
 #include "BLI_task.h"
 #include "BLI_threads.h"
 
@@ -139,6 +140,27 @@ struct TaskPool {
 #endif
 };
 
+/* Per-thread queue of tasks.
+ *
+ * Tasks pushed from a worker thread go to the queue of that thread, so pushing
+ * from a task only contends with threads stealing from that same queue instead
+ * of with all the workers of the scheduler. Queue 0 is shared by the threads
+ * which are not workers of the scheduler (the main thread and other threads
+ * doing BLI_task_pool_work_and_wait()).
+ *
+ * Tasks are ordered by priority, high priority tasks are at the head.
+ */
+typedef struct TaskQueue {
+	ListBase tasks;
+	/* Number of tasks and tasks of background pools, read without the lock
+	 * to skip queues without tasks for a thread. */
+	volatile size_t num_tasks;
+	volatile size_t num_background_tasks;
+	SpinLock lock;
+	/* Keep locks of different queues on different cache lines. */
+	char pad[64];
+} TaskQueue;
+
 struct TaskScheduler {
 	pthread_t *threads;
 	struct TaskThread *task_threads;
@@ -146,9 +168,13 @@ struct TaskScheduler {
 	int num_threads;
 	bool background_thread_only;
 
-	ListBase queue;
+	/* Queue 0 is the shared queue, 1..num_threads belong to the worker threads. */
+	TaskQueue *queues;
+
+	/* Only used by workers to sleep while there are no tasks to run. */
 	ThreadMutex queue_mutex;
 	ThreadCondition queue_cond;
+	size_t num_sleeping;
 
 	volatile bool do_exit;
 };
@@ -256,59 +282,144 @@ static void task_pool_num_increase(TaskPool *pool)
 	BLI_mutex_unlock(&pool->num_mutex);
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+/* Reserve one of the threads of the pool for running a task of it,
+ * fails when the pool already runs its maximum number of tasks. */
+BLI_INLINE bool task_pool_thread_acquire(TaskPool *pool)
 {
-	bool found_task = false;
-	BLI_mutex_lock(&scheduler->queue_mutex);
-
-	while (!scheduler->queue.first && !scheduler->do_exit)
-		BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+	if (pool->num_threads == 0) {
+		atomic_add_z(&pool->currently_running_tasks, 1);
+		return true;
+	}
 
-	do {
-		Task *current_task;
+	while (true) {
+		const size_t running = *(volatile size_t *)&pool->currently_running_tasks;
 
-		/* Assuming we can only have a void queue in 'exit' case here seems logical (we should only be here after
-		 * our worker thread has been woken up from a condition_wait(), which only happens after a new task was
-		 * added to the queue), but it is wrong.
-		 * Waiting on condition may wake up the thread even if condition is not signaled (spurious wake-ups), and some
-		 * race condition may also empty the queue **after** condition has been signaled, but **before** awoken thread
-		 * reaches this point...
-		 * See http://stackoverflow.com/questions/8594591
-		 *
-		 * So we only abort here if do_exit is set.
-		 */
-		if (scheduler->do_exit) {
-			BLI_mutex_unlock(&scheduler->queue_mutex);
+		if (running >= pool->num_threads) {
 			return false;
 		}
+		if (atomic_cas_z(&pool->currently_running_tasks, running, running + 1) == running) {
+			return true;
+		}
+	}
+}
+
+/* Remove the first task from the queue which is allowed to run.
+ * When pool is given only tasks of that pool are considered, when
+ * background_only is set only tasks of background pools. */
+static Task *task_queue_pop(TaskQueue *queue, TaskPool *pool, const bool background_only)
+{
+	Task *task;
+
+	if (queue->num_tasks == 0 || (background_only && queue->num_background_tasks == 0)) {
+		return NULL;
+	}
+
+	BLI_spin_lock(&queue->lock);
+
+	for (task = queue->tasks.first; task; task = task->next) {
+		if (pool != NULL && task->pool != pool) {
+			continue;
+		}
 
-		for (current_task = scheduler->queue.first;
-		     current_task != NULL;
-		     current_task = current_task->next)
-		{
-			TaskPool *pool = current_task->pool;
+		if (background_only && !task->pool->run_in_background) {
+			continue;
+		}
 
-			if (scheduler->background_thread_only && !pool->run_in_background) {
-				continue;
+		if (task_pool_thread_acquire(task->pool)) {
+			BLI_remlink(&queue->tasks, task);
+			queue->num_tasks--;
+			if (task->pool->run_in_background) {
+				queue->num_background_tasks--;
 			}
+			break;
+		}
+	}
 
-			if (pool->num_threads == 0 ||
-			    pool->currently_running_tasks < pool->num_threads)
-			{
-				*task = current_task;
-				found_task = true;
-				atomic_add_z(&pool->currently_running_tasks, 1);
-				BLI_remlink(&scheduler->queue, *task);
-				break;
+	BLI_spin_unlock(&queue->lock);
+
+	return task;
+}
+
+/* Find a task for a worker thread.
+ *
+ * The own queue of the thread goes first, tasks pushed from this thread are likely
+ * to use data which is still in its cache. Then tasks pushed from other threads than
+ * workers and finally tasks are stolen from the other workers, preferring tasks of
+ * the pool this thread worked on last.
+ */
+static Task *task_scheduler_find_task(TaskScheduler *scheduler, int thread_id, TaskPool *last_pool)
+{
+	const bool background_only = scheduler->background_thread_only;
+	const int num_threads = scheduler->num_threads;
+	Task *task;
+	int i;
+
+	if ((task = task_queue_pop(&scheduler->queues[thread_id], NULL, background_only))) {
+		return task;
+	}
+
+	if ((task = task_queue_pop(&scheduler->queues[0], NULL, background_only))) {
+		return task;
+	}
+
+	/* Start with the next thread, so not all threads steal from the same victim. */
+	if (last_pool != NULL) {
+		for (i = 1; i < num_threads; i++) {
+			TaskQueue *queue = &scheduler->queues[(thread_id - 1 + i) % num_threads + 1];
+			if ((task = task_queue_pop(queue, last_pool, background_only))) {
+				return task;
 			}
 		}
-		if (!found_task)
-			BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
-	} while (!found_task);
+	}
 
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+	for (i = 1; i < num_threads; i++) {
+		TaskQueue *queue = &scheduler->queues[(thread_id - 1 + i) % num_threads + 1];
+		if ((task = task_queue_pop(queue, NULL, background_only))) {
+			return task;
+		}
+	}
+
+	return NULL;
+}
+
+static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, int thread_id,
+                                           TaskPool *last_pool, Task **task)
+{
+	while (!scheduler->do_exit) {
+		if ((*task = task_scheduler_find_task(scheduler, thread_id, last_pool))) {
+			return true;
+		}
+
+		BLI_mutex_lock(&scheduler->queue_mutex);
+
+		/* Announce this thread goes to sleep before looking at the queues for the last
+		 * time. Both this and the check in task_scheduler_push() are full barriers, so
+		 * either the pushed task is found here, or the pushing thread sees this thread
+		 * sleeping and wakes it up (after the wait released the mutex).
+		 *
+		 * The wait may also end without a task being pushed (spurious wake-ups, or
+		 * another thread took the task first), so we only abort if do_exit is set.
+		 * See http://stackoverflow.com/questions/8594591
+		 */
+		atomic_add_z(&scheduler->num_sleeping, 1);
+
+		if (!scheduler->do_exit) {
+			*task = task_scheduler_find_task(scheduler, thread_id, last_pool);
+			if (*task == NULL) {
+				BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+			}
+		}
+
+		atomic_sub_z(&scheduler->num_sleeping, 1);
+
+		BLI_mutex_unlock(&scheduler->queue_mutex);
+
+		if (*task != NULL) {
+			return true;
+		}
+	}
 
-	return true;
+	return false;
 }
 
 static void *task_scheduler_thread_run(void *thread_p)
@@ -316,10 +427,11 @@ static void *task_scheduler_thread_run(void *thread_p)
 	TaskThread *thread = (TaskThread *) thread_p;
 	TaskScheduler *scheduler = thread->scheduler;
 	int thread_id = thread->id;
+	TaskPool *last_pool = NULL;
 	Task *task;
 
 	/* keep popping off tasks */
-	while (task_scheduler_thread_wait_pop(scheduler, &task)) {
+	while (task_scheduler_thread_wait_pop(scheduler, thread_id, last_pool, &task)) {
 		TaskPool *pool = task->pool;
 
 		/* run task */
@@ -328,7 +440,9 @@ static void *task_scheduler_thread_run(void *thread_p)
 		/* delete task */
 		task_free(pool, task, thread_id);
 
-		/* notify pool task was done */
+		/* notify pool task was done, the pool may be freed after this,
+		 * last_pool is only compared with pools of tasks in the queues */
+		last_pool = pool;
 		task_pool_num_decrease(pool, 1);
 	}
 
@@ -343,7 +457,6 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 	 * threads, so we keep track of the number of users. */
 	scheduler->do_exit = false;
 
-	BLI_listbase_clear(&scheduler->queue);
 	BLI_mutex_init(&scheduler->queue_mutex);
 	BLI_condition_init(&scheduler->queue_cond);
 
@@ -369,6 +482,12 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 		scheduler->threads = MEM_callocN(sizeof(pthread_t) * num_threads, "TaskScheduler threads");
 		scheduler->task_threads = MEM_callocN(sizeof(TaskThread) * num_threads, "TaskScheduler task threads");
 
+		/* queues must exist before the threads start looking at them */
+		scheduler->queues = MEM_callocN(sizeof(TaskQueue) * (num_threads + 1), "TaskScheduler queues");
+		for (i = 0; i <= num_threads; i++) {
+			BLI_spin_init(&scheduler->queues[i].lock);
+		}
+
 		for (i = 0; i < num_threads; i++) {
 			TaskThread *thread = &scheduler->task_threads[i];
 			thread->scheduler = scheduler;
@@ -424,10 +543,18 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
 	}
 
 	/* delete leftover tasks */
-	for (task = scheduler->queue.first; task; task = task->next) {
-		task_data_free(task, 0);
+	if (scheduler->queues) {
+		for (int i = 0; i <= scheduler->num_threads; i++) {
+			TaskQueue *queue = &scheduler->queues[i];
+
+			for (task = queue->tasks.first; task; task = task->next) {
+				task_data_free(task, 0);
+			}
+			BLI_freelistN(&queue->tasks);
+			BLI_spin_end(&queue->lock);
+		}
+		MEM_freeN(scheduler->queues);
 	}
-	BLI_freelistN(&scheduler->queue);
 
 	/* delete mutex/condition */
 	BLI_mutex_end(&scheduler->queue_mutex);
@@ -441,20 +568,56 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
 	return scheduler->num_threads + 1;
 }
 
-static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
+static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority,
+                                const int thread_id)
 {
-	task_pool_num_increase(task->pool);
+	/* tasks pushed from a worker go to its own queue, others to the shared queue */
+	TaskQueue *queue = &scheduler->queues[(thread_id > 0) ? thread_id : 0];
+	TaskPool *pool = task->pool;
+
+	task_pool_num_increase(pool);
 
 	/* add task to queue */
-	BLI_mutex_lock(&scheduler->queue_mutex);
+	BLI_spin_lock(&queue->lock);
 
 	if (priority == TASK_PRIORITY_HIGH)
-		BLI_addhead(&scheduler->queue, task);
+		BLI_addhead(&queue->tasks, task);
 	else
-		BLI_addtail(&scheduler->queue, task);
+		BLI_addtail(&queue->tasks, task);
 
-	BLI_condition_notify_one(&scheduler->queue_cond);
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+	queue->num_tasks++;
+	if (pool->run_in_background) {
+		queue->num_background_tasks++;
+	}
+
+	BLI_spin_unlock(&queue->lock);
+
+	/* wake up a sleeping worker, see task_scheduler_thread_wait_pop(),
+	 * the task may already run on another thread, don't access it anymore,
+	 * the background thread can not run tasks of other pools */
+	if (scheduler->background_thread_only && !pool->run_in_background) {
+		return;
+	}
+
+	if (atomic_add_z(&scheduler->num_sleeping, 0) != 0) {
+		BLI_mutex_lock(&scheduler->queue_mutex);
+		BLI_condition_notify_one(&scheduler->queue_cond);
+		BLI_mutex_unlock(&scheduler->queue_mutex);
+	}
+}
+
+/* Find a task of the pool for a thread waiting for it to be done. */
+static Task *task_scheduler_find_pool_task(TaskScheduler *scheduler, TaskPool *pool)
+{
+	Task *task;
+
+	for (int i = 0; i <= scheduler->num_threads; i++) {
+		if ((task = task_queue_pop(&scheduler->queues[i], pool, false))) {
+			return task;
+		}
+	}
+
+	return NULL;
 }
 
 static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
@@ -462,21 +625,33 @@ static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
 	Task *task, *nexttask;
 	size_t done = 0;
 
-	BLI_mutex_lock(&scheduler->queue_mutex);
+	/* free all tasks from this pool from the queues */
+	for (int i = 0; i <= scheduler->num_threads; i++) {
+		TaskQueue *queue = &scheduler->queues[i];
+
+		if (queue->num_tasks == 0) {
+			continue;
+		}
 
-	/* free all tasks from this pool from the queue */
-	for (task = scheduler->queue.first; task; task = nexttask) {
-		nexttask = task->next;
+		BLI_spin_lock(&queue->lock);
 
-		if (task->pool == pool) {
-			task_data_free(task, 0);
-			BLI_freelinkN(&scheduler->queue, task);
+		for (task = queue->tasks.first; task; task = nexttask) {
+			nexttask = task->next;
+
+			if (task->pool == pool) {
+				task_data_free(task, 0);
+				BLI_freelinkN(&queue->tasks, task);
+				queue->num_tasks--;
+				if (pool->run_in_background) {
+					queue->num_background_tasks--;
+				}
 
-			done++;
+				done++;
+			}
 		}
-	}
 
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+		BLI_spin_unlock(&queue->lock);
+	}
 
 	/* notify done */
 	task_pool_num_decrease(pool, done);
@@ -610,7 +785,7 @@ static void task_pool_push(
 	task->freedata = freedata;
 	task->pool = pool;
 
-	task_scheduler_push(pool->scheduler, task, priority);
+	task_scheduler_push(pool->scheduler, task, priority, thread_id);
 }
 
 void BLI_task_pool_push_ex(
@@ -639,36 +814,18 @@ void BLI_task_pool_work_and_wait(TaskPool *pool)
 	BLI_mutex_lock(&pool->num_mutex);
 
 	while (pool->num != 0) {
-		Task *task, *work_task = NULL;
-		bool found_task = false;
+		Task *task;
 
 		BLI_mutex_unlock(&pool->num_mutex);
 
-		BLI_mutex_lock(&scheduler->queue_mutex);
-
 		/* find task from this pool. if we get a task from another pool,
 		 * we can get into deadlock */
-
-		if (pool->num_threads == 0 ||
-		    pool->currently_running_tasks < pool->num_threads)
-		{
-			for (task = scheduler->queue.first; task; task = task->next) {
-				if (task->pool == pool) {
-					work_task = task;
-					found_task = true;
-					BLI_remlink(&scheduler->queue, task);
-					break;
-				}
-			}
-		}
-
-		BLI_mutex_unlock(&scheduler->queue_mutex);
+		task = task_scheduler_find_pool_task(scheduler, pool);
 
 		/* if found task, do it, otherwise wait until other tasks are done */
-		if (found_task) {
+		if (task) {
 			/* run task */
-			atomic_add_z(&pool->currently_running_tasks, 1);
-			work_task->run(pool, work_task->taskdata, 0);
+			task->run(pool, task->taskdata, 0);
 
 			/* delete task */
 			task_free(pool, task, 0);
@@ -681,7 +838,7 @@ void BLI_task_pool_work_and_wait(TaskPool *pool)
 		if (pool->num == 0)
 			break;
 
-		if (!found_task)
+		if (!task)
 			BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
 	}
 
@@ -753,11 +910,11 @@ size_t BLI_task_pool_tasks_done(TaskPool *pool)
  * Main functions:
  * - #BLI_task_parallel_range
  * - #BLI_task_parallel_listbase (#ListBase - double linked list)
+ * - #BLI_task_parallel_mempool (#BLI_mempool - iterate over mempools)
  *
  * TODO:
  * - #BLI_task_parallel_foreach_link (#Link - single linked list)
  * - #BLI_task_parallel_foreach_ghash/gset (#GHash/#GSet - hash & set)
- * - #BLI_task_parallel_foreach_mempool (#BLI_mempool - iterate over mempools)
  *
  */
 
@@ -1130,3 +1287,96 @@ void BLI_task_parallel_listbase(
 
 	BLI_spin_end(&state.lock);
 }
+
+typedef struct ParallelMempoolState {
+	void *userdata;
+	TaskParallelMempoolFunc func;
+
+	BLI_mempool_iter *iters;
+	int iters_num;
+	int iter;
+} ParallelMempoolState;
+
+static void parallel_mempool_func(
+        TaskPool * __restrict pool,
+        void *UNUSED(taskdata),
+        int threadid)
+{
+	ParallelMempoolState * __restrict state = BLI_task_pool_userdata(pool);
+	int index;
+
+	while ((index = (int)atomic_fetch_and_add_uint32((uint32_t *)&state->iter, 1)) < state->iters_num) {
+		BLI_mempool_iter *iter = &state->iters[index];
+		void *elem;
+
+		while ((elem = BLI_mempool_iterstep(iter))) {
+			state->func(state->userdata, elem, threadid);
+		}
+	}
+}
+
+/**
+ * This function allows to parallelize for loops over the elements of a mempool.
+ *
+ * \param pool The mempool to loop over, it must have the #BLI_MEMPOOL_ALLOW_ITER flag.
+ * \param userdata Common userdata passed to all instances of \a func.
+ * \param func Callback function, the thread id can be used to allocate from a thread-safe mempool.
+ * \param use_threading If \a true, actually split-execute loop in threads, else just do a sequential forloop
+ *                      (allows caller to use any kind of test to switch on parallelization or not).
+ *
+ * \note The elements are split into ranges of chunks, the order of the elements is not kept.
+ */
+void BLI_task_parallel_mempool(
+        BLI_mempool *mempool,
+        void *userdata,
+        TaskParallelMempoolFunc func,
+        const bool use_threading)
+{
+	TaskScheduler *task_scheduler;
+	TaskPool *task_pool;
+	ParallelMempoolState state;
+	int i, num_threads, num_tasks;
+
+	if (BLI_mempool_count(mempool) == 0) {
+		return;
+	}
+
+	if (!use_threading) {
+		BLI_mempool_iter iter;
+		void *elem;
+
+		BLI_mempool_iternew(mempool, &iter);
+		while ((elem = BLI_mempool_iterstep(&iter))) {
+			func(userdata, elem, 0);
+		}
+		return;
+	}
+
+	task_scheduler = BLI_task_scheduler_get();
+	task_pool = BLI_task_pool_create(task_scheduler, &state);
+	num_threads = BLI_task_scheduler_num_threads(task_scheduler);
+
+	/* More ranges than threads, since the elements in use are not spread evenly over the chunks. */
+	num_tasks = num_threads * 2;
+
+	state.userdata = userdata;
+	state.func = func;
+	state.iters = MEM_mallocN(sizeof(*state.iters) * (size_t)(num_threads * 4), __func__);
+	state.iters_num = (int)BLI_mempool_iter_ranges_init(mempool, state.iters, (unsigned int)(num_threads * 4));
+	state.iter = 0;
+
+	num_tasks = min_ii(num_tasks, state.iters_num);
+
+	for (i = 0; i < num_tasks; i++) {
+		/* Use this pool's pre-allocated tasks. */
+		BLI_task_pool_push_from_thread(task_pool,
+		                               parallel_mempool_func,
+		                               NULL, false,
+		                               TASK_PRIORITY_HIGH, 0);
+	}
+
+	BLI_task_pool_work_and_wait(task_pool);
+	BLI_task_pool_free(task_pool);
+
+	MEM_freeN(state.iters);
+}
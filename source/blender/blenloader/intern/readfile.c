@@ -45,6 +45,7 @@
 #include "BLI_utildefines.h"
 #ifndef WIN32
 #  include <unistd.h> // for read close
+#  include <sys/mman.h> // for mmap munmap
 #else
 #  include <io.h> // for open close read
 #  include "winsock2.h"
@@ -111,6 +112,8 @@
 #include "BLI_threads.h"
 #include "BLI_mempool.h"
 
+#include "PIL_time.h"
+
 #include "BLT_translation.h"
 
 #include "BKE_action.h"
@@ -230,8 +233,11 @@ typedef struct OldNew {
 typedef struct OldNewMap {
 	OldNew *entries;
 	int nentries, entriessize;
-	bool sorted;
 	int lasthit;
+	/* Open addressing hash of the old addresses, storing indices in entries (-1 for empty slots).
+	 * The size is a power of two, kept at least twice the number of entries. */
+	int *map;
+	int map_size;
 } OldNewMap;
 
 
@@ -274,31 +280,60 @@ static const char *library_parent_filepath(Library *lib)
 	return lib->parent ? lib->parent->filepath : "<direct>";
 }
 
+#define OLDNEWMAP_MAP_SIZE_DEFAULT 2048
+
 static OldNewMap *oldnewmap_new(void) 
 {
 	OldNewMap *onm= MEM_callocN(sizeof(*onm), "OldNewMap");
 	
 	onm->entriessize = 1024;
 	onm->entries = MEM_mallocN(sizeof(*onm->entries)*onm->entriessize, "OldNewMap.entries");
+
+	onm->map_size = OLDNEWMAP_MAP_SIZE_DEFAULT;
+	onm->map = MEM_mallocN(sizeof(*onm->map) * onm->map_size, "OldNewMap.map");
+	memset(onm->map, -1, sizeof(*onm->map) * onm->map_size);
 	
 	return onm;
 }
 
-static int verg_oldnewmap(const void *v1, const void *v2)
+/* Addresses are aligned and allocated close to each other, mix all the bits. */
+BLI_INLINE unsigned int oldnewmap_hash(const void *addr)
 {
-	const struct OldNew *x1=v1, *x2=v2;
-	
-	if (x1->old > x2->old) return 1;
-	else if (x1->old < x2->old) return -1;
-	return 0;
+	uint64_t key = (uint64_t)(uintptr_t)addr;
+
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+
+	return (unsigned int)key;
 }
 
+/* Return the slot of \a addr in the map, or the empty slot where it should be inserted. */
+BLI_INLINE int oldnewmap_map_slot(const OldNewMap *onm, const void *addr)
+{
+	const unsigned int mask = (unsigned int)onm->map_size - 1;
+	unsigned int slot = oldnewmap_hash(addr) & mask;
+
+	while (onm->map[slot] != -1 && onm->entries[onm->map[slot]].old != addr) {
+		slot = (slot + 1) & mask;
+	}
+
+	return (int)slot;
+}
 
-static void oldnewmap_sort(FileData *fd) 
+static void oldnewmap_map_grow(OldNewMap *onm)
 {
-	BLI_assert(fd->libmap->sorted == false);
-	qsort(fd->libmap->entries, fd->libmap->nentries, sizeof(OldNew), verg_oldnewmap);
-	fd->libmap->sorted = 1;
+	int i;
+
+	onm->map_size *= 2;
+	MEM_freeN(onm->map);
+	onm->map = MEM_mallocN(sizeof(*onm->map) * onm->map_size, "OldNewMap.map");
+	memset(onm->map, -1, sizeof(*onm->map) * onm->map_size);
+
+	/* in order, so duplicated addresses keep pointing to the last entry */
+	for (i = 0; i < onm->nentries; i++) {
+		onm->map[oldnewmap_map_slot(onm, onm->entries[i].old)] = i;
+	}
 }
 
 /* nr is zero for data, and ID code for libdata */
@@ -313,10 +348,17 @@ static void oldnewmap_insert(OldNewMap *onm, const void *oldaddr, void *newaddr,
 		onm->entries = MEM_reallocN(onm->entries, sizeof(*onm->entries) * onm->entriessize);
 	}
 
-	entry = &onm->entries[onm->nentries++];
+	entry = &onm->entries[onm->nentries];
 	entry->old = oldaddr;
 	entry->newp = newaddr;
 	entry->nr = nr;
+
+	/* a duplicated address replaces the previous one in the map, as the backward search used to */
+	onm->map[oldnewmap_map_slot(onm, oldaddr)] = onm->nentries++;
+
+	if (UNLIKELY(onm->nentries * 2 > onm->map_size)) {
+		oldnewmap_map_grow(onm);
+	}
 }
 
 void blo_do_versions_oldnewmap_insert(OldNewMap *onm, const void *oldaddr, void *newaddr, int nr)
@@ -327,51 +369,13 @@ void blo_do_versions_oldnewmap_insert(OldNewMap *onm, const void *oldaddr, void
 /**
  * Do a full search (no state).
  *
- * \param lasthit: Use as a reference position to avoid a full search
- * from either end of the array, giving more efficient lookups.
- *
- * \note This would seem an ideal case for hash or btree lookups.
- * However the data is written in-order, using the \a lasthit will normally avoid calling this function.
- * Creating a btree/hash structure adds overhead for the common-case to optimize the corner-case
- * (since most entries will never be retrieved).
- * So just keep full lookups as a fall-back.
+ * \note The data is written in-order, using the \a lasthit will normally avoid calling this function.
+ * Big files still have many out of order lookups (libdata, pointers between data-blocks),
+ * so the full search uses the hash of the old addresses.
  */
-static int oldnewmap_lookup_entry_full(const OldNewMap *onm, const void *addr, int lasthit)
+static int oldnewmap_lookup_entry_full(const OldNewMap *onm, const void *addr)
 {
-	const int nentries = onm->nentries;
-	const OldNew *entries = onm->entries;
-	int i;
-
-	/* search relative to lasthit where possible */
-	if (lasthit >= 0 && lasthit < nentries) {
-
-		/* search forwards */
-		i = lasthit;
-		while (++i != nentries) {
-			if (entries[i].old == addr) {
-				return i;
-			}
-		}
-
-		/* search backwards */
-		i = lasthit + 1;
-		while (i--) {
-			if (entries[i].old == addr) {
-				return i;
-			}
-		}
-	}
-	else {
-		/* search backwards (full) */
-		i = nentries;
-		while (i--) {
-			if (entries[i].old == addr) {
-				return i;
-			}
-		}
-	}
-
-	return -1;
+	return onm->map[oldnewmap_map_slot(onm, addr)];
 }
 
 static void *oldnewmap_lookup_and_inc(OldNewMap *onm, const void *addr, bool increase_users)
@@ -390,7 +394,7 @@ static void *oldnewmap_lookup_and_inc(OldNewMap *onm, const void *addr, bool inc
 		}
 	}
 	
-	i = oldnewmap_lookup_entry_full(onm, addr, onm->lasthit);
+	i = oldnewmap_lookup_entry_full(onm, addr);
 	if (i != -1) {
 		OldNew *entry = &onm->entries[i];
 		BLI_assert(entry->old == addr);
@@ -411,27 +415,13 @@ static void *oldnewmap_liblookup(OldNewMap *onm, const void *addr, const void *l
 	}
 
 	/* lasthit works fine for non-libdata, linking there is done in same sequence as writing */
-	if (onm->sorted) {
-		const OldNew entry_s = {.old = addr};
-		OldNew *entry = bsearch(&entry_s, onm->entries, onm->nentries, sizeof(OldNew), verg_oldnewmap);
-		if (entry) {
-			ID *id = entry->newp;
-
-			if (id && (!lib || id->lib)) {
-				return id;
-			}
-		}
-	}
-	else {
-		/* note, this can be a bottle neck when loading some files */
-		const int i = oldnewmap_lookup_entry_full(onm, addr, -1);
-		if (i != -1) {
-			OldNew *entry = &onm->entries[i];
-			ID *id = entry->newp;
-			BLI_assert(entry->old == addr);
-			if (id && (!lib || id->lib)) {
-				return id;
-			}
+	const int i = oldnewmap_lookup_entry_full(onm, addr);
+	if (i != -1) {
+		OldNew *entry = &onm->entries[i];
+		ID *id = entry->newp;
+		BLI_assert(entry->old == addr);
+		if (id && (!lib || id->lib)) {
+			return id;
 		}
 	}
 
@@ -453,12 +443,33 @@ static void oldnewmap_free_unused(OldNewMap *onm)
 
 static void oldnewmap_clear(OldNewMap *onm) 
 {
+	const unsigned int mask = (unsigned int)onm->map_size - 1;
+	int i;
+
+	/* The map is cleared for every read data-block, only reset the used slots.
+	 * Slots emptied before are skipped, the entry is always further in its probe sequence. */
+	for (i = 0; i < onm->nentries; i++) {
+		unsigned int slot = oldnewmap_hash(onm->entries[i].old) & mask;
+
+		while (onm->map[slot] != i) {
+			if (onm->map[slot] != -1 && onm->entries[onm->map[slot]].old == onm->entries[i].old) {
+				/* duplicated address, the slot is owned by the last entry and reset with it */
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+		if (onm->map[slot] == i) {
+			onm->map[slot] = -1;
+		}
+	}
+
 	onm->nentries = 0;
 	onm->lasthit = 0;
 }
 
 static void oldnewmap_free(OldNewMap *onm) 
 {
+	MEM_freeN(onm->map);
 	MEM_freeN(onm->entries);
 	MEM_freeN(onm);
 }
@@ -1007,6 +1018,161 @@ static int fd_read_gzip_from_file(FileData *filedata, void *buffer, unsigned int
 	return (readsize);
 }
 
+/* ************** Threaded gzip reading ************** */
+
+/* Compressed files are decompressed in a background thread, ahead of get_bhead()
+ * parsing the blocks. The data goes through a ring of chunks. */
+
+#define READ_THREAD_CHUNK_SIZE (1 << 20)
+#define READ_THREAD_CHUNK_NUM 4
+
+typedef struct FileReadThread {
+	pthread_t thread;
+	ThreadMutex mutex;
+	ThreadCondition cond;
+
+	gzFile gzfile;
+	char *chunks[READ_THREAD_CHUNK_NUM];
+	int chunks_size[READ_THREAD_CHUNK_NUM];
+	/* Number of chunks decompressed and consumed, the index in the ring is modulo the number of chunks. */
+	int write_chunk, read_chunk;
+	bool eof, cancel;
+
+	/* only used by the reading thread, true when the current chunk is decompressed */
+	bool read_ready;
+	int read_offset;
+} FileReadThread;
+
+static void *file_read_thread_run(void *data)
+{
+	FileReadThread *rt = data;
+
+	while (true) {
+		char *chunk;
+		int size;
+
+		BLI_mutex_lock(&rt->mutex);
+		while (rt->write_chunk - rt->read_chunk == READ_THREAD_CHUNK_NUM && !rt->cancel) {
+			BLI_condition_wait(&rt->cond, &rt->mutex);
+		}
+		if (rt->cancel) {
+			BLI_mutex_unlock(&rt->mutex);
+			break;
+		}
+		chunk = rt->chunks[rt->write_chunk % READ_THREAD_CHUNK_NUM];
+		BLI_mutex_unlock(&rt->mutex);
+
+		/* the chunk isn't used by the reader until it's counted as written */
+		size = gzread(rt->gzfile, chunk, READ_THREAD_CHUNK_SIZE);
+
+		BLI_mutex_lock(&rt->mutex);
+		if (size <= 0) {
+			rt->eof = true;
+		}
+		else {
+			rt->chunks_size[rt->write_chunk % READ_THREAD_CHUNK_NUM] = size;
+			rt->write_chunk++;
+		}
+		BLI_condition_notify_all(&rt->cond);
+		BLI_mutex_unlock(&rt->mutex);
+
+		if (size <= 0) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static FileReadThread *file_read_thread_start(gzFile gzfile)
+{
+	FileReadThread *rt = MEM_callocN(sizeof(FileReadThread), "FileReadThread");
+	int i;
+
+	rt->gzfile = gzfile;
+	for (i = 0; i < READ_THREAD_CHUNK_NUM; i++) {
+		rt->chunks[i] = MEM_mallocN(READ_THREAD_CHUNK_SIZE, "FileReadThread.chunk");
+	}
+
+	BLI_mutex_init(&rt->mutex);
+	BLI_condition_init(&rt->cond);
+
+	if (pthread_create(&rt->thread, NULL, file_read_thread_run, rt) != 0) {
+		BLI_condition_end(&rt->cond);
+		BLI_mutex_end(&rt->mutex);
+		for (i = 0; i < READ_THREAD_CHUNK_NUM; i++) {
+			MEM_freeN(rt->chunks[i]);
+		}
+		MEM_freeN(rt);
+		return NULL;
+	}
+
+	return rt;
+}
+
+static void file_read_thread_end(FileReadThread *rt)
+{
+	int i;
+
+	BLI_mutex_lock(&rt->mutex);
+	rt->cancel = true;
+	BLI_condition_notify_all(&rt->cond);
+	BLI_mutex_unlock(&rt->mutex);
+
+	pthread_join(rt->thread, NULL);
+
+	BLI_condition_end(&rt->cond);
+	BLI_mutex_end(&rt->mutex);
+	for (i = 0; i < READ_THREAD_CHUNK_NUM; i++) {
+		MEM_freeN(rt->chunks[i]);
+	}
+	MEM_freeN(rt);
+}
+
+static int fd_read_gzip_from_thread(FileData *filedata, void *buffer, unsigned int size)
+{
+	FileReadThread *rt = filedata->readthread;
+	unsigned int totread = 0;
+
+	while (totread < size) {
+		const int chunk_index = rt->read_chunk % READ_THREAD_CHUNK_NUM;
+		unsigned int readsize;
+
+		if (!rt->read_ready) {
+			BLI_mutex_lock(&rt->mutex);
+			while (rt->read_chunk == rt->write_chunk && !rt->eof) {
+				BLI_condition_wait(&rt->cond, &rt->mutex);
+			}
+			rt->read_ready = (rt->read_chunk != rt->write_chunk);
+			BLI_mutex_unlock(&rt->mutex);
+
+			if (!rt->read_ready) {
+				break;
+			}
+		}
+
+		readsize = MIN2(size - totread, (unsigned int)(rt->chunks_size[chunk_index] - rt->read_offset));
+		memcpy(POINTER_OFFSET(buffer, totread), rt->chunks[chunk_index] + rt->read_offset, readsize);
+		totread += readsize;
+		rt->read_offset += readsize;
+
+		if (rt->read_offset == rt->chunks_size[chunk_index]) {
+			/* give the chunk back to the decompression */
+			BLI_mutex_lock(&rt->mutex);
+			rt->read_chunk++;
+			BLI_condition_notify_all(&rt->cond);
+			BLI_mutex_unlock(&rt->mutex);
+
+			rt->read_offset = 0;
+			rt->read_ready = false;
+		}
+	}
+
+	filedata->seek += totread;
+
+	return (int)totread;
+}
+
 static int fd_read_from_memory(FileData *filedata, void *buffer, unsigned int size)
 {
 	/* don't read more bytes then there are available in the buffer */
@@ -1118,9 +1284,70 @@ static FileData *blo_decode_and_check(FileData *fd, ReportList *reports)
 
 /* cannot be called with relative paths anymore! */
 /* on each new library added, it now checks for the current FileData and expands relativeness */
+/**
+ * Memory map uncompressed files, reading the blocks is then only a copy.
+ *
+ * \return NULL for compressed files or when mapping isn't possible.
+ */
+static FileData *blo_openblenderfile_mmap(const char *filepath)
+{
+#ifndef WIN32
+	FileData *fd = NULL;
+	unsigned char magic[2];
+	size_t size;
+	void *mem;
+	int file;
+
+	file = BLI_open(filepath, O_BINARY | O_RDONLY, 0);
+	if (file == -1) {
+		return NULL;
+	}
+
+	size = BLI_file_descriptor_size(file);
+
+	/* gzip magic number, decompressed by the reading thread */
+	if (size < SIZEOFBLENDERHEADER || size > INT_MAX ||
+	    read(file, magic, sizeof(magic)) != sizeof(magic) ||
+	    (magic[0] == 0x1f && magic[1] == 0x8b))
+	{
+		close(file);
+		return NULL;
+	}
+
+	mem = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+	/* the mapping stays valid after closing the file */
+	close(file);
+
+	if (mem == MAP_FAILED) {
+		return NULL;
+	}
+
+	fd = filedata_new();
+	fd->buffer = mem;
+	fd->buffersize = (int)size;
+	fd->read = fd_read_from_memory;
+	fd->flags |= FD_FLAGS_FILE_MMAP;
+
+	return fd;
+#else
+	UNUSED_VARS(filepath);
+	return NULL;
+#endif
+}
+
 FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
 {
+	FileData *fd;
 	gzFile gzfile;
+
+	fd = blo_openblenderfile_mmap(filepath);
+	if (fd) {
+		/* needed for library_append and read_libraries */
+		BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
+
+		return blo_decode_and_check(fd, reports);
+	}
+
 	errno = 0;
 	gzfile = BLI_gzopen(filepath, "rb");
 	
@@ -1130,9 +1357,10 @@ FileData *blo_openblenderfile(const char *filepath, ReportList *reports)
 		return NULL;
 	}
 	else {
-		FileData *fd = filedata_new();
+		fd = filedata_new();
 		fd->gzfiledes = gzfile;
-		fd->read = fd_read_gzip_from_file;
+		fd->readthread = file_read_thread_start(gzfile);
+		fd->read = fd->readthread ? fd_read_gzip_from_thread : fd_read_gzip_from_file;
 		
 		/* needed for library_append and read_libraries */
 		BLI_strncpy(fd->relabase, filepath, sizeof(fd->relabase));
@@ -1262,6 +1490,11 @@ void blo_freefiledata(FileData *fd)
 			close(fd->filedes);
 		}
 		
+		/* before closing the file it reads */
+		if (fd->readthread) {
+			file_read_thread_end(fd->readthread);
+		}
+		
 		if (fd->gzfiledes != NULL) {
 			gzclose(fd->gzfiledes);
 		}
@@ -1272,7 +1505,13 @@ void blo_freefiledata(FileData *fd)
 			}
 		}
 		
-		if (fd->buffer && !(fd->flags & FD_FLAGS_NOT_MY_BUFFER)) {
+		if (fd->flags & FD_FLAGS_FILE_MMAP) {
+#ifndef WIN32
+			munmap((void *)fd->buffer, fd->buffersize);
+#endif
+			fd->buffer = NULL;
+		}
+		else if (fd->buffer && !(fd->flags & FD_FLAGS_NOT_MY_BUFFER)) {
 			MEM_freeN((void *)fd->buffer);
 			fd->buffer = NULL;
 		}
@@ -1535,9 +1774,6 @@ static void change_idid_adr_fd(FileData *fd, const void *old, void *new)
 {
 	int i;
 	
-	/* use a binary search if we have a sorted libmap, for now it's not needed. */
-	BLI_assert(fd->libmap->sorted == false);
-
 	for (i = 0; i < fd->libmap->nentries; i++) {
 		OldNew *entry = &fd->libmap->entries[i];
 		
@@ -1629,7 +1865,7 @@ void blo_end_image_pointer_map(FileData *fd, Main *oldmain)
 	for (; ima; ima = ima->id.next) {
 		ima->cache = newimaadr(fd, ima->cache);
 		if (ima->cache == NULL) {
-			ima->tpageflag &= ~IMA_GLBIND_IS_DATA;
+			ima->tpageflag &= ~(IMA_GLBIND_IS_DATA | IMA_GLBIND_IS_STREAMED);
 			for (i = 0; i < TEXTARGET_COUNT; i++) {
 				ima->bindcode[i] = 0;
 				ima->gputexture[i] = NULL;
@@ -3696,7 +3932,7 @@ static void direct_link_image(FileData *fd, Image *ima)
 
 	/* if not restored, we keep the binded opengl index */
 	if (!ima->cache) {
-		ima->tpageflag &= ~IMA_GLBIND_IS_DATA;
+		ima->tpageflag &= ~(IMA_GLBIND_IS_DATA | IMA_GLBIND_IS_STREAMED);
 		for (int i = 0; i < TEXTARGET_COUNT; i++) {
 			ima->bindcode[i] = 0;
 			ima->gputexture[i] = NULL;
@@ -8394,8 +8630,6 @@ static void do_versions_after_linking(FileData *fd, Library *lib, Main *main)
 
 static void lib_link_all(FileData *fd, Main *main)
 {
-	oldnewmap_sort(fd);
-	
 	/* No load UI for undo memfiles */
 	if (fd->memfile == NULL) {
 		lib_link_windowmanager(fd, main);
@@ -8515,6 +8749,8 @@ static BHead *read_userdef(BlendFileData *bfd, FileData *fd, BHead *bhead)
 
 BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 {
+	const double time_start = PIL_check_seconds_timer();
+	double time_read, time_versioning, time_expand, time_link;
 	BHead *bhead = blo_firstbhead(fd);
 	BlendFileData *bfd;
 	ListBase mainlist = {NULL, NULL};
@@ -8580,16 +8816,22 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 		}
 	}
 	
+	time_read = PIL_check_seconds_timer();
+	
 	/* do before read_libraries, but skip undo case */
 	if (fd->memfile == NULL) {
 		do_versions(fd, NULL, bfd->main);
 		do_versions_userdef(fd, bfd);
 	}
 	
+	time_versioning = PIL_check_seconds_timer();
+	
 	read_libraries(fd, &mainlist);
 	
 	blo_join_main(&mainlist);
 	
+	time_expand = PIL_check_seconds_timer();
+	
 	lib_link_all(fd, bfd->main);
 	//do_versions_after_linking(fd, NULL, bfd->main); // XXX: not here (or even in this function at all)! this causes crashes on many files - Aligorith (July 04, 2010)
 	lib_verify_nodetree(bfd->main, true);
@@ -8597,8 +8839,16 @@ BlendFileData *blo_read_file_internal(FileData *fd, const char *filepath)
 	
 	link_global(fd, bfd);	/* as last */
 	
+	time_link = PIL_check_seconds_timer();
+	
 	fd->mainlist = NULL;  /* Safety, this is local variable, shall not be used afterward. */
 
+	if (G.debug & G_DEBUG_IO) {
+		printf("Read blend \"%s\": read %.3fs, versioning %.3fs, expand %.3fs, link %.3fs\n",
+		       filepath[0] ? filepath : "<memory>", time_read - time_start, time_versioning - time_read,
+		       time_expand - time_versioning, time_link - time_expand);
+	}
+
 	return bfd;
 }
 
@@ -10123,6 +10373,8 @@ Main *BLO_library_link_begin(Main *mainvar, BlendHandle **bh, const char *filepa
 /* scene and v3d may be NULL. */
 static void library_link_end(Main *mainl, FileData **fd, const short flag, Scene *scene, View3D *v3d)
 {
+	const double time_start = PIL_check_seconds_timer();
+	double time_expand;
 	Main *mainvar;
 	Library *curlib;
 
@@ -10135,6 +10387,8 @@ static void library_link_end(Main *mainl, FileData **fd, const short flag, Scene
 	/* do this when expand found other libs */
 	read_libraries(*fd, (*fd)->mainlist);
 
+	time_expand = PIL_check_seconds_timer();
+
 	curlib = mainl->curlib;
 
 	/* make the lib path relative if required */
@@ -10155,6 +10409,11 @@ static void library_link_end(Main *mainl, FileData **fd, const short flag, Scene
 	lib_verify_nodetree(mainvar, false);
 	fix_relpaths_library(G.main->name, mainvar); /* make all relative paths, relative to the open blend file */
 
+	if (G.debug & G_DEBUG_IO) {
+		printf("Link blend \"%s\": expand %.3fs, link %.3fs\n",
+		       (*fd)->relabase, time_expand - time_start, PIL_check_seconds_timer() - time_expand);
+	}
+
 	/* Give a base to loose objects. If group append, do it for objects too.
 	 * Only directly linked objects & groups are instantiated by `BLO_library_link_named_part_ex()` & co,
 	 * here we handle indirect ones and other possible edge-cases. */
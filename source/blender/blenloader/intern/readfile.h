@@ -37,6 +37,7 @@
 #include "DNA_windowmanager_types.h"  /* for ReportType */
 
 struct OldNewMap;
+struct FileReadThread;
 struct MemFile;
 struct ReportList;
 struct Object;
@@ -61,6 +62,8 @@ typedef struct FileData {
 	// variables needed for reading from file
 	int filedes;
 	gzFile gzfiledes;
+	/* decompresses gzfiledes in a background thread */
+	struct FileReadThread *readthread;
 
 	// now only in use for library appending
 	char relabase[FILE_MAX];
@@ -118,6 +121,7 @@ enum {
 	FD_FLAGS_FILE_OK               = 1 << 3,
 	FD_FLAGS_NOT_MY_BUFFER         = 1 << 4,
 	FD_FLAGS_NOT_MY_LIBMAP         = 1 << 5,  /* XXX Unused in practice (checked once but never set). */
+	FD_FLAGS_FILE_MMAP             = 1 << 6,  /* buffer is the memory mapped file */
 };
 
 #define SIZEOFBLENDERHEADER 12
@@ -35,6 +35,7 @@
 #include "BLI_listbase.h"
 #include "BLI_math.h"
 #include "BLI_stack.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BKE_cdderivedmesh.h"
@@ -321,91 +322,107 @@ void BM_mesh_free(BMesh *bm)
 /**
  * Helpers for #BM_mesh_normals_update and #BM_verts_calc_normal_vcos
  */
-static void bm_mesh_edges_calc_vectors(BMesh *bm, float (*edgevec)[3], const float (*vcos)[3])
+typedef struct BMEdgesCalcVectorsData {
+	float (*edgevec)[3];
+	const float (*vcos)[3];
+} BMEdgesCalcVectorsData;
+
+static void bm_edge_calc_vectors_cb(void *userdata, void *elem, const int UNUSED(thread_id))
 {
-	BMIter eiter;
-	BMEdge *e;
-	int index;
+	BMEdgesCalcVectorsData *data = userdata;
+	BMEdge *e = elem;
 
-	if (vcos) {
-		BM_mesh_elem_index_ensure(bm, BM_VERT);
+	if (e->l) {
+		const float *v1_co = data->vcos ? data->vcos[BM_elem_index_get(e->v1)] : e->v1->co;
+		const float *v2_co = data->vcos ? data->vcos[BM_elem_index_get(e->v2)] : e->v2->co;
+		float *e_vec = data->edgevec[BM_elem_index_get(e)];
+		sub_v3_v3v3(e_vec, v2_co, v1_co);
+		normalize_v3(e_vec);
 	}
+	else {
+		/* the edge vector will not be needed when the edge has no radial */
+	}
+}
+
+static void bm_mesh_edges_calc_vectors(BMesh *bm, float (*edgevec)[3], const float (*vcos)[3])
+{
+	BMEdgesCalcVectorsData data = {edgevec, vcos};
 
-	BM_ITER_MESH_INDEX (e, &eiter, bm, BM_EDGES_OF_MESH, index) {
-		BM_elem_index_set(e, index); /* set_inline */
+	/* indices are read by the callback, so they must be valid before the threads start */
+	BM_mesh_elem_index_ensure(bm, BM_EDGE | (vcos ? BM_VERT : 0));
 
-		if (e->l) {
-			const float *v1_co = vcos ? vcos[BM_elem_index_get(e->v1)] : e->v1->co;
-			const float *v2_co = vcos ? vcos[BM_elem_index_get(e->v2)] : e->v2->co;
-			sub_v3_v3v3(edgevec[index], v2_co, v1_co);
-			normalize_v3(edgevec[index]);
-		}
-		else {
-			/* the edge vector will not be needed when the edge has no radial */
+	BLI_task_parallel_mempool(bm->epool, &data, bm_edge_calc_vectors_cb, bm->totedge >= BM_OMP_LIMIT);
+}
+
+typedef struct BMVertsCalcNormalsData {
+	const float (*edgevec)[3];
+	const float (*fnos)[3];
+	const float (*vcos)[3];
+	float (*vnos)[3];
+} BMVertsCalcNormalsData;
+
+static void bm_vert_calc_normals_cb(void *userdata, void *elem, const int UNUSED(thread_id))
+{
+	BMVertsCalcNormalsData *data = userdata;
+	BMVert *v = elem;
+	float *v_no = data->vnos ? data->vnos[BM_elem_index_get(v)] : v->no;
+
+	zero_v3(v_no);
+
+	/* add weighted face normals of the face corners using the vertex,
+	 * gathered per vertex so vertices can be done in parallel */
+	if (v->e) {
+		BMIter liter;
+		BMLoop *l_iter;
+
+		BM_ITER_ELEM (l_iter, &liter, v, BM_LOOPS_OF_VERT) {
+			const float *f_no = data->fnos ? data->fnos[BM_elem_index_get(l_iter->f)] : l_iter->f->no;
+			const float *e1diff, *e2diff;
+			float dotprod;
+			float fac;
+
+			/* calculate the dot product of the two edges that
+			 * meet at the loop's vertex */
+			e1diff = data->edgevec[BM_elem_index_get(l_iter->prev->e)];
+			e2diff = data->edgevec[BM_elem_index_get(l_iter->e)];
+			dotprod = dot_v3v3(e1diff, e2diff);
+
+			/* edge vectors are calculated from e->v1 to e->v2, so
+			 * adjust the dot product if one but not both loops
+			 * actually runs from from e->v2 to e->v1 */
+			if ((l_iter->prev->e->v1 == l_iter->prev->v) ^ (l_iter->e->v1 == l_iter->v)) {
+				dotprod = -dotprod;
+			}
+
+			fac = saacos(-dotprod);
+
+			/* accumulate weighted face normal into the vertex's normal */
+			madd_v3_v3fl(v_no, f_no, fac);
 		}
 	}
-	bm->elem_index_dirty &= ~BM_EDGE;
+
+	/* normalize the accumulated vertex normal */
+	if (UNLIKELY(normalize_v3(v_no) == 0.0f)) {
+		const float *v_co = data->vcos ? data->vcos[BM_elem_index_get(v)] : v->co;
+		normalize_v3_v3(v_no, v_co);
+	}
 }
 
 static void bm_mesh_verts_calc_normals(
         BMesh *bm, const float (*edgevec)[3], const float (*fnos)[3],
         const float (*vcos)[3], float (*vnos)[3])
 {
-	BM_mesh_elem_index_ensure(bm, (vnos) ? (BM_EDGE | BM_VERT) : BM_EDGE);
+	BMVertsCalcNormalsData data = {edgevec, fnos, vcos, vnos};
 
-	/* add weighted face normals to vertices */
-	{
-		BMIter fiter;
-		BMFace *f;
-		int i;
-
-		BM_ITER_MESH_INDEX (f, &fiter, bm, BM_FACES_OF_MESH, i) {
-			BMLoop *l_first, *l_iter;
-			const float *f_no = fnos ? fnos[i] : f->no;
-
-			l_iter = l_first = BM_FACE_FIRST_LOOP(f);
-			do {
-				const float *e1diff, *e2diff;
-				float dotprod;
-				float fac;
-				float *v_no = vnos ? vnos[BM_elem_index_get(l_iter->v)] : l_iter->v->no;
-
-				/* calculate the dot product of the two edges that
-				 * meet at the loop's vertex */
-				e1diff = edgevec[BM_elem_index_get(l_iter->prev->e)];
-				e2diff = edgevec[BM_elem_index_get(l_iter->e)];
-				dotprod = dot_v3v3(e1diff, e2diff);
-
-				/* edge vectors are calculated from e->v1 to e->v2, so
-				 * adjust the dot product if one but not both loops
-				 * actually runs from from e->v2 to e->v1 */
-				if ((l_iter->prev->e->v1 == l_iter->prev->v) ^ (l_iter->e->v1 == l_iter->v)) {
-					dotprod = -dotprod;
-				}
-
-				fac = saacos(-dotprod);
-
-				/* accumulate weighted face normal into the vertex's normal */
-				madd_v3_v3fl(v_no, f_no, fac);
-			} while ((l_iter = l_iter->next) != l_first);
-		}
-	}
+	BM_mesh_elem_index_ensure(bm, BM_EDGE | ((vnos || vcos) ? BM_VERT : 0) | (fnos ? BM_FACE : 0));
 
+	/* add weighted face normals to vertices, and normalize */
+	BLI_task_parallel_mempool(bm->vpool, &data, bm_vert_calc_normals_cb, bm->totvert >= BM_OMP_LIMIT);
+}
 
-	/* normalize the accumulated vertex normals */
-	{
-		BMIter viter;
-		BMVert *v;
-		int i;
-
-		BM_ITER_MESH_INDEX (v, &viter, bm, BM_VERTS_OF_MESH, i) {
-			float *v_no = vnos ? vnos[i] : v->no;
-			if (UNLIKELY(normalize_v3(v_no) == 0.0f)) {
-				const float *v_co = vcos ? vcos[i] : v->co;
-				normalize_v3_v3(v_no, v_co);
-			}
-		}
-	}
+static void bm_face_normal_update_cb(void *UNUSED(userdata), void *elem, const int UNUSED(thread_id))
+{
+	BM_face_normal_update((BMFace *)elem);
 }
 
 /**
@@ -417,43 +434,16 @@ void BM_mesh_normals_update(BMesh *bm)
 {
 	float (*edgevec)[3] = MEM_mallocN(sizeof(*edgevec) * bm->totedge, __func__);
 
-#pragma omp parallel sections if (bm->totvert + bm->totedge + bm->totface >= BM_OMP_LIMIT)
-	{
-#pragma omp section
-		{
-			/* calculate all face normals */
-			BMIter fiter;
-			BMFace *f;
-			int i;
-
-			BM_ITER_MESH_INDEX (f, &fiter, bm, BM_FACES_OF_MESH, i) {
-				BM_elem_index_set(f, i); /* set_inline */
-				BM_face_normal_update(f);
-			}
-			bm->elem_index_dirty &= ~BM_FACE;
-		}
-#pragma omp section
-		{
-			/* Zero out vertex normals */
-			BMIter viter;
-			BMVert *v;
-			int i;
-
-			BM_ITER_MESH_INDEX (v, &viter, bm, BM_VERTS_OF_MESH, i) {
-				BM_elem_index_set(v, i); /* set_inline */
-				zero_v3(v->no);
-			}
-			bm->elem_index_dirty &= ~BM_VERT;
-		}
-#pragma omp section
-		{
-			/* Compute normalized direction vectors for each edge.
-			 * Directions will be used for calculating the weights of the face normals on the vertex normals.
-			 */
-			bm_mesh_edges_calc_vectors(bm, edgevec, NULL);
-		}
-	}
-	/* end omp */
+	/* calculate all face normals */
+	BLI_task_parallel_mempool(bm->fpool, NULL, bm_face_normal_update_cb, bm->totface >= BM_OMP_LIMIT);
+
+	/* callers rely on valid indices after the update */
+	BM_mesh_elem_index_ensure(bm, BM_VERT | BM_FACE);
+
+	/* Compute normalized direction vectors for each edge.
+	 * Directions will be used for calculating the weights of the face normals on the vertex normals.
+	 */
+	bm_mesh_edges_calc_vectors(bm, edgevec, NULL);
 
 	/* Add weighted face normals to vertices, and normalize vert normals. */
 	bm_mesh_verts_calc_normals(bm, (const float(*)[3])edgevec, NULL, NULL, NULL);
@@ -328,8 +328,9 @@ void COM_deinitialize(void);
 /**
  * @brief Clear all compositor caches. (Compositor system will still remain available). 
  * To deinitialize the compositor use the COM_deinitialize method.
+ * Called when the inputs of the compositor changed without their nodes being tagged, like after rendering.
  */
-// void COM_clearCaches(void); // NOT YET WRITTEN
+void COM_clearCaches(void);
 
 /**
  * @brief Return a list of highlighted bnodes pointers.
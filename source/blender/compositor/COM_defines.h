@@ -111,4 +111,17 @@ typedef enum OrderOfChunks {
 
 #define COM_BLUR_BOKEH_PIXELS 512
 
+/**
+ * @brief Maximum number of pixels calculated by a single row execution
+ * Operations keep their input rows on the stack, so this should stay small.
+ * @see SocketReader.readRow
+ */
+#define COM_ROW_MAX_PIXELS 128
+
+/**
+ * @brief Maximum memory used by buffered results kept between executions, in bytes
+ * @see OperationCache
+ */
+#define COM_CACHE_MEMORY_LIMIT ((size_t)1024 * 1024 * 1024)
+
 #endif  /* __COM_DEFINES_H__ */
@@ -152,6 +152,37 @@ void ExecutionGroup::deinitExecution()
 	this->m_cachedReadOperations.clear();
 	this->m_bTree = NULL;
 }
+
+void ExecutionGroup::setChunksExecuted()
+{
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		this->m_chunkExecutionStates[index] = COM_ES_EXECUTED;
+	}
+}
+
+bool ExecutionGroup::isCompletelyExecuted() const
+{
+	if (this->m_numberOfChunks == 0) {
+		return false;
+	}
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		if (this->m_chunkExecutionStates[index] != COM_ES_EXECUTED) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ExecutionGroup::isExecutionStarted() const
+{
+	for (unsigned int index = 0; index < this->m_numberOfChunks; index++) {
+		if (this->m_chunkExecutionStates[index] != COM_ES_NOT_SCHEDULED) {
+			return true;
+		}
+	}
+	return false;
+}
+
 void ExecutionGroup::determineResolution(unsigned int resolution[2])
 {
 	NodeOperation *operation = this->getOutputOperation();
@@ -339,6 +370,7 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
 		}
 
 		WorkScheduler::finish();
+		graph->getMemoryManager()->update();
 
 		if (bTree->test_break && bTree->test_break(bTree->tbh)) {
 			breaked = true;
@@ -539,6 +571,7 @@ bool ExecutionGroup::scheduleChunkWhenPossible(ExecutionSystem *graph, int xChun
 	}
 
 	if (canBeExecuted) {
+		graph->getMemoryManager()->acquire(this);
 		scheduleChunk(chunkNumber);
 	}
 
@@ -25,6 +25,7 @@
 
 #include "COM_Node.h"
 #include "COM_NodeOperation.h"
+#include <string>
 #include <vector>
 #include "BLI_rect.h"
 #include "COM_MemoryProxy.h"
@@ -178,6 +179,11 @@ private:
 	 */
 	double m_executionStartTime;
 
+	/**
+	 * @brief key of the output buffer in the OperationCache, empty when the result is not cached
+	 */
+	std::string m_cacheKey;
+
 	// methods
 	/**
 	 * @brief check whether parameter operation can be added to the execution group
@@ -413,8 +419,37 @@ public:
 
 	void setRenderBorder(float xmin, float xmax, float ymin, float ymax);
 
+	/**
+	 * @brief set the key of the output buffer in the OperationCache
+	 * @see NodeOperationBuilder.determine_cache_keys
+	 */
+	void setCacheKey(const std::string &key) { this->m_cacheKey = key; }
+
+	/**
+	 * @brief get the key of the output buffer in the OperationCache
+	 */
+	const std::string &getCacheKey() const { return this->m_cacheKey; }
+
+	/**
+	 * @brief mark all chunks as executed, used when the output buffer was read from the OperationCache
+	 * @note the ExecutionGroup must be initialized
+	 */
+	void setChunksExecuted();
+
+	/**
+	 * @brief check whether all chunks have been executed, so the output buffer is complete
+	 */
+	bool isCompletelyExecuted() const;
+
+	/**
+	 * @brief check whether any chunk has been scheduled
+	 */
+	bool isExecutionStarted() const;
+
 	/* allow the DebugInfo class to look at internals */
 	friend class DebugInfo;
+	/* allow tests to change chunk states without scheduling work */
+	friend class ExecutionGroupTestAccess;
 
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:ExecutionGroup")
@@ -22,9 +22,13 @@
 
 #include "COM_ExecutionSystem.h"
 
+#include <stdio.h>
+
 #include "PIL_time.h"
 #include "BLI_utildefines.h"
 extern "C" {
+#include "BKE_appdir.h"
+#include "BKE_global.h"
 #include "BKE_node.h"
 }
 
@@ -34,8 +38,10 @@ extern "C" {
 #include "COM_NodeOperationBuilder.h"
 #include "COM_NodeOperation.h"
 #include "COM_ExecutionGroup.h"
+#include "COM_OperationCache.h"
 #include "COM_WorkScheduler.h"
 #include "COM_ReadBufferOperation.h"
+#include "COM_WriteBufferOperation.h"
 #include "COM_Debug.h"
 
 #ifdef WITH_CXX_GUARDEDALLOC
@@ -174,6 +180,29 @@ void ExecutionSystem::execute()
 		executionGroup->initExecution();
 	}
 
+	this->m_memoryManager.setUseHalfFloat((editingtree->flag & NTREE_COM_HALF_BUFFERS) != 0);
+	this->m_memoryManager.setMemoryLimit((size_t)editingtree->buffer_memory_limit * 1024 * 1024);
+	this->m_memoryManager.setScratchDirectory(BKE_tempdir_session());
+	this->m_memoryManager.initExecution(this->m_groups);
+
+	/* groups with a cached result are not executed, neither are the groups only they depend on */
+	vector<bool> cached(this->m_groups.size(), false);
+	for (index = 0; index < this->m_groups.size(); index++) {
+		ExecutionGroup *executionGroup = this->m_groups[index];
+		if (!executionGroup->getCacheKey().empty()) {
+			MemoryProxy *proxy = ((WriteBufferOperation *)executionGroup->getOutputOperation())->getMemoryProxy();
+			this->m_memoryManager.acquire(proxy);
+			if (OperationCache::read(executionGroup->getCacheKey(), proxy->getBuffer())) {
+				executionGroup->setChunksExecuted();
+				cached[index] = true;
+			}
+			else {
+				/* the result is written to the cache after execution */
+				this->m_memoryManager.setKeepBuffer(proxy, true);
+			}
+		}
+	}
+
 	WorkScheduler::start(this->m_context);
 
 	executeGroups(COM_PRIORITY_HIGH);
@@ -185,6 +214,27 @@ void ExecutionSystem::execute()
 	WorkScheduler::finish();
 	WorkScheduler::stop();
 
+	/* keep complete results for the next execution, chunks are also marked executed when canceled */
+	if (!(editingtree->test_break && editingtree->test_break(editingtree->tbh))) {
+		for (index = 0; index < this->m_groups.size(); index++) {
+			ExecutionGroup *executionGroup = this->m_groups[index];
+			if (!executionGroup->getCacheKey().empty() && !cached[index] && executionGroup->isCompletelyExecuted()) {
+				MemoryProxy *proxy = ((WriteBufferOperation *)executionGroup->getOutputOperation())->getMemoryProxy();
+				this->m_memoryManager.acquire(proxy);
+				OperationCache::write(executionGroup->getCacheKey(), proxy->getBuffer());
+				this->m_memoryManager.setKeepBuffer(proxy, false);
+				this->m_memoryManager.update();
+			}
+		}
+	}
+
+	if ((G.debug & G_DEBUG) || (G.background && this->m_context.isRendering())) {
+		printf("Compositor: peak buffer memory %.2fM, %u buffers written to scratch files\n",
+		       (double)this->m_memoryManager.getPeakMemory() / (1024.0 * 1024.0),
+		       this->m_memoryManager.getNumberOfSpills());
+	}
+	this->m_memoryManager.deinitExecution();
+
 	editingtree->stats_draw(editingtree->sdh, IFACE_("Compositing | De-initializing execution"));
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
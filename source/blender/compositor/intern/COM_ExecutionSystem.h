@@ -30,6 +30,7 @@ class ExecutionGroup;
 #include "COM_Node.h"
 #include "BKE_text.h"
 #include "COM_ExecutionGroup.h"
+#include "COM_MemoryManager.h"
 #include "COM_NodeOperation.h"
 
 /**
@@ -131,6 +132,11 @@ private:
 	 */
 	Groups m_groups;
 
+	/**
+	 * @brief storage of the buffers during execution
+	 */
+	MemoryManager m_memoryManager;
+
 private: //methods
 	/**
 	 * find all execution group with output nodes
@@ -174,6 +180,11 @@ public:
 	 */
 	const CompositorContext &getContext() const { return this->m_context; }
 
+	/**
+	 * @brief get the storage of the buffers
+	 */
+	MemoryManager *getMemoryManager() { return &this->m_memoryManager; }
+
 private:
 	void executeGroups(CompositorPriority priority);
 
@@ -40,11 +40,16 @@ static unsigned int determine_num_channels(DataType datatype)
 	}
 }
 
-unsigned int MemoryBuffer::determineBufferSize()
+unsigned int MemoryBuffer::determineBufferSize() const
 {
 	return getWidth() * getHeight();
 }
 
+size_t MemoryBuffer::getBufferMemorySize() const
+{
+	return sizeof(float) * (size_t)determineBufferSize() * this->m_num_channels;
+}
+
 int MemoryBuffer::getWidth() const
 {
 	return this->m_width;
@@ -62,7 +67,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, r
 	this->m_memoryProxy = memoryProxy;
 	this->m_chunkNumber = chunkNumber;
 	this->m_num_channels = determine_num_channels(memoryProxy->getDataType());
-	this->m_buffer = (float *)MEM_mallocN_aligned(sizeof(float) * determineBufferSize() * this->m_num_channels, 16, "COM_MemoryBuffer");
+	this->m_buffer = NULL;
 	this->m_state = COM_MB_ALLOCATED;
 	this->m_datatype = memoryProxy->getDataType();
 }
@@ -143,6 +148,18 @@ float MemoryBuffer::getMaximumValue(rcti *rect)
 }
 
 MemoryBuffer::~MemoryBuffer()
+{
+	freeBuffer();
+}
+
+void MemoryBuffer::allocateBuffer()
+{
+	if (this->m_buffer == NULL) {
+		this->m_buffer = (float *)MEM_mallocN_aligned(getBufferMemorySize(), 16, "COM_MemoryBuffer");
+	}
+}
+
+void MemoryBuffer::freeBuffer()
 {
 	if (this->m_buffer) {
 		MEM_freeN(this->m_buffer);
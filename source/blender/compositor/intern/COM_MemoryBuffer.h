@@ -104,6 +104,8 @@ private:
 public:
 	/**
 	 * @brief construct new MemoryBuffer for a chunk
+	 * @note the data is not allocated yet, the MemoryManager allocates it when it is first needed
+	 * @see allocateBuffer
 	 */
 	MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, rcti *rect);
 	
@@ -135,6 +137,26 @@ public:
 	 */
 	float *getBuffer() { return this->m_buffer; }
 	
+	/**
+	 * @brief is the data of this MemoryBuffer allocated
+	 */
+	bool isAllocated() const { return this->m_buffer != NULL; }
+
+	/**
+	 * @brief allocate the data of this MemoryBuffer, the content is undefined
+	 */
+	void allocateBuffer();
+
+	/**
+	 * @brief free the data of this MemoryBuffer, the buffer itself stays valid
+	 */
+	void freeBuffer();
+
+	/**
+	 * @brief number of bytes used by the data of this MemoryBuffer when allocated
+	 */
+	size_t getBufferMemorySize() const;
+
 	/**
 	 * @brief after execution the state will be set to available by calling this method
 	 */
@@ -311,7 +333,7 @@ public:
 	float getMaximumValue();
 	float getMaximumValue(rcti *rect);
 private:
-	unsigned int determineBufferSize();
+	unsigned int determineBufferSize() const;
 
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryBuffer")
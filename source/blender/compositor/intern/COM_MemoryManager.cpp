@@ -0,0 +1,475 @@
+/*
+ * Copyright 2016, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Blender Foundation
+ */
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+#include "BLI_fileops.h"
+#include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_task.h"
+#include "BLI_utildefines.h"
+}
+
+#include "COM_ExecutionGroup.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_MemoryProxy.h"
+#include "COM_WriteBufferOperation.h"
+
+#include "COM_MemoryManager.h" /* own include */
+
+using std::min;
+using std::max;
+
+/* number of values converted by a single task */
+#define HALF_CONVERT_BLOCK_SIZE (1 << 16)
+
+typedef union FloatBits {
+	float f;
+	unsigned int u;
+} FloatBits;
+
+static unsigned short float_to_half(float value)
+{
+	FloatBits bits;
+	bits.f = value;
+	const unsigned short sign = (bits.u >> 16) & 0x8000;
+	const unsigned int abs = bits.u & 0x7fffffff;
+	unsigned int h, rem, halfway;
+
+	if (abs >= 0x7f800000) {
+		/* infinity, keep nan a quiet nan */
+		return sign | 0x7c00 | ((abs > 0x7f800000) ? 0x200 : 0);
+	}
+	if (abs >= 0x477ff000) {
+		/* rounds to a value larger than 65504 */
+		return sign | 0x7c00;
+	}
+	if (abs < 0x33000000) {
+		/* rounds to zero */
+		return sign;
+	}
+	if (abs < 0x38800000) {
+		/* denormal half, in units of 2^-24 */
+		const unsigned int shift = 126 - (abs >> 23);
+		const unsigned int mantissa = (abs & 0x7fffff) | 0x800000;
+		h = mantissa >> shift;
+		rem = mantissa & ((1u << shift) - 1);
+		halfway = 1u << (shift - 1);
+	}
+	else {
+		/* rebias the exponent, a rounding carry ends up in the exponent */
+		h = (abs - 0x38000000) >> 13;
+		rem = abs & 0x1fff;
+		halfway = 0x1000;
+	}
+	if (rem > halfway || (rem == halfway && (h & 1))) {
+		h++;
+	}
+	return sign | h;
+}
+
+static float half_to_float(unsigned short value)
+{
+	const unsigned int sign = (unsigned int)(value & 0x8000) << 16;
+	const unsigned int exponent = (value >> 10) & 0x1f;
+	const unsigned int mantissa = value & 0x3ff;
+	FloatBits bits;
+
+	if (exponent == 0) {
+		/* zero and denormals, exact in float */
+		bits.f = (float)mantissa * (1.0f / 16777216.0f);
+		bits.u |= sign;
+	}
+	else if (exponent == 31) {
+		bits.u = sign | 0x7f800000 | (mantissa << 13);
+	}
+	else {
+		bits.u = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	return bits.f;
+}
+
+typedef struct HalfConvertData {
+	float *floats;
+	unsigned short *halfs;
+	size_t size;
+} HalfConvertData;
+
+static void float_to_half_task(void *userdata, const int block)
+{
+	HalfConvertData *data = (HalfConvertData *)userdata;
+	const size_t start = (size_t)block * HALF_CONVERT_BLOCK_SIZE;
+	const size_t end = min(start + HALF_CONVERT_BLOCK_SIZE, data->size);
+	for (size_t i = start; i < end; i++) {
+		data->halfs[i] = float_to_half(data->floats[i]);
+	}
+}
+
+static void half_to_float_task(void *userdata, const int block)
+{
+	HalfConvertData *data = (HalfConvertData *)userdata;
+	const size_t start = (size_t)block * HALF_CONVERT_BLOCK_SIZE;
+	const size_t end = min(start + HALF_CONVERT_BLOCK_SIZE, data->size);
+	for (size_t i = start; i < end; i++) {
+		data->floats[i] = half_to_float(data->halfs[i]);
+	}
+}
+
+static int half_convert_num_blocks(size_t size)
+{
+	return (int)((size + HALF_CONVERT_BLOCK_SIZE - 1) / HALF_CONVERT_BLOCK_SIZE);
+}
+
+void MemoryManager::floatToHalf(unsigned short *dst, const float *src, size_t size)
+{
+	HalfConvertData data = {(float *)src, dst, size};
+	const int num_blocks = half_convert_num_blocks(size);
+	BLI_task_parallel_range(0, num_blocks, &data, float_to_half_task, num_blocks > 1);
+}
+
+void MemoryManager::halfToFloat(float *dst, const unsigned short *src, size_t size)
+{
+	HalfConvertData data = {dst, (unsigned short *)src, size};
+	const int num_blocks = half_convert_num_blocks(size);
+	BLI_task_parallel_range(0, num_blocks, &data, half_to_float_task, num_blocks > 1);
+}
+
+MemoryManager::MemoryManager()
+{
+	this->m_memoryLimit = 0;
+	this->m_useHalfFloat = false;
+	this->m_memoryInUse = 0;
+	this->m_peakMemory = 0;
+	this->m_useCounter = 0;
+	this->m_scratchCounter = 0;
+	this->m_numberOfSpills = 0;
+}
+
+MemoryManager::~MemoryManager()
+{
+	deinitExecution();
+}
+
+void MemoryManager::addEntry(MemoryProxy *proxy)
+{
+	if (this->m_entries.find(proxy) == this->m_entries.end()) {
+		MemoryManagerEntry entry;
+		entry.proxy = proxy;
+		entry.writer = NULL;
+		entry.state = COM_MM_UNALLOCATED;
+		entry.halfBuffer = NULL;
+		entry.spilledHalf = false;
+		entry.lastUsed = 0;
+		entry.keep = false;
+		this->m_entries[proxy] = entry;
+	}
+}
+
+void MemoryManager::initExecution(const std::vector<ExecutionGroup *> &groups)
+{
+	for (unsigned int index = 0; index < groups.size(); index++) {
+		ExecutionGroup *group = groups[index];
+		NodeOperation *operation = group->getOutputOperation();
+		if (operation->isWriteBufferOperation()) {
+			MemoryProxy *proxy = ((WriteBufferOperation *)operation)->getMemoryProxy();
+			addEntry(proxy);
+			this->m_entries[proxy].writer = group;
+		}
+
+		std::vector<MemoryProxy *> proxies;
+		group->determineDependingMemoryProxies(&proxies);
+		for (unsigned int i = 0; i < proxies.size(); i++) {
+			addEntry(proxies[i]);
+			this->m_entries[proxies[i]].readers.push_back(group);
+		}
+	}
+}
+
+void MemoryManager::deinitExecution()
+{
+	for (MemoryManagerEntries::iterator it = this->m_entries.begin(); it != this->m_entries.end(); ++it) {
+		MemoryManagerEntry &entry = it->second;
+		if (entry.halfBuffer) {
+			MEM_freeN(entry.halfBuffer);
+			entry.halfBuffer = NULL;
+		}
+		if (!entry.scratchFile.empty()) {
+			BLI_delete(entry.scratchFile.c_str(), false, false);
+			entry.scratchFile.clear();
+		}
+	}
+	this->m_entries.clear();
+	this->m_memoryInUse = 0;
+}
+
+size_t MemoryManager::getEntrySize(MemoryManagerEntry &entry, MemoryManagerState state)
+{
+	const size_t size = entry.proxy->getBuffer()->getBufferMemorySize();
+	switch (state) {
+		case COM_MM_RESIDENT:
+			return size;
+		case COM_MM_HALF:
+			return size / 2;
+		default:
+			return 0;
+	}
+}
+
+void MemoryManager::setEntryState(MemoryManagerEntry &entry, MemoryManagerState state)
+{
+	this->m_memoryInUse -= getEntrySize(entry, entry.state);
+	this->m_memoryInUse += getEntrySize(entry, state);
+	this->m_peakMemory = max(this->m_peakMemory, this->m_memoryInUse);
+	entry.state = state;
+}
+
+bool MemoryManager::isFinished(MemoryManagerEntry &entry)
+{
+	if (entry.keep || !entry.writer || !entry.writer->isCompletelyExecuted()) {
+		return false;
+	}
+	for (unsigned int index = 0; index < entry.readers.size(); index++) {
+		if (!entry.readers[index]->isCompletelyExecuted()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool MemoryManager::isIdle(MemoryManagerEntry &entry)
+{
+	if (!entry.writer || !entry.writer->isCompletelyExecuted()) {
+		return false;
+	}
+	/* readers that started keep using the data they got from the buffer until they are executed */
+	for (unsigned int index = 0; index < entry.readers.size(); index++) {
+		ExecutionGroup *reader = entry.readers[index];
+		if (reader->isExecutionStarted() && !reader->isCompletelyExecuted()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void MemoryManager::restore(MemoryManagerEntry &entry)
+{
+	MemoryBuffer *buffer = entry.proxy->getBuffer();
+	const size_t size = buffer->getBufferMemorySize() / sizeof(float);
+
+	buffer->allocateBuffer();
+	/* the stored data exists next to the buffer until it is converted */
+	const bool half = (entry.state == COM_MM_HALF || (entry.state == COM_MM_SPILLED && entry.spilledHalf));
+	this->m_peakMemory = max(this->m_peakMemory, this->m_memoryInUse + buffer->getBufferMemorySize() +
+	                         ((half) ? size * sizeof(unsigned short) : 0));
+
+	if (entry.state == COM_MM_SPILLED) {
+		void *data = (entry.spilledHalf) ? (void *)MEM_mallocN(sizeof(unsigned short) * size, __func__) :
+		                                   (void *)buffer->getBuffer();
+		const size_t element_size = (entry.spilledHalf) ? sizeof(unsigned short) : sizeof(float);
+		FILE *file = BLI_fopen(entry.scratchFile.c_str(), "rb");
+		if (!file || fread(data, element_size, size, file) != size) {
+			printf("Compositor: failed to read buffer from %s\n", entry.scratchFile.c_str());
+			memset(data, 0, element_size * size);
+		}
+		if (file) {
+			fclose(file);
+		}
+		BLI_delete(entry.scratchFile.c_str(), false, false);
+		entry.scratchFile.clear();
+
+		if (entry.spilledHalf) {
+			halfToFloat(buffer->getBuffer(), (unsigned short *)data, size);
+			MEM_freeN(data);
+		}
+	}
+	else if (entry.state == COM_MM_HALF) {
+		halfToFloat(buffer->getBuffer(), entry.halfBuffer, size);
+		MEM_freeN(entry.halfBuffer);
+		entry.halfBuffer = NULL;
+	}
+
+	setEntryState(entry, COM_MM_RESIDENT);
+}
+
+void MemoryManager::pack(MemoryManagerEntry &entry)
+{
+	MemoryBuffer *buffer = entry.proxy->getBuffer();
+	const size_t size = buffer->getBufferMemorySize() / sizeof(float);
+
+	entry.halfBuffer = (unsigned short *)MEM_mallocN(sizeof(unsigned short) * size, __func__);
+	floatToHalf(entry.halfBuffer, buffer->getBuffer(), size);
+	/* both exist for a moment */
+	this->m_peakMemory = max(this->m_peakMemory, this->m_memoryInUse + size * sizeof(unsigned short));
+	buffer->freeBuffer();
+
+	setEntryState(entry, COM_MM_HALF);
+}
+
+bool MemoryManager::spill(MemoryManagerEntry &entry)
+{
+	MemoryBuffer *buffer = entry.proxy->getBuffer();
+	const size_t size = buffer->getBufferMemorySize() / sizeof(float);
+	const bool half = (entry.state == COM_MM_HALF);
+	const void *data = (half) ? (const void *)entry.halfBuffer : (const void *)buffer->getBuffer();
+	const size_t element_size = (half) ? sizeof(unsigned short) : sizeof(float);
+
+	char name[64];
+	char filepath[FILE_MAX];
+	BLI_snprintf(name, sizeof(name), "compositor_%p_%u.buf", (void *)this, this->m_scratchCounter++);
+	BLI_join_dirfile(filepath, sizeof(filepath), this->m_scratchDirectory.c_str(), name);
+
+	FILE *file = BLI_fopen(filepath, "wb");
+	if (!file) {
+		return false;
+	}
+	const bool written = (fwrite(data, element_size, size, file) == size);
+	if (fclose(file) != 0 || !written) {
+		BLI_delete(filepath, false, false);
+		return false;
+	}
+
+	if (half) {
+		MEM_freeN(entry.halfBuffer);
+		entry.halfBuffer = NULL;
+	}
+	else {
+		buffer->freeBuffer();
+	}
+	entry.spilledHalf = half;
+	entry.scratchFile = filepath;
+	this->m_numberOfSpills++;
+
+	setEntryState(entry, COM_MM_SPILLED);
+	return true;
+}
+
+void MemoryManager::free(MemoryManagerEntry &entry)
+{
+	entry.proxy->getBuffer()->freeBuffer();
+	if (entry.halfBuffer) {
+		MEM_freeN(entry.halfBuffer);
+		entry.halfBuffer = NULL;
+	}
+	if (!entry.scratchFile.empty()) {
+		BLI_delete(entry.scratchFile.c_str(), false, false);
+		entry.scratchFile.clear();
+	}
+	setEntryState(entry, COM_MM_FREED);
+}
+
+void MemoryManager::freeMemory(size_t size, ExecutionGroup *group)
+{
+	if (this->m_memoryLimit == 0) {
+		return;
+	}
+
+	while (this->m_memoryInUse + size > this->m_memoryLimit) {
+		MemoryManagerEntry *oldest = NULL;
+		for (MemoryManagerEntries::iterator it = this->m_entries.begin(); it != this->m_entries.end(); ++it) {
+			MemoryManagerEntry &entry = it->second;
+			if (!ELEM(entry.state, COM_MM_RESIDENT, COM_MM_HALF) || !isIdle(entry)) {
+				continue;
+			}
+			/* the buffers of the group being scheduled are about to be used */
+			if (group && (entry.writer == group ||
+			              std::find(entry.readers.begin(), entry.readers.end(), group) != entry.readers.end()))
+			{
+				continue;
+			}
+			if (!oldest || entry.lastUsed < oldest->lastUsed) {
+				oldest = &entry;
+			}
+		}
+
+		if (!oldest || !spill(*oldest)) {
+			/* the buffers in use need more memory than the limit */
+			break;
+		}
+	}
+}
+
+void MemoryManager::acquire(MemoryProxy *proxy, ExecutionGroup *group)
+{
+	addEntry(proxy);
+	MemoryManagerEntry &entry = this->m_entries[proxy];
+	entry.lastUsed = ++this->m_useCounter;
+	if (entry.state != COM_MM_RESIDENT) {
+		freeMemory(proxy->getBuffer()->getBufferMemorySize(), group);
+		restore(entry);
+	}
+}
+
+void MemoryManager::acquire(MemoryProxy *proxy)
+{
+	addEntry(proxy);
+	acquire(proxy, this->m_entries[proxy].writer);
+}
+
+void MemoryManager::acquire(ExecutionGroup *group)
+{
+	NodeOperation *operation = group->getOutputOperation();
+	std::vector<MemoryProxy *> proxies;
+	group->determineDependingMemoryProxies(&proxies);
+
+	if (operation->isWriteBufferOperation()) {
+		proxies.push_back(((WriteBufferOperation *)operation)->getMemoryProxy());
+	}
+
+	for (unsigned int index = 0; index < proxies.size(); index++) {
+		acquire(proxies[index], group);
+	}
+}
+
+void MemoryManager::setKeepBuffer(MemoryProxy *proxy, bool keep)
+{
+	MemoryManagerEntries::iterator it = this->m_entries.find(proxy);
+	if (it != this->m_entries.end()) {
+		it->second.keep = keep;
+	}
+}
+
+void MemoryManager::update()
+{
+	MemoryManagerEntries::iterator it;
+
+	/* free first, so storing buffers in half precision doesn't add to the peak memory */
+	for (it = this->m_entries.begin(); it != this->m_entries.end(); ++it) {
+		MemoryManagerEntry &entry = it->second;
+		if (!ELEM(entry.state, COM_MM_UNALLOCATED, COM_MM_FREED) && isFinished(entry)) {
+			free(entry);
+		}
+	}
+
+	if (this->m_useHalfFloat) {
+		for (it = this->m_entries.begin(); it != this->m_entries.end(); ++it) {
+			MemoryManagerEntry &entry = it->second;
+			if (entry.state == COM_MM_RESIDENT && entry.proxy->getDataType() == COM_DT_COLOR && isIdle(entry)) {
+				pack(entry);
+			}
+		}
+	}
+
+	freeMemory(0, NULL);
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2016, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Blender Foundation
+ */
+
+#ifndef _COM_MemoryManager_h_
+#define _COM_MemoryManager_h_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "COM_defines.h"
+
+class ExecutionGroup;
+class MemoryProxy;
+
+/**
+ * @brief Storage of the buffers of MemoryProxies during an execution.
+ *
+ * Operations access their input buffers as a whole, so buffers are managed per MemoryProxy:
+ *  - the data of a buffer is only allocated when the first chunk of its ExecutionGroup,
+ *    or of a group reading it, is scheduled. Buffers of groups that are never scheduled
+ *    (outside the viewer border, second pass of two pass editing) are never allocated.
+ *  - when the writing group and all groups reading a buffer are executed, it is freed.
+ *  - buffers that are complete but are not read by a running group are idle. With half float
+ *    buffers enabled idle color buffers are stored in half precision, when the memory limit
+ *    is exceeded the least recently used idle buffers are written to a scratch file.
+ *    They are restored before a group reading them is scheduled.
+ *
+ * All methods are called from the thread scheduling the chunks, never by the devices.
+ * A buffer can only become idle when no scheduled chunk uses it, so the devices never
+ * see a buffer being stored.
+ * @ingroup Memory
+ */
+class MemoryManager {
+public:
+	MemoryManager();
+	~MemoryManager();
+
+	/**
+	 * @brief set the maximum memory used by buffers in bytes, 0 for no limit
+	 * @note the limit is exceeded when the buffers of the running groups need more memory
+	 */
+	void setMemoryLimit(size_t limit) { this->m_memoryLimit = limit; }
+
+	/**
+	 * @brief store idle color buffers in half float precision
+	 * Value and vector buffers contain depth, indices and motion vectors, they are always kept in full precision.
+	 */
+	void setUseHalfFloat(bool useHalfFloat) { this->m_useHalfFloat = useHalfFloat; }
+
+	/**
+	 * @brief set the directory of the scratch files buffers are written to
+	 */
+	void setScratchDirectory(const char *directory) { this->m_scratchDirectory = directory; }
+
+	/**
+	 * @brief register the buffers written and read by the groups
+	 * @note the write buffer operations must be initialized
+	 */
+	void initExecution(const std::vector<ExecutionGroup *> &groups);
+
+	/**
+	 * @brief free all stored buffers and remove the scratch files
+	 * The buffers in memory are freed by their MemoryProxy.
+	 */
+	void deinitExecution();
+
+	/**
+	 * @brief make sure the buffer is allocated and restored
+	 */
+	void acquire(MemoryProxy *proxy);
+
+	/**
+	 * @brief make sure the buffers written and read by a group are allocated and restored
+	 * Called before a chunk of the group is scheduled.
+	 */
+	void acquire(ExecutionGroup *group);
+
+	/**
+	 * @brief keep the buffer until the end of the execution, even when all its readers are executed
+	 */
+	void setKeepBuffer(MemoryProxy *proxy, bool keep);
+
+	/**
+	 * @brief free buffers that are not needed anymore and store idle buffers
+	 * Called when all scheduled chunks are executed.
+	 */
+	void update();
+
+	/**
+	 * @brief memory used by buffers in bytes
+	 */
+	size_t getMemoryInUse() const { return this->m_memoryInUse; }
+
+	/**
+	 * @brief highest memory used by buffers during the execution in bytes
+	 */
+	size_t getPeakMemory() const { return this->m_peakMemory; }
+
+	/**
+	 * @brief number of times a buffer was written to a scratch file
+	 */
+	unsigned int getNumberOfSpills() const { return this->m_numberOfSpills; }
+
+	/**
+	 * @brief convert floats to half floats, rounding to nearest even
+	 */
+	static void floatToHalf(unsigned short *dst, const float *src, size_t size);
+
+	/**
+	 * @brief convert half floats to floats
+	 */
+	static void halfToFloat(float *dst, const unsigned short *src, size_t size);
+
+private:
+	typedef enum MemoryManagerState {
+		/** @brief data is not allocated yet */
+		COM_MM_UNALLOCATED = 0,
+		/** @brief data is in memory, in the MemoryBuffer */
+		COM_MM_RESIDENT = 1,
+		/** @brief data is in memory in half precision */
+		COM_MM_HALF = 2,
+		/** @brief data is in a scratch file */
+		COM_MM_SPILLED = 3,
+		/** @brief data is not needed anymore */
+		COM_MM_FREED = 4
+	} MemoryManagerState;
+
+	typedef struct MemoryManagerEntry {
+		MemoryProxy *proxy;
+		/** @brief group writing the buffer, buffers without a known writer are kept */
+		ExecutionGroup *writer;
+		std::vector<ExecutionGroup *> readers;
+		MemoryManagerState state;
+		/** @brief data in half precision, also used for the COM_MM_SPILLED state when spilledHalf is set */
+		unsigned short *halfBuffer;
+		bool spilledHalf;
+		std::string scratchFile;
+		unsigned int lastUsed;
+		bool keep;
+	} MemoryManagerEntry;
+
+	typedef std::map<MemoryProxy *, MemoryManagerEntry> MemoryManagerEntries;
+
+	MemoryManagerEntries m_entries;
+	size_t m_memoryLimit;
+	bool m_useHalfFloat;
+	std::string m_scratchDirectory;
+	size_t m_memoryInUse;
+	size_t m_peakMemory;
+	unsigned int m_useCounter;
+	unsigned int m_scratchCounter;
+	unsigned int m_numberOfSpills;
+
+	void addEntry(MemoryProxy *proxy);
+	void acquire(MemoryProxy *proxy, ExecutionGroup *group);
+	size_t getEntrySize(MemoryManagerEntry &entry, MemoryManagerState state);
+	void setEntryState(MemoryManagerEntry &entry, MemoryManagerState state);
+	bool isFinished(MemoryManagerEntry &entry);
+	bool isIdle(MemoryManagerEntry &entry);
+	void restore(MemoryManagerEntry &entry);
+	void pack(MemoryManagerEntry &entry);
+	bool spill(MemoryManagerEntry &entry);
+	void free(MemoryManagerEntry &entry);
+	/** @brief spill least recently used idle buffers until size more bytes fit in the limit */
+	void freeMemory(size_t size, ExecutionGroup *group);
+
+#ifdef WITH_CXX_GUARDEDALLOC
+	MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryManager")
+#endif
+};
+
+#endif
@@ -19,6 +19,8 @@
  *		Lukas Toenne
  */
 
+#include <typeinfo>
+
 extern "C" {
 #include "BLI_utildefines.h"
 }
@@ -31,6 +33,7 @@ extern "C" {
 #include "COM_SocketProxyNode.h"
 
 #include "COM_NodeOperation.h"
+#include "COM_OperationCache.h"
 #include "COM_PreviewOperation.h"
 #include "COM_SetValueOperation.h"
 #include "COM_SetVectorOperation.h"
@@ -45,6 +48,7 @@ extern "C" {
 NodeOperationBuilder::NodeOperationBuilder(const CompositorContext *context, bNodeTree *b_nodetree) :
     m_context(context),
     m_current_node(NULL),
+    m_current_node_operations(0),
     m_active_viewer(NULL)
 {
 	m_graph.from_bNodeTree(*context, b_nodetree);
@@ -63,6 +67,7 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 		Node *node = (Node *)m_graph.nodes()[index];
 		
 		m_current_node = node;
+		m_current_node_operations = 0;
 		
 		DebugInfo::node_to_operations(node);
 		node->convertToOperations(converter, *m_context);
@@ -124,6 +129,8 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 	/* create execution groups */
 	group_operations();
 	
+	determine_cache_keys();
+	
 	/* transfer resulting operations to the system */
 	system->set_operations(m_operations, m_groups);
 }
@@ -131,6 +138,9 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 void NodeOperationBuilder::addOperation(NodeOperation *operation)
 {
 	m_operations.push_back(operation);
+	
+	if (m_current_node)
+		m_operation_nodes[operation] = std::make_pair(m_current_node, m_current_node_operations++);
 }
 
 void NodeOperationBuilder::mapInputSocket(NodeInput *node_socket, NodeOperationInput *operation_socket)
@@ -693,3 +703,84 @@ void NodeOperationBuilder::group_operations()
 		}
 	}
 }
+
+std::string NodeOperationBuilder::operation_cache_key(NodeKeyMap &node_keys, OperationKeyMap &operation_keys, NodeOperation *op)
+{
+	OperationKeyMap::const_iterator it_op = operation_keys.find(op);
+	if (it_op != operation_keys.end())
+		return it_op->second;
+	
+	std::string data;
+	
+	OperationNodeMap::const_iterator it_node = m_operation_nodes.find(op);
+	if (it_node != m_operation_nodes.end()) {
+		Node *node = it_node->second.first;
+		
+		NodeKeyMap::const_iterator it_key = node_keys.find(node);
+		if (it_key == node_keys.end())
+			it_key = node_keys.insert(std::make_pair(node, OperationCache::getNodeKey(*m_context, node))).first;
+		
+		/* an empty key can't be cached, neither can anything using its result */
+		if (it_key->second.empty())
+			return operation_keys[op] = "";
+		
+		data.append(it_key->second);
+		OperationCache::append(data, it_node->second.second);
+	}
+	
+	data.append(typeid(*op).name());
+	OperationCache::append(data, op->getWidth());
+	OperationCache::append(data, op->getHeight());
+	
+	if (op->isSetOperation()) {
+		float value[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+		op->readSampled(value, 0.0f, 0.0f, COM_PS_NEAREST);
+		data.append((const char *)value, sizeof(value));
+	}
+	
+	if (op->isReadBufferOperation()) {
+		MemoryProxy *memproxy = ((ReadBufferOperation *)op)->getMemoryProxy();
+		std::string input_key = operation_cache_key(node_keys, operation_keys, memproxy->getWriteBufferOperation());
+		if (input_key.empty())
+			return operation_keys[op] = "";
+		data.append(input_key);
+	}
+	
+	for (unsigned int index = 0; index < op->getNumberOfInputSockets(); index++) {
+		NodeOperationInput *input = op->getInputSocket(index);
+		if (input->isConnected()) {
+			std::string input_key = operation_cache_key(node_keys, operation_keys, &input->getLink()->getOperation());
+			if (input_key.empty())
+				return operation_keys[op] = "";
+			data.append(input_key);
+		}
+		else {
+			OperationCache::append(data, index);
+		}
+	}
+	
+	return operation_keys[op] = OperationCache::hash(data);
+}
+
+void NodeOperationBuilder::determine_cache_keys()
+{
+	if (!OperationCache::isEnabled(*m_context))
+		return;
+	
+	const std::string context_key = OperationCache::getContextKey(*m_context);
+	NodeKeyMap node_keys;
+	OperationKeyMap operation_keys;
+	
+	for (Groups::const_iterator it = m_groups.begin(); it != m_groups.end(); ++it) {
+		ExecutionGroup *group = *it;
+		NodeOperation *op = group->getOutputOperation();
+		
+		/* only results written to a buffer can be reused */
+		if (!op->isWriteBufferOperation())
+			continue;
+		
+		std::string key = operation_cache_key(node_keys, operation_keys, op);
+		if (!key.empty())
+			group->setCacheKey(OperationCache::hash(context_key + key));
+	}
+}
@@ -24,6 +24,7 @@
 
 #include <map>
 #include <set>
+#include <string>
 #include <vector>
 
 #include "COM_NodeGraph.h"
@@ -73,6 +74,11 @@ public:
 	typedef std::vector<NodeOperationInput *> OpInputs;
 	typedef std::map<NodeInput *, OpInputs> OpInputInverseMap;
 	
+	/** Node an operation was created for, with the index of the operation among those of the node */
+	typedef std::map<NodeOperation *, std::pair<Node *, int> > OperationNodeMap;
+	typedef std::map<Node *, std::string> NodeKeyMap;
+	typedef std::map<NodeOperation *, std::string> OperationKeyMap;
+	
 private:
 	const CompositorContext *m_context;
 	NodeGraph m_graph;
@@ -88,6 +94,10 @@ private:
 	
 	Node *m_current_node;
 	
+	/** Maps operations to the node they were created for */
+	OperationNodeMap m_operation_nodes;
+	int m_current_node_operations;
+	
 	/** Operation that will be writing to the viewer image
 	 *  Only one operation can occupy this place at a time,
 	 *  to avoid race conditions
@@ -159,6 +169,10 @@ protected:
 	void group_operations();
 	ExecutionGroup *make_group(NodeOperation *op);
 	
+	/** Calculate the keys of buffered group results in the operation cache */
+	void determine_cache_keys();
+	std::string operation_cache_key(NodeKeyMap &node_keys, OperationKeyMap &operation_keys, NodeOperation *op);
+	
 private:
 	PreviewOperation *make_preview_operation() const;
 
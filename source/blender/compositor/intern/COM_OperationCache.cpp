@@ -0,0 +1,361 @@
+/*
+ * Copyright 2016, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Blender Foundation
+ */
+
+#include <map>
+#include <vector>
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+#include "BLI_hash_md5.h"
+#include "BLI_threads.h"
+#include "BLI_utildefines.h"
+#include "DNA_ID.h"
+#include "DNA_node_types.h"
+#include "RNA_access.h"
+}
+
+#include "COM_CompositorContext.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_Node.h"
+
+#include "COM_OperationCache.h" /* own include */
+
+/* depth of nested structs and collections included in node keys,
+ * enough for curve mappings and image format settings */
+#define NODE_KEY_MAX_DEPTH 4
+
+typedef struct OperationCacheEntry {
+	MemoryBuffer *buffer;
+	size_t size;
+	unsigned int lastUsed;
+} OperationCacheEntry;
+
+typedef std::map<std::string, OperationCacheEntry> OperationCacheEntries;
+
+static ThreadMutex g_cacheMutex = BLI_MUTEX_INITIALIZER;
+static OperationCacheEntries g_entries;
+/** Incremented for nodes tagged for execution, see getNodeKey */
+static std::map<std::string, unsigned int> g_nodeRevisions;
+static size_t g_memoryInUse = 0;
+static size_t g_memoryLimit = COM_CACHE_MEMORY_LIMIT;
+static unsigned int g_useCounter = 0;
+
+static size_t buffer_size(MemoryBuffer *buffer)
+{
+	return sizeof(float) * buffer->getWidth() * buffer->getHeight() * buffer->get_num_channels();
+}
+
+static DataType buffer_datatype(MemoryBuffer *buffer)
+{
+	switch (buffer->get_num_channels()) {
+		case COM_NUM_CHANNELS_VALUE:
+			return COM_DT_VALUE;
+		case COM_NUM_CHANNELS_VECTOR:
+			return COM_DT_VECTOR;
+		default:
+			return COM_DT_COLOR;
+	}
+}
+
+static void remove_entry(OperationCacheEntries::iterator it)
+{
+	g_memoryInUse -= it->second.size;
+	delete it->second.buffer;
+	g_entries.erase(it);
+}
+
+/* free least recently used entries until size more bytes fit */
+static void free_memory(size_t size)
+{
+	while (!g_entries.empty() && g_memoryInUse + size > g_memoryLimit) {
+		OperationCacheEntries::iterator oldest = g_entries.begin();
+		for (OperationCacheEntries::iterator it = g_entries.begin(); it != g_entries.end(); ++it) {
+			if (it->second.lastUsed < oldest->second.lastUsed) {
+				oldest = it;
+			}
+		}
+		remove_entry(oldest);
+	}
+}
+
+static void append_string(std::string &data, const char *str)
+{
+	/* include terminator, so consecutive strings can't be confused */
+	data.append(str, strlen(str) + 1);
+}
+
+static void append_rna_struct(std::string &data, PointerRNA *ptr, int depth);
+
+static void append_rna_property(std::string &data, PointerRNA *ptr, PropertyRNA *prop, int depth)
+{
+	const int length = RNA_property_array_length(ptr, prop);
+
+	switch (RNA_property_type(prop)) {
+		case PROP_BOOLEAN:
+			if (length) {
+				std::vector<int> values(length);
+				RNA_property_boolean_get_array(ptr, prop, &values[0]);
+				data.append((const char *)&values[0], sizeof(int) * length);
+			}
+			else {
+				OperationCache::append(data, RNA_property_boolean_get(ptr, prop));
+			}
+			break;
+		case PROP_INT:
+			if (length) {
+				std::vector<int> values(length);
+				RNA_property_int_get_array(ptr, prop, &values[0]);
+				data.append((const char *)&values[0], sizeof(int) * length);
+			}
+			else {
+				OperationCache::append(data, RNA_property_int_get(ptr, prop));
+			}
+			break;
+		case PROP_FLOAT:
+			if (length) {
+				std::vector<float> values(length);
+				RNA_property_float_get_array(ptr, prop, &values[0]);
+				data.append((const char *)&values[0], sizeof(float) * length);
+			}
+			else {
+				OperationCache::append(data, RNA_property_float_get(ptr, prop));
+			}
+			break;
+		case PROP_ENUM:
+			OperationCache::append(data, RNA_property_enum_get(ptr, prop));
+			break;
+		case PROP_STRING:
+		{
+			char *str = RNA_property_string_get_alloc(ptr, prop, NULL, 0, NULL);
+			append_string(data, str);
+			MEM_freeN(str);
+			break;
+		}
+		case PROP_POINTER:
+		{
+			PointerRNA value = RNA_property_pointer_get(ptr, prop);
+			if (value.data == NULL) {
+				OperationCache::append(data, value.data);
+			}
+			else if (RNA_struct_is_ID(value.type)) {
+				/* data-blocks are shared with the original tree, their address identifies them */
+				OperationCache::append(data, value.data);
+			}
+			else if (depth < NODE_KEY_MAX_DEPTH) {
+				/* other structs are copied along with the tree, only their contents are compared */
+				append_rna_struct(data, &value, depth + 1);
+			}
+			break;
+		}
+		case PROP_COLLECTION:
+		{
+			int count = 0;
+			if (depth < NODE_KEY_MAX_DEPTH) {
+				RNA_PROP_BEGIN (ptr, item, prop)
+				{
+					append_rna_struct(data, &item, depth + 1);
+					count++;
+				}
+				RNA_PROP_END;
+			}
+			OperationCache::append(data, count);
+			break;
+		}
+	}
+}
+
+static void append_rna_struct(std::string &data, PointerRNA *ptr, int depth)
+{
+	RNA_STRUCT_BEGIN (ptr, prop)
+	{
+		/* skip the settings every node has, the location and looks of the node in the editor */
+		if (depth == 0 && RNA_struct_type_find_property(&RNA_Node, RNA_property_identifier(prop))) {
+			continue;
+		}
+		if (STREQ(RNA_property_identifier(prop), "rna_type")) {
+			continue;
+		}
+		append_rna_property(data, ptr, prop, depth);
+	}
+	RNA_STRUCT_END;
+}
+
+bool OperationCache::isEnabled(const CompositorContext &context)
+{
+	return !context.isRendering() && g_memoryLimit > 0;
+}
+
+std::string OperationCache::getContextKey(const CompositorContext &context)
+{
+	std::string data;
+	const RenderData *rd = context.getRenderData();
+	const ColorManagedViewSettings *viewSettings = context.getViewSettings();
+	const ColorManagedDisplaySettings *displaySettings = context.getDisplaySettings();
+
+	append(data, context.getScene());
+	append(data, context.getFramenumber());
+	append(data, context.getQuality());
+	append(data, context.isFastCalculation());
+	append(data, context.getHasActiveOpenCLDevices());
+	append_string(data, context.getViewName() ? context.getViewName() : "");
+	if (rd) {
+		append(data, rd->size);
+		append(data, rd->xsch);
+		append(data, rd->ysch);
+	}
+	if (viewSettings) {
+		append(data, viewSettings->flag);
+		append_string(data, viewSettings->look);
+		append_string(data, viewSettings->view_transform);
+		append(data, viewSettings->exposure);
+		append(data, viewSettings->gamma);
+	}
+	if (displaySettings) {
+		append_string(data, displaySettings->display_device);
+	}
+
+	return hash(data);
+}
+
+std::string OperationCache::getNodeKey(const CompositorContext &context, Node *node)
+{
+	bNode *bnode = node->getbNode();
+	bNodeTree *bnodetree = node->getbNodeTree();
+	std::string data;
+
+	/* images, movie clips, masks and textures are edited without tagging the node,
+	 * only results depending on the render result (cleared after rendering) are cached */
+	if (bnode->id && !ELEM(GS(bnode->id->name), ID_SCE, ID_NT)) {
+		return data;
+	}
+
+	/* nodes of the edited tree are tagged when their data changed since the last execution,
+	 * earlier results that used this node are not valid anymore */
+	std::string identity;
+	append(identity, context.getScene());
+	append(identity, node->getInstanceKey().value);
+	unsigned int revision;
+	BLI_mutex_lock(&g_cacheMutex);
+	if (bnode->need_exec && bnodetree == context.getbNodeTree()) {
+		g_nodeRevisions[identity]++;
+	}
+	revision = g_nodeRevisions[identity];
+	BLI_mutex_unlock(&g_cacheMutex);
+
+	data.append(identity);
+	append(data, revision);
+	append_string(data, bnode->idname);
+	append(data, bnode->id);
+
+	PointerRNA ptr;
+	RNA_pointer_create((ID *)bnodetree, &RNA_Node, bnode, &ptr);
+	append_rna_struct(data, &ptr, 0);
+
+	/* some nodes use the values of unconnected inputs directly */
+	for (bNodeSocket *sock = (bNodeSocket *)bnode->inputs.first; sock; sock = sock->next) {
+		PointerRNA sockptr;
+		RNA_pointer_create((ID *)bnodetree, &RNA_NodeSocket, sock, &sockptr);
+		PropertyRNA *prop = RNA_struct_find_property(&sockptr, "default_value");
+		if (prop) {
+			append_rna_property(data, &sockptr, prop, NODE_KEY_MAX_DEPTH);
+		}
+	}
+
+	return hash(data);
+}
+
+std::string OperationCache::hash(const std::string &data)
+{
+	unsigned char digest[16];
+	BLI_hash_md5_buffer(data.data(), data.size(), digest);
+	return std::string((const char *)digest, sizeof(digest));
+}
+
+bool OperationCache::read(const std::string &key, MemoryBuffer *buffer)
+{
+	bool found = false;
+
+	BLI_mutex_lock(&g_cacheMutex);
+	OperationCacheEntries::iterator it = g_entries.find(key);
+	if (it != g_entries.end()) {
+		MemoryBuffer *cached = it->second.buffer;
+		if (cached->getWidth() == buffer->getWidth() &&
+		    cached->getHeight() == buffer->getHeight() &&
+		    cached->get_num_channels() == buffer->get_num_channels())
+		{
+			buffer->copyContentFrom(cached);
+			it->second.lastUsed = ++g_useCounter;
+			found = true;
+		}
+	}
+	BLI_mutex_unlock(&g_cacheMutex);
+
+	return found;
+}
+
+void OperationCache::write(const std::string &key, MemoryBuffer *buffer)
+{
+	const size_t size = buffer_size(buffer);
+
+	BLI_mutex_lock(&g_cacheMutex);
+	OperationCacheEntries::iterator it = g_entries.find(key);
+	if (it != g_entries.end()) {
+		remove_entry(it);
+	}
+	if (size <= g_memoryLimit) {
+		free_memory(size);
+
+		OperationCacheEntry entry;
+		entry.buffer = new MemoryBuffer(buffer_datatype(buffer), buffer->getRect());
+		entry.buffer->copyContentFrom(buffer);
+		entry.size = size;
+		entry.lastUsed = ++g_useCounter;
+		g_entries[key] = entry;
+		g_memoryInUse += size;
+	}
+	BLI_mutex_unlock(&g_cacheMutex);
+}
+
+void OperationCache::clear()
+{
+	BLI_mutex_lock(&g_cacheMutex);
+	while (!g_entries.empty()) {
+		remove_entry(g_entries.begin());
+	}
+	g_nodeRevisions.clear();
+	BLI_mutex_unlock(&g_cacheMutex);
+}
+
+void OperationCache::setMemoryLimit(size_t limit)
+{
+	BLI_mutex_lock(&g_cacheMutex);
+	g_memoryLimit = limit;
+	free_memory(0);
+	BLI_mutex_unlock(&g_cacheMutex);
+}
+
+size_t OperationCache::getMemoryInUse()
+{
+	BLI_mutex_lock(&g_cacheMutex);
+	size_t memoryInUse = g_memoryInUse;
+	BLI_mutex_unlock(&g_cacheMutex);
+	return memoryInUse;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2016, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Blender Foundation
+ */
+
+#ifndef _COM_OperationCache_h_
+#define _COM_OperationCache_h_
+
+#include <string>
+
+#include "COM_defines.h"
+
+class CompositorContext;
+class MemoryBuffer;
+class Node;
+
+/**
+ * @brief Results of buffered operations, kept between executions of the compositor.
+ *
+ * The result of an ExecutionGroup writing to a buffer is stored under a key that hashes
+ * everything the result depends on: the operations of the group, the settings of the nodes
+ * they were created for and the keys of their inputs. When the tree is executed again,
+ * groups that are found in the cache are not calculated and neither are the groups they
+ * depend on, so only the branches that changed since the last execution are recalculated.
+ *
+ * Keys are plain strings of bytes, an empty key means the result can not be cached.
+ * The total size of the stored buffers is limited, the least recently used are freed first.
+ * @ingroup Memory
+ */
+class OperationCache {
+public:
+	/**
+	 * @brief is the cache used for this execution
+	 * Only interactive compositing is cached, renders always calculate everything.
+	 */
+	static bool isEnabled(const CompositorContext &context);
+
+	/**
+	 * @brief key of the settings of the execution that all results depend on
+	 */
+	static std::string getContextKey(const CompositorContext &context);
+
+	/**
+	 * @brief key of the settings of a node
+	 * Returns an empty key for nodes reading data that can change without the node being tagged.
+	 */
+	static std::string getNodeKey(const CompositorContext &context, Node *node);
+
+	/**
+	 * @brief hash arbitrary data to a fixed size key
+	 */
+	static std::string hash(const std::string &data);
+
+	/**
+	 * @brief append the bytes of a value to the data of a key
+	 */
+	template<typename T>
+	static void append(std::string &data, const T &value)
+	{
+		data.append((const char *)&value, sizeof(T));
+	}
+
+	/**
+	 * @brief copy the cached result to buffer
+	 * @return false when the key is not cached or the cached result has a different size
+	 */
+	static bool read(const std::string &key, MemoryBuffer *buffer);
+
+	/**
+	 * @brief store a copy of buffer under key, replacing an earlier result
+	 */
+	static void write(const std::string &key, MemoryBuffer *buffer);
+
+	/**
+	 * @brief free all cached results
+	 */
+	static void clear();
+
+	/**
+	 * @brief set the maximum memory used by cached results, in bytes
+	 * @see COM_CACHE_MEMORY_LIMIT
+	 */
+	static void setMemoryLimit(size_t limit);
+
+	/**
+	 * @brief memory used by cached results, in bytes
+	 */
+	static size_t getMemoryInUse();
+};
+
+#endif
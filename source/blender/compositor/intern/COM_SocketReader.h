@@ -95,6 +95,34 @@ protected:
 	                                  float /*x*/, float /*y*/,
 	                                  float /*dx*/[2], float /*dy*/[2]) {}
 
+	/**
+	 * @brief calculate a row of pixels
+	 * @note this method is called for non-complex
+	 * Operations that can work on whole rows override this to read their inputs a row at a time,
+	 * the default implementation calls executePixelSampled for every pixel.
+	 * @param output array of num * 4 floats to store the result, 4 floats per pixel whatever the datatype
+	 * @param x the x-coordinate of the first pixel to calculate in image space
+	 * @param y the y-coordinate of the row to calculate in image space
+	 * @param num the number of pixels to calculate, at most COM_ROW_MAX_PIXELS
+	 */
+	virtual void executeRow(float *output, int x, int y, int num) {
+		for (int i = 0; i < num; i++) {
+			executePixelSampled(&output[i * 4], x + i, y, COM_PS_NEAREST);
+		}
+	}
+
+	/**
+	 * @brief calculate a row of pixels
+	 * @note this method is called for complex, the default implementation calls executePixel for every pixel.
+	 * @see executeRow
+	 * @param chunkData chunk specific data a during execution time.
+	 */
+	virtual void executeTileRow(float *output, int x, int y, int num, void *chunkData) {
+		for (int i = 0; i < num; i++) {
+			executePixel(&output[i * 4], x + i, y, chunkData);
+		}
+	}
+
 public:
 	inline void readSampled(float result[4], float x, float y, PixelSampler sampler) {
 		executePixelSampled(result, x, y, sampler);
@@ -105,6 +133,12 @@ public:
 	inline void readFiltered(float result[4], float x, float y, float dx[2], float dy[2]) {
 		executePixelFiltered(result, x, y, dx, dy);
 	}
+	inline void readRow(float *result, int x, int y, int num) {
+		executeRow(result, x, y, num);
+	}
+	inline void readRow(float *result, int x, int y, int num, void *chunkData) {
+		executeTileRow(result, x, y, num, chunkData);
+	}
 
 	virtual void *initializeTileData(rcti * /*rect*/) { return 0; }
 	virtual void deinitializeTileData(rcti * /*rect*/, void * /*data*/) {}
@@ -32,6 +32,7 @@ extern "C" {
 
 #include "COM_compositor.h"
 #include "COM_ExecutionSystem.h"
+#include "COM_OperationCache.h"
 #include "COM_WorkScheduler.h"
 #include "clew.h"
 #include "COM_MovieDistortionOperation.h"
@@ -99,10 +100,16 @@ void COM_execute(RenderData *rd, Scene *scene, bNodeTree *editingtree, int rende
 	BLI_mutex_unlock(&s_compositorMutex);
 }
 
+void COM_clearCaches()
+{
+	OperationCache::clear();
+}
+
 void COM_deinitialize()
 {
 	if (is_compositorMutex_init) {
 		BLI_mutex_lock(&s_compositorMutex);
+		OperationCache::clear();
 		WorkScheduler::deinitialize();
 		is_compositorMutex_init = false;
 		BLI_mutex_unlock(&s_compositorMutex);
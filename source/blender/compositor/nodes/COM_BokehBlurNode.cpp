@@ -27,6 +27,8 @@
 #include "COM_ExecutionSystem.h"
 #include "COM_BokehBlurOperation.h"
 #include "COM_VariableSizeBokehBlurOperation.h"
+#include "COM_FastBokehBlurOperation.h"
+#include "COM_FastVariableSizeBokehBlurOperation.h"
 #include "COM_ConvertDepthToRadiusOperation.h"
 
 BokehBlurNode::BokehBlurNode(bNode *editorNode) : Node(editorNode)
@@ -42,8 +44,22 @@ void BokehBlurNode::convertToOperations(NodeConverter &converter, const Composit
 
 	bool connectedSizeSocket = inputSizeSocket->isLinked();
 	const bool extend_bounds = (b_node->custom1 & CMP_NODEFLAG_BLUR_EXTEND_BOUNDS) != 0;
+	const bool fast = (b_node->custom2 == CMP_NODE_BOKEHBLUR_FAST);
 
-	if ((b_node->custom1 & CMP_NODEFLAG_BLUR_VARIABLE_SIZE) && connectedSizeSocket) {
+	if ((b_node->custom1 & CMP_NODEFLAG_BLUR_VARIABLE_SIZE) && connectedSizeSocket && fast) {
+		FastVariableSizeBokehBlurOperation *operation = new FastVariableSizeBokehBlurOperation();
+		operation->setQuality(context.getQuality());
+		operation->setThreshold(0.0f);
+		operation->setMaxBlur(b_node->custom4);
+		operation->setDoScaleSize(true);
+
+		converter.addOperation(operation);
+		converter.mapInputSocket(getInputSocket(0), operation->getInputSocket(0));
+		converter.mapInputSocket(getInputSocket(1), operation->getInputSocket(1));
+		converter.mapInputSocket(getInputSocket(2), operation->getInputSocket(2));
+		converter.mapOutputSocket(getOutputSocket(0), operation->getOutputSocket());
+	}
+	else if ((b_node->custom1 & CMP_NODEFLAG_BLUR_VARIABLE_SIZE) && connectedSizeSocket) {
 		VariableSizeBokehBlurOperation *operation = new VariableSizeBokehBlurOperation();
 		operation->setQuality(context.getQuality());
 		operation->setThreshold(0.0f);
@@ -56,6 +72,22 @@ void BokehBlurNode::convertToOperations(NodeConverter &converter, const Composit
 		converter.mapInputSocket(getInputSocket(2), operation->getInputSocket(2));
 		converter.mapOutputSocket(getOutputSocket(0), operation->getOutputSocket());
 	}
+	else if (fast) {
+		FastBokehBlurOperation *operation = new FastBokehBlurOperation();
+		operation->setQuality(context.getQuality());
+		operation->setExtendBounds(extend_bounds);
+
+		converter.addOperation(operation);
+		converter.mapInputSocket(getInputSocket(0), operation->getInputSocket(0));
+		converter.mapInputSocket(getInputSocket(1), operation->getInputSocket(1));
+		converter.mapInputSocket(getInputSocket(2), operation->getInputSocket(3));
+		converter.mapInputSocket(getInputSocket(3), operation->getInputSocket(2));
+		converter.mapOutputSocket(getOutputSocket(0), operation->getOutputSocket());
+
+		if (!connectedSizeSocket) {
+			operation->setSize(this->getInputSocket(2)->getEditorValueFloat());
+		}
+	}
 	else {
 		BokehBlurOperation *operation = new BokehBlurOperation();
 		operation->setQuality(context.getQuality());
@@ -38,6 +38,11 @@ private:
 	bool m_greenChannelEnabled;
 	bool m_blueChannelEnabled;
 
+	/**
+	 * Correct num pixels, all arrays have 4 floats per pixel
+	 */
+	void correctRow(float *output, float *inputImageColor, float *inputMask, int num);
+
 public:
 	ColorCorrectionOperation();
 	
@@ -45,6 +50,7 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 	
 	/**
 	 * Initialize the execution
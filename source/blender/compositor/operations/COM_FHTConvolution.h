@@ -0,0 +1,41 @@
+/*
+ * Copyright 2016, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Blender Foundation
+ */
+
+#ifndef _COM_FHTConvolution_h
+#define _COM_FHTConvolution_h
+
+#include "COM_defines.h"
+
+/**
+ * @brief convolve an image with a kernel using the 2D Fast Hartley Transform
+ *
+ * Image, kernel and result are RGBA buffers. The first numChannels channels of the image are
+ * convolved with the same channel of the kernel, the other channels of the result are cleared.
+ * The kernel is centered on pixel (kernelWidth / 2, kernelHeight / 2), pixels outside of the
+ * image are zero.
+ *
+ * The image is convolved in blocks of about twice the kernel size, calculated by multiple
+ * threads, so the time needed hardly depends on the size of the kernel.
+ */
+void FHTConvolve(float *dst, const float *image, int imageWidth, int imageHeight,
+                 const float *kernel, int kernelWidth, int kernelHeight, int numChannels);
+
+#endif
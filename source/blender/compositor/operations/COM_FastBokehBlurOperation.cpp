@@ -0,0 +1,258 @@
+/*
+ * Copyright 2016, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Blender Foundation
+ */
+
+#include "COM_FastBokehBlurOperation.h"
+#include "COM_FHTConvolution.h"
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#  include "BLI_math.h"
+#  include "BLI_rect.h"
+}
+
+/* bokeh radius in pixels of the downscaled image, the image is not downscaled below it */
+#define COM_FAST_BOKEH_MIN_RADIUS 8
+
+FastBokehBlurOperation::FastBokehBlurOperation() : SingleThreadedOperation()
+{
+	this->addInputSocket(COM_DT_COLOR);
+	this->addInputSocket(COM_DT_COLOR, COM_SC_NO_RESIZE);
+	this->addInputSocket(COM_DT_VALUE);
+	this->addInputSocket(COM_DT_VALUE);
+	this->addOutputSocket(COM_DT_COLOR);
+
+	this->m_size = 1.0f;
+	this->m_sizeavailable = false;
+	this->m_inputProgram = NULL;
+	this->m_inputBokehProgram = NULL;
+	this->m_inputBoundingBoxReader = NULL;
+
+	this->m_extend_bounds = false;
+}
+
+void FastBokehBlurOperation::initExecution()
+{
+	SingleThreadedOperation::initExecution();
+	this->m_inputProgram = getInputSocketReader(0);
+	this->m_inputBokehProgram = getInputSocketReader(1);
+	this->m_inputBoundingBoxReader = getInputSocketReader(2);
+	QualityStepHelper::initExecution(COM_QH_MULTIPLY);
+}
+
+void FastBokehBlurOperation::deinitExecution()
+{
+	this->m_inputProgram = NULL;
+	this->m_inputBokehProgram = NULL;
+	this->m_inputBoundingBoxReader = NULL;
+	SingleThreadedOperation::deinitExecution();
+}
+
+/* average blocks of scale by scale pixels */
+static void downscale(float *dst, const float *src, int width, int height, int scale)
+{
+	const int scaledWidth = (width + scale - 1) / scale;
+	const int scaledHeight = (height + scale - 1) / scale;
+
+	for (int y = 0; y < scaledHeight; y++) {
+		for (int x = 0; x < scaledWidth; x++) {
+			const int maxx = min(width, (x + 1) * scale);
+			const int maxy = min(height, (y + 1) * scale);
+			float *color = &dst[(y * scaledWidth + x) * COM_NUM_CHANNELS_COLOR];
+			int count = 0;
+
+			zero_v4(color);
+			for (int sy = y * scale; sy < maxy; sy++) {
+				for (int sx = x * scale; sx < maxx; sx++) {
+					add_v4_v4(color, &src[(sy * width + sx) * COM_NUM_CHANNELS_COLOR]);
+					count++;
+				}
+			}
+			mul_v4_fl(color, 1.0f / count);
+		}
+	}
+}
+
+/* bilinear interpolation, extending the border pixels */
+static void sample_bilinear(float result[4], const float *buffer, int width, int height, float u, float v)
+{
+	u = min_ff(max_ff(u, 0.0f), width - 1);
+	v = min_ff(max_ff(v, 0.0f), height - 1);
+
+	const int x1 = (int)u, y1 = (int)v;
+	const int x2 = min(x1 + 1, width - 1), y2 = min(y1 + 1, height - 1);
+	const float fx = u - x1, fy = v - y1;
+	float row1[4], row2[4];
+
+	interp_v4_v4v4(row1, &buffer[(y1 * width + x1) * COM_NUM_CHANNELS_COLOR],
+	               &buffer[(y1 * width + x2) * COM_NUM_CHANNELS_COLOR], fx);
+	interp_v4_v4v4(row2, &buffer[(y2 * width + x1) * COM_NUM_CHANNELS_COLOR],
+	               &buffer[(y2 * width + x2) * COM_NUM_CHANNELS_COLOR], fx);
+	interp_v4_v4v4(result, row1, row2, fy);
+}
+
+MemoryBuffer *FastBokehBlurOperation::createMemoryBuffer(rcti *rect2)
+{
+	MemoryBuffer *tile = (MemoryBuffer *)this->m_inputProgram->initializeTileData(rect2);
+	float *image = tile->getBuffer();
+	const int width = getWidth();
+	const int height = getHeight();
+	rcti rect;
+	BLI_rcti_init(&rect, 0, width, 0, height);
+	MemoryBuffer *result = new MemoryBuffer(COM_DT_COLOR, &rect);
+
+	updateSize();
+	const float max_dim = max(width, height);
+	const int pixelSize = this->m_size * max_dim / 100.0f;
+
+	/* lower quality blurs a downscaled image, only blurs large enough to hide it are downscaled */
+	const int scale = max(1, min(getStep(), pixelSize / COM_FAST_BOKEH_MIN_RADIUS));
+	const int scaledWidth = (width + scale - 1) / scale;
+	const int scaledHeight = (height + scale - 1) / scale;
+	const int radius = pixelSize / scale;
+	float *scaled = image;
+	if (scale > 1) {
+		scaled = (float *)MEM_mallocN(sizeof(float) * scaledWidth * scaledHeight * COM_NUM_CHANNELS_COLOR, "fast bokeh scaled");
+		downscale(scaled, image, width, height, scale);
+	}
+
+	/* the kernel is the bokeh mirrored, the convolution sums the same pixels as
+	 * BokehBlurOperation, up to radius - 1 pixels after the center */
+	const int kernelSize = 2 * radius + 1;
+	const float bokehMidX = this->m_inputBokehProgram->getWidth() / 2.0f;
+	const float bokehMidY = this->m_inputBokehProgram->getHeight() / 2.0f;
+	const float bokehDimension = min(this->m_inputBokehProgram->getWidth(), this->m_inputBokehProgram->getHeight()) / 2.0f;
+	float *kernel = (float *)MEM_callocN(sizeof(float) * kernelSize * kernelSize * COM_NUM_CHANNELS_COLOR, "fast bokeh kernel");
+	if (radius > 0) {
+		const float m = bokehDimension / radius;
+		for (int y = 1; y < kernelSize; y++) {
+			for (int x = 1; x < kernelSize; x++) {
+				this->m_inputBokehProgram->readSampled(&kernel[(y * kernelSize + x) * COM_NUM_CHANNELS_COLOR],
+				                                       bokehMidX + (x - radius) * m, bokehMidY + (y - radius) * m,
+				                                       COM_PS_NEAREST);
+			}
+		}
+	}
+	if (pixelSize < 2) {
+		add_v4_fl(&kernel[(radius * kernelSize + radius) * COM_NUM_CHANNELS_COLOR], 1.0f);
+	}
+
+	float *blurred = (float *)MEM_mallocN(sizeof(float) * scaledWidth * scaledHeight * COM_NUM_CHANNELS_COLOR, "fast bokeh blurred");
+	FHTConvolve(blurred, scaled, scaledWidth, scaledHeight, kernel, kernelSize, kernelSize, COM_NUM_CHANNELS_COLOR);
+
+	/* divide by the sum of the kernel inside the image, using a summed area table of the kernel */
+	const int tableSize = kernelSize + 1;
+	float *table = (float *)MEM_callocN(sizeof(float) * tableSize * tableSize * COM_NUM_CHANNELS_COLOR, "fast bokeh table");
+	for (int y = 0; y < kernelSize; y++) {
+		for (int x = 0; x < kernelSize; x++) {
+			float *sum = &table[((y + 1) * tableSize + x + 1) * COM_NUM_CHANNELS_COLOR];
+			add_v4_v4v4(sum, &table[(y * tableSize + x + 1) * COM_NUM_CHANNELS_COLOR],
+			            &table[((y + 1) * tableSize + x) * COM_NUM_CHANNELS_COLOR]);
+			sub_v4_v4(sum, &table[(y * tableSize + x) * COM_NUM_CHANNELS_COLOR]);
+			add_v4_v4(sum, &kernel[(y * kernelSize + x) * COM_NUM_CHANNELS_COLOR]);
+		}
+	}
+	for (int y = 0; y < scaledHeight; y++) {
+		const int miny = max(0, y + radius - scaledHeight + 1);
+		const int maxy = min(kernelSize, y + radius + 1);
+		for (int x = 0; x < scaledWidth; x++) {
+			const int minx = max(0, x + radius - scaledWidth + 1);
+			const int maxx = min(kernelSize, x + radius + 1);
+			float *color = &blurred[(y * scaledWidth + x) * COM_NUM_CHANNELS_COLOR];
+			float weight[4];
+
+			add_v4_v4v4(weight, &table[(maxy * tableSize + maxx) * COM_NUM_CHANNELS_COLOR],
+			            &table[(miny * tableSize + minx) * COM_NUM_CHANNELS_COLOR]);
+			sub_v4_v4(weight, &table[(miny * tableSize + maxx) * COM_NUM_CHANNELS_COLOR]);
+			sub_v4_v4(weight, &table[(maxy * tableSize + minx) * COM_NUM_CHANNELS_COLOR]);
+			for (int ch = 0; ch < COM_NUM_CHANNELS_COLOR; ch++) {
+				color[ch] = (weight[ch] > 0.0f) ? color[ch] / weight[ch] : 0.0f;
+			}
+		}
+	}
+
+	/* pixels outside the bounding box are not blurred */
+	float *data = result->getBuffer();
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			float *color = &data[(y * width + x) * COM_NUM_CHANNELS_COLOR];
+			float boundingBox[4];
+
+			this->m_inputBoundingBoxReader->readSampled(boundingBox, x, y, COM_PS_NEAREST);
+			if (boundingBox[0] <= 0.0f) {
+				copy_v4_v4(color, &image[(y * width + x) * COM_NUM_CHANNELS_COLOR]);
+			}
+			else if (scale == 1) {
+				copy_v4_v4(color, &blurred[(y * width + x) * COM_NUM_CHANNELS_COLOR]);
+			}
+			else {
+				sample_bilinear(color, blurred, scaledWidth, scaledHeight,
+				                (x + 0.5f) / scale - 0.5f, (y + 0.5f) / scale - 0.5f);
+			}
+		}
+	}
+
+	MEM_freeN(table);
+	MEM_freeN(blurred);
+	MEM_freeN(kernel);
+	if (scaled != image) {
+		MEM_freeN(scaled);
+	}
+
+	return result;
+}
+
+bool FastBokehBlurOperation::determineDependingAreaOfInterest(rcti * /*input*/, ReadBufferOperation *readOperation, rcti *output)
+{
+	if (isCached()) {
+		return false;
+	}
+	else {
+		rcti newInput;
+		newInput.xmax = this->getWidth();
+		newInput.xmin = 0;
+		newInput.ymax = this->getHeight();
+		newInput.ymin = 0;
+		return NodeOperation::determineDependingAreaOfInterest(&newInput, readOperation, output);
+	}
+}
+
+void FastBokehBlurOperation::updateSize()
+{
+	if (!this->m_sizeavailable) {
+		float result[4];
+		this->getInputSocketReader(3)->readSampled(result, 0, 0, COM_PS_NEAREST);
+		this->m_size = result[0];
+		CLAMP(this->m_size, 0.0f, 10.0f);
+		this->m_sizeavailable = true;
+	}
+}
+
+void FastBokehBlurOperation::determineResolution(unsigned int resolution[2],
+                                                 unsigned int preferredResolution[2])
+{
+	NodeOperation::determineResolution(resolution,
+	                                   preferredResolution);
+	if (this->m_extend_bounds) {
+		const float max_dim = max(resolution[0], resolution[1]);
+		resolution[0] += 2 * this->m_size * max_dim / 100.0f;
+		resolution[1] += 2 * this->m_size * max_dim / 100.0f;
+	}
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2016, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Blender Foundation
+ */
+
+#ifndef _COM_FastBokehBlurOperation_h
+#define _COM_FastBokehBlurOperation_h
+
+#include "COM_SingleThreadedOperation.h"
+#include "COM_QualityStepHelper.h"
+
+/**
+ * @brief bokeh blur of a constant size, convolving the image with the bokeh in the frequency domain.
+ *
+ * Gives the same result as BokehBlurOperation at high quality, but the time needed hardly depends
+ * on the blur size. At lower quality the image is downscaled before it is blurred.
+ */
+class FastBokehBlurOperation : public SingleThreadedOperation, public QualityStepHelper {
+private:
+	SocketReader *m_inputProgram;
+	SocketReader *m_inputBokehProgram;
+	SocketReader *m_inputBoundingBoxReader;
+	void updateSize();
+	float m_size;
+	bool m_sizeavailable;
+	bool m_extend_bounds;
+
+protected:
+	MemoryBuffer *createMemoryBuffer(rcti *rect);
+
+public:
+	FastBokehBlurOperation();
+
+	/**
+	 * Initialize the execution
+	 */
+	void initExecution();
+
+	/**
+	 * Deinitialize the execution
+	 */
+	void deinitExecution();
+
+	bool determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output);
+
+	void setSize(float size) { this->m_size = size; this->m_sizeavailable = true; }
+
+	void setExtendBounds(bool extend_bounds) { this->m_extend_bounds = extend_bounds; }
+
+	void determineResolution(unsigned int resolution[2],
+	                         unsigned int preferredResolution[2]);
+};
+#endif
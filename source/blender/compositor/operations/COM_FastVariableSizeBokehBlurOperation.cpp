@@ -0,0 +1,272 @@
+/*
+ * Copyright 2016, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Blender Foundation
+ */
+
+#include <vector>
+
+#include "COM_FastVariableSizeBokehBlurOperation.h"
+#include "MEM_guardedalloc.h"
+
+extern "C" {
+#  include "BLI_math.h"
+}
+
+/* largest blur radius in pixels of a pyramid level at high quality,
+ * pixels with a smaller size are blurred without downscaling */
+#define COM_FAST_BOKEH_PYRAMID_RADIUS 8
+
+typedef struct FastVariableSizeBokehBlurLevel {
+	int width;
+	int height;
+	float *color;
+	/* blur size in pixels of the input image */
+	float *size;
+} FastVariableSizeBokehBlurLevel;
+
+struct FastVariableSizeBokehBlurPyramid {
+	/* every level is half the size of the previous, the first level is the input image */
+	std::vector<FastVariableSizeBokehBlurLevel> levels;
+	MemoryBuffer *bokeh;
+	/* sizes up to this radius are blurred at the first level */
+	float radius;
+};
+
+FastVariableSizeBokehBlurOperation::FastVariableSizeBokehBlurOperation() : NodeOperation()
+{
+	this->addInputSocket(COM_DT_COLOR);
+	this->addInputSocket(COM_DT_COLOR, COM_SC_NO_RESIZE); // do not resize the bokeh image.
+	this->addInputSocket(COM_DT_VALUE); // radius
+	this->addOutputSocket(COM_DT_COLOR);
+	this->setComplex(true);
+
+	this->m_inputProgram = NULL;
+	this->m_inputBokehProgram = NULL;
+	this->m_inputSizeProgram = NULL;
+	this->m_pyramid = NULL;
+	this->m_maxBlur = 32.0f;
+	this->m_threshold = 1.0f;
+	this->m_do_size_scale = false;
+}
+
+void FastVariableSizeBokehBlurOperation::initExecution()
+{
+	initMutex();
+	this->m_inputProgram = getInputSocketReader(0);
+	this->m_inputBokehProgram = getInputSocketReader(1);
+	this->m_inputSizeProgram = getInputSocketReader(2);
+	QualityStepHelper::initExecution(COM_QH_MULTIPLY);
+}
+
+void FastVariableSizeBokehBlurOperation::deinitExecution()
+{
+	if (this->m_pyramid) {
+		std::vector<FastVariableSizeBokehBlurLevel> &levels = this->m_pyramid->levels;
+		for (unsigned int i = 0; i < levels.size(); i++) {
+			/* the color of the first level is the input buffer */
+			if (i > 0) {
+				MEM_freeN(levels[i].color);
+			}
+			MEM_freeN(levels[i].size);
+		}
+		delete this->m_pyramid;
+		this->m_pyramid = NULL;
+	}
+	this->m_inputProgram = NULL;
+	this->m_inputBokehProgram = NULL;
+	this->m_inputSizeProgram = NULL;
+	deinitMutex();
+}
+
+FastVariableSizeBokehBlurPyramid *FastVariableSizeBokehBlurOperation::createPyramid(rcti *rect)
+{
+	FastVariableSizeBokehBlurPyramid *pyramid = new FastVariableSizeBokehBlurPyramid();
+	MemoryBuffer *color = (MemoryBuffer *)this->m_inputProgram->initializeTileData(rect);
+	MemoryBuffer *size = (MemoryBuffer *)this->m_inputSizeProgram->initializeTileData(rect);
+	pyramid->bokeh = (MemoryBuffer *)this->m_inputBokehProgram->initializeTileData(rect);
+	pyramid->radius = COM_FAST_BOKEH_PYRAMID_RADIUS / getStep();
+
+	const float max_dim = max(m_width, m_height);
+	const float scalar = this->m_do_size_scale ? (max_dim / 100.0f) : 1.0f;
+	int maxBlurScalar = (int)(size->getMaximumValue() * scalar);
+	CLAMP(maxBlurScalar, 1.0f, this->m_maxBlur);
+
+	/* sizes are limited to the maximum blur, like the search area of VariableSizeBokehBlurOperation */
+	FastVariableSizeBokehBlurLevel level;
+	level.width = color->getWidth();
+	level.height = color->getHeight();
+	level.color = color->getBuffer();
+	level.size = (float *)MEM_mallocN(sizeof(float) * level.width * level.height, "fast bokeh size");
+	const float *sizeBuffer = size->getBuffer();
+	for (int i = 0; i < level.width * level.height; i++) {
+		level.size[i] = min_ff(sizeBuffer[i] * scalar, maxBlurScalar);
+	}
+	pyramid->levels.push_back(level);
+
+	/* levels until the maximum blur is below the radius */
+	unsigned int numLevels = 1;
+	while (maxBlurScalar / (float)(1 << (numLevels - 1)) > pyramid->radius) {
+		numLevels++;
+	}
+
+	while (pyramid->levels.size() < numLevels && (level.width > 1 || level.height > 1)) {
+		const FastVariableSizeBokehBlurLevel &parent = pyramid->levels.back();
+		level.width = (parent.width + 1) / 2;
+		level.height = (parent.height + 1) / 2;
+		level.color = (float *)MEM_mallocN(sizeof(float) * level.width * level.height * COM_NUM_CHANNELS_COLOR, "fast bokeh color");
+		level.size = (float *)MEM_mallocN(sizeof(float) * level.width * level.height, "fast bokeh size");
+
+		for (int y = 0; y < level.height; y++) {
+			for (int x = 0; x < level.width; x++) {
+				const int offset = y * level.width + x;
+				const int maxx = min(parent.width, 2 * x + 2);
+				const int maxy = min(parent.height, 2 * y + 2);
+				float *levelColor = &level.color[offset * COM_NUM_CHANNELS_COLOR];
+				float levelSize = 0.0f;
+				int count = 0;
+
+				zero_v4(levelColor);
+				for (int py = 2 * y; py < maxy; py++) {
+					for (int px = 2 * x; px < maxx; px++) {
+						add_v4_v4(levelColor, &parent.color[(py * parent.width + px) * COM_NUM_CHANNELS_COLOR]);
+						levelSize += parent.size[py * parent.width + px];
+						count++;
+					}
+				}
+				mul_v4_fl(levelColor, 1.0f / count);
+				level.size[offset] = levelSize / count;
+			}
+		}
+		pyramid->levels.push_back(level);
+	}
+
+	return pyramid;
+}
+
+void *FastVariableSizeBokehBlurOperation::initializeTileData(rcti *rect)
+{
+	if (this->m_pyramid) return this->m_pyramid;
+
+	lockMutex();
+	if (this->m_pyramid == NULL) {
+		this->m_pyramid = createPyramid(rect);
+	}
+	unlockMutex();
+	return this->m_pyramid;
+}
+
+/* sum the bokeh of the pixels of a level, as VariableSizeBokehBlurOperation does for the input
+ * image, every pixel of a level counts for all pixels of the input image it was created from */
+void FastVariableSizeBokehBlurOperation::gather(float output[4], FastVariableSizeBokehBlurPyramid *pyramid, int levelIndex,
+                                                int x, int y, float size_center)
+{
+	const FastVariableSizeBokehBlurLevel &level = pyramid->levels[levelIndex];
+	const FastVariableSizeBokehBlurLevel &image = pyramid->levels[0];
+	MemoryBuffer *inputBokehBuffer = pyramid->bokeh;
+	const int scale = 1 << levelIndex;
+	const float area = scale * scale;
+	const float centerx = (x + 0.5f) / scale - 0.5f;
+	const float centery = (y + 0.5f) / scale - 0.5f;
+	const float radius = size_center / scale;
+	const float threshold = this->m_threshold / scale;
+	float bokeh[4];
+	float multiplier_accum[4];
+	float color_accum[4];
+
+	const int minx = max((int)floorf(centerx - radius) + 1, 0);
+	const int miny = max((int)floorf(centery - radius) + 1, 0);
+	const int maxx = min((int)ceilf(centerx + radius), level.width);
+	const int maxy = min((int)ceilf(centery + radius), level.height);
+
+	copy_v4_v4(color_accum, &image.color[(y * image.width + x) * COM_NUM_CHANNELS_COLOR]);
+	copy_v4_fl(multiplier_accum, 1.0f);
+
+	for (int ny = miny; ny < maxy; ny++) {
+		const float dy = ny - centery;
+		for (int nx = minx; nx < maxx; nx++) {
+			if (levelIndex == 0 && nx == x && ny == y) {
+				continue;
+			}
+			const int offset = ny * level.width + nx;
+			const float size = min_ff(level.size[offset] / scale, radius);
+			const float dx = nx - centerx;
+			if (size > threshold && size > fabsf(dx) && size > fabsf(dy)) {
+				float uv[2] = {
+					(float)(COM_BLUR_BOKEH_PIXELS / 2) + (dx / size) * (float)((COM_BLUR_BOKEH_PIXELS / 2) - 1),
+					(float)(COM_BLUR_BOKEH_PIXELS / 2) + (dy / size) * (float)((COM_BLUR_BOKEH_PIXELS / 2) - 1)};
+				inputBokehBuffer->read(bokeh, uv[0], uv[1]);
+				mul_v4_fl(bokeh, area);
+				madd_v4_v4v4(color_accum, bokeh, &level.color[offset * COM_NUM_CHANNELS_COLOR]);
+				add_v4_v4(multiplier_accum, bokeh);
+			}
+		}
+	}
+
+	output[0] = color_accum[0] / multiplier_accum[0];
+	output[1] = color_accum[1] / multiplier_accum[1];
+	output[2] = color_accum[2] / multiplier_accum[2];
+	output[3] = color_accum[3] / multiplier_accum[3];
+}
+
+void FastVariableSizeBokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
+{
+	FastVariableSizeBokehBlurPyramid *pyramid = (FastVariableSizeBokehBlurPyramid *)data;
+	const FastVariableSizeBokehBlurLevel &image = pyramid->levels[0];
+	const float *readColor = &image.color[(y * image.width + x) * COM_NUM_CHANNELS_COLOR];
+	const float size_center = image.size[y * image.width + x];
+
+	if (size_center <= this->m_threshold) {
+		copy_v4_v4(output, readColor);
+		return;
+	}
+
+	/* the levels where the size is between the radius and twice the radius */
+	const float level = (size_center > pyramid->radius) ? log2f(size_center / pyramid->radius) : 0.0f;
+	const int levelIndex = min((int)level, (int)pyramid->levels.size() - 1);
+	const float levelFac = level - levelIndex;
+
+	gather(output, pyramid, levelIndex, x, y, size_center);
+	if (levelFac > 0.0f && levelIndex + 1 < (int)pyramid->levels.size()) {
+		float next[4];
+		gather(next, pyramid, levelIndex + 1, x, y, size_center);
+		interp_v4_v4v4(output, output, next, levelFac);
+	}
+
+	/* blend in out values over the threshold, otherwise we get sharp, ugly transitions */
+	if (size_center < this->m_threshold * 2.0f) {
+		/* factor from 0-1 */
+		float fac = (size_center - this->m_threshold) / this->m_threshold;
+		interp_v4_v4v4(output, readColor, output, fac);
+	}
+}
+
+bool FastVariableSizeBokehBlurOperation::determineDependingAreaOfInterest(rcti * /*input*/, ReadBufferOperation *readOperation, rcti *output)
+{
+	if (this->m_pyramid) {
+		return false;
+	}
+	else {
+		rcti newInput;
+		newInput.xmax = this->getWidth();
+		newInput.xmin = 0;
+		newInput.ymax = this->getHeight();
+		newInput.ymin = 0;
+		return NodeOperation::determineDependingAreaOfInterest(&newInput, readOperation, output);
+	}
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2016, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor:
+ *		Blender Foundation
+ */
+
+#ifndef _COM_FastVariableSizeBokehBlurOperation_h
+#define _COM_FastVariableSizeBokehBlurOperation_h
+
+#include "COM_NodeOperation.h"
+#include "COM_QualityStepHelper.h"
+
+struct FastVariableSizeBokehBlurPyramid;
+
+/**
+ * @brief bokeh blur of a size per pixel, summing the bokeh of downscaled images for large sizes.
+ *
+ * Pixels with a small blur size are blurred like VariableSizeBokehBlurOperation does.
+ * Pixels with a larger size are blurred using a pyramid of images that are downscaled by two
+ * for every level, so that the number of pixels summed never exceeds the number for a small
+ * size. Results of the two closest levels are mixed, to avoid visible transitions.
+ * The pyramid is created once for all tiles.
+ */
+class FastVariableSizeBokehBlurOperation : public NodeOperation, public QualityStepHelper {
+private:
+	int m_maxBlur;
+	float m_threshold;
+	bool m_do_size_scale;  /* scale size, matching 'BokehBlurNode' */
+	SocketReader *m_inputProgram;
+	SocketReader *m_inputBokehProgram;
+	SocketReader *m_inputSizeProgram;
+	FastVariableSizeBokehBlurPyramid *m_pyramid;
+
+	FastVariableSizeBokehBlurPyramid *createPyramid(rcti *rect);
+	void gather(float output[4], FastVariableSizeBokehBlurPyramid *pyramid, int level, int x, int y, float size_center);
+
+public:
+	FastVariableSizeBokehBlurOperation();
+
+	/**
+	 * the inner loop of this program
+	 */
+	void executePixel(float output[4], int x, int y, void *data);
+
+	/**
+	 * Initialize the execution
+	 */
+	void initExecution();
+
+	void *initializeTileData(rcti *rect);
+
+	/**
+	 * Deinitialize the execution
+	 */
+	void deinitExecution();
+
+	bool determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output);
+
+	void setMaxBlur(int maxRadius) { this->m_maxBlur = maxRadius; }
+
+	void setThreshold(float threshold) { this->m_threshold = threshold; }
+
+	void setDoScaleSize(bool scale_size) { this->m_do_size_scale = scale_size; }
+};
+#endif
@@ -123,6 +123,60 @@ void GaussianXBlurOperation::executePixel(float output[4], int x, int y, void *d
 	mul_v4_v4fl(output, color_accum, 1.0f / multiplier_accum);
 }
 
+#ifdef __SSE2__
+void GaussianXBlurOperation::executeTileRow(float *output, int x, int y, int num, void *data)
+{
+	MemoryBuffer *inputBuffer = (MemoryBuffer *)data;
+	float *buffer = inputBuffer->getBuffer();
+	int bufferwidth = inputBuffer->getWidth();
+	int bufferstartx = inputBuffer->getRect()->xmin;
+	int bufferstarty = inputBuffer->getRect()->ymin;
+
+	/* only pixels with the full filter inside the buffer share the same weights,
+	 * the pixels near the borders are calculated one by one */
+	rcti &rect = *inputBuffer->getRect();
+	int start = min_ii(max_ii(rect.xmin + m_filtersize - x, 0), num);
+	int end = max_ii(min_ii(rect.xmax - m_filtersize - x, num), start);
+	int ymin = max_ii(y, rect.ymin);
+
+	int step = getStep();
+	int offsetadd = getOffsetAdd();
+	float multiplier_accum = 0.0f;
+	for (int index = 0; index <= 2 * this->m_filtersize; index += step) {
+		multiplier_accum += this->m_gausstab[index];
+	}
+	const __m128 multiplier_inv = _mm_set1_ps(1.0f / multiplier_accum);
+
+	int i;
+	for (i = 0; i < start; i++) {
+		executePixel(&output[i * 4], x + i, y, data);
+	}
+	/* four pixels at a time, independent sums hide the latency of the additions */
+	for (; i + 4 <= end; i += 4) {
+		__m128 accum_0 = _mm_setzero_ps();
+		__m128 accum_1 = _mm_setzero_ps();
+		__m128 accum_2 = _mm_setzero_ps();
+		__m128 accum_3 = _mm_setzero_ps();
+		int bufferindex = ((x + i - this->m_filtersize - bufferstartx) * 4) + ((ymin - bufferstarty) * 4 * bufferwidth);
+		for (int index = 0; index <= 2 * this->m_filtersize; index += step) {
+			const __m128 multiplier = this->m_gausstab_sse[index];
+			accum_0 = _mm_add_ps(accum_0, _mm_mul_ps(_mm_load_ps(&buffer[bufferindex]), multiplier));
+			accum_1 = _mm_add_ps(accum_1, _mm_mul_ps(_mm_load_ps(&buffer[bufferindex + 4]), multiplier));
+			accum_2 = _mm_add_ps(accum_2, _mm_mul_ps(_mm_load_ps(&buffer[bufferindex + 8]), multiplier));
+			accum_3 = _mm_add_ps(accum_3, _mm_mul_ps(_mm_load_ps(&buffer[bufferindex + 12]), multiplier));
+			bufferindex += offsetadd;
+		}
+		_mm_storeu_ps(&output[i * 4], _mm_mul_ps(accum_0, multiplier_inv));
+		_mm_storeu_ps(&output[i * 4 + 4], _mm_mul_ps(accum_1, multiplier_inv));
+		_mm_storeu_ps(&output[i * 4 + 8], _mm_mul_ps(accum_2, multiplier_inv));
+		_mm_storeu_ps(&output[i * 4 + 12], _mm_mul_ps(accum_3, multiplier_inv));
+	}
+	for (; i < num; i++) {
+		executePixel(&output[i * 4], x + i, y, data);
+	}
+}
+#endif
+
 void GaussianXBlurOperation::executeOpenCL(OpenCLDevice *device,
                                            MemoryBuffer *outputMemoryBuffer, cl_mem clOutputBuffer,
                                            MemoryBuffer **inputMemoryBuffers, list<cl_mem> *clMemToCleanUp,
@@ -125,6 +125,60 @@ void GaussianYBlurOperation::executePixel(float output[4], int x, int y, void *d
 	mul_v4_v4fl(output, color_accum, 1.0f / multiplier_accum);
 }
 
+#ifdef __SSE2__
+void GaussianYBlurOperation::executeTileRow(float *output, int x, int y, int num, void *data)
+{
+	MemoryBuffer *inputBuffer = (MemoryBuffer *)data;
+	float *buffer = inputBuffer->getBuffer();
+	int bufferwidth = inputBuffer->getWidth();
+	int bufferstartx = inputBuffer->getRect()->xmin;
+	int bufferstarty = inputBuffer->getRect()->ymin;
+
+	/* all pixels of the row use the same filter taps, except pixels left and
+	 * right of the buffer which are calculated one by one */
+	rcti &rect = *inputBuffer->getRect();
+	int start = min_ii(max_ii(rect.xmin - x, 0), num);
+	int end = max_ii(min_ii(rect.xmax - x, num), start);
+	int ymin = max_ii(y - m_filtersize,     rect.ymin);
+	int ymax = min_ii(y + m_filtersize + 1, rect.ymax);
+
+	int step = getStep();
+	float multiplier_accum = 0.0f;
+	for (int ny = ymin; ny < ymax; ny += step) {
+		multiplier_accum += this->m_gausstab[(ny - y) + this->m_filtersize];
+	}
+	const __m128 multiplier_inv = _mm_set1_ps(1.0f / multiplier_accum);
+
+	int i;
+	for (i = 0; i < start; i++) {
+		executePixel(&output[i * 4], x + i, y, data);
+	}
+	/* four pixels at a time, these share the cache lines read for each filter tap */
+	for (; i + 4 <= end; i += 4) {
+		__m128 accum_0 = _mm_setzero_ps();
+		__m128 accum_1 = _mm_setzero_ps();
+		__m128 accum_2 = _mm_setzero_ps();
+		__m128 accum_3 = _mm_setzero_ps();
+		const int bufferIndexx = ((x + i - bufferstartx) * 4);
+		for (int ny = ymin; ny < ymax; ny += step) {
+			const __m128 multiplier = this->m_gausstab_sse[(ny - y) + this->m_filtersize];
+			const float *in = &buffer[bufferIndexx + ((ny - bufferstarty) * 4 * bufferwidth)];
+			accum_0 = _mm_add_ps(accum_0, _mm_mul_ps(_mm_load_ps(&in[0]), multiplier));
+			accum_1 = _mm_add_ps(accum_1, _mm_mul_ps(_mm_load_ps(&in[4]), multiplier));
+			accum_2 = _mm_add_ps(accum_2, _mm_mul_ps(_mm_load_ps(&in[8]), multiplier));
+			accum_3 = _mm_add_ps(accum_3, _mm_mul_ps(_mm_load_ps(&in[12]), multiplier));
+		}
+		_mm_storeu_ps(&output[i * 4], _mm_mul_ps(accum_0, multiplier_inv));
+		_mm_storeu_ps(&output[i * 4 + 4], _mm_mul_ps(accum_1, multiplier_inv));
+		_mm_storeu_ps(&output[i * 4 + 8], _mm_mul_ps(accum_2, multiplier_inv));
+		_mm_storeu_ps(&output[i * 4 + 12], _mm_mul_ps(accum_3, multiplier_inv));
+	}
+	for (; i < num; i++) {
+		executePixel(&output[i * 4], x + i, y, data);
+	}
+}
+#endif
+
 void GaussianYBlurOperation::executeOpenCL(OpenCLDevice *device,
                                            MemoryBuffer *outputMemoryBuffer, cl_mem clOutputBuffer,
                                            MemoryBuffer **inputMemoryBuffers, list<cl_mem> *clMemToCleanUp,
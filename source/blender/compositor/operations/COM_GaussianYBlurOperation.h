@@ -40,6 +40,9 @@ public:
 	 * the inner loop of this program
 	 */
 	void executePixel(float output[4], int x, int y, void *data);
+#ifdef __SSE2__
+	void executeTileRow(float *output, int x, int y, int num, void *data);
+#endif
 
 	void executeOpenCL(OpenCLDevice *device,
 	                   MemoryBuffer *outputMemoryBuffer, cl_mem clOutputBuffer,
@@ -42,6 +42,30 @@ void MathBaseOperation::initExecution()
 }
 
 
+void MathBaseOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+{
+	float inputValue1[4];
+	float inputValue2[4];
+
+	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
+	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
+
+	mathRow(output, inputValue1, inputValue2, 1);
+}
+
+void MathBaseOperation::executeRow(float *output, int x, int y, int num)
+{
+	float inputValue1[COM_ROW_MAX_PIXELS * 4];
+	float inputValue2[COM_ROW_MAX_PIXELS * 4];
+
+	BLI_assert(num <= COM_ROW_MAX_PIXELS);
+
+	this->m_inputValue1Operation->readRow(inputValue1, x, y, num);
+	this->m_inputValue2Operation->readRow(inputValue2, x, y, num);
+
+	mathRow(output, inputValue1, inputValue2, num);
+}
+
 void MathBaseOperation::deinitExecution()
 {
 	this->m_inputValue1Operation = NULL;
@@ -72,274 +96,200 @@ void MathBaseOperation::clampIfNeeded(float *color)
 	}
 }
 
-void MathAddOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathAddOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = inputValue1[0] + inputValue2[0];
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = inputValue1[0] + inputValue2[0];
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathSubtractOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathSubtractOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = inputValue1[0] - inputValue2[0];
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = inputValue1[0] - inputValue2[0];
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathMultiplyOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathMultiplyOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = inputValue1[0] * inputValue2[0];
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = inputValue1[0] * inputValue2[0];
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathDivideOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathDivideOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	if (inputValue2[0] == 0) /* We don't want to divide by zero. */
-		output[0] = 0.0;
-	else
-		output[0] = inputValue1[0] / inputValue2[0];
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		if (inputValue2[0] == 0) /* We don't want to divide by zero. */
+			output[0] = 0.0;
+		else
+			output[0] = inputValue1[0] / inputValue2[0];
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathSineOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathSineOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = sin(inputValue1[0]);
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = sin(inputValue1[0]);
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathCosineOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathCosineOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = cos(inputValue1[0]);
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = cos(inputValue1[0]);
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathTangentOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathTangentOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = tan(inputValue1[0]);
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = tan(inputValue1[0]);
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathArcSineOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathArcSineOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	if (inputValue1[0] <= 1 && inputValue1[0] >= -1)
-		output[0] = asin(inputValue1[0]);
-	else
-		output[0] = 0.0;
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		if (inputValue1[0] <= 1 && inputValue1[0] >= -1)
+			output[0] = asin(inputValue1[0]);
+		else
+			output[0] = 0.0;
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathArcCosineOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathArcCosineOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	if (inputValue1[0] <= 1 && inputValue1[0] >= -1)
-		output[0] = acos(inputValue1[0]);
-	else
-		output[0] = 0.0;
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		if (inputValue1[0] <= 1 && inputValue1[0] >= -1)
+			output[0] = acos(inputValue1[0]);
+		else
+			output[0] = 0.0;
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathArcTangentOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathArcTangentOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = atan(inputValue1[0]);
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = atan(inputValue1[0]);
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathPowerOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathPowerOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	if (inputValue1[0] >= 0) {
-		output[0] = pow(inputValue1[0], inputValue2[0]);
-	}
-	else {
-		float y_mod_1 = fmod(inputValue2[0], 1);
-		/* if input value is not nearly an integer, fall back to zero, nicer than straight rounding */
-		if (y_mod_1 > 0.999f || y_mod_1 < 0.001f) {
-			output[0] = pow(inputValue1[0], floorf(inputValue2[0] + 0.5f));
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		if (inputValue1[0] >= 0) {
+			output[0] = pow(inputValue1[0], inputValue2[0]);
 		}
 		else {
-			output[0] = 0.0;
+			float y_mod_1 = fmod(inputValue2[0], 1);
+			/* if input value is not nearly an integer, fall back to zero, nicer than straight rounding */
+			if (y_mod_1 > 0.999f || y_mod_1 < 0.001f) {
+				output[0] = pow(inputValue1[0], floorf(inputValue2[0] + 0.5f));
+			}
+			else {
+				output[0] = 0.0;
+			}
 		}
-	}
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathLogarithmOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathLogarithmOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	if (inputValue1[0] > 0  && inputValue2[0] > 0)
-		output[0] = log(inputValue1[0]) / log(inputValue2[0]);
-	else
-		output[0] = 0.0;
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		if (inputValue1[0] > 0  && inputValue2[0] > 0)
+			output[0] = log(inputValue1[0]) / log(inputValue2[0]);
+		else
+			output[0] = 0.0;
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathMinimumOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathMinimumOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = min(inputValue1[0], inputValue2[0]);
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = min(inputValue1[0], inputValue2[0]);
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathMaximumOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathMaximumOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = max(inputValue1[0], inputValue2[0]);
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = max(inputValue1[0], inputValue2[0]);
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathRoundOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathRoundOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = round(inputValue1[0]);
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = round(inputValue1[0]);
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathLessThanOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathLessThanOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = inputValue1[0] < inputValue2[0] ? 1.0f : 0.0f;
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = inputValue1[0] < inputValue2[0] ? 1.0f : 0.0f;
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathGreaterThanOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathGreaterThanOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	output[0] = inputValue1[0] > inputValue2[0] ? 1.0f : 0.0f;
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		output[0] = inputValue1[0] > inputValue2[0] ? 1.0f : 0.0f;
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathModuloOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathModuloOperation::mathRow(float *output, float *inputValue1, float *inputValue2, int num)
 {
-	float inputValue1[4];
-	float inputValue2[4];
-	
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-	this->m_inputValue2Operation->readSampled(inputValue2, x, y, sampler);
-	
-	if (inputValue2[0] == 0)
-		output[0] = 0.0;
-	else
-		output[0] = fmod(inputValue1[0], inputValue2[0]);
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4, inputValue2 += 4) {
+		if (inputValue2[0] == 0)
+			output[0] = 0.0;
+		else
+			output[0] = fmod(inputValue1[0], inputValue2[0]);
 
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
 
-void MathAbsoluteOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+void MathAbsoluteOperation::mathRow(float *output, float *inputValue1, float * /*inputValue2*/, int num)
 {
-	float inputValue1[4];
+	for (int i = 0; i < num; i++, output += 4, inputValue1 += 4) {
+		output[0] = fabs(inputValue1[0]);
 
-	this->m_inputValue1Operation->readSampled(inputValue1, x, y, sampler);
-
-	output[0] = fabs(inputValue1[0]);
-
-	clampIfNeeded(output);
+		clampIfNeeded(output);
+	}
 }
@@ -46,11 +46,18 @@ protected:
 	MathBaseOperation();
 
 	void clampIfNeeded(float color[4]);
+
+	/**
+	 * Calculate num pixels, all arrays have 4 floats per pixel.
+	 * Used by both the pixel and row execution.
+	 */
+	virtual void mathRow(float *output, float *inputValue1, float *inputValue2, int num) = 0;
 public:
 	/**
 	 * the inner loop of this program
 	 */
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler) = 0;
+	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void executeRow(float *output, int x, int y, int num);
 	
 	/**
 	 * Initialize the execution
@@ -73,100 +80,100 @@ public:
 class MathAddOperation : public MathBaseOperation {
 public:
 	MathAddOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathSubtractOperation : public MathBaseOperation {
 public:
 	MathSubtractOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathMultiplyOperation : public MathBaseOperation {
 public:
 	MathMultiplyOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathDivideOperation : public MathBaseOperation {
 public:
 	MathDivideOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathSineOperation : public MathBaseOperation {
 public:
 	MathSineOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathCosineOperation : public MathBaseOperation {
 public:
 	MathCosineOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathTangentOperation : public MathBaseOperation {
 public:
 	MathTangentOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 
 class MathArcSineOperation : public MathBaseOperation {
 public:
 	MathArcSineOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathArcCosineOperation : public MathBaseOperation {
 public:
 	MathArcCosineOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathArcTangentOperation : public MathBaseOperation {
 public:
 	MathArcTangentOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathPowerOperation : public MathBaseOperation {
 public:
 	MathPowerOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathLogarithmOperation : public MathBaseOperation {
 public:
 	MathLogarithmOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathMinimumOperation : public MathBaseOperation {
 public:
 	MathMinimumOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathMaximumOperation : public MathBaseOperation {
 public:
 	MathMaximumOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathRoundOperation : public MathBaseOperation {
 public:
 	MathRoundOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathLessThanOperation : public MathBaseOperation {
 public:
 	MathLessThanOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 class MathGreaterThanOperation : public MathBaseOperation {
 public:
 	MathGreaterThanOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 
 class MathModuloOperation : public MathBaseOperation {
 public:
 	MathModuloOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 
 class MathAbsoluteOperation : public MathBaseOperation {
 public:
 	MathAbsoluteOperation() : MathBaseOperation() {}
-	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	void mathRow(float *output, float *inputValue1, float *inputValue2, int num);
 };
 
 #endif
@@ -31,6 +31,7 @@ WriteBufferOperation::WriteBufferOperation(DataType datatype) : NodeOperation()
 	this->m_memoryProxy = new MemoryProxy(datatype);
 	this->m_memoryProxy->setWriteBufferOperation(this);
 	this->m_memoryProxy->setExecutor(NULL);
+	this->m_useRowExecution = true;
 }
 WriteBufferOperation::~WriteBufferOperation()
 {
@@ -62,7 +63,10 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/
 	MemoryBuffer *memoryBuffer = this->m_memoryProxy->getBuffer();
 	float *buffer = memoryBuffer->getBuffer();
 	const int num_channels = memoryBuffer->get_num_channels();
-	if (this->m_input->isComplex()) {
+	if (this->m_useRowExecution) {
+		executeRegionRows(rect, memoryBuffer);
+	}
+	else if (this->m_input->isComplex()) {
 		void *data = this->m_input->initializeTileData(rect);
 		int x1 = rect->xmin;
 		int y1 = rect->ymin;
@@ -110,6 +114,45 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int /*tileNumber*/
 	memoryBuffer->setCreatedState();
 }
 
+/* Calculate rows of at most COM_ROW_MAX_PIXELS, so operations process a span of pixels per call. */
+void WriteBufferOperation::executeRegionRows(rcti *rect, MemoryBuffer *memoryBuffer)
+{
+	float *buffer = memoryBuffer->getBuffer();
+	const int num_channels = memoryBuffer->get_num_channels();
+	const bool complex = this->m_input->isComplex();
+	void *data = (complex) ? this->m_input->initializeTileData(rect) : NULL;
+	float row[COM_ROW_MAX_PIXELS * 4];
+
+	for (int y = rect->ymin; y < rect->ymax; y++) {
+		for (int x = rect->xmin; x < rect->xmax; x += COM_ROW_MAX_PIXELS) {
+			const int num = min(rect->xmax - x, COM_ROW_MAX_PIXELS);
+			float *output = &buffer[(y * memoryBuffer->getWidth() + x) * num_channels];
+			/* color rows have the same layout as the buffer */
+			float *result = (num_channels == COM_NUM_CHANNELS_COLOR) ? output : row;
+
+			if (complex) {
+				this->m_input->readRow(result, x, y, num, data);
+			}
+			else {
+				this->m_input->readRow(result, x, y, num);
+			}
+
+			if (result == row) {
+				for (int i = 0; i < num; i++) {
+					memcpy(&output[i * num_channels], &row[i * 4], sizeof(float) * num_channels);
+				}
+			}
+		}
+		if (isBreaked()) {
+			break;
+		}
+	}
+
+	if (data) {
+		this->m_input->deinitializeTileData(rect, data);
+	}
+}
+
 void WriteBufferOperation::executeOpenCLRegion(OpenCLDevice *device, rcti * /*rect*/, unsigned int /*chunkNumber*/,
                                                MemoryBuffer **inputMemoryBuffers, MemoryBuffer *outputBuffer)
 {
@@ -34,6 +34,9 @@ class WriteBufferOperation : public NodeOperation {
 	MemoryProxy *m_memoryProxy;
 	bool m_single_value; /* single value stored in buffer */
 	NodeOperation *m_input;
+	bool m_useRowExecution;
+
+	void executeRegionRows(rcti *rect, MemoryBuffer *memoryBuffer);
 public:
 	WriteBufferOperation(DataType datatype);
 	~WriteBufferOperation();
@@ -43,6 +46,12 @@ public:
 	bool isSingleValue() const { return m_single_value; }
 	
 	void executeRegion(rcti *rect, unsigned int tileNumber);
+
+	/**
+	 * @brief calculate the input a row at a time instead of pixel by pixel
+	 * Enabled by default, the pixel by pixel path is kept for comparison.
+	 */
+	void setUseRowExecution(bool useRowExecution) { this->m_useRowExecution = useRowExecution; }
 	void initExecution();
 	void deinitExecution();
 	void executeOpenCLRegion(OpenCLDevice *device, rcti *rect, unsigned int chunkNumber, MemoryBuffer **memoryBuffers, MemoryBuffer *outputBuffer);
@@ -82,6 +82,44 @@ void DEG_stats_simple(const struct Depsgraph *graph,
                       size_t *r_operations,
                       size_t *r_relations);
 
+/* ------------------------------------------------ */
+/* Evaluation Timing */
+
+/* Timing of an operation, measured on every evaluation of the graph. */
+typedef struct DepsgraphStatsOperation {
+	struct ID *id;
+	char name[128];
+
+	float duration_last;
+	float duration_average;
+	/* Estimated duration of the longest chain of updates starting at the
+	 * operation in the last threaded evaluation.
+	 */
+	float critical_path;
+	int num_evaluations;
+} DepsgraphStatsOperation;
+
+/* Timing of the last evaluation of the graph. */
+typedef struct DepsgraphStatsEval {
+	float duration;
+	/* Sum of the durations of the evaluated operations. */
+	float duration_operations;
+	/* Estimated from previous evaluations, zero when evaluated with a single thread. */
+	float critical_path;
+	int num_operations;
+} DepsgraphStatsEval;
+
+void DEG_stats_eval(const struct Depsgraph *graph, DepsgraphStatsEval *r_stats);
+
+/* Allocate an array with the timing of all evaluated operations, slowest
+ * first, and return its length. The array is to be freed with MEM_freeN().
+ */
+int DEG_stats_operations(const struct Depsgraph *graph,
+                         DepsgraphStatsOperation **r_operations);
+
+/* Forget timing of previous evaluations. */
+void DEG_stats_operations_reset(struct Depsgraph *graph);
+
 /* ************************************************ */
 /* Diagram-Based Graph Debugging */
 
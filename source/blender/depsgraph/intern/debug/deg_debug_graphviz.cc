@@ -138,7 +138,9 @@ static int deg_debug_node_color_index(const DepsNode *node)
 struct DebugContext {
 	FILE *file;
 	bool show_tags;
-	bool show_eval_priority;
+	/* Overlay of the evaluation time and critical path of operations. */
+	bool show_costs;
+	float max_cost;
 };
 
 static void deg_debug_fprintf(const DebugContext &ctx, const char *fmt, ...) ATTR_PRINTF_FORMAT(2, 3);
@@ -160,6 +162,18 @@ static void deg_debug_graphviz_legend_color(const DebugContext &ctx,
 	deg_debug_fprintf(ctx, "</TR>" NL);
 }
 
+/* Heat map color of an operation, for the cost relative to the slowest one. */
+static void deg_debug_graphviz_cost_color(float factor, char r_color[8])
+{
+	const int fast[3] = {255, 255, 204};
+	const int slow[3] = {227, 26, 28};
+	unsigned int rgb[3];
+	for (int i = 0; i < 3; i++) {
+		rgb[i] = (unsigned int)(fast[i] + (int)((slow[i] - fast[i]) * factor));
+	}
+	BLI_snprintf(r_color, 8, "#%02x%02x%02x", rgb[0], rgb[1], rgb[2]);
+}
+
 static void deg_debug_graphviz_legend(const DebugContext &ctx)
 {
 	deg_debug_fprintf(ctx, "{" NL);
@@ -176,6 +190,14 @@ static void deg_debug_graphviz_legend(const DebugContext &ctx)
 	deg_debug_graphviz_legend_color(ctx, "NOOP", colors[8]);
 #endif
 
+	if (ctx.show_costs) {
+		char color[8];
+		deg_debug_graphviz_cost_color(0.0f, color);
+		deg_debug_graphviz_legend_color(ctx, "Fastest Operation", color);
+		deg_debug_graphviz_cost_color(1.0f, color);
+		deg_debug_graphviz_legend_color(ctx, "Slowest Operation", color);
+	}
+
 #ifdef COLOR_SCHEME_NODE_TYPE
 	const int (*pair)[2];
 	for (pair = deg_debug_node_type_color_map; (*pair)[0] >= 0; ++pair) {
@@ -239,6 +261,17 @@ static void deg_debug_graphviz_node_fillcolor(const DebugContext &ctx,
                                               const DepsNode *node)
 {
 	const char *defaultcolor = "gainsboro";
+	if (ctx.show_costs && ctx.max_cost > 0.0f &&
+	    node->tclass == DEPSNODE_CLASS_OPERATION)
+	{
+		OperationDepsNode *op_node = (OperationDepsNode *)node;
+		if (op_node->num_evaluations != 0) {
+			char color[8];
+			deg_debug_graphviz_cost_color(op_node->eval_time_average / ctx.max_cost, color);
+			deg_debug_fprintf(ctx, "\"%s\"", color);
+			return;
+		}
+	}
 	int color_index = deg_debug_node_color_index(node);
 	const char *fillcolor = color_index < 0 ? defaultcolor : deg_debug_colors_light[color_index % deg_debug_max_colors];
 	deg_debug_fprintf(ctx, "\"%s\"", fillcolor);
@@ -256,6 +289,32 @@ static void deg_debug_graphviz_relation_color(const DebugContext &ctx,
 	deg_debug_fprintf(ctx, "%s", color);
 }
 
+/* Relation to the child which continues the longest chain of updates. */
+static bool deg_debug_graphviz_relation_is_critical(const DebugContext &ctx,
+                                                    const DepsRelation *rel)
+{
+	if (!ctx.show_costs ||
+	    (rel->flag & DEPSREL_FLAG_CYCLIC) ||
+	    rel->from->type != DEPSNODE_TYPE_OPERATION ||
+	    rel->to->type != DEPSNODE_TYPE_OPERATION)
+	{
+		return false;
+	}
+	const OperationDepsNode *to = (const OperationDepsNode *)rel->to;
+	if (to->eval_priority <= 0.0f) {
+		return false;
+	}
+	foreach (DepsRelation *other, rel->from->outlinks) {
+		if (other->to->type == DEPSNODE_TYPE_OPERATION &&
+		    (other->flag & DEPSREL_FLAG_CYCLIC) == 0 &&
+		    ((const OperationDepsNode *)other->to)->eval_priority > to->eval_priority)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 static void deg_debug_graphviz_node_style(const DebugContext &ctx, const DepsNode *node)
 {
 	const char *base_style = "filled"; /* default style */
@@ -285,24 +344,28 @@ static void deg_debug_graphviz_node_single(const DebugContext &ctx,
 {
 	const char *shape = "box";
 	string name = node->identifier();
-	float priority = -1.0f;
+	const OperationDepsNode *op_node = NULL;
 	if (node->type == DEPSNODE_TYPE_ID_REF) {
 		IDDepsNode *id_node = (IDDepsNode *)node;
 		char buf[256];
 		BLI_snprintf(buf, sizeof(buf), " (Layers: %u)", id_node->layers);
 		name += buf;
 	}
-	if (ctx.show_eval_priority && node->tclass == DEPSNODE_CLASS_OPERATION) {
-		priority = ((OperationDepsNode *)node)->eval_priority;
+	if (ctx.show_costs && node->tclass == DEPSNODE_CLASS_OPERATION) {
+		op_node = (const OperationDepsNode *)node;
+		if (op_node->num_evaluations == 0) {
+			op_node = NULL;
+		}
 	}
 	deg_debug_fprintf(ctx, "// %s\n", name.c_str());
 	deg_debug_fprintf(ctx, "\"node_%p\"", node);
 	deg_debug_fprintf(ctx, "[");
 //	deg_debug_fprintf(ctx, "label=<<B>%s</B>>", name);
-	if (priority >= 0.0f) {
-		deg_debug_fprintf(ctx, "label=<%s<BR/>(<I>%.2f</I>)>",
+	if (op_node != NULL) {
+		deg_debug_fprintf(ctx, "label=<%s<BR/>(<I>%.3f ms, path %.3f ms</I>)>",
 		                 name.c_str(),
-		                 priority);
+		                 op_node->eval_time_average * 1000.0f,
+		                 op_node->eval_priority * 1000.0f);
 	}
 	else {
 		deg_debug_fprintf(ctx, "label=<%s>", name.c_str());
@@ -483,7 +546,7 @@ static void deg_debug_graphviz_node_relations(const DebugContext &ctx,
                                               const DepsNode *node)
 {
 	foreach (DepsRelation *rel, node->inlinks) {
-		float penwidth = 2.0f;
+		float penwidth = deg_debug_graphviz_relation_is_critical(ctx, rel) ? 6.0f : 2.0f;
 
 		const DepsNode *tail = rel->to; /* same as node */
 		const DepsNode *head = rel->from;
@@ -565,7 +628,11 @@ void DEG_debug_graphviz(const Depsgraph *graph, FILE *f, const char *label, bool
 	DEG::DebugContext ctx;
 	ctx.file = f;
 	ctx.show_tags = show_eval;
-	ctx.show_eval_priority = show_eval;
+	ctx.show_costs = show_eval;
+	ctx.max_cost = 0.0f;
+	foreach (DEG::OperationDepsNode *op_node, deg_graph->operations) {
+		ctx.max_cost = MAX2(ctx.max_cost, op_node->eval_time_average);
+	}
 
 	DEG::deg_debug_fprintf(ctx, "digraph depgraph {" NL);
 	DEG::deg_debug_fprintf(ctx, "rankdir=LR;" NL);
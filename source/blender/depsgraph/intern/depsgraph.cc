@@ -71,6 +71,10 @@ static DEG_EditorUpdateScenePreCb deg_editor_update_scene_pre_cb = NULL;
 Depsgraph::Depsgraph()
   : root_node(NULL),
     need_update(false),
+    eval_time_last(0.0f),
+    eval_time_operations(0.0f),
+    eval_critical_path(0.0f),
+    eval_num_operations(0),
     layers(0)
 {
 	BLI_spin_init(&lock);
@@ -188,6 +188,12 @@ struct Depsgraph {
 	 */
 	SpinLock lock;
 
+	/* Timing of the last evaluation, see DEG_stats_eval(). */
+	float eval_time_last;
+	float eval_time_operations;
+	float eval_critical_path;
+	int eval_num_operations;
+
 	/* Layers Visibility .................. */
 
 	/* Visible layers bitfield, used for skipping invisible objects updates. */
@@ -30,8 +30,13 @@
  * Implementation of tools for debugging the depsgraph
  */
 
+#include <algorithm>
+
+#include "MEM_guardedalloc.h"
+
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
+#include "BLI_string.h"
 
 extern "C" {
 #include "DNA_scene_types.h"
@@ -241,3 +246,69 @@ void DEG_stats_simple(const Depsgraph *graph, size_t *r_outer,
 		if (r_outer)     *r_outer     = tot_outer;
 	}
 }
+
+void DEG_stats_eval(const Depsgraph *graph, DepsgraphStatsEval *r_stats)
+{
+	const DEG::Depsgraph *deg_graph = reinterpret_cast<const DEG::Depsgraph *>(graph);
+
+	r_stats->duration = deg_graph->eval_time_last;
+	r_stats->duration_operations = deg_graph->eval_time_operations;
+	r_stats->critical_path = deg_graph->eval_critical_path;
+	r_stats->num_operations = deg_graph->eval_num_operations;
+}
+
+static bool deg_stats_operation_slower(const DEG::OperationDepsNode *a,
+                                       const DEG::OperationDepsNode *b)
+{
+	return a->eval_time_average > b->eval_time_average;
+}
+
+int DEG_stats_operations(const Depsgraph *graph,
+                         DepsgraphStatsOperation **r_operations)
+{
+	const DEG::Depsgraph *deg_graph = reinterpret_cast<const DEG::Depsgraph *>(graph);
+	vector<DEG::OperationDepsNode *> nodes;
+
+	foreach (DEG::OperationDepsNode *node, deg_graph->operations) {
+		if (node->num_evaluations != 0) {
+			nodes.push_back(node);
+		}
+	}
+	std::sort(nodes.begin(), nodes.end(), deg_stats_operation_slower);
+
+	*r_operations = NULL;
+	if (nodes.empty()) {
+		return 0;
+	}
+
+	DepsgraphStatsOperation *operations = (DepsgraphStatsOperation *)MEM_callocN(
+	        sizeof(DepsgraphStatsOperation) * nodes.size(), "depsgraph operation stats");
+	for (size_t i = 0; i < nodes.size(); i++) {
+		DEG::OperationDepsNode *node = nodes[i];
+		DepsgraphStatsOperation *stats = &operations[i];
+		stats->id = node->owner->owner->id;
+		BLI_strncpy(stats->name, node->full_identifier().c_str(), sizeof(stats->name));
+		stats->duration_last = node->eval_time_last;
+		stats->duration_average = node->eval_time_average;
+		stats->critical_path = node->eval_priority;
+		stats->num_evaluations = node->num_evaluations;
+	}
+
+	*r_operations = operations;
+	return (int)nodes.size();
+}
+
+void DEG_stats_operations_reset(Depsgraph *graph)
+{
+	DEG::Depsgraph *deg_graph = reinterpret_cast<DEG::Depsgraph *>(graph);
+
+	foreach (DEG::OperationDepsNode *node, deg_graph->operations) {
+		node->eval_time_last = 0.0f;
+		node->eval_time_average = 0.0f;
+		node->num_evaluations = 0;
+	}
+	deg_graph->eval_time_last = 0.0f;
+	deg_graph->eval_time_operations = 0.0f;
+	deg_graph->eval_critical_path = 0.0f;
+	deg_graph->eval_num_operations = 0;
+}
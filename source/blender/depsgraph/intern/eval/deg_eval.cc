@@ -32,12 +32,16 @@
 
 #include "intern/eval/deg_eval.h"
 
+#include <utility>
+
 #include "PIL_time.h"
 
 extern "C" {
 #include "BLI_utildefines.h"
 #include "BLI_task.h"
 #include "BLI_ghash.h"
+#include "BLI_heap.h"
+#include "BLI_threads.h"
 
 #include "BKE_depsgraph.h"
 #include "BKE_global.h"
@@ -55,8 +59,11 @@ extern "C" {
 #include "intern/depsgraph.h"
 #include "util/deg_util_foreach.h"
 
-/* Unfinished and unused, and takes quite some pre-processing time. */
-#undef USE_EVAL_PRIORITY
+/* Cost in seconds assumed for operations which were never evaluated. */
+#define EVAL_COST_DEFAULT 1e-6f
+
+/* Weight of the last evaluation in the running average of operation timing. */
+#define EVAL_TIME_AVERAGE_FACTOR 0.25f
 
 /* Use integrated debugger to keep track how much each of the nodes was
  * evaluating.
@@ -79,8 +86,26 @@ struct DepsgraphEvalState {
 	EvaluationContext *eval_ctx;
 	Depsgraph *graph;
 	unsigned int layers;
+	/* Operations ready for evaluation, ordered by their critical path. NULL
+	 * when evaluating with a single thread, where the order does not matter.
+	 */
+	Heap *ready_heap;
+	SpinLock ready_lock;
 };
 
+static void deg_eval_time_update(OperationDepsNode *node, float time)
+{
+	node->eval_time_last = time;
+	if (node->num_evaluations == 0) {
+		node->eval_time_average = time;
+	}
+	else {
+		node->eval_time_average += (time - node->eval_time_average) *
+		                           EVAL_TIME_AVERAGE_FACTOR;
+	}
+	node->num_evaluations++;
+}
+
 static void deg_task_run_func(TaskPool *pool,
                               void *taskdata,
                               int thread_id)
@@ -89,6 +114,15 @@ static void deg_task_run_func(TaskPool *pool,
 	        reinterpret_cast<DepsgraphEvalState *>(BLI_task_pool_userdata(pool));
 	OperationDepsNode *node = reinterpret_cast<OperationDepsNode *>(taskdata);
 
+	/* Tasks pushed with a ready queue do not carry their node, the most
+	 * expensive ready operation is taken when the task starts.
+	 */
+	if (node == NULL) {
+		BLI_spin_lock(&state->ready_lock);
+		node = (OperationDepsNode *)BLI_heap_popmin(state->ready_heap);
+		BLI_spin_unlock(&state->ready_lock);
+	}
+
 	BLI_assert(!node->is_noop() && "NOOP nodes should not actually be scheduled");
 
 	/* Should only be the case for NOOPs, which never get to this point. */
@@ -109,8 +143,8 @@ static void deg_task_run_func(TaskPool *pool,
 		 */
 		if (node->evaluate) {
 			/* Take note of current time. */
-#ifdef USE_DEBUGGER
 			double start_time = PIL_check_seconds_timer();
+#ifdef USE_DEBUGGER
 			DepsgraphDebug::task_started(state->graph, node);
 #endif
 
@@ -118,8 +152,9 @@ static void deg_task_run_func(TaskPool *pool,
 			node->evaluate(state->eval_ctx);
 
 			/* Note how long this took. */
-#ifdef USE_DEBUGGER
 			double end_time = PIL_check_seconds_timer();
+			deg_eval_time_update(node, (float)(end_time - start_time));
+#ifdef USE_DEBUGGER
 			DepsgraphDebug::task_completed(state->graph,
 			                               node,
 			                               end_time - start_time);
@@ -209,6 +244,7 @@ static void calculate_pending_func(void *data_v, int i)
 	IDDepsNode *id_node = node->owner->owner;
 
 	node->num_links_pending = 0;
+	node->eval_priority = 0.0f;
 	node->scheduled = false;
 
 	/* count number of inputs that need updates */
@@ -245,32 +281,77 @@ static void calculate_pending_parents(Depsgraph *graph, unsigned int layers)
 	                        do_threads);
 }
 
-#ifdef USE_EVAL_PRIORITY
-static void calculate_eval_priority(OperationDepsNode *node)
+static bool operation_needs_update(const OperationDepsNode *node,
+                                   const unsigned int layers)
 {
-	if (node->done) {
-		return;
+	return (node->flag & DEPSOP_FLAG_NEEDS_UPDATE) != 0 &&
+	       (node->owner->owner->layers & layers) != 0;
+}
+
+static float operation_eval_cost(const OperationDepsNode *node)
+{
+	if (node->is_noop()) {
+		return 0.0f;
 	}
-	node->done = 1;
-
-	if (node->flag & DEPSOP_FLAG_NEEDS_UPDATE) {
-		/* XXX standard cost of a node, could be estimated somewhat later on */
-		const float cost = 1.0f;
-		/* NOOP nodes have no cost */
-		node->eval_priority = node->is_noop() ? cost : 0.0f;
-
-		foreach (DepsRelation *rel, node->outlinks) {
-			OperationDepsNode *to = (OperationDepsNode *)rel->to;
-			BLI_assert(to->type == DEPSNODE_TYPE_OPERATION);
-			calculate_eval_priority(to);
-			node->eval_priority += to->eval_priority;
-		}
+	if (node->num_evaluations == 0) {
+		return EVAL_COST_DEFAULT;
 	}
-	else {
-		node->eval_priority = 0.0f;
+	return node->eval_time_average;
+}
+
+/* Set the priority of every operation which needs update to the estimated
+ * time of the longest chain of updates starting at it, and return the
+ * longest one of the graph.
+ *
+ * Traversal is iterative, chains in rigs can be deep enough to overflow the
+ * stack with recursion.
+ */
+static float calculate_eval_priority(Depsgraph *graph, const unsigned int layers)
+{
+	typedef std::pair<OperationDepsNode *, size_t> StackEntry;
+	vector<StackEntry> stack;
+	float critical_path = 0.0f;
+
+	foreach (OperationDepsNode *root, graph->operations) {
+		if (root->done || !operation_needs_update(root, layers)) {
+			continue;
+		}
+		root->done = 1;
+		stack.push_back(StackEntry(root, 0));
+		while (!stack.empty()) {
+			OperationDepsNode *node = stack.back().first;
+			size_t index = stack.back().second;
+			if (index < node->outlinks.size()) {
+				DepsRelation *rel = node->outlinks[index];
+				OperationDepsNode *child = (OperationDepsNode *)rel->to;
+				BLI_assert(child->type == DEPSNODE_TYPE_OPERATION);
+				stack.back().second++;
+				if ((rel->flag & DEPSREL_FLAG_CYCLIC) == 0 &&
+				    child->done == 0 &&
+				    operation_needs_update(child, layers))
+				{
+					child->done = 1;
+					stack.push_back(StackEntry(child, 0));
+				}
+			}
+			else {
+				/* All children are done, so their priority is final. */
+				float priority = 0.0f;
+				foreach (DepsRelation *rel, node->outlinks) {
+					OperationDepsNode *child = (OperationDepsNode *)rel->to;
+					if ((rel->flag & DEPSREL_FLAG_CYCLIC) == 0) {
+						priority = MAX2(priority, child->eval_priority);
+					}
+				}
+				node->eval_priority = operation_eval_cost(node) + priority;
+				stack.pop_back();
+			}
+		}
+		critical_path = MAX2(critical_path, root->eval_priority);
 	}
+
+	return critical_path;
 }
-#endif
 
 /* Schedule a node if it needs evaluation.
  *   dec_parents: Decrement pending parents count, true when child nodes are
@@ -300,9 +381,18 @@ static void schedule_node(TaskPool *pool, Depsgraph *graph, unsigned int layers,
 				}
 				else {
 					/* children are scheduled once this task is completed */
+					DepsgraphEvalState *state =
+					        (DepsgraphEvalState *)BLI_task_pool_userdata(pool);
+					void *taskdata = node;
+					if (state->ready_heap != NULL) {
+						BLI_spin_lock(&state->ready_lock);
+						BLI_heap_insert(state->ready_heap, -node->eval_priority, node);
+						BLI_spin_unlock(&state->ready_lock);
+						taskdata = NULL;
+					}
 					BLI_task_pool_push_from_thread(pool,
 					                               deg_task_run_func,
-					                               node,
+					                               taskdata,
 					                               false,
 					                               TASK_PRIORITY_LOW,
 					                               thread_id);
@@ -371,6 +461,9 @@ void deg_evaluate_on_refresh(EvaluationContext *eval_ctx,
 	state.eval_ctx = eval_ctx;
 	state.graph = graph;
 	state.layers = layers;
+	state.ready_heap = NULL;
+
+	double start_time = PIL_check_seconds_timer();
 
 	TaskScheduler *task_scheduler = BLI_task_scheduler_get();
 	TaskPool *task_pool = BLI_task_pool_create(task_scheduler, &state);
@@ -386,12 +479,15 @@ void deg_evaluate_on_refresh(EvaluationContext *eval_ctx,
 		node->done = 0;
 	}
 
-	/* Calculate priority for operation nodes. */
-#ifdef USE_EVAL_PRIORITY
-	foreach (OperationDepsNode *node, graph->operations) {
-		calculate_eval_priority(node);
+	/* Calculate priority for operation nodes, so threads start with the
+	 * longest chains instead of leaving them for the end of the update.
+	 */
+	graph->eval_critical_path = 0.0f;
+	if (BLI_pool_get_num_threads(task_pool) > 1) {
+		graph->eval_critical_path = calculate_eval_priority(graph, layers);
+		state.ready_heap = BLI_heap_new();
+		BLI_spin_init(&state.ready_lock);
 	}
-#endif
 
 	DepsgraphDebug::eval_begin(eval_ctx);
 
@@ -400,8 +496,25 @@ void deg_evaluate_on_refresh(EvaluationContext *eval_ctx,
 	BLI_task_pool_work_and_wait(task_pool);
 	BLI_task_pool_free(task_pool);
 
+	if (state.ready_heap != NULL) {
+		BLI_assert(BLI_heap_is_empty(state.ready_heap));
+		BLI_heap_free(state.ready_heap, NULL);
+		BLI_spin_end(&state.ready_lock);
+	}
+
 	DepsgraphDebug::eval_end(eval_ctx);
 
+	/* Gather timing of the evaluation. */
+	graph->eval_time_last = (float)(PIL_check_seconds_timer() - start_time);
+	graph->eval_time_operations = 0.0f;
+	graph->eval_num_operations = 0;
+	foreach (OperationDepsNode *node, graph->operations) {
+		if (node->scheduled && !node->is_noop()) {
+			graph->eval_time_operations += node->eval_time_last;
+			graph->eval_num_operations++;
+		}
+	}
+
 	/* Clear any uncleared tags - just in case. */
 	deg_graph_clear_tags(graph);
 }
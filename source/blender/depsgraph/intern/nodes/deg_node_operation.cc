@@ -47,6 +47,9 @@ namespace DEG {
 
 OperationDepsNode::OperationDepsNode() :
     eval_priority(0.0f),
+    eval_time_last(0.0f),
+    eval_time_average(0.0f),
+    num_evaluations(0),
     flag(0),
     customdata_mask(0)
 {
@@ -81,9 +81,19 @@ struct OperationDepsNode : public DepsNode {
 
 	/* How many inlinks are we still waiting on before we can be evaluated. */
 	uint32_t num_links_pending;
+	/* Estimated time in seconds of the longest chain of tagged operations
+	 * starting at this one, used to evaluate the critical path first.
+	 */
 	float eval_priority;
 	bool scheduled;
 
+	/* Time in seconds spent in evaluate() by the last evaluation, and running
+	 * average over the previous ones.
+	 */
+	float eval_time_last;
+	float eval_time_average;
+	uint32_t num_evaluations;
+
 	/* Stage of evaluation */
 	eDepsOperation_Type optype;
 
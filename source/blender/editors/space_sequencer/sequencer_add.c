@@ -289,6 +289,8 @@ static int sequencer_add_scene_strip_exec(bContext *C, wmOperator *op)
 	
 	int start_frame, channel; /* operator props */
 	
+	BKE_sequencer_prefetch_stop();
+
 	start_frame = RNA_int_get(op->ptr, "frame_start");
 	channel = RNA_int_get(op->ptr, "channel");
 	
@@ -377,6 +379,8 @@ static int sequencer_add_movieclip_strip_exec(bContext *C, wmOperator *op)
 	
 	int start_frame, channel; /* operator props */
 	
+	BKE_sequencer_prefetch_stop();
+
 	start_frame = RNA_int_get(op->ptr, "frame_start");
 	channel = RNA_int_get(op->ptr, "channel");
 	
@@ -461,6 +465,8 @@ static int sequencer_add_mask_strip_exec(bContext *C, wmOperator *op)
 
 	int start_frame, channel; /* operator props */
 
+	BKE_sequencer_prefetch_stop();
+
 	start_frame = RNA_int_get(op->ptr, "frame_start");
 	channel = RNA_int_get(op->ptr, "channel");
 
@@ -542,6 +548,8 @@ static int sequencer_add_generic_strip_exec(bContext *C, wmOperator *op, SeqLoad
 	SeqLoadInfo seq_load;
 	int tot_files;
 
+	BKE_sequencer_prefetch_stop();
+
 	seq_load_operator_info(&seq_load, op);
 
 	if (seq_load.flag & SEQ_LOAD_REPLACE_SEL)
@@ -979,6 +987,8 @@ static int sequencer_add_effect_strip_exec(bContext *C, wmOperator *op)
 	Sequence *seq1, *seq2, *seq3;
 	const char *error_msg;
 
+	BKE_sequencer_prefetch_stop();
+
 	start_frame = RNA_int_get(op->ptr, "frame_start");
 	end_frame = RNA_int_get(op->ptr, "frame_end");
 	channel = RNA_int_get(op->ptr, "channel");
@@ -36,6 +36,8 @@
 #include "BLI_utildefines.h"
 #include "BLI_threads.h"
 
+#include "BLT_translation.h"
+
 #include "IMB_imbuf_types.h"
 
 #include "DNA_scene_types.h"
@@ -941,10 +943,11 @@ ImBuf *sequencer_ibuf_get(struct Main *bmain, Scene *scene, SpaceSeq *sseq, int
 
 	if (special_seq_update)
 		ibuf = BKE_sequencer_give_ibuf_direct(&context, cfra + frame_ofs, special_seq_update);
-	else if (!U.prefetchframes) // XXX || (G.f & G_PLAYANIM) == 0) {
-		ibuf = BKE_sequencer_give_ibuf(&context, cfra + frame_ofs, sseq->chanshown);
+	/* strips are changed while transforming, the prefetch threads would render them */
+	else if (U.prefetchframes && frame_ofs == 0 && !(G.moving & G_TRANSFORM_SEQ))
+		ibuf = BKE_sequencer_give_ibuf_prefetch(&context, cfra, sseq->chanshown, U.prefetchframes);
 	else
-		ibuf = BKE_sequencer_give_ibuf_threaded(&context, cfra + frame_ofs, sseq->chanshown);
+		ibuf = BKE_sequencer_give_ibuf(&context, cfra + frame_ofs, sseq->chanshown);
 
 	/* restore state so real rendering would be canceled (if needed) */
 	G.is_break = is_break;
@@ -952,6 +955,27 @@ ImBuf *sequencer_ibuf_get(struct Main *bmain, Scene *scene, SpaceSeq *sseq, int
 	return ibuf;
 }
 
+static void sequencer_draw_prefetch_stats(ARegion *ar)
+{
+	SeqPrefetchStats stats;
+	char str[UI_MAX_DRAW_STR];
+	float fill_color[4] = {0.0f, 0.0f, 0.0f, 0.25f};
+	int hit_rate;
+
+	BKE_sequencer_prefetch_stats_get(&stats);
+
+	if (stats.frames_requested == 0) {
+		return;
+	}
+
+	hit_rate = (100 * stats.frames_cached) / stats.frames_requested;
+
+	BLI_snprintf(str, sizeof(str), IFACE_("Cache hits: %d%% of %d frames | Ahead: %d frames | Prefetched: %d | Skipped: %d"),
+	             hit_rate, stats.frames_requested, stats.frames_ahead, stats.frames_prefetched, stats.frames_skipped);
+
+	ED_region_info_draw(ar, str, fill_color, false);
+}
+
 static void sequencer_check_scopes(SequencerScopes *scopes, ImBuf *ibuf)
 {
 	if (scopes->reference_ibuf != ibuf) {
@@ -1416,6 +1440,10 @@ void draw_image_seq(const bContext *C, Scene *scene, ARegion *ar, SpaceSeq *sseq
 		UI_view2d_view_restore(C);
 	}
 
+	if (U.prefetchframes && !draw_overlay && ED_screen_animation_playing(CTX_wm_manager(C))) {
+		UI_view2d_view_restore(C);
+		sequencer_draw_prefetch_stats(ar);
+	}
 
 	/* NOTE: sequencer mask editing isnt finished, the draw code is working but editing not,
 	 * for now just disable drawing since the strip frame will likely be offset */
@@ -4923,6 +4923,8 @@ static void freeSeqData(TransInfo *t, TransCustomData *custom_data)
 		Sequence *seq_prev = NULL;
 		Sequence *seq;
 
+		/* strips may be shuffled, removed or have their effects changed */
+		BKE_sequencer_prefetch_stop();
 
 		if (!(t->state == TRANS_CANCEL)) {
 
@@ -5104,6 +5106,8 @@ static void createTransSeqData(bContext *C, TransInfo *t)
 		return;
 	}
 
+	BKE_sequencer_prefetch_stop();
+
 	t->custom.type.free_cb = freeSeqData;
 
 	xmouse = (int)UI_view2d_region_to_view_x(v2d, t->mouse.imval[0]);
@@ -134,6 +134,14 @@ void GPU_create_gl_tex_compressed(
         unsigned int *bind, unsigned int *pix, int x, int y, int mipmap,
         int textarget, struct Image *ima, struct ImBuf *ibuf);
 bool GPU_upload_dxt_texture(struct ImBuf *ibuf);
+void GPU_get_gl_tex_size(int rectw, int recth, int *r_texw, int *r_texh);
+
+/* Image texture streaming
+ * - the texture is created with a placeholder and its levels are uploaded later */
+unsigned int GPU_stream_image_create(struct Image *ima);
+void GPU_stream_image_allocate(struct Image *ima, int rectw, int recth, int levels);
+void GPU_stream_image_upload(struct Image *ima, int level, int rectw, int y, int numrows, const unsigned int *rect);
+void GPU_stream_image_set_base_level(struct Image *ima, int level);
 void GPU_free_image(struct Image *ima);
 void GPU_free_images(void);
 void GPU_free_images_anim(void);
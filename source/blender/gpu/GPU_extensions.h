@@ -48,6 +48,7 @@ bool GPU_bicubic_bump_support(void);
 bool GPU_geometry_shader_support(void);
 bool GPU_geometry_shader_support_via_extension(void);
 bool GPU_instanced_drawing_support(void);
+bool GPU_program_binary_support(void);
 
 int GPU_max_texture_size(void);
 int GPU_max_textures(void);
@@ -378,6 +378,24 @@ void GPU_material_update_fvar_offset(GPUMaterial *gpu_material,
                                      struct DerivedMesh *dm);
 #endif
 
+/* Shader cache */
+
+typedef struct GPUPassCacheStats {
+	int num_generated;      /* passes generated */
+	int num_shared;         /* passes using the shader of an identical pass */
+	int num_compiled;       /* shaders compiled from their code */
+	int num_loaded;         /* shaders loaded from the cache file */
+	int num_shaders;        /* shaders in use */
+	int num_file_entries;   /* program binaries in the cache file */
+	double generate_time;   /* seconds spent generating the code */
+	double compile_time;    /* seconds spent compiling or loading the shaders */
+} GPUPassCacheStats;
+
+void GPU_pass_cache_stats(GPUPassCacheStats *r_stats);
+void GPU_pass_cache_file_open(const char *filepath);
+bool GPU_pass_cache_file_save(void);
+void GPU_pass_cache_file_close(void);
+
 /* Instancing material */
 void GPU_material_bind_instancing_attrib(GPUMaterial *material, void *matrixoffset, void *positionoffset, void *coloroffset, unsigned int stride);
 void GPU_material_unbind_instancing_attrib(GPUMaterial *material);
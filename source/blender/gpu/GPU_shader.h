@@ -49,6 +49,8 @@ enum {
 	GPU_SHADER_FLAGS_NEW_SHADING        = (1 << 1),
 	GPU_SHADER_FLAGS_SPECIAL_INSTANCING = (1 << 2),
 	GPU_SHADER_FLAGS_SPECIAL_RESET_LINE = (1 << 3),
+	/* the program binary can be read with GPU_shader_get_binary */
+	GPU_SHADER_FLAGS_BINARY_RETRIEVABLE = (1 << 4),
 };
 
 GPUShader *GPU_shader_create(
@@ -66,6 +68,8 @@ GPUShader *GPU_shader_create_ex(
         const char *defines,
         int input, int output, int number,
         const int flags);
+GPUShader *GPU_shader_create_from_binary(const void *binary, int size, unsigned int format);
+void *GPU_shader_get_binary(GPUShader *shader, int *r_size, unsigned int *r_format);
 char *GPU_shader_validate(GPUShader *shader);
 void GPU_shader_free(GPUShader *shader);
 
@@ -109,6 +109,7 @@ int GPU_texture_depth(const GPUTexture *tex);
 int GPU_texture_opengl_bindcode(const GPUTexture *tex);
 
 void GPU_texture_set_opengl_bindcode(GPUTexture *tex, int bindcode);
+void GPU_texture_set_size(GPUTexture *tex, int w, int h);
 
 
 #ifdef __cplusplus
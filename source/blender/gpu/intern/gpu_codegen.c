@@ -41,6 +41,9 @@
 #include "BLI_utildefines.h"
 #include "BLI_dynstr.h"
 #include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
+
+#include "BKE_blender_version.h"
 
 #include "GPU_extensions.h"
 #include "GPU_glew.h"
@@ -50,10 +53,13 @@
 
 #include "BLI_sys_types.h" /* for intptr_t support */
 
+#include "PIL_time.h"
+
 #include "gpu_codegen.h"
 
 #include <string.h>
 #include <stdarg.h>
+#include <stdio.h>
 
 extern char datatoc_gpu_shader_material_glsl[];
 extern char datatoc_gpu_shader_vertex_glsl[];
@@ -62,6 +68,21 @@ extern char datatoc_gpu_shader_geometry_glsl[];
 
 static char *glsl_material_library = NULL;
 
+/* Passes with the same code share their shader, see GPU_generate_pass. */
+typedef struct GPUPassCacheEntry {
+	uint64_t hash;
+	GPUShader *shader;
+	char *vertexcode;
+	char *geometrycode;
+	char *fragmentcode;
+	int users;
+	/* false for a hash collision, then the entry isn't in the cache */
+	bool cached;
+} GPUPassCacheEntry;
+
+static GHash *gpu_pass_cache = NULL;
+static GPUPassCacheStats gpu_pass_cache_stats = {0};
+
 
 /* type definitions and constants */
 
@@ -291,6 +312,15 @@ void gpu_codegen_exit(void)
 
 	GPU_shader_free_builtin_shaders();
 
+	GPU_pass_cache_file_close();
+
+	/* the entries are freed by the passes still using them */
+	if (gpu_pass_cache) {
+		BLI_ghash_free(gpu_pass_cache, NULL, NULL);
+		gpu_pass_cache = NULL;
+	}
+	memset(&gpu_pass_cache_stats, 0, sizeof(gpu_pass_cache_stats));
+
 	if (glsl_material_library) {
 		MEM_freeN(glsl_material_library);
 		glsl_material_library = NULL;
@@ -1717,6 +1747,424 @@ static void gpu_nodes_prune(ListBase *nodes, GPUNodeLink *outlink)
 	}
 }
 
+/* Pass cache
+ *
+ * Identical materials generate the same code, the passes of a session are looked up by
+ * a hash of their code, flags and attribute layout to compile their shader only once.
+ * The uniforms and textures stay in each pass, only the program is shared.
+ *
+ * With GPU_pass_cache_file_open the program binaries are also kept in a file when the
+ * driver supports ARB_get_program_binary, to skip the compilation in the next sessions.
+ * The file is discarded when the driver, the Blender version or the GLSL library change. */
+
+#define GPU_PASS_CACHE_FILE_VERSION 1
+
+static const char gpu_pass_cache_file_magic[4] = {'G', 'P', 'U', 'C'};
+
+typedef struct GPUPassCacheFileEntry {
+	uint64_t hash;
+	unsigned int format;
+	int size;
+	void *binary;
+	/* compared with the generated code, in case of a hash collision */
+	char *vertexcode;
+	char *fragmentcode;
+} GPUPassCacheFileEntry;
+
+static struct {
+	GHash *entries;
+	char filepath[FILE_MAX];
+	/* hash of the driver, the Blender version and the GLSL library */
+	uint64_t context_hash;
+	bool changed;
+} gpu_pass_cache_file = {NULL};
+
+static unsigned int gpu_pass_cache_hash(const void *key)
+{
+	const uint64_t hash = *(const uint64_t *)key;
+	return (unsigned int)(hash ^ (hash >> 32));
+}
+
+static bool gpu_pass_cache_cmp(const void *a, const void *b)
+{
+	return (*(const uint64_t *)a != *(const uint64_t *)b);
+}
+
+static void gpu_hash_add_string(BLI_HashMurmur2A *mm2, const char *str)
+{
+	if (str) {
+		const size_t len = strlen(str);
+		BLI_hash_mm2a_add_int(mm2, (int)len);
+		BLI_hash_mm2a_add(mm2, (const unsigned char *)str, len);
+	}
+	else {
+		BLI_hash_mm2a_add_int(mm2, -1);
+	}
+}
+
+static uint64_t gpu_pass_hash(const char *vertexcode, const char *geometrycode, const char *fragmentcode,
+                              const GPUVertexAttribs *attribs, int flags)
+{
+	uint32_t hash[2];
+	int i, a;
+
+	/* two seeds for a 64 bits hash */
+	for (i = 0; i < 2; i++) {
+		BLI_HashMurmur2A mm2;
+
+		BLI_hash_mm2a_init(&mm2, (uint32_t)i);
+		gpu_hash_add_string(&mm2, vertexcode);
+		gpu_hash_add_string(&mm2, geometrycode);
+		gpu_hash_add_string(&mm2, fragmentcode);
+		BLI_hash_mm2a_add_int(&mm2, flags);
+		BLI_hash_mm2a_add_int(&mm2, attribs->totlayer);
+		for (a = 0; a < attribs->totlayer; a++) {
+			BLI_hash_mm2a_add_int(&mm2, attribs->layer[a].type);
+			BLI_hash_mm2a_add_int(&mm2, attribs->layer[a].attribid);
+			BLI_hash_mm2a_add_int(&mm2, attribs->layer[a].gltexco);
+		}
+		hash[i] = BLI_hash_mm2a_end(&mm2);
+	}
+
+	return ((uint64_t)hash[0] << 32) | hash[1];
+}
+
+static bool gpu_str_equals(const char *a, const char *b)
+{
+	if (a && b)
+		return STREQ(a, b);
+	return (a == b);
+}
+
+static GPUPassCacheEntry *gpu_pass_cache_lookup(uint64_t hash, const char *vertexcode,
+                                                const char *geometrycode, const char *fragmentcode)
+{
+	GPUPassCacheEntry *entry;
+
+	if (!gpu_pass_cache)
+		return NULL;
+
+	entry = BLI_ghash_lookup(gpu_pass_cache, &hash);
+	if (entry &&
+	    gpu_str_equals(entry->vertexcode, vertexcode) &&
+	    gpu_str_equals(entry->geometrycode, geometrycode) &&
+	    gpu_str_equals(entry->fragmentcode, fragmentcode))
+	{
+		return entry;
+	}
+
+	return NULL;
+}
+
+static GPUPassCacheEntry *gpu_pass_cache_add(uint64_t hash, GPUShader *shader, char *vertexcode,
+                                             char *geometrycode, char *fragmentcode)
+{
+	GPUPassCacheEntry *entry = MEM_callocN(sizeof(GPUPassCacheEntry), "GPUPassCacheEntry");
+
+	entry->hash = hash;
+	entry->shader = shader;
+	entry->vertexcode = vertexcode;
+	entry->geometrycode = geometrycode;
+	entry->fragmentcode = fragmentcode;
+	entry->users = 1;
+
+	if (!gpu_pass_cache)
+		gpu_pass_cache = BLI_ghash_new(gpu_pass_cache_hash, gpu_pass_cache_cmp, "GPU pass cache");
+
+	if (!BLI_ghash_haskey(gpu_pass_cache, &entry->hash)) {
+		BLI_ghash_insert(gpu_pass_cache, &entry->hash, entry);
+		entry->cached = true;
+	}
+
+	return entry;
+}
+
+static void gpu_pass_cache_release(GPUPassCacheEntry *entry)
+{
+	if (--entry->users > 0)
+		return;
+
+	if (entry->cached && gpu_pass_cache)
+		BLI_ghash_remove(gpu_pass_cache, &entry->hash, NULL, NULL);
+
+	GPU_shader_free(entry->shader);
+	if (entry->vertexcode)
+		MEM_freeN(entry->vertexcode);
+	if (entry->geometrycode)
+		MEM_freeN(entry->geometrycode);
+	if (entry->fragmentcode)
+		MEM_freeN(entry->fragmentcode);
+	MEM_freeN(entry);
+}
+
+static void gpu_pass_cache_file_entry_free(void *val)
+{
+	GPUPassCacheFileEntry *entry = val;
+
+	MEM_freeN(entry->binary);
+	MEM_freeN(entry->vertexcode);
+	MEM_freeN(entry->fragmentcode);
+	MEM_freeN(entry);
+}
+
+static uint64_t gpu_pass_cache_context_hash(void)
+{
+	const char *strings[4];
+	uint32_t hash[2];
+	int i, a;
+
+	strings[0] = (const char *)glGetString(GL_VENDOR);
+	strings[1] = (const char *)glGetString(GL_RENDERER);
+	strings[2] = (const char *)glGetString(GL_VERSION);
+	strings[3] = (const char *)glGetString(GL_SHADING_LANGUAGE_VERSION);
+
+	for (i = 0; i < 2; i++) {
+		BLI_HashMurmur2A mm2;
+
+		BLI_hash_mm2a_init(&mm2, (uint32_t)i);
+		for (a = 0; a < ARRAY_SIZE(strings); a++)
+			gpu_hash_add_string(&mm2, strings[a]);
+		BLI_hash_mm2a_add_int(&mm2, BLENDER_VERSION);
+		BLI_hash_mm2a_add_int(&mm2, BLENDER_SUBVERSION);
+		gpu_hash_add_string(&mm2, glsl_material_library);
+		hash[i] = BLI_hash_mm2a_end(&mm2);
+	}
+
+	return ((uint64_t)hash[0] << 32) | hash[1];
+}
+
+/* Read a value of the file, false when past its end. */
+static bool gpu_pass_cache_file_read(const char **cur, const char *end, void *data, size_t size)
+{
+	if ((size_t)(end - *cur) < size)
+		return false;
+
+	memcpy(data, *cur, size);
+	*cur += size;
+	return true;
+}
+
+static char *gpu_pass_cache_file_read_string(const char **cur, const char *end, int len)
+{
+	char *str;
+
+	if (len < 0 || (end - *cur) < len)
+		return NULL;
+
+	str = MEM_mallocN(len + 1, "GPUPassCacheFileEntry code");
+	memcpy(str, *cur, len);
+	str[len] = '\0';
+	*cur += len;
+	return str;
+}
+
+static void gpu_pass_cache_file_parse(const char *data, size_t size)
+{
+	const char *cur = data, *end = data + size;
+	char magic[4];
+	int version, num_entries, i;
+	uint64_t context_hash;
+
+	if (!gpu_pass_cache_file_read(&cur, end, magic, sizeof(magic)) ||
+	    !gpu_pass_cache_file_read(&cur, end, &version, sizeof(version)) ||
+	    !gpu_pass_cache_file_read(&cur, end, &context_hash, sizeof(context_hash)) ||
+	    !gpu_pass_cache_file_read(&cur, end, &num_entries, sizeof(num_entries)))
+	{
+		return;
+	}
+
+	if (memcmp(magic, gpu_pass_cache_file_magic, sizeof(magic)) != 0 ||
+	    version != GPU_PASS_CACHE_FILE_VERSION ||
+	    context_hash != gpu_pass_cache_file.context_hash)
+	{
+		/* written by another driver or version, replaced on save */
+		gpu_pass_cache_file.changed = true;
+		return;
+	}
+
+	for (i = 0; i < num_entries; i++) {
+		GPUPassCacheFileEntry *entry;
+		int vertexlen, fragmentlen;
+
+		entry = MEM_callocN(sizeof(GPUPassCacheFileEntry), "GPUPassCacheFileEntry");
+
+		if (!gpu_pass_cache_file_read(&cur, end, &entry->hash, sizeof(entry->hash)) ||
+		    !gpu_pass_cache_file_read(&cur, end, &entry->format, sizeof(entry->format)) ||
+		    !gpu_pass_cache_file_read(&cur, end, &entry->size, sizeof(entry->size)) ||
+		    !gpu_pass_cache_file_read(&cur, end, &vertexlen, sizeof(vertexlen)) ||
+		    !gpu_pass_cache_file_read(&cur, end, &fragmentlen, sizeof(fragmentlen)) ||
+		    !(entry->vertexcode = gpu_pass_cache_file_read_string(&cur, end, vertexlen)) ||
+		    !(entry->fragmentcode = gpu_pass_cache_file_read_string(&cur, end, fragmentlen)) ||
+		    entry->size <= 0 || (end - cur) < entry->size)
+		{
+			/* truncated file, keep the complete entries */
+			if (entry->vertexcode)
+				MEM_freeN(entry->vertexcode);
+			if (entry->fragmentcode)
+				MEM_freeN(entry->fragmentcode);
+			MEM_freeN(entry);
+			gpu_pass_cache_file.changed = true;
+			return;
+		}
+
+		entry->binary = MEM_mallocN(entry->size, "GPUPassCacheFileEntry binary");
+		memcpy(entry->binary, cur, entry->size);
+		cur += entry->size;
+
+		if (!BLI_ghash_reinsert(gpu_pass_cache_file.entries, &entry->hash, entry,
+		                        NULL, gpu_pass_cache_file_entry_free))
+		{
+			gpu_pass_cache_file.changed = true;
+		}
+	}
+}
+
+/* Open the cache file of program binaries, it doesn't need to exist. Must be called
+ * with an OpenGL context and before generating the passes to load. */
+void GPU_pass_cache_file_open(const char *filepath)
+{
+	void *data;
+	size_t size;
+
+	GPU_pass_cache_file_close();
+
+	if (!GPU_program_binary_support())
+		return;
+
+	GPU_code_generate_glsl_lib();
+
+	gpu_pass_cache_file.entries = BLI_ghash_new(gpu_pass_cache_hash, gpu_pass_cache_cmp, "GPU pass cache file");
+	BLI_strncpy(gpu_pass_cache_file.filepath, filepath, sizeof(gpu_pass_cache_file.filepath));
+	gpu_pass_cache_file.context_hash = gpu_pass_cache_context_hash();
+	gpu_pass_cache_file.changed = false;
+
+	data = BLI_file_read_binary_as_mem(filepath, 0, &size);
+	if (data) {
+		gpu_pass_cache_file_parse(data, size);
+		MEM_freeN(data);
+	}
+}
+
+/* Write the cache file if programs were added or discarded since it was opened. */
+bool GPU_pass_cache_file_save(void)
+{
+	GHashIterator gh_iter;
+	char tmppath[FILE_MAX];
+	FILE *fp;
+	int version = GPU_PASS_CACHE_FILE_VERSION;
+	int num_entries;
+	bool ok = true;
+
+	if (!gpu_pass_cache_file.entries)
+		return false;
+	if (!gpu_pass_cache_file.changed)
+		return true;
+
+	/* write a temporary file, a crash would leave an incomplete file otherwise */
+	BLI_snprintf(tmppath, sizeof(tmppath), "%s@", gpu_pass_cache_file.filepath);
+
+	fp = BLI_fopen(tmppath, "wb");
+	if (!fp) {
+		fprintf(stderr, "GPU pass cache: can't write '%s'\n", tmppath);
+		return false;
+	}
+
+	num_entries = BLI_ghash_size(gpu_pass_cache_file.entries);
+	ok &= (fwrite(gpu_pass_cache_file_magic, sizeof(gpu_pass_cache_file_magic), 1, fp) == 1);
+	ok &= (fwrite(&version, sizeof(version), 1, fp) == 1);
+	ok &= (fwrite(&gpu_pass_cache_file.context_hash, sizeof(uint64_t), 1, fp) == 1);
+	ok &= (fwrite(&num_entries, sizeof(num_entries), 1, fp) == 1);
+
+	GHASH_ITER (gh_iter, gpu_pass_cache_file.entries) {
+		GPUPassCacheFileEntry *entry = BLI_ghashIterator_getValue(&gh_iter);
+		const int vertexlen = strlen(entry->vertexcode);
+		const int fragmentlen = strlen(entry->fragmentcode);
+
+		ok &= (fwrite(&entry->hash, sizeof(entry->hash), 1, fp) == 1);
+		ok &= (fwrite(&entry->format, sizeof(entry->format), 1, fp) == 1);
+		ok &= (fwrite(&entry->size, sizeof(entry->size), 1, fp) == 1);
+		ok &= (fwrite(&vertexlen, sizeof(vertexlen), 1, fp) == 1);
+		ok &= (fwrite(&fragmentlen, sizeof(fragmentlen), 1, fp) == 1);
+		ok &= (fwrite(entry->vertexcode, 1, vertexlen, fp) == vertexlen);
+		ok &= (fwrite(entry->fragmentcode, 1, fragmentlen, fp) == fragmentlen);
+		ok &= (fwrite(entry->binary, 1, entry->size, fp) == entry->size);
+	}
+
+	if (fclose(fp) != 0)
+		ok = false;
+
+	if (!ok || BLI_rename(tmppath, gpu_pass_cache_file.filepath) != 0) {
+		fprintf(stderr, "GPU pass cache: can't write '%s'\n", gpu_pass_cache_file.filepath);
+		BLI_delete(tmppath, false, false);
+		return false;
+	}
+
+	gpu_pass_cache_file.changed = false;
+	return true;
+}
+
+/* Close the cache file without saving it. */
+void GPU_pass_cache_file_close(void)
+{
+	if (gpu_pass_cache_file.entries) {
+		BLI_ghash_free(gpu_pass_cache_file.entries, NULL, gpu_pass_cache_file_entry_free);
+		gpu_pass_cache_file.entries = NULL;
+	}
+}
+
+/* Create the shader from the cache file, NULL if it isn't in the file or the driver rejects it. */
+static GPUShader *gpu_pass_cache_file_load(uint64_t hash, const char *vertexcode, const char *fragmentcode)
+{
+	GPUPassCacheFileEntry *entry;
+	GPUShader *shader;
+
+	entry = BLI_ghash_lookup(gpu_pass_cache_file.entries, &hash);
+	if (!entry)
+		return NULL;
+
+	if (STREQ(entry->vertexcode, vertexcode) && STREQ(entry->fragmentcode, fragmentcode)) {
+		shader = GPU_shader_create_from_binary(entry->binary, entry->size, entry->format);
+		if (shader)
+			return shader;
+	}
+
+	/* replaced by the compiled program */
+	BLI_ghash_remove(gpu_pass_cache_file.entries, &hash, NULL, gpu_pass_cache_file_entry_free);
+	gpu_pass_cache_file.changed = true;
+	return NULL;
+}
+
+static void gpu_pass_cache_file_store(uint64_t hash, GPUShader *shader,
+                                      const char *vertexcode, const char *fragmentcode)
+{
+	GPUPassCacheFileEntry *entry;
+	void *binary;
+	unsigned int format;
+	int size;
+
+	binary = GPU_shader_get_binary(shader, &size, &format);
+	if (!binary)
+		return;
+
+	entry = MEM_callocN(sizeof(GPUPassCacheFileEntry), "GPUPassCacheFileEntry");
+	entry->hash = hash;
+	entry->format = format;
+	entry->size = size;
+	entry->binary = binary;
+	entry->vertexcode = BLI_strdup(vertexcode);
+	entry->fragmentcode = BLI_strdup(fragmentcode);
+
+	BLI_ghash_reinsert(gpu_pass_cache_file.entries, &entry->hash, entry, NULL, gpu_pass_cache_file_entry_free);
+	gpu_pass_cache_file.changed = true;
+}
+
+void GPU_pass_cache_stats(GPUPassCacheStats *r_stats)
+{
+	*r_stats = gpu_pass_cache_stats;
+	r_stats->num_shaders = (gpu_pass_cache) ? BLI_ghash_size(gpu_pass_cache) : 0;
+	r_stats->num_file_entries = (gpu_pass_cache_file.entries) ? BLI_ghash_size(gpu_pass_cache_file.entries) : 0;
+}
+
 GPUPass *GPU_generate_pass(
         ListBase *nodes, GPUNodeLink *outlink,
         GPUVertexAttribs *attribs, int *builtins,
@@ -1725,9 +2173,12 @@ GPUPass *GPU_generate_pass(
 		const bool use_instancing,
         const bool use_new_shading)
 {
+	GPUPassCacheEntry *entry;
 	GPUShader *shader;
 	GPUPass *pass;
 	char *vertexcode, *geometrycode, *fragmentcode;
+	uint64_t hash;
+	double time;
 
 #if 0
 	if (!FUNCTION_LIB) {
@@ -1736,6 +2187,8 @@ GPUPass *GPU_generate_pass(
 	}
 #endif
 
+	time = PIL_check_seconds_timer();
+
 	/* prune unused nodes */
 	gpu_nodes_prune(nodes, outlink);
 
@@ -1757,36 +2210,82 @@ GPUPass *GPU_generate_pass(
 	if (use_instancing) {
 		flags |= GPU_SHADER_FLAGS_SPECIAL_INSTANCING;
 	}
-	shader = GPU_shader_create_ex(vertexcode,
-	                              fragmentcode,
-	                              geometrycode,
-	                              glsl_material_library,
-	                              NULL,
-	                              0,
-	                              0,
-	                              0,
-	                              flags);
-
-	/* failed? */
-	if (!shader) {
-		if (fragmentcode)
-			MEM_freeN(fragmentcode);
-		if (vertexcode)
-			MEM_freeN(vertexcode);
-		memset(attribs, 0, sizeof(*attribs));
-		memset(builtins, 0, sizeof(*builtins));
-		gpu_nodes_free(nodes);
-		return NULL;
+
+	hash = gpu_pass_hash(vertexcode, geometrycode, fragmentcode, attribs, flags);
+
+	gpu_pass_cache_stats.num_generated++;
+	gpu_pass_cache_stats.generate_time += PIL_check_seconds_timer() - time;
+
+	/* share the shader of an identical pass */
+	entry = gpu_pass_cache_lookup(hash, vertexcode, geometrycode, fragmentcode);
+	if (entry) {
+		MEM_freeN(fragmentcode);
+		MEM_freeN(vertexcode);
+		if (geometrycode)
+			MEM_freeN(geometrycode);
+
+		entry->users++;
+		gpu_pass_cache_stats.num_shared++;
 	}
-	
+	else {
+		/* the cache file doesn't support geometry shaders, they need extra program parameters */
+		const bool use_cache_file = (gpu_pass_cache_file.entries && !geometrycode);
+
+		time = PIL_check_seconds_timer();
+
+		shader = (use_cache_file) ? gpu_pass_cache_file_load(hash, vertexcode, fragmentcode) : NULL;
+		if (shader) {
+			gpu_pass_cache_stats.num_loaded++;
+		}
+		else {
+			if (use_cache_file)
+				flags |= GPU_SHADER_FLAGS_BINARY_RETRIEVABLE;
+
+			shader = GPU_shader_create_ex(vertexcode,
+			                              fragmentcode,
+			                              geometrycode,
+			                              glsl_material_library,
+			                              NULL,
+			                              0,
+			                              0,
+			                              0,
+			                              flags);
+
+			if (shader) {
+				gpu_pass_cache_stats.num_compiled++;
+				if (use_cache_file)
+					gpu_pass_cache_file_store(hash, shader, vertexcode, fragmentcode);
+			}
+		}
+
+		gpu_pass_cache_stats.compile_time += PIL_check_seconds_timer() - time;
+
+		/* failed? */
+		if (!shader) {
+			if (fragmentcode)
+				MEM_freeN(fragmentcode);
+			if (vertexcode)
+				MEM_freeN(vertexcode);
+			if (geometrycode)
+				MEM_freeN(geometrycode);
+			memset(attribs, 0, sizeof(*attribs));
+			memset(builtins, 0, sizeof(*builtins));
+			gpu_nodes_free(nodes);
+			return NULL;
+		}
+
+		entry = gpu_pass_cache_add(hash, shader, vertexcode, geometrycode, fragmentcode);
+	}
+
 	/* create pass */
 	pass = MEM_callocN(sizeof(GPUPass), "GPUPass");
 
 	pass->output = outlink->output;
-	pass->shader = shader;
-	pass->fragmentcode = fragmentcode;
-	pass->geometrycode = geometrycode;
-	pass->vertexcode = vertexcode;
+	pass->cache_entry = entry;
+	pass->shader = entry->shader;
+	pass->fragmentcode = entry->fragmentcode;
+	pass->geometrycode = entry->geometrycode;
+	pass->vertexcode = entry->vertexcode;
 	pass->libcode = glsl_material_library;
 
 	/* extract dynamic inputs and throw away nodes */
@@ -1798,14 +2297,8 @@ GPUPass *GPU_generate_pass(
 
 void GPU_pass_free(GPUPass *pass)
 {
-	GPU_shader_free(pass->shader);
+	gpu_pass_cache_release(pass->cache_entry);
 	gpu_inputs_free(&pass->inputs);
-	if (pass->fragmentcode)
-		MEM_freeN(pass->fragmentcode);
-	if (pass->geometrycode)
-		MEM_freeN(pass->geometrycode);
-	if (pass->vertexcode)
-		MEM_freeN(pass->vertexcode);
 	MEM_freeN(pass);
 }
 
@@ -162,10 +162,12 @@ struct GPUPass {
 
 	ListBase inputs;
 	struct GPUOutput *output;
+	/* shared by the passes with the same code */
+	struct GPUPassCacheEntry *cache_entry;
 	struct GPUShader *shader;
-	char *fragmentcode;
-	char *geometrycode;
-	char *vertexcode;
+	const char *fragmentcode;
+	const char *geometrycode;
+	const char *vertexcode;
 	const char *libcode;
 };
 
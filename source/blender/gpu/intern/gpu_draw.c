@@ -498,6 +498,19 @@ int GPU_verify_image(
 	if (ima == NULL || ima->ok == 0)
 		return 0;
 
+	/* a streamed texture is complete without the image buffer, acquiring it
+	 * would load the whole image again on the main thread */
+	if ((ima->tpageflag & IMA_GLBIND_IS_STREAMED) && !GTS.tilemode) {
+		bind = gpu_get_image_bindcode(ima, textarget);
+
+		if (*bind != 0) {
+			/* the texture is in use, like when acquiring the image buffer */
+			BKE_image_tag_time(ima);
+			glBindTexture(textarget, *bind);
+			return *bind;
+		}
+	}
+
 	/* check if we have a valid image buffer */
 	ImBuf *ibuf = BKE_image_acquire_ibuf(ima, iuser, NULL);
 
@@ -725,6 +738,24 @@ static void gpu_del_cube_map(void **cube_map)
 	MEM_freeN(cube_map);
 }
 
+/* Size of the 2D texture created for an image, the image is scaled if not a power of two.
+ * This is not strictly necessary for newer GPUs (OpenGL version >= 2.0) since they support
+ * non-power-of-two-textures, then don't bother scaling for hardware that supports NPOT textures!
+ * It doesn't use OpenGL and can be called from any thread. */
+void GPU_get_gl_tex_size(int rectw, int recth, int *r_texw, int *r_texh)
+{
+	if ((!GPU_full_non_power_of_two_support() && !is_power_of_2_resolution(rectw, recth)) ||
+	    is_over_resolution_limit(GL_TEXTURE_2D, rectw, recth))
+	{
+		*r_texw = smaller_power_of_2_limit(rectw);
+		*r_texh = smaller_power_of_2_limit(recth);
+	}
+	else {
+		*r_texw = rectw;
+		*r_texh = recth;
+	}
+}
+
 /* Image *ima can be NULL */
 void GPU_create_gl_tex(
         unsigned int *bind, unsigned int *rect, float *frect, int rectw, int recth,
@@ -735,16 +766,11 @@ void GPU_create_gl_tex(
 	int tpx = rectw;
 	int tpy = recth;
 
-	/* scale if not a power of two. this is not strictly necessary for newer
-	 * GPUs (OpenGL version >= 2.0) since they support non-power-of-two-textures 
-	 * Then don't bother scaling for hardware that supports NPOT textures! */
-	if (textarget == GL_TEXTURE_2D &&
-	    ((!GPU_full_non_power_of_two_support() && !is_power_of_2_resolution(rectw, recth)) ||
-	     is_over_resolution_limit(textarget, rectw, recth)))
-	{
-		rectw = smaller_power_of_2_limit(rectw);
-		recth = smaller_power_of_2_limit(recth);
+	if (textarget == GL_TEXTURE_2D) {
+		GPU_get_gl_tex_size(tpx, tpy, &rectw, &recth);
+	}
 
+	if (rectw != tpx || recth != tpy) {
 		if (use_high_bit_depth) {
 			ibuf = IMB_allocFromBuffer(NULL, frect, tpx, tpy);
 			IMB_scaleImBuf(ibuf, rectw, recth);
@@ -884,6 +910,83 @@ void GPU_create_gl_tex(
 		IMB_freeImBuf(ibuf);
 }
 
+/* Image texture streaming, the texture of an image is created with a single
+ * placeholder texel and its levels are uploaded later from the smallest one.
+ * The base level is lowered once a level is complete, so the texture always
+ * samples the finest level uploaded so far. Used by the game engine. */
+
+unsigned int GPU_stream_image_create(Image *ima)
+{
+	const unsigned char placeholder[4] = {128, 128, 128, 255};
+	unsigned int *bind = gpu_get_image_bindcode(ima, GL_TEXTURE_2D);
+
+	if (*bind == 0) {
+		glGenTextures(1, (GLuint *)bind);
+		glBindTexture(GL_TEXTURE_2D, *bind);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		ima->tpageflag &= ~IMA_GLBIND_IS_DATA;
+		ima->tpageflag |= IMA_GLBIND_IS_STREAMED;
+	}
+
+	return *bind;
+}
+
+/* Allocate all the levels of the streamed texture, levels is 1 without mipmaps.
+ * The placeholder is replaced, the smallest level must be uploaded before drawing. */
+void GPU_stream_image_allocate(Image *ima, int rectw, int recth, int levels)
+{
+	unsigned int bind = ima->bindcode[TEXTARGET_TEXTURE_2D];
+
+	glBindTexture(GL_TEXTURE_2D, bind);
+
+	for (int i = 0; i < levels; i++) {
+		glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, max_ii(rectw >> i, 1), max_ii(recth >> i, 1), 0,
+		             GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levels - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, gpu_get_mipmap_filter(1));
+
+	if (levels > 1) {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, gpu_get_mipmap_filter(0));
+		ima->tpageflag |= IMA_MIPMAP_COMPLETE;
+	}
+	else {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	}
+
+	if (GLEW_EXT_texture_filter_anisotropic)
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, GPU_get_anisotropic());
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (ima->gputexture[TEXTARGET_TEXTURE_2D]) {
+		GPU_texture_set_size(ima->gputexture[TEXTARGET_TEXTURE_2D], rectw, recth);
+	}
+}
+
+/* Upload the rows [y, y + numrows[ of a level, rect points to the first row to upload */
+void GPU_stream_image_upload(Image *ima, int level, int rectw, int y, int numrows, const unsigned int *rect)
+{
+	glBindTexture(GL_TEXTURE_2D, ima->bindcode[TEXTARGET_TEXTURE_2D]);
+	glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, rectw, numrows, GL_RGBA, GL_UNSIGNED_BYTE, rect);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+/* Use the levels from level once they are all uploaded */
+void GPU_stream_image_set_base_level(Image *ima, int level)
+{
+	glBindTexture(GL_TEXTURE_2D, ima->bindcode[TEXTARGET_TEXTURE_2D]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 /**
  * GPU_upload_dxt_texture() assumes that the texture is already bound and ready to go.
  * This is so the viewport and the BGE can share some code.
@@ -1410,7 +1513,7 @@ void GPU_free_image(Image *ima)
 		ima->repbind = NULL;
 	}
 
-	ima->tpageflag &= ~(IMA_MIPMAP_COMPLETE | IMA_GLBIND_IS_DATA);
+	ima->tpageflag &= ~(IMA_MIPMAP_COMPLETE | IMA_GLBIND_IS_DATA | IMA_GLBIND_IS_STREAMED);
 }
 
 void GPU_free_images(void)
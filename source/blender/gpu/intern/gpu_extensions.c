@@ -330,6 +330,17 @@ bool GPU_instanced_drawing_support(void)
 	return GLEW_VERSION_3_1 || GLEW_ARB_draw_instanced;
 }
 
+bool GPU_program_binary_support(void)
+{
+	/* the driver can expose the extension without any binary format */
+	if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+		GLint numformats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numformats);
+		return (numformats > 0);
+	}
+	return false;
+}
+
 int GPU_color_depth(void)
 {
 	return GG.colordepth;
@@ -450,6 +450,10 @@ GPUShader *GPU_shader_create_ex(const char *vertexcode,
 	}
 #endif
 
+	if ((flags & GPU_SHADER_FLAGS_BINARY_RETRIEVABLE) && GPU_program_binary_support()) {
+		glProgramParameteri(shader->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
 	glLinkProgram(shader->program);
 	glGetProgramiv(shader->program, GL_LINK_STATUS, &status);
 	if (!status) {
@@ -480,6 +484,62 @@ GPUShader *GPU_shader_create_ex(const char *vertexcode,
 	return shader;
 }
 
+/* Create a program from a binary of GPU_shader_get_binary, NULL when the driver
+ * rejects it, e.g. after a driver update. */
+GPUShader *GPU_shader_create_from_binary(const void *binary, int size, unsigned int format)
+{
+	GPUShader *shader;
+	GLint status;
+
+	if (!GPU_program_binary_support())
+		return NULL;
+
+	shader = MEM_callocN(sizeof(GPUShader), "GPUShader");
+	shader->program = glCreateProgram();
+
+	if (!shader->program) {
+		fprintf(stderr, "GPUShader, object creation failed.\n");
+		GPU_shader_free(shader);
+		return NULL;
+	}
+
+	glProgramBinary(shader->program, format, binary, size);
+	glGetProgramiv(shader->program, GL_LINK_STATUS, &status);
+	if (!status) {
+		GPU_shader_free(shader);
+		return NULL;
+	}
+
+	return shader;
+}
+
+/* Return the binary of a program created with GPU_SHADER_FLAGS_BINARY_RETRIEVABLE,
+ * or NULL if the driver doesn't provide it. */
+void *GPU_shader_get_binary(GPUShader *shader, int *r_size, unsigned int *r_format)
+{
+	GLint size = 0;
+	GLenum format;
+	void *binary;
+
+	if (!GPU_program_binary_support())
+		return NULL;
+
+	glGetProgramiv(shader->program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0)
+		return NULL;
+
+	binary = MEM_mallocN(size, "GPUShader binary");
+	glGetProgramBinary(shader->program, size, &size, &format, binary);
+	if (size <= 0) {
+		MEM_freeN(binary);
+		return NULL;
+	}
+
+	*r_size = size;
+	*r_format = format;
+	return binary;
+}
+
 char *GPU_shader_validate(GPUShader *shader)
 {
 	int stat = 0;
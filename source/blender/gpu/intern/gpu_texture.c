@@ -810,6 +810,12 @@ void GPU_texture_set_opengl_bindcode(GPUTexture *tex, int bindcode)
 	tex->bindcode = bindcode;
 }
 
+void GPU_texture_set_size(GPUTexture *tex, int w, int h)
+{
+	tex->w = w;
+	tex->h = h;
+}
+
 GPUFrameBuffer *GPU_texture_framebuffer(GPUTexture *tex)
 {
 	return tex->fb;
@@ -400,6 +400,14 @@ void IMB_scaleImBuf_threaded(struct ImBuf *ibuf, unsigned int newx, unsigned int
 short IMB_saveiff(struct ImBuf *ibuf, const char *filepath, int flags);
 struct ImBuf *IMB_prepare_write_ImBuf(const bool isfloat, struct ImBuf *ibuf);
 
+/**
+ * Write the image with IMB_saveiff in a thread, the queue owns the image.
+ *
+ * \attention Defined in writeimage.c
+ */
+void IMB_write_queue_push(struct ImBuf *ibuf, const char *filepath, int flags);
+int IMB_write_queue_wait(void);
+
 /**
  *
  * \attention Defined in util.c
@@ -60,6 +60,9 @@ void imb_filetypes_exit(void);
 void imb_tile_cache_init(void);
 void imb_tile_cache_exit(void);
 
+void imb_write_queue_init(void);
+void imb_write_queue_exit(void);
+
 void imb_loadtile(struct ImBuf *ibuf, int tx, int ty, unsigned int *rect);
 void imb_tile_cache_tile_free(struct ImBuf *ibuf, int tx, int ty);
 
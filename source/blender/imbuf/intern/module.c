@@ -40,11 +40,13 @@ void IMB_init(void)
 	imb_mmap_lock_init();
 	imb_filetypes_init();
 	imb_tile_cache_init();
+	imb_write_queue_init();
 	colormanagement_init();
 }
 
 void IMB_exit(void)
 {
+	imb_write_queue_exit();
 	imb_tile_cache_exit();
 	imb_filetypes_exit();
 	colormanagement_exit();
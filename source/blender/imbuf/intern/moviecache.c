@@ -425,15 +425,18 @@ ImBuf *IMB_moviecache_get(MovieCache *cache, void *userkey)
 	item = (MovieCacheItem *)BLI_ghash_lookup(cache->hash, &key);
 
 	if (item) {
-		if (item->ibuf) {
-			BLI_mutex_lock(&limitor_lock);
-			MEM_CacheLimiter_touch(item->c_handle);
-			BLI_mutex_unlock(&limitor_lock);
-
-			IMB_refImBuf(item->ibuf);
+		ImBuf *ibuf;
 
-			return item->ibuf;
+		/* the limiter may free the buffer from another thread */
+		BLI_mutex_lock(&limitor_lock);
+		ibuf = item->ibuf;
+		if (ibuf) {
+			MEM_CacheLimiter_touch(item->c_handle);
+			IMB_refImBuf(ibuf);
 		}
+		BLI_mutex_unlock(&limitor_lock);
+
+		return ibuf;
 	}
 
 	return NULL;
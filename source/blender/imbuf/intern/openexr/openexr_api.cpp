@@ -54,6 +54,7 @@
 #include <ImfCompressionAttribute.h>
 #include <ImfStringAttribute.h>
 #include <ImfStandardAttributes.h>
+#include <ImfThreading.h>
 
 /* multiview/multipart */
 #include <ImfMultiView.h>
@@ -108,6 +109,22 @@ extern "C" {
 using namespace Imf;
 using namespace Imath;
 
+/* Lines and tiles are compressed and decompressed by the global thread pool of OpenEXR,
+ * its size follows the thread count of Blender which can be set after the initialization
+ * (-t argument, render threads). Called before each file is read or written. */
+static ThreadMutex exr_thread_count_mutex = BLI_MUTEX_INITIALIZER;
+
+static void exr_update_thread_count(void)
+{
+	const int num_threads = BLI_system_thread_count();
+
+	BLI_mutex_lock(&exr_thread_count_mutex);
+	if (globalThreadCount() != num_threads) {
+		setGlobalThreadCount(num_threads);
+	}
+	BLI_mutex_unlock(&exr_thread_count_mutex);
+}
+
 extern "C"
 {
 /* prototype */
@@ -598,6 +615,8 @@ int imb_save_openexr(struct ImBuf *ibuf, const char *name, int flags)
 		return(0);
 	}
 
+	exr_update_thread_count();
+
 	if (ibuf->foptions.flag & OPENEXR_HALF)
 		return (int) imb_save_openexr_half(ibuf, name, flags, 1, NULL, NULL);
 	else {
@@ -621,6 +640,8 @@ static bool imb_save_openexr_multiview(
 		return false;
 	}
 
+	exr_update_thread_count();
+
 	if (ibuf->foptions.flag & OPENEXR_HALF)
 		return imb_save_openexr_half(ibuf, name, flags, totviews, getview, getbuffer);
 	else {
@@ -869,6 +890,8 @@ int IMB_exr_begin_write(void *handle, const char *filename, int width, int heigh
 	Header header(width, height);
 	ExrChannel *echan;
 
+	exr_update_thread_count();
+
 	data->width = width;
 	data->height = height;
 
@@ -919,6 +942,8 @@ void IMB_exrtile_begin_write(void *handle, const char *filename, int mipmap, int
 	std::vector<Header> headers;
 	ExrChannel *echan;
 
+	exr_update_thread_count();
+
 	data->tilex = tilex;
 	data->tiley = tiley;
 	data->width = width;
@@ -978,6 +1003,8 @@ int IMB_exr_begin_read(void *handle, const char *filename, int *width, int *heig
 	ExrHandle *data = (ExrHandle *)handle;
 	ExrChannel *echan;
 
+	exr_update_thread_count();
+
 	if (BLI_exists(filename) && BLI_file_size(filename) > 32) {   /* 32 is arbitrary, but zero length files crashes exr */
 		/* avoid crash/abort when we don't have permission to write here */
 		try {
@@ -1935,6 +1962,8 @@ struct ImBuf *imb_load_openexr(const unsigned char *mem, size_t size, int flags,
 
 	if (imb_is_a_openexr(mem) == 0) return(NULL);
 
+	exr_update_thread_count();
+
 	colorspace_set_default_role(colorspace, IM_MAX_SPACE, COLOR_ROLE_DEFAULT_FLOAT);
 
 	try
@@ -2103,9 +2132,7 @@ struct ImBuf *imb_load_openexr(const unsigned char *mem, size_t size, int flags,
 
 void imb_initopenexr(void)
 {
-	int num_threads = BLI_system_thread_count();
-
-	setGlobalThreadCount(num_threads);
+	exr_update_thread_count();
 }
 
 } // export "C"
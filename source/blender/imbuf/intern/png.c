@@ -32,10 +32,12 @@
  */
 
 #include "png.h"
+#include <zlib.h>
 
 #include "BLI_utildefines.h"
 #include "BLI_fileops.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "BKE_global.h"
 #include "BKE_idprop.h"
@@ -127,6 +129,276 @@ BLI_INLINE unsigned short ftoshort(float val)
 	return FTOUSHORT(val);
 }
 
+/* Parallel encoding
+ *
+ * The rows are filtered by threads, then the filtered data is split in chunks
+ * deflated by threads like pigz does: each chunk is primed with the end of the
+ * previous one and ends on a byte boundary with a sync flush, so the raw deflate
+ * streams are concatenated into the single zlib stream of the IDAT chunks. The
+ * chunk size doesn't depend on the number of threads, the file is the same on any
+ * machine. */
+
+/* Size of the filtered data deflated by a task. */
+#define PNG_DEFLATE_CHUNK_SIZE (256 * 1024)
+/* Rows filtered by a task. */
+#define PNG_FILTER_BLOCK_ROWS 32
+/* Size of the data of the IDAT chunks. */
+#define PNG_IDAT_SIZE (256 * 1024)
+/* Size of the deflate window, the dictionary of a chunk. */
+#define PNG_DEFLATE_WINDOW_SIZE 32768
+
+typedef struct PNGEncodeData {
+	png_bytepp row_pointers;
+	int height;
+	size_t rowbytes;
+	/* bytes per complete pixel, the distance used by the filters */
+	int bpp;
+	bool is_16bit;
+	bool use_filter;
+	int compression;
+
+	/* filter type byte and filtered row, of rowbytes + 1 */
+	unsigned char *filtered;
+	size_t filtered_size;
+
+	struct {
+		unsigned char *data;
+		size_t size;
+		unsigned long adler;
+		bool ok;
+	} *chunks;
+	int num_chunks;
+} PNGEncodeData;
+
+BLI_INLINE unsigned char png_paeth(int a, int b, int c)
+{
+	const int p = a + b - c;
+	const int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+
+	if (pa <= pb && pa <= pc)
+		return (unsigned char)a;
+	else if (pb <= pc)
+		return (unsigned char)b;
+	return (unsigned char)c;
+}
+
+/* Row as written in the file, the 16 bits samples are big endian. */
+static const unsigned char *png_encode_row(const PNGEncodeData *data, int y, unsigned char *buffer)
+{
+	const unsigned char *row = data->row_pointers[y];
+
+#ifdef __LITTLE_ENDIAN__
+	if (data->is_16bit) {
+		size_t i;
+		for (i = 0; i < data->rowbytes; i += 2) {
+			buffer[i] = row[i + 1];
+			buffer[i + 1] = row[i];
+		}
+		return buffer;
+	}
+#else
+	UNUSED_VARS(buffer);
+#endif
+
+	return row;
+}
+
+/* Filter a row with the type having the lowest sum of absolute differences,
+ * the heuristic of libpng. */
+static void png_filter_row(const PNGEncodeData *data, const unsigned char *row, const unsigned char *prev,
+                           unsigned char *candidates, unsigned char *r_filtered)
+{
+	const size_t rowbytes = data->rowbytes;
+	const int bpp = data->bpp;
+	unsigned long sum, best_sum = (unsigned long)-1;
+	int type, best_type = 0;
+	size_t i;
+
+	if (!data->use_filter) {
+		r_filtered[0] = 0;
+		memcpy(r_filtered + 1, row, rowbytes);
+		return;
+	}
+
+	for (type = 0; type < 5; type++) {
+		unsigned char *out = candidates + type * rowbytes;
+
+		for (i = 0; i < rowbytes; i++) {
+			const int a = (i >= (size_t)bpp) ? row[i - bpp] : 0;
+			const int b = (prev) ? prev[i] : 0;
+			const int c = (prev && i >= (size_t)bpp) ? prev[i - bpp] : 0;
+
+			switch (type) {
+				case 0: out[i] = row[i]; break;
+				case 1: out[i] = (unsigned char)(row[i] - a); break;
+				case 2: out[i] = (unsigned char)(row[i] - b); break;
+				case 3: out[i] = (unsigned char)(row[i] - ((a + b) >> 1)); break;
+				case 4: out[i] = (unsigned char)(row[i] - png_paeth(a, b, c)); break;
+			}
+		}
+
+		sum = 0;
+		for (i = 0; i < rowbytes; i++) {
+			sum += abs((signed char)out[i]);
+		}
+
+		if (sum < best_sum) {
+			best_sum = sum;
+			best_type = type;
+		}
+	}
+
+	r_filtered[0] = (unsigned char)best_type;
+	memcpy(r_filtered + 1, candidates + best_type * rowbytes, rowbytes);
+}
+
+static void png_filter_block(void *userdata, const int block)
+{
+	PNGEncodeData *data = userdata;
+	const size_t rowbytes = data->rowbytes;
+	const int ystart = block * PNG_FILTER_BLOCK_ROWS;
+	const int yend = min_ii(ystart + PNG_FILTER_BLOCK_ROWS, data->height);
+	unsigned char *buffer = MEM_mallocN(rowbytes * 7, "png filter buffer");
+	unsigned char *rowbuf[2] = {buffer, buffer + rowbytes};
+	unsigned char *candidates = buffer + 2 * rowbytes;
+	const unsigned char *prev = NULL;
+	int y;
+
+	if (ystart > 0)
+		prev = png_encode_row(data, ystart - 1, rowbuf[1]);
+
+	for (y = ystart; y < yend; y++) {
+		const unsigned char *row = png_encode_row(data, y, rowbuf[y & 1]);
+
+		png_filter_row(data, row, prev, candidates, data->filtered + (size_t)y * (rowbytes + 1));
+		prev = row;
+	}
+
+	MEM_freeN(buffer);
+}
+
+static void png_deflate_chunk(void *userdata, const int chunk)
+{
+	PNGEncodeData *data = userdata;
+	const size_t start = (size_t)chunk * PNG_DEFLATE_CHUNK_SIZE;
+	const size_t size = MIN2(PNG_DEFLATE_CHUNK_SIZE, data->filtered_size - start);
+	const bool is_last = (chunk == data->num_chunks - 1);
+	z_stream stream = {NULL};
+	size_t bound;
+
+	data->chunks[chunk].ok = false;
+
+	if (deflateInit2(&stream, data->compression, Z_DEFLATED, -15, 8, Z_FILTERED) != Z_OK)
+		return;
+
+	if (chunk > 0) {
+		const size_t dictsize = MIN2(start, PNG_DEFLATE_WINDOW_SIZE);
+		deflateSetDictionary(&stream, data->filtered + start - dictsize, (uInt)dictsize);
+	}
+
+	/* room for the sync flush marker */
+	bound = deflateBound(&stream, (uLong)size) + 16;
+	data->chunks[chunk].data = MEM_mallocN(bound, "png deflate chunk");
+
+	stream.next_in = data->filtered + start;
+	stream.avail_in = (uInt)size;
+	stream.next_out = data->chunks[chunk].data;
+	stream.avail_out = (uInt)bound;
+
+	if (deflate(&stream, is_last ? Z_FINISH : Z_SYNC_FLUSH) == (is_last ? Z_STREAM_END : Z_OK) &&
+	    stream.avail_in == 0 && stream.avail_out != 0)
+	{
+		data->chunks[chunk].size = bound - stream.avail_out;
+		data->chunks[chunk].adler = adler32(adler32(0, NULL, 0), data->filtered + start, (uInt)size);
+		data->chunks[chunk].ok = true;
+	}
+
+	deflateEnd(&stream);
+}
+
+static void png_write_idat(png_structp png_ptr, const unsigned char *data, size_t size)
+{
+	while (size > 0) {
+		const size_t len = MIN2(size, PNG_IDAT_SIZE);
+		png_write_chunk(png_ptr, (png_bytep)"IDAT", (png_bytep)data, len);
+		data += len;
+		size -= len;
+	}
+}
+
+/* Write the image data and the end of the file after png_write_info, false when
+ * the image is too small to be split or the compression failed, nothing is written
+ * then and the image is written by libpng. */
+static bool png_write_image_parallel(png_structp png_ptr, png_bytepp row_pointers, int width, int height,
+                                     int bytesperpixel, bool is_16bit, int compression)
+{
+	PNGEncodeData data = {NULL};
+	unsigned char header[2];
+	unsigned char trailer[4];
+	unsigned long adler;
+	bool ok = true;
+	int i;
+
+	data.row_pointers = row_pointers;
+	data.height = height;
+	data.bpp = bytesperpixel * (is_16bit ? 2 : 1);
+	data.rowbytes = (size_t)width * data.bpp;
+	data.is_16bit = is_16bit;
+	/* filtering doesn't help without compression */
+	data.use_filter = (compression > 0);
+	data.compression = compression;
+	data.filtered_size = (data.rowbytes + 1) * height;
+	data.num_chunks = (int)((data.filtered_size + PNG_DEFLATE_CHUNK_SIZE - 1) / PNG_DEFLATE_CHUNK_SIZE);
+
+	if (data.num_chunks < 2)
+		return false;
+
+	data.filtered = MEM_mallocN(data.filtered_size, "png filtered rows");
+	data.chunks = MEM_callocN(sizeof(*data.chunks) * data.num_chunks, "png deflate chunks");
+
+	BLI_task_parallel_range(0, (height + PNG_FILTER_BLOCK_ROWS - 1) / PNG_FILTER_BLOCK_ROWS,
+	                        &data, png_filter_block, true);
+	BLI_task_parallel_range(0, data.num_chunks, &data, png_deflate_chunk, true);
+
+	adler = adler32(0, NULL, 0);
+	for (i = 0; i < data.num_chunks; i++) {
+		const size_t start = (size_t)i * PNG_DEFLATE_CHUNK_SIZE;
+
+		ok &= data.chunks[i].ok;
+		adler = adler32_combine(adler, data.chunks[i].adler,
+		                        (z_off_t)MIN2(PNG_DEFLATE_CHUNK_SIZE, data.filtered_size - start));
+	}
+
+	if (ok) {
+		/* zlib header: deflate with a 32K window, the level and the check bits */
+		const int level = (compression < 2) ? 0 : (compression < 6) ? 1 : (compression == 6) ? 2 : 3;
+		header[0] = 0x78;
+		header[1] = (unsigned char)(level << 6);
+		header[1] += 31 - ((header[0] << 8) + header[1]) % 31;
+
+		trailer[0] = (unsigned char)(adler >> 24);
+		trailer[1] = (unsigned char)(adler >> 16);
+		trailer[2] = (unsigned char)(adler >> 8);
+		trailer[3] = (unsigned char)adler;
+
+		png_write_idat(png_ptr, header, sizeof(header));
+		for (i = 0; i < data.num_chunks; i++) {
+			png_write_idat(png_ptr, data.chunks[i].data, data.chunks[i].size);
+		}
+		png_write_idat(png_ptr, trailer, sizeof(trailer));
+		png_write_chunk(png_ptr, (png_bytep)"IEND", NULL, 0);
+	}
+
+	for (i = 0; i < data.num_chunks; i++) {
+		if (data.chunks[i].data)
+			MEM_freeN(data.chunks[i].data);
+	}
+	MEM_freeN(data.chunks);
+	MEM_freeN(data.filtered);
+
+	return ok;
+}
+
 int imb_savepng(struct ImBuf *ibuf, const char *name, int flags)
 {
 	png_structp png_ptr;
@@ -472,11 +744,13 @@ int imb_savepng(struct ImBuf *ibuf, const char *name, int flags)
 		}
 	}
 
-	/* write out the entire image data in one call */
-	png_write_image(png_ptr, row_pointers);
+	if (!png_write_image_parallel(png_ptr, row_pointers, ibuf->x, ibuf->y, bytesperpixel, is_16bit, compression)) {
+		/* write out the entire image data in one call */
+		png_write_image(png_ptr, row_pointers);
 
-	/* write the additional chunks to the PNG file (not really needed) */
-	png_write_end(png_ptr, info_ptr);
+		/* write the additional chunks to the PNG file (not really needed) */
+		png_write_end(png_ptr, info_ptr);
+	}
 
 	/* clean up */
 	if (pixels)
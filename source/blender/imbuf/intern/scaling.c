@@ -44,6 +44,128 @@
 #include "IMB_filter.h"
 
 #include "BLI_sys_types.h" // for intptr_t support
+#include "BLI_task.h"
+
+#include <string.h>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+/* Images with fewer pixels are scaled by the calling thread only. */
+#define SCALE_THREADING_MIN_PIXELS (256 * 256)
+
+/* Four channels of a pixel. The operations are done per channel in the same order
+ * with and without SSE2, so both give the same result to the bit. */
+#ifdef __SSE2__
+
+typedef __m128 scale_v4;
+
+BLI_INLINE scale_v4 scale_v4_zero(void) { return _mm_setzero_ps(); }
+BLI_INLINE scale_v4 scale_v4_set1(float f) { return _mm_set1_ps(f); }
+BLI_INLINE scale_v4 scale_v4_load(const float *p) { return _mm_loadu_ps(p); }
+BLI_INLINE void scale_v4_store(float *p, scale_v4 a) { _mm_storeu_ps(p, a); }
+BLI_INLINE scale_v4 scale_v4_add(scale_v4 a, scale_v4 b) { return _mm_add_ps(a, b); }
+BLI_INLINE scale_v4 scale_v4_sub(scale_v4 a, scale_v4 b) { return _mm_sub_ps(a, b); }
+BLI_INLINE scale_v4 scale_v4_mul(scale_v4 a, scale_v4 b) { return _mm_mul_ps(a, b); }
+BLI_INLINE scale_v4 scale_v4_div(scale_v4 a, scale_v4 b) { return _mm_div_ps(a, b); }
+/* Flip the sign bit like the unary minus, a subtraction from zero would lose the sign of zero. */
+BLI_INLINE scale_v4 scale_v4_neg(scale_v4 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+
+BLI_INLINE scale_v4 scale_v4_load_uchar(const uchar *p)
+{
+	int i;
+	__m128i v;
+
+	memcpy(&i, p, sizeof(i));
+	v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(i), _mm_setzero_si128());
+	v = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+	return _mm_cvtepi32_ps(v);
+}
+
+/* Truncate to the low byte like a float to uchar cast. */
+BLI_INLINE void scale_v4_store_uchar(uchar *p, scale_v4 a)
+{
+	__m128i v = _mm_and_si128(_mm_cvttps_epi32(a), _mm_set1_epi32(0xff));
+	int i;
+
+	v = _mm_packs_epi32(v, v);
+	v = _mm_packus_epi16(v, v);
+	i = _mm_cvtsi128_si32(v);
+	memcpy(p, &i, sizeof(i));
+}
+
+#else  /* __SSE2__ */
+
+typedef struct scale_v4 {
+	float v[4];
+} scale_v4;
+
+BLI_INLINE scale_v4 scale_v4_zero(void)
+{
+	scale_v4 r = {{0.0f, 0.0f, 0.0f, 0.0f}};
+	return r;
+}
+
+BLI_INLINE scale_v4 scale_v4_set1(float f)
+{
+	scale_v4 r = {{f, f, f, f}};
+	return r;
+}
+
+BLI_INLINE scale_v4 scale_v4_load(const float *p)
+{
+	scale_v4 r = {{p[0], p[1], p[2], p[3]}};
+	return r;
+}
+
+BLI_INLINE void scale_v4_store(float *p, scale_v4 a)
+{
+	p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3];
+}
+
+BLI_INLINE scale_v4 scale_v4_add(scale_v4 a, scale_v4 b)
+{
+	scale_v4 r = {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}};
+	return r;
+}
+
+BLI_INLINE scale_v4 scale_v4_sub(scale_v4 a, scale_v4 b)
+{
+	scale_v4 r = {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}};
+	return r;
+}
+
+BLI_INLINE scale_v4 scale_v4_mul(scale_v4 a, scale_v4 b)
+{
+	scale_v4 r = {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}};
+	return r;
+}
+
+BLI_INLINE scale_v4 scale_v4_div(scale_v4 a, scale_v4 b)
+{
+	scale_v4 r = {{a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3]}};
+	return r;
+}
+
+BLI_INLINE scale_v4 scale_v4_neg(scale_v4 a)
+{
+	scale_v4 r = {{-a.v[0], -a.v[1], -a.v[2], -a.v[3]}};
+	return r;
+}
+
+BLI_INLINE scale_v4 scale_v4_load_uchar(const uchar *p)
+{
+	scale_v4 r = {{p[0], p[1], p[2], p[3]}};
+	return r;
+}
+
+BLI_INLINE void scale_v4_store_uchar(uchar *p, scale_v4 a)
+{
+	p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3];
+}
+
+#endif  /* __SSE2__ */
 
 /************************************************************************/
 /*								SCALING									*/
@@ -339,14 +461,76 @@ MINLINE void premul_ushort_to_straight_uchar(unsigned char *result, const unsign
 	}
 }
 
+typedef struct OneHalfThreadData {
+	const ImBuf *ibuf1;
+	ImBuf *ibuf2;
+	bool do_rect, do_float;
+} OneHalfThreadData;
+
+static void onehalf_row(void *userdata, const int y)
+{
+	const OneHalfThreadData *data = userdata;
+	const ImBuf *ibuf1 = data->ibuf1;
+	ImBuf *ibuf2 = data->ibuf2;
+	/* Two rows of the source per row, the last pixel of odd widths is skipped. */
+	const size_t row = (size_t)y * (ibuf1->x + 2 * ibuf2->x + (ibuf1->x & 1)) * 4;
+	int x;
+
+	if (data->do_rect) {
+		const unsigned char *cp1 = (unsigned char *) ibuf1->rect + row;
+		const unsigned char *cp2 = cp1 + (ibuf1->x << 2);
+		unsigned char *dest = (unsigned char *) ibuf2->rect + (size_t)y * ibuf2->x * 4;
+
+		for (x = ibuf2->x; x > 0; x--) {
+			unsigned short p1i[8], p2i[8], desti[4];
+
+			straight_uchar_to_premul_ushort(p1i, cp1);
+			straight_uchar_to_premul_ushort(p2i, cp2);
+			straight_uchar_to_premul_ushort(p1i + 4, cp1 + 4);
+			straight_uchar_to_premul_ushort(p2i + 4, cp2 + 4);
+
+			desti[0] = ((unsigned int) p1i[0] + p2i[0] + p1i[4] + p2i[4]) >> 2;
+			desti[1] = ((unsigned int) p1i[1] + p2i[1] + p1i[5] + p2i[5]) >> 2;
+			desti[2] = ((unsigned int) p1i[2] + p2i[2] + p1i[6] + p2i[6]) >> 2;
+			desti[3] = ((unsigned int) p1i[3] + p2i[3] + p1i[7] + p2i[7]) >> 2;
+
+			premul_ushort_to_straight_uchar(dest, desti);
+
+			cp1 += 8;
+			cp2 += 8;
+			dest += 4;
+		}
+	}
+
+	if (data->do_float) {
+		const float *p1f = ibuf1->rect_float + row;
+		const float *p2f = p1f + (ibuf1->x << 2);
+		float *destf = ibuf2->rect_float + (size_t)y * ibuf2->x * 4;
+		const scale_v4 quarter = scale_v4_set1(0.25f);
+
+		for (x = ibuf2->x; x > 0; x--) {
+			scale_v4 sum = scale_v4_add(scale_v4_load(p1f), scale_v4_load(p2f));
+			sum = scale_v4_add(sum, scale_v4_load(p1f + 4));
+			sum = scale_v4_add(sum, scale_v4_load(p2f + 4));
+			scale_v4_store(destf, scale_v4_mul(quarter, sum));
+			p1f += 8;
+			p2f += 8;
+			destf += 4;
+		}
+	}
+}
+
 /* result in ibuf2, scaling should be done correctly */
 void imb_onehalf_no_alloc(struct ImBuf *ibuf2, struct ImBuf *ibuf1)
 {
-	int x, y;
-	const short do_rect = (ibuf1->rect != NULL);
-	const short do_float = (ibuf1->rect_float != NULL) && (ibuf2->rect_float != NULL);
+	OneHalfThreadData data;
 
-	if (do_rect && (ibuf2->rect == NULL)) {
+	data.ibuf1 = ibuf1;
+	data.ibuf2 = ibuf2;
+	data.do_rect = (ibuf1->rect != NULL);
+	data.do_float = (ibuf1->rect_float != NULL) && (ibuf2->rect_float != NULL);
+
+	if (data.do_rect && (ibuf2->rect == NULL)) {
 		imb_addrectImBuf(ibuf2);
 	}
 
@@ -358,59 +542,9 @@ void imb_onehalf_no_alloc(struct ImBuf *ibuf2, struct ImBuf *ibuf1)
 		imb_half_x_no_alloc(ibuf2, ibuf1);
 		return;
 	}
-	
-	if (do_rect) {
-		unsigned char *cp1, *cp2, *dest;
-		
-		cp1 = (unsigned char *) ibuf1->rect;
-		dest = (unsigned char *) ibuf2->rect;
-		
-		for (y = ibuf2->y; y > 0; y--) {
-			cp2 = cp1 + (ibuf1->x << 2);
-			for (x = ibuf2->x; x > 0; x--) {
-				unsigned short p1i[8], p2i[8], desti[4];
-				
-				straight_uchar_to_premul_ushort(p1i, cp1);
-				straight_uchar_to_premul_ushort(p2i, cp2);
-				straight_uchar_to_premul_ushort(p1i + 4, cp1 + 4);
-				straight_uchar_to_premul_ushort(p2i + 4, cp2 + 4);
-				
-				desti[0] = ((unsigned int) p1i[0] + p2i[0] + p1i[4] + p2i[4]) >> 2;
-				desti[1] = ((unsigned int) p1i[1] + p2i[1] + p1i[5] + p2i[5]) >> 2;
-				desti[2] = ((unsigned int) p1i[2] + p2i[2] + p1i[6] + p2i[6]) >> 2;
-				desti[3] = ((unsigned int) p1i[3] + p2i[3] + p1i[7] + p2i[7]) >> 2;
-				
-				premul_ushort_to_straight_uchar(dest, desti);
-				
-				cp1 += 8;
-				cp2 += 8;
-				dest += 4;
-			}
-			cp1 = cp2;
-			if (ibuf1->x & 1) cp1 += 4;
-		}
-	}
-	
-	if (do_float) {
-		float *p1f, *p2f, *destf;
-		
-		p1f = ibuf1->rect_float;
-		destf = ibuf2->rect_float;
-		for (y = ibuf2->y; y > 0; y--) {
-			p2f = p1f + (ibuf1->x << 2);
-			for (x = ibuf2->x; x > 0; x--) {
-				destf[0] = 0.25f * (p1f[0] + p2f[0] + p1f[4] + p2f[4]);
-				destf[1] = 0.25f * (p1f[1] + p2f[1] + p1f[5] + p2f[5]);
-				destf[2] = 0.25f * (p1f[2] + p2f[2] + p1f[6] + p2f[6]);
-				destf[3] = 0.25f * (p1f[3] + p2f[3] + p1f[7] + p2f[7]);
-				p1f += 8;
-				p2f += 8;
-				destf += 4;
-			}
-			p1f = p2f;
-			if (ibuf1->x & 1) p1f += 4;
-		}
-	}
+
+	BLI_task_parallel_range(0, ibuf2->y, &data, onehalf_row,
+	                        ((size_t)ibuf2->x * ibuf2->y >= SCALE_THREADING_MIN_PIXELS));
 }
 
 ImBuf *IMB_onehalf(struct ImBuf *ibuf1)
@@ -881,607 +1015,347 @@ static bool q_scale_linear_interpolation(
 	return true;
 }
 
-static ImBuf *scaledownx(struct ImBuf *ibuf, int newx)
+/* The box filters below compute the same position along the scaled axis for every
+ * row (or column), the positions are computed once in a table of steps. The rows are
+ * then filtered independently, so they are split between threads. */
+
+typedef struct ScaleDownStep {
+	/* Weight of the last pixel of the previous step, removed from this one. */
+	float sample_start;
+	/* Weight of the pixel at 'end'. */
+	float sample;
+	/* Pixels added at full weight. */
+	int begin, end;
+} ScaleDownStep;
+
+typedef struct ScaleUpStep {
+	/* Interpolate between the pixels 'index' and 'index + 1'. */
+	int index;
+	float sample;
+} ScaleUpStep;
+
+typedef struct BoxScaleData {
+	const uchar *rect;
+	uchar *newrect;
+	const float *rectf;
+	float *newrectf;
+	/* Pixels per row of the source and the result. */
+	int width, newwidth;
+	float add;
+	const void *steps;
+} BoxScaleData;
+
+static ScaleDownStep *scaledown_steps(int size, int newsize, float add)
 {
-	const int do_rect = (ibuf->rect != NULL);
-	const int do_float = (ibuf->rect_float != NULL);
-	const size_t rect_size = ibuf->x * ibuf->y * 4;
-
-	uchar *rect, *_newrect, *newrect;
-	float *rectf, *_newrectf, *newrectf;
-	float sample, add, val[4], nval[4], valf[4], nvalf[4];
-	int x, y;
-
-	rectf = _newrectf = newrectf = NULL;
-	rect = _newrect = newrect = NULL;
-	nval[0] =  nval[1] = nval[2] = nval[3] = 0.0f;
-	nvalf[0] = nvalf[1] = nvalf[2] = nvalf[3] = 0.0f;
+	ScaleDownStep *steps = MEM_mallocN(sizeof(ScaleDownStep) * newsize, __func__);
+	float sample = 0.0f;
+	int pixel = 0;
+	int i;
 
-	if (!do_rect && !do_float) return (ibuf);
+	for (i = 0; i < newsize; i++) {
+		steps[i].sample_start = sample;
+		steps[i].begin = pixel;
 
-	if (do_rect) {
-		_newrect = MEM_mallocN(newx * ibuf->y * sizeof(uchar) * 4, "scaledownx");
-		if (_newrect == NULL) return(ibuf);
-	}
-	if (do_float) {
-		_newrectf = MEM_mallocN(newx * ibuf->y * sizeof(float) * 4, "scaledownxf");
-		if (_newrectf == NULL) {
-			if (_newrect) MEM_freeN(_newrect);
-			return(ibuf);
+		sample += add;
+		while (sample >= 1.0f) {
+			sample -= 1.0f;
+			pixel++;
 		}
+
+		steps[i].end = pixel;
+		steps[i].sample = sample;
+		pixel++;
+		sample -= 1.0f;
 	}
 
-	add = (ibuf->x - 0.01) / newx;
+	BLI_assert(pixel == size); /* see bug [#26502] */
+	UNUSED_VARS_NDEBUG(size);
 
-	if (do_rect) {
-		rect = (uchar *) ibuf->rect;
-		newrect = _newrect;
-	}
-	if (do_float) {
-		rectf = ibuf->rect_float;
-		newrectf = _newrectf;
-	}
-		
-	for (y = ibuf->y; y > 0; y--) {
-		sample = 0.0f;
-		val[0] =  val[1] = val[2] = val[3] = 0.0f;
-		valf[0] = valf[1] = valf[2] = valf[3] = 0.0f;
+	return steps;
+}
 
-		for (x = newx; x > 0; x--) {
-			if (do_rect) {
-				nval[0] = -val[0] * sample;
-				nval[1] = -val[1] * sample;
-				nval[2] = -val[2] * sample;
-				nval[3] = -val[3] * sample;
-			}
-			if (do_float) {
-				nvalf[0] = -valf[0] * sample;
-				nvalf[1] = -valf[1] * sample;
-				nvalf[2] = -valf[2] * sample;
-				nvalf[3] = -valf[3] * sample;
-			}
-			
-			sample += add;
-
-			while (sample >= 1.0f) {
-				sample -= 1.0f;
-				
-				if (do_rect) {
-					nval[0] += rect[0];
-					nval[1] += rect[1];
-					nval[2] += rect[2];
-					nval[3] += rect[3];
-					rect += 4;
-				}
-				if (do_float) {
-					nvalf[0] += rectf[0];
-					nvalf[1] += rectf[1];
-					nvalf[2] += rectf[2];
-					nvalf[3] += rectf[3];
-					rectf += 4;
-				}
-			}
-			
-			if (do_rect) {
-				val[0] = rect[0]; val[1] = rect[1]; val[2] = rect[2]; val[3] = rect[3];
-				rect += 4;
-				
-				newrect[0] = ((nval[0] + sample * val[0]) / add + 0.5f);
-				newrect[1] = ((nval[1] + sample * val[1]) / add + 0.5f);
-				newrect[2] = ((nval[2] + sample * val[2]) / add + 0.5f);
-				newrect[3] = ((nval[3] + sample * val[3]) / add + 0.5f);
-				
-				newrect += 4;
-			}
-			if (do_float) {
-				
-				valf[0] = rectf[0]; valf[1] = rectf[1]; valf[2] = rectf[2]; valf[3] = rectf[3];
-				rectf += 4;
-				
-				newrectf[0] = ((nvalf[0] + sample * valf[0]) / add);
-				newrectf[1] = ((nvalf[1] + sample * valf[1]) / add);
-				newrectf[2] = ((nvalf[2] + sample * valf[2]) / add);
-				newrectf[3] = ((nvalf[3] + sample * valf[3]) / add);
-				
-				newrectf += 4;
-			}
-			
+static ScaleUpStep *scaleup_steps(int newsize, float add)
+{
+	ScaleUpStep *steps = MEM_mallocN(sizeof(ScaleUpStep) * newsize, __func__);
+	float sample = 0.0f;
+	int pixel = 0;
+	int i;
+
+	for (i = 0; i < newsize; i++) {
+		if (sample >= 1.0f) {
 			sample -= 1.0f;
+			pixel++;
 		}
+		steps[i].index = pixel;
+		steps[i].sample = sample;
+		sample += add;
 	}
 
-	if (do_rect) {
-		// printf("%ld %ld\n", (uchar *)rect - ((uchar *)ibuf->rect), rect_size);
-		BLI_assert((uchar *)rect - ((uchar *)ibuf->rect) == rect_size); /* see bug [#26502] */
-		imb_freerectImBuf(ibuf);
-		ibuf->mall |= IB_rect;
-		ibuf->rect = (unsigned int *) _newrect;
-	}
-	if (do_float) {
-		// printf("%ld %ld\n", rectf - ibuf->rect_float, rect_size);
-		BLI_assert((rectf - ibuf->rect_float) == rect_size); /* see bug [#26502] */
-		imb_freerectfloatImBuf(ibuf);
-		ibuf->mall |= IB_rectfloat;
-		ibuf->rect_float = _newrectf;
-	}
-	(void)rect_size; /* UNUSED in release builds */
-	
-	ibuf->x = newx;
-	return(ibuf);
+	return steps;
 }
 
-
-static ImBuf *scaledowny(struct ImBuf *ibuf, int newy)
+/* Box filter of a pixel, the pixels are read from 'src' with a stride of 'skip'. */
+BLI_INLINE scale_v4 scaledown_pixel_uchar(const uchar *src, size_t skip, const ScaleDownStep *step, scale_v4 add)
 {
-	const int do_rect = (ibuf->rect != NULL);
-	const int do_float = (ibuf->rect_float != NULL);
-	const size_t rect_size = ibuf->x * ibuf->y * 4;
-
-	uchar *rect, *_newrect, *newrect;
-	float *rectf, *_newrectf, *newrectf;
-	float sample, add, val[4], nval[4], valf[4], nvalf[4];
-	int x, y, skipx;
+	const uchar *p = src + step->begin * skip;
+	scale_v4 nval = scale_v4_mul(scale_v4_neg((step->begin > 0) ? scale_v4_load_uchar(p - skip) : scale_v4_zero()),
+	                             scale_v4_set1(step->sample_start));
+	int i;
 
-	rectf = _newrectf = newrectf = NULL;
-	rect = _newrect = newrect = NULL;
-	nval[0] =  nval[1] = nval[2] = nval[3] = 0.0f;
-	nvalf[0] = nvalf[1] = nvalf[2] = nvalf[3] = 0.0f;
+	for (i = step->begin; i < step->end; i++, p += skip) {
+		nval = scale_v4_add(nval, scale_v4_load_uchar(p));
+	}
+	return scale_v4_div(scale_v4_add(nval, scale_v4_mul(scale_v4_set1(step->sample), scale_v4_load_uchar(p))), add);
+}
 
-	if (!do_rect && !do_float) return (ibuf);
+BLI_INLINE scale_v4 scaledown_pixel_float(const float *src, size_t skip, const ScaleDownStep *step, scale_v4 add)
+{
+	const float *p = src + step->begin * skip;
+	scale_v4 nval = scale_v4_mul(scale_v4_neg((step->begin > 0) ? scale_v4_load(p - skip) : scale_v4_zero()),
+	                             scale_v4_set1(step->sample_start));
+	int i;
 
-	if (do_rect) {
-		_newrect = MEM_mallocN(newy * ibuf->x * sizeof(uchar) * 4, "scaledowny");
-		if (_newrect == NULL) return(ibuf);
+	for (i = step->begin; i < step->end; i++, p += skip) {
+		nval = scale_v4_add(nval, scale_v4_load(p));
 	}
-	if (do_float) {
-		_newrectf = MEM_mallocN(newy * ibuf->x * sizeof(float) * 4, "scaledownyf");
-		if (_newrectf == NULL) {
-			if (_newrect) MEM_freeN(_newrect);
-			return(ibuf);
+	return scale_v4_div(scale_v4_add(nval, scale_v4_mul(scale_v4_set1(step->sample), scale_v4_load(p))), add);
+}
+
+static void scaledownx_row(void *userdata, const int y)
+{
+	const BoxScaleData *data = userdata;
+	const ScaleDownStep *steps = data->steps;
+	const scale_v4 add = scale_v4_set1(data->add);
+	const scale_v4 half = scale_v4_set1(0.5f);
+	int x;
+
+	if (data->newrect) {
+		const uchar *rect = data->rect + (size_t)y * data->width * 4;
+		uchar *newrect = data->newrect + (size_t)y * data->newwidth * 4;
+
+		for (x = 0; x < data->newwidth; x++, newrect += 4) {
+			const scale_v4 val = scaledown_pixel_uchar(rect, 4, &steps[x], add);
+			scale_v4_store_uchar(newrect, scale_v4_add(val, half));
 		}
 	}
+	if (data->newrectf) {
+		const float *rectf = data->rectf + (size_t)y * data->width * 4;
+		float *newrectf = data->newrectf + (size_t)y * data->newwidth * 4;
 
-	add = (ibuf->y - 0.01) / newy;
-	skipx = 4 * ibuf->x;
-
-	for (x = skipx - 4; x >= 0; x -= 4) {
-		if (do_rect) {
-			rect = ((uchar *) ibuf->rect) + x;
-			newrect = _newrect + x;
-		}
-		if (do_float) {
-			rectf = ibuf->rect_float + x;
-			newrectf = _newrectf + x;
+		for (x = 0; x < data->newwidth; x++, newrectf += 4) {
+			scale_v4_store(newrectf, scaledown_pixel_float(rectf, 4, &steps[x], add));
 		}
-		
-		sample = 0.0f;
-		val[0] =  val[1] = val[2] = val[3] = 0.0f;
-		valf[0] = valf[1] = valf[2] = valf[3] = 0.0f;
+	}
+}
 
-		for (y = newy; y > 0; y--) {
-			if (do_rect) {
-				nval[0] = -val[0] * sample;
-				nval[1] = -val[1] * sample;
-				nval[2] = -val[2] * sample;
-				nval[3] = -val[3] * sample;
-			}
-			if (do_float) {
-				nvalf[0] = -valf[0] * sample;
-				nvalf[1] = -valf[1] * sample;
-				nvalf[2] = -valf[2] * sample;
-				nvalf[3] = -valf[3] * sample;
-			}
-			
-			sample += add;
-
-			while (sample >= 1.0f) {
-				sample -= 1.0f;
-				
-				if (do_rect) {
-					nval[0] += rect[0];
-					nval[1] += rect[1];
-					nval[2] += rect[2];
-					nval[3] += rect[3];
-					rect += skipx;
-				}
-				if (do_float) {
-					nvalf[0] += rectf[0];
-					nvalf[1] += rectf[1];
-					nvalf[2] += rectf[2];
-					nvalf[3] += rectf[3];
-					rectf += skipx;
-				}
-			}
+static void scaledowny_row(void *userdata, const int y)
+{
+	const BoxScaleData *data = userdata;
+	const ScaleDownStep *step = &((const ScaleDownStep *)data->steps)[y];
+	const scale_v4 add = scale_v4_set1(data->add);
+	const scale_v4 half = scale_v4_set1(0.5f);
+	const size_t skip = (size_t)data->width * 4;
+	int x;
+
+	if (data->newrect) {
+		uchar *newrect = data->newrect + y * skip;
+
+		for (x = 0; x < data->width; x++, newrect += 4) {
+			const scale_v4 val = scaledown_pixel_uchar(data->rect + x * 4, skip, step, add);
+			scale_v4_store_uchar(newrect, scale_v4_add(val, half));
+		}
+	}
+	if (data->newrectf) {
+		float *newrectf = data->newrectf + y * skip;
 
-			if (do_rect) {
-				val[0] = rect[0]; val[1] = rect[1]; val[2] = rect[2]; val[3] = rect[3];
-				rect += skipx;
-				
-				newrect[0] = ((nval[0] + sample * val[0]) / add + 0.5f);
-				newrect[1] = ((nval[1] + sample * val[1]) / add + 0.5f);
-				newrect[2] = ((nval[2] + sample * val[2]) / add + 0.5f);
-				newrect[3] = ((nval[3] + sample * val[3]) / add + 0.5f);
-				
-				newrect += skipx;
-			}
-			if (do_float) {
-				
-				valf[0] = rectf[0]; valf[1] = rectf[1]; valf[2] = rectf[2]; valf[3] = rectf[3];
-				rectf += skipx;
-				
-				newrectf[0] = ((nvalf[0] + sample * valf[0]) / add);
-				newrectf[1] = ((nvalf[1] + sample * valf[1]) / add);
-				newrectf[2] = ((nvalf[2] + sample * valf[2]) / add);
-				newrectf[3] = ((nvalf[3] + sample * valf[3]) / add);
-				
-				newrectf += skipx;
-			}
-			
-			sample -= 1.0f;
+		for (x = 0; x < data->width; x++, newrectf += 4) {
+			scale_v4_store(newrectf, scaledown_pixel_float(data->rectf + x * 4, skip, step, add));
 		}
 	}
+}
 
-	if (do_rect) {
-		// printf("%ld %ld\n", (uchar *)rect - ((uchar *)ibuf->rect), rect_size);
-		BLI_assert((uchar *)rect - ((uchar *)ibuf->rect) == rect_size); /* see bug [#26502] */
-		imb_freerectImBuf(ibuf);
-		ibuf->mall |= IB_rect;
-		ibuf->rect = (unsigned int *) _newrect;
+static void scaleupx_row(void *userdata, const int y)
+{
+	const BoxScaleData *data = userdata;
+	const ScaleUpStep *steps = data->steps;
+	const scale_v4 half = scale_v4_set1(0.5f);
+	int x;
+
+	if (data->newrect) {
+		const uchar *rect = data->rect + (size_t)y * data->width * 4;
+		uchar *newrect = data->newrect + (size_t)y * data->newwidth * 4;
+
+		for (x = 0; x < data->newwidth; x++, newrect += 4) {
+			const uchar *p = rect + steps[x].index * 4;
+			const scale_v4 val = scale_v4_load_uchar(p);
+			const scale_v4 diff = scale_v4_sub(scale_v4_load_uchar(p + 4), val);
+			scale_v4_store_uchar(newrect, scale_v4_add(scale_v4_add(val, half),
+			                                           scale_v4_mul(scale_v4_set1(steps[x].sample), diff)));
+		}
 	}
-	if (do_float) {
-		// printf("%ld %ld\n", rectf - ibuf->rect_float, rect_size);
-		BLI_assert((rectf - ibuf->rect_float) == rect_size); /* see bug [#26502] */
-		imb_freerectfloatImBuf(ibuf);
-		ibuf->mall |= IB_rectfloat;
-		ibuf->rect_float = (float *) _newrectf;
+	if (data->newrectf) {
+		const float *rectf = data->rectf + (size_t)y * data->width * 4;
+		float *newrectf = data->newrectf + (size_t)y * data->newwidth * 4;
+
+		for (x = 0; x < data->newwidth; x++, newrectf += 4) {
+			const float *p = rectf + steps[x].index * 4;
+			const scale_v4 val = scale_v4_load(p);
+			const scale_v4 diff = scale_v4_sub(scale_v4_load(p + 4), val);
+			scale_v4_store(newrectf, scale_v4_add(val, scale_v4_mul(scale_v4_set1(steps[x].sample), diff)));
+		}
 	}
-	(void)rect_size; /* UNUSED in release builds */
-	
-	ibuf->y = newy;
-	return(ibuf);
 }
 
-
-static ImBuf *scaleupx(struct ImBuf *ibuf, int newx)
+static void scaleupy_row(void *userdata, const int y)
 {
-	uchar *rect, *_newrect = NULL, *newrect;
-	float *rectf, *_newrectf = NULL, *newrectf;
-	float sample, add;
-	float val_a, nval_a, diff_a;
-	float val_b, nval_b, diff_b;
-	float val_g, nval_g, diff_g;
-	float val_r, nval_r, diff_r;
-	float val_af, nval_af, diff_af;
-	float val_bf, nval_bf, diff_bf;
-	float val_gf, nval_gf, diff_gf;
-	float val_rf, nval_rf, diff_rf;
-	int x, y;
-	bool do_rect = false, do_float = false;
+	const BoxScaleData *data = userdata;
+	const ScaleUpStep *step = &((const ScaleUpStep *)data->steps)[y];
+	const scale_v4 sample = scale_v4_set1(step->sample);
+	const scale_v4 half = scale_v4_set1(0.5f);
+	const size_t skip = (size_t)data->width * 4;
+	int x;
+
+	if (data->newrect) {
+		const uchar *rect = data->rect + step->index * skip;
+		uchar *newrect = data->newrect + y * skip;
+
+		for (x = 0; x < data->width; x++, rect += 4, newrect += 4) {
+			const scale_v4 val = scale_v4_load_uchar(rect);
+			const scale_v4 diff = scale_v4_sub(scale_v4_load_uchar(rect + skip), val);
+			scale_v4_store_uchar(newrect, scale_v4_add(scale_v4_add(val, half), scale_v4_mul(sample, diff)));
+		}
+	}
+	if (data->newrectf) {
+		const float *rectf = data->rectf + step->index * skip;
+		float *newrectf = data->newrectf + y * skip;
+
+		for (x = 0; x < data->width; x++, rectf += 4, newrectf += 4) {
+			const scale_v4 val = scale_v4_load(rectf);
+			const scale_v4 diff = scale_v4_sub(scale_v4_load(rectf + skip), val);
+			scale_v4_store(newrectf, scale_v4_add(val, scale_v4_mul(sample, diff)));
+		}
+	}
+}
 
-	val_a = nval_a = diff_a = val_b = nval_b = diff_b = 0;
-	val_g = nval_g = diff_g = val_r = nval_r = diff_r = 0;
-	val_af = nval_af = diff_af = val_bf = nval_bf = diff_bf = 0;
-	val_gf = nval_gf = diff_gf = val_rf = nval_rf = diff_rf = 0;
-	if (ibuf == NULL) return(NULL);
-	if (ibuf->rect == NULL && ibuf->rect_float == NULL) return (ibuf);
+/* Allocate the result buffers, false when the allocation failed and the image is left unchanged. */
+static bool scale_alloc(ImBuf *ibuf, BoxScaleData *data, int newx, int newy, const char *name)
+{
+	memset(data, 0, sizeof(*data));
 
 	if (ibuf->rect) {
-		do_rect = true;
-		_newrect = MEM_mallocN(newx * ibuf->y * sizeof(int), "scaleupx");
-		if (_newrect == NULL) return(ibuf);
+		data->rect = (uchar *)ibuf->rect;
+		data->newrect = MEM_mallocN((size_t)newx * newy * sizeof(uchar) * 4, name);
+		if (data->newrect == NULL) {
+			return false;
+		}
 	}
 	if (ibuf->rect_float) {
-		do_float = true;
-		_newrectf = MEM_mallocN(newx * ibuf->y * sizeof(float) * 4, "scaleupxf");
-		if (_newrectf == NULL) {
-			if (_newrect) MEM_freeN(_newrect);
-			return(ibuf);
+		data->rectf = ibuf->rect_float;
+		data->newrectf = MEM_mallocN((size_t)newx * newy * sizeof(float) * 4, name);
+		if (data->newrectf == NULL) {
+			if (data->newrect) MEM_freeN(data->newrect);
+			return false;
 		}
 	}
 
-	add = (ibuf->x - 1.001) / (newx - 1.0);
-
-	rect = (uchar *) ibuf->rect;
-	rectf = (float *) ibuf->rect_float;
-	newrect = _newrect;
-	newrectf = _newrectf;
-
-	for (y = ibuf->y; y > 0; y--) {
-
-		sample = 0;
-		
-		if (do_rect) {
-			val_a = rect[0];
-			nval_a = rect[4];
-			diff_a = nval_a - val_a;
-			val_a += 0.5f;
-
-			val_b = rect[1];
-			nval_b = rect[5];
-			diff_b = nval_b - val_b;
-			val_b += 0.5f;
-
-			val_g = rect[2];
-			nval_g = rect[6];
-			diff_g = nval_g - val_g;
-			val_g += 0.5f;
-
-			val_r = rect[3];
-			nval_r = rect[7];
-			diff_r = nval_r - val_r;
-			val_r += 0.5f;
-
-			rect += 8;
-		}
-		if (do_float) {
-			val_af = rectf[0];
-			nval_af = rectf[4];
-			diff_af = nval_af - val_af;
-	
-			val_bf = rectf[1];
-			nval_bf = rectf[5];
-			diff_bf = nval_bf - val_bf;
+	return true;
+}
 
-			val_gf = rectf[2];
-			nval_gf = rectf[6];
-			diff_gf = nval_gf - val_gf;
+static void scale_run(ImBuf *ibuf, BoxScaleData *data, int newx, int newy, int numrows,
+                      TaskParallelRangeFunc func)
+{
+	const bool use_threading = ((size_t)newx * newy >= SCALE_THREADING_MIN_PIXELS);
 
-			val_rf = rectf[3];
-			nval_rf = rectf[7];
-			diff_rf = nval_rf - val_rf;
+	BLI_task_parallel_range(0, numrows, data, func, use_threading);
 
-			rectf += 8;
-		}
-		for (x = newx; x > 0; x--) {
-			if (sample >= 1.0f) {
-				sample -= 1.0f;
-
-				if (do_rect) {
-					val_a = nval_a;
-					nval_a = rect[0];
-					diff_a = nval_a - val_a;
-					val_a += 0.5f;
-
-					val_b = nval_b;
-					nval_b = rect[1];
-					diff_b = nval_b - val_b;
-					val_b += 0.5f;
-
-					val_g = nval_g;
-					nval_g = rect[2];
-					diff_g = nval_g - val_g;
-					val_g += 0.5f;
-
-					val_r = nval_r;
-					nval_r = rect[3];
-					diff_r = nval_r - val_r;
-					val_r += 0.5f;
-					rect += 4;
-				}
-				if (do_float) {
-					val_af = nval_af;
-					nval_af = rectf[0];
-					diff_af = nval_af - val_af;
-	
-					val_bf = nval_bf;
-					nval_bf = rectf[1];
-					diff_bf = nval_bf - val_bf;
-
-					val_gf = nval_gf;
-					nval_gf = rectf[2];
-					diff_gf = nval_gf - val_gf;
-
-					val_rf = nval_rf;
-					nval_rf = rectf[3];
-					diff_rf = nval_rf - val_rf;
-					rectf += 4;
-				}
-			}
-			if (do_rect) {
-				newrect[0] = val_a + sample * diff_a;
-				newrect[1] = val_b + sample * diff_b;
-				newrect[2] = val_g + sample * diff_g;
-				newrect[3] = val_r + sample * diff_r;
-				newrect += 4;
-			}
-			if (do_float) {
-				newrectf[0] = val_af + sample * diff_af;
-				newrectf[1] = val_bf + sample * diff_bf;
-				newrectf[2] = val_gf + sample * diff_gf;
-				newrectf[3] = val_rf + sample * diff_rf;
-				newrectf += 4;
-			}
-			sample += add;
-		}
-	}
-
-	if (do_rect) {
+	if (data->newrect) {
 		imb_freerectImBuf(ibuf);
 		ibuf->mall |= IB_rect;
-		ibuf->rect = (unsigned int *) _newrect;
+		ibuf->rect = (unsigned int *)data->newrect;
 	}
-	if (do_float) {
+	if (data->newrectf) {
 		imb_freerectfloatImBuf(ibuf);
 		ibuf->mall |= IB_rectfloat;
-		ibuf->rect_float = (float *) _newrectf;
+		ibuf->rect_float = data->newrectf;
 	}
-	
+
 	ibuf->x = newx;
+	ibuf->y = newy;
+}
+
+static ImBuf *scaledownx(struct ImBuf *ibuf, int newx)
+{
+	BoxScaleData data;
+	ScaleDownStep *steps;
+
+	if (ibuf->rect == NULL && ibuf->rect_float == NULL) return (ibuf);
+	if (!scale_alloc(ibuf, &data, newx, ibuf->y, "scaledownx")) return (ibuf);
+
+	data.width = ibuf->x;
+	data.newwidth = newx;
+	data.add = (ibuf->x - 0.01) / newx;
+	data.steps = steps = scaledown_steps(ibuf->x, newx, data.add);
+
+	scale_run(ibuf, &data, newx, ibuf->y, ibuf->y, scaledownx_row);
+
+	MEM_freeN(steps);
 	return(ibuf);
 }
 
-static ImBuf *scaleupy(struct ImBuf *ibuf, int newy)
+static ImBuf *scaledowny(struct ImBuf *ibuf, int newy)
 {
-	uchar *rect, *_newrect = NULL, *newrect;
-	float *rectf, *_newrectf = NULL, *newrectf;
-	float sample, add;
-	float val_a, nval_a, diff_a;
-	float val_b, nval_b, diff_b;
-	float val_g, nval_g, diff_g;
-	float val_r, nval_r, diff_r;
-	float val_af, nval_af, diff_af;
-	float val_bf, nval_bf, diff_bf;
-	float val_gf, nval_gf, diff_gf;
-	float val_rf, nval_rf, diff_rf;
-	int x, y, skipx;
-	bool do_rect = false, do_float = false;
-
-	val_a = nval_a = diff_a = val_b = nval_b = diff_b = 0;
-	val_g = nval_g = diff_g = val_r = nval_r = diff_r = 0;
-	val_af = nval_af = diff_af = val_bf = nval_bf = diff_bf = 0;
-	val_gf = nval_gf = diff_gf = val_rf = nval_rf = diff_rf = 0;
-	if (ibuf == NULL) return(NULL);
+	BoxScaleData data;
+	ScaleDownStep *steps;
+
 	if (ibuf->rect == NULL && ibuf->rect_float == NULL) return (ibuf);
+	if (!scale_alloc(ibuf, &data, ibuf->x, newy, "scaledowny")) return (ibuf);
 
-	if (ibuf->rect) {
-		do_rect = true;
-		_newrect = MEM_mallocN(ibuf->x * newy * sizeof(int), "scaleupy");
-		if (_newrect == NULL) return(ibuf);
-	}
-	if (ibuf->rect_float) {
-		do_float = true;
-		_newrectf = MEM_mallocN(ibuf->x * newy * sizeof(float) * 4, "scaleupyf");
-		if (_newrectf == NULL) {
-			if (_newrect) MEM_freeN(_newrect);
-			return(ibuf);
-		}
-	}
+	data.width = data.newwidth = ibuf->x;
+	data.add = (ibuf->y - 0.01) / newy;
+	data.steps = steps = scaledown_steps(ibuf->y, newy, data.add);
+
+	scale_run(ibuf, &data, ibuf->x, newy, newy, scaledowny_row);
+
+	MEM_freeN(steps);
+	return(ibuf);
+}
 
-	add = (ibuf->y - 1.001) / (newy - 1.0);
-	skipx = 4 * ibuf->x;
+static ImBuf *scaleupx(struct ImBuf *ibuf, int newx)
+{
+	BoxScaleData data;
+	ScaleUpStep *steps;
 
-	rect = (uchar *) ibuf->rect;
-	rectf = (float *) ibuf->rect_float;
-	newrect = _newrect;
-	newrectf = _newrectf;
+	if (ibuf == NULL) return(NULL);
+	if (ibuf->rect == NULL && ibuf->rect_float == NULL) return (ibuf);
+	if (!scale_alloc(ibuf, &data, newx, ibuf->y, "scaleupx")) return (ibuf);
 
-	for (x = ibuf->x; x > 0; x--) {
+	data.width = ibuf->x;
+	data.newwidth = newx;
+	data.add = (ibuf->x - 1.001) / (newx - 1.0);
+	data.steps = steps = scaleup_steps(newx, data.add);
 
-		sample = 0;
-		if (do_rect) {
-			rect = ((uchar *)ibuf->rect) + 4 * (x - 1);
-			newrect = _newrect + 4 * (x - 1);
-
-			val_a = rect[0];
-			nval_a = rect[skipx];
-			diff_a = nval_a - val_a;
-			val_a += 0.5f;
-
-			val_b = rect[1];
-			nval_b = rect[skipx + 1];
-			diff_b = nval_b - val_b;
-			val_b += 0.5f;
-
-			val_g = rect[2];
-			nval_g = rect[skipx + 2];
-			diff_g = nval_g - val_g;
-			val_g += 0.5f;
-
-			val_r = rect[3];
-			nval_r = rect[skipx + 3];
-			diff_r = nval_r - val_r;
-			val_r += 0.5f;
-
-			rect += 2 * skipx;
-		}
-		if (do_float) {
-			rectf = ibuf->rect_float + 4 * (x - 1);
-			newrectf = _newrectf + 4 * (x - 1);
+	scale_run(ibuf, &data, newx, ibuf->y, ibuf->y, scaleupx_row);
 
-			val_af = rectf[0];
-			nval_af = rectf[skipx];
-			diff_af = nval_af - val_af;
-	
-			val_bf = rectf[1];
-			nval_bf = rectf[skipx + 1];
-			diff_bf = nval_bf - val_bf;
+	MEM_freeN(steps);
+	return(ibuf);
+}
 
-			val_gf = rectf[2];
-			nval_gf = rectf[skipx + 2];
-			diff_gf = nval_gf - val_gf;
+static ImBuf *scaleupy(struct ImBuf *ibuf, int newy)
+{
+	BoxScaleData data;
+	ScaleUpStep *steps;
 
-			val_rf = rectf[3];
-			nval_rf = rectf[skipx + 3];
-			diff_rf = nval_rf - val_rf;
+	if (ibuf == NULL) return(NULL);
+	if (ibuf->rect == NULL && ibuf->rect_float == NULL) return (ibuf);
+	if (!scale_alloc(ibuf, &data, ibuf->x, newy, "scaleupy")) return (ibuf);
 
-			rectf += 2 * skipx;
-		}
-		
-		for (y = newy; y > 0; y--) {
-			if (sample >= 1.0f) {
-				sample -= 1.0f;
-
-				if (do_rect) {
-					val_a = nval_a;
-					nval_a = rect[0];
-					diff_a = nval_a - val_a;
-					val_a += 0.5f;
-
-					val_b = nval_b;
-					nval_b = rect[1];
-					diff_b = nval_b - val_b;
-					val_b += 0.5f;
-
-					val_g = nval_g;
-					nval_g = rect[2];
-					diff_g = nval_g - val_g;
-					val_g += 0.5f;
-
-					val_r = nval_r;
-					nval_r = rect[3];
-					diff_r = nval_r - val_r;
-					val_r += 0.5f;
-					rect += skipx;
-				}
-				if (do_float) {
-					val_af = nval_af;
-					nval_af = rectf[0];
-					diff_af = nval_af - val_af;
-	
-					val_bf = nval_bf;
-					nval_bf = rectf[1];
-					diff_bf = nval_bf - val_bf;
-
-					val_gf = nval_gf;
-					nval_gf = rectf[2];
-					diff_gf = nval_gf - val_gf;
-
-					val_rf = nval_rf;
-					nval_rf = rectf[3];
-					diff_rf = nval_rf - val_rf;
-					rectf += skipx;
-				}
-			}
-			if (do_rect) {
-				newrect[0] = val_a + sample * diff_a;
-				newrect[1] = val_b + sample * diff_b;
-				newrect[2] = val_g + sample * diff_g;
-				newrect[3] = val_r + sample * diff_r;
-				newrect += skipx;
-			}
-			if (do_float) {
-				newrectf[0] = val_af + sample * diff_af;
-				newrectf[1] = val_bf + sample * diff_bf;
-				newrectf[2] = val_gf + sample * diff_gf;
-				newrectf[3] = val_rf + sample * diff_rf;
-				newrectf += skipx;
-			}
-			sample += add;
-		}
-	}
+	data.width = data.newwidth = ibuf->x;
+	data.add = (ibuf->y - 1.001) / (newy - 1.0);
+	data.steps = steps = scaleup_steps(newy, data.add);
 
-	if (do_rect) {
-		imb_freerectImBuf(ibuf);
-		ibuf->mall |= IB_rect;
-		ibuf->rect = (unsigned int *) _newrect;
-	}
-	if (do_float) {
-		imb_freerectfloatImBuf(ibuf);
-		ibuf->mall |= IB_rectfloat;
-		ibuf->rect_float = (float *) _newrectf;
-	}
-	
-	ibuf->y = newy;
+	scale_run(ibuf, &data, ibuf->x, newy, newy, scaleupy_row);
+
+	MEM_freeN(steps);
 	return(ibuf);
 }
 
@@ -36,8 +36,13 @@
 #include <stdlib.h>
 #include <errno.h>
 
+#include "MEM_guardedalloc.h"
+
 #include "BLI_utildefines.h"
+#include "BLI_listbase.h"
 #include "BLI_path_util.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
 
 #include "IMB_imbuf_types.h"
 #include "IMB_imbuf.h"
@@ -99,3 +104,124 @@ ImBuf *IMB_prepare_write_ImBuf(const bool isfloat, ImBuf *ibuf)
 
 	return write_ibuf;
 }
+
+/* Write queue
+ *
+ * The images are written by a thread in the order they are pushed, so a renderer
+ * can go on with the next frame while the previous one is compressed and written.
+ * The number of images queued is limited, the caller waits for the oldest image to
+ * be written when the queue is full. */
+
+/* Images queued or being written. */
+#define WRITE_QUEUE_MAX_IMAGES 2
+
+typedef struct WriteQueueImage {
+	ImBuf *ibuf;
+	char filepath[FILE_MAX];
+	int flags;
+} WriteQueueImage;
+
+static struct {
+	ListBase threads;
+	/* created by the first push, under the mutex */
+	ThreadQueue *queue;
+	ThreadMutex mutex;
+	ThreadCondition cond;
+	/* images pushed and not yet written */
+	int num_pending;
+	/* images which couldn't be written since the last wait */
+	int num_failed;
+} write_queue = {{NULL}};
+
+static void *write_queue_thread(void *UNUSED(data))
+{
+	WriteQueueImage *image;
+
+	while ((image = BLI_thread_queue_pop(write_queue.queue))) {
+		const bool ok = (IMB_saveiff(image->ibuf, image->filepath, image->flags) != 0);
+
+		if (!ok) {
+			perror(image->filepath);
+		}
+
+		IMB_freeImBuf(image->ibuf);
+		MEM_freeN(image);
+
+		BLI_mutex_lock(&write_queue.mutex);
+		write_queue.num_pending--;
+		if (!ok) {
+			write_queue.num_failed++;
+		}
+		BLI_condition_notify_all(&write_queue.cond);
+		BLI_mutex_unlock(&write_queue.mutex);
+	}
+
+	return NULL;
+}
+
+void imb_write_queue_init(void)
+{
+	BLI_mutex_init(&write_queue.mutex);
+	BLI_condition_init(&write_queue.cond);
+}
+
+/* Push an image to write, the queue takes over the reference of the caller
+ * and the image must not be changed anymore. Can be called from any thread,
+ * render jobs push the frames from their own thread. */
+void IMB_write_queue_push(ImBuf *ibuf, const char *filepath, int flags)
+{
+	WriteQueueImage *image;
+
+	image = MEM_callocN(sizeof(WriteQueueImage), "WriteQueueImage");
+	image->ibuf = ibuf;
+	BLI_strncpy(image->filepath, filepath, sizeof(image->filepath));
+	image->flags = flags;
+
+	BLI_mutex_lock(&write_queue.mutex);
+	if (!write_queue.queue) {
+		write_queue.queue = BLI_thread_queue_init();
+		BLI_init_threads(&write_queue.threads, write_queue_thread, 1);
+		BLI_insert_thread(&write_queue.threads, NULL);
+	}
+	while (write_queue.num_pending >= WRITE_QUEUE_MAX_IMAGES) {
+		BLI_condition_wait(&write_queue.cond, &write_queue.mutex);
+	}
+	write_queue.num_pending++;
+	BLI_mutex_unlock(&write_queue.mutex);
+
+	BLI_thread_queue_push(write_queue.queue, image);
+}
+
+/* Wait for all the images pushed to be written.
+ * \return The number of images which couldn't be written since the last wait. */
+int IMB_write_queue_wait(void)
+{
+	int num_failed;
+
+	BLI_mutex_lock(&write_queue.mutex);
+	while (write_queue.num_pending > 0) {
+		BLI_condition_wait(&write_queue.cond, &write_queue.mutex);
+	}
+	num_failed = write_queue.num_failed;
+	write_queue.num_failed = 0;
+	BLI_mutex_unlock(&write_queue.mutex);
+
+	return num_failed;
+}
+
+void imb_write_queue_exit(void)
+{
+	if (write_queue.queue) {
+		IMB_write_queue_wait();
+
+		/* the thread returns once the queue is empty */
+		BLI_thread_queue_nowait(write_queue.queue);
+		BLI_end_threads(&write_queue.threads);
+
+		BLI_thread_queue_free(write_queue.queue);
+		write_queue.queue = NULL;
+	}
+
+	BLI_condition_end(&write_queue.cond);
+	BLI_mutex_end(&write_queue.mutex);
+}
@@ -192,6 +192,7 @@ enum {
 #define IMA_CLAMP_V			32
 #define IMA_TPAGE_REFRESH	64
 #define IMA_GLBIND_IS_DATA	128 /* opengl image texture bound as non-color data */
+#define IMA_GLBIND_IS_STREAMED	256 /* opengl image texture uploaded by GPU_stream_image_* */
 
 /* ima->type and ima->source moved to BKE_image.h, for API */
 
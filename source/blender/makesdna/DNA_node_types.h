@@ -371,7 +371,7 @@ typedef struct bNodeTree {
 	 * in case multiple different editors are used and make context ambiguous.
 	 */
 	bNodeInstanceKey active_viewer_key;
-	int pad;
+	int buffer_memory_limit;		/* compositor buffer memory in MB before buffers are written to disk, 0 for no limit */
 	
 	/* execution data */
 	/* XXX It would be preferable to completely move this data out of the underlying node tree,
@@ -410,6 +410,7 @@ typedef struct bNodeTree {
 #define NTREE_COM_GROUPNODE_BUFFER	8	/* use groupnode buffers */
 #define NTREE_VIEWER_BORDER			16	/* use a border for viewer nodes */
 #define NTREE_IS_LOCALIZED			32	/* tree is localized copy, free when deleting node groups */
+#define NTREE_COM_HALF_BUFFERS		64	/* store idle compositor buffers in half float */
 
 /* XXX not nice, but needed as a temporary flags
  * for group updates after library linking.
@@ -492,6 +493,12 @@ enum {
 	CMP_NODE_INPAINT_SIMPLE               = 0
 };
 
+/* bokeh blur node, custom2 */
+enum {
+	CMP_NODE_BOKEHBLUR_ACCURATE = 0,
+	CMP_NODE_BOKEHBLUR_FAST     = 1
+};
+
 enum {
 	CMP_NODEFLAG_MASK_AA          = (1 << 0),
 	CMP_NODEFLAG_MASK_NO_FEATHER  = (1 << 1),
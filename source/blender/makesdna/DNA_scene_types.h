@@ -909,6 +909,8 @@ typedef struct GameData {
 #define GAME_SHOW_ARMATURES					(1 << 19)
 #define GAME_PYTHON_CONSOLE					(1 << 20)
 #define GAME_GLSL_NO_ENV_LIGHTING			(1 << 21)
+#define GAME_USE_COOKED_CACHE				(1 << 22)
+#define GAME_USE_TEXTURE_STREAMING			(1 << 23)
 /* Note: GameData.flag is now an int (max 32 flags). A short could only take 16 flags */
 
 /* GameData.playerflag */
@@ -1736,6 +1738,7 @@ typedef struct Scene {
 #define R_VIEWPORT_PREVIEW	0x80000
 #define R_EXR_CACHE_FILE	0x100000
 #define R_MULTIVIEW			0x200000
+#define R_ASYNC_WRITE		0x400000  /* write the animation frames in a thread */
 
 /* r->stamp */
 #define R_STAMP_TIME 	0x0001
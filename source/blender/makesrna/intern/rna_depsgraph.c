@@ -40,17 +40,19 @@
 
 #ifdef RNA_RUNTIME
 
+#include "MEM_guardedalloc.h"
+
 #include "BKE_report.h"
 
 #include "DEG_depsgraph_debug.h"
 
-static void rna_Depsgraph_debug_graphviz(Depsgraph *graph, const char *filename)
+static void rna_Depsgraph_debug_graphviz(Depsgraph *graph, const char *filename, int show_costs)
 {
 	FILE *f = fopen(filename, "w");
 	if (f == NULL)
 		return;
 	
-	DEG_debug_graphviz(graph, f, "Depsgraph", false);
+	DEG_debug_graphviz(graph, f, "Depsgraph", show_costs != 0);
 	
 	fclose(f);
 }
@@ -79,6 +81,29 @@ static void rna_Depsgraph_debug_stats(Depsgraph *graph, ReportList *reports)
 	            ops, rels, outer);
 }
 
+static void rna_Depsgraph_debug_timing(Depsgraph *graph, ReportList *reports)
+{
+	DepsgraphStatsEval stats;
+	DepsgraphStatsOperation *operations;
+	int i, num_operations;
+
+	DEG_stats_eval(graph, &stats);
+	BKE_reportf(reports, RPT_INFO, "Last update %.3f ms, %d operations taking %.3f ms, critical path %.3f ms",
+	            stats.duration * 1000.0f, stats.num_operations,
+	            stats.duration_operations * 1000.0f, stats.critical_path * 1000.0f);
+
+	num_operations = DEG_stats_operations(graph, &operations);
+	for (i = 0; i < MIN2(num_operations, 10); i++) {
+		BKE_reportf(reports, RPT_INFO, "%s: %.3f ms average, %.3f ms last",
+		            operations[i].name,
+		            operations[i].duration_average * 1000.0f,
+		            operations[i].duration_last * 1000.0f);
+	}
+	if (operations) {
+		MEM_freeN(operations);
+	}
+}
+
 #else
 
 static void rna_def_depsgraph(BlenderRNA *brna)
@@ -94,6 +119,8 @@ static void rna_def_depsgraph(BlenderRNA *brna)
 	parm = RNA_def_string_file_path(func, "filename", NULL, FILE_MAX, "File Name",
 	                                "File in which to store graphviz debug output");
 	RNA_def_property_flag(parm, PROP_REQUIRED);
+	RNA_def_boolean(func, "show_costs", false, "Show Costs",
+	                "Color operations by their evaluation time and highlight the critical path");
 
 	func = RNA_def_function(srna, "debug_rebuild", "rna_Depsgraph_debug_rebuild");
 	RNA_def_function_flag(func, FUNC_USE_MAIN);
@@ -102,6 +129,10 @@ static void rna_def_depsgraph(BlenderRNA *brna)
 	func = RNA_def_function(srna, "debug_stats", "rna_Depsgraph_debug_stats");
 	RNA_def_function_ui_description(func, "Report the number of elements in the Dependency Graph");
 	RNA_def_function_flag(func, FUNC_USE_REPORTS);
+
+	func = RNA_def_function(srna, "debug_timing", "rna_Depsgraph_debug_timing");
+	RNA_def_function_ui_description(func, "Report the duration of the last update and its slowest operations");
+	RNA_def_function_flag(func, FUNC_USE_REPORTS);
 }
 
 void RNA_def_depsgraph(BlenderRNA *brna)
@@ -6217,6 +6217,20 @@ static void def_cmp_bokehblur(StructRNA *srna)
 {
 	PropertyRNA *prop;
 
+	static EnumPropertyItem method_items[] = {
+	    {CMP_NODE_BOKEHBLUR_ACCURATE, "ACCURATE", 0, "Accurate", "Sum the bokeh of every pixel in the blur radius"},
+	    {CMP_NODE_BOKEHBLUR_FAST,     "FAST",     0, "Fast",
+	     "Convolve in the frequency domain, or sum the bokeh of downscaled images for variable size, "
+	     "lower render quality downscales more"},
+	    {0, NULL, 0, NULL, NULL}
+	};
+
+	prop = RNA_def_property(srna, "method", PROP_ENUM, PROP_NONE);
+	RNA_def_property_enum_sdna(prop, NULL, "custom2");
+	RNA_def_property_enum_items(prop, method_items);
+	RNA_def_property_ui_text(prop, "Method", "Method to calculate the blur, fast is much faster for large blur sizes");
+	RNA_def_property_update(prop, NC_NODE | NA_EDITED, "rna_Node_update");
+
 	/* duplicated in def_cmp_blur */
 	prop = RNA_def_property(srna, "use_variable_size", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "custom1", CMP_NODEFLAG_BLUR_VARIABLE_SIZE);
@@ -8257,6 +8271,19 @@ static void rna_def_composite_nodetree(BlenderRNA *brna)
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_GROUPNODE_BUFFER);
 	RNA_def_property_ui_text(prop, "Buffer Groups", "Enable buffering of group nodes");
 
+	prop = RNA_def_property(srna, "use_half_buffers", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_HALF_BUFFERS);
+	RNA_def_property_ui_text(prop, "Half Float Buffers",
+	                         "Store color buffers waiting to be used in half float precision to save memory");
+
+	prop = RNA_def_property(srna, "buffer_memory_limit", PROP_INT, PROP_NONE);
+	RNA_def_property_int_sdna(prop, NULL, "buffer_memory_limit");
+	RNA_def_property_range(prop, 0, INT_MAX);
+	RNA_def_property_ui_range(prop, 0, 65536, 256, -1);
+	RNA_def_property_ui_text(prop, "Buffer Memory Limit",
+	                         "Maximum memory used by buffers in megabytes, least recently used buffers are written "
+	                         "to a temporary file when exceeded (0 for no limit)");
+
 	prop = RNA_def_property(srna, "use_two_pass", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_TWO_PASS);
 	RNA_def_property_ui_text(prop, "Two Pass", "Use two pass execution during editing: first calculate fast nodes, "
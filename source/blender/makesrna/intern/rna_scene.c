@@ -4697,6 +4697,18 @@ static void rna_def_scene_game_data(BlenderRNA *brna)
 	                         "Restrict the number of animation updates to the animation FPS (this is "
 	                         "better for performance, but can cause issues with smooth playback)");
 
+	prop = RNA_def_property(srna, "use_cooked_cache", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", GAME_USE_COOKED_CACHE);
+	RNA_def_property_ui_text(prop, "Cooked Data Cache",
+	                         "Save the converted meshes, physics shapes, navigation meshes and compiled material shaders "
+	                         "in files next to the blend file and reuse them when the game starts (faster loading)");
+
+	prop = RNA_def_property(srna, "use_texture_streaming", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", GAME_USE_TEXTURE_STREAMING);
+	RNA_def_property_ui_text(prop, "Texture Streaming",
+	                         "Load the image textures in the background and upload them progressively, "
+	                         "a placeholder is used until they are loaded (faster loading)");
+
 	prop = RNA_def_property(srna, "show_bounding_box", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", GAME_SHOW_BOUNDING_BOX);
 	RNA_def_property_ui_text(prop, "Show Bounding Box", "Show a visualization of bounding volume box");
@@ -6165,6 +6177,13 @@ static void rna_def_scene_render_data(BlenderRNA *brna)
 	RNA_def_property_boolean_negative_sdna(prop, NULL, "mode", R_NO_OVERWRITE);
 	RNA_def_property_ui_text(prop, "Overwrite", "Overwrite existing files while rendering");
 	RNA_def_property_update(prop, NC_SCENE | ND_RENDER_OPTIONS, NULL);
+
+	prop = RNA_def_property(srna, "use_async_write", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "scemode", R_ASYNC_WRITE);
+	RNA_def_property_ui_text(prop, "Background Saving",
+	                         "Save the animation frames in the background while the next frame renders "
+	                         "(render_write handlers may run before the file is complete)");
+	RNA_def_property_update(prop, NC_SCENE | ND_RENDER_OPTIONS, NULL);
 	
 	prop = RNA_def_property(srna, "use_compositing", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "scemode", R_DOCOMP);
@@ -269,6 +269,11 @@ void ntreeCompositTagRender(Scene *curscene)
 {
 	Scene *sce;
 
+#ifdef WITH_COMPOSITOR
+	/* render results changed, cached results of the previous render are not valid anymore */
+	COM_clearCaches();
+#endif
+
 	for (sce = G.main->scene.first; sce; sce = sce->id.next) {
 		if (sce->nodetree) {
 			bNode *node;
@@ -369,6 +374,10 @@ void ntreeCompositTagGenerators(bNodeTree *ntree)
 
 	if (ntree == NULL) return;
 
+#ifdef WITH_COMPOSITOR
+	COM_clearCaches();
+#endif
+
 	for (node = ntree->nodes.first; node; node = node->next) {
 		if (ELEM(node->type, CMP_NODE_R_LAYERS, CMP_NODE_IMAGE))
 			nodeUpdate(ntree, node);
@@ -213,13 +213,33 @@ static void render_print_save_message(
 	}
 }
 
+/* wait for the frames written in the background, see R_ASYNC_WRITE */
+static void render_write_queue_wait(Render *re)
+{
+	const int num_failed = IMB_write_queue_wait();
+
+	if (num_failed) {
+		BKE_reportf(re->reports, RPT_ERROR, "Render error, cannot save %d frame(s)", num_failed);
+	}
+}
+
 static int render_imbuf_write_stamp_test(
         ReportList *reports,
         Scene *scene, struct RenderResult *rr, ImBuf *ibuf, const char *name,
-        const ImageFormatData *imf, bool stamp)
+        const ImageFormatData *imf, bool stamp, bool use_async)
 {
 	int ok;
 
+	if (use_async) {
+		/* errors are reported once the queue is waited for */
+		if (stamp && (scene->r.stamp & R_STAMP_ALL))
+			BKE_imbuf_stamp_info(rr, ibuf);
+
+		BKE_imbuf_write_async(ibuf, name, imf);
+		printf("Saving: '%s'\n", name);
+		return true;
+	}
+
 	if (stamp) {
 		/* writes the name of the individual cameras */
 		ok = BKE_imbuf_write_stamp(scene, rr, ibuf, name, imf);
@@ -3273,7 +3293,8 @@ void RE_RenderFreestyleExternal(Render *re)
 }
 #endif
 
-bool RE_WriteRenderViewsImage(ReportList *reports, RenderResult *rr, Scene *scene, const bool stamp, char *name)
+static bool render_write_views_image(
+        ReportList *reports, RenderResult *rr, Scene *scene, const bool stamp, char *name, const bool use_async)
 {
 	bool is_mono;
 	bool ok = true;
@@ -3315,7 +3336,7 @@ bool RE_WriteRenderViewsImage(ReportList *reports, RenderResult *rr, Scene *scen
 				IMB_colormanagement_imbuf_for_write(ibuf, true, false, &scene->view_settings,
 				                                    &scene->display_settings, &rd->im_format);
 
-				ok = render_imbuf_write_stamp_test(reports, scene, rr, ibuf, name, &rd->im_format, stamp);
+				ok = render_imbuf_write_stamp_test(reports, scene, rr, ibuf, name, &rd->im_format, stamp, use_async);
 
 				/* optional preview images for exr */
 				if (ok && rd->im_format.imtype == R_IMF_IMTYPE_OPENEXR && (rd->im_format.flag & R_IMF_FLAG_PREVIEW_JPG)) {
@@ -3330,7 +3351,7 @@ bool RE_WriteRenderViewsImage(ReportList *reports, RenderResult *rr, Scene *scen
 					IMB_colormanagement_imbuf_for_write(ibuf, true, false, &scene->view_settings,
 					                                    &scene->display_settings, &imf);
 
-					ok = render_imbuf_write_stamp_test(reports, scene, rr, ibuf, name, &imf, stamp);
+					ok = render_imbuf_write_stamp_test(reports, scene, rr, ibuf, name, &imf, stamp, use_async);
 				}
 
 				/* imbuf knows which rects are not part of ibuf */
@@ -3359,7 +3380,7 @@ bool RE_WriteRenderViewsImage(ReportList *reports, RenderResult *rr, Scene *scen
 
 			ibuf_arr[2] = IMB_stereo3d_ImBuf(&scene->r.im_format, ibuf_arr[0], ibuf_arr[1]);
 
-			ok = render_imbuf_write_stamp_test(reports, scene, rr, ibuf_arr[2], name, &rd->im_format, stamp);
+			ok = render_imbuf_write_stamp_test(reports, scene, rr, ibuf_arr[2], name, &rd->im_format, stamp, use_async);
 
 			/* optional preview images for exr */
 			if (ok && rd->im_format.imtype == R_IMF_IMTYPE_OPENEXR &&
@@ -3377,7 +3398,7 @@ bool RE_WriteRenderViewsImage(ReportList *reports, RenderResult *rr, Scene *scen
 				IMB_colormanagement_imbuf_for_write(ibuf_arr[2], true, false, &scene->view_settings,
 				                                    &scene->display_settings, &imf);
 
-				ok = render_imbuf_write_stamp_test(reports, scene, rr, ibuf_arr[2], name, &rd->im_format, stamp);
+				ok = render_imbuf_write_stamp_test(reports, scene, rr, ibuf_arr[2], name, &rd->im_format, stamp, use_async);
 			}
 
 			/* imbuf knows which rects are not part of ibuf */
@@ -3390,6 +3411,11 @@ bool RE_WriteRenderViewsImage(ReportList *reports, RenderResult *rr, Scene *scen
 	return ok;
 }
 
+bool RE_WriteRenderViewsImage(ReportList *reports, RenderResult *rr, Scene *scene, const bool stamp, char *name)
+{
+	return render_write_views_image(reports, rr, scene, stamp, name, false);
+}
+
 bool RE_WriteRenderViewsMovie(
         ReportList *reports, RenderResult *rr, Scene *scene, RenderData *rd, bMovieHandle *mh,
         void **movie_ctx_arr, const int totvideos, bool preview)
@@ -3454,6 +3480,8 @@ static int do_write_image_or_movie(Render *re, Main *bmain, Scene *scene, bMovie
 	RenderResult rres;
 	double render_time;
 	bool ok = true;
+	/* animation frames can be written while the next one renders */
+	const bool use_async = (re->flag & R_ANIMATION) && (scene->r.scemode & R_ASYNC_WRITE);
 
 	RE_AcquireResultImageViews(re, &rres);
 
@@ -3470,7 +3498,7 @@ static int do_write_image_or_movie(Render *re, Main *bmain, Scene *scene, bMovie
 			        &scene->r.im_format, (scene->r.scemode & R_EXTENSION) != 0, true, NULL);
 
 		/* write images as individual images or stereo */
-		ok = RE_WriteRenderViewsImage(re->reports, &rres, scene, true, name);
+		ok = render_write_views_image(re->reports, &rres, scene, true, name, use_async);
 	}
 	
 	RE_ReleaseResultImageViews(re, &rres);
@@ -3740,6 +3768,9 @@ void RE_BlenderAnim(Render *re, Main *bmain, Scene *scene, Object *camera_overri
 				G.is_break = true;
 		
 			if (G.is_break == true) {
+				/* the placeholders of the frames being written aren't empty */
+				render_write_queue_wait(re);
+
 				/* remove touched file */
 				if (is_movie == false) {
 					if ((scene->r.mode & R_TOUCH)) {
@@ -3782,6 +3813,9 @@ void RE_BlenderAnim(Render *re, Main *bmain, Scene *scene, Object *camera_overri
 	if (is_movie) {
 		re_movie_free_all(re, mh, totvideos);
 	}
+	else {
+		render_write_queue_wait(re);
+	}
 	
 	if (totskipped && totrendered == 0)
 		BKE_report(re->reports, RPT_INFO, "No frames rendered, skipped to not overwrite");
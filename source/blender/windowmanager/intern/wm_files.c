@@ -115,6 +115,8 @@
 /* only to report a missing engine */
 #include "RE_engine.h"
 
+#include "COM_compositor.h"
+
 #ifdef WITH_PYTHON
 #include "BPY_extern.h"
 #endif
@@ -466,6 +468,11 @@ static void wm_file_read_post(bContext *C, bool is_startup_file)
 	ED_editors_init(C);
 	DAG_on_visible_update(CTX_data_main(C), true);
 
+#ifdef WITH_COMPOSITOR
+	/* cached compositor results belong to the previous file */
+	COM_clearCaches();
+#endif
+
 #ifdef WITH_PYTHON
 	if (is_startup_file) {
 		/* possible python hasn't been initialized */
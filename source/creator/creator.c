@@ -266,22 +266,31 @@ int main(
 
 	/* NOTE: Special exception for guarded allocator type switch:
 	 *       we need to perform switch from lock-free to fully
-	 *       guarded allocator before any allocation happened.
+	 *       guarded (or thread caching) allocator before any allocation happened.
 	 */
 	{
 		int i;
+		bool use_threadcache = false;
 		for (i = 0; i < argc; i++) {
 			if (STREQ(argv[i], "--debug") || STREQ(argv[i], "-d") ||
 			    STREQ(argv[i], "--debug-memory") || STREQ(argv[i], "--debug-all"))
 			{
 				printf("Switching to fully guarded memory allocator.\n");
 				MEM_use_guarded_allocator();
+				use_threadcache = false;
 				break;
 			}
+			else if (STREQ(argv[i], "--enable-threadcache-alloc")) {
+				use_threadcache = true;
+			}
 			else if (STREQ(argv[i], "--")) {
 				break;
 			}
 		}
+		if (use_threadcache) {
+			printf("Switching to thread caching memory allocator.\n");
+			MEM_use_threadcache_allocator();
+		}
 	}
 
 #ifdef BUILD_DATE
@@ -552,6 +552,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
 	BLI_argsPrintArgDoc(ba, "--debug-depsgraph-no-threads");
 
 	BLI_argsPrintArgDoc(ba, "--debug-gpumem");
+	BLI_argsPrintArgDoc(ba, "--debug-io");
 	BLI_argsPrintArgDoc(ba, "--debug-wm");
 	BLI_argsPrintArgDoc(ba, "--debug-all");
 
@@ -593,6 +594,7 @@ static int arg_handle_print_help(int UNUSED(argc), const char **UNUSED(argv), vo
 	printf("Experimental Features:\n");
 	BLI_argsPrintArgDoc(ba, "--enable-new-depsgraph");
 	BLI_argsPrintArgDoc(ba, "--enable-new-basic-shader-glsl");
+	BLI_argsPrintArgDoc(ba, "--enable-threadcache-alloc");
 
 	printf("\n");
 	printf("Argument Parsing:\n");
@@ -749,6 +751,8 @@ static const char arg_handle_debug_mode_generic_set_doc_depsgraph_no_threads[] =
 "\n\tSwitch dependency graph to a single threaded evaluation";
 static const char arg_handle_debug_mode_generic_set_doc_gpumem[] =
 "\n\tEnable GPU memory stats in status bar";
+static const char arg_handle_debug_mode_generic_set_doc_io[] =
+"\n\tEnable timings of the .blend file reading phases";
 
 static int arg_handle_debug_mode_generic_set(int UNUSED(argc), const char **UNUSED(argv), void *data)
 {
@@ -1186,6 +1190,15 @@ static int arg_handle_depsgraph_use_new(int UNUSED(argc), const char **UNUSED(ar
 	return 0;
 }
 
+static const char arg_handle_threadcache_alloc_use_doc[] =
+"\n\tUse memory allocator caching small blocks per thread (ignored with memory debugging)"
+;
+static int arg_handle_threadcache_alloc_use(int UNUSED(argc), const char **UNUSED(argv), void *UNUSED(data))
+{
+	/* Handled on startup, before any allocation in main(). */
+	return 0;
+}
+
 static const char arg_handle_basic_shader_glsl_use_new_doc[] =
 "\n\tUse new GLSL basic shader"
 ;
@@ -1828,9 +1841,12 @@ void main_args_setup(bContext *C, bArgs *ba, SYS_SystemHandle *syshandle)
 	            CB_EX(arg_handle_debug_mode_generic_set, depsgraph_no_threads), (void *)G_DEBUG_DEPSGRAPH_NO_THREADS);
 	BLI_argsAdd(ba, 1, NULL, "--debug-gpumem",
 	            CB_EX(arg_handle_debug_mode_generic_set, gpumem), (void *)G_DEBUG_GPU_MEM);
+	BLI_argsAdd(ba, 1, NULL, "--debug-io",
+	            CB_EX(arg_handle_debug_mode_generic_set, io), (void *)G_DEBUG_IO);
 
 	BLI_argsAdd(ba, 1, NULL, "--enable-new-depsgraph", CB(arg_handle_depsgraph_use_new), NULL);
 	BLI_argsAdd(ba, 1, NULL, "--enable-new-basic-shader-glsl", CB(arg_handle_basic_shader_glsl_use_new), NULL);
+	BLI_argsAdd(ba, 1, NULL, "--enable-threadcache-alloc", CB(arg_handle_threadcache_alloc_use), NULL);
 
 	BLI_argsAdd(ba, 1, NULL, "--verbose", CB(arg_handle_verbosity_set), NULL);
 
@@ -107,6 +107,7 @@
 
 #include "KX_KetsjiEngine.h"
 #include "KX_BlenderSceneConverter.h"
+#include "KX_CookedDataCache.h"
 
 #include "KX_Globals.h"
 #include "KX_PyConstraintBinding.h"
@@ -488,6 +489,294 @@ static RAS_MaterialBucket *material_from_mesh(Material *ma, MFace *mface, MTFace
 	return bucket;
 }
 
+/* Cooked meshes, the result of the conversion of a mesh is saved in the cooked data cache
+ * and replayed the next time the game starts without the tessellation and tangent computation. */
+
+/// Face in a cooked mesh, followed by its vertices.
+typedef struct CookedMeshFace {
+	int polyindex;
+	short matnr;
+	unsigned char numverts;
+	unsigned char flat;
+	/// Lines of a wire material, pair of vertex index in the face.
+	unsigned char numlines;
+	unsigned char lines[4][2];
+	unsigned char pad[3];
+} CookedMeshFace;
+
+/// Vertex in a cooked mesh, followed by its UVs.
+typedef struct CookedMeshVertex {
+	float xyz[3];
+	float normal[3];
+	float tangent[4];
+	unsigned int rgba;
+	unsigned int origindex;
+} CookedMeshVertex;
+
+static Material *mesh_face_material(Mesh *mesh, Object *blenderobj, int matnr)
+{
+	Material *ma;
+	if (blenderobj)
+		ma = give_current_material(blenderobj, matnr + 1);
+	else
+		ma = mesh->mat ? mesh->mat[matnr] : NULL;
+
+	// Check for blender material
+	if (ma == NULL) {
+		ma = &defmaterial;
+	}
+	return ma;
+}
+
+static void cooked_key_add_material(KX_CookedDataKey& key, Material *ma)
+{
+	if (!ma) {
+		ma = &defmaterial;
+	}
+	key.AddString(ma->id.name);
+	key.AddString(ma->id.lib ? ma->id.lib->name : "");
+	key.AddInt(ma->game.flag);
+	key.AddInt(ma->material_type);
+}
+
+/// Key of a converted mesh, depends on the mesh data and on the materials giving the buckets and polygon flags.
+static uint64_t cooked_mesh_key(Mesh *mesh, Object *blenderobj)
+{
+	KX_CookedDataKey key;
+	key.AddInt(KX_CookedDataCache::DATA_MESH);
+
+	// Only the data used by the conversion, selection flags don't change the key.
+	key.AddInt(mesh->totvert);
+	for (int i = 0; i < mesh->totvert; ++i) {
+		const MVert& mv = mesh->mvert[i];
+		key.Add(mv.co, sizeof(mv.co));
+		key.Add(mv.no, sizeof(mv.no));
+	}
+	key.AddInt(mesh->totedge);
+	for (int i = 0; i < mesh->totedge; ++i) {
+		key.AddInt(mesh->medge[i].v1);
+		key.AddInt(mesh->medge[i].v2);
+	}
+	key.AddInt(mesh->totpoly);
+	for (int i = 0; i < mesh->totpoly; ++i) {
+		const MPoly& mp = mesh->mpoly[i];
+		key.AddInt(mp.loopstart);
+		key.AddInt(mp.totloop);
+		key.AddInt(mp.mat_nr);
+		key.AddInt(mp.flag & ME_SMOOTH);
+	}
+	key.AddInt(mesh->totloop);
+	key.Add(mesh->mloop, sizeof(MLoop) * mesh->totloop);
+
+	for (int i = 0; i < mesh->ldata.totlayer; ++i) {
+		const CustomDataLayer& layer = mesh->ldata.layers[i];
+		if (layer.type == CD_MLOOPUV) {
+			key.AddInt(layer.type);
+			key.AddString(layer.name);
+			const MLoopUV *mloopuv = (const MLoopUV *)layer.data;
+			for (int j = 0; j < mesh->totloop; ++j) {
+				key.Add(mloopuv[j].uv, sizeof(mloopuv[j].uv));
+			}
+		}
+		else if (ELEM(layer.type, CD_MLOOPCOL, CD_CUSTOMLOOPNORMAL)) {
+			key.AddInt(layer.type);
+			key.AddString(layer.name);
+			key.Add(layer.data, CustomData_sizeof(layer.type) * mesh->totloop);
+		}
+	}
+	key.AddInt(CustomData_get_active_layer(&mesh->ldata, CD_MLOOPUV));
+	key.AddInt(CustomData_get_active_layer(&mesh->ldata, CD_MLOOPCOL));
+	key.AddInt(CustomData_has_layer(&mesh->pdata, CD_MTEXPOLY));
+
+	for (int i = 0; i < mesh->totcol; ++i) {
+		cooked_key_add_material(key, mesh->mat[i]);
+	}
+	if (blenderobj) {
+		const int totcol = max_ii(mesh->totcol, blenderobj->totcol);
+		key.AddInt(totcol);
+		for (int i = 0; i < totcol; ++i) {
+			cooked_key_add_material(key, give_current_material(blenderobj, i + 1));
+		}
+	}
+
+	return key.Get();
+}
+
+static void cooked_mesh_write_vertex(KX_CookedDataWriter& writer, const MT_Vector3& xyz, const MT_Vector2 *uvs, unsigned int uvsize,
+                                     const MT_Vector4& tangent, unsigned int rgba, const MT_Vector3& normal, unsigned int origindex)
+{
+	CookedMeshVertex vertex;
+	xyz.getValue(vertex.xyz);
+	normal.getValue(vertex.normal);
+	tangent.getValue(vertex.tangent);
+	vertex.rgba = rgba;
+	vertex.origindex = origindex;
+	writer.Write(vertex);
+
+	for (unsigned int i = 0; i < uvsize; ++i) {
+		float uv[2];
+		uvs[i].getValue(uv);
+		writer.Write(uv, sizeof(uv));
+	}
+}
+
+static void BL_EndMeshConversion(RAS_MeshObject *meshobj, Mesh *mesh, const STR_String uvsname[RAS_Texture::MaxUnits],
+                                 KX_Scene *scene, KX_BlenderSceneConverter *converter, bool libloading)
+{
+	// keep meshobj->m_sharedvertex_map for reinstance phys mesh.
+	// 2.49a and before it did: meshobj->m_sharedvertex_map.clear();
+	// but this didnt save much ram. - Campbell
+	meshobj->EndConversion();
+
+	// pre calculate texture generation
+	// However, we want to delay this if we're libloading so we can make sure we have the right scene.
+	if (!libloading) {
+		for (list<RAS_MeshMaterial>::iterator mit = meshobj->GetFirstMaterial();
+			mit != meshobj->GetLastMaterial(); ++ mit) {
+			mit->m_bucket->GetPolyMaterial()->OnConstruction();
+		}
+	}
+
+	// Find attributes layer (currently only UVs) by materials for this mesh.
+	meshobj->GenerateAttribLayers(uvsname);
+
+	converter->RegisterGameMesh(scene, meshobj, mesh);
+}
+
+/// Check the cooked data before any bucket is modified, return the number of faces or -1 if invalid.
+static int cooked_mesh_validate(Mesh *mesh, KX_CookedDataReader& reader, unsigned int& uvsize, STR_String uvsname[RAS_Texture::MaxUnits], bool& hastface)
+{
+	unsigned int numlayers, totvert, totface, tfaceflag;
+	if (!reader.Read(uvsize) || !reader.Read(numlayers) || uvsize < 1 || uvsize > RAS_Texture::MaxUnits ||
+	    numlayers > RAS_Texture::MaxUnits)
+	{
+		return -1;
+	}
+	for (unsigned int i = 0; i < numlayers; ++i) {
+		if (!reader.ReadString(uvsname[i])) {
+			return -1;
+		}
+	}
+	if (!reader.Read(tfaceflag) || !reader.Read(totvert) || !reader.Read(totface) || totvert != (unsigned int)mesh->totvert) {
+		return -1;
+	}
+	hastface = (tfaceflag != 0);
+
+	for (unsigned int f = 0; f < totface; ++f) {
+		const CookedMeshFace *face = (const CookedMeshFace *)reader.ReadData(sizeof(CookedMeshFace));
+		if (!face || face->matnr < 0 || !ELEM(face->numverts, 3, 4) || face->numlines > 4) {
+			return -1;
+		}
+		for (unsigned int i = 0; i < face->numlines; ++i) {
+			if (face->lines[i][0] >= face->numverts || face->lines[i][1] >= face->numverts) {
+				return -1;
+			}
+		}
+		for (unsigned int i = 0; i < face->numverts; ++i) {
+			const CookedMeshVertex *vertex = (const CookedMeshVertex *)reader.ReadData(sizeof(CookedMeshVertex));
+			if (!vertex || vertex->origindex >= totvert || !reader.ReadData(sizeof(float[2]) * uvsize)) {
+				return -1;
+			}
+		}
+	}
+
+	return reader.IsValid() ? (int)totface : -1;
+}
+
+/// Convert a mesh from its cooked data, return NULL if the data is invalid.
+static RAS_MeshObject *BL_ConvertCookedMesh(Mesh *mesh, Object *blenderobj, KX_Scene *scene, KX_BlenderSceneConverter *converter,
+                                            bool libloading, const void *data, size_t size)
+{
+	int lightlayer = blenderobj ? blenderobj->lay:(1<<20)-1; // all layers if no object.
+
+	unsigned int uvsize;
+	STR_String uvsname[RAS_Texture::MaxUnits];
+	bool hastface;
+	KX_CookedDataReader reader(data, size);
+	const int totface = cooked_mesh_validate(mesh, reader, uvsize, uvsname, hastface);
+	if (totface == -1) {
+		return NULL;
+	}
+
+	// Read again the data now it's known to be valid.
+	reader = KX_CookedDataReader(data, size);
+	unsigned int header[2];
+	reader.Read(header, sizeof(header));
+	for (unsigned int i = 0; i < header[1]; ++i) {
+		STR_String name;
+		reader.ReadString(name);
+	}
+	reader.ReadData(sizeof(unsigned int) * 3);
+
+	RAS_MeshObject *meshobj = new RAS_MeshObject(mesh);
+	meshobj->SetName(mesh->id.name + 2);
+	meshobj->m_sharedvertex_map.resize(mesh->totvert);
+
+	RAS_TexVertFormat vertformat;
+	vertformat.UVSize = uvsize;
+
+	// The face textures are only used when a material is created.
+	const MTexPoly *mtpoly = hastface ? (const MTexPoly *)CustomData_get_layer(&mesh->pdata, CD_MTEXPOLY) : NULL;
+
+	if (totface == 0) {
+		Material *ma = mesh->mat ? mesh->mat[0] : NULL;
+		// Check for blender material
+		if (!ma) {
+			ma = &defmaterial;
+		}
+
+		RAS_MaterialBucket *bucket = material_from_mesh(ma, NULL, NULL, NULL, NULL, lightlayer, NULL, NULL, "", scene, converter);
+		meshobj->AddMaterial(bucket, 0, vertformat);
+	}
+
+	MT_Vector2 uvs[RAS_ITexVert::MAX_UNIT];
+	for (unsigned int i = 0; i < RAS_ITexVert::MAX_UNIT; i++) {
+		uvs[i] = MT_Vector2(0.0f, 0.0f);
+	}
+
+	for (int f = 0; f < totface; ++f) {
+		const CookedMeshFace *face = (const CookedMeshFace *)reader.ReadData(sizeof(CookedMeshFace));
+		Material *ma = mesh_face_material(mesh, blenderobj, face->matnr);
+
+		MTFace mtface;
+		MTFace *tface = NULL;
+		if (mtpoly && face->polyindex >= 0 && face->polyindex < mesh->totpoly) {
+			memset(&mtface, 0, sizeof(mtface));
+			ME_MTEXFACE_CPY(&mtface, &mtpoly[face->polyindex]);
+			tface = &mtface;
+		}
+
+		RAS_MaterialBucket *bucket = material_from_mesh(ma, NULL, tface, NULL, NULL, lightlayer, NULL, NULL, "", scene, converter);
+		meshobj->AddMaterial(bucket, face->matnr, vertformat);
+
+		// set render flags
+		bool visible = ((ma->game.flag & GEMAT_INVISIBLE)==0);
+		bool twoside = ((ma->game.flag  & GEMAT_BACKCULL)==0);
+		bool collider = ((ma->game.flag & GEMAT_NOPHYSICS)==0);
+
+		unsigned int indices[4];
+		for (unsigned int i = 0; i < face->numverts; ++i) {
+			const CookedMeshVertex *vertex = (const CookedMeshVertex *)reader.ReadData(sizeof(CookedMeshVertex));
+			const float (*vertuvs)[2] = (const float (*)[2])reader.ReadData(sizeof(float[2]) * uvsize);
+			for (unsigned int j = 0; j < uvsize; ++j) {
+				uvs[j].setValue(vertuvs[j]);
+			}
+
+			indices[i] = meshobj->AddVertex(bucket, MT_Vector3(vertex->xyz), uvs, MT_Vector4(vertex->tangent), vertex->rgba,
+			                                MT_Vector3(vertex->normal), face->flat, vertex->origindex);
+		}
+
+		for (unsigned int i = 0; i < face->numlines; ++i) {
+			meshobj->AddLine(bucket, indices[face->lines[i][0]], indices[face->lines[i][1]]);
+		}
+		meshobj->AddPolygon(bucket, face->numverts, indices, visible, collider, twoside);
+	}
+
+	BL_EndMeshConversion(meshobj, mesh, uvsname, scene, converter, libloading);
+
+	return meshobj;
+}
+
 /* blenderobj can be NULL, make sure its checked for */
 RAS_MeshObject* BL_ConvertMesh(Mesh* mesh, Object* blenderobj, KX_Scene* scene, KX_BlenderSceneConverter *converter, bool libloading)
 {
@@ -504,6 +793,21 @@ RAS_MeshObject* BL_ConvertMesh(Mesh* mesh, Object* blenderobj, KX_Scene* scene,
 		}
 	}
 
+	KX_CookedDataCache *cookedcache = converter->GetCookedDataCache();
+	uint64_t cookedkey = 0;
+	if (cookedcache) {
+		cookedkey = cooked_mesh_key(mesh, blenderobj);
+		size_t cookedsize;
+		const void *cookeddata = cookedcache->Find(KX_CookedDataCache::DATA_MESH, cookedkey, cookedsize);
+		if (cookeddata) {
+			meshobj = BL_ConvertCookedMesh(mesh, blenderobj, scene, converter, libloading, cookeddata, cookedsize);
+			if (meshobj) {
+				meshobj->SetCookedKey(cookedkey);
+				return meshobj;
+			}
+		}
+	}
+
 	// Get DerivedMesh data
 	DerivedMesh *dm = CDDM_from_mesh(mesh);
 	DM_ensure_tessface(dm);
@@ -591,6 +895,18 @@ RAS_MeshObject* BL_ConvertMesh(Mesh* mesh, Object* blenderobj, KX_Scene* scene,
 		uvs[0][i] = uvs[1][i] = uvs[2][i] = uvs[3][i] = MT_Vector2(0.f, 0.f);
 	}
 
+	// The conversion is recorded to be replayed from the cooked data cache.
+	KX_CookedDataWriter cookedwriter;
+	if (cookedcache) {
+		const unsigned int header[2] = {vertformat.UVSize, (unsigned int)validLayers};
+		cookedwriter.Write(header, sizeof(header));
+		for (int lay = 0; lay < validLayers; ++lay) {
+			cookedwriter.WriteString(layers[lay].name);
+		}
+		const unsigned int sizes[3] = {(tface != NULL), (unsigned int)totvert, (unsigned int)totface};
+		cookedwriter.Write(sizes, sizeof(sizes));
+	}
+
 	if (totface == 0) {
 		ma = mesh->mat ? mesh->mat[0] : NULL;
 		// Check for blender material
@@ -679,6 +995,15 @@ RAS_MeshObject* BL_ConvertMesh(Mesh* mesh, Object* blenderobj, KX_Scene* scene,
 				indices[3] = meshobj->AddVertex(bucket, pt[3], uvs[3], tan[3], rgb[3], no[3], flat, mface->v4);
 			}
 
+			CookedMeshFace cookedface;
+			if (cookedcache) {
+				memset(&cookedface, 0, sizeof(cookedface));
+				cookedface.polyindex = mfaceTompoly ? mfaceTompoly[f] : f;
+				cookedface.matnr = mface->mat_nr;
+				cookedface.numverts = nverts;
+				cookedface.flat = flat;
+			}
+
 			if (bucket->IsWire() && visible) {
 				// The fourth value can be uninitialized.
 				unsigned int mfaceindices[4] = {mface->v1, mface->v2, mface->v3, mface->v4};
@@ -696,12 +1021,25 @@ RAS_MeshObject* BL_ConvertMesh(Mesh* mesh, Object* blenderobj, KX_Scene* scene,
 						if (ELEM(medge->v1, mfaceindices[j], mfaceindices[k]) &&
 							ELEM(medge->v2, mfaceindices[j], mfaceindices[k])) {
 							meshobj->AddLine(bucket, indices[j], indices[k]);
+							if (cookedcache && cookedface.numlines < 4) {
+								cookedface.lines[cookedface.numlines][0] = j;
+								cookedface.lines[cookedface.numlines][1] = k;
+								cookedface.numlines++;
+							}
 							break;
 						}
 					}
 				}
 			}
 			meshobj->AddPolygon(bucket, nverts, indices, visible, collider, twoside);
+
+			if (cookedcache) {
+				const unsigned int origindices[4] = {mface->v1, mface->v2, mface->v3, mface->v4};
+				cookedwriter.Write(cookedface);
+				for (int i = 0; i < nverts; ++i) {
+					cooked_mesh_write_vertex(cookedwriter, pt[i], uvs[i], vertformat.UVSize, tan[i], rgb[i], no[i], origindices[i]);
+				}
+			}
 		}
 
 		if (tface) 
@@ -717,20 +1055,6 @@ RAS_MeshObject* BL_ConvertMesh(Mesh* mesh, Object* blenderobj, KX_Scene* scene,
 			layer.face++;
 		}
 	}
-	// keep meshobj->m_sharedvertex_map for reinstance phys mesh.
-	// 2.49a and before it did: meshobj->m_sharedvertex_map.clear();
-	// but this didnt save much ram. - Campbell
-	meshobj->EndConversion();
-
-	// pre calculate texture generation
-	// However, we want to delay this if we're libloading so we can make sure we have the right scene.
-	if (!libloading) {
-		for (list<RAS_MeshMaterial>::iterator mit = meshobj->GetFirstMaterial();
-			mit != meshobj->GetLastMaterial(); ++ mit) {
-			mit->m_bucket->GetPolyMaterial()->OnConstruction();
-		}
-	}
-
 	STR_String uvsname[RAS_Texture::MaxUnits];
 	// foreach MTex
 	for (int i = 0; i < RAS_Texture::MaxUnits; i++) {
@@ -738,15 +1062,20 @@ RAS_MeshObject* BL_ConvertMesh(Mesh* mesh, Object* blenderobj, KX_Scene* scene,
 		uvsname[i] = STR_String(layers[i].name);
 	}
 
-	// Find attributes layer (currently only UVs) by materials for this mesh.
-	meshobj->GenerateAttribLayers(uvsname);
+	BL_EndMeshConversion(meshobj, mesh, uvsname, scene, converter, libloading);
+
+	if (cookedcache) {
+		cookedcache->Add(KX_CookedDataCache::DATA_MESH, cookedkey,
+		                 KX_CookedDataCache::GetSourceKey(KX_CookedDataCache::DATA_MESH, &mesh->id),
+		                 cookedwriter.GetData(), cookedwriter.GetSize());
+		meshobj->SetCookedKey(cookedkey);
+	}
 
 	if (layers)
 		delete []layers;
 	
 	dm->release(dm);
 
-	converter->RegisterGameMesh(scene, meshobj, mesh);
 	return meshobj;
 }
 
@@ -54,6 +54,8 @@
 #endif
 
 #include "KX_LibLoadStatus.h"
+#include "KX_CookedDataCache.h"
+#include "KX_TextureStreamer.h"
 #include "KX_BlenderScalarInterpolator.h"
 #include "BL_BlenderDataConversion.h"
 #include "KX_WorldInfo.h"
@@ -115,6 +117,8 @@ extern "C" {
 #include "BLI_task.h"
 #include "EXP_Thread.h"
 
+#include <float.h>
+
 // This is used to avoid including BLI_task.h in KX_BlenderSceneConverter.h
 typedef struct ThreadInfo {
 	TaskPool *m_pool;
@@ -124,12 +128,14 @@ typedef struct ThreadInfo {
 KX_BlenderSceneConverter::KX_BlenderSceneConverter(
 							Main *maggie,
 							KX_KetsjiEngine *engine)
-							:m_maggie(maggie),
+							:m_cookedcache(NULL),
+							m_maggie(maggie),
 							m_ketsjiEngine(engine),
 							m_alwaysUseExpandFraming(false)
 {
 	BKE_main_id_tag_all(maggie, LIB_TAG_DOIT, false);  /* avoid re-tagging later on */
 	m_newfilename = "";
+	m_mergebudget = 0.004;
 	m_threadinfo = new ThreadInfo();
 	m_threadinfo->m_pool = BLI_task_pool_create(engine->GetTaskScheduler(), NULL);
 }
@@ -177,6 +183,11 @@ KX_BlenderSceneConverter::~KX_BlenderSceneConverter()
 		BLI_task_pool_free(m_threadinfo->m_pool);
 		delete m_threadinfo;
 	}
+
+	// Saves the data cooked by the asynchronous loads.
+	if (m_cookedcache) {
+		delete m_cookedcache;
+	}
 }
 
 void KX_BlenderSceneConverter::SetNewFileName(const STR_String &filename)
@@ -287,6 +298,11 @@ void KX_BlenderSceneConverter::ConvertScene(KX_Scene *destinationscene, RAS_IRas
 	//This cache mecanism is buggy so I leave it disable and the memory leak
 	//that would result from this is fixed in RemoveScene()
 	m_map_mesh_to_gamemesh.clear();
+
+	// Save the cooked data as soon as possible, the game can be killed before exiting.
+	if (m_cookedcache && !libloading) {
+		m_cookedcache->Save();
+	}
 }
 
 // This function removes all entities stored in the converter for that scene
@@ -448,44 +464,66 @@ Main *KX_BlenderSceneConverter::GetMainDynamicPath(const char *path)
 	return NULL;
 }
 
+// Data of an asynchronous libload, stored in its KX_LibLoadStatus.
+typedef struct AsyncLibLoad {
+	// Copy of the blend file data when loading from memory, freed once read
+	void *buffer;
+	int length;
+
+	Main *main_newlib;
+	int idcode;
+	short options;
+
+	// Scenes converted by the task, deleted once merged. Meshes are
+	// converted into a scene of their own holding their buckets and materials.
+	vector<KX_Scene *> scenes;
+	vector<RAS_MeshObject *> meshes;
+
+	// State of the merge, which is spread over several frames
+	unsigned int scene_index;
+	int object_index;
+	bool physics_merged;
+	vector<KX_GameObject *> physics_objects;
+	unsigned int constraint_index;
+	unsigned int material_index;
+	int merge_done;
+	int merge_total;
+} AsyncLibLoad;
+
 void KX_BlenderSceneConverter::MergeAsyncLoads()
 {
-	vector<KX_Scene *> *merge_scenes;
+	MergeAsyncLoadQueue(PIL_check_seconds_timer() + m_mergebudget);
+}
 
-	vector<KX_LibLoadStatus *>::iterator mit;
-	vector<KX_Scene *>::iterator sit;
+void KX_BlenderSceneConverter::FinalizeAsyncLoads()
+{
+	// Finish all loading libraries.
+	if (m_threadinfo) {
+		BLI_task_pool_work_and_wait(m_threadinfo->m_pool);
+	}
+	// Merge all libraries data in the current scene, to avoid memory leak of unmerged scenes.
+	MergeAsyncLoadQueue(DBL_MAX);
+}
 
+void KX_BlenderSceneConverter::MergeAsyncLoadQueue(double endtime)
+{
 	m_threadinfo->m_mutex.Lock();
 
-	for (mit = m_mergequeue.begin(); mit != m_mergequeue.end(); ++mit) {
-		merge_scenes = (vector<KX_Scene *> *)(*mit)->GetData();
+	while (!m_mergequeue.empty()) {
+		KX_LibLoadStatus *status = m_mergequeue.front();
 
-		for (sit=merge_scenes->begin(); sit!=merge_scenes->end(); ++sit) {
-			(*mit)->GetMergeScene()->MergeScene(*sit);
-			delete (*sit);
+		if (!MergeAsyncLoad(status, endtime)) {
+			// Out of time, continue on the next frame.
+			break;
 		}
 
-		delete merge_scenes;
-		(*mit)->SetData(NULL);
-
-		(*mit)->Finish();
+		m_mergequeue.erase(m_mergequeue.begin());
+		status->Finish();
 	}
 
-	m_mergequeue.clear();
-
 	m_threadinfo->m_mutex.Unlock();
 }
 
-void KX_BlenderSceneConverter::FinalizeAsyncLoads()
-{
-	// Finish all loading libraries.
-	if (m_threadinfo) {
-		BLI_task_pool_work_and_wait(m_threadinfo->m_pool);
-	}
-	// Merge all libraries data in the current scene, to avoid memory leak of unmerged scenes.
-	MergeAsyncLoads();
-}
-
 void KX_BlenderSceneConverter::AddScenesToMergeQueue(KX_LibLoadStatus *status)
 {
 	m_threadinfo->m_mutex.Lock();
@@ -493,42 +531,34 @@ void KX_BlenderSceneConverter::AddScenesToMergeQueue(KX_LibLoadStatus *status)
 	m_threadinfo->m_mutex.Unlock();
 }
 
-static void async_convert(TaskPool *pool, void *ptr, int UNUSED(threadid))
+void KX_BlenderSceneConverter::SetMergeBudget(double budget)
 {
-	KX_Scene *new_scene = NULL;
-	KX_LibLoadStatus *status = (KX_LibLoadStatus *)ptr;
-	vector<Scene *> *scenes = (vector<Scene *> *)status->GetData();
-	vector<KX_Scene *> *merge_scenes = new vector<KX_Scene *>(); // Deleted in MergeAsyncLoads
-
-	for (unsigned int i = 0; i < scenes->size(); ++i) {
-		new_scene = status->GetEngine()->CreateScene((*scenes)[i], true);
+	m_mergebudget = budget * 0.001;
+}
 
-		if (new_scene)
-			merge_scenes->push_back(new_scene);
+double KX_BlenderSceneConverter::GetMergeBudget()
+{
+	return m_mergebudget * 1000.0;
+}
 
-		status->AddProgress((1.0f / scenes->size()) * 0.9f); // We'll call conversion 90% and merging 10% for now
+void KX_BlenderSceneConverter::EnableCookedDataCache(const char *blendpath)
+{
+	if (!m_cookedcache) {
+		m_cookedcache = new KX_CookedDataCache(blendpath);
 	}
-
-	delete scenes;
-	status->SetData(merge_scenes);
-
-	status->GetConverter()->AddScenesToMergeQueue(status);
 }
 
-KX_LibLoadStatus *KX_BlenderSceneConverter::LinkBlendFileMemory(void *data, int length, const char *path, char *group, KX_Scene *scene_merge, char **err_str, short options)
+KX_CookedDataCache *KX_BlenderSceneConverter::GetCookedDataCache()
 {
-	BlendHandle *bpy_openlib = BLO_blendhandle_from_memory(data, length);
-
-	// Error checking is done in LinkBlendFile
-	return LinkBlendFile(bpy_openlib, path, group, scene_merge, err_str, options);
+	return m_cookedcache;
 }
 
-KX_LibLoadStatus *KX_BlenderSceneConverter::LinkBlendFilePath(const char *filepath, char *group, KX_Scene *scene_merge, char **err_str, short options)
+void KX_BlenderSceneConverter::PrintCookedDataStats()
 {
-	BlendHandle *bpy_openlib = BLO_blendhandle_from_file(filepath, NULL);
-
-	// Error checking is done in LinkBlendFile
-	return LinkBlendFile(bpy_openlib, filepath, group, scene_merge, err_str, options);
+	printf("\nCooked data cache...\n");
+	printf("\t file: %s\n", m_cookedcache->GetPath().ReadPtr());
+	printf("\t hits: %d\n", m_cookedcache->GetNumHits());
+	printf("\t misses: %d\n", m_cookedcache->GetNumMisses());
 }
 
 static void load_datablocks(Main *main_tmp, BlendHandle *bpy_openlib, const char *path, int idcode)
@@ -548,57 +578,336 @@ static void load_datablocks(Main *main_tmp, BlendHandle *bpy_openlib, const char
 	BLI_linklist_free(names, free);	/* free linklist *and* each node's data */
 }
 
-KX_LibLoadStatus *KX_BlenderSceneConverter::LinkBlendFile(BlendHandle *bpy_openlib, const char *path, char *group, KX_Scene *scene_merge, char **err_str, short options)
+static void link_datablocks(Main *main_newlib, BlendHandle *bpy_openlib, const char *path, int idcode, short options)
 {
-	Main *main_newlib; /* stored as a dynamic 'main' until we free it */
-	const int idcode = BKE_idcode_from_name(group);
-	ReportList reports;
-	static char err_local[255];
+	short flag = 0; /* don't need any special options */
+	/* created only for linking, then freed */
+	Main *main_tmp = BLO_library_link_begin(main_newlib, &bpy_openlib, (char *)path);
 
-//	TIMEIT_START(bge_link_blend_file);
+	load_datablocks(main_tmp, bpy_openlib, path, idcode);
 
-	KX_LibLoadStatus *status;
+	if (idcode == ID_SCE && options & KX_BlenderSceneConverter::LIB_LOAD_LOAD_SCRIPTS) {
+		load_datablocks(main_tmp, bpy_openlib, path, ID_TXT);
+	}
+
+	/* now do another round of linking for Scenes so all actions are properly loaded */
+	if (idcode == ID_SCE && options & KX_BlenderSceneConverter::LIB_LOAD_LOAD_ACTIONS) {
+		load_datablocks(main_tmp, bpy_openlib, path, ID_AC);
+	}
+
+	BLO_library_link_end(main_tmp, &bpy_openlib, flag, NULL, NULL);
+}
+
+static void register_actions(Main *main_newlib, KX_Scene *scene_merge, short options)
+{
+	ID *action;
+
+	for (action = (ID *)main_newlib->action.first; action; action = (ID *)action->next) {
+		if (options & KX_BlenderSceneConverter::LIB_LOAD_VERBOSE)
+			printf("ActionName: %s\n", action->name + 2);
+		scene_merge->GetLogicManager()->RegisterActionName(action->name + 2, action);
+	}
+}
+
+static void async_load(TaskPool *pool, void *ptr, int UNUSED(threadid))
+{
+	KX_LibLoadStatus *status = (KX_LibLoadStatus *)ptr;
+	AsyncLibLoad *load = (AsyncLibLoad *)status->GetData();
+	const char *path = status->GetLibName();
+
+	BlendHandle *bpy_openlib = (load->buffer) ? BLO_blendhandle_from_memory(load->buffer, load->length) :
+	                                            BLO_blendhandle_from_file(path, NULL);
+
+	if (bpy_openlib) {
+		status->SetStageProgress(0.5f);
+		link_datablocks(load->main_newlib, bpy_openlib, path, load->idcode, load->options);
+		BLO_blendhandle_close(bpy_openlib);
+	}
+	else {
+		// The library stays empty, it's still registered so it can be freed.
+		printf("could not open blendfile \"%s\"\n", path);
+	}
+
+	if (load->buffer) {
+		MEM_freeN(load->buffer);
+		load->buffer = NULL;
+	}
+
+	status->SetStage(KX_LibLoadStatus::LIBLOAD_STAGE_CONVERT);
+
+	if (load->idcode == ID_SCE) {
+		// Meshes, materials and physics shapes are converted with the scenes.
+		const int totscene = BLI_listbase_count(&load->main_newlib->scene);
+		int i = 0;
+
+		for (ID *scene = (ID *)load->main_newlib->scene.first; scene; scene = (ID *)scene->next, ++i) {
+			if (load->options & KX_BlenderSceneConverter::LIB_LOAD_VERBOSE)
+				printf("SceneName: %s\n", scene->name + 2);
+
+			KX_Scene *new_scene = status->GetEngine()->CreateScene((Scene *)scene, true);
+
+			if (new_scene)
+				load->scenes.push_back(new_scene);
+
+			status->SetStageProgress((float)(i + 1) / totscene);
+		}
+	}
+	else if (load->idcode == ID_ME) {
+		KX_KetsjiEngine *engine = status->GetEngine();
+		KX_Scene *scene_merge = status->GetMergeScene();
+		KX_Scene *mesh_scene = new KX_Scene(engine->GetInputDevice(),
+		                                    scene_merge->GetName(),
+		                                    scene_merge->GetBlenderScene(),
+		                                    engine->GetCanvas(),
+		                                    engine->GetNetworkMessageManager());
+		const int totmesh = BLI_listbase_count(&load->main_newlib->mesh);
+		int i = 0;
+
+		for (ID *mesh = (ID *)load->main_newlib->mesh.first; mesh; mesh = (ID *)mesh->next, ++i) {
+			if (load->options & KX_BlenderSceneConverter::LIB_LOAD_VERBOSE)
+				printf("MeshName: %s\n", mesh->name + 2);
+
+			// The materials are constructed once merged, like for scenes.
+			load->meshes.push_back(BL_ConvertMesh((Mesh *)mesh, NULL, mesh_scene, status->GetConverter(), true));
+			status->SetStageProgress((float)(i + 1) / totmesh);
+		}
+
+		load->scenes.push_back(mesh_scene);
+	}
+
+	status->SetStageProgress(1.0f);
+	status->GetConverter()->AddScenesToMergeQueue(status);
+}
+
+bool KX_BlenderSceneConverter::MergeAsyncLoad(KX_LibLoadStatus *status, double endtime)
+{
+	AsyncLibLoad *load = (AsyncLibLoad *)status->GetData();
+	KX_Scene *scene_merge = status->GetMergeScene();
+	Main *main_newlib = load->main_newlib;
+
+	if (status->GetStage() != KX_LibLoadStatus::LIBLOAD_STAGE_MERGE) {
+		// The library is visible only once linked, the task doesn't use it anymore.
+		GetMainDynamic().push_back(main_newlib);
+		status->SetStage(KX_LibLoadStatus::LIBLOAD_STAGE_MERGE);
+
+		for (unsigned int i = 0; i < load->scenes.size(); ++i) {
+			load->merge_total += load->scenes[i]->GetObjectList()->GetCount() + load->scenes[i]->GetInactiveList()->GetCount();
+		}
+		if (load->idcode == ID_ME) {
+			load->merge_total += m_polymaterials[load->scenes[0]].size();
+		}
+	}
+
+	if (load->idcode == ID_ME) {
+		KX_Scene *other = load->scenes[0];
+		std::vector<RAS_IPolyMaterial *>& polymatlist = m_polymaterials[other];
+
+		// Constructing the shaders is the costly part of merging the meshes, it's done
+		// material by material, MergeScene skips the constructed materials.
+		while (load->material_index < polymatlist.size()) {
+			polymatlist[load->material_index++]->Replace_IScene(scene_merge);
+			status->SetStageProgress((float)(++load->merge_done) / load->merge_total);
+
+			if (PIL_check_seconds_timer() > endtime) {
+				return false;
+			}
+		}
+
+		scene_merge->GetBucketManager()->MergeBucketManager(other->GetBucketManager(), scene_merge);
+		MergeScene(scene_merge, other);
+		delete other;
+
+		for (unsigned int i = 0; i < load->meshes.size(); ++i) {
+			RAS_MeshObject *meshobj = load->meshes[i];
+			scene_merge->GetLogicManager()->RegisterMeshName(meshobj->GetName(), meshobj);
+		}
+	}
+	else if (load->idcode == ID_AC) {
+		register_actions(main_newlib, scene_merge, load->options);
+	}
+	else if (load->idcode == ID_SCE) {
+		while (load->scene_index < load->scenes.size()) {
+			KX_Scene *other = load->scenes[load->scene_index];
+			CListValue *objects = other->GetObjectList();
+			CListValue *inactives = other->GetInactiveList();
+			const int totobj = objects->GetCount() + inactives->GetCount();
+
+			if (load->object_index == 0 && !load->physics_merged && !scene_merge->CanMergeScene(other)) {
+				load->object_index = totobj;
+				load->physics_merged = true;
+				load->merge_done += totobj;
+			}
+			else {
+				// Objects are prepared and their physics merged one by one, then their constraints are
+				// replicated one by one, and the rest of the scene is merged at once.
+				while (load->object_index < totobj) {
+					const int i = load->object_index++;
+					KX_GameObject *gameobj = (KX_GameObject *)((i < objects->GetCount()) ? objects->GetValue(i) : inactives->GetValue(i - objects->GetCount()));
+
+					other->PrepareMergeGameObject(gameobj);
+					scene_merge->MergeScenePhysicsObject(gameobj);
+					status->SetStageProgress((float)(++load->merge_done) / load->merge_total);
+
+					if (PIL_check_seconds_timer() > endtime) {
+						return false;
+					}
+				}
+
+				if (!load->physics_merged) {
+					scene_merge->MergeScenePhysics(other, load->physics_objects);
+					load->physics_merged = true;
+				}
+
+				while (load->constraint_index < load->physics_objects.size()) {
+					scene_merge->MergeSceneConstraints(load->physics_objects[load->constraint_index++], load->physics_objects);
+
+					if (PIL_check_seconds_timer() > endtime) {
+						return false;
+					}
+				}
+
+				scene_merge->MergeSceneFinish(other);
+			}
+
+			// RemoveScene(other); // Don't run this, it frees the entire scene converter data, just delete the scene
+			delete other;
+
+			load->scene_index++;
+			load->object_index = 0;
+			load->physics_merged = false;
+			load->physics_objects.clear();
+			load->constraint_index = 0;
+
+			if (PIL_check_seconds_timer() > endtime) {
+				return false;
+			}
+		}
+
+#ifdef WITH_PYTHON
+		/* Handle any text datablocks */
+		if (load->options & LIB_LOAD_LOAD_SCRIPTS)
+			addImportMain(main_newlib);
+#endif
+
+		/* Now handle all the actions */
+		if (load->options & LIB_LOAD_LOAD_ACTIONS)
+			register_actions(main_newlib, scene_merge, load->options);
+	}
+
+	delete load;
+	status->SetData(NULL);
+
+	return true;
+}
+
+bool KX_BlenderSceneConverter::CheckLibLoad(const char *path, int idcode, char *group, bool opened, char **err_str)
+{
+	static char err_local[255];
 
 	/* only scene and mesh supported right now */
 	if (idcode != ID_SCE && idcode != ID_ME && idcode != ID_AC) {
 		snprintf(err_local, sizeof(err_local), "invalid ID type given \"%s\"\n", group);
 		*err_str = err_local;
-		BLO_blendhandle_close(bpy_openlib);
-		return NULL;
+		return false;
 	}
-	
-	if (GetMainDynamicPath(path)) {
+
+	bool loaded = (GetMainDynamicPath(path) != NULL);
+	// Libraries being loaded asynchronously are not in the dynamic mains yet.
+	for (map<char *, KX_LibLoadStatus *>::iterator it = m_status_map.begin(); !loaded && it != m_status_map.end(); ++it) {
+		loaded = (BLI_path_cmp(it->first, path) == 0);
+	}
+
+	if (loaded) {
 		snprintf(err_local, sizeof(err_local), "blend file already open \"%s\"\n", path);
 		*err_str = err_local;
-		BLO_blendhandle_close(bpy_openlib);
-		return NULL;
+		return false;
 	}
 
-	if (bpy_openlib == NULL) {
+	if (!opened) {
 		snprintf(err_local, sizeof(err_local), "could not open blendfile \"%s\"\n", path);
 		*err_str = err_local;
-		return NULL;
+		return false;
 	}
 
-	main_newlib = BKE_main_new();
-	BKE_reports_init(&reports, RPT_STORE);
+	return true;
+}
 
-	short flag = 0; /* don't need any special options */
-	/* created only for linking, then freed */
-	Main *main_tmp = BLO_library_link_begin(main_newlib, &bpy_openlib, (char *)path);
+KX_LibLoadStatus *KX_BlenderSceneConverter::LinkBlendFileMemory(void *data, int length, const char *path, char *group, KX_Scene *scene_merge, char **err_str, short options)
+{
+	if (options & LIB_LOAD_ASYNC) {
+		// The data is decoded by the loading task
+		return LinkBlendFileAsync(data, length, path, group, scene_merge, err_str, options);
+	}
 
-	load_datablocks(main_tmp, bpy_openlib, path, idcode);
+	BlendHandle *bpy_openlib = BLO_blendhandle_from_memory(data, length);
 
-	if (idcode == ID_SCE && options & LIB_LOAD_LOAD_SCRIPTS) {
-		load_datablocks(main_tmp, bpy_openlib, path, ID_TXT);
+	// Error checking is done in LinkBlendFile
+	return LinkBlendFile(bpy_openlib, path, group, scene_merge, err_str, options);
+}
+
+KX_LibLoadStatus *KX_BlenderSceneConverter::LinkBlendFilePath(const char *filepath, char *group, KX_Scene *scene_merge, char **err_str, short options)
+{
+	if (options & LIB_LOAD_ASYNC) {
+		// The file is read by the loading task
+		return LinkBlendFileAsync(NULL, 0, filepath, group, scene_merge, err_str, options);
 	}
 
-	/* now do another round of linking for Scenes so all actions are properly loaded */
-	if (idcode == ID_SCE && options & LIB_LOAD_LOAD_ACTIONS) {
-		load_datablocks(main_tmp, bpy_openlib, path, ID_AC);
+	BlendHandle *bpy_openlib = BLO_blendhandle_from_file(filepath, NULL);
+
+	// Error checking is done in LinkBlendFile
+	return LinkBlendFile(bpy_openlib, filepath, group, scene_merge, err_str, options);
+}
+
+KX_LibLoadStatus *KX_BlenderSceneConverter::LinkBlendFileAsync(void *data, int length, const char *path, char *group, KX_Scene *scene_merge, char **err_str, short options)
+{
+	const int idcode = BKE_idcode_from_name(group);
+
+	if (!CheckLibLoad(path, idcode, group, data || BLI_exists(path), err_str)) {
+		return NULL;
 	}
 
-	BLO_library_link_end(main_tmp, &bpy_openlib, flag, NULL, NULL);
+	AsyncLibLoad *load = new AsyncLibLoad(); // Deleted in MergeAsyncLoad
+	if (data) {
+		// The caller's buffer isn't valid anymore once the task runs
+		load->buffer = MEM_mallocN(length, "AsyncLibLoad buffer");
+		load->length = length;
+		memcpy(load->buffer, data, length);
+	}
+	load->main_newlib = BKE_main_new();
+	load->idcode = idcode;
+	load->options = options;
+	/* needed for lookups*/
+	BLI_strncpy(load->main_newlib->name, path, sizeof(load->main_newlib->name));
+
+	KX_LibLoadStatus *status = new KX_LibLoadStatus(this, m_ketsjiEngine, scene_merge, path);
+	status->SetData(load);
+	m_status_map[load->main_newlib->name] = status;
+
+	BLI_task_pool_push(m_threadinfo->m_pool, async_load, (void *)status, false, TASK_PRIORITY_LOW);
+
+	return status;
+}
+
+KX_LibLoadStatus *KX_BlenderSceneConverter::LinkBlendFile(BlendHandle *bpy_openlib, const char *path, char *group, KX_Scene *scene_merge, char **err_str, short options)
+{
+	Main *main_newlib; /* stored as a dynamic 'main' until we free it */
+	const int idcode = BKE_idcode_from_name(group);
+	ReportList reports;
+
+//	TIMEIT_START(bge_link_blend_file);
+
+	KX_LibLoadStatus *status;
+
+	if (!CheckLibLoad(path, idcode, group, bpy_openlib != NULL, err_str)) {
+		if (bpy_openlib)
+			BLO_blendhandle_close(bpy_openlib);
+		return NULL;
+	}
+
+	main_newlib = BKE_main_new();
+	BKE_reports_init(&reports, RPT_STORE);
+
+	link_datablocks(main_newlib, bpy_openlib, path, idcode, options);
 
 	BLO_blendhandle_close(bpy_openlib);
 
@@ -625,40 +934,22 @@ KX_LibLoadStatus *KX_BlenderSceneConverter::LinkBlendFile(BlendHandle *bpy_openl
 	}
 	else if (idcode == ID_AC) {
 		/* Convert all actions */
-		ID *action;
-
-		for (action= (ID *)main_newlib->action.first; action; action = (ID *)action->next) {
-			if (options & LIB_LOAD_VERBOSE)
-				printf("ActionName: %s\n", action->name + 2);
-			scene_merge->GetLogicManager()->RegisterActionName(action->name + 2, action);
-		}
+		register_actions(main_newlib, scene_merge, options);
 	}
 	else if (idcode == ID_SCE) {
 		/* Merge all new linked in scene into the existing one */
 		ID *scene;
-		// scenes gets deleted by the thread when it's done using it (look in async_convert())
-		vector<Scene *> *scenes = (options & LIB_LOAD_ASYNC) ? new vector<Scene *>() : NULL;
 
 		for (scene = (ID *)main_newlib->scene.first; scene; scene = (ID *)scene->next ) {
 			if (options & LIB_LOAD_VERBOSE)
 				printf("SceneName: %s\n", scene->name + 2);
 			
-			if (options & LIB_LOAD_ASYNC) {
-				scenes->push_back((Scene *)scene);
-			} 
-			else {
-				/* merge into the base  scene */
-				KX_Scene* other = m_ketsjiEngine->CreateScene((Scene *)scene, true);
-				scene_merge->MergeScene(other);
-			
-				// RemoveScene(other); // Don't run this, it frees the entire scene converter data, just delete the scene
-				delete other;
-			}
-		}
-
-		if (options & LIB_LOAD_ASYNC) {
-			status->SetData(scenes);
-			BLI_task_pool_push(m_threadinfo->m_pool, async_convert, (void *)status, false, TASK_PRIORITY_LOW);
+			/* merge into the base  scene */
+			KX_Scene* other = m_ketsjiEngine->CreateScene((Scene *)scene, true);
+			scene_merge->MergeScene(other);
+		
+			// RemoveScene(other); // Don't run this, it frees the entire scene converter data, just delete the scene
+			delete other;
 		}
 
 #ifdef WITH_PYTHON
@@ -668,19 +959,11 @@ KX_LibLoadStatus *KX_BlenderSceneConverter::LinkBlendFile(BlendHandle *bpy_openl
 #endif
 
 		/* Now handle all the actions */
-		if (options & LIB_LOAD_LOAD_ACTIONS) {
-			ID *action;
-
-			for (action = (ID *)main_newlib->action.first; action; action = (ID *)action->next) {
-				if (options & LIB_LOAD_VERBOSE)
-					printf("ActionName: %s\n", action->name + 2);
-				scene_merge->GetLogicManager()->RegisterActionName(action->name + 2, action);
-			}
-		}
+		if (options & LIB_LOAD_LOAD_ACTIONS)
+			register_actions(main_newlib, scene_merge, options);
 	}
 
-	if (!(options & LIB_LOAD_ASYNC))
-		status->Finish();
+	status->Finish();
 
 //	TIMEIT_END(bge_link_blend_file);
 
@@ -889,6 +1172,11 @@ bool KX_BlenderSceneConverter::FreeBlendFile(Main *maggie)
 	delete m_status_map[maggie->name];
 	m_status_map.erase(maggie->name);
 
+	KX_TextureStreamer *streamer = m_ketsjiEngine->GetTextureStreamer();
+	if (streamer) {
+		streamer->RemoveImages(maggie);
+	}
+
 	BKE_main_free(maggie);
 
 	return true;
@@ -68,6 +68,12 @@ class KX_BlenderSceneConverter : public KX_ISceneConverter
 	vector<class KX_LibLoadStatus*> m_mergequeue;
 	ThreadInfo	*m_threadinfo;
 
+	// Time in seconds spent each frame to merge asynchronous loads
+	double m_mergebudget;
+
+	// Converted data saved next to the blend file, NULL if disabled
+	class KX_CookedDataCache *m_cookedcache;
+
 	// Cached material conversions
 	PolyMaterialCache m_polymat_cache;
 
@@ -91,6 +97,11 @@ class KX_BlenderSceneConverter : public KX_ISceneConverter
 	class KX_KetsjiEngine*	m_ketsjiEngine;
 	bool					m_alwaysUseExpandFraming;
 
+	bool CheckLibLoad(const char *path, int idcode, char *group, bool opened, char **err_str);
+	class KX_LibLoadStatus *LinkBlendFileAsync(void *data, int length, const char *path, char *group, KX_Scene *scene_merge, char **err_str, short options);
+	bool MergeAsyncLoad(class KX_LibLoadStatus *status, double endtime);
+	void MergeAsyncLoadQueue(double endtime);
+
 public:
 	KX_BlenderSceneConverter(
 		Main* maggie,
@@ -154,6 +165,17 @@ public:
 	virtual void MergeAsyncLoads();
 	virtual void FinalizeAsyncLoads();
 	void AddScenesToMergeQueue(class KX_LibLoadStatus *status);
+
+	/* Time in milliseconds that merging asynchronous loads can take per frame,
+	 * the merge goes on the next frames when it's exceeded. */
+	void SetMergeBudget(double budget);
+	double GetMergeBudget();
+
+	/* Reuse the meshes, physics shapes and navigation meshes converted
+	 * by the previous games, see KX_CookedDataCache. */
+	void EnableCookedDataCache(const char *blendpath);
+	class KX_CookedDataCache *GetCookedDataCache();
+	void PrintCookedDataStats();
  
 	void PrintStats() {
 		printf("BGE STATS!\n");
@@ -169,6 +191,10 @@ public:
 		printf("\t m_map_blender_to_gamecontroller: %d\n", (int)m_map_blender_to_gamecontroller.size());
 		printf("\t m_map_blender_to_gameAdtList: %d\n", (int)m_map_blender_to_gameAdtList.size());
 
+		if (m_cookedcache) {
+			PrintCookedDataStats();
+		}
+
 #ifdef WITH_CXX_GUARDEDALLOC
 		MEM_printmemlist_pydict();
 #endif
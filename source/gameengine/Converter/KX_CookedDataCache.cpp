@@ -0,0 +1,497 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor(s): none yet.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file gameengine/Converter/KX_CookedDataCache.cpp
+ *  \ingroup bgeconv
+ */
+
+#include "KX_CookedDataCache.h"
+
+#include "MEM_guardedalloc.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <set>
+
+#ifndef WIN32
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+extern "C" {
+#include "BLI_fileops.h"
+#include "DNA_ID.h"
+}
+
+/* Increase when the format of the file or of the cooked data changes. */
+#define COOKED_CACHE_VERSION 1
+#define COOKED_CACHE_ALIGN 16
+
+static const char cooked_magic[8] = {'B', 'G', 'E', 'C', 'O', 'O', 'K', '\0'};
+
+struct CookedFileHeader {
+	char magic[8];
+	uint32_t version;
+	/// Pointer size and endianness, a file from another platform is ignored.
+	uint32_t platform;
+	uint32_t numentries;
+	uint32_t pad;
+};
+
+struct CookedFileEntry {
+	uint64_t key;
+	uint64_t source;
+	uint32_t type;
+	uint32_t pad;
+	uint64_t offset;
+	uint64_t size;
+};
+
+static uint32_t cooked_platform()
+{
+	const uint16_t endian = 1;
+	return (uint32_t)sizeof(void *) | ((*(const char *)&endian) ? 0 : 0x100);
+}
+
+static size_t cooked_align(size_t size)
+{
+	return (size + COOKED_CACHE_ALIGN - 1) & ~((size_t)COOKED_CACHE_ALIGN - 1);
+}
+
+KX_CookedDataKey::KX_CookedDataKey()
+{
+	BLI_hash_mm2a_init(&m_low, 0x4b58434b);
+	BLI_hash_mm2a_init(&m_high, 0x9e3779b9);
+	AddInt(COOKED_CACHE_VERSION);
+}
+
+void KX_CookedDataKey::Add(const void *data, size_t size)
+{
+	if (size == 0) {
+		return;
+	}
+	BLI_hash_mm2a_add(&m_low, (const unsigned char *)data, size);
+	BLI_hash_mm2a_add(&m_high, (const unsigned char *)data, size);
+}
+
+void KX_CookedDataKey::AddInt(int value)
+{
+	BLI_hash_mm2a_add_int(&m_low, value);
+	BLI_hash_mm2a_add_int(&m_high, value);
+}
+
+void KX_CookedDataKey::AddString(const char *str)
+{
+	const size_t len = str ? strlen(str) : 0;
+	AddInt((int)len);
+	Add(str, len);
+}
+
+void KX_CookedDataKey::AddKey(uint64_t key)
+{
+	Add(&key, sizeof(key));
+}
+
+uint64_t KX_CookedDataKey::Get()
+{
+	return ((uint64_t)BLI_hash_mm2a_end(&m_high) << 32) | (uint64_t)BLI_hash_mm2a_end(&m_low);
+}
+
+void KX_CookedDataWriter::Write(const void *data, size_t size)
+{
+	const char *cdata = (const char *)data;
+	m_data.insert(m_data.end(), cdata, cdata + size);
+}
+
+void KX_CookedDataWriter::WriteString(const char *str)
+{
+	const unsigned int len = (unsigned int)strlen(str);
+	Write(len);
+	Write(str, len);
+}
+
+void KX_CookedDataWriter::Align(size_t alignment)
+{
+	while (m_data.size() % alignment) {
+		m_data.push_back(0);
+	}
+}
+
+const void *KX_CookedDataWriter::GetData() const
+{
+	return m_data.empty() ? NULL : &m_data[0];
+}
+
+size_t KX_CookedDataWriter::GetSize() const
+{
+	return m_data.size();
+}
+
+KX_CookedDataReader::KX_CookedDataReader(const void *data, size_t size)
+	:m_data((const char *)data),
+	m_size(size),
+	m_offset(0),
+	m_valid(true)
+{
+}
+
+const void *KX_CookedDataReader::ReadData(size_t size)
+{
+	if (!m_valid || size > m_size - m_offset) {
+		m_valid = false;
+		return NULL;
+	}
+	const void *data = m_data + m_offset;
+	m_offset += size;
+	return data;
+}
+
+bool KX_CookedDataReader::Read(void *data, size_t size)
+{
+	const void *src = ReadData(size);
+	if (!src) {
+		return false;
+	}
+	memcpy(data, src, size);
+	return true;
+}
+
+bool KX_CookedDataReader::ReadString(STR_String& str)
+{
+	unsigned int len;
+	if (!Read(len)) {
+		return false;
+	}
+	const char *data = (const char *)ReadData(len);
+	if (!data) {
+		return false;
+	}
+	str = STR_String(data, len);
+	return true;
+}
+
+void KX_CookedDataReader::Align(size_t alignment)
+{
+	/* The entries data start on an aligned address. */
+	const size_t offset = (m_offset + alignment - 1) / alignment * alignment;
+	if (offset > m_size) {
+		m_valid = false;
+	}
+	else {
+		m_offset = offset;
+	}
+}
+
+bool KX_CookedDataReader::IsValid() const
+{
+	return m_valid;
+}
+
+KX_CookedDataCache::KX_CookedDataCache(const char *blendpath)
+	:m_path(STR_String(blendpath) + ".bgecache"),
+	m_fileData(NULL),
+	m_fileSize(0),
+	m_fileMapped(false),
+	m_modified(false),
+	m_numHits(0),
+	m_numMisses(0)
+{
+	if (Read()) {
+		printf("Cooked data cache: %s, %d entries\n", m_path.ReadPtr(), (int)m_entries.size());
+	}
+}
+
+KX_CookedDataCache::~KX_CookedDataCache()
+{
+	Save();
+
+	m_entries.clear();
+	FreeFileData();
+
+	for (std::vector<void *>::iterator it = m_newData.begin(), end = m_newData.end(); it != end; ++it) {
+		MEM_freeN(*it);
+	}
+}
+
+void KX_CookedDataCache::FreeFileData()
+{
+	if (!m_fileData) {
+		return;
+	}
+
+#ifndef WIN32
+	if (m_fileMapped) {
+		munmap(m_fileData, m_fileSize);
+	}
+	else
+#endif
+	{
+		MEM_freeN(m_fileData);
+	}
+
+	m_fileData = NULL;
+	m_fileSize = 0;
+	m_fileMapped = false;
+}
+
+bool KX_CookedDataCache::Read()
+{
+	if (!BLI_exists(m_path.ReadPtr())) {
+		return false;
+	}
+
+#ifndef WIN32
+	const int file = BLI_open(m_path.ReadPtr(), O_RDONLY, 0);
+	if (file == -1) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(file, &st) == 0 && st.st_size > 0) {
+		void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED) {
+			m_fileData = data;
+			m_fileSize = (size_t)st.st_size;
+			m_fileMapped = true;
+		}
+	}
+	close(file);
+#else
+	FILE *file = BLI_fopen(m_path.ReadPtr(), "rb");
+	if (!file) {
+		return false;
+	}
+
+	const size_t size = BLI_file_size(m_path.ReadPtr());
+	if (size != (size_t)-1 && size > 0) {
+		void *data = MEM_mallocN_aligned(size, COOKED_CACHE_ALIGN, "KX_CookedDataCache file");
+		if (fread(data, 1, size, file) == size) {
+			m_fileData = data;
+			m_fileSize = size;
+		}
+		else {
+			MEM_freeN(data);
+		}
+	}
+	fclose(file);
+#endif
+
+	if (!m_fileData) {
+		return false;
+	}
+
+	KX_CookedDataReader reader(m_fileData, m_fileSize);
+	CookedFileHeader header;
+	if (!reader.Read(header) || memcmp(header.magic, cooked_magic, sizeof(cooked_magic)) != 0 ||
+	    header.version != COOKED_CACHE_VERSION || header.platform != cooked_platform())
+	{
+		printf("Cooked data cache: ignoring %s, incompatible file\n", m_path.ReadPtr());
+		FreeFileData();
+		return false;
+	}
+
+	const CookedFileEntry *fileentries = (const CookedFileEntry *)reader.ReadData(sizeof(CookedFileEntry) * header.numentries);
+	if (!fileentries) {
+		FreeFileData();
+		return false;
+	}
+
+	for (unsigned int i = 0; i < header.numentries; ++i) {
+		const CookedFileEntry& fileentry = fileentries[i];
+		if (fileentry.type >= DATA_MAX || fileentry.offset % COOKED_CACHE_ALIGN != 0 ||
+		    fileentry.offset > m_fileSize || fileentry.size > m_fileSize - fileentry.offset)
+		{
+			continue;
+		}
+
+		Entry entry;
+		entry.m_source = fileentry.source;
+		entry.m_type = fileentry.type;
+		entry.m_data = (const char *)m_fileData + fileentry.offset;
+		entry.m_size = (size_t)fileentry.size;
+		entry.m_used = false;
+		m_entries[fileentry.key] = entry;
+	}
+
+	return true;
+}
+
+const void *KX_CookedDataCache::Find(DataType type, uint64_t key, size_t& size)
+{
+	m_mutex.Lock();
+
+	std::map<uint64_t, Entry>::iterator it = m_entries.find(key);
+	if (it == m_entries.end() || it->second.m_type != (unsigned int)type) {
+		++m_numMisses;
+		m_mutex.Unlock();
+		return NULL;
+	}
+
+	Entry& entry = it->second;
+	entry.m_used = true;
+	size = entry.m_size;
+	++m_numHits;
+
+	m_mutex.Unlock();
+
+	return entry.m_data;
+}
+
+void KX_CookedDataCache::Add(DataType type, uint64_t key, uint64_t source, const void *data, size_t size)
+{
+	void *copy = MEM_mallocN_aligned((size > 0) ? size : 1, COOKED_CACHE_ALIGN, "KX_CookedDataCache entry");
+	memcpy(copy, data, size);
+
+	m_mutex.Lock();
+
+	m_newData.push_back(copy);
+
+	Entry entry;
+	entry.m_source = source;
+	entry.m_type = type;
+	entry.m_data = copy;
+	entry.m_size = size;
+	entry.m_used = true;
+	m_entries[key] = entry;
+	m_modified = true;
+
+	m_mutex.Unlock();
+}
+
+bool KX_CookedDataCache::Save()
+{
+	m_mutex.Lock();
+
+	if (!m_modified) {
+		m_mutex.Unlock();
+		return true;
+	}
+
+	/* The sources with new entries, their unused entries come from an older version of the data. */
+	std::set<std::pair<unsigned int, uint64_t> > modifiedSources;
+	for (std::map<uint64_t, Entry>::const_iterator it = m_entries.begin(), end = m_entries.end(); it != end; ++it) {
+		const Entry& entry = it->second;
+		if (entry.m_used && (entry.m_data < m_fileData || entry.m_data >= (const char *)m_fileData + m_fileSize)) {
+			modifiedSources.insert(std::make_pair(entry.m_type, entry.m_source));
+		}
+	}
+
+	std::vector<CookedFileEntry> fileentries;
+	std::vector<const void *> datas;
+	for (std::map<uint64_t, Entry>::const_iterator it = m_entries.begin(), end = m_entries.end(); it != end; ++it) {
+		const Entry& entry = it->second;
+		if (!entry.m_used && modifiedSources.count(std::make_pair(entry.m_type, entry.m_source))) {
+			continue;
+		}
+
+		CookedFileEntry fileentry;
+		memset(&fileentry, 0, sizeof(fileentry));
+		fileentry.key = it->first;
+		fileentry.source = entry.m_source;
+		fileentry.type = entry.m_type;
+		fileentry.size = entry.m_size;
+		fileentries.push_back(fileentry);
+		datas.push_back(entry.m_data);
+	}
+
+	CookedFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, cooked_magic, sizeof(cooked_magic));
+	header.version = COOKED_CACHE_VERSION;
+	header.platform = cooked_platform();
+	header.numentries = (uint32_t)fileentries.size();
+
+	size_t offset = cooked_align(sizeof(CookedFileHeader) + sizeof(CookedFileEntry) * fileentries.size());
+	for (std::vector<CookedFileEntry>::iterator it = fileentries.begin(), end = fileentries.end(); it != end; ++it) {
+		it->offset = offset;
+		offset = cooked_align(offset + it->size);
+	}
+
+	/* Write in a temporary file, the current file can be mapped and a
+	 * game quitting during the write must not leave a corrupted cache. */
+	const STR_String tmppath = m_path + "@";
+	FILE *file = BLI_fopen(tmppath.ReadPtr(), "wb");
+	if (!file) {
+		printf("Cooked data cache: can't write %s\n", tmppath.ReadPtr());
+		m_mutex.Unlock();
+		return false;
+	}
+
+	static const char padding[COOKED_CACHE_ALIGN] = {0};
+	bool success = (fwrite(&header, sizeof(header), 1, file) == 1);
+	if (!fileentries.empty()) {
+		success = success && (fwrite(&fileentries[0], sizeof(CookedFileEntry), fileentries.size(), file) == fileentries.size());
+	}
+
+	size_t written = sizeof(CookedFileHeader) + sizeof(CookedFileEntry) * fileentries.size();
+	for (unsigned int i = 0; i < fileentries.size() && success; ++i) {
+		const CookedFileEntry& fileentry = fileentries[i];
+		const size_t pad = (size_t)fileentry.offset - written;
+		success = (fwrite(padding, 1, pad, file) == pad) &&
+		          (fwrite(datas[i], 1, (size_t)fileentry.size, file) == fileentry.size);
+		written = (size_t)(fileentry.offset + fileentry.size);
+	}
+
+	success = (fclose(file) == 0) && success;
+	if (success) {
+		success = (BLI_rename(tmppath.ReadPtr(), m_path.ReadPtr()) == 0);
+	}
+
+	if (success) {
+		m_modified = false;
+		printf("Cooked data cache: saved %d entries in %s\n", (int)fileentries.size(), m_path.ReadPtr());
+	}
+	else {
+		BLI_delete(tmppath.ReadPtr(), false, false);
+		printf("Cooked data cache: failed to write %s\n", m_path.ReadPtr());
+	}
+
+	m_mutex.Unlock();
+
+	return success;
+}
+
+uint64_t KX_CookedDataCache::GetSourceKey(DataType type, const ID *id)
+{
+	KX_CookedDataKey key;
+	key.AddInt(type);
+	key.AddString(id->name);
+	key.AddString(id->lib ? id->lib->name : "");
+	return key.Get();
+}
+
+const STR_String& KX_CookedDataCache::GetPath() const
+{
+	return m_path;
+}
+
+int KX_CookedDataCache::GetNumHits() const
+{
+	return m_numHits;
+}
+
+int KX_CookedDataCache::GetNumMisses() const
+{
+	return m_numMisses;
+}
@@ -0,0 +1,189 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor(s): none yet.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file KX_CookedDataCache.h
+ *  \ingroup bgeconv
+ */
+
+#ifndef __KX_COOKED_DATA_CACHE_H__
+#define __KX_COOKED_DATA_CACHE_H__
+
+#include "EXP_Thread.h"
+#include "STR_String.h"
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+extern "C" {
+#include "BLI_hash_mm2a.h"
+}
+
+/** Content hash of the data used to cook, a change of the source data gives a new key.
+ * Two murmur hashes with different seeds are combined to make collisions unlikely. */
+class KX_CookedDataKey
+{
+private:
+	BLI_HashMurmur2A m_low;
+	BLI_HashMurmur2A m_high;
+
+public:
+	KX_CookedDataKey();
+
+	void Add(const void *data, size_t size);
+	void AddInt(int value);
+	void AddString(const char *str);
+	void AddKey(uint64_t key);
+
+	uint64_t Get();
+};
+
+/// Build the binary data of a cooked entry.
+class KX_CookedDataWriter
+{
+private:
+	std::vector<char> m_data;
+
+public:
+	void Write(const void *data, size_t size);
+	void WriteString(const char *str);
+	/// Pad the data so the next write is aligned, used for data used in place.
+	void Align(size_t alignment);
+
+	template <class T>
+	void Write(const T& value)
+	{
+		Write(&value, sizeof(T));
+	}
+
+	const void *GetData() const;
+	size_t GetSize() const;
+};
+
+/// Read the binary data of a cooked entry, every read is checked against the data size.
+class KX_CookedDataReader
+{
+private:
+	const char *m_data;
+	size_t m_size;
+	size_t m_offset;
+	bool m_valid;
+
+public:
+	KX_CookedDataReader(const void *data, size_t size);
+
+	/// Return a pointer to the next size bytes, NULL if the data is too short.
+	const void *ReadData(size_t size);
+	bool Read(void *data, size_t size);
+	bool ReadString(STR_String& str);
+	void Align(size_t alignment);
+
+	template <class T>
+	bool Read(T& value)
+	{
+		return Read(&value, sizeof(T));
+	}
+
+	/// False after any read out of the data.
+	bool IsValid() const;
+};
+
+/** Cache of the converted data (display arrays, physics shapes, navigation meshes),
+ * saved in a file next to the .blend and memory mapped when the game starts.
+ *
+ * Every entry is keyed by a content hash of its source data-block, a modified data-block
+ * doesn't find its old entry and is converted again. The entries are also tagged by the
+ * data-block they come from, a new entry replaces the old entry of the same data-block
+ * when the file is saved. Find and Add can be used by asynchronous libloads.
+ */
+class KX_CookedDataCache
+{
+public:
+	enum DataType {
+		DATA_MESH = 0,
+		DATA_PHYSICS_MESH,
+		DATA_NAVMESH,
+		DATA_MAX
+	};
+
+private:
+	struct Entry {
+		uint64_t m_source;
+		unsigned int m_type;
+		/// Pointer in the mapped file or in m_newData.
+		const void *m_data;
+		size_t m_size;
+		/// The entry was found or added by this game, the unused entries of a modified source are removed.
+		bool m_used;
+	};
+
+	STR_String m_path;
+
+	/// The mapped file, NULL if there's no valid cache file.
+	void *m_fileData;
+	size_t m_fileSize;
+	/// True if the file is memory mapped, else it's read in a buffer.
+	bool m_fileMapped;
+
+	std::map<uint64_t, Entry> m_entries;
+	/// Data of the entries added since the file was read, aligned on 16 bytes.
+	std::vector<void *> m_newData;
+	bool m_modified;
+
+	int m_numHits;
+	int m_numMisses;
+
+	CThreadMutex m_mutex;
+
+	bool Read();
+	void FreeFileData();
+
+public:
+	/// \param blendpath The path of the .blend file, the cache file is next to it.
+	KX_CookedDataCache(const char *blendpath);
+	~KX_CookedDataCache();
+
+	/** Return the cooked data of a key or NULL when it's missing. The data
+	 * stays valid until the cache is freed and is aligned on 16 bytes.
+	 */
+	const void *Find(DataType type, uint64_t key, size_t& size);
+	/** Add cooked data, the data is copied.
+	 * \param source Identifier of the source data-block, see GetSourceKey.
+	 */
+	void Add(DataType type, uint64_t key, uint64_t source, const void *data, size_t size);
+
+	/// Write the file if entries were added.
+	bool Save();
+
+	/// Identifier of a data-block independant of its content.
+	static uint64_t GetSourceKey(DataType type, const struct ID *id);
+
+	const STR_String& GetPath() const;
+	int GetNumHits() const;
+	int GetNumMisses() const;
+
+#ifdef WITH_CXX_GUARDEDALLOC
+	MEM_CXX_CLASS_ALLOC_FUNCS("GE:KX_CookedDataCache")
+#endif
+};
+
+#endif  // __KX_COOKED_DATA_CACHE_H__
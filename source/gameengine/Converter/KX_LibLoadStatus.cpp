@@ -27,6 +27,12 @@
 #include "KX_LibLoadStatus.h"
 #include "PIL_time.h"
 
+/* Part of the global progress taken by each stage. */
+static const float libload_stage_weights[KX_LibLoadStatus::LIBLOAD_STAGE_MAX] = {0.2f, 0.6f, 0.2f};
+#ifdef WITH_PYTHON
+static const char *libload_stage_names[KX_LibLoadStatus::LIBLOAD_STAGE_MAX] = {"READ", "CONVERT", "MERGE"};
+#endif
+
 KX_LibLoadStatus::KX_LibLoadStatus(class KX_BlenderSceneConverter* kx_converter,
 				class KX_KetsjiEngine* kx_engine,
 				class KX_Scene* merge_scene,
@@ -37,6 +43,8 @@ KX_LibLoadStatus::KX_LibLoadStatus(class KX_BlenderSceneConverter* kx_converter,
 			m_data(NULL),
 			m_libname(path),
 			m_progress(0.0f),
+			m_stageprogress(0.0f),
+			m_stage(LIBLOAD_STAGE_READ),
 			m_finished(false)
 #ifdef WITH_PYTHON
 			,
@@ -51,6 +59,8 @@ void KX_LibLoadStatus::Finish()
 {
 	m_finished = true;
 	m_progress = 1.f;
+	m_stage = LIBLOAD_STAGE_MERGE;
+	m_stageprogress = 1.f;
 	m_endtime = PIL_check_seconds_timer();
 
 	RunFinishCallback();
@@ -146,6 +156,33 @@ void KX_LibLoadStatus::AddProgress(float progress)
 	RunProgressCallback();
 }
 
+void KX_LibLoadStatus::SetStage(LibLoadStage stage)
+{
+	m_stage = stage;
+	SetStageProgress(0.0f);
+}
+
+KX_LibLoadStatus::LibLoadStage KX_LibLoadStatus::GetStage()
+{
+	return m_stage;
+}
+
+void KX_LibLoadStatus::SetStageProgress(float progress)
+{
+	float done = 0.0f;
+	for (int i = 0; i < m_stage; ++i) {
+		done += libload_stage_weights[i];
+	}
+
+	m_stageprogress = progress;
+	SetProgress(done + libload_stage_weights[m_stage] * progress);
+}
+
+float KX_LibLoadStatus::GetStageProgress()
+{
+	return m_stageprogress;
+}
+
 #ifdef WITH_PYTHON
 
 PyMethodDef KX_LibLoadStatus::Methods[] = 
@@ -157,6 +194,8 @@ PyAttributeDef KX_LibLoadStatus::Attributes[] = {
 	KX_PYATTRIBUTE_RW_FUNCTION("onFinish", KX_LibLoadStatus, pyattr_get_onfinish, pyattr_set_onfinish),
 	// KX_PYATTRIBUTE_RW_FUNCTION("onProgress", KX_LibLoadStatus, pyattr_get_onprogress, pyattr_set_onprogress),
 	KX_PYATTRIBUTE_FLOAT_RO("progress", KX_LibLoadStatus, m_progress),
+	KX_PYATTRIBUTE_RO_FUNCTION("stage", KX_LibLoadStatus, pyattr_get_stage),
+	KX_PYATTRIBUTE_FLOAT_RO("stageProgress", KX_LibLoadStatus, m_stageprogress),
 	KX_PYATTRIBUTE_STRING_RO("libraryName", KX_LibLoadStatus, m_libname),
 	KX_PYATTRIBUTE_RO_FUNCTION("timeTaken", KX_LibLoadStatus, pyattr_get_timetaken),
 	KX_PYATTRIBUTE_BOOL_RO("finished", KX_LibLoadStatus, m_finished),
@@ -252,4 +291,11 @@ PyObject* KX_LibLoadStatus::pyattr_get_timetaken(void *self_v, const KX_PYATTRIB
 
 	return PyFloat_FromDouble(self->m_endtime - self->m_starttime);
 }
+
+PyObject* KX_LibLoadStatus::pyattr_get_stage(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef)
+{
+	KX_LibLoadStatus* self = static_cast<KX_LibLoadStatus*>(self_v);
+
+	return PyUnicode_FromString(libload_stage_names[self->m_stage]);
+}
 #endif // WITH_PYTHON
@@ -32,6 +32,15 @@
 class KX_LibLoadStatus : public PyObjectPlus
 {
 	Py_Header
+public:
+	// The stages of a libload, an asynchronous libload goes through all of them.
+	enum LibLoadStage {
+		LIBLOAD_STAGE_READ = 0, // Reading the file and linking the datablocks
+		LIBLOAD_STAGE_CONVERT, // Converting scenes, meshes, materials and physics shapes
+		LIBLOAD_STAGE_MERGE, // Merging into the scene, time sliced over the frames
+		LIBLOAD_STAGE_MAX
+	};
+
 private:
 	class KX_BlenderSceneConverter*	m_converter;
 	class KX_KetsjiEngine*			m_engine;
@@ -40,6 +49,8 @@ private:
 	STR_String						m_libname;
 
 	float	m_progress;
+	float	m_stageprogress;
+	LibLoadStage	m_stage;
 	double	m_starttime;
 	double	m_endtime;
 
@@ -80,6 +91,13 @@ public:
 	float GetProgress();
 	void AddProgress(float progress);
 
+	/* Set the current stage and its progress, the global
+	 * progress is computed from the stages weights. */
+	void SetStage(LibLoadStage stage);
+	LibLoadStage GetStage();
+	void SetStageProgress(float progress);
+	float GetStageProgress();
+
 #ifdef WITH_PYTHON
 	static PyObject*	pyattr_get_onfinish(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef);
 	static int			pyattr_set_onfinish(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef, PyObject *value);
@@ -87,6 +105,7 @@ public:
 	static int			pyattr_set_onprogress(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef, PyObject *value);
 
 	static PyObject*	pyattr_get_timetaken(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef);
+	static PyObject*	pyattr_get_stage(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef);
 #endif
 };
 
@@ -472,7 +472,8 @@ static void usage(const char* program, bool isBlenderPlayer)
 #endif
 	printf("  -d: debugging options:\n");
 	printf("       memory        Debug memory leaks\n");
-	printf("       gpu           Debug gpu error and warnings\n\n");
+	printf("       gpu           Debug gpu error and warnings\n");
+	printf("       io            Print the timings of the .blend file reading\n\n");
 	printf("  -g: game engine options:\n\n");
 	printf("       Name                       Default      Description\n");
 	printf("       ------------------------------------------------------------------------\n");
@@ -482,6 +483,8 @@ static void usage(const char* program, bool isBlenderPlayer)
 	printf("       show_framerate                 0         Show the frame rate\n");
 	printf("       show_properties                0         Show debug properties\n");
 	printf("       show_profile                   0         Show profiling information\n");
+	printf("       cooked_cache                   0         Reuse the converted data and shaders saved next to the file\n");
+	printf("       texture_streaming              0         Load the image textures in the background\n");
 	printf("       ignore_deprecation_warnings    1         Ignore deprecation warnings\n\n");
 	printf("  -p: override python main loop script\n");
 	printf("\n");
@@ -810,6 +813,10 @@ int main(
 					G.debug |= G_DEBUG_GPU | G_DEBUG;
 					++i;
 				}
+				else if (strcmp(argv[i], "io") == 0) {
+					G.debug |= G_DEBUG_IO;
+					++i;
+				}
 				else if (strcmp(argv[i], "memory") == 0) {
 					G.debug |= G_DEBUG;
 
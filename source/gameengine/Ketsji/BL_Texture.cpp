@@ -24,12 +24,32 @@
 
 #include "BL_Texture.h"
 #include "KX_CubeMap.h"
+#include "KX_Globals.h"
+#include "KX_KetsjiEngine.h"
+#include "KX_TextureStreamer.h"
 
 #include "DNA_texture_types.h"
 
 #include "GPU_texture.h"
 #include "GPU_draw.h"
 
+/// Get the gpu texture of the image of a texture, a 2D image is streamed if the streaming is enabled.
+static GPUTexture *texture_from_blender(Tex *tex, bool isCubeMap, int gltextarget)
+{
+	Image *ima = tex->ima;
+	if (!ima) {
+		return NULL;
+	}
+
+	// The planar textures use the size of the image when they are converted.
+	KX_TextureStreamer *streamer = KX_GetActiveEngine()->GetTextureStreamer();
+	if (streamer && !isCubeMap && !(tex->planarflag & (TEX_PLANAR_REFLECTION | TEX_PLANAR_REFRACTION))) {
+		streamer->AddImage(ima);
+	}
+
+	return GPU_texture_from_blender(ima, &tex->iuser, gltextarget, false, 0.0, true);
+}
+
 BL_Texture::BL_Texture(MTex *mtex)
 	:CValue(),
 	m_isCubeMap(false),
@@ -40,11 +60,9 @@ BL_Texture::BL_Texture(MTex *mtex)
 	EnvMap *env = tex->env;
 	m_isCubeMap = (env && tex->type == TEX_ENVMAP && (env->stype == ENV_LOAD || env->stype == ENV_REALT));
 
-	Image *ima = tex->ima;
-	ImageUser& iuser = tex->iuser;
 	const int gltextarget = m_isCubeMap ? GetCubeMapTextureType() : GetTexture2DType();
 
-	m_gpuTex = (ima ? GPU_texture_from_blender(ima, &iuser, gltextarget, false, 0.0, true) : NULL);
+	m_gpuTex = texture_from_blender(tex, m_isCubeMap, gltextarget);
 
 	// Initialize saved data.
 	m_name = STR_String(m_mtex->tex->id.name + 2);
@@ -104,17 +122,13 @@ void BL_Texture::CheckValidTexture()
 	 */
 	int target = m_isCubeMap ? TEXTARGET_TEXTURE_CUBE_MAP : TEXTARGET_TEXTURE_2D;
 	if (m_gpuTex != m_mtex->tex->ima->gputexture[target]) {
-		Tex *tex = m_mtex->tex;
-		Image *ima = tex->ima;
-		ImageUser& iuser = tex->iuser;
-
 		const int gltextarget = m_isCubeMap ? GetCubeMapTextureType() : GetTexture2DType();
 
 		// Restore gpu texture original bind cdoe to make sure we will delete the right opengl texture.
 		GPU_texture_set_opengl_bindcode(m_gpuTex, m_savedData.bindcode);
 		GPU_texture_free(m_gpuTex);
 
-		m_gpuTex = (ima ? GPU_texture_from_blender(ima, &iuser, gltextarget, false, 0.0, true) : NULL);
+		m_gpuTex = texture_from_blender(m_mtex->tex, m_isCubeMap, gltextarget);
 
 		if (m_gpuTex) {
 			int bindCode = GPU_texture_opengl_bindcode(m_gpuTex);
@@ -68,6 +68,8 @@
 #include "KX_WorldInfo.h"
 #include "KX_ISceneConverter.h"
 #include "KX_TimeCategoryLogger.h"
+#include "KX_StreamingManager.h"
+#include "KX_TextureStreamer.h"
 
 #include "RAS_FramingManager.h"
 #include "DNA_world_types.h"
@@ -88,6 +90,7 @@ const char KX_KetsjiEngine::m_profileLabels[tc_numCategories][15] = {
 	"Logic:", // tc_logic
 	"Animations:", // tc_animations
 	"Network:", // tc_network
+	"Streaming:", // tc_streaming
 	"Scenegraph:", // tc_scenegraph
 	"Rasterizer:", // tc_rasterizer
 	"Services:", // tc_services
@@ -169,6 +172,7 @@ KX_KetsjiEngine::KX_KetsjiEngine(KX_ISystem *system)
 #endif
 
 	m_taskscheduler = BLI_task_scheduler_create(TASK_SCHEDULER_AUTO_THREADS);
+	m_textureStreamer = NULL;
 
 	m_scenes = new CListValue();
 }
@@ -184,6 +188,10 @@ KX_KetsjiEngine::~KX_KetsjiEngine()
 	Py_CLEAR(m_pyprofiledict);
 #endif
 
+	// The streamer uses the task scheduler.
+	if (m_textureStreamer)
+		delete m_textureStreamer;
+
 	if (m_taskscheduler)
 		BLI_task_scheduler_free(m_taskscheduler);
 
@@ -237,6 +245,13 @@ void KX_KetsjiEngine::SetSceneConverter(KX_ISceneConverter *sceneconverter)
 	m_sceneconverter = sceneconverter;
 }
 
+void KX_KetsjiEngine::EnableTextureStreaming()
+{
+	if (!m_textureStreamer) {
+		m_textureStreamer = new KX_TextureStreamer(m_taskscheduler);
+	}
+}
+
 /**
  * Ketsji Init(), Initializes data-structures and converts data from
  * Blender into Ketsji native (realtime) format also sets up the
@@ -395,8 +410,18 @@ bool KX_KetsjiEngine::NextFrame()
 	while (frames) {
 		m_frameTime += framestep;
 
+		m_logger->StartLog(tc_streaming, m_kxsystem->GetTimeInSeconds(), true);
+		for (CListValue::iterator sceit = m_scenes->GetBegin(); sceit != m_scenes->GetEnd(); ++sceit) {
+			KX_Scene *scene = (KX_Scene *)*sceit;
+			if (!scene->IsSuspended()) {
+				scene->GetStreamingManager()->Update(m_frameTime);
+			}
+		}
+
 		m_sceneconverter->MergeAsyncLoads();
 
+		m_logger->StartLog(tc_services, m_kxsystem->GetTimeInSeconds(), true);
+
 		if (m_inputDevice) {
 			m_inputDevice->ReleaseMoveEvent();
 		}
@@ -540,6 +565,12 @@ void KX_KetsjiEngine::Render()
 
 	BeginFrame();
 
+	if (m_textureStreamer) {
+		m_logger->StartLog(tc_streaming, m_kxsystem->GetTimeInSeconds(), true);
+		m_textureStreamer->Update();
+		m_logger->StartLog(tc_rasterizer, m_kxsystem->GetTimeInSeconds(), true);
+	}
+
 	for (CListValue::iterator sceit = m_scenes->GetBegin(), sceend = m_scenes->GetEnd(); sceit != sceend; ++sceit) {
 		KX_Scene *scene = (KX_Scene *)*sceit;
 		// shadow buffers
@@ -1086,6 +1117,10 @@ void KX_KetsjiEngine::StopEngine()
 			m_scenes->Remove(0);
 		}
 
+		if (m_textureStreamer) {
+			m_textureStreamer->Finish();
+		}
+
 		// cleanup all the stuff
 		m_rasterizer->Exit();
 	}
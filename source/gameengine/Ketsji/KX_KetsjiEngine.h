@@ -47,6 +47,7 @@ class KX_TimeCategoryLogger;
 class KX_ISystem;
 class KX_ISceneConverter;
 class KX_NetworkMessageManager;
+class KX_TextureStreamer;
 class CListValue;
 class RAS_ICanvas;
 class RAS_IRasterizer;
@@ -172,6 +173,7 @@ private:
 		tc_logic,
 		tc_animations,
 		tc_network,
+		tc_streaming, // libraries and textures streaming, asynchronous loads merging
 		tc_scenegraph,
 		tc_rasterizer,
 		tc_services, // time spent in miscelaneous activities
@@ -226,6 +228,9 @@ private:
 	/// Task scheduler for multi-threading
 	TaskScheduler *m_taskscheduler;
 
+	/// Streamer of the image textures, NULL if the textures are created synchronously.
+	KX_TextureStreamer *m_textureStreamer;
+
 	/** Set scene's total pause duration for animations process.
 	 * This is done in a separate loop to get the proper state of each scenes.
 	 * eg: There's 2 scenes, the first is suspended and the second is active.
@@ -287,6 +292,13 @@ public:
 		return m_taskscheduler;
 	}
 
+	/// Stream the image textures instead of creating them when the materials are converted.
+	void EnableTextureStreaming();
+	KX_TextureStreamer *GetTextureStreamer() const
+	{
+		return m_textureStreamer;
+	}
+
 	/// returns true if an update happened to indicate -> Render
 	bool NextFrame();
 	void Render();
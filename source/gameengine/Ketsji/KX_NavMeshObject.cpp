@@ -35,8 +35,10 @@
 
 #include "DNA_mesh_types.h"
 #include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
 
 extern "C" {
+#include "BLI_listbase.h"
 #include "BKE_scene.h"
 #include "BKE_customdata.h"
 #include "BKE_cdderivedmesh.h"
@@ -45,6 +47,9 @@ extern "C" {
 }
 
 #include "KX_Globals.h"
+#include "KX_KetsjiEngine.h"
+#include "KX_BlenderSceneConverter.h"
+#include "KX_CookedDataCache.h"
 #include "KX_PyMath.h"
 #include "EXP_Value.h"
 #include "Recast.h"
@@ -283,6 +288,25 @@ bool KX_NavMeshObject::BuildVertIndArrays(float *&vertices, int& nverts,
 }
 
 
+/// Check the navigation mesh data of the cooked data cache like dtStatNavMesh::init but with the data size.
+static bool navmesh_cooked_data_valid(const void *data, size_t size)
+{
+	if (size < sizeof(dtStatNavMeshHeader)) {
+		return false;
+	}
+
+	const dtStatNavMeshHeader *header = (const dtStatNavMeshHeader *)data;
+	if (header->magic != DT_STAT_NAVMESH_MAGIC || header->version != DT_STAT_NAVMESH_VERSION) {
+		return false;
+	}
+
+	const size_t dataSize = sizeof(dtStatNavMeshHeader) + sizeof(float) * 3 * header->nverts +
+		sizeof(dtStatPoly) * header->npolys + sizeof(dtStatBVNode) * header->npolys * 2 +
+		sizeof(dtStatPolyDetail) * header->ndmeshes + sizeof(float) * 3 * header->ndverts +
+		sizeof(unsigned char) * 4 * header->ndtris;
+	return (dataSize == size);
+}
+
 bool KX_NavMeshObject::BuildNavMesh()
 {
 	if (m_navMesh)
@@ -297,6 +321,37 @@ bool KX_NavMeshObject::BuildNavMesh()
 		return false;
 	}
 
+	/* The navigation mesh only depends on the mesh data when the object has no modifiers,
+	 * its key is made from the key of the converted mesh and the recast data. */
+	KX_CookedDataCache *cookedcache = ((KX_BlenderSceneConverter *)KX_GetActiveEngine()->GetSceneConverter())->GetCookedDataCache();
+	Object *blenderobj = GetBlenderObject();
+	RAS_MeshObject *meshobj = GetMesh(0);
+	uint64_t cookedkey = 0;
+	if (cookedcache && BLI_listbase_is_empty(&blenderobj->modifiers) && meshobj->GetCookedKey() != 0 &&
+		meshobj->GetMesh() == blenderobj->data)
+	{
+		Mesh *mesh = meshobj->GetMesh();
+		KX_CookedDataKey key;
+		key.AddInt(KX_CookedDataCache::DATA_NAVMESH);
+		key.AddKey(meshobj->GetCookedKey());
+		const int *recastData = (const int *)CustomData_get_layer(&mesh->pdata, CD_RECAST);
+		key.AddInt(recastData != NULL);
+		if (recastData) {
+			key.Add(recastData, sizeof(int) * mesh->totpoly);
+		}
+		cookedkey = key.Get();
+
+		size_t cookedsize;
+		const void *cookeddata = cookedcache->Find(KX_CookedDataCache::DATA_NAVMESH, cookedkey, cookedsize);
+		if (cookeddata && navmesh_cooked_data_valid(cookeddata, cookedsize)) {
+			unsigned char *data = new unsigned char[cookedsize];
+			memcpy(data, cookeddata, cookedsize);
+			m_navMesh = new dtStatNavMesh;
+			m_navMesh->init(data, cookedsize, true);
+			return true;
+		}
+	}
+
 	float *vertices = NULL, *dvertices = NULL;
 	unsigned short *polys = NULL, *dtris = NULL, *dmeshes = NULL;
 	int nverts = 0, npolys = 0, ndvertsuniq = 0, ndtris = 0;
@@ -467,6 +522,13 @@ bool KX_NavMeshObject::BuildNavMesh()
 		}
 	}
 
+	// Added before the initialization which sets pointers in the header.
+	if (cookedkey) {
+		cookedcache->Add(KX_CookedDataCache::DATA_NAVMESH, cookedkey,
+		                 KX_CookedDataCache::GetSourceKey(KX_CookedDataCache::DATA_NAVMESH, &blenderobj->id),
+		                 data, dataSize);
+	}
+
 	m_navMesh = new dtStatNavMesh;
 	m_navMesh->init(data, dataSize, true);
 
@@ -144,6 +144,7 @@ extern "C" {
 /* for converting new scenes */
 #include "KX_BlenderSceneConverter.h"
 #include "KX_LibLoadStatus.h"
+#include "KX_TextureStreamer.h"
 #include "KX_MeshProxy.h" /* for creating a new library of mesh objects */
 extern "C" {
 	#include "BKE_idcode.h"
@@ -762,6 +763,126 @@ static PyObject *gLibList(PyObject *, PyObject *args)
 	return list;
 }
 
+static PyObject *gLibSetMergeBudget(PyObject *, PyObject *args)
+{
+	float budget;
+	if (!PyArg_ParseTuple(args, "f:setLibLoadMergeBudget", &budget))
+		return NULL;
+
+	if (budget <= 0.0f) {
+		PyErr_SetString(PyExc_ValueError, "setLibLoadMergeBudget(budget): expected a budget greater than 0");
+		return NULL;
+	}
+
+	KX_GetActiveScene()->GetSceneConverter()->SetMergeBudget(budget);
+	Py_RETURN_NONE;
+}
+
+static PyObject *gLibGetMergeBudget(PyObject *)
+{
+	return PyFloat_FromDouble(KX_GetActiveScene()->GetSceneConverter()->GetMergeBudget());
+}
+
+static KX_TextureStreamer *getTextureStreamer(const char *funcname)
+{
+	KX_TextureStreamer *streamer = KX_GetActiveEngine()->GetTextureStreamer();
+	if (!streamer) {
+		PyErr_Format(PyExc_RuntimeError, "%s: texture streaming is disabled", funcname);
+	}
+	return streamer;
+}
+
+static PyObject *gPySetTextureUploadBudget(PyObject *, PyObject *args)
+{
+	int budget;
+	if (!PyArg_ParseTuple(args, "i:setTextureUploadBudget", &budget))
+		return NULL;
+
+	if (budget <= 0) {
+		PyErr_SetString(PyExc_ValueError, "setTextureUploadBudget(budget): expected a budget greater than 0");
+		return NULL;
+	}
+
+	KX_TextureStreamer *streamer = getTextureStreamer("setTextureUploadBudget(budget)");
+	if (!streamer)
+		return NULL;
+
+	streamer->SetUploadBudget((size_t)budget * 1024);
+	Py_RETURN_NONE;
+}
+
+static PyObject *gPyGetTextureUploadBudget(PyObject *)
+{
+	KX_TextureStreamer *streamer = getTextureStreamer("getTextureUploadBudget()");
+	if (!streamer)
+		return NULL;
+
+	return PyLong_FromSize_t(streamer->GetUploadBudget() / 1024);
+}
+
+static PyObject *gPyFlushTextureStreaming(PyObject *)
+{
+	KX_TextureStreamer *streamer = getTextureStreamer("flushTextureStreaming()");
+	if (!streamer)
+		return NULL;
+
+	streamer->Flush();
+	Py_RETURN_NONE;
+}
+
+static PyObject *gPyGetTextureStreamingStats(PyObject *)
+{
+	KX_TextureStreamer *streamer = getTextureStreamer("getTextureStreamingStats()");
+	if (!streamer)
+		return NULL;
+
+	PyObject *stats = PyDict_New();
+	PyObject *item;
+
+	PyDict_SetItemString(stats, "pending", item = PyLong_FromLong(streamer->GetNumPending()));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "streamed", item = PyLong_FromLong(streamer->GetNumStreamed()));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "queuedBytes", item = PyLong_FromSize_t(streamer->GetQueuedBytes()));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "uploadedBytes", item = PyLong_FromSize_t(streamer->GetUploadedBytes()));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "uploadTime", item = PyFloat_FromDouble(streamer->GetUploadTime() * 1000.0));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "stallTime", item = PyFloat_FromDouble(streamer->GetStallTime() * 1000.0));
+	Py_DECREF(item);
+
+	return stats;
+}
+
+static PyObject *gPyGetShaderCacheStats(PyObject *)
+{
+	GPUPassCacheStats cachestats;
+	GPU_pass_cache_stats(&cachestats);
+
+	PyObject *stats = PyDict_New();
+	PyObject *item;
+
+	PyDict_SetItemString(stats, "generated", item = PyLong_FromLong(cachestats.num_generated));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "shared", item = PyLong_FromLong(cachestats.num_shared));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "compiled", item = PyLong_FromLong(cachestats.num_compiled));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "loaded", item = PyLong_FromLong(cachestats.num_loaded));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "shaders", item = PyLong_FromLong(cachestats.num_shaders));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "fileEntries", item = PyLong_FromLong(cachestats.num_file_entries));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "generateTime", item = PyFloat_FromDouble(cachestats.generate_time * 1000.0));
+	Py_DECREF(item);
+	PyDict_SetItemString(stats, "compileTime", item = PyFloat_FromDouble(cachestats.compile_time * 1000.0));
+	Py_DECREF(item);
+
+	return stats;
+}
+
 struct PyNextFrameState pynextframestate;
 static PyObject *gPyNextFrame(PyObject *)
 {
@@ -830,6 +951,13 @@ static struct PyMethodDef game_methods[] = {
 	{"LibNew", (PyCFunction)gLibNew, METH_VARARGS, (const char *)""},
 	{"LibFree", (PyCFunction)gLibFree, METH_VARARGS, (const char *)""},
 	{"LibList", (PyCFunction)gLibList, METH_VARARGS, (const char *)""},
+	{"setLibLoadMergeBudget", (PyCFunction)gLibSetMergeBudget, METH_VARARGS, (const char *)"Sets the time in milliseconds spent each frame merging asynchronous LibLoad"},
+	{"getLibLoadMergeBudget", (PyCFunction)gLibGetMergeBudget, METH_NOARGS, (const char *)"Gets the time in milliseconds spent each frame merging asynchronous LibLoad"},
+	{"setTextureUploadBudget", (PyCFunction)gPySetTextureUploadBudget, METH_VARARGS, (const char *)"Sets the kilobytes of streamed textures uploaded each frame"},
+	{"getTextureUploadBudget", (PyCFunction)gPyGetTextureUploadBudget, METH_NOARGS, (const char *)"Gets the kilobytes of streamed textures uploaded each frame"},
+	{"flushTextureStreaming", (PyCFunction)gPyFlushTextureStreaming, METH_NOARGS, (const char *)"Loads and uploads all the streamed textures now"},
+	{"getTextureStreamingStats", (PyCFunction)gPyGetTextureStreamingStats, METH_NOARGS, (const char *)"Gets the counters of the texture streaming"},
+	{"getShaderCacheStats", (PyCFunction)gPyGetShaderCacheStats, METH_NOARGS, (const char *)"Gets the counters of the material shader cache"},
 	
 	{NULL, (PyCFunction) NULL, 0, NULL }
 };
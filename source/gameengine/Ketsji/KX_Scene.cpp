@@ -67,6 +67,7 @@
 #include "RAS_CubeMap.h"
 #include "RAS_Planar.h"
 #include "KX_2DFilterManager.h"
+#include "KX_StreamingManager.h"
 #include "KX_PlanarManager.h"
 #include "KX_CubeMapManager.h"
 #include "RAS_BucketManager.h"
@@ -177,6 +178,7 @@ KX_Scene::KX_Scene(SCA_IInputDevice *inputDevice,
 	m_fontlist = new CListValue();
 
 	m_filterManager = new KX_2DFilterManager();
+	m_streamingManager = new KX_StreamingManager(this);
 	m_logicmgr = new SCA_LogicManager();
 	
 	m_timemgr = new SCA_TimeEventManager(m_logicmgr);
@@ -275,6 +277,10 @@ KX_Scene::~KX_Scene()
 		delete m_filterManager;
 	}
 
+	if (m_streamingManager) {
+		delete m_streamingManager;
+	}
+
 	if (m_logicmgr)
 		delete m_logicmgr;
 
@@ -1877,7 +1883,8 @@ static void MergeScene_LogicBrick(SCA_ILogicBrick* brick, KX_Scene *from, KX_Sce
 	if (pyctrl) {
 		pyctrl->SetNamespace(KX_GetActiveEngine()->GetPyNamespace());
 
-		if (pyctrl->m_mode==SCA_PythonController::SCA_PYEXEC_SCRIPT)
+		// The script may already be compiled by KX_Scene::PrepareMergeGameObject.
+		if (pyctrl->m_mode==SCA_PythonController::SCA_PYEXEC_SCRIPT && pyctrl->m_bModified)
 			pyctrl->Compile();
 	}
 #endif
@@ -1917,18 +1924,6 @@ static void MergeScene_GameObject(KX_GameObject* gameobj, KX_Scene *to, KX_Scene
 		}
 	}
 
-	/* graphics controller */
-	PHY_IController *ctrl = gameobj->GetGraphicController();
-	if (ctrl) {
-		/* SHOULD update the m_cullingTree */
-		ctrl->SetPhysicsEnvironment(to->GetPhysicsEnvironment());
-	}
-
-	ctrl = gameobj->GetPhysicsController();
-	if (ctrl) {
-		ctrl->SetPhysicsEnvironment(to->GetPhysicsEnvironment());
-	}
-
 	/* SG_Node can hold a scene reference */
 	SG_Node *sg= gameobj->GetSGNode();
 	if (sg) {
@@ -1961,7 +1956,22 @@ static void MergeScene_GameObject(KX_GameObject* gameobj, KX_Scene *to, KX_Scene
 	}
 }
 
-bool KX_Scene::MergeScene(KX_Scene *other)
+void KX_Scene::PrepareMergeGameObject(KX_GameObject *gameobj)
+{
+#ifdef WITH_PYTHON
+	// Compiling the scripts is the costly part of merging the logic bricks.
+	SCA_ControllerList& controllers = gameobj->GetControllers();
+
+	for (SCA_ControllerList::iterator itc = controllers.begin(); !(itc == controllers.end()); ++itc) {
+		SCA_PythonController *pyctrl = dynamic_cast<SCA_PythonController*>(*itc);
+		if (pyctrl && pyctrl->m_mode == SCA_PythonController::SCA_PYEXEC_SCRIPT && pyctrl->m_bModified) {
+			pyctrl->Compile();
+		}
+	}
+#endif
+}
+
+bool KX_Scene::CanMergeScene(KX_Scene *other)
 {
 	PHY_IPhysicsEnvironment *env = this->GetPhysicsEnvironment();
 	PHY_IPhysicsEnvironment *env_other = other->GetPhysicsEnvironment();
@@ -1978,7 +1988,78 @@ bool KX_Scene::MergeScene(KX_Scene *other)
 		return false;
 	}
 
+	return true;
+}
+
+void KX_Scene::MergeScenePhysicsObject(KX_GameObject *gameobj)
+{
+	/* graphics controller */
+	PHY_IController *ctrl = gameobj->GetGraphicController();
+	if (ctrl) {
+		/* SHOULD update the m_cullingTree */
+		ctrl->SetPhysicsEnvironment(GetPhysicsEnvironment());
+	}
+
+	ctrl = gameobj->GetPhysicsController();
+	if (ctrl) {
+		ctrl->SetPhysicsEnvironment(GetPhysicsEnvironment());
+	}
+}
+
+void KX_Scene::MergeScenePhysics(KX_Scene *other, std::vector<KX_GameObject *>& physicsObjects)
+{
+	PHY_IPhysicsEnvironment *env = this->GetPhysicsEnvironment();
+
+	if (env) {
+		env->MergeEnvironment(other->GetPhysicsEnvironment());
+		CListValue *otherObjects = other->GetObjectList();
+
+		// List of all physics objects to merge (needed by ReplicateConstraints).
+		for (unsigned int i = 0; i < otherObjects->GetCount(); ++i) {
+			KX_GameObject *gameobj = (KX_GameObject *)otherObjects->GetValue(i);
+			if (gameobj->GetPhysicsController()) {
+				physicsObjects.push_back(gameobj);
+			}
+		}
+	}
+}
+
+void KX_Scene::MergeSceneConstraints(KX_GameObject *gameobj, const std::vector<KX_GameObject *>& physicsObjects)
+{
+	// Replicate all constraints in the right physics environment.
+	gameobj->GetPhysicsController()->ReplicateConstraints(gameobj, physicsObjects);
+	gameobj->ClearConstraints();
+}
+
+bool KX_Scene::MergeScene(KX_Scene *other)
+{
+	if (!CanMergeScene(other)) {
+		return false;
+	}
+
+	/* active + inactive == all ??? - lets hope so */
+	for (int i = 0; i < other->GetObjectList()->GetCount(); i++) {
+		MergeScenePhysicsObject((KX_GameObject *)other->GetObjectList()->GetValue(i));
+	}
+
+	for (int i = 0; i < other->GetInactiveList()->GetCount(); i++) {
+		MergeScenePhysicsObject((KX_GameObject *)other->GetInactiveList()->GetValue(i));
+	}
+
+	std::vector<KX_GameObject *> physicsObjects;
+	MergeScenePhysics(other, physicsObjects);
+
+	for (unsigned int i = 0; i < physicsObjects.size(); ++i) {
+		MergeSceneConstraints(physicsObjects[i], physicsObjects);
+	}
+
+	MergeSceneFinish(other);
+
+	return true;
+}
 
+void KX_Scene::MergeSceneFinish(KX_Scene *other)
+{
 	GetBucketManager()->MergeBucketManager(other->GetBucketManager(), this);
 
 
@@ -2000,27 +2081,6 @@ bool KX_Scene::MergeScene(KX_Scene *other)
 		MergeScene_GameObject(gameobj, this, other);
 	}
 
-	if (env) {
-		env->MergeEnvironment(env_other);
-		CListValue *otherObjects = other->GetObjectList();
-
-		// List of all physics objects to merge (needed by ReplicateConstraints).
-		std::vector<KX_GameObject *> physicsObjects;
-		for (unsigned int i = 0; i < otherObjects->GetCount(); ++i) {
-			KX_GameObject *gameobj = (KX_GameObject *)otherObjects->GetValue(i);
-			if (gameobj->GetPhysicsController()) {
-				physicsObjects.push_back(gameobj);
-			}
-		}
-
-		for (unsigned int i = 0; i < physicsObjects.size(); ++i) {
-			KX_GameObject *gameobj = physicsObjects[i];
-			// Replicate all constraints in the right physics environment.
-			gameobj->GetPhysicsController()->ReplicateConstraints(gameobj, physicsObjects);
-			gameobj->ClearConstraints();
-		}
-	}
-
 
 	GetTempObjectList()->MergeList(other->GetTempObjectList());
 	other->GetTempObjectList()->ReleaseAndRemoveAll();
@@ -2078,7 +2138,6 @@ bool KX_Scene::MergeScene(KX_Scene *other)
 		}
 		
 	}
-	return true;
 }
 
 RAS_2DFilterManager *KX_Scene::Get2DFilterManager() const
@@ -2086,6 +2145,11 @@ RAS_2DFilterManager *KX_Scene::Get2DFilterManager() const
 	return m_filterManager;
 }
 
+KX_StreamingManager *KX_Scene::GetStreamingManager() const
+{
+	return m_streamingManager;
+}
+
 void KX_Scene::Render2DFilters(RAS_IRasterizer *rasty, RAS_ICanvas *canvas, unsigned short target)
 {
 	m_filterManager->RenderFilters(rasty, canvas, target);
@@ -2292,6 +2356,13 @@ PyObject *KX_Scene::pyattr_get_filter_manager(void *self_v, const KX_PYATTRIBUTE
 	return filterManager->GetProxy();
 }
 
+PyObject *KX_Scene::pyattr_get_streaming_manager(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef)
+{
+	KX_Scene *self = static_cast<KX_Scene*>(self_v);
+
+	return self->GetStreamingManager()->GetProxy();
+}
+
 PyObject *KX_Scene::pyattr_get_world(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef)
 {
 	KX_Scene* self = static_cast<KX_Scene*>(self_v);
@@ -2448,6 +2519,7 @@ PyAttributeDef KX_Scene::Attributes[] = {
 	KX_PYATTRIBUTE_RO_FUNCTION("texts",				KX_Scene, pyattr_get_texts),
 	KX_PYATTRIBUTE_RO_FUNCTION("cameras",			KX_Scene, pyattr_get_cameras),
 	KX_PYATTRIBUTE_RO_FUNCTION("filterManager",		KX_Scene, pyattr_get_filter_manager),
+	KX_PYATTRIBUTE_RO_FUNCTION("streamingManager",	KX_Scene, pyattr_get_streaming_manager),
 	KX_PYATTRIBUTE_RO_FUNCTION("world",				KX_Scene, pyattr_get_world),
 	KX_PYATTRIBUTE_RW_FUNCTION("active_camera",		KX_Scene, pyattr_get_active_camera, pyattr_set_active_camera),
 	KX_PYATTRIBUTE_RW_FUNCTION("pre_draw",			KX_Scene, pyattr_get_drawing_callback_pre, pyattr_set_drawing_callback_pre),
@@ -82,6 +82,7 @@ class RAS_IRasterizer;
 class RAS_IRenderTools;
 class RAS_2DFilterManager;
 class KX_2DFilterManager;
+class KX_StreamingManager;
 class SCA_JoystickManager;
 class btCollisionShape;
 class KX_BlenderSceneConverter;
@@ -286,6 +287,8 @@ protected:
 
 	KX_2DFilterManager *m_filterManager;
 
+	KX_StreamingManager *m_streamingManager;
+
 	KX_ObstacleSimulation* m_obstacleSimulation;
 
 	/**
@@ -535,6 +538,7 @@ public:
 	 * 2D Filters
 	 */
 	RAS_2DFilterManager *Get2DFilterManager() const;
+	KX_StreamingManager *GetStreamingManager() const;
 	void Render2DFilters(RAS_IRasterizer *rasty, RAS_ICanvas *canvas, unsigned short target);
 
 	KX_ObstacleSimulation* GetObstacleSimulation() { return m_obstacleSimulation; }
@@ -568,6 +572,7 @@ public:
 	static PyObject*	pyattr_get_texts(void* self_v, const KX_PYATTRIBUTE_DEF *attrdef);
 	static PyObject*	pyattr_get_cameras(void* self_v, const KX_PYATTRIBUTE_DEF *attrdef);
 	static PyObject*	pyattr_get_filter_manager(void* self_v, const KX_PYATTRIBUTE_DEF *attrdef);
+	static PyObject*	pyattr_get_streaming_manager(void* self_v, const KX_PYATTRIBUTE_DEF *attrdef);
 	static PyObject*	pyattr_get_world(void* self_v, const KX_PYATTRIBUTE_DEF *attrdef);
 	static PyObject*	pyattr_get_active_camera(void* self_v, const KX_PYATTRIBUTE_DEF *attrdef);
 	static int			pyattr_set_active_camera(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef, PyObject *value);
@@ -620,6 +625,24 @@ public:
 	struct Scene *GetBlenderScene() { return m_blenderScene; }
 
 	bool MergeScene(KX_Scene *other);
+	/**
+	 * The steps of MergeScene, which lets a merge be spread over frames:
+	 * the physics objects are moved one by one into the physics environment,
+	 * then their constraints are replicated one by one, and MergeSceneFinish
+	 * merges everything else in one go. Until then the objects are only in
+	 * the physics environment of the scene merged into, not in its lists.
+	 */
+	bool CanMergeScene(KX_Scene *other);
+	void MergeScenePhysicsObject(KX_GameObject *gameobj);
+	/// Merges the remaining physics controllers and lists the physics objects to replicate the constraints of.
+	void MergeScenePhysics(KX_Scene *other, std::vector<KX_GameObject *>& physicsObjects);
+	void MergeSceneConstraints(KX_GameObject *gameobj, const std::vector<KX_GameObject *>& physicsObjects);
+	void MergeSceneFinish(KX_Scene *other);
+	/**
+	 * Does the work of merging an object of this scene which doesn't
+	 * modify the scene merged into, lets a merge be spread over frames.
+	 */
+	void PrepareMergeGameObject(KX_GameObject *gameobj);
 
 
 	//void PrintStats(int verbose_level) {
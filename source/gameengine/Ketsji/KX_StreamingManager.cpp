@@ -0,0 +1,380 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor(s): none yet.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file gameengine/Ketsji/KX_StreamingManager.cpp
+ *  \ingroup ketsji
+ */
+
+#include "KX_StreamingManager.h"
+#include "KX_Scene.h"
+#include "KX_Camera.h"
+#include "KX_Globals.h"
+#include "KX_LibLoadStatus.h"
+#include "KX_BlenderSceneConverter.h"
+
+#ifdef WITH_PYTHON
+#  include "KX_PyMath.h"
+#endif
+
+#include <algorithm>
+#include <float.h>
+#include <limits.h>
+
+extern "C" {
+#  include "BLI_fileops.h"
+#  include "BLI_path_util.h"
+#  include "BLI_string.h"
+#  include "BLI_utildefines.h"
+}
+
+KX_StreamingManager::KX_StreamingManager(KX_Scene *scene)
+	:m_scene(scene),
+	m_loadDistance(100.0f),
+	m_unloadDistance(150.0f),
+	m_lookAhead(1.0f),
+	m_maxPendingLoads(1),
+	m_memoryBudget(0),
+	m_lastPosition(0.0f, 0.0f, 0.0f),
+	m_velocity(0.0f, 0.0f, 0.0f),
+	m_lastTime(-1.0),
+	m_numPending(0),
+	m_numLoaded(0),
+	m_loadCount(0),
+	m_unloadCount(0),
+	m_failCount(0),
+	m_loadedMemory(0)
+{
+}
+
+KX_StreamingManager::~KX_StreamingManager()
+{
+	/* The libraries are owned by the scene converter, the loaded
+	 * ones stay until the converter frees them at the game end. */
+}
+
+KX_StreamingManager::Cell *KX_StreamingManager::FindCell(const char *path)
+{
+	for (std::vector<Cell>::iterator it = m_cells.begin(), end = m_cells.end(); it != end; ++it) {
+		if (BLI_path_cmp(it->m_path.ReadPtr(), path) == 0) {
+			return &(*it);
+		}
+	}
+	return NULL;
+}
+
+bool KX_StreamingManager::AddCell(const char *path, const MT_Vector3& position, float radius)
+{
+	if (FindCell(path)) {
+		return false;
+	}
+
+	Cell cell;
+	cell.m_path = path;
+	cell.m_position = position;
+	cell.m_radius = radius;
+	cell.m_size = BLI_exists(path) ? BLI_file_size(path) : 0;
+	cell.m_state = CELL_UNLOADED;
+	cell.m_status = NULL;
+	m_cells.push_back(cell);
+
+	return true;
+}
+
+bool KX_StreamingManager::RemoveCell(const char *path)
+{
+	for (std::vector<Cell>::iterator it = m_cells.begin(), end = m_cells.end(); it != end; ++it) {
+		if (BLI_path_cmp(it->m_path.ReadPtr(), path) == 0) {
+			// A loading library can't be freed until it's merged.
+			if (it->m_state == CELL_LOADING || (it->m_state == CELL_LOADED && !UnloadCell(*it))) {
+				return false;
+			}
+			m_cells.erase(it);
+			return true;
+		}
+	}
+	return false;
+}
+
+KX_StreamingManager::CellState KX_StreamingManager::GetCellState(const char *path)
+{
+	Cell *cell = FindCell(path);
+	return (cell) ? cell->m_state : CELL_UNLOADED;
+}
+
+void KX_StreamingManager::LoadCell(Cell& cell)
+{
+	KX_BlenderSceneConverter *converter = m_scene->GetSceneConverter();
+	char group[] = "Scene";
+	char *err_str = NULL;
+
+	cell.m_status = converter->LinkBlendFilePath(cell.m_path.ReadPtr(), group, m_scene, &err_str,
+	                                             KX_BlenderSceneConverter::LIB_LOAD_ASYNC |
+	                                             KX_BlenderSceneConverter::LIB_LOAD_LOAD_SCRIPTS);
+
+	if (cell.m_status) {
+		cell.m_state = CELL_LOADING;
+		m_numPending++;
+		m_loadedMemory += cell.m_size;
+	}
+	else {
+		printf("KX_StreamingManager: failed to load cell: %s", (err_str) ? err_str : "\n");
+		cell.m_state = CELL_FAILED;
+		m_failCount++;
+	}
+}
+
+bool KX_StreamingManager::UnloadCell(Cell& cell)
+{
+	if (!m_scene->GetSceneConverter()->FreeBlendFile(cell.m_path.ReadPtr())) {
+		return false;
+	}
+
+	// The status is deleted by the converter.
+	cell.m_status = NULL;
+	cell.m_state = CELL_UNLOADED;
+	m_numLoaded--;
+	m_unloadCount++;
+	m_loadedMemory -= cell.m_size;
+
+	return true;
+}
+
+static bool cell_distance_cmp(const std::pair<float, int>& a, const std::pair<float, int>& b)
+{
+	return a.first < b.first;
+}
+
+void KX_StreamingManager::Update(double curtime)
+{
+	KX_Camera *cam = m_scene->GetActiveCamera();
+
+	if (m_cells.empty() || !cam) {
+		return;
+	}
+
+	const MT_Vector3& position = cam->NodeGetWorldPosition();
+
+	if (m_lastTime >= 0.0 && curtime > m_lastTime) {
+		m_velocity = (position - m_lastPosition) / (curtime - m_lastTime);
+	}
+	m_lastPosition = position;
+	m_lastTime = curtime;
+
+	// Prefetch the cells the camera is heading to.
+	const MT_Vector3 predicted = position + m_velocity * m_lookAhead;
+
+	// Cells to load, sorted by distance.
+	std::vector<std::pair<float, int> > candidates;
+
+	for (unsigned int i = 0; i < m_cells.size(); ++i) {
+		Cell& cell = m_cells[i];
+		const float distance = std::min((cell.m_position - position).length(),
+		                                (cell.m_position - predicted).length()) - cell.m_radius;
+
+		if (cell.m_state == CELL_LOADING && cell.m_status->IsFinished()) {
+			cell.m_state = CELL_LOADED;
+			m_numPending--;
+			m_numLoaded++;
+			m_loadCount++;
+		}
+
+		if (cell.m_state == CELL_LOADED) {
+			if (distance > m_unloadDistance) {
+				UnloadCell(cell);
+			}
+		}
+		else if (cell.m_state == CELL_UNLOADED) {
+			if (distance < m_loadDistance) {
+				candidates.push_back(std::pair<float, int>(distance, i));
+			}
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), cell_distance_cmp);
+
+	const size_t memoryBudget = (size_t)m_memoryBudget * 1024 * 1024;
+
+	for (unsigned int i = 0; i < candidates.size(); ++i) {
+		Cell& cell = m_cells[candidates[i].second];
+
+		if (m_numPending >= m_maxPendingLoads) {
+			break;
+		}
+		// Stop at the closest cell over the budget, instead of loading farther ones.
+		if (memoryBudget != 0 && m_loadedMemory + cell.m_size > memoryBudget) {
+			break;
+		}
+
+		LoadCell(cell);
+	}
+}
+
+#ifdef WITH_PYTHON
+
+static const char *cell_state_names[] = {"UNLOADED", "LOADING", "LOADED", "FAILED"};
+
+PyTypeObject KX_StreamingManager::Type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"KX_StreamingManager",
+	sizeof(PyObjectPlus_Proxy),
+	0,
+	py_base_dealloc,
+	0,
+	0,
+	0,
+	0,
+	py_base_repr,
+	0, 0, 0, 0, 0, 0, 0, 0, 0,
+	Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+	0, 0, 0, 0, 0, 0, 0,
+	Methods,
+	0,
+	0,
+	&PyObjectPlus::Type,
+	0, 0, 0, 0, 0, 0,
+	py_base_new
+};
+
+PyMethodDef KX_StreamingManager::Methods[] = {
+	KX_PYMETHODTABLE(KX_StreamingManager, addCell),
+	KX_PYMETHODTABLE(KX_StreamingManager, removeCell),
+	KX_PYMETHODTABLE(KX_StreamingManager, getCellState),
+	{NULL, NULL} // Sentinel
+};
+
+PyAttributeDef KX_StreamingManager::Attributes[] = {
+	KX_PYATTRIBUTE_FLOAT_RW_CHECK("loadDistance", 0.0f, FLT_MAX, KX_StreamingManager, m_loadDistance, pyattr_check_distances),
+	KX_PYATTRIBUTE_FLOAT_RW_CHECK("unloadDistance", 0.0f, FLT_MAX, KX_StreamingManager, m_unloadDistance, pyattr_check_distances),
+	KX_PYATTRIBUTE_FLOAT_RW("lookAhead", 0.0f, FLT_MAX, KX_StreamingManager, m_lookAhead),
+	KX_PYATTRIBUTE_INT_RW("maxPendingLoads", 1, 64, true, KX_StreamingManager, m_maxPendingLoads),
+	KX_PYATTRIBUTE_INT_RW("memoryBudget", 0, INT_MAX, true, KX_StreamingManager, m_memoryBudget),
+	KX_PYATTRIBUTE_RO_FUNCTION("cells", KX_StreamingManager, pyattr_get_cells),
+	KX_PYATTRIBUTE_INT_RO("numPending", KX_StreamingManager, m_numPending),
+	KX_PYATTRIBUTE_INT_RO("numLoaded", KX_StreamingManager, m_numLoaded),
+	KX_PYATTRIBUTE_INT_RO("loadCount", KX_StreamingManager, m_loadCount),
+	KX_PYATTRIBUTE_INT_RO("unloadCount", KX_StreamingManager, m_unloadCount),
+	KX_PYATTRIBUTE_INT_RO("failCount", KX_StreamingManager, m_failCount),
+	KX_PYATTRIBUTE_RO_FUNCTION("loadedMemory", KX_StreamingManager, pyattr_get_loaded_memory),
+	{NULL} // Sentinel
+};
+
+int KX_StreamingManager::pyattr_check_distances(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef)
+{
+	KX_StreamingManager *self = static_cast<KX_StreamingManager *>(self_v);
+
+	// Keep the hysteresis, cells must not be unloaded as soon as loaded.
+	if (self->m_unloadDistance < self->m_loadDistance) {
+		self->m_unloadDistance = self->m_loadDistance;
+	}
+
+	return 0;
+}
+
+PyObject *KX_StreamingManager::pyattr_get_cells(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef)
+{
+	KX_StreamingManager *self = static_cast<KX_StreamingManager *>(self_v);
+	PyObject *list = PyList_New(self->m_cells.size());
+
+	for (unsigned int i = 0; i < self->m_cells.size(); ++i) {
+		PyList_SET_ITEM(list, i, PyUnicode_FromString(self->m_cells[i].m_path.ReadPtr()));
+	}
+
+	return list;
+}
+
+PyObject *KX_StreamingManager::pyattr_get_loaded_memory(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef)
+{
+	KX_StreamingManager *self = static_cast<KX_StreamingManager *>(self_v);
+
+	return PyFloat_FromDouble((double)self->m_loadedMemory / (1024.0 * 1024.0));
+}
+
+/* Make the path absolute, like LibLoad does. */
+static void streaming_path_abs(char *abs_path, const char *path)
+{
+	BLI_strncpy(abs_path, path, FILE_MAX);
+	BLI_path_abs(abs_path, KX_GetMainPath().ReadPtr());
+}
+
+KX_PYMETHODDEF_DOC(KX_StreamingManager, addCell, " addCell(path, position, radius)")
+{
+	const char *path;
+	PyObject *pyposition;
+	float radius = 0.0f;
+	MT_Vector3 position;
+
+	if (!PyArg_ParseTuple(args, "sO|f:addCell", &path, &pyposition, &radius)) {
+		return NULL;
+	}
+
+	if (!PyVecTo(pyposition, position)) {
+		return NULL;
+	}
+
+	char abs_path[FILE_MAX];
+	streaming_path_abs(abs_path, path);
+
+	if (!AddCell(abs_path, position, radius)) {
+		PyErr_Format(PyExc_ValueError, "streamingManager.addCell(path, position, radius): KX_StreamingManager, cell \"%s\" already exists", path);
+		return NULL;
+	}
+
+	Py_RETURN_NONE;
+}
+
+KX_PYMETHODDEF_DOC(KX_StreamingManager, removeCell, " removeCell(path)")
+{
+	const char *path;
+
+	if (!PyArg_ParseTuple(args, "s:removeCell", &path)) {
+		return NULL;
+	}
+
+	char abs_path[FILE_MAX];
+	streaming_path_abs(abs_path, path);
+
+	if (RemoveCell(abs_path)) {
+		Py_RETURN_TRUE;
+	}
+	Py_RETURN_FALSE;
+}
+
+KX_PYMETHODDEF_DOC(KX_StreamingManager, getCellState, " getCellState(path)")
+{
+	const char *path;
+
+	if (!PyArg_ParseTuple(args, "s:getCellState", &path)) {
+		return NULL;
+	}
+
+	char abs_path[FILE_MAX];
+	streaming_path_abs(abs_path, path);
+
+	if (!FindCell(abs_path)) {
+		PyErr_Format(PyExc_ValueError, "streamingManager.getCellState(path): KX_StreamingManager, cell \"%s\" not found", path);
+		return NULL;
+	}
+
+	return PyUnicode_FromString(cell_state_names[GetCellState(abs_path)]);
+}
+
+#endif  // WITH_PYTHON
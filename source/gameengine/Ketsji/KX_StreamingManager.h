@@ -0,0 +1,130 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor(s): none yet.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file KX_StreamingManager.h
+ *  \ingroup ketsji
+ */
+
+#ifndef __KX_STREAMING_MANAGER_H__
+#define __KX_STREAMING_MANAGER_H__
+
+#include "EXP_PyObjectPlus.h"
+#include "MT_Vector3.h"
+
+#include <vector>
+
+class KX_Scene;
+class KX_LibLoadStatus;
+
+/** Streams libraries in and out of a scene, each library is a cell
+ * placed in the world and loaded asynchronously when the active camera
+ * gets close to it. */
+class KX_StreamingManager : public PyObjectPlus
+{
+	Py_Header
+public:
+	enum CellState {
+		CELL_UNLOADED = 0,
+		CELL_LOADING,
+		CELL_LOADED,
+		CELL_FAILED
+	};
+
+private:
+	struct Cell {
+		STR_String m_path;
+		MT_Vector3 m_position;
+		float m_radius;
+		/// Size of the file, used as an estimation of the memory used by the cell.
+		size_t m_size;
+		CellState m_state;
+		KX_LibLoadStatus *m_status;
+	};
+
+	KX_Scene *m_scene;
+	std::vector<Cell> m_cells;
+
+	/// Cells closer than this distance are loaded.
+	float m_loadDistance;
+	/// Cells farther than this distance are unloaded, greater than the load distance for hysteresis.
+	float m_unloadDistance;
+	/// Time in seconds the camera velocity is extrapolated to prefetch the cells.
+	float m_lookAhead;
+	/// Number of loads at the same time.
+	int m_maxPendingLoads;
+	/// Maximum memory used by the loaded cells in megabytes, 0 is unlimited.
+	int m_memoryBudget;
+
+	MT_Vector3 m_lastPosition;
+	MT_Vector3 m_velocity;
+	double m_lastTime;
+
+	// Counters
+	int m_numPending;
+	int m_numLoaded;
+	int m_loadCount;
+	int m_unloadCount;
+	int m_failCount;
+	size_t m_loadedMemory;
+
+	Cell *FindCell(const char *path);
+	void LoadCell(Cell& cell);
+	bool UnloadCell(Cell& cell);
+
+public:
+	KX_StreamingManager(KX_Scene *scene);
+	virtual ~KX_StreamingManager();
+
+	/** Add a library to stream.
+	 * \param path Absolute path of the library.
+	 * \param position Center of the cell.
+	 * \param radius Radius of the cell, the distances are computed to its bounds.
+	 */
+	bool AddCell(const char *path, const MT_Vector3& position, float radius);
+	/// Remove a library, it's freed if loaded.
+	bool RemoveCell(const char *path);
+	CellState GetCellState(const char *path);
+
+	/** Load and unload the cells depending on the active camera position and velocity.
+	 * \param curtime The current logic time.
+	 */
+	void Update(double curtime);
+
+#ifdef WITH_PYTHON
+
+	virtual PyObject *py_repr()
+	{
+		return PyUnicode_FromString("KX_StreamingManager");
+	}
+
+	KX_PYMETHOD_DOC(KX_StreamingManager, addCell);
+	KX_PYMETHOD_DOC(KX_StreamingManager, removeCell);
+	KX_PYMETHOD_DOC(KX_StreamingManager, getCellState);
+
+	static PyObject *pyattr_get_cells(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef);
+	static PyObject *pyattr_get_loaded_memory(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef);
+	static int pyattr_check_distances(void *self_v, const KX_PYATTRIBUTE_DEF *attrdef);
+
+#endif  // WITH_PYTHON
+};
+
+#endif  // __KX_STREAMING_MANAGER_H__
@@ -0,0 +1,435 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor(s): none yet.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file gameengine/Ketsji/KX_TextureStreamer.cpp
+ *  \ingroup ketsji
+ */
+
+#include "KX_TextureStreamer.h"
+
+#include "GPU_draw.h"
+
+#include <algorithm>
+#include <string.h>
+
+extern "C" {
+#  include "BLI_task.h"
+#  include "BLI_listbase.h"
+#  include "BLI_path_util.h"
+#  include "BLI_string.h"
+#  include "BLI_utildefines.h"
+#  include "BKE_image.h"
+#  include "DNA_image_types.h"
+#  include "DNA_packedFile_types.h"
+#  include "DNA_userdef_types.h"
+#  include "BKE_main.h"
+#  include "IMB_imbuf.h"
+#  include "IMB_imbuf_types.h"
+#  include "PIL_time.h"
+#  include "MEM_guardedalloc.h"
+}
+
+/// Default upload budget per frame, 8MB is a 1448x1448 image with its mipmaps.
+#define DEFAULT_UPLOAD_BUDGET (8 * 1024 * 1024)
+
+KX_TextureStreamer::KX_TextureStreamer(TaskScheduler *scheduler)
+	:m_uploadBudget(DEFAULT_UPLOAD_BUDGET),
+	m_numStreamed(0),
+	m_queuedBytes(0),
+	m_uploadedBytes(0),
+	m_uploadTime(0.0),
+	m_stallTime(0.0)
+{
+	m_pool = BLI_task_pool_create(scheduler, this);
+}
+
+KX_TextureStreamer::~KX_TextureStreamer()
+{
+	Finish();
+	BLI_task_pool_free(m_pool);
+}
+
+bool KX_TextureStreamer::AddImage(Image *ima)
+{
+	/* Only the still images are streamed, the textures of the image sequences and
+	 * movies are updated each frame, the tiled images use a texture per tile. */
+	if (ima->source != IMA_SRC_FILE || ima->type != IMA_TYPE_IMAGE || ima->ok == 0 ||
+	    (ima->tpageflag & (IMA_TILES | IMA_TWINANIM)) || (ima->flag & IMA_FIELDS) ||
+	    BKE_image_is_multiview(ima))
+	{
+		return false;
+	}
+
+	// The texture already exists or is streamed.
+	if (ima->bindcode[TEXTARGET_TEXTURE_2D] != 0) {
+		return false;
+	}
+
+	// Float textures and compressed DDS textures are created as they are by GPU_verify_image.
+	if (U.use_16bit_textures || BLI_testextensie(ima->name, ".dds")) {
+		return false;
+	}
+
+	Job *job = new Job();
+	job->m_image = ima;
+	job->m_packedData = NULL;
+	job->m_packedSize = 0;
+	job->m_mipmap = GPU_get_mipmap();
+	job->m_ibuf = NULL;
+	job->m_cancelled = false;
+	job->m_level = -1;
+	job->m_row = 0;
+
+	// Same flags as load_image_single.
+	job->m_flag = IB_rect;
+	if (ima->flag & IMA_IGNORE_ALPHA) {
+		job->m_flag |= IB_ignore_alpha;
+	}
+	else if (ima->alpha_mode == IMA_ALPHA_PREMUL) {
+		job->m_flag |= IB_alphamode_premul;
+	}
+	BLI_strncpy(job->m_colorSpace, ima->colorspace_settings.name, sizeof(job->m_colorSpace));
+
+	if (BKE_image_has_packedfile(ima)) {
+		PackedFile *pf = ((ImagePackedFile *)ima->packedfiles.first)->packedfile;
+		if (!pf) {
+			delete job;
+			return false;
+		}
+		job->m_packedData = MEM_mallocN(pf->size, "KX_TextureStreamer packed data");
+		job->m_packedSize = pf->size;
+		memcpy(job->m_packedData, pf->data, pf->size);
+	}
+	else {
+		char filepath[FILE_MAX];
+		BKE_image_user_file_path(NULL, ima, filepath);
+		job->m_filePath = filepath;
+	}
+
+	job->m_bindCode = GPU_stream_image_create(ima);
+
+	m_mutex.Lock();
+	m_decodingJobs.push_back(job);
+	m_mutex.Unlock();
+
+	BLI_task_pool_push(m_pool, DecodeTask, job, false, TASK_PRIORITY_LOW);
+
+	return true;
+}
+
+void KX_TextureStreamer::DecodeTask(TaskPool *pool, void *taskdata, int UNUSED(threadid))
+{
+	KX_TextureStreamer *streamer = (KX_TextureStreamer *)BLI_task_pool_userdata(pool);
+	Job *job = (Job *)taskdata;
+
+	streamer->m_mutex.Lock();
+	const bool cancelled = job->m_cancelled;
+	streamer->m_mutex.Unlock();
+
+	if (!cancelled) {
+		streamer->DecodeImage(job);
+	}
+
+	streamer->m_mutex.Lock();
+	streamer->m_decodingJobs.remove(job);
+	streamer->m_decodedJobs.push_back(job);
+	streamer->m_mutex.Unlock();
+}
+
+void KX_TextureStreamer::DecodeImage(Job *job)
+{
+	ImBuf *ibuf;
+
+	if (job->m_packedData) {
+		ibuf = IMB_ibImageFromMemory((unsigned char *)job->m_packedData, job->m_packedSize, job->m_flag,
+		                             job->m_colorSpace, "<packed data>");
+	}
+	else {
+		ibuf = IMB_loadiffname(job->m_filePath.ReadPtr(), job->m_flag, job->m_colorSpace);
+	}
+
+	if (!ibuf) {
+		return;
+	}
+
+	// Like GPU_verify_image without high bit depth textures.
+	if (ibuf->rect_float) {
+		if (!ibuf->rect) {
+			IMB_rect_from_float(ibuf);
+		}
+		imb_freerectfloatImBuf(ibuf);
+	}
+
+	if (!ibuf->rect) {
+		IMB_freeImBuf(ibuf);
+		return;
+	}
+
+	int width, height;
+	GPU_get_gl_tex_size(ibuf->x, ibuf->y, &width, &height);
+	if (width != ibuf->x || height != ibuf->y) {
+		IMB_scaleImBuf(ibuf, width, height);
+	}
+
+	if (job->m_mipmap) {
+		IMB_makemipmap(ibuf, true);
+	}
+
+	job->m_ibuf = ibuf;
+}
+
+void KX_TextureStreamer::FreeJob(Job *job)
+{
+	if (job->m_ibuf) {
+		m_queuedBytes -= GetRemainingBytes(job);
+		IMB_freeImBuf(job->m_ibuf);
+	}
+	if (job->m_packedData) {
+		MEM_freeN(job->m_packedData);
+	}
+	delete job;
+}
+
+void KX_TextureStreamer::WaitDecoding()
+{
+	m_mutex.Lock();
+	const bool decoding = !m_decodingJobs.empty();
+	m_mutex.Unlock();
+
+	if (decoding) {
+		const double starttime = PIL_check_seconds_timer();
+		BLI_task_pool_work_and_wait(m_pool);
+		m_stallTime += PIL_check_seconds_timer() - starttime;
+	}
+}
+
+size_t KX_TextureStreamer::GetRemainingBytes(Job *job) const
+{
+	if (!job->m_ibuf || job->m_level < 0) {
+		return 0;
+	}
+
+	size_t bytes = 0;
+	for (int level = job->m_level; level >= 0; --level) {
+		ImBuf *mip = IMB_getmipmap(job->m_ibuf, level);
+		bytes += (size_t)mip->x * mip->y * 4;
+	}
+	// The rows of the current level already uploaded.
+	bytes -= (size_t)IMB_getmipmap(job->m_ibuf, job->m_level)->x * job->m_row * 4;
+
+	return bytes;
+}
+
+void KX_TextureStreamer::StartUploads()
+{
+	m_mutex.Lock();
+	std::vector<Job *> jobs;
+	jobs.swap(m_decodedJobs);
+	m_mutex.Unlock();
+
+	for (std::vector<Job *>::iterator it = jobs.begin(), end = jobs.end(); it != end; ++it) {
+		Job *job = *it;
+		Image *ima = job->m_image;
+
+		// The image failed to load or its texture was freed, e.g. by a mipmap setting change.
+		if (job->m_cancelled || !job->m_ibuf || ima->bindcode[TEXTARGET_TEXTURE_2D] != job->m_bindCode) {
+			FreeJob(job);
+			continue;
+		}
+
+		ImBuf *ibuf = job->m_ibuf;
+		const int levels = job->m_mipmap ? ibuf->miptot : 1;
+
+		GPU_stream_image_allocate(ima, ibuf->x, ibuf->y, levels);
+
+		/* The smallest level replaces the placeholder immediately, it's also the
+		 * complete image without mipmaps as the texture can't show a partial level. */
+		job->m_level = levels - 1;
+		ImBuf *mip = IMB_getmipmap(ibuf, job->m_level);
+		GPU_stream_image_upload(ima, job->m_level, mip->x, 0, mip->y, mip->rect);
+		m_uploadedBytes += (size_t)mip->x * mip->y * 4;
+		--job->m_level;
+
+		if (job->m_level < 0) {
+			++m_numStreamed;
+			FreeJob(job);
+			continue;
+		}
+
+		m_queuedBytes += GetRemainingBytes(job);
+		m_uploadingJobs.push_back(job);
+	}
+}
+
+void KX_TextureStreamer::Upload(size_t budget)
+{
+	const double starttime = PIL_check_seconds_timer();
+
+	StartUploads();
+
+	size_t uploaded = 0;
+	for (std::list<Job *>::iterator it = m_uploadingJobs.begin(); it != m_uploadingJobs.end() && uploaded < budget;) {
+		Job *job = *it;
+		Image *ima = job->m_image;
+
+		if (ima->bindcode[TEXTARGET_TEXTURE_2D] != job->m_bindCode) {
+			FreeJob(job);
+			it = m_uploadingJobs.erase(it);
+			continue;
+		}
+
+		while (job->m_level >= 0 && uploaded < budget) {
+			ImBuf *mip = IMB_getmipmap(job->m_ibuf, job->m_level);
+			const size_t rowsize = (size_t)mip->x * 4;
+			// Upload at least one row to always progress.
+			const size_t maxrows = std::max((budget - uploaded) / rowsize, (size_t)1);
+			const int numrows = (int)std::min((size_t)(mip->y - job->m_row), maxrows);
+
+			GPU_stream_image_upload(ima, job->m_level, mip->x, job->m_row, numrows, mip->rect + mip->x * job->m_row);
+			job->m_row += numrows;
+			uploaded += rowsize * numrows;
+			m_queuedBytes -= rowsize * numrows;
+
+			if (job->m_row == mip->y) {
+				GPU_stream_image_set_base_level(ima, job->m_level);
+				--job->m_level;
+				job->m_row = 0;
+			}
+		}
+
+		if (job->m_level < 0) {
+			++m_numStreamed;
+			FreeJob(job);
+			it = m_uploadingJobs.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	m_uploadedBytes += uploaded;
+	m_uploadTime += PIL_check_seconds_timer() - starttime;
+}
+
+void KX_TextureStreamer::Update()
+{
+	Upload(m_uploadBudget);
+}
+
+void KX_TextureStreamer::RemoveImages(Main *maggie)
+{
+	m_mutex.Lock();
+	for (std::list<Job *>::iterator it = m_decodingJobs.begin(), end = m_decodingJobs.end(); it != end; ++it) {
+		if (BLI_findindex(&maggie->image, (*it)->m_image) != -1) {
+			(*it)->m_cancelled = true;
+		}
+	}
+	for (std::vector<Job *>::iterator it = m_decodedJobs.begin(), end = m_decodedJobs.end(); it != end; ++it) {
+		if (BLI_findindex(&maggie->image, (*it)->m_image) != -1) {
+			(*it)->m_cancelled = true;
+		}
+	}
+	m_mutex.Unlock();
+
+	for (std::list<Job *>::iterator it = m_uploadingJobs.begin(); it != m_uploadingJobs.end();) {
+		if (BLI_findindex(&maggie->image, (*it)->m_image) != -1) {
+			FreeJob(*it);
+			it = m_uploadingJobs.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void KX_TextureStreamer::Flush()
+{
+	WaitDecoding();
+	Upload((size_t)-1);
+}
+
+void KX_TextureStreamer::Finish()
+{
+	WaitDecoding();
+
+	m_mutex.Lock();
+	std::vector<Job *> jobs;
+	jobs.swap(m_decodedJobs);
+	m_mutex.Unlock();
+
+	jobs.insert(jobs.end(), m_uploadingJobs.begin(), m_uploadingJobs.end());
+	m_uploadingJobs.clear();
+
+	for (std::vector<Job *>::iterator it = jobs.begin(), end = jobs.end(); it != end; ++it) {
+		Job *job = *it;
+		Image *ima = job->m_image;
+		// A partial texture must not be used outside of the game.
+		if (!job->m_cancelled && ima->bindcode[TEXTARGET_TEXTURE_2D] == job->m_bindCode) {
+			GPU_free_image(ima);
+		}
+		FreeJob(job);
+	}
+}
+
+void KX_TextureStreamer::SetUploadBudget(size_t budget)
+{
+	m_uploadBudget = budget;
+}
+
+size_t KX_TextureStreamer::GetUploadBudget() const
+{
+	return m_uploadBudget;
+}
+
+int KX_TextureStreamer::GetNumPending()
+{
+	m_mutex.Lock();
+	const int numpending = m_decodingJobs.size() + m_decodedJobs.size() + m_uploadingJobs.size();
+	m_mutex.Unlock();
+
+	return numpending;
+}
+
+size_t KX_TextureStreamer::GetQueuedBytes() const
+{
+	return m_queuedBytes;
+}
+
+size_t KX_TextureStreamer::GetUploadedBytes() const
+{
+	return m_uploadedBytes;
+}
+
+int KX_TextureStreamer::GetNumStreamed() const
+{
+	return m_numStreamed;
+}
+
+double KX_TextureStreamer::GetUploadTime() const
+{
+	return m_uploadTime;
+}
+
+double KX_TextureStreamer::GetStallTime() const
+{
+	return m_stallTime;
+}
@@ -0,0 +1,153 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Contributor(s): none yet.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file KX_TextureStreamer.h
+ *  \ingroup ketsji
+ */
+
+#ifndef __KX_TEXTURE_STREAMER_H__
+#define __KX_TEXTURE_STREAMER_H__
+
+#include "EXP_Thread.h"
+#include "STR_String.h"
+
+#include <list>
+#include <vector>
+
+struct Image;
+struct ImBuf;
+struct Main;
+struct TaskPool;
+struct TaskScheduler;
+
+/** Streams the image textures to the GPU. The images are decoded and their
+ * mipmaps are generated by tasks, the levels are then uploaded by the main thread
+ * from the smallest one within a budget of bytes per frame. Until the first level
+ * is uploaded the texture is a single placeholder texel.
+ *
+ * The OpenGL texture name of an image doesn't change while it is streamed, the
+ * materials and the game engine textures use it as a complete texture.
+ */
+class KX_TextureStreamer
+{
+private:
+	struct Job {
+		Image *m_image;
+		unsigned int m_bindCode;
+
+		/// Copies of the image data used by the task, the image can be freed meanwhile.
+		STR_String m_filePath;
+		void *m_packedData;
+		size_t m_packedSize;
+		/// Color space name, of size IM_MAX_SPACE.
+		char m_colorSpace[64];
+		int m_flag;
+		bool m_mipmap;
+
+		/// Set by the task, NULL if the image can't be read.
+		ImBuf *m_ibuf;
+		bool m_cancelled;
+
+		/** The level being uploaded, from the smallest one to 0, and its next row.
+		 * The level is -1 before the upload and once it's done. */
+		int m_level;
+		int m_row;
+	};
+
+	TaskPool *m_pool;
+	CThreadMutex m_mutex;
+
+	/// Jobs being decoded, they are owned by their task.
+	std::list<Job *> m_decodingJobs;
+	/// Jobs decoded and not yet taken by the main thread.
+	std::vector<Job *> m_decodedJobs;
+	/// Jobs being uploaded, used only by the main thread.
+	std::list<Job *> m_uploadingJobs;
+
+	/// Bytes uploaded per frame.
+	size_t m_uploadBudget;
+
+	// Counters
+	int m_numStreamed;
+	size_t m_queuedBytes;
+	size_t m_uploadedBytes;
+	/// Time spent by the main thread uploading the textures.
+	double m_uploadTime;
+	/// Time spent by the main thread waiting for the decoding tasks.
+	double m_stallTime;
+
+	static void DecodeTask(TaskPool *pool, void *taskdata, int threadid);
+	void DecodeImage(Job *job);
+	void FreeJob(Job *job);
+	/// Wait for the decoding tasks, the time waited is a stall.
+	void WaitDecoding();
+	/// Take the decoded jobs and replace their placeholder by their smallest level.
+	void StartUploads();
+	void Upload(size_t budget);
+	size_t GetRemainingBytes(Job *job) const;
+
+public:
+	KX_TextureStreamer(TaskScheduler *scheduler);
+	~KX_TextureStreamer();
+
+	/** Create the texture of an image with a placeholder and decode the image in a task.
+	 * \return False if the image can't be streamed, the texture is then created
+	 * synchronously by GPU_verify_image.
+	 */
+	bool AddImage(Image *ima);
+
+	/** Upload the decoded images within the budget, must be called by the main
+	 * thread once per frame before rendering.
+	 */
+	void Update();
+
+	/// Stop streaming the images of a main before it's freed.
+	void RemoveImages(Main *maggie);
+
+	/** Wait for all the tasks and upload all the images now, used when the
+	 * textures are needed at once, e.g. behind a loading screen.
+	 */
+	void Flush();
+
+	/** Stop the streaming, the textures not completely uploaded are freed
+	 * and created again by their next user.
+	 */
+	void Finish();
+
+	void SetUploadBudget(size_t budget);
+	size_t GetUploadBudget() const;
+
+	/// Number of images not completely uploaded.
+	int GetNumPending();
+	/// Bytes of the decoded levels waiting to be uploaded.
+	size_t GetQueuedBytes() const;
+	size_t GetUploadedBytes() const;
+	int GetNumStreamed() const;
+	double GetUploadTime() const;
+	double GetStallTime() const;
+
+#ifdef WITH_CXX_GUARDEDALLOC
+	MEM_CXX_CLASS_ALLOC_FUNCS("GE:KX_TextureStreamer")
+#endif
+};
+
+#endif  // __KX_TEXTURE_STREAMER_H__
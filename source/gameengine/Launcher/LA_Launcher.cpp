@@ -62,6 +62,7 @@
 
 extern "C" {
 #  include "GPU_extensions.h"
+#  include "GPU_material.h"
 
 #  include "BKE_sound.h"
 #  include "BKE_main.h"
@@ -151,6 +152,8 @@ void LA_Launcher::InitEngine()
 	bool showArmatures = (SYS_GetCommandLineInt(syshandle, "show_armatures", gm->flag & GAME_SHOW_ARMATURES) != 0);
 	bool nodepwarnings = (SYS_GetCommandLineInt(syshandle, "ignore_deprecation_warnings", 1) != 0);
 	bool restrictAnimFPS = (gm->flag & GAME_RESTRICT_ANIM_UPDATES) != 0;
+	bool cookedCache = (SYS_GetCommandLineInt(syshandle, "cooked_cache", gm->flag & GAME_USE_COOKED_CACHE) != 0);
+	bool textureStreaming = (SYS_GetCommandLineInt(syshandle, "texture_streaming", gm->flag & GAME_USE_TEXTURE_STREAMING) != 0);
 
 	// Setup python console keys used as shortcut.
 	for (unsigned short i = 0; i < 4; ++i) {
@@ -250,6 +253,9 @@ void LA_Launcher::InitEngine()
 	m_ketsjiEngine->SetRestrictAnimationFPS(restrictAnimFPS);
 	m_ketsjiEngine->SetShowBoundingBox(showBoundingBox);
 	m_ketsjiEngine->SetShowArmatures(showArmatures);
+	if (textureStreaming) {
+		m_ketsjiEngine->EnableTextureStreaming();
+	}
 
 	// Set the global settings (carried over if restart/load new files).
 	m_ketsjiEngine->SetGlobalSettings(m_globalSettings);
@@ -261,7 +267,14 @@ void LA_Launcher::InitEngine()
 #endif
 
 	// Create a scene converter, create and convert the stratingscene.
-	m_sceneConverter = new KX_BlenderSceneConverter(m_maggie, m_ketsjiEngine);
+	KX_BlenderSceneConverter *sceneConverter = new KX_BlenderSceneConverter(m_maggie, m_ketsjiEngine);
+	// The cache file is next to the blend file, an unsaved file can't use it.
+	if (cookedCache && m_maggie->name[0] != '\0') {
+		sceneConverter->EnableCookedDataCache(m_maggie->name);
+		// Program binaries of the material shaders.
+		GPU_pass_cache_file_open((STR_String(m_maggie->name) + ".glslcache").ReadPtr());
+	}
+	m_sceneConverter = sceneConverter;
 	STR_String m_kxStartScenename = m_startSceneName.Ptr();
 	m_ketsjiEngine->SetSceneConverter(m_sceneConverter);
 
@@ -294,6 +307,9 @@ void LA_Launcher::InitEngine()
 	m_ketsjiEngine->AddScene(m_kxStartScene);
 	m_kxStartScene->Release();
 
+	// Keep the shaders of the start scene even if the game doesn't exit properly.
+	GPU_pass_cache_file_save();
+
 	m_rasterizer->Init();
 	m_ketsjiEngine->StartEngine(true);
 
@@ -315,6 +331,10 @@ void LA_Launcher::ExitEngine()
 	DEV_Joystick::Close();
 	m_ketsjiEngine->StopEngine();
 
+	// Add the shaders of the scenes and libraries loaded while playing.
+	GPU_pass_cache_file_save();
+	GPU_pass_cache_file_close();
+
 #ifdef WITH_PYTHON
 
 	/* Clears the dictionary by hand:
@@ -34,6 +34,7 @@
 #include "RAS_Polygon.h"
 #include "RAS_Deformer.h"
 #include "KX_GameObject.h"
+#include "KX_CookedDataCache.h"
 
 #include "BulletSoftBody/btSoftBody.h"
 #include "BulletSoftBody/btSoftBodyInternals.h"
@@ -1764,6 +1765,8 @@ void CcdShapeConstructionInfo::ProcessReplica()
 	m_triangleIndexVertexArray = NULL;
 	m_forceReInstance = false;
 	m_shapeProxy = NULL;
+	m_cookedBvh = NULL;
+	m_cookedBvhBuffer = NULL;
 	m_vertexArray.clear();
 	m_polygonIndexArray.clear();
 	m_triFaceArray.clear();
@@ -2080,6 +2083,112 @@ cleanup_empty_mesh:
 	return false;
 }
 
+bool CcdShapeConstructionInfo::SetCookedMesh(RAS_MeshObject *meshobj, const void *data, size_t size)
+{
+	// no support for dynamic change of shape yet
+	assert(IsUnused());
+
+	KX_CookedDataReader reader(data, size);
+	// Bullet version, scalar size, then the size of the arrays.
+	unsigned int header[6];
+	if (!reader.Read(header, sizeof(header)) || header[0] != BT_BULLET_VERSION || header[1] != sizeof(btScalar)) {
+		return false;
+	}
+
+	const unsigned int numscalars = header[2];
+	const unsigned int numtris = header[3];
+	const unsigned int numuvcos = header[5];
+	if (numscalars == 0 || numscalars % 3 != 0 || numtris == 0 || header[4] != numtris * 3 || (numuvcos != 0 && numuvcos != numtris * 3)) {
+		return false;
+	}
+
+	const btScalar *vertices = (const btScalar *)reader.ReadData(sizeof(btScalar) * numscalars);
+	const int *polys = (const int *)reader.ReadData(sizeof(int) * numtris);
+	const int *trifaces = (const int *)reader.ReadData(sizeof(int) * numtris * 3);
+	const UVco *uvcos = (const UVco *)reader.ReadData(sizeof(UVco) * numuvcos);
+	unsigned int bvhsize = 0;
+	reader.Read(bvhsize);
+	reader.Align(16);
+	const void *bvhdata = reader.ReadData(bvhsize);
+	if (!reader.IsValid() || bvhsize == 0) {
+		return false;
+	}
+
+	for (unsigned int i = 0; i < numtris * 3; ++i) {
+		if (trifaces[i] < 0 || (unsigned int)trifaces[i] >= numscalars / 3) {
+			return false;
+		}
+	}
+
+	// The BVH is modified by the deserialization and must be aligned.
+	void *buffer = btAlignedAlloc(bvhsize, 16);
+	memcpy(buffer, bvhdata, bvhsize);
+	btOptimizedBvh *bvh = btOptimizedBvh::deSerializeInPlace(buffer, bvhsize, false);
+	if (!bvh) {
+		btAlignedFree(buffer);
+		return false;
+	}
+
+	m_vertexArray.resize(numscalars);
+	memcpy(&m_vertexArray[0], vertices, sizeof(btScalar) * numscalars);
+	m_polygonIndexArray.assign(polys, polys + numtris);
+	m_triFaceArray.assign(trifaces, trifaces + numtris * 3);
+	m_triFaceUVcoArray.assign(uvcos, uvcos + numuvcos);
+
+	m_cookedBvh = bvh;
+	m_cookedBvhBuffer = buffer;
+	m_shapeType = PHY_SHAPE_MESH;
+	m_meshObject = meshobj;
+
+	// triangle shape can be shared, store the mesh object in the map
+	m_meshShapeMap.insert(std::pair<RAS_MeshObject *, CcdShapeConstructionInfo *>(meshobj, this));
+
+	return true;
+}
+
+bool CcdShapeConstructionInfo::WriteCookedMesh(KX_CookedDataWriter& writer, btCollisionShape *shape)
+{
+	if (m_shapeType != PHY_SHAPE_MESH || m_vertexArray.size() == 0 || !shape ||
+	    shape->getShapeType() != SCALED_TRIANGLE_MESH_SHAPE_PROXYTYPE)
+	{
+		return false;
+	}
+
+	btBvhTriangleMeshShape *trimeshshape = ((btScaledBvhTriangleMeshShape *)shape)->getChildShape();
+	btOptimizedBvh *bvh = trimeshshape->getOptimizedBvh();
+	if (!bvh) {
+		return false;
+	}
+
+	const unsigned int bvhsize = bvh->calculateSerializeBufferSize();
+	void *buffer = btAlignedAlloc(bvhsize, 16);
+	if (!bvh->serializeInPlace(buffer, bvhsize, false)) {
+		btAlignedFree(buffer);
+		return false;
+	}
+
+	const unsigned int header[6] = {
+		BT_BULLET_VERSION,
+		sizeof(btScalar),
+		(unsigned int)m_vertexArray.size(),
+		(unsigned int)m_polygonIndexArray.size(),
+		(unsigned int)m_triFaceArray.size(),
+		(unsigned int)m_triFaceUVcoArray.size()
+	};
+	writer.Write(header, sizeof(header));
+	writer.Write(&m_vertexArray[0], sizeof(btScalar) * m_vertexArray.size());
+	writer.Write(m_polygonIndexArray.data(), sizeof(int) * m_polygonIndexArray.size());
+	writer.Write(m_triFaceArray.data(), sizeof(int) * m_triFaceArray.size());
+	writer.Write(m_triFaceUVcoArray.data(), sizeof(UVco) * m_triFaceUVcoArray.size());
+	writer.Write(bvhsize);
+	writer.Align(16);
+	writer.Write(buffer, bvhsize);
+
+	btAlignedFree(buffer);
+
+	return true;
+}
+
 #include <cstdio>
 
 /* Updates the arrays used by CreateBulletShape(),
@@ -2386,6 +2495,9 @@ bool CcdShapeConstructionInfo::UpdateMesh(class KX_GameObject *gameobj, class RA
 		m_forceReInstance = true;
 	}
 
+	// The cooked BVH doesn't match the new mesh, its buffer is kept for the current shapes.
+	m_cookedBvh = NULL;
+
 	// Make sure to also replace the mesh in the shape map! Otherwise we leave dangling references when we free.
 	// Note, this whole business could cause issues with shared meshes. If we update one mesh, do we replace
 	// them all?
@@ -2521,7 +2633,14 @@ btCollisionShape *CcdShapeConstructionInfo::CreateBulletShape(btScalar margin, b
 					m_forceReInstance = false;
 				}
 
-				btBvhTriangleMeshShape *unscaledShape = new btBvhTriangleMeshShape(m_triangleIndexVertexArray, true, useBvh);
+				btBvhTriangleMeshShape *unscaledShape;
+				if (m_cookedBvh && useBvh && m_weldingThreshold1 == 0.0f) {
+					unscaledShape = new btBvhTriangleMeshShape(m_triangleIndexVertexArray, true, false);
+					unscaledShape->setOptimizedBvh(m_cookedBvh);
+				}
+				else {
+					unscaledShape = new btBvhTriangleMeshShape(m_triangleIndexVertexArray, true, useBvh);
+				}
 				unscaledShape->setMargin(margin);
 				collisionShape = new btScaledBvhTriangleMeshShape(unscaledShape, btVector3(1.0f, 1.0f, 1.0f));
 				collisionShape->setMargin(margin);
@@ -2567,6 +2686,10 @@ CcdShapeConstructionInfo::~CcdShapeConstructionInfo()
 	if (m_triangleIndexVertexArray)
 		delete m_triangleIndexVertexArray;
 	m_vertexArray.clear();
+	if (m_cookedBvhBuffer) {
+		// The BVH is deserialized in place, its arrays don't own memory.
+		btAlignedFree(m_cookedBvhBuffer);
+	}
 	if (m_shapeType == PHY_SHAPE_MESH && m_meshObject != NULL) {
 		std::map<RAS_MeshObject *, CcdShapeConstructionInfo *>::iterator mit = m_meshShapeMap.find(m_meshObject);
 		if (mit != m_meshShapeMap.end() && mit->second == this) {
@@ -42,6 +42,7 @@ extern bool gDisableDeactivation;
 class CcdPhysicsEnvironment;
 class btMotionState;
 class RAS_MeshObject;
+class KX_CookedDataWriter;
 struct DerivedMesh;
 class btCollisionShape;
 
@@ -80,7 +81,9 @@ public:
 		m_triangleIndexVertexArray(NULL),
 		m_forceReInstance(false),
 		m_weldingThreshold1(0.0f),
-		m_shapeProxy(NULL)
+		m_shapeProxy(NULL),
+		m_cookedBvh(NULL),
+		m_cookedBvhBuffer(NULL)
 	{
 		m_childTrans.setIdentity();
 	}
@@ -161,6 +164,16 @@ public:
 
 	bool UpdateMesh(class KX_GameObject *gameobj, class RAS_MeshObject *mesh);
 
+	/** Set a static triangle mesh from the data of the cooked data cache, it contains
+	 * the arrays of SetMesh and the BVH used by all the shapes of this mesh.
+	 * \return False if the data is invalid, the mesh is unchanged.
+	 */
+	bool SetCookedMesh(class RAS_MeshObject *mesh, const void *data, size_t size);
+	/** Write the data read by SetCookedMesh.
+	 * \param shape A shape created by CreateBulletShape.
+	 */
+	bool WriteCookedMesh(class KX_CookedDataWriter& writer, btCollisionShape *shape);
+
 	CcdShapeConstructionInfo *GetReplica();
 
 	void ProcessReplica();
@@ -216,6 +229,10 @@ protected:
 	float m_weldingThreshold1;
 	/// only used for PHY_SHAPE_PROXY, pointer to actual shape info
 	CcdShapeConstructionInfo *m_shapeProxy;
+	/// BVH read from the cooked data cache, shared by the triangle mesh shapes instead of building one per shape.
+	btOptimizedBvh *m_cookedBvh;
+	/// Buffer of m_cookedBvh, freed with the shape info because the shapes keep using it after UpdateMesh.
+	void *m_cookedBvhBuffer;
 
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("GE:CcdShapeConstructionInfo")
@@ -40,12 +40,14 @@
 #include "KX_GameObject.h"
 #include "KX_Globals.h" // for KX_RasterizerDrawDebugLine
 #include "KX_BlenderSceneConverter.h"
+#include "KX_CookedDataCache.h"
 #include "RAS_MeshObject.h"
 #include "RAS_Polygon.h"
 #include "RAS_ITexVert.h"
 
 #include "DNA_scene_types.h"
 #include "DNA_world_types.h"
+#include "DNA_mesh_types.h"
 #include "DNA_object_types.h" // for OB_MAX_COL_MASKS
 #include "DNA_object_force.h"
 
@@ -3162,15 +3164,33 @@ void CcdPhysicsEnvironment::ConvertObject(KX_GameObject *gameobj, RAS_MeshObject
 		}
 		case OB_BOUND_TRIANGLE_MESH:
 		{
+			// The static triangle meshes and their BVH can be read from the cooked data cache.
+			KX_BlenderSceneConverter *converter = (KX_BlenderSceneConverter *)KX_GetActiveEngine()->GetSceneConverter();
+			KX_CookedDataCache *cookedcache = converter->GetCookedDataCache();
+			uint64_t cookedkey = 0;
+			bool cooked = false;
+			if (cookedcache && !dm && !useGimpact && !isbulletsoftbody && meshobj && meshobj->GetCookedKey() != 0) {
+				KX_CookedDataKey key;
+				key.AddInt(KX_CookedDataCache::DATA_PHYSICS_MESH);
+				key.AddKey(meshobj->GetCookedKey());
+				cookedkey = key.Get();
+			}
+
 			// mesh shapes can be shared, check first if we already have a shape on that mesh
 			class CcdShapeConstructionInfo *sharedShapeInfo = CcdShapeConstructionInfo::FindMesh(meshobj, dm, false);
 			if (sharedShapeInfo != NULL) {
 				shapeInfo->Release();
 				shapeInfo = sharedShapeInfo;
 				shapeInfo->AddRef();
+				cooked = true;
 			}
 			else {
-				shapeInfo->SetMesh(meshobj, dm, false);
+				size_t cookedsize;
+				const void *cookeddata = cookedkey ? cookedcache->Find(KX_CookedDataCache::DATA_PHYSICS_MESH, cookedkey, cookedsize) : NULL;
+				cooked = (cookeddata && shapeInfo->SetCookedMesh(meshobj, cookeddata, cookedsize));
+				if (!cooked) {
+					shapeInfo->SetMesh(meshobj, dm, false);
+				}
 			}
 
 			// Soft bodies can benefit from welding, don't do it on non-soft bodies
@@ -3184,6 +3204,15 @@ void CcdPhysicsEnvironment::ConvertObject(KX_GameObject *gameobj, RAS_MeshObject
 			//should we compute inertia for dynamic shape?
 			//bm->calculateLocalInertia(ci.m_mass,ci.m_localInertiaTensor);
 
+			if (cookedkey && !cooked) {
+				KX_CookedDataWriter writer;
+				if (shapeInfo->WriteCookedMesh(writer, bm)) {
+					cookedcache->Add(KX_CookedDataCache::DATA_PHYSICS_MESH, cookedkey,
+					                 KX_CookedDataCache::GetSourceKey(KX_CookedDataCache::DATA_PHYSICS_MESH, &meshobj->GetMesh()->id),
+					                 writer.GetData(), writer.GetSize());
+				}
+			}
+
 			break;
 		}
 	}
@@ -105,6 +105,7 @@ RAS_MeshObject::RAS_MeshObject(Mesh *mesh)
 	m_needUpdateAabb(true),
 	m_aabbMax(0.0f, 0.0f, 0.0f),
 	m_aabbMin(0.0f, 0.0f, 0.0f),
+	m_cookedKey(0),
 	m_mesh(mesh)
 {
 }
@@ -224,6 +225,16 @@ STR_String& RAS_MeshObject::GetName()
 	return m_name;
 }
 
+void RAS_MeshObject::SetCookedKey(uint64_t key)
+{
+	m_cookedKey = key;
+}
+
+uint64_t RAS_MeshObject::GetCookedKey() const
+{
+	return m_cookedKey;
+}
+
 short RAS_MeshObject::GetModifiedFlag() const
 {
 	return m_modifiedFlag;
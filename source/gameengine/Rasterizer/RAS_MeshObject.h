@@ -39,6 +39,7 @@
 
 #include <vector>
 #include <list>
+#include <stdint.h>
 
 #include "RAS_MaterialBucket.h"
 #include "RAS_MeshMaterial.h"
@@ -68,6 +69,9 @@ private:
 	STR_String m_name;
 	static STR_String s_emptyname;
 
+	/// Key of the mesh data in the cooked data cache, 0 if the cache is unused.
+	uint64_t m_cookedKey;
+
 	std::vector<RAS_Polygon *> m_polygons;
 
 	/* polygon sorting */
@@ -103,6 +107,10 @@ public:
 	void SetName(const char *name);
 	STR_String& GetName();
 
+	// cooked data cache
+	void SetCookedKey(uint64_t key);
+	uint64_t GetCookedKey() const;
+
 	/// Modification categories.
 	enum {
 		POSITION_MODIFIED = 1 << 0, // Vertex position modified.
@@ -9,6 +9,7 @@ extern "C" {
 #include "MEM_guardedalloc.h"
 #include "BLI_utildefines.h"
 #include "BLI_ghash.h"
+#include "BLI_hash_mm2a.h"
 #include "BLI_rand.h"
 #include "BLI_string.h"
 #include "PIL_time_utildefines.h"
@@ -534,3 +535,234 @@ TEST(ghash, MultiRandIntMurmur2a200000)
 
 	multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - Murmur2a - 200000", 200000);
 }
+
+
+/* Ptr: addresses of elements allocated in a shuffled order, as when mapping data-blocks or mesh elements. */
+
+static void ptr_ghash_tests(GHash *ghash, const char *id, const unsigned int nbr)
+{
+	printf("\n========== STARTING %s ==========\n", id);
+
+	/* size of a typical element, keys are spread over the memory like real pointers */
+	const size_t elem_size = 48;
+	char *elems = (char *)MEM_mallocN(elem_size * (size_t)nbr, __func__);
+	void **data = (void **)MEM_mallocN(sizeof(*data) * (size_t)nbr, __func__);
+	void **dt;
+	unsigned int i;
+
+	for (i = 0; i < nbr; i++) {
+		data[i] = elems + elem_size * i;
+	}
+	BLI_array_randomize(data, sizeof(*data), nbr, 0);
+
+	{
+		TIMEIT_START(ptr_insert);
+
+#ifdef GHASH_RESERVE
+		BLI_ghash_reserve(ghash, nbr);
+#endif
+
+		for (i = nbr, dt = data; i--; dt++) {
+			BLI_ghash_insert(ghash, *dt, SET_UINT_IN_POINTER(i));
+		}
+
+		TIMEIT_END(ptr_insert);
+	}
+
+	PRINTF_GHASH_STATS(ghash);
+
+	{
+		TIMEIT_START(ptr_lookup);
+
+		for (i = nbr, dt = data; i--; dt++) {
+			void *v = BLI_ghash_lookup(ghash, *dt);
+			EXPECT_EQ(i, GET_UINT_FROM_POINTER(v));
+		}
+
+		TIMEIT_END(ptr_lookup);
+	}
+
+	BLI_array_randomize(data, sizeof(*data), nbr, 1);
+
+	{
+		TIMEIT_START(ptr_lookup_random);
+
+		for (i = nbr, dt = data; i--; dt++) {
+			EXPECT_TRUE(BLI_ghash_haskey(ghash, *dt));
+		}
+
+		TIMEIT_END(ptr_lookup_random);
+	}
+
+	{
+		TIMEIT_START(ptr_lookup_missing);
+
+		/* addresses past the elements, never stored */
+		for (i = nbr, dt = data; i--; dt++) {
+			EXPECT_FALSE(BLI_ghash_haskey(ghash, (char *)*dt + elem_size * nbr));
+		}
+
+		TIMEIT_END(ptr_lookup_missing);
+	}
+
+	{
+		TIMEIT_START(ptr_remove);
+
+		for (i = nbr, dt = data; i--; dt++) {
+			BLI_ghash_remove(ghash, *dt, NULL, NULL);
+		}
+
+		TIMEIT_END(ptr_remove);
+	}
+
+	BLI_ghash_free(ghash, NULL, NULL);
+	MEM_freeN(data);
+	MEM_freeN(elems);
+
+	printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ghash, PtrGHash1000000)
+{
+	GHash *ghash = BLI_ghash_ptr_new(__func__);
+
+	ptr_ghash_tests(ghash, "PtrGHash - Chaining - 1000000", 1000000);
+}
+
+TEST(ghash, PtrGHashOpenAddressing1000000)
+{
+	GHash *ghash = BLI_ghash_ptr_new(__func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING | GHASH_FLAG_ALLOW_SHRINK);
+
+	ptr_ghash_tests(ghash, "PtrGHash - Open Addressing - 1000000", 1000000);
+}
+
+
+/* Int2: pairs of vertex indices of the edges of a grid, as used for edge and face-corner maps. */
+
+static unsigned int ghashutil_tests_int2_p(const void *p)
+{
+	return BLI_hash_mm2((const unsigned char *)p, sizeof(unsigned int[2]), 0);
+}
+
+static bool ghashutil_tests_int2_cmp(const void *a, const void *b)
+{
+	return (memcmp(a, b, sizeof(unsigned int[2])) != 0);
+}
+
+static void int2_ghash_tests(GHash *ghash, const char *id, const unsigned int nbr)
+{
+	printf("\n========== STARTING %s ==========\n", id);
+
+	void *data_v = MEM_mallocN(sizeof(unsigned int[2]) * (size_t)nbr, __func__);
+	unsigned int (*data)[2] = (unsigned int (*)[2])data_v;
+	unsigned int (*dt)[2];
+	unsigned int i;
+
+	{
+		const unsigned int side = 1000;
+		for (i = 0, dt = data; i < nbr; i++, dt++) {
+			const unsigned int v = i / 2;
+			(*dt)[0] = v;
+			(*dt)[1] = (i & 1) ? v + side : v + 1;
+		}
+	}
+
+	{
+		TIMEIT_START(int_v2_insert);
+
+#ifdef GHASH_RESERVE
+		BLI_ghash_reserve(ghash, nbr);
+#endif
+
+		for (i = nbr, dt = data; i--; dt++) {
+			BLI_ghash_insert(ghash, *dt, SET_UINT_IN_POINTER(i));
+		}
+
+		TIMEIT_END(int_v2_insert);
+	}
+
+	PRINTF_GHASH_STATS(ghash);
+
+	{
+		TIMEIT_START(int_v2_lookup);
+
+		for (i = nbr, dt = data; i--; dt++) {
+			unsigned int key[2] = {(*dt)[0], (*dt)[1]};
+			void *v = BLI_ghash_lookup(ghash, key);
+			EXPECT_EQ(i, GET_UINT_FROM_POINTER(v));
+		}
+
+		TIMEIT_END(int_v2_lookup);
+	}
+
+	BLI_ghash_free(ghash, NULL, NULL);
+	MEM_freeN(data);
+
+	printf("========== ENDED %s ==========\n\n", id);
+}
+
+TEST(ghash, Int2GHash1000000)
+{
+	GHash *ghash = BLI_ghash_new(ghashutil_tests_int2_p, ghashutil_tests_int2_cmp, __func__);
+
+	int2_ghash_tests(ghash, "Int2GHash - Chaining - 1000000", 1000000);
+}
+
+TEST(ghash, Int2GHashOpenAddressing1000000)
+{
+	GHash *ghash = BLI_ghash_new(ghashutil_tests_int2_p, ghashutil_tests_int2_cmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	int2_ghash_tests(ghash, "Int2GHash - Open Addressing - 1000000", 1000000);
+}
+
+
+/* Open addressing storage with the string, int and int4 tests above. */
+
+TEST(ghash, TextGHashOpenAddressing)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	str_ghash_tests(ghash, "StrGHash - GHash - Open Addressing");
+}
+
+TEST(ghash, IntRandGHashOpenAddressing12000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	randint_ghash_tests(ghash, "RandIntGHash - GHash - Open Addressing - 12000", 12000);
+}
+
+TEST(ghash, IntRandGHash1000000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+
+	randint_ghash_tests(ghash, "RandIntGHash - GHash - 1000000", 1000000);
+}
+
+TEST(ghash, IntRandGHashOpenAddressing1000000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	randint_ghash_tests(ghash, "RandIntGHash - GHash - Open Addressing - 1000000", 1000000);
+}
+
+TEST(ghash, Int4GHashOpenAddressing2000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_uinthash_v4_p, BLI_ghashutil_uinthash_v4_cmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	int4_ghash_tests(ghash, "Int4GHash - GHash - Open Addressing - 2000", 2000);
+}
+
+TEST(ghash, MultiRandIntGHashOpenAddressing200000)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+
+	multi_small_ghash_tests(ghash, "MultiSmall RandIntGHash - GHash - Open Addressing - 200000", 200000);
+}
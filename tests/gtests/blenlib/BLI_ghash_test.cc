@@ -198,3 +198,264 @@ TEST(ghash, Pop)
 
 	BLI_ghash_free(ghash, NULL, NULL);
 }
+
+/* Open addressing storage, same tests as above. */
+
+static GHash *ghash_open_addressing_new(const char *info)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, info);
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+	return ghash;
+}
+
+TEST(ghash, OpenAddressingInsertLookup)
+{
+	GHash *ghash = ghash_open_addressing_new(__func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	init_keys(keys, 0);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+
+	EXPECT_EQ(TESTCASE_SIZE, BLI_ghash_size(ghash));
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void *v = BLI_ghash_lookup(ghash, SET_UINT_IN_POINTER(*k));
+		EXPECT_EQ(*k, GET_UINT_FROM_POINTER(v));
+		EXPECT_FALSE(BLI_ghash_haskey(ghash, SET_UINT_IN_POINTER(*k + 1)) && (*k + 1 != keys[0]));
+	}
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+TEST(ghash, OpenAddressingInsertRemoveShrink)
+{
+	GHash *ghash = ghash_open_addressing_new(__func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i, bkt_size;
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_ALLOW_SHRINK);
+	init_keys(keys, 20);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+
+	EXPECT_EQ(TESTCASE_SIZE, BLI_ghash_size(ghash));
+	bkt_size = BLI_ghash_buckets_size(ghash);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void *v = BLI_ghash_popkey(ghash, SET_UINT_IN_POINTER(*k), NULL);
+		EXPECT_EQ(*k, GET_UINT_FROM_POINTER(v));
+		/* the remaining keys must still be found after entries are shifted back */
+		if ((i % 1000) == 0) {
+			for (int j = 0; j < i; j++) {
+				EXPECT_TRUE(BLI_ghash_haskey(ghash, SET_UINT_IN_POINTER(k[j + 1])));
+			}
+		}
+	}
+
+	EXPECT_EQ(0, BLI_ghash_size(ghash));
+	EXPECT_LT(BLI_ghash_buckets_size(ghash), bkt_size);
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+TEST(ghash, OpenAddressingCopy)
+{
+	GHash *ghash = ghash_open_addressing_new(__func__);
+	GHash *ghash_copy;
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	init_keys(keys, 30);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+
+	ghash_copy = BLI_ghash_copy(ghash, NULL, NULL);
+
+	EXPECT_EQ(TESTCASE_SIZE, BLI_ghash_size(ghash_copy));
+	EXPECT_EQ(BLI_ghash_buckets_size(ghash), BLI_ghash_buckets_size(ghash_copy));
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void *v = BLI_ghash_lookup(ghash_copy, SET_UINT_IN_POINTER(*k));
+		EXPECT_EQ(*k, GET_UINT_FROM_POINTER(v));
+	}
+
+	BLI_ghash_free(ghash, NULL, NULL);
+	BLI_ghash_free(ghash_copy, NULL, NULL);
+}
+
+TEST(ghash, OpenAddressingPop)
+{
+	GHash *ghash = ghash_open_addressing_new(__func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_ALLOW_SHRINK);
+	init_keys(keys, 30);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+
+	GHashIterState pop_state = {0};
+
+	for (i = TESTCASE_SIZE / 2; i--; ) {
+		void *k, *v;
+		bool success = BLI_ghash_pop(ghash, &pop_state, &k, &v);
+		EXPECT_EQ(k, v);
+		EXPECT_EQ(success, true);
+
+		if (i % 2) {
+			BLI_ghash_insert(ghash, SET_UINT_IN_POINTER(i * 4), SET_UINT_IN_POINTER(i * 4));
+		}
+	}
+
+	EXPECT_EQ((TESTCASE_SIZE - TESTCASE_SIZE / 2 + TESTCASE_SIZE / 4), BLI_ghash_size(ghash));
+
+	{
+		void *k, *v;
+		while (BLI_ghash_pop(ghash, &pop_state, &k, &v)) {
+			EXPECT_EQ(k, v);
+		}
+	}
+	EXPECT_EQ(0, BLI_ghash_size(ghash));
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+TEST(ghash, OpenAddressingEnsureIterate)
+{
+	GHash *ghash = ghash_open_addressing_new(__func__);
+	GHashIterator gh_iter;
+	unsigned int keys[TESTCASE_SIZE], *k;
+	unsigned int sum = 0, sum_iter = 0, count = 0;
+	int i;
+
+	init_keys(keys, 40);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void **val_p;
+		EXPECT_FALSE(BLI_ghash_ensure_p(ghash, SET_UINT_IN_POINTER(*k), &val_p));
+		*val_p = SET_UINT_IN_POINTER(*k);
+		sum += *k;
+	}
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		void **val_p;
+		EXPECT_TRUE(BLI_ghash_ensure_p(ghash, SET_UINT_IN_POINTER(*k), &val_p));
+		EXPECT_EQ(*k, GET_UINT_FROM_POINTER(*val_p));
+	}
+
+	GHASH_ITER (gh_iter, ghash) {
+		EXPECT_EQ(BLI_ghashIterator_getKey(&gh_iter), BLI_ghashIterator_getValue(&gh_iter));
+		sum_iter += GET_UINT_FROM_POINTER(BLI_ghashIterator_getKey(&gh_iter));
+		count++;
+	}
+	EXPECT_EQ(TESTCASE_SIZE, count);
+	EXPECT_EQ(sum, sum_iter);
+
+	/* reinsert replaces values */
+	EXPECT_FALSE(BLI_ghash_reinsert(ghash, SET_UINT_IN_POINTER(keys[0]), NULL, NULL, NULL));
+	EXPECT_EQ(NULL, BLI_ghash_lookup(ghash, SET_UINT_IN_POINTER(keys[0])));
+	EXPECT_EQ(TESTCASE_SIZE, BLI_ghash_size(ghash));
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+/* All keys end up in one cluster. */
+static unsigned int ghashutil_tests_collide_p(const void *p)
+{
+	return GET_UINT_FROM_POINTER(p) % 7;
+}
+
+TEST(ghash, OpenAddressingCollisions)
+{
+	GHash *ghash = BLI_ghash_new(ghashutil_tests_collide_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int i;
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING | GHASH_FLAG_ALLOW_SHRINK);
+
+	for (i = 0; i < 500; i++) {
+		BLI_ghash_insert(ghash, SET_UINT_IN_POINTER(i), SET_UINT_IN_POINTER(i));
+	}
+	for (i = 0; i < 500; i += 3) {
+		EXPECT_TRUE(BLI_ghash_remove(ghash, SET_UINT_IN_POINTER(i), NULL, NULL));
+	}
+	for (i = 0; i < 500; i++) {
+		void *v = BLI_ghash_lookup(ghash, SET_UINT_IN_POINTER(i));
+		EXPECT_EQ((i % 3) ? i : 0, GET_UINT_FROM_POINTER(v));
+	}
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+/* Switching storage keeps all entries. */
+TEST(ghash, OpenAddressingConvert)
+{
+	GHash *ghash = BLI_ghash_new(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, __func__);
+	unsigned int keys[TESTCASE_SIZE], *k;
+	int i;
+
+	init_keys(keys, 50);
+
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		BLI_ghash_insert(ghash, SET_UINT_IN_POINTER(*k), SET_UINT_IN_POINTER(*k));
+	}
+
+	BLI_ghash_flag_set(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+	EXPECT_EQ(TESTCASE_SIZE, BLI_ghash_size(ghash));
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		EXPECT_EQ(*k, GET_UINT_FROM_POINTER(BLI_ghash_lookup(ghash, SET_UINT_IN_POINTER(*k))));
+	}
+
+	BLI_ghash_flag_clear(ghash, GHASH_FLAG_OPEN_ADDRESSING);
+	EXPECT_EQ(TESTCASE_SIZE, BLI_ghash_size(ghash));
+	for (i = TESTCASE_SIZE, k = keys; i--; k++) {
+		EXPECT_EQ(*k, GET_UINT_FROM_POINTER(BLI_ghash_lookup(ghash, SET_UINT_IN_POINTER(*k))));
+	}
+
+	BLI_ghash_free(ghash, NULL, NULL);
+}
+
+TEST(ghash, OpenAddressingGSet)
+{
+	GSet *gset = BLI_gset_str_new(__func__);
+	const char *words[] = {"first", "second", "third", "fourth", "fifth"};
+	void **key_p;
+	void *key;
+	int i;
+
+	BLI_gset_flag_set(gset, GHASH_FLAG_OPEN_ADDRESSING);
+
+	for (i = 0; i < 5; i++) {
+		EXPECT_TRUE(BLI_gset_add(gset, (void *)words[i]));
+	}
+	EXPECT_FALSE(BLI_gset_add(gset, (void *)"third"));
+	EXPECT_TRUE(BLI_gset_haskey(gset, "fifth"));
+	EXPECT_FALSE(BLI_gset_haskey(gset, "sixth"));
+
+	EXPECT_FALSE(BLI_gset_ensure_p_ex(gset, "sixth", &key_p));
+	*key_p = (void *)"sixth";
+	EXPECT_TRUE(BLI_gset_haskey(gset, "sixth"));
+	EXPECT_EQ(6, BLI_gset_size(gset));
+
+	EXPECT_TRUE(BLI_gset_remove(gset, "first", NULL));
+	EXPECT_FALSE(BLI_gset_haskey(gset, "first"));
+
+	GSetIterState pop_state = {0};
+	i = 0;
+	while (BLI_gset_pop(gset, &pop_state, &key)) {
+		EXPECT_NE((char *)NULL, (char *)key);
+		i++;
+	}
+	EXPECT_EQ(5, i);
+	EXPECT_EQ(0, BLI_gset_size(gset));
+
+	BLI_gset_free(gset, NULL);
+}
@@ -0,0 +1,224 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "PIL_time.h"
+}
+
+/* Number of rays and points of the query tests. */
+#define NUM_QUERIES 1000000
+
+class BVHTreePerformanceTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+	}
+};
+
+typedef struct TestMesh {
+	std::vector<float> verts;
+	std::vector<int> tris;
+
+	const float *vert(int tri, int corner) const
+	{
+		return &verts[tris[tri * 3 + corner] * 3];
+	}
+	int tris_num() const
+	{
+		return (int)tris.size() / 3;
+	}
+} TestMesh;
+
+/* A bumpy grid with (size * size * 2) triangles, with random triangles sizes
+ * so the median split is not as good as on a regular grid. */
+static void test_mesh_grid(TestMesh *mesh, const int size)
+{
+	RNG *rng = BLI_rng_new(1);
+	float x_co = 0.0f;
+
+	for (int x = 0; x <= size; x++) {
+		float y_co = 0.0f;
+		for (int y = 0; y <= size; y++) {
+			mesh->verts.push_back(x_co);
+			mesh->verts.push_back(y_co);
+			mesh->verts.push_back(sinf(x_co * 0.3f) * cosf(y_co * 0.2f) * 4.0f);
+			y_co += (y % 16 < 2) ? 8.0f : 0.5f;
+		}
+		x_co += (BLI_rng_get_float(rng) < 0.1f) ? 8.0f : 0.5f;
+	}
+
+	for (int x = 0; x < size; x++) {
+		for (int y = 0; y < size; y++) {
+			const int v = x * (size + 1) + y;
+			const int quad[2][3] = {{v, v + 1, v + size + 2}, {v, v + size + 2, v + size + 1}};
+			for (int i = 0; i < 2; i++) {
+				mesh->tris.insert(mesh->tris.end(), quad[i], quad[i] + 3);
+			}
+		}
+	}
+
+	BLI_rng_free(rng);
+}
+
+static BVHTree *test_mesh_tree(const TestMesh *mesh, const int tree_type, const int flag)
+{
+	BVHTree *tree = BLI_bvhtree_new(mesh->tris_num(), 0.0f, tree_type, 6);
+
+	for (int i = 0; i < mesh->tris_num(); i++) {
+		float co[3][3];
+		for (int j = 0; j < 3; j++) {
+			copy_v3_v3(co[j], mesh->vert(i, j));
+		}
+		BLI_bvhtree_insert(tree, i, co[0], 3);
+	}
+	BLI_bvhtree_balance_ex(tree, flag);
+
+	return tree;
+}
+
+static void test_mesh_raycast_cb(void *userdata, int index, const BVHTreeRay *ray, BVHTreeRayHit *hit)
+{
+	const TestMesh *mesh = (const TestMesh *)userdata;
+	float dist;
+
+	if (isect_ray_tri_watertight_v3(ray->origin, ray->isect_precalc,
+	                                mesh->vert(index, 0), mesh->vert(index, 1), mesh->vert(index, 2), &dist, NULL) &&
+	    (dist < hit->dist))
+	{
+		hit->index = index;
+		hit->dist = dist;
+	}
+}
+
+static void test_mesh_nearest_cb(void *userdata, int index, const float co[3], BVHTreeNearest *nearest)
+{
+	const TestMesh *mesh = (const TestMesh *)userdata;
+	float nearest_tmp[3], dist_sq;
+
+	closest_on_tri_to_point_v3(nearest_tmp, co, mesh->vert(index, 0), mesh->vert(index, 1), mesh->vert(index, 2));
+	dist_sq = len_squared_v3v3(co, nearest_tmp);
+
+	if (dist_sq < nearest->dist_sq) {
+		nearest->index = index;
+		nearest->dist_sq = dist_sq;
+		copy_v3_v3(nearest->co, nearest_tmp);
+	}
+}
+
+/* Coherent queries, like the rays of a camera or the vertices of a mesh: a grid above the mesh. */
+static void test_queries(const TestMesh *mesh, std::vector<float> &co, std::vector<float> &dir)
+{
+	float min[3], max[3];
+	const int side = (int)sqrtf((float)NUM_QUERIES);
+
+	INIT_MINMAX(min, max);
+	for (size_t i = 0; i < mesh->verts.size(); i += 3) {
+		minmax_v3v3_v3(min, max, &mesh->verts[i]);
+	}
+
+	co.resize(NUM_QUERIES * 3);
+	dir.resize(NUM_QUERIES * 3);
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		const float u = (float)(i % side) / (float)side, v = (float)(i / side) / (float)side;
+		float *c = &co[i * 3], *d = &dir[i * 3];
+
+		c[0] = min[0] + (max[0] - min[0]) * u;
+		c[1] = min[1] + (max[1] - min[1]) * v;
+		c[2] = max[2] + 2.0f;
+
+		d[0] = u - 0.5f;
+		d[1] = v - 0.5f;
+		d[2] = -2.0f;
+		normalize_v3(d);
+	}
+}
+
+static void bvhtree_test(const int size, const int tree_type)
+{
+	TestMesh mesh;
+	std::vector<float> co, dir;
+	std::vector<BVHTreeRayHit> hits(NUM_QUERIES);
+	std::vector<BVHTreeNearest> nearest(NUM_QUERIES);
+	double time;
+
+	test_mesh_grid(&mesh, size);
+	test_queries(&mesh, co, dir);
+
+	printf("\n========== STARTING %s, %d triangles, tree type %d ==========\n",
+	       __func__, mesh.tris_num(), tree_type);
+
+	for (int flag = 0; flag <= BVH_BALANCE_SAH; flag += BVH_BALANCE_SAH) {
+		const char *name = flag ? "SAH" : "median";
+
+		time = PIL_check_seconds_timer();
+		BVHTree *tree = test_mesh_tree(&mesh, tree_type, flag);
+		printf("%s build: %.3fs\n", name, PIL_check_seconds_timer() - time);
+
+		time = PIL_check_seconds_timer();
+		for (int i = 0; i < NUM_QUERIES; i++) {
+			hits[i].index = -1;
+			hits[i].dist = BVH_RAYCAST_DIST_MAX;
+			BLI_bvhtree_ray_cast(tree, &co[i * 3], &dir[i * 3], 0.0f, &hits[i], test_mesh_raycast_cb, &mesh);
+		}
+		printf("%s ray-cast single: %.3fs\n", name, PIL_check_seconds_timer() - time);
+
+		time = PIL_check_seconds_timer();
+		for (int i = 0; i < NUM_QUERIES; i++) {
+			hits[i].index = -1;
+			hits[i].dist = BVH_RAYCAST_DIST_MAX;
+		}
+		BLI_bvhtree_ray_cast_batch(tree, (const float (*)[3])&co[0], (const float (*)[3])&dir[0], NUM_QUERIES, 0.0f,
+		                           &hits[0], test_mesh_raycast_cb, &mesh, BVH_RAYCAST_DEFAULT);
+		printf("%s ray-cast batch: %.3fs\n", name, PIL_check_seconds_timer() - time);
+
+		time = PIL_check_seconds_timer();
+		for (int i = 0; i < NUM_QUERIES; i++) {
+			nearest[i].index = -1;
+			nearest[i].dist_sq = FLT_MAX;
+			BLI_bvhtree_find_nearest(tree, &co[i * 3], &nearest[i], test_mesh_nearest_cb, &mesh);
+		}
+		printf("%s nearest single: %.3fs\n", name, PIL_check_seconds_timer() - time);
+
+		time = PIL_check_seconds_timer();
+		for (int i = 0; i < NUM_QUERIES; i++) {
+			nearest[i].index = -1;
+			nearest[i].dist_sq = FLT_MAX;
+		}
+		BLI_bvhtree_find_nearest_batch(tree, (const float (*)[3])&co[0], NUM_QUERIES, &nearest[0],
+		                               test_mesh_nearest_cb, &mesh);
+		printf("%s nearest batch: %.3fs\n", name, PIL_check_seconds_timer() - time);
+
+		BLI_bvhtree_free(tree);
+	}
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST_F(BVHTreePerformanceTest, Tris10k)
+{
+	bvhtree_test(71, 4);
+}
+
+TEST_F(BVHTreePerformanceTest, Tris100k)
+{
+	bvhtree_test(224, 4);
+}
+
+TEST_F(BVHTreePerformanceTest, Tris1M)
+{
+	bvhtree_test(707, 4);
+}
+
+TEST_F(BVHTreePerformanceTest, Tris1MBinary)
+{
+	bvhtree_test(707, 2);
+}
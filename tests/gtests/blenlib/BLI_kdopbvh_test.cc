@@ -0,0 +1,341 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+}
+
+/* Number of quads along the sides of the test grid, two triangles each. */
+#define GRID_SIZE 64
+
+/* Not a multiple of the packet size, so the last packet is not full. */
+#define NUM_QUERIES 1001
+
+class BVHTreeTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		/* the batched queries and the build of large trees use the task scheduler */
+		BLI_threadapi_init();
+	}
+};
+
+typedef struct TestMesh {
+	std::vector<float> verts;
+	std::vector<int> tris;
+
+	const float *vert(int tri, int corner) const
+	{
+		return &verts[tris[tri * 3 + corner] * 3];
+	}
+	int tris_num() const
+	{
+		return (int)tris.size() / 3;
+	}
+} TestMesh;
+
+/* A bumpy grid, with a phase to get moved versions of it. */
+static void test_mesh_grid(TestMesh *mesh, const int size, const float phase)
+{
+	mesh->verts.clear();
+	mesh->tris.clear();
+
+	for (int y = 0; y <= size; y++) {
+		for (int x = 0; x <= size; x++) {
+			mesh->verts.push_back((float)x);
+			mesh->verts.push_back((float)y);
+			mesh->verts.push_back(sinf((float)x * 0.3f + phase) * cosf((float)y * 0.2f) * 4.0f);
+		}
+	}
+
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			const int v = y * (size + 1) + x;
+			const int quad[2][3] = {{v, v + 1, v + size + 2}, {v, v + size + 2, v + size + 1}};
+			for (int i = 0; i < 2; i++) {
+				mesh->tris.insert(mesh->tris.end(), quad[i], quad[i] + 3);
+			}
+		}
+	}
+}
+
+static BVHTree *test_mesh_tree(const TestMesh *mesh, const int tree_type, const int flag)
+{
+	BVHTree *tree = BLI_bvhtree_new(mesh->tris_num(), 0.0f, tree_type, 6);
+
+	for (int i = 0; i < mesh->tris_num(); i++) {
+		float co[3][3];
+		for (int j = 0; j < 3; j++) {
+			copy_v3_v3(co[j], mesh->vert(i, j));
+		}
+		BLI_bvhtree_insert(tree, i, co[0], 3);
+	}
+	BLI_bvhtree_balance_ex(tree, flag);
+
+	return tree;
+}
+
+static void test_mesh_raycast_cb(void *userdata, int index, const BVHTreeRay *ray, BVHTreeRayHit *hit)
+{
+	const TestMesh *mesh = (const TestMesh *)userdata;
+	float dist;
+
+	if (isect_ray_tri_watertight_v3(ray->origin, ray->isect_precalc,
+	                                mesh->vert(index, 0), mesh->vert(index, 1), mesh->vert(index, 2), &dist, NULL) &&
+	    (dist < hit->dist))
+	{
+		hit->index = index;
+		hit->dist = dist;
+		madd_v3_v3v3fl(hit->co, ray->origin, ray->direction, dist);
+	}
+}
+
+static void test_mesh_nearest_cb(void *userdata, int index, const float co[3], BVHTreeNearest *nearest)
+{
+	const TestMesh *mesh = (const TestMesh *)userdata;
+	float nearest_tmp[3], dist_sq;
+
+	closest_on_tri_to_point_v3(nearest_tmp, co, mesh->vert(index, 0), mesh->vert(index, 1), mesh->vert(index, 2));
+	dist_sq = len_squared_v3v3(co, nearest_tmp);
+
+	if (dist_sq < nearest->dist_sq) {
+		nearest->index = index;
+		nearest->dist_sq = dist_sq;
+		copy_v3_v3(nearest->co, nearest_tmp);
+	}
+}
+
+/* Rays from above the grid, pointing down in random directions, and points around it. */
+static void test_queries(std::vector<float> &co, std::vector<float> &dir, const int num)
+{
+	RNG *rng = BLI_rng_new(1);
+
+	co.resize(num * 3);
+	dir.resize(num * 3);
+	for (int i = 0; i < num; i++) {
+		float *v = &co[i * 3], *d = &dir[i * 3];
+
+		v[0] = BLI_rng_get_float(rng) * GRID_SIZE;
+		v[1] = BLI_rng_get_float(rng) * GRID_SIZE;
+		v[2] = BLI_rng_get_float(rng) * 16.0f - 8.0f;
+
+		BLI_rng_get_float_unit_v3(rng, d);
+		if (i % 8 == 0) {
+			/* rays away from the grid, missing it */
+			v[2] = 10.0f;
+			d[2] = fabsf(d[2]);
+		}
+	}
+
+	BLI_rng_free(rng);
+}
+
+static void test_ray_cast_batch(const TestMesh *mesh, BVHTree *tree, const bool use_callback, const float radius)
+{
+	std::vector<float> co, dir;
+	std::vector<BVHTreeRayHit> hits(NUM_QUERIES);
+	BVHTree_RayCastCallback callback = use_callback ? test_mesh_raycast_cb : NULL;
+
+	test_queries(co, dir, NUM_QUERIES);
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		hits[i].index = -1;
+		hits[i].dist = (i % 3 == 0) ? 5.0f : BVH_RAYCAST_DIST_MAX;
+	}
+
+	BLI_bvhtree_ray_cast_batch(tree, (const float (*)[3])&co[0], (const float (*)[3])&dir[0], NUM_QUERIES,
+	                           radius, &hits[0], callback, (void *)mesh, BVH_RAYCAST_DEFAULT);
+
+	int hits_num = 0;
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		BVHTreeRayHit hit;
+		hit.index = -1;
+		hit.dist = (i % 3 == 0) ? 5.0f : BVH_RAYCAST_DIST_MAX;
+
+		BLI_bvhtree_ray_cast(tree, &co[i * 3], &dir[i * 3], radius, &hit, callback, (void *)mesh);
+
+		EXPECT_EQ(hit.index, hits[i].index);
+		EXPECT_EQ(hit.dist, hits[i].dist);
+		hits_num += (hit.index != -1);
+	}
+
+	/* make sure the test is not trivial */
+	EXPECT_LT(NUM_QUERIES / 4, hits_num);
+}
+
+static void test_find_nearest_batch(const TestMesh *mesh, BVHTree *tree, const bool use_callback)
+{
+	std::vector<float> co, dir;
+	std::vector<BVHTreeNearest> nearest(NUM_QUERIES);
+	BVHTree_NearestPointCallback callback = use_callback ? test_mesh_nearest_cb : NULL;
+
+	test_queries(co, dir, NUM_QUERIES);
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		nearest[i].index = -1;
+		nearest[i].dist_sq = (i % 3 == 0) ? 1.0f : FLT_MAX;
+	}
+
+	BLI_bvhtree_find_nearest_batch(tree, (const float (*)[3])&co[0], NUM_QUERIES, &nearest[0],
+	                               callback, (void *)mesh);
+
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		BVHTreeNearest single;
+		single.index = -1;
+		single.dist_sq = (i % 3 == 0) ? 1.0f : FLT_MAX;
+
+		BLI_bvhtree_find_nearest(tree, &co[i * 3], &single, callback, (void *)mesh);
+
+		/* points can be nearest to several triangles, only the distance is unique */
+		EXPECT_EQ(single.index == -1, nearest[i].index == -1);
+		EXPECT_EQ(single.dist_sq, nearest[i].dist_sq);
+	}
+}
+
+TEST_F(BVHTreeTest, RayCastBatch)
+{
+	TestMesh mesh;
+	test_mesh_grid(&mesh, GRID_SIZE, 0.0f);
+
+	for (int tree_type = 2; tree_type <= 8; tree_type *= 2) {
+		BVHTree *tree = test_mesh_tree(&mesh, tree_type, 0);
+		test_ray_cast_batch(&mesh, tree, true, 0.0f);
+		/* rays with a radius are not cast in packets */
+		test_ray_cast_batch(&mesh, tree, true, 0.1f);
+		BLI_bvhtree_free(tree);
+	}
+}
+
+TEST_F(BVHTreeTest, RayCastBatchNoCallback)
+{
+	TestMesh mesh;
+	test_mesh_grid(&mesh, 4, 0.0f);
+
+	BVHTree *tree = test_mesh_tree(&mesh, 4, 0);
+	std::vector<float> co, dir;
+	std::vector<BVHTreeRayHit> hits(NUM_QUERIES);
+
+	/* hits the bounds of the leafs, the rays start outside of the grid bounds */
+	test_queries(co, dir, NUM_QUERIES);
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		co[i * 3 + 2] = 10.0f;
+		dir[i * 3 + 2] = -fabsf(dir[i * 3 + 2]);
+		hits[i].index = -1;
+		hits[i].dist = BVH_RAYCAST_DIST_MAX;
+	}
+
+	BLI_bvhtree_ray_cast_batch(tree, (const float (*)[3])&co[0], (const float (*)[3])&dir[0], NUM_QUERIES,
+	                           0.0f, &hits[0], NULL, NULL, BVH_RAYCAST_DEFAULT);
+
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		BVHTreeRayHit hit;
+		hit.index = -1;
+		hit.dist = BVH_RAYCAST_DIST_MAX;
+		BLI_bvhtree_ray_cast(tree, &co[i * 3], &dir[i * 3], 0.0f, &hit, NULL, NULL);
+
+		EXPECT_EQ(hit.index == -1, hits[i].index == -1);
+		EXPECT_EQ(hit.dist, hits[i].dist);
+	}
+
+	BLI_bvhtree_free(tree);
+}
+
+TEST_F(BVHTreeTest, FindNearestBatch)
+{
+	TestMesh mesh;
+	test_mesh_grid(&mesh, GRID_SIZE, 0.0f);
+
+	for (int tree_type = 2; tree_type <= 8; tree_type *= 2) {
+		BVHTree *tree = test_mesh_tree(&mesh, tree_type, 0);
+		test_find_nearest_batch(&mesh, tree, true);
+		test_find_nearest_batch(&mesh, tree, false);
+		BLI_bvhtree_free(tree);
+	}
+}
+
+TEST_F(BVHTreeTest, SAHBalance)
+{
+	TestMesh mesh;
+	test_mesh_grid(&mesh, GRID_SIZE, 0.0f);
+
+	for (int tree_type = 2; tree_type <= 8; tree_type *= 2) {
+		BVHTree *tree = test_mesh_tree(&mesh, tree_type, 0);
+		BVHTree *tree_sah = test_mesh_tree(&mesh, tree_type, BVH_BALANCE_SAH);
+		std::vector<float> co, dir;
+
+		test_queries(co, dir, NUM_QUERIES);
+		for (int i = 0; i < NUM_QUERIES; i++) {
+			BVHTreeRayHit hit, hit_sah;
+			BVHTreeNearest nearest, nearest_sah;
+
+			hit.index = hit_sah.index = -1;
+			hit.dist = hit_sah.dist = BVH_RAYCAST_DIST_MAX;
+			BLI_bvhtree_ray_cast(tree, &co[i * 3], &dir[i * 3], 0.0f, &hit, test_mesh_raycast_cb, &mesh);
+			BLI_bvhtree_ray_cast(tree_sah, &co[i * 3], &dir[i * 3], 0.0f, &hit_sah, test_mesh_raycast_cb, &mesh);
+			EXPECT_EQ(hit.index, hit_sah.index);
+			EXPECT_EQ(hit.dist, hit_sah.dist);
+
+			nearest.index = nearest_sah.index = -1;
+			nearest.dist_sq = nearest_sah.dist_sq = FLT_MAX;
+			BLI_bvhtree_find_nearest(tree, &co[i * 3], &nearest, test_mesh_nearest_cb, &mesh);
+			BLI_bvhtree_find_nearest(tree_sah, &co[i * 3], &nearest_sah, test_mesh_nearest_cb, &mesh);
+			EXPECT_EQ(nearest.dist_sq, nearest_sah.dist_sq);
+		}
+
+		/* batched queries on the SAH tree */
+		test_ray_cast_batch(&mesh, tree_sah, true, 0.0f);
+		test_find_nearest_batch(&mesh, tree_sah, true);
+
+		BLI_bvhtree_free(tree);
+		BLI_bvhtree_free(tree_sah);
+	}
+}
+
+TEST_F(BVHTreeTest, SAHBalanceUpdate)
+{
+	TestMesh mesh, mesh_moved;
+	test_mesh_grid(&mesh, GRID_SIZE, 0.0f);
+	test_mesh_grid(&mesh_moved, GRID_SIZE, 1.0f);
+
+	/* refitting relies on the children being after their parent in the nodes */
+	BVHTree *tree = test_mesh_tree(&mesh, 4, BVH_BALANCE_SAH);
+	for (int i = 0; i < mesh_moved.tris_num(); i++) {
+		float co[3][3];
+		for (int j = 0; j < 3; j++) {
+			copy_v3_v3(co[j], mesh_moved.vert(i, j));
+		}
+		BLI_bvhtree_update_node(tree, i, co[0], NULL, 3);
+	}
+	BLI_bvhtree_update_tree(tree);
+
+	test_ray_cast_batch(&mesh_moved, tree, true, 0.0f);
+	test_find_nearest_batch(&mesh_moved, tree, true);
+
+	BLI_bvhtree_free(tree);
+}
+
+TEST_F(BVHTreeTest, SAHBalanceSmall)
+{
+	/* fewer leafs than a node can have children, and all leafs at the same position */
+	for (int num = 1; num < 12; num++) {
+		BVHTree *tree = BLI_bvhtree_new(num, 0.0f, 4, 6);
+		const float co[3] = {1.0f, 2.0f, 3.0f};
+		for (int i = 0; i < num; i++) {
+			BLI_bvhtree_insert(tree, i, co, 1);
+		}
+		BLI_bvhtree_balance_ex(tree, BVH_BALANCE_SAH);
+
+		BVHTreeNearest nearest;
+		nearest.index = -1;
+		nearest.dist_sq = FLT_MAX;
+		EXPECT_NE(-1, BLI_bvhtree_find_nearest(tree, co, &nearest, NULL, NULL));
+		EXPECT_EQ(0.0f, nearest.dist_sq);
+
+		BLI_bvhtree_free(tree);
+	}
+}
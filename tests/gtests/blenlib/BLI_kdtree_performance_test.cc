@@ -0,0 +1,130 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <math.h>
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_kdtree.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "MEM_guardedalloc.h"
+#include "PIL_time.h"
+}
+
+/* Number of points of the query tests. */
+#define NUM_QUERIES 1000000
+
+/* Number of nearest points found by the k-nearest queries. */
+#define NUM_NEAREST 8
+
+class KDTreePerformanceTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+	}
+};
+
+static void random_points(std::vector<float> &co, const int num, const unsigned int seed)
+{
+	RNG *rng = BLI_rng_new(seed);
+
+	co.resize(num * 3);
+	for (int i = 0; i < num * 3; i++) {
+		co[i] = BLI_rng_get_float(rng);
+	}
+
+	BLI_rng_free(rng);
+}
+
+static void kdtree_test(const int num)
+{
+	std::vector<float> points, co;
+	std::vector<KDTreeNearest> nearest(NUM_QUERIES * NUM_NEAREST);
+	std::vector<int> found(NUM_QUERIES);
+	/* about NUM_NEAREST points in range */
+	const float range = cbrtf(3.0f * NUM_NEAREST / (4.0f * (float)M_PI * (float)num));
+	double time;
+	size_t found_tot;
+
+	random_points(points, num, 1);
+	random_points(co, NUM_QUERIES, 2);
+
+	printf("\n========== STARTING %s, %d points ==========\n", __func__, num);
+
+	time = PIL_check_seconds_timer();
+	KDTree *tree = BLI_kdtree_new((unsigned int)num);
+	for (int i = 0; i < num; i++) {
+		BLI_kdtree_insert(tree, i, &points[i * 3]);
+	}
+	BLI_kdtree_balance(tree);
+	printf("build: %.3fs\n", PIL_check_seconds_timer() - time);
+
+	time = PIL_check_seconds_timer();
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		BLI_kdtree_find_nearest(tree, &co[i * 3], &nearest[i]);
+	}
+	printf("nearest single: %.3fs\n", PIL_check_seconds_timer() - time);
+
+	time = PIL_check_seconds_timer();
+	found_tot = 0;
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		found_tot += (size_t)BLI_kdtree_find_nearest_n(tree, &co[i * 3], &nearest[i * NUM_NEAREST], NUM_NEAREST);
+	}
+	printf("%d nearest single: %.3fs, %d found\n", NUM_NEAREST, PIL_check_seconds_timer() - time, (int)found_tot);
+
+	time = PIL_check_seconds_timer();
+	BLI_kdtree_find_nearest_n_batch(tree, (const float (*)[3])&co[0], NUM_QUERIES, &nearest[0], NUM_NEAREST, &found[0]);
+	found_tot = 0;
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		found_tot += (size_t)found[i];
+	}
+	printf("%d nearest batch: %.3fs, %d found\n", NUM_NEAREST, PIL_check_seconds_timer() - time, (int)found_tot);
+
+	time = PIL_check_seconds_timer();
+	found_tot = 0;
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		KDTreeNearest *range_nearest = NULL;
+		found_tot += (size_t)BLI_kdtree_range_search(tree, &co[i * 3], &range_nearest, range);
+		if (range_nearest) {
+			MEM_freeN(range_nearest);
+		}
+	}
+	printf("range single: %.3fs, %d found\n", PIL_check_seconds_timer() - time, (int)found_tot);
+
+	time = PIL_check_seconds_timer();
+	BLI_kdtree_range_search_batch(tree, (const float (*)[3])&co[0], NUM_QUERIES, range,
+	                              &nearest[0], NUM_NEAREST, &found[0]);
+	found_tot = 0;
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		found_tot += (size_t)found[i];
+	}
+	printf("range batch (up to %d): %.3fs, %d found\n", NUM_NEAREST, PIL_check_seconds_timer() - time, (int)found_tot);
+
+	BLI_kdtree_free(tree);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST_F(KDTreePerformanceTest, Points10k)
+{
+	kdtree_test(10000);
+}
+
+TEST_F(KDTreePerformanceTest, Points100k)
+{
+	kdtree_test(100000);
+}
+
+TEST_F(KDTreePerformanceTest, Points1M)
+{
+	kdtree_test(1000000);
+}
+
+TEST_F(KDTreePerformanceTest, Points10M)
+{
+	kdtree_test(10000000);
+}
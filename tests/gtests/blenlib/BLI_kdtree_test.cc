@@ -0,0 +1,178 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <algorithm>
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_kdtree.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "MEM_guardedalloc.h"
+}
+
+/* Number of query points, not a multiple of anything. */
+#define NUM_QUERIES 1001
+
+class KDTreeTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		/* the balance of large trees and the batched queries use the task scheduler */
+		BLI_threadapi_init();
+	}
+};
+
+static void random_points(std::vector<float> &co, const int num, const unsigned int seed)
+{
+	RNG *rng = BLI_rng_new(seed);
+
+	co.resize(num * 3);
+	for (int i = 0; i < num * 3; i++) {
+		co[i] = BLI_rng_get_float(rng);
+	}
+
+	BLI_rng_free(rng);
+}
+
+static KDTree *points_tree(const std::vector<float> &points)
+{
+	const int num = (int)points.size() / 3;
+	KDTree *tree = BLI_kdtree_new((unsigned int)num);
+
+	for (int i = 0; i < num; i++) {
+		BLI_kdtree_insert(tree, i, &points[i * 3]);
+	}
+	BLI_kdtree_balance(tree);
+
+	return tree;
+}
+
+/* Sorted distances of all points to co. */
+static std::vector<float> points_distances(const std::vector<float> &points, const float co[3])
+{
+	std::vector<float> dist;
+
+	for (size_t i = 0; i < points.size(); i += 3) {
+		dist.push_back(len_v3v3(&points[i], co));
+	}
+	std::sort(dist.begin(), dist.end());
+
+	return dist;
+}
+
+static void kdtree_test_queries(const int num, const unsigned int n)
+{
+	std::vector<float> points, co;
+	random_points(points, num, 1);
+	random_points(co, NUM_QUERIES, 2);
+
+	KDTree *tree = points_tree(points);
+	const float range = 0.1f;
+
+	std::vector<KDTreeNearest> nearest_batch(NUM_QUERIES * n);
+	std::vector<int> found_batch(NUM_QUERIES);
+	std::vector<KDTreeNearest> range_batch(NUM_QUERIES * n);
+	std::vector<int> range_found_batch(NUM_QUERIES);
+
+	BLI_kdtree_find_nearest_n_batch(tree, (const float (*)[3])&co[0], NUM_QUERIES, &nearest_batch[0], n, &found_batch[0]);
+	BLI_kdtree_range_search_batch(tree, (const float (*)[3])&co[0], NUM_QUERIES, range,
+	                              &range_batch[0], n, &range_found_batch[0]);
+
+	for (int i = 0; i < NUM_QUERIES; i++) {
+		const float *q = &co[i * 3];
+		const std::vector<float> dist = points_distances(points, q);
+		const int dist_num = (int)dist.size();
+		std::vector<KDTreeNearest> nearest(n);
+		KDTreeNearest *range_nearest = NULL;
+
+		/* nearest */
+		KDTreeNearest nearest_single;
+		const int index = BLI_kdtree_find_nearest(tree, q, &nearest_single);
+		if (num == 0) {
+			EXPECT_EQ(-1, index);
+		}
+		else {
+			EXPECT_LE(0, index);
+			EXPECT_FLOAT_EQ(dist[0], nearest_single.dist);
+		}
+
+		/* n nearest */
+		const int found = BLI_kdtree_find_nearest_n(tree, q, &nearest[0], n);
+		EXPECT_EQ(min_ii(dist_num, (int)n), found);
+		EXPECT_EQ(found, found_batch[i]);
+		for (int j = 0; j < found; j++) {
+			EXPECT_FLOAT_EQ(dist[j], nearest[j].dist);
+			EXPECT_EQ(nearest[j].dist, nearest_batch[i * n + j].dist);
+			EXPECT_FLOAT_EQ(nearest[j].dist, len_v3v3(&points[nearest[j].index * 3], q));
+		}
+
+		/* range */
+		const int range_found = BLI_kdtree_range_search(tree, q, &range_nearest, range);
+		const int range_num = (int)(std::upper_bound(dist.begin(), dist.end(), range) - dist.begin());
+		EXPECT_EQ(range_num, range_found);
+		EXPECT_EQ(min_ii(range_num, (int)n), range_found_batch[i]);
+		for (int j = 0; j < range_found_batch[i]; j++) {
+			EXPECT_EQ(range_nearest[j].dist, range_batch[i * n + j].dist);
+			EXPECT_LE(range_batch[i * n + j].dist, range);
+		}
+		if (range_nearest) {
+			MEM_freeN(range_nearest);
+		}
+	}
+
+	BLI_kdtree_free(tree);
+}
+
+TEST_F(KDTreeTest, QueriesEmpty)
+{
+	kdtree_test_queries(0, 4);
+}
+
+TEST_F(KDTreeTest, QueriesSmall)
+{
+	for (int num = 1; num < 10; num++) {
+		kdtree_test_queries(num, 4);
+	}
+}
+
+TEST_F(KDTreeTest, Queries)
+{
+	kdtree_test_queries(1000, 1);
+	kdtree_test_queries(1000, 10);
+}
+
+TEST_F(KDTreeTest, QueriesLarge)
+{
+	/* balanced in parallel */
+	kdtree_test_queries(20000, 8);
+}
+
+TEST_F(KDTreeTest, Duplicates)
+{
+	/* many points at the same position, some with the same split coordinates */
+	std::vector<float> points;
+	for (int i = 0; i < 20000; i++) {
+		points.push_back((float)(i % 3));
+		points.push_back((float)(i % 5));
+		points.push_back(0.0f);
+	}
+	KDTree *tree = points_tree(points);
+
+	for (int i = 0; i < 15; i++) {
+		const float co[3] = {(float)(i % 3), (float)(i % 5), 0.0f};
+		KDTreeNearest nearest[10];
+
+		const int found = BLI_kdtree_find_nearest_n(tree, co, nearest, 10);
+		EXPECT_EQ(10, found);
+		for (int j = 0; j < found; j++) {
+			EXPECT_EQ(0.0f, nearest[j].dist);
+			EXPECT_EQ(i, nearest[j].index % 15);
+		}
+	}
+
+	BLI_kdtree_free(tree);
+}
@@ -0,0 +1,168 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_mempool.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "MEM_guardedalloc.h"
+#include "atomic_ops.h"
+}
+
+#define NUM_ELEMS 100000
+
+class MempoolTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+	}
+};
+
+typedef struct TestElem {
+	int value;
+	int pad[3];
+} TestElem;
+
+typedef struct ThreadsafeData {
+	BLI_mempool *pool;
+	TestElem **elems;
+} ThreadsafeData;
+
+static void threadsafe_alloc_func(void *userdata, void *UNUSED(userdata_chunk), const int iter, const int thread_id)
+{
+	ThreadsafeData *data = (ThreadsafeData *)userdata;
+	TestElem *elem = (TestElem *)BLI_mempool_alloc_threadsafe(data->pool, thread_id);
+
+	elem->value = iter;
+	data->elems[iter] = elem;
+}
+
+static void threadsafe_free_func(void *userdata, void *UNUSED(userdata_chunk), const int iter, const int thread_id)
+{
+	ThreadsafeData *data = (ThreadsafeData *)userdata;
+
+	/* freed in a different order than allocated, likely by other threads */
+	const int index = NUM_ELEMS - 1 - iter;
+	EXPECT_EQ(index, data->elems[index]->value);
+	BLI_mempool_free_threadsafe(data->pool, data->elems[index], thread_id);
+}
+
+static void parallel_mempool_func(void *userdata, void *elem, const int UNUSED(thread_id))
+{
+	size_t *sum = (size_t *)userdata;
+	atomic_add_z(sum, (size_t)((TestElem *)elem)->value);
+}
+
+static BLI_mempool *test_pool(std::vector<TestElem *> &elems, const int step)
+{
+	BLI_mempool *pool = BLI_mempool_create(sizeof(TestElem), 0, 512, BLI_MEMPOOL_ALLOW_ITER);
+
+	elems.resize(NUM_ELEMS);
+	for (int i = 0; i < NUM_ELEMS; i++) {
+		elems[i] = (TestElem *)BLI_mempool_alloc(pool);
+		elems[i]->value = i;
+	}
+	/* leave holes */
+	for (int i = 0; i < NUM_ELEMS; i += step) {
+		BLI_mempool_free(pool, elems[i]);
+		elems[i] = NULL;
+	}
+
+	return pool;
+}
+
+TEST_F(MempoolTest, Threadsafe)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	const int num_threads = BLI_task_scheduler_num_threads(scheduler);
+	std::vector<TestElem *> elems(NUM_ELEMS);
+	ThreadsafeData data = {NULL, &elems[0]};
+
+	data.pool = BLI_mempool_create_threadsafe(sizeof(TestElem), 0, 512, BLI_MEMPOOL_ALLOW_ITER,
+	                                          (unsigned int)num_threads);
+
+	for (int pass = 0; pass < 2; pass++) {
+		BLI_task_parallel_range_ex(0, NUM_ELEMS, &data, NULL, 0, threadsafe_alloc_func, true, true);
+		EXPECT_EQ(NUM_ELEMS, BLI_mempool_count(data.pool));
+
+		/* all elements are distinct and found by iterating */
+		size_t sum = 0;
+		BLI_task_parallel_mempool(data.pool, &sum, parallel_mempool_func, true);
+		EXPECT_EQ((size_t)NUM_ELEMS * (NUM_ELEMS - 1) / 2, sum);
+
+		BLI_task_parallel_range_ex(0, NUM_ELEMS, &data, NULL, 0, threadsafe_free_func, true, true);
+		EXPECT_EQ(0, BLI_mempool_count(data.pool));
+	}
+
+	/* regular functions are those of the main thread */
+	void *elem = BLI_mempool_alloc(data.pool);
+	EXPECT_EQ(1, BLI_mempool_count(data.pool));
+	BLI_mempool_free(data.pool, elem);
+	EXPECT_EQ(0, BLI_mempool_count(data.pool));
+
+	BLI_mempool_destroy(data.pool);
+}
+
+TEST_F(MempoolTest, IterRanges)
+{
+	std::vector<TestElem *> elems;
+	BLI_mempool *pool = test_pool(elems, 3);
+	const int count = BLI_mempool_count(pool);
+
+	for (unsigned int range_num = 1; range_num < 400; range_num *= 3) {
+		std::vector<BLI_mempool_iter> iters(range_num);
+		std::vector<int> found(NUM_ELEMS, 0);
+		int found_tot = 0;
+
+		const unsigned int ranges = BLI_mempool_iter_ranges_init(pool, &iters[0], range_num);
+		EXPECT_LE(ranges, range_num);
+		EXPECT_LT(0, ranges);
+
+		for (unsigned int i = 0; i < ranges; i++) {
+			TestElem *elem;
+			while ((elem = (TestElem *)BLI_mempool_iterstep(&iters[i]))) {
+				found[elem->value]++;
+				found_tot++;
+			}
+		}
+
+		EXPECT_EQ(count, found_tot);
+		for (int i = 0; i < NUM_ELEMS; i++) {
+			EXPECT_EQ((elems[i] != NULL) ? 1 : 0, found[i]);
+		}
+	}
+
+	BLI_mempool_destroy(pool);
+}
+
+TEST_F(MempoolTest, ParallelMempool)
+{
+	std::vector<TestElem *> elems;
+	BLI_mempool *pool = test_pool(elems, 5);
+	size_t sum_expected = 0;
+
+	for (int i = 0; i < NUM_ELEMS; i++) {
+		if (elems[i]) {
+			sum_expected += (size_t)i;
+		}
+	}
+
+	for (int use_threading = 0; use_threading < 2; use_threading++) {
+		size_t sum = 0;
+		BLI_task_parallel_mempool(pool, &sum, parallel_mempool_func, use_threading != 0);
+		EXPECT_EQ(sum_expected, sum);
+	}
+
+	/* empty pool */
+	BLI_mempool_clear(pool);
+	size_t sum = 0;
+	BLI_task_parallel_mempool(pool, &sum, parallel_mempool_func, true);
+	EXPECT_EQ(0, sum);
+
+	BLI_mempool_destroy(pool);
+}
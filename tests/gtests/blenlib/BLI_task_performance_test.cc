@@ -0,0 +1,128 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "PIL_time.h"
+#include "atomic_ops.h"
+}
+
+/* Number of tasks for measuring the overhead per task. */
+#define NUM_TASKS 1000000
+
+/* Depth of the tree of tasks pushed from the tasks themselves. */
+#define TREE_DEPTH 18
+
+/* Number of iterations of the work done by a single task in the scaling tests. */
+#define WORK_SIZE 20000
+
+class TaskPerformanceTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+	}
+};
+
+static void task_empty_func(TaskPool *__restrict pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	size_t *count = (size_t *)BLI_task_pool_userdata(pool);
+	atomic_add_z(count, 1);
+}
+
+static void task_tree_func(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+	const intptr_t depth = (intptr_t)taskdata;
+
+	task_empty_func(pool, NULL, threadid);
+
+	if (depth > 0) {
+		for (int i = 0; i < 2; i++) {
+			BLI_task_pool_push_from_thread(pool, task_tree_func, (void *)(depth - 1), false,
+			                               TASK_PRIORITY_LOW, threadid);
+		}
+	}
+}
+
+static void task_work_func(TaskPool *__restrict pool, void *taskdata, int UNUSED(threadid))
+{
+	size_t *count = (size_t *)BLI_task_pool_userdata(pool);
+	unsigned int value = (unsigned int)(intptr_t)taskdata;
+
+	for (int i = 0; i < WORK_SIZE; i++) {
+		value = value * 1664525u + 1013904223u;
+	}
+	/* avoid the work being optimized away */
+	atomic_add_z(count, value & 1);
+}
+
+/* Tasks pushed from the main thread and waited for, as done by most users of the pools. */
+static double task_push_main(TaskScheduler *scheduler, TaskRunFunction run, const int num_tasks)
+{
+	size_t count = 0;
+	TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+	const double start = PIL_check_seconds_timer();
+
+	for (int i = 0; i < num_tasks; i++) {
+		BLI_task_pool_push(pool, run, SET_INT_IN_POINTER(i), false, TASK_PRIORITY_LOW);
+	}
+	BLI_task_pool_work_and_wait(pool);
+
+	const double time = PIL_check_seconds_timer() - start;
+	BLI_task_pool_free(pool);
+	return time;
+}
+
+/* Tasks pushed from the tasks, as done by the dependency graph evaluation. */
+static double task_push_tree(TaskScheduler *scheduler, const int depth)
+{
+	size_t count = 0;
+	TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+	const double start = PIL_check_seconds_timer();
+
+	BLI_task_pool_push_from_thread(pool, task_tree_func, (void *)(intptr_t)depth, false, TASK_PRIORITY_HIGH, 0);
+	BLI_task_pool_work_and_wait(pool);
+
+	const double time = PIL_check_seconds_timer() - start;
+	EXPECT_EQ((2 << depth) - 1, count);
+	BLI_task_pool_free(pool);
+	return time;
+}
+
+TEST_F(TaskPerformanceTest, Overhead)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	const int num_threads = BLI_task_scheduler_num_threads(scheduler);
+
+	const double time_main = task_push_main(scheduler, task_empty_func, NUM_TASKS);
+	printf("%d threads, %d empty tasks pushed from main thread: %.3fs, %.1fns per task\n",
+	       num_threads, NUM_TASKS, time_main, time_main * 1e9 / NUM_TASKS);
+
+	const int num_tree_tasks = (2 << TREE_DEPTH) - 1;
+	const double time_tree = task_push_tree(scheduler, TREE_DEPTH);
+	printf("%d threads, %d empty tasks pushed from tasks: %.3fs, %.1fns per task\n",
+	       num_threads, num_tree_tasks, time_tree, time_tree * 1e9 / num_tree_tasks);
+}
+
+TEST_F(TaskPerformanceTest, Scaling)
+{
+	const int num_tasks = 10000;
+	const int max_threads = BLI_system_thread_count();
+	double time_single = 0.0;
+
+	for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+		TaskScheduler *scheduler = BLI_task_scheduler_create(num_threads);
+
+		const double time = task_push_main(scheduler, task_work_func, num_tasks);
+		if (num_threads == 1) {
+			time_single = time;
+		}
+		printf("%d threads, %d tasks: %.3fs, speedup %.2f\n",
+		       num_threads, num_tasks, time, time_single / time);
+
+		BLI_task_scheduler_free(scheduler);
+	}
+}
@@ -0,0 +1,177 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+#include "atomic_ops.h"
+}
+
+#define NUM_TASKS 10000
+
+class TaskTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+	}
+};
+
+static void task_count_func(TaskPool *__restrict pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	size_t *count = (size_t *)BLI_task_pool_userdata(pool);
+	atomic_add_z(count, 1);
+}
+
+TEST_F(TaskTest, Basic)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	size_t count = 0;
+	TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+
+	for (int i = 0; i < NUM_TASKS; i++) {
+		BLI_task_pool_push(pool, task_count_func, NULL, false,
+		                   (i % 2) ? TASK_PRIORITY_HIGH : TASK_PRIORITY_LOW);
+	}
+	BLI_task_pool_work_and_wait(pool);
+
+	EXPECT_EQ(NUM_TASKS, count);
+	EXPECT_EQ(NUM_TASKS, BLI_task_pool_tasks_done(pool));
+
+	BLI_task_pool_free(pool);
+}
+
+/* Every task pushes two children from its own thread, as long as the depth allows,
+ * those end in the queue of the worker and are stolen by the other workers. */
+static void task_tree_func(TaskPool *__restrict pool, void *taskdata, int threadid)
+{
+	size_t *count = (size_t *)BLI_task_pool_userdata(pool);
+	const intptr_t depth = (intptr_t)taskdata;
+
+	atomic_add_z(count, 1);
+
+	if (depth > 0) {
+		for (int i = 0; i < 2; i++) {
+			BLI_task_pool_push_from_thread(pool, task_tree_func, (void *)(depth - 1), false,
+			                               TASK_PRIORITY_LOW, threadid);
+		}
+	}
+}
+
+TEST_F(TaskTest, PushFromThread)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	const intptr_t depth = 12;
+	size_t count = 0;
+
+	for (int run = 0; run < 10; run++) {
+		TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+
+		count = 0;
+		BLI_task_pool_push_from_thread(pool, task_tree_func, (void *)depth, false, TASK_PRIORITY_HIGH, 0);
+		BLI_task_pool_work_and_wait(pool);
+
+		EXPECT_EQ((2 << depth) - 1, count);
+
+		BLI_task_pool_free(pool);
+	}
+}
+
+typedef struct TaskLimitData {
+	size_t running;
+	size_t max_running;
+	size_t count;
+} TaskLimitData;
+
+static void task_limit_func(TaskPool *__restrict pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	TaskLimitData *data = (TaskLimitData *)BLI_task_pool_userdata(pool);
+	const size_t running = atomic_add_z(&data->running, 1);
+
+	if (running > data->max_running) {
+		data->max_running = running;
+	}
+	atomic_add_z(&data->count, 1);
+	atomic_sub_z(&data->running, 1);
+}
+
+TEST_F(TaskTest, NumThreads)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	TaskLimitData data = {0, 0, 0};
+	TaskPool *pool = BLI_task_pool_create(scheduler, &data);
+
+	BLI_pool_set_num_threads(pool, 1);
+	for (int i = 0; i < NUM_TASKS; i++) {
+		BLI_task_pool_push(pool, task_limit_func, NULL, false, TASK_PRIORITY_LOW);
+	}
+	BLI_task_pool_work_and_wait(pool);
+
+	EXPECT_EQ(NUM_TASKS, data.count);
+	EXPECT_EQ(1, data.max_running);
+
+	BLI_task_pool_free(pool);
+}
+
+/* Pushes the tasks from a worker thread, the waiting thread can only take them from its queue. */
+static void task_push_children_func(TaskPool *__restrict UNUSED(pool), void *taskdata, int threadid)
+{
+	TaskPool *child_pool = (TaskPool *)taskdata;
+
+	for (int i = 0; i < NUM_TASKS; i++) {
+		BLI_task_pool_push_from_thread(child_pool, task_count_func, NULL, false, TASK_PRIORITY_LOW, threadid);
+	}
+}
+
+TEST_F(TaskTest, MultiplePools)
+{
+	TaskScheduler *scheduler = BLI_task_scheduler_get();
+	size_t count = 0, child_count = 0;
+	TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+	TaskPool *child_pool = BLI_task_pool_create(scheduler, &child_count);
+
+	for (int i = 0; i < 4; i++) {
+		BLI_task_pool_push(pool, task_push_children_func, child_pool, false, TASK_PRIORITY_HIGH);
+	}
+	BLI_task_pool_work_and_wait(pool);
+	BLI_task_pool_work_and_wait(child_pool);
+
+	EXPECT_EQ(4 * NUM_TASKS, child_count);
+	EXPECT_EQ(4 * NUM_TASKS, BLI_task_pool_tasks_done(child_pool));
+
+	BLI_task_pool_free(child_pool);
+	BLI_task_pool_free(pool);
+}
+
+TEST_F(TaskTest, SchedulerSizes)
+{
+	for (int num_threads = 1; num_threads <= 8; num_threads++) {
+		TaskScheduler *scheduler = BLI_task_scheduler_create(num_threads);
+		size_t count = 0;
+		TaskPool *pool = BLI_task_pool_create(scheduler, &count);
+
+		BLI_task_pool_push_from_thread(pool, task_tree_func, (void *)10, false, TASK_PRIORITY_HIGH, 0);
+		BLI_task_pool_work_and_wait(pool);
+		EXPECT_EQ((2 << 10) - 1, count);
+
+		BLI_task_pool_free(pool);
+		BLI_task_scheduler_free(scheduler);
+	}
+}
+
+static void task_range_func(void *userdata, int iter)
+{
+	size_t *sum = (size_t *)userdata;
+	atomic_add_z(sum, (size_t)iter);
+}
+
+TEST_F(TaskTest, ParallelRange)
+{
+	size_t sum = 0;
+
+	BLI_task_parallel_range(0, NUM_TASKS, &sum, task_range_func, true);
+
+	EXPECT_EQ((size_t)NUM_TASKS * (NUM_TASKS - 1) / 2, sum);
+}
@@ -0,0 +1,236 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <vector>
+
+#include "COM_ColorCorrectionOperation.h"
+#include "COM_ConvertOperation.h"
+#include "COM_GaussianXBlurOperation.h"
+#include "COM_GaussianYBlurOperation.h"
+#include "COM_MathBaseOperation.h"
+#include "COM_MixOperation.h"
+#include "COM_ReadBufferOperation.h"
+#include "COM_SetValueOperation.h"
+#include "COM_WriteBufferOperation.h"
+
+extern "C" {
+#include "MEM_guardedalloc.h"
+#include "BLI_rand.h"
+#include "BLI_utildefines.h"
+#include "DNA_node_types.h"
+#include "DNA_scene_types.h"
+#include "PIL_time.h"
+}
+
+/* Compares the pixel by pixel and the row execution of the same operations,
+ * on an image about the size of a 4K frame. */
+
+#define IMAGE_WIDTH 3840
+#define IMAGE_HEIGHT 2160
+#define CHUNK_SIZE 256
+
+static int test_break(void * /*data*/)
+{
+	return 0;
+}
+
+class OperationTree {
+public:
+	std::vector<NodeOperation *> operations;
+	WriteBufferOperation *input;
+	WriteBufferOperation *output;
+	bNodeTree btree;
+
+	OperationTree()
+	{
+		memset(&btree, 0, sizeof(btree));
+		btree.test_break = test_break;
+
+		/* input image, filled with noise and never executed itself */
+		input = new WriteBufferOperation(COM_DT_COLOR);
+		input->getMemoryProxy()->allocate(IMAGE_WIDTH, IMAGE_HEIGHT);
+		MemoryBuffer *buffer = input->getMemoryProxy()->getBuffer();
+		buffer->allocateBuffer();
+		RNG *rng = BLI_rng_new(0);
+		float *pixels = buffer->getBuffer();
+		for (int i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT * 4; i++) {
+			pixels[i] = BLI_rng_get_float(rng);
+		}
+		BLI_rng_free(rng);
+		output = NULL;
+	}
+
+	~OperationTree()
+	{
+		for (int i = operations.size() - 1; i >= 0; i--) {
+			delete operations[i];
+		}
+		input->getMemoryProxy()->free();
+		delete input;
+	}
+
+	/* operations must be added after their inputs */
+	template<typename T> T *add(T *operation)
+	{
+		unsigned int resolution[2] = {IMAGE_WIDTH, IMAGE_HEIGHT};
+		operation->setResolution(resolution);
+		operation->setbNodeTree(&btree);
+		operations.push_back(operation);
+		return operation;
+	}
+
+	ReadBufferOperation *add_read()
+	{
+		ReadBufferOperation *read = add(new ReadBufferOperation(COM_DT_COLOR));
+		read->setMemoryProxy(input->getMemoryProxy());
+		read->updateMemoryBuffer();
+		return read;
+	}
+
+	SetValueOperation *add_value(float value)
+	{
+		SetValueOperation *operation = add(new SetValueOperation());
+		operation->setValue(value);
+		return operation;
+	}
+
+	void link(NodeOperation *from, NodeOperation *to, int index)
+	{
+		to->getInputSocket(index)->setLink(from->getOutputSocket());
+	}
+
+	void set_output(NodeOperation *from)
+	{
+		output = add(new WriteBufferOperation(COM_DT_COLOR));
+		link(from, output, 0);
+	}
+
+	/* returns the time in seconds, the result stays in the output buffer */
+	double execute(bool use_rows)
+	{
+		for (int i = 0; i < operations.size(); i++) {
+			operations[i]->initExecution();
+		}
+		output->setUseRowExecution(use_rows);
+		/* allocated by the MemoryManager of the ExecutionSystem otherwise */
+		output->getMemoryProxy()->getBuffer()->allocateBuffer();
+
+		double time_start = PIL_check_seconds_timer();
+		for (int y = 0; y < IMAGE_HEIGHT; y += CHUNK_SIZE) {
+			for (int x = 0; x < IMAGE_WIDTH; x += CHUNK_SIZE) {
+				rcti rect;
+				BLI_rcti_init(&rect, x, min_ii(x + CHUNK_SIZE, IMAGE_WIDTH), y, min_ii(y + CHUNK_SIZE, IMAGE_HEIGHT));
+				output->executeRegion(&rect, 0);
+			}
+		}
+		return PIL_check_seconds_timer() - time_start;
+	}
+
+	void deinit()
+	{
+		for (int i = operations.size() - 1; i >= 0; i--) {
+			operations[i]->deinitExecution();
+		}
+	}
+
+	/* run both paths and check they give the same result */
+	void compare(const char *name)
+	{
+		const size_t size = IMAGE_WIDTH * IMAGE_HEIGHT * 4;
+
+		double time_pixels = execute(false);
+		float *pixels = (float *)MEM_mallocN(sizeof(float) * size, __func__);
+		memcpy(pixels, output->getMemoryProxy()->getBuffer()->getBuffer(), sizeof(float) * size);
+		deinit();
+
+		double time_rows = execute(true);
+		const float *rows = output->getMemoryProxy()->getBuffer()->getBuffer();
+		size_t num_different = 0;
+		for (size_t i = 0; i < size; i++) {
+			if (fabsf(pixels[i] - rows[i]) > 1e-5f * max_ff(1.0f, fabsf(pixels[i]))) {
+				num_different++;
+			}
+		}
+		deinit();
+		MEM_freeN(pixels);
+
+		printf("%s: pixels %.3fs, rows %.3fs, %.2fx\n", name, time_pixels, time_rows, time_pixels / time_rows);
+		EXPECT_EQ(0, num_different);
+	}
+};
+
+TEST(compositor_execution, MixMathConvert)
+{
+	OperationTree tree;
+	ReadBufferOperation *image = tree.add_read();
+	ReadBufferOperation *image2 = tree.add_read();
+
+	ConvertColorToBWOperation *bw = tree.add(new ConvertColorToBWOperation());
+	tree.link(image, bw, 0);
+
+	MathMultiplyOperation *multiply = tree.add(new MathMultiplyOperation());
+	tree.link(bw, multiply, 0);
+	tree.link(tree.add_value(0.75f), multiply, 1);
+
+	MixScreenOperation *mix = tree.add(new MixScreenOperation());
+	tree.link(multiply, mix, 0);
+	tree.link(image, mix, 1);
+	tree.link(image2, mix, 2);
+
+	MixMultiplyOperation *mix2 = tree.add(new MixMultiplyOperation());
+	mix2->setUseClamp(true);
+	tree.link(tree.add_value(0.5f), mix2, 0);
+	tree.link(mix, mix2, 1);
+	tree.link(image2, mix2, 2);
+
+	tree.set_output(mix2);
+	tree.compare("Mix, math and convert");
+}
+
+TEST(compositor_execution, ColorCorrection)
+{
+	OperationTree tree;
+	NodeColorCorrection data;
+	ColorCorrectionData levels = {1.1f, 1.2f, 0.9f, 1.0f, 0.05f, 0};
+	data.master = data.shadows = data.midtones = data.highlights = levels;
+	data.startmidtones = 0.2f;
+	data.endmidtones = 0.7f;
+
+	ColorCorrectionOperation *correction = tree.add(new ColorCorrectionOperation());
+	correction->setData(&data);
+	tree.link(tree.add_read(), correction, 0);
+	tree.link(tree.add_value(0.8f), correction, 1);
+
+	tree.set_output(correction);
+	tree.compare("Color correction");
+}
+
+TEST(compositor_execution, GaussianBlur)
+{
+	NodeBlurData data;
+	memset(&data, 0, sizeof(data));
+	data.sizex = data.sizey = 25;
+	data.filtertype = R_FILTER_GAUSS;
+
+	{
+		OperationTree tree;
+		GaussianXBlurOperation *blur = tree.add(new GaussianXBlurOperation());
+		blur->setData(&data);
+		blur->setSize(1.0f);
+		tree.link(tree.add_read(), blur, 0);
+		tree.link(tree.add_value(1.0f), blur, 1);
+		tree.set_output(blur);
+		tree.compare("Gaussian X blur");
+	}
+	{
+		OperationTree tree;
+		GaussianYBlurOperation *blur = tree.add(new GaussianYBlurOperation());
+		blur->setData(&data);
+		blur->setSize(1.0f);
+		tree.link(tree.add_read(), blur, 0);
+		tree.link(tree.add_value(1.0f), blur, 1);
+		tree.set_output(blur);
+		tree.compare("Gaussian Y blur");
+	}
+}
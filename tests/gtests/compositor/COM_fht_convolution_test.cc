@@ -0,0 +1,102 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <vector>
+
+#include "COM_FHTConvolution.h"
+
+extern "C" {
+#include "BLI_compiler_attrs.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+}
+
+static std::vector<float> random_buffer(RNG *rng, int width, int height)
+{
+	std::vector<float> buffer(width * height * COM_NUM_CHANNELS_COLOR);
+	for (int i = 0; i < buffer.size(); i++) {
+		buffer[i] = BLI_rng_get_float(rng);
+	}
+	return buffer;
+}
+
+/* direct convolution, the reference for the FHT */
+static std::vector<float> convolve(const std::vector<float> &image, int width, int height,
+                                   const std::vector<float> &kernel, int kernelWidth, int kernelHeight)
+{
+	std::vector<float> result(width * height * COM_NUM_CHANNELS_COLOR, 0.0f);
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			for (int ky = 0; ky < kernelHeight; ky++) {
+				for (int kx = 0; kx < kernelWidth; kx++) {
+					const int sx = x + kernelWidth / 2 - kx;
+					const int sy = y + kernelHeight / 2 - ky;
+					if (sx < 0 || sx >= width || sy < 0 || sy >= height) {
+						continue;
+					}
+					for (int ch = 0; ch < COM_NUM_CHANNELS_COLOR; ch++) {
+						result[(y * width + x) * COM_NUM_CHANNELS_COLOR + ch] +=
+						        image[(sy * width + sx) * COM_NUM_CHANNELS_COLOR + ch] *
+						        kernel[(ky * kernelWidth + kx) * COM_NUM_CHANNELS_COLOR + ch];
+					}
+				}
+			}
+		}
+	}
+	return result;
+}
+
+static void test_convolution(int width, int height, int kernelWidth, int kernelHeight, int numChannels)
+{
+	RNG *rng = BLI_rng_new(width * height + kernelWidth);
+	std::vector<float> image = random_buffer(rng, width, height);
+	std::vector<float> kernel = random_buffer(rng, kernelWidth, kernelHeight);
+	std::vector<float> expected = convolve(image, width, height, kernel, kernelWidth, kernelHeight);
+	std::vector<float> result(width * height * COM_NUM_CHANNELS_COLOR, -1.0f);
+	BLI_rng_free(rng);
+
+	FHTConvolve(&result[0], &image[0], width, height, &kernel[0], kernelWidth, kernelHeight, numChannels);
+
+	for (int i = 0; i < width * height; i++) {
+		for (int ch = 0; ch < COM_NUM_CHANNELS_COLOR; ch++) {
+			const int index = i * COM_NUM_CHANNELS_COLOR + ch;
+			if (ch < numChannels) {
+				EXPECT_NEAR(expected[index], result[index], 1e-3f * kernelWidth * kernelHeight);
+			}
+			else {
+				EXPECT_EQ(0.0f, result[index]);
+			}
+		}
+	}
+}
+
+class FHTConvolutionTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		/* the convolution runs in the task scheduler */
+		BLI_threadapi_init();
+	}
+};
+
+TEST_F(FHTConvolutionTest, SmallKernel)
+{
+	test_convolution(37, 23, 3, 3, 4);
+}
+
+TEST_F(FHTConvolutionTest, LargeKernel)
+{
+	/* more blocks than threads in both directions */
+	test_convolution(160, 130, 17, 9, 4);
+}
+
+TEST_F(FHTConvolutionTest, KernelLargerThanImage)
+{
+	test_convolution(11, 7, 15, 15, 4);
+}
+
+TEST_F(FHTConvolutionTest, RGB)
+{
+	test_convolution(40, 30, 8, 8, 3);
+}
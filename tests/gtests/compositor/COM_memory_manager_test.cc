@@ -0,0 +1,371 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "COM_ExecutionGroup.h"
+#include "COM_MemoryBuffer.h"
+#include "COM_MemoryManager.h"
+#include "COM_MemoryProxy.h"
+#include "COM_ReadBufferOperation.h"
+#include "COM_WriteBufferOperation.h"
+
+extern "C" {
+#include "BLI_threads.h"
+}
+
+class MemoryManagerTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		/* the conversion uses the task scheduler */
+		BLI_threadapi_init();
+	}
+};
+
+static unsigned short to_half(float value)
+{
+	unsigned short result;
+	MemoryManager::floatToHalf(&result, &value, 1);
+	return result;
+}
+
+static float to_float(unsigned short value)
+{
+	float result;
+	MemoryManager::halfToFloat(&result, &value, 1);
+	return result;
+}
+
+TEST_F(MemoryManagerTest, HalfExact)
+{
+	EXPECT_EQ(0x0000, to_half(0.0f));
+	EXPECT_EQ(0x8000, to_half(-0.0f));
+	EXPECT_EQ(0x3c00, to_half(1.0f));
+	EXPECT_EQ(0xc000, to_half(-2.0f));
+	EXPECT_EQ(0x3800, to_half(0.5f));
+	EXPECT_EQ(0x7bff, to_half(65504.0f));
+	/* smallest normal and denormal */
+	EXPECT_EQ(0x0400, to_half(ldexpf(1.0f, -14)));
+	EXPECT_EQ(0x0001, to_half(ldexpf(1.0f, -24)));
+
+	/* every finite half converts back to itself */
+	for (unsigned int h = 0; h < 0x10000; h++) {
+		if ((h & 0x7c00) == 0x7c00) {
+			continue;
+		}
+		EXPECT_EQ(h, to_half(to_float(h)));
+	}
+}
+
+TEST_F(MemoryManagerTest, HalfRounding)
+{
+	/* halfway between 1 and the next half rounds to even, above it rounds up */
+	EXPECT_EQ(0x3c00, to_half(1.0f + ldexpf(1.0f, -11)));
+	EXPECT_EQ(0x3c01, to_half(1.0f + ldexpf(1.0f, -11) + ldexpf(1.0f, -20)));
+	EXPECT_EQ(0x3c02, to_half(1.0f + 3.0f * ldexpf(1.0f, -11)));
+	/* rounding carries into the exponent */
+	EXPECT_EQ(0x4000, to_half(2.0f - ldexpf(1.0f, -12)));
+	/* denormals */
+	EXPECT_EQ(0x0000, to_half(ldexpf(1.0f, -25)));
+	EXPECT_EQ(0x0001, to_half(ldexpf(1.5f, -25)));
+	EXPECT_EQ(0x0002, to_half(ldexpf(1.5f, -24)));
+	EXPECT_EQ(0x0400, to_half(ldexpf(1.0f, -14) - ldexpf(1.0f, -26)));
+}
+
+TEST_F(MemoryManagerTest, HalfSpecial)
+{
+	EXPECT_EQ(0x7c00, to_half(65520.0f));
+	EXPECT_EQ(0xfc00, to_half(-1e10f));
+	EXPECT_EQ(0x7c00, to_half(INFINITY));
+	EXPECT_EQ(0x7bff, to_half(65519.0f));
+	EXPECT_TRUE(isnan(to_float(to_half(NAN))));
+	EXPECT_TRUE(isinf(to_float(0x7c00)));
+	EXPECT_EQ(ldexpf(1.0f, -24), to_float(0x0001));
+	EXPECT_EQ(-1.0f, to_float(0xbc00));
+}
+
+TEST_F(MemoryManagerTest, HalfBuffer)
+{
+	/* larger than a single conversion task */
+	const size_t size = 300000;
+	std::vector<float> values(size);
+	std::vector<unsigned short> halfs(size);
+	std::vector<float> result(size);
+	for (size_t i = 0; i < size; i++) {
+		values[i] = (float)i / 1000.0f - 100.0f;
+	}
+
+	MemoryManager::floatToHalf(&halfs[0], &values[0], size);
+	MemoryManager::halfToFloat(&result[0], &halfs[0], size);
+
+	for (size_t i = 0; i < size; i++) {
+		EXPECT_NEAR(values[i], result[i], fabsf(values[i]) * (1.0f / 2048.0f));
+	}
+}
+
+/* buffer states */
+
+static const unsigned int test_size = 64;
+
+/* marks chunks as scheduled without handing them to the WorkScheduler, the
+ * chunks of the test groups have nothing to execute */
+class ExecutionGroupTestAccess {
+public:
+	static void setChunkScheduled(ExecutionGroup *group, unsigned int chunkNumber)
+	{
+		group->m_chunkExecutionStates[chunkNumber] = COM_ES_SCHEDULED;
+	}
+};
+
+/* a group writing a test_size square buffer, optionally reading the buffer of another group */
+class TestGroup {
+public:
+	TestGroup(DataType datatype, TestGroup *input = NULL)
+	{
+		unsigned int resolution[2] = {test_size, test_size};
+
+		this->m_write = new WriteBufferOperation(datatype);
+		this->m_write->setResolution(resolution);
+		this->m_read = NULL;
+		this->m_group = new ExecutionGroup();
+		this->m_group->addOperation(this->m_write);
+		if (input) {
+			this->m_read = new ReadBufferOperation(input->getProxy()->getDataType());
+			this->m_read->setMemoryProxy(input->getProxy());
+			this->m_group->addOperation(this->m_read);
+		}
+
+		this->m_group->determineResolution(resolution);
+		this->m_group->setChunksize(test_size);
+		this->m_group->initExecution();
+		this->getProxy()->allocate(test_size, test_size);
+	}
+
+	~TestGroup()
+	{
+		this->m_group->deinitExecution();
+		this->getProxy()->free();
+		delete this->m_group;
+		delete this->m_read;
+		delete this->m_write;
+	}
+
+	ExecutionGroup *getGroup() { return this->m_group; }
+	MemoryProxy *getProxy() { return this->m_write->getMemoryProxy(); }
+	MemoryBuffer *getBuffer() { return this->getProxy()->getBuffer(); }
+	size_t getSize() { return this->getBuffer()->getBufferMemorySize(); }
+
+	void start() { ExecutionGroupTestAccess::setChunkScheduled(this->m_group, 0); }
+	void finish() { this->m_group->finalizeChunkExecution(0, NULL); }
+	void execute() { start(); finish(); }
+
+private:
+	WriteBufferOperation *m_write;
+	ReadBufferOperation *m_read;
+	ExecutionGroup *m_group;
+};
+
+static std::string temp_dir()
+{
+	const char *dir = getenv("TMPDIR");
+	return dir ? dir : "/tmp";
+}
+
+static void init_manager(MemoryManager &manager, TestGroup *a, TestGroup *b, TestGroup *c = NULL)
+{
+	std::vector<ExecutionGroup *> groups;
+	groups.push_back(a->getGroup());
+	groups.push_back(b->getGroup());
+	if (c) {
+		groups.push_back(c->getGroup());
+	}
+	manager.initExecution(groups);
+}
+
+/* fill the buffer, the values are exact in half precision when half is set */
+static std::vector<float> fill_buffer(MemoryBuffer *buffer, bool half)
+{
+	const size_t size = buffer->getBufferMemorySize() / sizeof(float);
+	std::vector<float> values(size);
+	float *data = buffer->getBuffer();
+	for (size_t i = 0; i < size; i++) {
+		values[i] = (half) ? (float)(i % 1024) * 0.25f - 128.0f : (float)i * 0.001f + 0.1234567f;
+		data[i] = values[i];
+	}
+	return values;
+}
+
+static bool buffer_equals(MemoryBuffer *buffer, const std::vector<float> &values)
+{
+	const float *data = buffer->getBuffer();
+	for (size_t i = 0; i < values.size(); i++) {
+		if (data[i] != values[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST_F(MemoryManagerTest, AcquireRelease)
+{
+	MemoryManager manager;
+	TestGroup writer(COM_DT_COLOR);
+	TestGroup reader(COM_DT_VALUE, &writer);
+	init_manager(manager, &writer, &reader);
+
+	/* nothing is allocated before a group is scheduled */
+	EXPECT_FALSE(writer.getBuffer()->isAllocated());
+	EXPECT_FALSE(reader.getBuffer()->isAllocated());
+	EXPECT_EQ(0, manager.getMemoryInUse());
+
+	manager.acquire(writer.getGroup());
+	EXPECT_TRUE(writer.getBuffer()->isAllocated());
+	EXPECT_FALSE(reader.getBuffer()->isAllocated());
+	EXPECT_EQ(writer.getSize(), manager.getMemoryInUse());
+
+	writer.execute();
+	manager.update();
+	EXPECT_TRUE(writer.getBuffer()->isAllocated());
+
+	manager.acquire(reader.getGroup());
+	EXPECT_TRUE(reader.getBuffer()->isAllocated());
+	EXPECT_EQ(writer.getSize() + reader.getSize(), manager.getMemoryInUse());
+
+	/* the output of the reader has no readers, both are released */
+	reader.execute();
+	manager.update();
+	EXPECT_FALSE(writer.getBuffer()->isAllocated());
+	EXPECT_FALSE(reader.getBuffer()->isAllocated());
+	EXPECT_EQ(0, manager.getMemoryInUse());
+	EXPECT_EQ(writer.getSize() + reader.getSize(), manager.getPeakMemory());
+	EXPECT_EQ(0, manager.getNumberOfSpills());
+}
+
+TEST_F(MemoryManagerTest, KeptForReaders)
+{
+	MemoryManager manager;
+	TestGroup writer(COM_DT_COLOR);
+	TestGroup first(COM_DT_VALUE, &writer);
+	TestGroup second(COM_DT_VALUE, &writer);
+	init_manager(manager, &writer, &first, &second);
+
+	manager.acquire(writer.getGroup());
+	std::vector<float> values = fill_buffer(writer.getBuffer(), false);
+	writer.execute();
+
+	manager.acquire(first.getGroup());
+	first.execute();
+	manager.update();
+	/* the second reader didn't run yet */
+	EXPECT_TRUE(writer.getBuffer()->isAllocated());
+	EXPECT_TRUE(buffer_equals(writer.getBuffer(), values));
+
+	manager.acquire(second.getGroup());
+	second.start();
+	manager.update();
+	EXPECT_TRUE(writer.getBuffer()->isAllocated());
+
+	second.finish();
+	manager.update();
+	EXPECT_FALSE(writer.getBuffer()->isAllocated());
+	EXPECT_EQ(0, manager.getMemoryInUse());
+}
+
+TEST_F(MemoryManagerTest, KeepBuffer)
+{
+	MemoryManager manager;
+	TestGroup writer(COM_DT_COLOR);
+	TestGroup reader(COM_DT_VALUE, &writer);
+	init_manager(manager, &writer, &reader);
+	manager.setKeepBuffer(writer.getProxy(), true);
+
+	manager.acquire(writer.getGroup());
+	writer.execute();
+	manager.acquire(reader.getGroup());
+	reader.execute();
+	manager.update();
+	EXPECT_TRUE(writer.getBuffer()->isAllocated());
+	EXPECT_FALSE(reader.getBuffer()->isAllocated());
+	EXPECT_EQ(writer.getSize(), manager.getMemoryInUse());
+}
+
+TEST_F(MemoryManagerTest, Pack)
+{
+	MemoryManager manager;
+	TestGroup writer(COM_DT_COLOR);
+	TestGroup reader(COM_DT_VALUE, &writer);
+	init_manager(manager, &writer, &reader);
+	manager.setUseHalfFloat(true);
+
+	manager.acquire(writer.getGroup());
+	std::vector<float> values = fill_buffer(writer.getBuffer(), true);
+	writer.execute();
+
+	/* complete and not read by a running group */
+	manager.update();
+	EXPECT_FALSE(writer.getBuffer()->isAllocated());
+	EXPECT_EQ(writer.getSize() / 2, manager.getMemoryInUse());
+
+	manager.acquire(reader.getGroup());
+	EXPECT_TRUE(writer.getBuffer()->isAllocated());
+	EXPECT_TRUE(buffer_equals(writer.getBuffer(), values));
+	EXPECT_EQ(writer.getSize() + reader.getSize(), manager.getMemoryInUse());
+
+	/* a running reader keeps the buffer in full precision, value buffers are never packed */
+	reader.start();
+	manager.update();
+	EXPECT_TRUE(writer.getBuffer()->isAllocated());
+	EXPECT_TRUE(reader.getBuffer()->isAllocated());
+	EXPECT_EQ(writer.getSize() + reader.getSize(), manager.getMemoryInUse());
+
+	reader.finish();
+	manager.update();
+	EXPECT_EQ(0, manager.getMemoryInUse());
+}
+
+static void test_spill(bool half)
+{
+	MemoryManager manager;
+	TestGroup writer(COM_DT_COLOR);
+	TestGroup reader(COM_DT_VALUE, &writer);
+	init_manager(manager, &writer, &reader);
+	manager.setUseHalfFloat(half);
+	manager.setMemoryLimit(1);
+	manager.setScratchDirectory(temp_dir().c_str());
+
+	/* the buffers in use exceed the limit */
+	manager.acquire(writer.getGroup());
+	EXPECT_TRUE(writer.getBuffer()->isAllocated());
+	std::vector<float> values = fill_buffer(writer.getBuffer(), half);
+	writer.execute();
+
+	manager.update();
+	EXPECT_FALSE(writer.getBuffer()->isAllocated());
+	EXPECT_EQ(1, manager.getNumberOfSpills());
+	EXPECT_EQ(0, manager.getMemoryInUse());
+
+	manager.acquire(reader.getGroup());
+	EXPECT_TRUE(writer.getBuffer()->isAllocated());
+	EXPECT_TRUE(buffer_equals(writer.getBuffer(), values));
+	EXPECT_EQ(writer.getSize() + reader.getSize(), manager.getMemoryInUse());
+
+	reader.execute();
+	manager.update();
+	EXPECT_EQ(0, manager.getMemoryInUse());
+	EXPECT_EQ(1, manager.getNumberOfSpills());
+}
+
+TEST_F(MemoryManagerTest, SpillRestore)
+{
+	test_spill(false);
+}
+
+TEST_F(MemoryManagerTest, SpillRestoreHalf)
+{
+	test_spill(true);
+}
@@ -0,0 +1,131 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include "COM_MemoryBuffer.h"
+#include "COM_OperationCache.h"
+
+extern "C" {
+#include "BLI_rect.h"
+}
+
+static MemoryBuffer *create_buffer(int width, int height, float value)
+{
+	rcti rect;
+	BLI_rcti_init(&rect, 0, width, 0, height);
+	MemoryBuffer *buffer = new MemoryBuffer(COM_DT_COLOR, &rect);
+	float *data = buffer->getBuffer();
+	for (int i = 0; i < width * height * COM_NUM_CHANNELS_COLOR; i++) {
+		data[i] = value;
+	}
+	return buffer;
+}
+
+static std::string key(const char *name)
+{
+	return OperationCache::hash(name);
+}
+
+class OperationCacheTest : public testing::Test {
+protected:
+	void SetUp()
+	{
+		OperationCache::clear();
+		OperationCache::setMemoryLimit(COM_CACHE_MEMORY_LIMIT);
+	}
+
+	void TearDown()
+	{
+		OperationCache::clear();
+		OperationCache::setMemoryLimit(COM_CACHE_MEMORY_LIMIT);
+	}
+};
+
+TEST_F(OperationCacheTest, ReadWrite)
+{
+	MemoryBuffer *buffer = create_buffer(16, 8, 0.5f);
+	MemoryBuffer *result = create_buffer(16, 8, 0.0f);
+
+	EXPECT_FALSE(OperationCache::read(key("a"), result));
+
+	OperationCache::write(key("a"), buffer);
+	EXPECT_EQ(16 * 8 * 4 * sizeof(float), OperationCache::getMemoryInUse());
+
+	/* the cache keeps a copy */
+	buffer->getBuffer()[0] = 1.0f;
+	EXPECT_TRUE(OperationCache::read(key("a"), result));
+	EXPECT_EQ(0.5f, result->getBuffer()[0]);
+	EXPECT_EQ(0.5f, result->getBuffer()[16 * 8 * 4 - 1]);
+	EXPECT_FALSE(OperationCache::read(key("b"), result));
+
+	/* writing the same key replaces the result */
+	OperationCache::write(key("a"), buffer);
+	EXPECT_EQ(16 * 8 * 4 * sizeof(float), OperationCache::getMemoryInUse());
+	EXPECT_TRUE(OperationCache::read(key("a"), result));
+	EXPECT_EQ(1.0f, result->getBuffer()[0]);
+
+	delete buffer;
+	delete result;
+}
+
+TEST_F(OperationCacheTest, SizeMismatch)
+{
+	MemoryBuffer *buffer = create_buffer(16, 8, 0.5f);
+	MemoryBuffer *result = create_buffer(8, 16, 0.0f);
+
+	OperationCache::write(key("a"), buffer);
+	EXPECT_FALSE(OperationCache::read(key("a"), result));
+
+	delete buffer;
+	delete result;
+}
+
+TEST_F(OperationCacheTest, LeastRecentlyUsed)
+{
+	const size_t size = 16 * 16 * 4 * sizeof(float);
+	MemoryBuffer *buffer = create_buffer(16, 16, 0.5f);
+	MemoryBuffer *result = create_buffer(16, 16, 0.0f);
+
+	OperationCache::setMemoryLimit(3 * size);
+	OperationCache::write(key("a"), buffer);
+	OperationCache::write(key("b"), buffer);
+	OperationCache::write(key("c"), buffer);
+	EXPECT_EQ(3 * size, OperationCache::getMemoryInUse());
+
+	/* "b" is the least recently used after reading "a" */
+	EXPECT_TRUE(OperationCache::read(key("a"), result));
+	OperationCache::write(key("d"), buffer);
+	EXPECT_EQ(3 * size, OperationCache::getMemoryInUse());
+	EXPECT_TRUE(OperationCache::read(key("a"), result));
+	EXPECT_FALSE(OperationCache::read(key("b"), result));
+	EXPECT_TRUE(OperationCache::read(key("c"), result));
+	EXPECT_TRUE(OperationCache::read(key("d"), result));
+
+	/* lowering the limit frees the oldest results */
+	OperationCache::setMemoryLimit(size);
+	EXPECT_EQ(size, OperationCache::getMemoryInUse());
+	EXPECT_TRUE(OperationCache::read(key("d"), result));
+
+	/* results larger than the limit are not kept */
+	OperationCache::setMemoryLimit(size / 2);
+	OperationCache::write(key("e"), buffer);
+	EXPECT_EQ(0, OperationCache::getMemoryInUse());
+	EXPECT_FALSE(OperationCache::read(key("e"), result));
+
+	delete buffer;
+	delete result;
+}
+
+TEST_F(OperationCacheTest, Clear)
+{
+	MemoryBuffer *buffer = create_buffer(4, 4, 0.5f);
+	MemoryBuffer *result = create_buffer(4, 4, 0.0f);
+
+	OperationCache::write(key("a"), buffer);
+	OperationCache::clear();
+	EXPECT_EQ(0, OperationCache::getMemoryInUse());
+	EXPECT_FALSE(OperationCache::read(key("a"), result));
+
+	delete buffer;
+	delete result;
+}
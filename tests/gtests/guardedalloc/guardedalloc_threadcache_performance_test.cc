@@ -0,0 +1,134 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "PIL_time.h"
+}
+
+#include "MEM_guardedalloc.h"
+
+/* Thread caching allocator is not available on Windows. */
+#ifndef _WIN32
+
+/* Number of blocks alive at once per thread, and number of times they are allocated. */
+#define NUM_BLOCKS 1000
+#define NUM_ROUNDS 2000
+
+#define MAX_THREADS 64
+
+typedef struct ThreadData {
+	void **blocks;
+	unsigned int seed;
+} ThreadData;
+
+static size_t block_size(unsigned int *seed)
+{
+	*seed = *seed * 1664525u + 1013904223u;
+	/* typical sizes of small structs, strings and arrays */
+	return 8 + ((*seed >> 16) % 512);
+}
+
+/* Blocks allocated and freed by the same thread. */
+static void *alloc_local_func(void *data)
+{
+	ThreadData *td = (ThreadData *)data;
+	void **blocks = (void **)malloc(sizeof(void *) * NUM_BLOCKS);
+
+	for (int round = 0; round < NUM_ROUNDS; round++) {
+		for (int i = 0; i < NUM_BLOCKS; i++) {
+			blocks[i] = MEM_mallocN(block_size(&td->seed), __func__);
+		}
+		for (int i = 0; i < NUM_BLOCKS; i++) {
+			MEM_freeN(blocks[i]);
+		}
+	}
+
+	free(blocks);
+	return NULL;
+}
+
+static void *alloc_func(void *data)
+{
+	ThreadData *td = (ThreadData *)data;
+
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		td->blocks[i] = MEM_mallocN(block_size(&td->seed), __func__);
+	}
+	return NULL;
+}
+
+static void *free_func(void *data)
+{
+	ThreadData *td = (ThreadData *)data;
+
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		MEM_freeN(td->blocks[i]);
+	}
+	return NULL;
+}
+
+static void run_threads(void *(*func)(void *), ThreadData *td, const int num_threads, const int offset)
+{
+	pthread_t threads[MAX_THREADS];
+
+	for (int i = 0; i < num_threads; i++) {
+		pthread_create(&threads[i], NULL, func, &td[(i + offset) % num_threads]);
+	}
+	for (int i = 0; i < num_threads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+}
+
+static void alloc_test(const char *name)
+{
+	const int max_threads = MIN2((int)sysconf(_SC_NPROCESSORS_ONLN) * 2, MAX_THREADS);
+	ThreadData td[MAX_THREADS];
+	double time;
+
+	printf("\n========== STARTING %s, %s allocator ==========\n", __func__, name);
+
+	for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+		for (int i = 0; i < num_threads; i++) {
+			td[i].blocks = (void **)malloc(sizeof(void *) * NUM_BLOCKS);
+			td[i].seed = (unsigned int)i;
+		}
+
+		time = PIL_check_seconds_timer();
+		run_threads(alloc_local_func, td, num_threads, 0);
+		printf("%d threads, %d local allocations per thread: %.3fs\n",
+		       num_threads, NUM_BLOCKS * NUM_ROUNDS, PIL_check_seconds_timer() - time);
+
+		/* producer and consumer threads, the blocks are freed by another thread */
+		time = PIL_check_seconds_timer();
+		for (int round = 0; round < NUM_ROUNDS / 10; round++) {
+			run_threads(alloc_func, td, num_threads, 0);
+			run_threads(free_func, td, num_threads, 1);
+		}
+		printf("%d threads, %d remote allocations per thread: %.3fs\n",
+		       num_threads, NUM_BLOCKS * NUM_ROUNDS / 10, PIL_check_seconds_timer() - time);
+
+		for (int i = 0; i < num_threads; i++) {
+			free(td[i].blocks);
+		}
+	}
+
+	EXPECT_EQ(0, MEM_get_memory_blocks_in_use());
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST(guardedalloc, ThreadCachePerformance)
+{
+	/* All blocks of an allocator are freed before switching to the next one. */
+	alloc_test("lock-free");
+
+	MEM_use_threadcache_allocator();
+	alloc_test("thread caching");
+}
+
+#endif  /* _WIN32 */
@@ -0,0 +1,232 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <pthread.h>
+#include <string.h>
+
+extern "C" {
+#include "BLI_utildefines.h"
+}
+
+#include "MEM_guardedalloc.h"
+
+/* Thread caching allocator is not available on Windows. */
+#ifndef _WIN32
+
+#define NUM_THREADS 8
+#define NUM_BLOCKS 10000
+
+#define CHECK_ALIGNMENT(ptr, align) EXPECT_EQ(0, (size_t)ptr % align)
+
+class ThreadCacheAllocTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		/* before any allocation */
+		MEM_use_threadcache_allocator();
+	}
+};
+
+typedef struct ThreadBlocks {
+	void *blocks[NUM_BLOCKS];
+	size_t mem;
+	int seed;
+} ThreadBlocks;
+
+static size_t test_block_size(int i, int seed)
+{
+	/* mostly small blocks, some larger than the size classes */
+	const unsigned int value = (unsigned int)(i * 2654435761u + (unsigned int)seed * 40503u);
+	return (value % 16 == 0) ? 2048 + value % 8192 : value % 1024;
+}
+
+static void *thread_alloc_func(void *data)
+{
+	ThreadBlocks *tb = (ThreadBlocks *)data;
+
+	tb->mem = 0;
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		const size_t size = test_block_size(i, tb->seed);
+		tb->blocks[i] = MEM_mallocN(size, __func__);
+		memset(tb->blocks[i], i & 0xff, size);
+		tb->mem += MEM_allocN_len(tb->blocks[i]);
+	}
+
+	return NULL;
+}
+
+static void *thread_free_func(void *data)
+{
+	ThreadBlocks *tb = (ThreadBlocks *)data;
+
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		const unsigned char *block = (const unsigned char *)tb->blocks[i];
+		const size_t size = test_block_size(i, tb->seed);
+		if (size) {
+			EXPECT_EQ(i & 0xff, block[0]);
+			EXPECT_EQ(i & 0xff, block[size - 1]);
+		}
+		MEM_freeN(tb->blocks[i]);
+	}
+
+	return NULL;
+}
+
+static void run_threads(void *(*func)(void *), ThreadBlocks *tb)
+{
+	pthread_t threads[NUM_THREADS];
+
+	for (int i = 0; i < NUM_THREADS; i++) {
+		pthread_create(&threads[i], NULL, func, &tb[i]);
+	}
+	for (int i = 0; i < NUM_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+}
+
+TEST_F(ThreadCacheAllocTest, SizeClasses)
+{
+	const size_t mem = MEM_get_memory_in_use();
+	const unsigned int blocks = MEM_get_memory_blocks_in_use();
+	void *ptr[4100];
+	size_t len = 0;
+
+	for (int i = 0; i < 4100; i++) {
+		ptr[i] = MEM_callocN((size_t)i, __func__);
+		EXPECT_EQ((size_t)((i + 3) & ~3), MEM_allocN_len(ptr[i]));
+		CHECK_ALIGNMENT(ptr[i], 8);
+		for (int j = 0; j < i; j++) {
+			EXPECT_EQ(0, ((char *)ptr[i])[j]);
+		}
+		memset(ptr[i], 255, (size_t)i);
+		len += MEM_allocN_len(ptr[i]);
+	}
+	EXPECT_EQ(mem + len, MEM_get_memory_in_use());
+	EXPECT_EQ(blocks + 4100, MEM_get_memory_blocks_in_use());
+	EXPECT_LE(mem + len, MEM_get_peak_memory());
+
+	for (int i = 0; i < 4100; i++) {
+		MEM_freeN(ptr[i]);
+	}
+	EXPECT_EQ(mem, MEM_get_memory_in_use());
+	EXPECT_EQ(blocks, MEM_get_memory_blocks_in_use());
+
+	/* reused blocks are cleared too */
+	for (int i = 0; i < 4100; i++) {
+		ptr[i] = MEM_callocN((size_t)i, __func__);
+		for (int j = 0; j < i; j++) {
+			EXPECT_EQ(0, ((char *)ptr[i])[j]);
+		}
+	}
+	for (int i = 0; i < 4100; i++) {
+		MEM_freeN(ptr[i]);
+	}
+}
+
+TEST_F(ThreadCacheAllocTest, Realloc)
+{
+	const size_t mem = MEM_get_memory_in_use();
+	char *ptr = (char *)MEM_mallocN(20, __func__);
+
+	for (int i = 0; i < 20; i++) {
+		ptr[i] = (char)i;
+	}
+
+	/* same size class */
+	char *ptr_new = (char *)MEM_reallocN(ptr, 30);
+	EXPECT_EQ(ptr, ptr_new);
+	EXPECT_EQ(32, MEM_allocN_len(ptr_new));
+	EXPECT_EQ(mem + 32, MEM_get_memory_in_use());
+
+	/* grow, data is kept and new bytes cleared */
+	ptr = (char *)MEM_recallocN(ptr_new, 3000);
+	EXPECT_EQ(mem + 3000, MEM_get_memory_in_use());
+	for (int i = 0; i < 20; i++) {
+		EXPECT_EQ((char)i, ptr[i]);
+	}
+	for (int i = 32; i < 3000; i++) {
+		EXPECT_EQ(0, ptr[i]);
+	}
+
+	/* shrink */
+	ptr = (char *)MEM_reallocN(ptr, 10);
+	EXPECT_EQ(mem + 12, MEM_get_memory_in_use());
+	for (int i = 0; i < 10; i++) {
+		EXPECT_EQ((char)i, ptr[i]);
+	}
+
+	ptr_new = (char *)MEM_dupallocN(ptr);
+	EXPECT_EQ(0, memcmp(ptr, ptr_new, 10));
+
+	MEM_freeN(ptr);
+	MEM_freeN(ptr_new);
+	EXPECT_EQ(mem, MEM_get_memory_in_use());
+}
+
+TEST_F(ThreadCacheAllocTest, AlignedAlloc)
+{
+	const size_t mem = MEM_get_memory_in_use();
+
+	for (int alignment = 16; alignment <= 64; alignment *= 2) {
+		int *foo, *bar;
+
+		foo = (int *)MEM_mallocN_aligned(sizeof(int) * 10, (size_t)alignment, "test");
+		CHECK_ALIGNMENT(foo, alignment);
+
+		bar = (int *)MEM_dupallocN(foo);
+		CHECK_ALIGNMENT(bar, alignment);
+		MEM_freeN(bar);
+
+		foo = (int *)MEM_reallocN(foo, sizeof(int) * 5);
+		CHECK_ALIGNMENT(foo, alignment);
+
+		foo = (int *)MEM_recallocN(foo, sizeof(int) * 5);
+		CHECK_ALIGNMENT(foo, alignment);
+
+		MEM_freeN(foo);
+	}
+
+	EXPECT_EQ(mem, MEM_get_memory_in_use());
+}
+
+TEST_F(ThreadCacheAllocTest, Threads)
+{
+	ThreadBlocks *tb = (ThreadBlocks *)malloc(sizeof(ThreadBlocks) * NUM_THREADS);
+	const size_t mem = MEM_get_memory_in_use();
+	const unsigned int blocks = MEM_get_memory_blocks_in_use();
+	size_t mem_threads = 0;
+
+	for (int i = 0; i < NUM_THREADS; i++) {
+		tb[i].seed = i;
+	}
+
+	/* allocated and freed by the same threads */
+	run_threads(thread_alloc_func, tb);
+	for (int i = 0; i < NUM_THREADS; i++) {
+		mem_threads += tb[i].mem;
+	}
+	EXPECT_EQ(mem + mem_threads, MEM_get_memory_in_use());
+	EXPECT_EQ(blocks + NUM_THREADS * NUM_BLOCKS, MEM_get_memory_blocks_in_use());
+	EXPECT_LE(mem + mem_threads, MEM_get_peak_memory());
+
+	/* freed by other threads */
+	for (int i = 0; i < NUM_THREADS / 2; i++) {
+		SWAP(ThreadBlocks, tb[i], tb[NUM_THREADS - 1 - i]);
+	}
+	run_threads(thread_free_func, tb);
+	EXPECT_EQ(mem, MEM_get_memory_in_use());
+	EXPECT_EQ(blocks, MEM_get_memory_blocks_in_use());
+
+	/* freed by the main thread, reusing the caches of finished threads */
+	run_threads(thread_alloc_func, tb);
+	for (int i = 0; i < NUM_THREADS; i++) {
+		thread_free_func(&tb[i]);
+	}
+	EXPECT_EQ(mem, MEM_get_memory_in_use());
+	EXPECT_EQ(blocks, MEM_get_memory_blocks_in_use());
+
+	free(tb);
+}
+
+#endif  /* _WIN32 */
@@ -0,0 +1,158 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_compiler_attrs.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "MEM_guardedalloc.h"
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+#include "PIL_time.h"
+}
+
+#include "IMB_scaling_reference.h"
+
+/* Number of times every scaling is repeated. */
+#define NUM_ITERATIONS 5
+
+class ImBufScalingPerformanceTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+		IMB_init();
+	}
+
+	static void TearDownTestCase()
+	{
+		IMB_exit();
+		BLI_threadapi_exit();
+	}
+};
+
+static ImBuf *create_image(int x, int y, int flags)
+{
+	ImBuf *ibuf = IMB_allocImBuf(x, y, 32, flags);
+	RNG *rng = BLI_rng_new(x + y);
+	const size_t size = (size_t)x * y * 4;
+
+	if (ibuf->rect) {
+		unsigned char *rect = (unsigned char *)ibuf->rect;
+		for (size_t i = 0; i < size; i++) {
+			rect[i] = BLI_rng_get_int(rng) & 0xff;
+		}
+	}
+	if (ibuf->rect_float) {
+		for (size_t i = 0; i < size; i++) {
+			ibuf->rect_float[i] = BLI_rng_get_float(rng);
+		}
+	}
+	BLI_rng_free(rng);
+
+	return ibuf;
+}
+
+template <typename T>
+static double scale_reference(const T *rect, int x, int y, int newx, int newy)
+{
+	double time = 0.0;
+
+	for (int i = 0; i < NUM_ITERATIONS; i++) {
+		std::vector<T> buffer(rect, rect + (size_t)x * y * 4);
+		int refx = x, refy = y;
+		const double start = PIL_check_seconds_timer();
+		ref_scale(buffer, refx, refy, newx, newy);
+		time += PIL_check_seconds_timer() - start;
+	}
+
+	return time / NUM_ITERATIONS;
+}
+
+static double scale_imbuf(ImBuf *ibuf, int newx, int newy)
+{
+	double time = 0.0;
+
+	for (int i = 0; i < NUM_ITERATIONS; i++) {
+		ImBuf *copy = IMB_allocImBuf(ibuf->x, ibuf->y, ibuf->planes, ibuf->flags);
+		if (ibuf->rect) {
+			memcpy(copy->rect, ibuf->rect, (size_t)ibuf->x * ibuf->y * sizeof(int));
+		}
+		if (ibuf->rect_float) {
+			memcpy(copy->rect_float, ibuf->rect_float, (size_t)ibuf->x * ibuf->y * sizeof(float) * 4);
+		}
+		const double start = PIL_check_seconds_timer();
+		IMB_scaleImBuf(copy, newx, newy);
+		time += PIL_check_seconds_timer() - start;
+		IMB_freeImBuf(copy);
+	}
+
+	return time / NUM_ITERATIONS;
+}
+
+static void scale_test(int x, int y, int newx, int newy)
+{
+	printf("\n========== STARTING %s, %dx%d to %dx%d ==========\n", __func__, x, y, newx, newy);
+
+	ImBuf *ibuf = create_image(x, y, IB_rect);
+	double time_ref = scale_reference((unsigned char *)ibuf->rect, x, y, newx, newy);
+	double time = scale_imbuf(ibuf, newx, newy);
+	printf("byte: reference %.4fs, optimized %.4fs, %.2fx\n", time_ref, time, time_ref / time);
+	IMB_freeImBuf(ibuf);
+
+	ibuf = create_image(x, y, IB_rectfloat);
+	time_ref = scale_reference(ibuf->rect_float, x, y, newx, newy);
+	time = scale_imbuf(ibuf, newx, newy);
+	printf("float: reference %.4fs, optimized %.4fs, %.2fx\n", time_ref, time, time_ref / time);
+	IMB_freeImBuf(ibuf);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+}
+
+TEST_F(ImBufScalingPerformanceTest, ScaleDownProxy)
+{
+	/* 25% proxy of a 4K frame. */
+	scale_test(3840, 2160, 960, 540);
+}
+
+TEST_F(ImBufScalingPerformanceTest, ScaleDownThumbnail)
+{
+	scale_test(3840, 2160, 128, 72);
+}
+
+TEST_F(ImBufScalingPerformanceTest, ScaleUp)
+{
+	scale_test(960, 540, 3840, 2160);
+}
+
+TEST_F(ImBufScalingPerformanceTest, OneHalf)
+{
+	ImBuf *ibuf = create_image(4096, 4096, IB_rectfloat);
+	double time_ref = 0.0, time = 0.0;
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	for (int i = 0; i < NUM_ITERATIONS; i++) {
+		/* Both include the allocation of the result. */
+		double start = PIL_check_seconds_timer();
+		std::vector<float> ref((size_t)2048 * 2048 * 4);
+		ref_onehalf_float(ibuf->rect_float, &ref[0], 4096, 2048, 2048);
+		time_ref += PIL_check_seconds_timer() - start;
+
+		start = PIL_check_seconds_timer();
+		ImBuf *half = IMB_onehalf(ibuf);
+		time += PIL_check_seconds_timer() - start;
+		IMB_freeImBuf(half);
+	}
+
+	printf("float 4096x4096: reference %.4fs, optimized %.4fs, %.2fx\n",
+	       time_ref / NUM_ITERATIONS, time / NUM_ITERATIONS, time_ref / time);
+	IMB_freeImBuf(ibuf);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+}
@@ -0,0 +1,218 @@
+/* Apache License, Version 2.0 */
+
+#ifndef __IMB_SCALING_REFERENCE_H__
+#define __IMB_SCALING_REFERENCE_H__
+
+#include <vector>
+
+/* Reference scalers, a copy of the scalar per channel loops the optimized ones replace.
+ * The results must be identical to the bit. */
+
+inline void ref_store(unsigned char *dst, float value)
+{
+	*dst = value + 0.5f;
+}
+
+inline void ref_store(float *dst, float value)
+{
+	*dst = value;
+}
+
+inline float ref_half(const unsigned char *)
+{
+	return 0.5f;
+}
+
+inline float ref_half(const float *)
+{
+	return 0.0f;
+}
+
+/* Box filter of a line, the pixels are read and written with a stride of 'skip'. */
+template <typename T>
+inline void ref_scaledown_line(const T *src, T *dst, size_t skip, int newsize, float add)
+{
+	float sample = 0.0f, val[4] = {0.0f}, nval[4];
+
+	for (int i = newsize; i > 0; i--) {
+		for (int c = 0; c < 4; c++) {
+			nval[c] = -val[c] * sample;
+		}
+
+		sample += add;
+
+		while (sample >= 1.0f) {
+			sample -= 1.0f;
+			for (int c = 0; c < 4; c++) {
+				nval[c] += src[c];
+			}
+			src += skip;
+		}
+
+		for (int c = 0; c < 4; c++) {
+			val[c] = src[c];
+			ref_store(&dst[c], (nval[c] + sample * val[c]) / add);
+		}
+		src += skip;
+		dst += skip;
+
+		sample -= 1.0f;
+	}
+}
+
+template <typename T>
+inline void ref_scaleup_line(const T *src, T *dst, size_t skip, int newsize, float add)
+{
+	const float half = ref_half(src);
+	float sample = 0.0f, val[4], nval[4], diff[4];
+
+	for (int c = 0; c < 4; c++) {
+		val[c] = src[c];
+		nval[c] = src[skip + c];
+		diff[c] = nval[c] - val[c];
+		val[c] += half;
+	}
+	src += 2 * skip;
+
+	for (int i = newsize; i > 0; i--) {
+		if (sample >= 1.0f) {
+			sample -= 1.0f;
+			for (int c = 0; c < 4; c++) {
+				val[c] = nval[c];
+				nval[c] = src[c];
+				diff[c] = nval[c] - val[c];
+				val[c] += half;
+			}
+			src += skip;
+		}
+		for (int c = 0; c < 4; c++) {
+			/* The byte result is truncated, the half is already in the value. */
+			dst[c] = val[c] + sample * diff[c];
+		}
+		dst += skip;
+		sample += add;
+	}
+}
+
+template <typename T>
+inline void ref_scale(std::vector<T> &rect, int &x, int &y, int newx, int newy)
+{
+	if (newx < x) {
+		std::vector<T> result((size_t)newx * y * 4);
+		const float add = (x - 0.01) / newx;
+		for (int i = 0; i < y; i++) {
+			ref_scaledown_line(&rect[(size_t)i * x * 4], &result[(size_t)i * newx * 4], 4, newx, add);
+		}
+		rect.swap(result);
+		x = newx;
+	}
+	if (newy < y) {
+		std::vector<T> result((size_t)x * newy * 4);
+		const float add = (y - 0.01) / newy;
+		for (int i = 0; i < x; i++) {
+			ref_scaledown_line(&rect[(size_t)i * 4], &result[(size_t)i * 4], (size_t)x * 4, newy, add);
+		}
+		rect.swap(result);
+		y = newy;
+	}
+	if (newx > x) {
+		std::vector<T> result((size_t)newx * y * 4);
+		const float add = (x - 1.001) / (newx - 1.0);
+		for (int i = 0; i < y; i++) {
+			ref_scaleup_line(&rect[(size_t)i * x * 4], &result[(size_t)i * newx * 4], 4, newx, add);
+		}
+		rect.swap(result);
+		x = newx;
+	}
+	if (newy > y) {
+		std::vector<T> result((size_t)x * newy * 4);
+		const float add = (y - 1.001) / (newy - 1.0);
+		for (int i = 0; i < x; i++) {
+			ref_scaleup_line(&rect[(size_t)i * 4], &result[(size_t)i * 4], (size_t)x * 4, newy, add);
+		}
+		rect.swap(result);
+		y = newy;
+	}
+}
+
+inline void ref_onehalf_float(const float *src, float *dst, int x, int newx, int newy)
+{
+	const float *p1f = src;
+	for (int j = newy; j > 0; j--) {
+		const float *p2f = p1f + (x << 2);
+		for (int i = newx; i > 0; i--) {
+			for (int c = 0; c < 4; c++) {
+				dst[c] = 0.25f * (p1f[c] + p2f[c] + p1f[c + 4] + p2f[c + 4]);
+			}
+			p1f += 8;
+			p2f += 8;
+			dst += 4;
+		}
+		p1f = p2f;
+		if (x & 1) p1f += 4;
+	}
+}
+
+/* The byte pixels are averaged premultiplied, in a ushort range of 255 * 255. */
+inline void ref_straight_uchar_to_premul_ushort(unsigned short result[4], const unsigned char color[4])
+{
+	unsigned short alpha = color[3];
+
+	result[0] = color[0] * alpha;
+	result[1] = color[1] * alpha;
+	result[2] = color[2] * alpha;
+	result[3] = alpha * 256;
+}
+
+inline unsigned char ref_ushort_to_uchar(unsigned int value)
+{
+	return (unsigned char)((value >= 65535 - 128) ? 255 : (value + 128) >> 8);
+}
+
+inline void ref_premul_ushort_to_straight_uchar(unsigned char *result, const unsigned short color[4])
+{
+	if (color[3] <= 255) {
+		result[0] = ref_ushort_to_uchar(color[0]);
+		result[1] = ref_ushort_to_uchar(color[1]);
+		result[2] = ref_ushort_to_uchar(color[2]);
+		result[3] = ref_ushort_to_uchar(color[3]);
+	}
+	else {
+		unsigned short alpha = color[3] / 256;
+
+		result[0] = ref_ushort_to_uchar(color[0] / alpha * 256);
+		result[1] = ref_ushort_to_uchar(color[1] / alpha * 256);
+		result[2] = ref_ushort_to_uchar(color[2] / alpha * 256);
+		result[3] = ref_ushort_to_uchar(color[3]);
+	}
+}
+
+inline void ref_onehalf_byte(const unsigned char *src, unsigned char *dst, int x, int newx, int newy)
+{
+	const unsigned char *cp1 = src;
+	for (int j = newy; j > 0; j--) {
+		const unsigned char *cp2 = cp1 + (x << 2);
+		for (int i = newx; i > 0; i--) {
+			unsigned short p1i[8], p2i[8], desti[4];
+
+			ref_straight_uchar_to_premul_ushort(p1i, cp1);
+			ref_straight_uchar_to_premul_ushort(p2i, cp2);
+			ref_straight_uchar_to_premul_ushort(p1i + 4, cp1 + 4);
+			ref_straight_uchar_to_premul_ushort(p2i + 4, cp2 + 4);
+
+			for (int c = 0; c < 4; c++) {
+				desti[c] = ((unsigned int)p1i[c] + p2i[c] + p1i[c + 4] + p2i[c + 4]) >> 2;
+			}
+
+			ref_premul_ushort_to_straight_uchar(dst, desti);
+
+			cp1 += 8;
+			cp2 += 8;
+			dst += 4;
+		}
+		cp1 = cp2;
+		if (x & 1) cp1 += 4;
+	}
+}
+
+#endif  /* __IMB_SCALING_REFERENCE_H__ */
@@ -0,0 +1,129 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_compiler_attrs.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "MEM_guardedalloc.h"
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+}
+
+#include "IMB_scaling_reference.h"
+
+class ImBufScalingTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+		IMB_init();
+	}
+
+	static void TearDownTestCase()
+	{
+		IMB_exit();
+		BLI_threadapi_exit();
+	}
+
+	std::vector<unsigned char> rect;
+	std::vector<float> rectf;
+
+	ImBuf *create(int x, int y, unsigned int seed)
+	{
+		ImBuf *ibuf = IMB_allocImBuf(x, y, 32, IB_rect | IB_rectfloat);
+		RNG *rng = BLI_rng_new(seed);
+
+		rect.resize((size_t)x * y * 4);
+		rectf.resize((size_t)x * y * 4);
+		for (size_t i = 0; i < rect.size(); i++) {
+			rect[i] = BLI_rng_get_int(rng) & 0xff;
+			/* Include negative and HDR values. */
+			rectf[i] = BLI_rng_get_float(rng) * 3.0f - 0.5f;
+		}
+		BLI_rng_free(rng);
+
+		memcpy(ibuf->rect, &rect[0], rect.size());
+		memcpy(ibuf->rect_float, &rectf[0], rectf.size() * sizeof(float));
+
+		return ibuf;
+	}
+
+	void compare_scale(int x, int y, int newx, int newy)
+	{
+		ImBuf *ibuf = create(x, y, x * 31 + y);
+		int refx = x, refy = y;
+
+		IMB_scaleImBuf(ibuf, newx, newy);
+		ref_scale(rect, refx, refy, newx, newy);
+		refx = x;
+		refy = y;
+		ref_scale(rectf, refx, refy, newx, newy);
+
+		ASSERT_EQ(newx, (int)ibuf->x);
+		ASSERT_EQ(newy, (int)ibuf->y);
+		EXPECT_EQ(0, memcmp(ibuf->rect, &rect[0], rect.size())) << x << "x" << y << " to " << newx << "x" << newy;
+		EXPECT_EQ(0, memcmp(ibuf->rect_float, &rectf[0], rectf.size() * sizeof(float)))
+		        << x << "x" << y << " to " << newx << "x" << newy;
+
+		IMB_freeImBuf(ibuf);
+	}
+};
+
+TEST_F(ImBufScalingTest, ScaleDown)
+{
+	compare_scale(64, 48, 32, 24);
+	compare_scale(101, 77, 33, 50);
+	compare_scale(640, 480, 17, 13);
+	compare_scale(1, 9, 1, 4);
+	compare_scale(9, 1, 4, 1);
+}
+
+TEST_F(ImBufScalingTest, ScaleUp)
+{
+	compare_scale(32, 24, 64, 48);
+	compare_scale(33, 50, 101, 77);
+	compare_scale(2, 2, 9, 7);
+}
+
+TEST_F(ImBufScalingTest, ScaleMixed)
+{
+	compare_scale(100, 40, 60, 90);
+	compare_scale(40, 100, 90, 60);
+}
+
+TEST_F(ImBufScalingTest, ScaleThreaded)
+{
+	/* Large enough to be split between threads. */
+	compare_scale(1920, 1080, 1280, 720);
+	compare_scale(640, 360, 1921, 1081);
+}
+
+TEST_F(ImBufScalingTest, OneHalf)
+{
+	const int sizes[][2] = {{64, 64}, {101, 77}, {1023, 767}};
+
+	for (int i = 0; i < (int)ARRAY_SIZE(sizes); i++) {
+		const int x = sizes[i][0], y = sizes[i][1];
+		ImBuf *ibuf = create(x, y, i);
+		ImBuf *half = IMB_onehalf(ibuf);
+		std::vector<unsigned char> ref((size_t)(x / 2) * (y / 2) * 4);
+		std::vector<float> reff(ref.size());
+
+		ref_onehalf_byte(&rect[0], &ref[0], x, x / 2, y / 2);
+		ref_onehalf_float(&rectf[0], &reff[0], x, x / 2, y / 2);
+
+		ASSERT_EQ(x / 2, (int)half->x);
+		ASSERT_EQ(y / 2, (int)half->y);
+		EXPECT_EQ(0, memcmp(half->rect, &ref[0], ref.size())) << x << "x" << y;
+		EXPECT_EQ(0, memcmp(half->rect_float, &reff[0], reff.size() * sizeof(float))) << x << "x" << y;
+
+		IMB_freeImBuf(half);
+		IMB_freeImBuf(ibuf);
+	}
+}
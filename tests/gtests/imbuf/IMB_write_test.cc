@@ -0,0 +1,267 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include <png.h>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_compiler_attrs.h"
+#include "BLI_fileops.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+#include "MEM_guardedalloc.h"
+#include "DNA_listBase.h"
+#include "IMB_imbuf.h"
+#include "IMB_imbuf_types.h"
+}
+
+class ImBufWriteTest : public testing::Test {
+protected:
+	static void SetUpTestCase()
+	{
+		BLI_threadapi_init();
+		IMB_init();
+	}
+
+	static void TearDownTestCase()
+	{
+		IMB_exit();
+		BLI_threadapi_exit();
+	}
+};
+
+static std::string temp_dir()
+{
+	const char *dir = getenv("TMPDIR");
+	std::string path = dir ? dir : "/tmp";
+
+	if (path.empty() || (path[path.size() - 1] != '/' && path[path.size() - 1] != '\\')) {
+		path += '/';
+	}
+
+	return path;
+}
+
+/* Gradients with noise, compressible but not trivially. */
+static ImBuf *create_image(int x, int y, int planes, int quality, bool is_16bit)
+{
+	ImBuf *ibuf = IMB_allocImBuf(x, y, planes, IB_rect);
+	unsigned char *rect = (unsigned char *)ibuf->rect;
+	RNG *rng = BLI_rng_new(x * 31 + y);
+
+	for (int j = 0; j < y; j++) {
+		for (int i = 0; i < x; i++) {
+			unsigned char *pixel = rect + ((size_t)j * x + i) * 4;
+			const int noise = BLI_rng_get_int(rng) & 0x7;
+			pixel[0] = (i + noise) & 0xff;
+			pixel[1] = (j * 3 + noise) & 0xff;
+			pixel[2] = ((i ^ j) + noise) & 0xff;
+			pixel[3] = (255 - noise) & 0xff;
+		}
+	}
+	BLI_rng_free(rng);
+
+	ibuf->ftype = IMB_FTYPE_PNG;
+	ibuf->foptions.quality = quality;
+	if (is_16bit) {
+		ibuf->foptions.flag |= PNG_16BIT;
+	}
+
+	return ibuf;
+}
+
+struct PNGMemory {
+	const unsigned char *data;
+	size_t size;
+	size_t seek;
+};
+
+static void png_read_memory(png_structp png_ptr, png_bytep data, png_size_t length)
+{
+	PNGMemory *mem = (PNGMemory *)png_get_io_ptr(png_ptr);
+
+	if (length > mem->size - mem->seek) {
+		png_error(png_ptr, "end of data");
+	}
+	memcpy(data, mem->data + mem->seek, length);
+	mem->seek += length;
+}
+
+/* Decode with libpng only, the samples in file order and native endianness. */
+static bool decode_png(const unsigned char *data, size_t size, int *r_channels, int *r_depth,
+                       std::vector<unsigned char> &r_pixels)
+{
+	png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info_ptr = png_create_info_struct(png_ptr);
+	PNGMemory mem = {data, size, 0};
+	std::vector<png_bytep> rows;
+
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		return false;
+	}
+
+	png_set_read_fn(png_ptr, &mem, png_read_memory);
+	png_read_info(png_ptr, info_ptr);
+
+	const int width = png_get_image_width(png_ptr, info_ptr);
+	const int height = png_get_image_height(png_ptr, info_ptr);
+	*r_channels = png_get_channels(png_ptr, info_ptr);
+	*r_depth = png_get_bit_depth(png_ptr, info_ptr);
+
+#ifdef __LITTLE_ENDIAN__
+	if (*r_depth == 16) {
+		png_set_swap(png_ptr);
+	}
+#endif
+
+	const size_t rowbytes = (size_t)width * *r_channels * (*r_depth / 8);
+	r_pixels.resize(rowbytes * height);
+	rows.resize(height);
+	for (int i = 0; i < height; i++) {
+		rows[i] = &r_pixels[rowbytes * i];
+	}
+
+	png_read_image(png_ptr, &rows[0]);
+	png_read_end(png_ptr, NULL);
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+
+	return true;
+}
+
+static void compare_png(int x, int y, int planes, int quality, bool is_16bit)
+{
+	ImBuf *ibuf = create_image(x, y, planes, quality, is_16bit);
+	const int channels = (planes + 7) / 8;
+
+	ASSERT_TRUE(IMB_saveiff(ibuf, "<memory>", IB_rect | IB_mem));
+
+	std::vector<unsigned char> pixels;
+	int decoded_channels, depth;
+	ASSERT_TRUE(decode_png(ibuf->encodedbuffer, ibuf->encodedsize, &decoded_channels, &depth, pixels))
+	        << x << "x" << y << " planes " << planes << " quality " << quality;
+	ASSERT_EQ(channels, decoded_channels);
+	ASSERT_EQ(is_16bit ? 16 : 8, depth);
+
+	const unsigned char *rect = (unsigned char *)ibuf->rect;
+	int errors = 0;
+
+	for (int j = 0; j < y; j++) {
+		/* the rows of the file are from the top */
+		const unsigned char *from = rect + (size_t)(y - 1 - j) * x * 4;
+
+		for (int i = 0; i < x; i++) {
+			for (int c = 0; c < channels; c++) {
+				const size_t index = ((size_t)j * x + i) * channels + c;
+				int expected = from[i * 4 + c], value;
+
+				if (is_16bit) {
+					expected = (expected << 8) + expected;
+					value = ((unsigned short *)&pixels[0])[index];
+				}
+				else {
+					value = pixels[index];
+				}
+				errors += (value != expected);
+			}
+		}
+	}
+
+	EXPECT_EQ(0, errors) << x << "x" << y << " planes " << planes << " quality " << quality;
+
+	IMB_freeImBuf(ibuf);
+}
+
+TEST_F(ImBufWriteTest, PNGSmall)
+{
+	/* Written by libpng in one go. */
+	compare_png(64, 48, 32, 90, false);
+	compare_png(64, 48, 24, 90, false);
+}
+
+TEST_F(ImBufWriteTest, PNGParallel)
+{
+	/* Large enough to be deflated in several chunks. */
+	compare_png(1023, 517, 32, 90, false);
+	compare_png(1023, 517, 24, 15, false);
+	compare_png(1023, 517, 8, 100, false);
+	compare_png(700, 400, 32, 0, false);
+}
+
+TEST_F(ImBufWriteTest, PNGParallel16Bit)
+{
+	compare_png(611, 333, 32, 90, true);
+	compare_png(611, 333, 24, 50, true);
+}
+
+TEST_F(ImBufWriteTest, WriteQueue)
+{
+	const std::string dir = temp_dir();
+	std::vector<std::string> paths;
+
+	for (int i = 0; i < 4; i++) {
+		ImBuf *ibuf = create_image(320 + i, 200, 32, 90, false);
+		paths.push_back(dir + "imb_write_queue_" + std::to_string(i) + ".png");
+		IMB_write_queue_push(ibuf, paths.back().c_str(), IB_rect);
+	}
+
+	EXPECT_EQ(0, IMB_write_queue_wait());
+
+	for (int i = 0; i < (int)paths.size(); i++) {
+		ImBuf *ibuf = IMB_loadiffname(paths[i].c_str(), IB_rect, NULL);
+		ASSERT_TRUE(ibuf != NULL) << paths[i];
+		EXPECT_EQ(320 + i, ibuf->x);
+		EXPECT_EQ(200, ibuf->y);
+		IMB_freeImBuf(ibuf);
+		BLI_delete(paths[i].c_str(), false, false);
+	}
+
+	/* A directory which doesn't exist. */
+	ImBuf *ibuf = create_image(16, 16, 32, 90, false);
+	IMB_write_queue_push(ibuf, (dir + "imb_write_queue_missing/image.png").c_str(), IB_rect);
+	EXPECT_EQ(1, IMB_write_queue_wait());
+	EXPECT_EQ(0, IMB_write_queue_wait());
+}
+
+static void *write_queue_push_thread(void *data)
+{
+	const std::vector<std::string> *paths = (const std::vector<std::string> *)data;
+
+	for (int i = 0; i < (int)paths->size(); i++) {
+		IMB_write_queue_push(create_image(64 + i, 48, 32, 90, false), (*paths)[i].c_str(), IB_rect);
+	}
+
+	return NULL;
+}
+
+TEST_F(ImBufWriteTest, WriteQueueFromThread)
+{
+	/* Render jobs push the frames from their own thread. */
+	const std::string dir = temp_dir();
+	std::vector<std::string> paths;
+	ListBase threads;
+
+	for (int i = 0; i < 3; i++) {
+		paths.push_back(dir + "imb_write_queue_thread_" + std::to_string(i) + ".png");
+	}
+
+	BLI_init_threads(&threads, write_queue_push_thread, 1);
+	BLI_insert_thread(&threads, &paths);
+	BLI_end_threads(&threads);
+
+	EXPECT_EQ(0, IMB_write_queue_wait());
+
+	for (int i = 0; i < (int)paths.size(); i++) {
+		ImBuf *ibuf = IMB_loadiffname(paths[i].c_str(), IB_rect, NULL);
+		ASSERT_TRUE(ibuf != NULL) << paths[i];
+		EXPECT_EQ(64 + i, ibuf->x);
+		IMB_freeImBuf(ibuf);
+		BLI_delete(paths[i].c_str(), false, false);
+	}
+}